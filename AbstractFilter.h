@@ -58,6 +58,18 @@ class AbstractFilter : public ref_countable {
 
   virtual QDomElement saveSettings(const ProjectWriter& writer, QDomDocument& doc) const = 0;
 
+  /**
+   * \brief Brings a previously saved settings element up to date in place.
+   *
+   * \p filter_el is this filter's element from an earlier saveSettings()
+   * call.  Filters that track which pages were modified may rewrite just
+   * the affected records and return true.  Returning false tells the
+   * caller to rebuild the element from scratch with saveSettings().
+   */
+  virtual bool updateSavedSettings(const ProjectWriter& writer, QDomDocument& doc, QDomElement& filter_el) {
+    return false;
+  }
+
   virtual void loadSettings(const ProjectReader& reader, const QDomElement& filters_el) = 0;
 
   virtual void loadDefaultSettings(const PageInfo& page_info) = 0;
@@ -40,7 +40,7 @@ class BackgroundExecutor::Impl : public QThread {
 
   ~Impl() override;
 
-  void enqueueTask(const TaskPtr& task);
+  void enqueueTask(const TaskPtr& task, Priority priority);
 
  protected:
   void run() override;
@@ -64,9 +64,9 @@ void BackgroundExecutor::shutdown() {
   m_impl.reset();
 }
 
-void BackgroundExecutor::enqueueTask(const TaskPtr& task) {
+void BackgroundExecutor::enqueueTask(const TaskPtr& task, const Priority priority) {
   if (m_impl) {
-    m_impl->enqueueTask(task);
+    m_impl->enqueueTask(task, priority);
   }
 }
 
@@ -82,6 +82,13 @@ void BackgroundExecutor::Dispatcher::customEvent(QEvent* event) {
     const TaskPtr& task = evt->payload();
     assert(task);
 
+    if (const auto* cancellable = dynamic_cast<const Cancellable*>(task.get())) {
+      if (cancellable->isCancelled()) {
+        // The task went stale while queued; drop it without executing.
+        return;
+      }
+    }
+
     const TaskResultPtr result((*task)());
     if (result) {
       QCoreApplication::postEvent(&m_owner, new ResultEvent(result));
@@ -103,8 +110,17 @@ BackgroundExecutor::Impl::~Impl() {
   wait();
 }
 
-void BackgroundExecutor::Impl::enqueueTask(const TaskPtr& task) {
-  QCoreApplication::postEvent(&m_dispatcher, new TaskEvent(task));
+void BackgroundExecutor::Impl::enqueueTask(const TaskPtr& task, const Priority priority) {
+  // Qt delivers higher-priority events first, so the priority levels
+  // ride on the existing event queue.
+  int event_priority = Qt::NormalEventPriority;
+  if (priority == INTERACTIVE) {
+    event_priority = Qt::HighEventPriority;
+  } else if (priority == SPECULATIVE) {
+    event_priority = Qt::LowEventPriority;
+  }
+
+  QCoreApplication::postEvent(&m_dispatcher, new TaskEvent(task), event_priority);
   if (!m_threadStarted) {
     start();
     m_threadStarted = true;
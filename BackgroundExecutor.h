@@ -32,6 +32,28 @@ class BackgroundExecutor {
   typedef intrusive_ptr<AbstractCommand<void>> TaskResultPtr;
   typedef intrusive_ptr<AbstractCommand<TaskResultPtr>> TaskPtr;
 
+  enum Priority {
+    INTERACTIVE, /**< The user is waiting for the result right now. */
+    PREFETCH,    /**< Likely to be needed soon, but nobody is waiting yet. */
+    SPECULATIVE  /**< May well turn out to be unnecessary. */
+  };
+
+  /**
+   * \brief An optional interface for tasks that may go stale while queued.
+   *
+   * A queued task implementing it is dropped right before execution if
+   * isCancelled() returns true, rather than being executed and having
+   * its result discarded.  isCancelled() is called from the background
+   * thread and therefore must be thread-safe.
+   */
+  class Cancellable {
+   public:
+    virtual bool isCancelled() const = 0;
+
+   protected:
+    virtual ~Cancellable() = default;
+  };
+
   BackgroundExecutor();
 
   /**
@@ -55,8 +77,11 @@ class BackgroundExecutor {
    * That functor may optionally return another one, that is
    * to be executed in the thread where this BackgroundExecutor
    * object was constructed.
+   *
+   * Higher-priority tasks are executed before lower-priority ones
+   * regardless of the order they were enqueued in.
    */
-  void enqueueTask(const TaskPtr& task);
+  void enqueueTask(const TaskPtr& task, Priority priority = INTERACTIVE);
 
  private:
   class Impl;
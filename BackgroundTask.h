@@ -21,6 +21,7 @@
 
 #include <QAtomicInt>
 #include <exception>
+#include <utility>
 #include "AbstractCommand.h"
 #include "FilterResult.h"
 #include "TaskStatus.h"
@@ -36,6 +37,8 @@ class BackgroundTask : public AbstractCommand<FilterResultPtr>, public TaskStatu
   };
 
 
+  typedef AbstractCommand<void, const FilterResultPtr&> IntermediateResultSink;
+
   explicit BackgroundTask(Type type) : m_type(type) {}
 
   Type type() const { return m_type; }
@@ -49,8 +52,25 @@ class BackgroundTask : public AbstractCommand<FilterResultPtr>, public TaskStatu
    */
   void throwIfCancelled() const override;
 
+  /**
+   * \brief Installs the channel deliverIntermediateResult() reports through.
+   *
+   * To be called by whoever is about to run the task, before execution
+   * starts.  The sink is invoked from the thread running the task.
+   */
+  void setIntermediateResultSink(intrusive_ptr<IntermediateResultSink> sink) {
+    m_intermediateResultSink = std::move(sink);
+  }
+
+  void deliverIntermediateResult(const FilterResultPtr& result) const override {
+    if (m_intermediateResultSink && result) {
+      (*m_intermediateResultSink)(result);
+    }
+  }
+
  private:
   QAtomicInt m_cancelFlag;
+  intrusive_ptr<IntermediateResultSink> m_intermediateResultSink;
   const Type m_type;
 };
 
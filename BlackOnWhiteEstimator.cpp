@@ -1,9 +1,12 @@
 
 #include "BlackOnWhiteEstimator.h"
 #include <imageproc/Binarize.h>
+#include <algorithm>
+#include <cmath>
 #include <imageproc/Grayscale.h>
 #include <imageproc/Morphology.h>
 #include <imageproc/PolygonRasterizer.h>
+#include <imageproc/PolygonUtils.h>
 #include <imageproc/RasterOp.h>
 #include <imageproc/Transform.h>
 #include "DebugImages.h"
@@ -12,6 +15,125 @@
 
 using namespace imageproc;
 
+namespace {
+const int SAMPLE_BLOCK_SIZE = 32;
+
+const double SAMPLE_FRACTION = 0.05;
+
+/** Sampled blocks are processed in batches of this many, with an
+ * early-exit check in between. */
+const int BLOCKS_PER_BATCH = 16;
+
+/** An early exit requires the black pixel fraction to be this far
+ * from the 50% decision boundary. */
+const double EARLY_EXIT_MARGIN = 0.1;
+
+/** After the full sample has been taken, estimates closer to the
+ * boundary than this still fall back to the full analysis. */
+const double FINAL_MARGIN = 0.03;
+
+const int MIN_SAMPLED_PIXELS = 10000;
+
+int greatestCommonDivisor(int a, int b) {
+  while (b != 0) {
+    const int r = a % b;
+    a = b;
+    b = r;
+  }
+
+  return a;
+}
+
+/**
+ * Computes the fraction of pixels the Otsu threshold of the sampled
+ * histogram would classify as black.  Returns -1.0 when the sample
+ * is too small to be meaningful.
+ */
+double sampledBlackFraction(const GrayscaleHistogram& hist) {
+  long total_pixels = 0;
+  for (int i = 0; i < 256; ++i) {
+    total_pixels += hist[i];
+  }
+  if (total_pixels < MIN_SAMPLED_PIXELS) {
+    return -1.0;
+  }
+
+  const int threshold = BinaryThreshold::otsuThreshold(hist);
+  long black_pixels = 0;
+  for (int i = 0; i < threshold; ++i) {
+    black_pixels += hist[i];
+  }
+
+  return double(black_pixels) / double(total_pixels);
+}
+
+/**
+ * Tries to decide the polarity from a sparse but well spread subset
+ * of image blocks.  Returns 1 for black-on-white, 0 for the opposite,
+ * and -1 when the sampled estimate is too close to the decision
+ * boundary to be trusted.
+ */
+int estimatePolarityBySampling(const GrayImage& img, const BinaryImage& mask) {
+  const int width = img.width();
+  const int height = img.height();
+  const int blocks_x = (width + SAMPLE_BLOCK_SIZE - 1) / SAMPLE_BLOCK_SIZE;
+  const int blocks_y = (height + SAMPLE_BLOCK_SIZE - 1) / SAMPLE_BLOCK_SIZE;
+  const int total_blocks = blocks_x * blocks_y;
+  const auto target_pixels = (long) (double(width) * double(height) * SAMPLE_FRACTION);
+
+  // Stepping through the blocks with a stride derived from the golden
+  // ratio visits them in a scattered low-discrepancy order, reaching
+  // every block exactly once before wrapping around.
+  int stride = std::max(1, qRound(total_blocks * 0.618034));
+  while (greatestCommonDivisor(stride, total_blocks) != 1) {
+    ++stride;
+  }
+
+  const uint8_t* const img_data = img.data();
+  const int img_stride = img.stride();
+  const uint32_t* const mask_data = mask.data();
+  const int mask_wpl = mask.wordsPerLine();
+
+  GrayscaleHistogram hist;
+  long covered_pixels = 0;
+  int block = 0;
+  for (int i = 0; i < total_blocks; ++i, block = (block + stride) % total_blocks) {
+    const int x_begin = (block % blocks_x) * SAMPLE_BLOCK_SIZE;
+    const int y_begin = (block / blocks_x) * SAMPLE_BLOCK_SIZE;
+    const int x_end = std::min(x_begin + SAMPLE_BLOCK_SIZE, width);
+    const int y_end = std::min(y_begin + SAMPLE_BLOCK_SIZE, height);
+
+    const uint8_t* img_line = img_data + y_begin * img_stride;
+    const uint32_t* mask_line = mask_data + y_begin * mask_wpl;
+    for (int y = y_begin; y < y_end; ++y, img_line += img_stride, mask_line += mask_wpl) {
+      for (int x = x_begin; x < x_end; ++x) {
+        if (mask_line[x >> 5] & (uint32_t(1) << (31 - (x & 31)))) {
+          ++hist[img_line[x]];
+        }
+      }
+    }
+    covered_pixels += (x_end - x_begin) * (y_end - y_begin);
+
+    if (covered_pixels >= target_pixels) {
+      break;
+    }
+    if ((i + 1) % BLOCKS_PER_BATCH == 0) {
+      const double black_fraction = sampledBlackFraction(hist);
+      if ((black_fraction >= 0.0) && (std::fabs(black_fraction - 0.5) > EARLY_EXIT_MARGIN)) {
+        return black_fraction <= 0.5 ? 1 : 0;
+      }
+    }
+  }
+
+  const double black_fraction = sampledBlackFraction(hist);
+  if ((black_fraction >= 0.0) && (std::fabs(black_fraction - 0.5) > FINAL_MARGIN)) {
+    return black_fraction <= 0.5 ? 1 : 0;
+  }
+
+  return -1;
+}
+}  // namespace
+
 bool BlackOnWhiteEstimator::isBlackOnWhiteRefining(const imageproc::GrayImage& grayImage,
                                                    const ImageTransformation& xform,
                                                    const TaskStatus& status,
@@ -82,6 +204,14 @@ bool BlackOnWhiteEstimator::isBlackOnWhite(const GrayImage& img, const BinaryIma
     throw std::invalid_argument("BlackOnWhiteEstimator: img and mask have different sizes");
   }
 
+  // This runs for every page on project loading, so the polarity is
+  // first estimated from a 5% sample of the image and the full
+  // analysis is reserved for the cases close to the decision boundary.
+  const int sampled_verdict = estimatePolarityBySampling(img, mask);
+  if (sampled_verdict >= 0) {
+    return sampled_verdict != 0;
+  }
+
   BinaryImage bwImage(img, BinaryThreshold::otsuThreshold(GrayscaleHistogram(img, mask)));
   rasterOp<RopAnd<RopSrc, RopDst>>(bwImage, mask);
 
@@ -92,7 +222,7 @@ bool BlackOnWhiteEstimator::isBlackOnWhite(const GrayImage& img, const QPolygonF
   if (img.isNull()) {
     throw std::invalid_argument("BlackOnWhiteEstimator: image is null.");
   }
-  if (cropArea.intersected(QRectF(img.rect())).isEmpty()) {
+  if (PolygonUtils::clipToRect(cropArea, QRectF(img.rect())).isEmpty()) {
     throw std::invalid_argument("BlackOnWhiteEstimator: the cropping area is wrong.");
   }
 
@@ -0,0 +1,173 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BookPriors.h"
+
+#include <QSettings>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Consistency thresholds and minimum band half-widths, chosen so that
+// a clean book establishes its bands within the first chapter while a
+// mixed batch of unrelated scans never does.
+const double SKEW_MAX_SIGMA_DEG = 1.0;
+const double SKEW_MIN_HALF_WIDTH_DEG = 0.5;
+const double SPLIT_MAX_SIGMA = 0.03;
+const double SPLIT_MIN_HALF_WIDTH = 0.02;
+const double MARGIN_MAX_SIGMA = 0.05;
+const double MARGIN_MIN_HALF_WIDTH = 0.04;
+
+const char* const MARGIN_KEYS[4] = {"content_left", "content_top", "content_right", "content_bottom"};
+}  // namespace
+
+BookPriors& BookPriors::instance() {
+  static BookPriors the_instance;
+
+  return the_instance;
+}
+
+void BookPriors::Estimator::add(const double sample) {
+  n += 1;
+  const double delta = sample - mean;
+  mean += delta / n;
+  m2 += delta * (sample - mean);
+}
+
+double BookPriors::Estimator::sigma() const {
+  return (n > 1) ? std::sqrt(m2 / (n - 1)) : 0;
+}
+
+bool BookPriors::Estimator::band(double& center,
+                                 double& half_width,
+                                 const double max_sigma,
+                                 const double min_half_width) const {
+  if ((n < MIN_SAMPLES) || (sigma() > max_sigma)) {
+    return false;
+  }
+
+  center = mean;
+  half_width = std::max(3 * sigma(), min_half_width);
+
+  return true;
+}
+
+void BookPriors::addSkewSample(const double degrees) {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+  m_skew.add(degrees);
+}
+
+void BookPriors::addContentMarginsSample(const double left, const double top, const double right, const double bottom) {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+  const double margins[4] = {left, top, right, bottom};
+  for (int i = 0; i < 4; ++i) {
+    m_contentMargins[i].add(margins[i]);
+  }
+}
+
+void BookPriors::addSplitPositionSample(const double x_fraction) {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+  m_split.add(x_fraction);
+}
+
+bool BookPriors::skewBand(double& center_degrees, double& half_width_degrees) const {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  return m_skew.band(center_degrees, half_width_degrees, SKEW_MAX_SIGMA_DEG, SKEW_MIN_HALF_WIDTH_DEG);
+}
+
+bool BookPriors::shrinkToContentBand(QRectF& rect) const {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  double center[4], half_width[4];
+  for (int i = 0; i < 4; ++i) {
+    if (!m_contentMargins[i].band(center[i], half_width[i], MARGIN_MAX_SIGMA, MARGIN_MIN_HALF_WIDTH)) {
+      return false;
+    }
+  }
+
+  // Shrink each edge by the prior margin less the slack, never
+  // crossing the middle of the rect.
+  const double left = std::max(0.0, center[0] - half_width[0]) * rect.width();
+  const double top = std::max(0.0, center[1] - half_width[1]) * rect.height();
+  const double right = std::max(0.0, center[2] - half_width[2]) * rect.width();
+  const double bottom = std::max(0.0, center[3] - half_width[3]) * rect.height();
+  if ((left + right >= 0.5 * rect.width()) || (top + bottom >= 0.5 * rect.height())) {
+    return false;
+  }
+
+  rect.adjust(left, top, -right, -bottom);
+
+  return true;
+}
+
+bool BookPriors::splitPositionBand(double& center_fraction, double& half_width_fraction) const {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  return m_split.band(center_fraction, half_width_fraction, SPLIT_MAX_SIGMA, SPLIT_MIN_HALF_WIDTH);
+}
+
+void BookPriors::clear() {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+  m_skew = Estimator();
+  m_split = Estimator();
+  for (Estimator& estimator : m_contentMargins) {
+    estimator = Estimator();
+  }
+}
+
+QString BookPriors::priorsFilePath(const QString& dir) {
+  return dir + "/book_priors.conf";
+}
+
+void BookPriors::load(const QString& dir) {
+  QSettings file(priorsFilePath(dir), QSettings::IniFormat);
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  const auto load_one = [&file](Estimator& estimator, const QString& key) {
+    const double n = file.value(key + "/n", 0).toDouble();
+    if (n > estimator.n) {
+      estimator.n = n;
+      estimator.mean = file.value(key + "/mean", 0).toDouble();
+      estimator.m2 = file.value(key + "/m2", 0).toDouble();
+    }
+  };
+
+  load_one(m_skew, "skew");
+  load_one(m_split, "split");
+  for (int i = 0; i < 4; ++i) {
+    load_one(m_contentMargins[i], MARGIN_KEYS[i]);
+  }
+}
+
+void BookPriors::save(const QString& dir) const {
+  QSettings file(priorsFilePath(dir), QSettings::IniFormat);
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  const auto save_one = [&file](const Estimator& estimator, const QString& key) {
+    file.setValue(key + "/n", estimator.n);
+    file.setValue(key + "/mean", estimator.mean);
+    file.setValue(key + "/m2", estimator.m2);
+  };
+
+  save_one(m_skew, "skew");
+  save_one(m_split, "split");
+  for (int i = 0; i < 4; ++i) {
+    save_one(m_contentMargins[i], MARGIN_KEYS[i]);
+  }
+}
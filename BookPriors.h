@@ -0,0 +1,126 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOOKPRIORS_H_
+#define BOOKPRIORS_H_
+
+#include <QRectF>
+#include <QString>
+#include <mutex>
+#include "NonCopyable.h"
+
+/**
+ * \brief Book-level priors learned from the auto-detectors' own results.
+ *
+ * Within one book the auto-detectors keep rediscovering much the same
+ * answers page after page: the skew stays within a fraction of a
+ * degree, the fold sits in the same place, the text block keeps its
+ * margins.  Each detector feeds its per-page result in here; once
+ * enough consistent samples accumulate, a prior band is established
+ * and the detectors use it to shrink their search spaces on the
+ * remaining pages.  An inconsistent book simply never establishes a
+ * band and detection proceeds as before.
+ *
+ * The priors are advisory: every consumer falls back to the full
+ * search when a result constrained by the band looks wrong, so an
+ * odd page (a plate, a fold-out) costs one extra detection pass
+ * rather than a wrong answer.
+ *
+ * The accumulated state can be persisted next to the output files, so
+ * a batch resumed or sharded across machines starts out warm.
+ * May be used from any thread.
+ */
+class BookPriors {
+  DECLARE_NON_COPYABLE(BookPriors)
+
+ public:
+  static BookPriors& instance();
+
+  /** Feeds a confidently detected skew angle, in degrees. */
+  void addSkewSample(double degrees);
+
+  /**
+   * Feeds detected content margins, each as a fraction of the
+   * corresponding page box dimension.
+   */
+  void addContentMarginsSample(double left, double top, double right, double bottom);
+
+  /** Feeds a detected fold position as a fraction of the image width. */
+  void addSplitPositionSample(double x_fraction);
+
+  /**
+   * \brief The skew band of this book, centered at \p center_degrees.
+   *
+   * \return false until enough consistent samples have accumulated.
+   */
+  bool skewBand(double& center_degrees, double& half_width_degrees) const;
+
+  /**
+   * \brief Shrinks \p rect to the area the content is expected in.
+   *
+   * The band is the prior margins less a generous slack, so content
+   * that wanders a little stays inside it.  \return false, leaving
+   * \p rect untouched, while no content prior is established.
+   */
+  bool shrinkToContentBand(QRectF& rect) const;
+
+  /** \see skewBand() */
+  bool splitPositionBand(double& center_fraction, double& half_width_fraction) const;
+
+  void clear();
+
+  /** Merges previously persisted samples from \p dir, if any. */
+  void load(const QString& dir);
+
+  /** Persists the accumulated samples to \p dir. */
+  void save(const QString& dir) const;
+
+ private:
+  /** Running mean / variance accumulator (Welford's algorithm). */
+  struct Estimator {
+    double n = 0;
+    double mean = 0;
+    double m2 = 0;
+
+    void add(double sample);
+
+    double sigma() const;
+
+    /**
+     * \return true once there are enough samples and they are
+     *         consistent (sigma below \p max_sigma), producing a band
+     *         of at least \p min_half_width around the mean.
+     */
+    bool band(double& center, double& half_width, double max_sigma, double min_half_width) const;
+  };
+
+  BookPriors() = default;
+
+  static QString priorsFilePath(const QString& dir);
+
+  /** Samples needed before a band is trusted. */
+  static const int MIN_SAMPLES = 12;
+
+  mutable std::mutex m_mutex;
+  Estimator m_skew;
+  Estimator m_split;
+  Estimator m_contentMargins[4];  // left, top, right, bottom
+};
+
+
+#endif  // ifndef BOOKPRIORS_H_
@@ -97,6 +97,13 @@ bool CommandLine::parseCli(const QStringList& argv) {
   opts << "depth-perception";
   opts << "start-filter";
   opts << "end-filter";
+  opts << "threads";
+  opts << "start-page";
+  opts << "end-page";
+  opts << "work-dir";
+  opts << "json-progress";
+  opts << "resume";
+  opts << "daemon";
   opts << "output-project";
   opts << "picture-shape";
   opts << "language";
@@ -238,9 +245,14 @@ void CommandLine::setup() {
   m_skewDeviation = fetchSkewDeviation();
   m_startFilterIdx = fetchStartFilterIdx();
   m_endFilterIdx = fetchEndFilterIdx();
+  m_threads = fetchThreads();
+  m_startPage = fetchStartPage();
+  m_endPage = fetchEndPage();
+  m_workDir = fetchWorkDir();
   m_matchLayoutTolerance = fetchMatchLayoutTolerance();
   m_dewarpingOptions = output::DewarpingOptions(fetchDewarpingMode());
   m_language = fetchLanguage();
+  m_daemonSocket = fetchDaemonSocket();
   m_windowTitle = fetchWindowTitle();
   m_pageDetectionBox = fetchPageDetectionBox();
   m_pageDetectionTolerance = fetchPageDetectionTolerance();
@@ -363,6 +375,26 @@ void CommandLine::printHelp() {
   std::cout << "\t--depth-perception=<1.0...3.0>\t\t-- default: 2.0" << std::endl;
   std::cout << "\t--start-filter=<1...6>\t\t\t-- default: 4" << std::endl;
   std::cout << "\t--end-filter=<1...6>\t\t\t-- default: 6" << std::endl;
+  std::cout << "\t--threads=<n>\t\t\t\t-- number of pages processed concurrently; default: number of cores"
+            << std::endl;
+  std::cout << "\t--start-page=<n>\t\t\t-- 1-based; process only pages n and later" << std::endl;
+  std::cout << "\t--end-page=<n>\t\t\t\t-- 1-based; process only pages up to and including n;" << std::endl;
+  std::cout << "\t\t\t\t\t\t   several invocations with disjoint page ranges may process" << std::endl;
+  std::cout << "\t\t\t\t\t\t   the same project file; each writes a shard manifest listing" << std::endl;
+  std::cout << "\t\t\t\t\t\t   the output files it produced" << std::endl;
+  std::cout << "\t--work-dir=<dir>\t\t\t-- claim pages dynamically through a shared directory;" << std::endl;
+  std::cout << "\t\t\t\t\t\t   several machines may run the same project against shared" << std::endl;
+  std::cout << "\t\t\t\t\t\t   storage, each claiming pages atomically as it goes and" << std::endl;
+  std::cout << "\t\t\t\t\t\t   writing a worker manifest of the pages it produced;" << std::endl;
+  std::cout << "\t\t\t\t\t\t   remove the claims/ subdirectory to reprocess from scratch" << std::endl;
+  std::cout << "\t--json-progress\t\t\t\t-- print one JSON line to stdout per processed page, with" << std::endl;
+  std::cout << "\t\t\t\t\t\t   stage, duration, peak image memory and a running ETA;" << std::endl;
+  std::cout << "\t\t\t\t\t\t   meant for orchestration layers driving batch runs" << std::endl;
+  std::cout << "\t--resume\t\t\t\t-- skip pages recorded as completed in the batch checkpoint" << std::endl;
+  std::cout << "\t\t\t\t\t\t   file of a previous (interrupted) run with the same settings" << std::endl;
+  std::cout << "\t--daemon[=<socket_name>]\t\t-- keep running and accept jobs over a local socket;" << std::endl;
+  std::cout << "\t\t\t\t\t\t   each job is the usual argument list, one argument per line," << std::endl;
+  std::cout << "\t\t\t\t\t\t   terminated by an empty line; default socket: scantailor-cli" << std::endl;
   std::cout << "\t--output-project=, -o=<project_name>" << std::endl;
   std::cout << "\t--tiff-force-rgb\t\t\t-- all output tiffs will be rgb" << std::endl;
   std::cout << "\t--tiff-force-grayscale\t\t\t-- all output tiffs will be grayscale" << std::endl;
@@ -682,6 +714,39 @@ int CommandLine::fetchEndFilterIdx() {
   return m_options["end-filter"].toInt() - 1;
 }
 
+int CommandLine::fetchThreads() {
+  if (!hasThreads()) {
+    return 0;
+  }
+
+  return m_options["threads"].toInt();
+}
+
+int CommandLine::fetchStartPage() {
+  if (!hasStartPage()) {
+    return 1;
+  }
+
+  return m_options["start-page"].toInt();
+}
+
+QString CommandLine::fetchWorkDir() {
+  if (!hasWorkDir()) {
+    return QString();
+  }
+
+  return m_options["work-dir"];
+}
+
+int CommandLine::fetchEndPage() {
+  // Zero means "through the last page".
+  if (!hasEndPage()) {
+    return 0;
+  }
+
+  return m_options["end-page"].toInt();
+}
+
 output::DewarpingMode CommandLine::fetchDewarpingMode() {
   if (!hasDewarping()) {
     return output::OFF;
@@ -740,6 +805,14 @@ QString CommandLine::fetchLanguage() const {
   return "untranslated";
 }
 
+QString CommandLine::fetchDaemonSocket() const {
+  if (hasDaemon() && !m_options["daemon"].isEmpty()) {
+    return m_options["daemon"];
+  }
+
+  return "scantailor-cli";
+}
+
 QString CommandLine::fetchWindowTitle() const {
   if (hasWindowTitle()) {
     return m_options["window-title"];
@@ -109,6 +109,20 @@ class CommandLine {
 
   bool hasEndFilterIdx() const { return contains("end-filter") && !m_options["end-filter"].isEmpty(); }
 
+  bool hasThreads() const { return contains("threads") && !m_options["threads"].isEmpty(); }
+
+  bool hasStartPage() const { return contains("start-page") && !m_options["start-page"].isEmpty(); }
+
+  bool hasEndPage() const { return contains("end-page") && !m_options["end-page"].isEmpty(); }
+
+  bool hasResume() const { return contains("resume"); }
+
+  bool isJsonProgress() const { return contains("json-progress"); }
+
+  bool hasWorkDir() const { return contains("work-dir") && !m_options["work-dir"].isEmpty(); }
+
+  bool hasDaemon() const { return contains("daemon"); }
+
   bool hasOrientation() const { return contains("orientation") && !m_options["orientation"].isEmpty(); }
 
   bool hasDeskewAngle() const { return contains("rotate") && !m_options["rotate"].isEmpty(); }
@@ -213,6 +227,14 @@ class CommandLine {
 
   int getEndFilterIdx() const { return m_endFilterIdx; }
 
+  int getThreads() const { return m_threads; }
+
+  int getStartPage() const { return m_startPage; }
+
+  int getEndPage() const { return m_endPage; }
+
+  QString getWorkDir() const { return m_workDir; }
+
   output::DewarpingOptions getDewarpingMode() const { return m_dewarpingOptions; }
 
   double getDespeckleLevel() const { return m_despeckleLevel; }
@@ -223,6 +245,8 @@ class CommandLine {
 
   QString getLanguage() const { return m_language; }
 
+  QString getDaemonSocket() const { return m_daemonSocket; }
+
   QString getWindowTitle() const { return m_windowTitle; }
 
   QSizeF getPageDetectionBox() const { return m_pageDetectionBox; }
@@ -243,6 +267,7 @@ class CommandLine {
   bool m_gui;
   bool m_global;
   QString m_language;
+  QString m_daemonSocket;
   QString m_windowTitle;
   QSizeF m_pageDetectionBox;
   double m_pageDetectionTolerance{0.1};
@@ -283,6 +308,10 @@ class CommandLine {
   double m_skewDeviation{5.0};
   int m_startFilterIdx{0};
   int m_endFilterIdx{5};
+  int m_threads{0};
+  int m_startPage{1};
+  int m_endPage{0};
+  QString m_workDir;
   output::DewarpingOptions m_dewarpingOptions;
   double m_despeckleLevel{2.0};
   output::DepthPerception m_depthPerception;
@@ -334,6 +363,14 @@ class CommandLine {
 
   int fetchEndFilterIdx();
 
+  int fetchThreads();
+
+  int fetchStartPage();
+
+  int fetchEndPage();
+
+  QString fetchWorkDir();
+
   output::DewarpingMode fetchDewarpingMode();
 
   double fetchDespeckleLevel();
@@ -344,6 +381,8 @@ class CommandLine {
 
   QString fetchLanguage() const;
 
+  QString fetchDaemonSocket() const;
+
   QString fetchWindowTitle() const;
 
   QSizeF fetchPageDetectionBox() const;
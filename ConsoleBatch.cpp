@@ -18,18 +18,36 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QSettings>
+#include <QSysInfo>
+#include <QTextStream>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
+#include "BinaryImage.h"
+#include "BookPriors.h"
 #include "FileNameDisambiguator.h"
+#include "ParallelFor.h"
 #include "LoadFileTask.h"
 #include "OutputFileNameGenerator.h"
 #include "PageSelectionAccessor.h"
 #include "PageSequence.h"
+#include "PageTimingRegistry.h"
 #include "ProcessingTaskQueue.h"
 #include "ProjectPages.h"
 #include "ProjectReader.h"
+#include "ProjectSidecar.h"
 #include "ProjectWriter.h"
 #include "StageSequence.h"
 #include "Utils.h"
@@ -40,6 +58,7 @@
 #include "filters/fix_orientation/Settings.h"
 #include "filters/fix_orientation/Task.h"
 #include "filters/output/CacheDrivenTask.h"
+#include "filters/output/OutputWriteQueue.h"
 #include "filters/output/Settings.h"
 #include "filters/output/Task.h"
 #include "filters/page_layout/CacheDrivenTask.h"
@@ -52,6 +71,142 @@
 
 #include "ConsoleBatch.h"
 
+namespace {
+/**
+ * \brief Emits one JSON line per processed page on stdout, with a
+ *        running ETA for the rest of the batch.
+ *
+ * Orchestration layers used to estimate completion by tailing output
+ * file names, which breaks whenever the processing order changes.
+ * This gives them a stable contract instead: every line is a complete
+ * JSON object, flushed immediately, and everything else ConsoleBatch
+ * prints starts with a non-brace character.
+ *
+ * The ETA comes from an online cost model in megapixels per wall
+ * second, so page size differences are accounted for.  The rate of
+ * the running filter is measured directly; filters this run hasn't
+ * reached yet are assumed to process at the blended rate of
+ * everything observed so far, which self-corrects as they start.
+ */
+class JsonProgressReporter {
+ public:
+  explicit JsonProgressReporter(bool enabled) : m_enabled(enabled) {}
+
+  void startFilter(const char* stage, int filters_remaining, const std::vector<PageInfo>& pages) {
+    if (!m_enabled) {
+      return;
+    }
+
+    const std::lock_guard<std::mutex> guard(m_mutex);
+
+    // Fold the finished filter into the model for future-filter estimates.
+    if (m_stage && (m_doneMegapixels > 0)) {
+      m_modelSeconds += secondsSince(m_filterStart);
+      m_modelMegapixels += m_doneMegapixels;
+    }
+
+    m_stage = stage;
+    m_filtersRemaining = filters_remaining;
+    m_totalPages = pages.size();
+    m_totalMegapixels = 0;
+    for (const PageInfo& page : pages) {
+      m_totalMegapixels += megapixelsOf(page);
+    }
+    m_donePages = 0;
+    m_doneMegapixels = 0;
+    m_filterStart = std::chrono::steady_clock::now();
+  }
+
+  void pageDone(const PageInfo& page, double seconds, size_t peak_bytes) {
+    if (!m_enabled) {
+      return;
+    }
+
+    const std::lock_guard<std::mutex> guard(m_mutex);
+
+    ++m_donePages;
+    m_doneMegapixels += megapixelsOf(page);
+
+    const double elapsed = secondsSince(m_filterStart);
+    // Wall-clock based, so worker parallelism is accounted for.
+    const double rate = (elapsed > 0) ? m_doneMegapixels / elapsed : 0;
+
+    double eta_sec = -1;
+    if (rate > 0) {
+      eta_sec = (m_totalMegapixels - m_doneMegapixels) / rate;
+      const double blended_rate
+          = ((m_modelSeconds + elapsed) > 0) ? (m_modelMegapixels + m_doneMegapixels) / (m_modelSeconds + elapsed) : 0;
+      if (blended_rate > 0) {
+        // Assume the remaining filters see the same pages.
+        eta_sec += m_filtersRemaining * m_totalMegapixels / blended_rate;
+      }
+    }
+
+    std::string line("{\"event\":\"page\"");
+    line += ",\"stage\":\"";
+    line += m_stage;
+    line += "\",\"file\":\"";
+    line += escape(page.imageId().filePath());
+    line += "\",\"duration_sec\":";
+    line += QString::number(seconds, 'f', 3).toStdString();
+    line += ",\"peak_mb\":";
+    line += QString::number(peak_bytes / (1024.0 * 1024.0), 'f', 1).toStdString();
+    line += ",\"done\":";
+    line += std::to_string(m_donePages);
+    line += ",\"total\":";
+    line += std::to_string(m_totalPages);
+    if (eta_sec >= 0) {
+      line += ",\"eta_sec\":";
+      line += QString::number(eta_sec, 'f', 1).toStdString();
+    }
+    line += "}\n";
+
+    std::cout << line << std::flush;
+  }
+
+ private:
+  static double megapixelsOf(const PageInfo& page) {
+    const QSize size(page.metadata().size());
+
+    return size.width() * double(size.height()) * 1e-6;
+  }
+
+  static double secondsSince(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  static std::string escape(const QString& str) {
+    std::string result;
+    for (const char c : str.toUtf8()) {
+      if ((c == '"') || (c == '\\')) {
+        result += '\\';
+        result += c;
+      } else if ((c >= 0) && (c < 0x20)) {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+        result += buf;
+      } else {
+        result += c;
+      }
+    }
+
+    return result;
+  }
+
+  const bool m_enabled;
+  std::mutex m_mutex;
+  const char* m_stage = nullptr;
+  int m_filtersRemaining = 0;
+  size_t m_totalPages = 0;
+  size_t m_donePages = 0;
+  double m_totalMegapixels = 0;
+  double m_doneMegapixels = 0;
+  double m_modelSeconds = 0;
+  double m_modelMegapixels = 0;
+  std::chrono::steady_clock::time_point m_filterStart;
+};
+}  // namespace
+
 ConsoleBatch::ConsoleBatch(const std::vector<ImageFileInfo>& images,
                            const QString& output_directory,
                            const Qt::LayoutDirection layout)
@@ -68,19 +223,23 @@ ConsoleBatch::ConsoleBatch(const std::vector<ImageFileInfo>& images,
 }
 
 ConsoleBatch::ConsoleBatch(const QString project_file) : batch(true), debug(true) {
-  QFile file(project_file);
-  if (!file.open(QIODevice::ReadOnly)) {
-    throw std::runtime_error("ConsoleBatch: Unable to open the project file.");
-  }
-
   QDomDocument doc;
-  if (!doc.setContent(&file)) {
-    throw std::runtime_error("ConsoleBatch: The project file is broken.");
-  }
-
-  file.close();
+  // A fresh binary sidecar saves us parsing the XML.
+  if (ProjectSidecar::read(project_file, doc)) {
+    m_reader = std::make_unique<ProjectReader>(doc);
+  } else {
+    QFile file(project_file);
+    if (!file.open(QIODevice::ReadOnly)) {
+      throw std::runtime_error("ConsoleBatch: Unable to open the project file.");
+    }
+    file.close();
 
-  m_reader = std::make_unique<ProjectReader>(doc);
+    // The streaming parse never builds a DOM of the whole file.
+    m_reader = std::make_unique<ProjectReader>(project_file);
+    if (!m_reader->success()) {
+      throw std::runtime_error("ConsoleBatch: The project file is broken.");
+    }
+  }
   m_pages = m_reader->pages();
 
   const PageSelectionAccessor accessor(nullptr);  // Won't be used anyway.
@@ -154,6 +313,23 @@ void ConsoleBatch::process() {
     startFilterIdx = sf;
   }
 
+  // Pages completed by a previous interrupted run, keyed by
+  // "<filter_idx>\t<output file name>" records.
+  std::set<QString> completed_records;
+  if (cli.hasResume()) {
+    loadCheckpoint(completed_records);
+  }
+
+  if (cli.hasWorkDir() && !QDir().mkpath(cli.getWorkDir() + "/claims")) {
+    throw std::runtime_error("ConsoleBatch: Unable to create the claims directory in the work dir.");
+  }
+
+  QFile checkpoint_file(checkpointFilePath());
+  if (!checkpoint_file.open(QIODevice::Append | QIODevice::Text)) {
+    std::cout << "Warning: unable to write " << checkpointFilePath().toLatin1().constData() << "\n";
+  }
+  std::mutex checkpoint_mutex;
+
   int endFilterIdx = m_stages->outputFilterIdx();
   if (cli.hasEndFilterIdx()) {
     unsigned int ef = cli.getEndFilterIdx();
@@ -163,6 +339,12 @@ void ConsoleBatch::process() {
     endFilterIdx = ef;
   }
 
+  // Warm up the learned book priors from a previous run of this
+  // output directory, and persist whatever this run adds at the end.
+  BookPriors::instance().load(m_outFileNameGen.outDir());
+
+  JsonProgressReporter json_progress(cli.isJsonProgress());
+
   for (int j = startFilterIdx; j <= endFilterIdx; j++) {
     if (cli.isVerbose()) {
       std::cout << "Filter: " << (j + 1) << "\n";
@@ -170,16 +352,111 @@ void ConsoleBatch::process() {
 
     PageSequence page_sequence = m_pages->toPageSequence(PAGE_VIEW);
     setupFilter(j, page_sequence.selectAll());
-    for (unsigned i = 0; i < page_sequence.numPages(); i++) {
-      PageInfo page = page_sequence.pageAt(i);
-      if (cli.isVerbose()) {
-        std::cout << "\tProcessing: " << page.imageId().filePath().toLatin1().constData() << "\n";
+
+    // The tasks are created up front on this thread, then executed by a
+    // small crew of workers pulling pages off a shared queue.  While one
+    // worker sits in image decode or TIFF encode, the others keep the
+    // CPUs busy, and at most num_workers pages are in flight at a time.
+    // With --start-page / --end-page only this shard's pages are
+    // processed; the settings setup above still covers the whole
+    // project, so disjoint shards agree on per-project defaults.
+    unsigned first_page, end_page;
+    shardPageRange(page_sequence.numPages(), first_page, end_page);
+
+    std::vector<PageInfo> shard_pages;
+    std::vector<QString> page_records;
+    std::vector<BackgroundTaskPtr> tasks;
+    for (unsigned i = first_page; i < end_page; i++) {
+      const PageInfo& page = page_sequence.pageAt(i);
+      const QString record = QString::number(j) + QChar('\t') + m_outFileNameGen.fileNameFor(page.id());
+      if (cli.hasResume() && (completed_records.find(record) != completed_records.end())
+          && ((j != m_stages->outputFilterIdx()) || QFile::exists(m_outFileNameGen.filePathFor(page.id())))) {
+        // Completed by the interrupted run; for the output stage also
+        // make sure the written file is still there.
+        continue;
+      }
+      if (cli.hasWorkDir() && !claimPage(page.id())) {
+        // Another worker owns this page for the whole filter chain.
+        continue;
+      }
+      shard_pages.push_back(page);
+      page_records.push_back(record);
+      tasks.push_back(createCompositeTask(page, j));
+    }
+
+    int num_workers = cli.hasThreads()
+                          ? cli.getThreads()
+                          : QSettings().value("settings/batch_processing_threads", parallelForNumThreads()).toInt();
+    num_workers = std::min(num_workers, parallelForNumThreads());
+    num_workers = std::max(1, std::min<int>(num_workers, tasks.size()));
+
+    json_progress.startFilter(stageNameFor(j), endFilterIdx - j, shard_pages);
+
+    std::atomic<size_t> next_task(0);
+    std::mutex log_mutex;
+    std::mutex eptr_mutex;
+    std::exception_ptr eptr;
+
+    const auto worker = [&]() {
+      // Count this worker against the machine-wide thread budget; the
+      // parallel kernels inside the tasks draw their helper threads
+      // from whatever the workers leave of it, so the total stays at
+      // the budget even as workers run dry towards the end of a
+      // filter.
+      const ParallelForActiveThread active_thread;
+
+      size_t task_idx;
+      while ((task_idx = next_task.fetch_add(1)) < tasks.size()) {
+        if (cli.isVerbose()) {
+          const std::lock_guard<std::mutex> guard(log_mutex);
+          std::cout << "\tProcessing: " << shard_pages[task_idx].imageId().filePath().toLatin1().constData() << "\n";
+        }
+        try {
+          const auto page_start = std::chrono::steady_clock::now();
+          (*tasks[task_idx])();
+          if (checkpoint_file.isOpen()) {
+            const std::lock_guard<std::mutex> guard(checkpoint_mutex);
+            checkpoint_file.write((page_records[task_idx] + QChar('\n')).toUtf8());
+            checkpoint_file.flush();
+          }
+          json_progress.pageDone(
+              shard_pages[task_idx],
+              std::chrono::duration<double>(std::chrono::steady_clock::now() - page_start).count(),
+              PageTimingRegistry::instance().breakdownFor(shard_pages[task_idx].id()).peakBytes());
+        } catch (...) {
+          const std::lock_guard<std::mutex> guard(eptr_mutex);
+          if (!eptr) {
+            eptr = std::current_exception();
+          }
+        }
       }
-      BackgroundTaskPtr bgTask = createCompositeTask(page, j);
-      (*bgTask)();
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_workers - 1);
+    for (int t = 1; t < num_workers; ++t) {
+      threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+
+    if (eptr) {
+      std::rethrow_exception(eptr);
+    }
+
+    if (cli.isVerbose()) {
+      // A non-zero count means somewhere a shared image got written to.
+      std::cout << "\tBinaryImage deep copies so far: " << imageproc::BinaryImage::deepCopyCount() << "\n";
     }
   }
 
+  // The barrier at the end of the batch: output files are written by a
+  // dedicated I/O thread, and the shard manifest and the project file
+  // must not describe files that haven't landed yet.
+  output::OutputWriteQueue::instance().waitForPendingWrites();
+
   for (int j = endFilterIdx + 1; j <= m_stages->count(); j++) {
     PageSequence page_sequence = m_pages->toPageSequence(PAGE_VIEW);
     setupFilter(j, page_sequence.selectAll());
@@ -188,8 +465,211 @@ void ConsoleBatch::process() {
   for (int j = 0; j <= endFilterIdx; j++) {
     m_stages->filterAt(j)->updateStatistics();
   }
+
+  // Slow outliers, usually huge fold-out plates, are worth knowing
+  // about before planning the next overnight batch.  "load" covers
+  // image decoding; the other entries are the filter stages.
+  const std::vector<PageTimingRegistry::PageBreakdown> slowest = PageTimingRegistry::instance().slowestPages(5);
+  if (!slowest.empty()) {
+    static const char* const stage_order[]
+        = {"load", "fix_orientation", "page_split", "deskew", "select_content", "page_layout", "output"};
+
+    std::cout << "Slowest pages:\n";
+    for (const PageTimingRegistry::PageBreakdown& breakdown : slowest) {
+      std::cout << "\t" << QString::number(breakdown.totalSec(), 'f', 1).toLatin1().constData() << "s\t"
+                << breakdown.pageId.imageId().filePath().toLatin1().constData() << "  (";
+      bool first = true;
+      for (const char* stage : stage_order) {
+        const auto it = breakdown.stageSec.find(stage);
+        if (it != breakdown.stageSec.end()) {
+          std::cout << (first ? "" : ", ") << stage << ": "
+                    << QString::number(it->second, 'f', 1).toLatin1().constData() << "s";
+          first = false;
+        }
+      }
+      std::cout << ", peak " << QString::number(breakdown.peakBytes() / (1024.0 * 1024.0), 'f', 0).toLatin1().constData()
+                << " MB)\n";
+    }
+
+    // The worst page of each stage.  With a corpus of similar pages this
+    // is what sizing a batch machine needs: peak bytes scale with DPI
+    // and page size, so one representative run predicts the fleet.
+    const std::map<std::string, size_t> stage_peaks = PageTimingRegistry::instance().maxStagePeaks();
+    std::cout << "Peak image memory per stage:\n";
+    for (const char* stage : stage_order) {
+      const auto it = stage_peaks.find(stage);
+      if (it != stage_peaks.end()) {
+        std::cout << "\t" << stage << ": "
+                  << QString::number(it->second / (1024.0 * 1024.0), 'f', 0).toLatin1().constData() << " MB\n";
+      }
+    }
+  }
+
+  if (cli.isVerbose()) {
+    // Batch work goes through the same thumbnail cache as interactive
+    // work, so these numbers are what sizing its memory limit needs.
+    const ThumbnailPixmapCache::Stats cache_stats = m_thumbnailCache->stats();
+    std::cout << "Thumbnail cache: " << cache_stats.memHits << " hits, " << cache_stats.misses << " misses, "
+              << cache_stats.diskLoads << " disk loads, " << cache_stats.evictions << " evictions, "
+              << QString::number(cache_stats.residentBytes / (1024.0 * 1024.0), 'f', 1).toLatin1().constData()
+              << " MB resident\n";
+    std::cout << "Thumbnail load times (ms):";
+    for (int i = 0; i < ThumbnailPixmapCache::Stats::NUM_DECODE_BUCKETS; ++i) {
+      std::cout << " <" << (1 << i) << ": " << cache_stats.decodeMsHistogram[i];
+    }
+    std::cout << "\n";
+  }
+
+  if (cli.hasStartPage() || cli.hasEndPage()) {
+    writeShardManifest();
+  }
+  if (cli.hasWorkDir()) {
+    writeWorkerManifest();
+  }
+
+  BookPriors::instance().save(m_outFileNameGen.outDir());
 }  // ConsoleBatch::process
 
+const char* ConsoleBatch::stageNameFor(const int filter_idx) const {
+  if (filter_idx == m_stages->fixOrientationFilterIdx()) {
+    return "fix_orientation";
+  } else if (filter_idx == m_stages->pageSplitFilterIdx()) {
+    return "page_split";
+  } else if (filter_idx == m_stages->deskewFilterIdx()) {
+    return "deskew";
+  } else if (filter_idx == m_stages->selectContentFilterIdx()) {
+    return "select_content";
+  } else if (filter_idx == m_stages->pageLayoutFilterIdx()) {
+    return "page_layout";
+  } else if (filter_idx == m_stages->outputFilterIdx()) {
+    return "output";
+  }
+
+  return "unknown";
+}
+
+/**
+ * Dynamic work distribution over shared storage.  Every worker runs
+ * against the same project file and output directory, and claims each
+ * page by creating a directory named after the page's output file
+ * under <work-dir>/claims/.  mkdir() is atomic on every filesystem we
+ * care about, including the network shares such a setup runs on, so
+ * exactly one worker wins each page and faster machines simply claim
+ * more of them.  A claim covers the page through the whole filter
+ * chain: the per-page work is independent across pages, just as with
+ * --start-page / --end-page sharding, except that the partitioning
+ * happens one page at a time instead of up front.
+ *
+ * Claims persist across runs: to reprocess a project from scratch,
+ * remove the claims/ subdirectory.
+ */
+bool ConsoleBatch::claimPage(const PageId& page_id) {
+  const QString record(m_outFileNameGen.fileNameFor(page_id));
+
+  const auto it = m_pageClaims.find(record);
+  if (it != m_pageClaims.end()) {
+    return it->second;
+  }
+
+  // Succeeds for exactly one worker; the others see the directory
+  // already existing.
+  const bool ours = QDir().mkdir(CommandLine::get().getWorkDir() + "/claims/" + record);
+  m_pageClaims.insert(std::map<QString, bool>::value_type(record, ours));
+
+  return ours;
+}
+
+/**
+ * Reports this worker's results for the merge step: which pages it
+ * claimed and where their output files are.  The counterpart of the
+ * shard manifest for --work-dir runs.
+ */
+void ConsoleBatch::writeWorkerManifest() const {
+  const QString manifest_path = QString("%1/worker-%2-%3.manifest")
+                                    .arg(CommandLine::get().getWorkDir())
+                                    .arg(QSysInfo::machineHostName())
+                                    .arg(QCoreApplication::applicationPid());
+  QFile file(manifest_path);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    std::cout << "Warning: unable to write " << manifest_path.toLatin1().constData() << "\n";
+
+    return;
+  }
+
+  const PageSequence page_sequence = m_pages->toPageSequence(PAGE_VIEW);
+
+  QTextStream strm(&file);
+  for (const PageInfo& page : page_sequence) {
+    const auto it = m_pageClaims.find(m_outFileNameGen.fileNameFor(page.id()));
+    if ((it != m_pageClaims.end()) && it->second) {
+      strm << page.imageId().filePath() << '\t' << m_outFileNameGen.filePathFor(page.id()) << '\n';
+    }
+  }
+}  // ConsoleBatch::writeWorkerManifest
+
+void ConsoleBatch::shardPageRange(const unsigned num_pages, unsigned& first_page, unsigned& end_page) {
+  const CommandLine& cli = CommandLine::get();
+
+  first_page = (cli.getStartPage() > 0) ? (unsigned) (cli.getStartPage() - 1) : 0;
+  first_page = std::min(first_page, num_pages);
+  end_page = (cli.getEndPage() > 0) ? std::min((unsigned) cli.getEndPage(), num_pages) : num_pages;
+  end_page = std::max(end_page, first_page);
+}
+
+QString ConsoleBatch::checkpointFilePath() const {
+  const CommandLine& cli = CommandLine::get();
+
+  if (cli.hasStartPage() || cli.hasEndPage()) {
+    return QString("%1/batch-%2-%3.checkpoint")
+        .arg(m_outFileNameGen.outDir())
+        .arg(cli.getStartPage())
+        .arg(cli.getEndPage());
+  }
+
+  return m_outFileNameGen.outDir() + "/batch.checkpoint";
+}
+
+void ConsoleBatch::loadCheckpoint(std::set<QString>& completed_records) const {
+  QFile file(checkpointFilePath());
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return;
+  }
+
+  QTextStream strm(&file);
+  while (!strm.atEnd()) {
+    const QString line = strm.readLine();
+    if (!line.isEmpty()) {
+      completed_records.insert(line);
+    }
+  }
+}
+
+/**
+ * Records which output files this shard produced, so that several
+ * invocations processing disjoint page ranges of one project can be
+ * reconciled afterwards.
+ */
+void ConsoleBatch::writeShardManifest() const {
+  PageSequence page_sequence = m_pages->toPageSequence(PAGE_VIEW);
+  unsigned first_page, end_page;
+  shardPageRange(page_sequence.numPages(), first_page, end_page);
+
+  const QString manifest_path
+      = QString("%1/shard-%2-%3.manifest").arg(m_outFileNameGen.outDir()).arg(first_page + 1).arg(end_page);
+  QFile file(manifest_path);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    std::cout << "Warning: unable to write " << manifest_path.toLatin1().constData() << "\n";
+
+    return;
+  }
+
+  QTextStream strm(&file);
+  for (unsigned i = first_page; i < end_page; i++) {
+    const PageInfo& page = page_sequence.pageAt(i);
+    strm << (i + 1) << '\t' << page.imageId().filePath() << '\t' << m_outFileNameGen.filePathFor(page.id()) << '\n';
+  }
+}  // ConsoleBatch::writeShardManifest
+
 void ConsoleBatch::saveProject(const QString project_file) {
   PageInfo fpage = m_pages->toPageSequence(PAGE_VIEW).pageAt(0);
   SelectedPage sPage(fpage.id(), IMAGE_VIEW);
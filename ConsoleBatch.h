@@ -22,6 +22,7 @@
 #define CONSOLEBATCH_H_
 
 #include <QString>
+#include <map>
 #include <vector>
 
 #include "BackgroundTask.h"
@@ -76,7 +77,30 @@ class ConsoleBatch {
 
   void setupOutput(std::set<PageId> allPages);
 
+  static void shardPageRange(unsigned num_pages, unsigned& first_page, unsigned& end_page);
+
+  QString checkpointFilePath() const;
+
+  /** The fixed stage key of a filter index, for machine-readable output. */
+  const char* stageNameFor(int filter_idx) const;
+
+  void loadCheckpoint(std::set<QString>& completed_records) const;
+
+  void writeShardManifest() const;
+
+  /**
+   * Atomically claims \p page_id through the shared --work-dir, or
+   * reports the cached outcome of an earlier attempt.  \return true
+   * if this worker owns the page.
+   */
+  bool claimPage(const PageId& page_id);
+
+  void writeWorkerManifest() const;
+
   BackgroundTaskPtr createCompositeTask(const PageInfo& page, const int last_filter_idx);
+
+  /** Claim outcomes keyed by output file name, ours or not. */
+  std::map<QString, bool> m_pageClaims;
 };
 
 
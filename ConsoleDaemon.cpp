@@ -0,0 +1,148 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+
+    ConsoleDaemon - Accepting batch processing jobs over a local socket.
+    Copyright (C) 2011 Petr Kovar <pejuko@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ConsoleDaemon.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <iostream>
+#include <memory>
+
+#include "CommandLine.h"
+#include "ConsoleBatch.h"
+
+static const int READ_TIMEOUT_MSEC = 30 * 1000;
+
+ConsoleDaemon::ConsoleDaemon(const QString& socket_name) : m_socketName(socket_name) {}
+
+int ConsoleDaemon::run() {
+  // A previous daemon that died without cleanup leaves the socket behind.
+  QLocalServer::removeServer(m_socketName);
+
+  QLocalServer server;
+  if (!server.listen(m_socketName)) {
+    std::cerr << "daemon: can't listen on " << m_socketName.toLocal8Bit().constData() << ": "
+              << server.errorString().toLocal8Bit().constData() << std::endl;
+
+    return 1;
+  }
+
+  std::cout << "daemon: listening on " << server.fullServerName().toLocal8Bit().constData() << std::endl;
+
+  for (;;) {
+    if (!server.waitForNewConnection(-1)) {
+      continue;
+    }
+
+    QLocalSocket* socket = server.nextPendingConnection();
+    if (!socket) {
+      continue;
+    }
+
+    QStringList args;
+    if (!readJob(*socket, args)) {
+      socket->write("ERR: incomplete job\n");
+    } else if ((args.size() == 1) && (args.front() == "shutdown")) {
+      socket->write("OK\n");
+      socket->waitForBytesWritten(READ_TIMEOUT_MSEC);
+      delete socket;
+      break;
+    } else {
+      // Jobs are processed one at a time, right here on the accepting
+      // thread.  Each job parallelizes internally across the cores, so
+      // serving them concurrently would only add contention.
+      QString error;
+      if (processJob(args, error)) {
+        socket->write("OK\n");
+      } else {
+        socket->write("ERR: ");
+        socket->write(error.toUtf8());
+        socket->write("\n");
+      }
+    }
+
+    socket->waitForBytesWritten(READ_TIMEOUT_MSEC);
+    delete socket;
+  }
+
+  return 0;
+}  // ConsoleDaemon::run
+
+bool ConsoleDaemon::readJob(QLocalSocket& socket, QStringList& args) const {
+  for (;;) {
+    if (!socket.canReadLine()) {
+      if (socket.state() != QLocalSocket::ConnectedState) {
+        return false;
+      }
+      if (!socket.waitForReadyRead(READ_TIMEOUT_MSEC)) {
+        continue;  // state check above breaks the loop on disconnect
+      }
+    }
+
+    while (socket.canReadLine()) {
+      QByteArray line(socket.readLine());
+      while (line.endsWith('\n') || line.endsWith('\r')) {
+        line.chop(1);
+      }
+      if (line.isEmpty()) {
+        // The empty line terminates the job.
+        return !args.isEmpty();
+      }
+      args << QString::fromUtf8(line);
+    }
+  }
+}
+
+bool ConsoleDaemon::processJob(const QStringList& args, QString& error) const {
+  // CommandLine expects argv including the program name.
+  QStringList argv;
+  argv << "scantailor-cli";
+  argv += args;
+
+  CommandLine cli(argv, false);
+  if (cli.isError() || cli.hasHelp() || cli.outputDirectory().isEmpty()
+      || (cli.images().empty() && cli.projectFile().isEmpty())) {
+    error = "bad job arguments";
+
+    return false;
+  }
+  // ConsoleBatch and the filters read the global instance.
+  CommandLine::set(cli);
+
+  try {
+    std::unique_ptr<ConsoleBatch> cbatch;
+    if (!cli.projectFile().isEmpty()) {
+      cbatch = std::make_unique<ConsoleBatch>(cli.projectFile());
+    } else {
+      cbatch = std::make_unique<ConsoleBatch>(cli.images(), cli.outputDirectory(), cli.getLayoutDirection());
+    }
+    cbatch->process();
+
+    if (cli.hasOutputProject()) {
+      cbatch->saveProject(cli.outputProjectFile());
+    }
+  } catch (const std::exception& e) {
+    error = QString::fromLocal8Bit(e.what());
+
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,63 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+
+    ConsoleDaemon - Accepting batch processing jobs over a local socket.
+    Copyright (C) 2011 Petr Kovar <pejuko@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONSOLEDAEMON_H_
+#define CONSOLEDAEMON_H_
+
+#include <QString>
+#include <QStringList>
+
+#include "NonCopyable.h"
+
+class QLocalSocket;
+
+/**
+ * \brief A long-lived headless server processing batch jobs one by one.
+ *
+ * Started with --daemon[=socket_name], it listens on a local socket and
+ * keeps the process (Qt initialization, thread pools, caches) alive
+ * between jobs, so scripts driving many small projects don't pay the
+ * startup cost per invocation.
+ *
+ * Protocol: one connection carries one job.  The client sends the same
+ * arguments it would have passed to scantailor-cli, one argument per
+ * line, UTF-8 encoded, terminated by an empty line.  The server replies
+ * with a single "OK" or "ERR: <message>" line and closes the connection.
+ * A job consisting of the single line "shutdown" stops the daemon.
+ */
+class ConsoleDaemon {
+  DECLARE_NON_COPYABLE(ConsoleDaemon)
+
+ public:
+  explicit ConsoleDaemon(const QString& socket_name);
+
+  /** Serves jobs until a shutdown request. Returns the process exit code. */
+  int run();
+
+ private:
+  bool readJob(QLocalSocket& socket, QStringList& args) const;
+
+  bool processJob(const QStringList& args, QString& error) const;
+
+  QString m_socketName;
+};
+
+
+#endif  // ifndef CONSOLEDAEMON_H_
@@ -19,12 +19,16 @@
 #include "ContentBoxPropagator.h"
 
 #include <utility>
+#include <vector>
 #include "CompositeCacheDrivenTask.h"
+#include "DirtyPages.h"
 #include "ImageTransformation.h"
 #include "PageSequence.h"
+#include "ParallelFor.h"
 #include "ProjectPages.h"
 #include "filter_dc/ContentBoxCollector.h"
 #include "filters/page_layout/Filter.h"
+#include "filters/select_content/Filter.h"
 
 class ContentBoxPropagator::Collector : public ContentBoxCollector {
  public:
@@ -45,20 +49,49 @@ class ContentBoxPropagator::Collector : public ContentBoxCollector {
 };
 
 
-ContentBoxPropagator::ContentBoxPropagator(intrusive_ptr<page_layout::Filter> page_layout_filter,
+ContentBoxPropagator::ContentBoxPropagator(intrusive_ptr<select_content::Filter> select_content_filter,
+                                           intrusive_ptr<page_layout::Filter> page_layout_filter,
                                            intrusive_ptr<CompositeCacheDrivenTask> task)
-    : m_pageLayoutFilter(std::move(page_layout_filter)), m_task(std::move(task)) {}
+    : m_selectContentFilter(std::move(select_content_filter)),
+      m_pageLayoutFilter(std::move(page_layout_filter)),
+      m_task(std::move(task)) {}
 
 ContentBoxPropagator::~ContentBoxPropagator() = default;
 
 void ContentBoxPropagator::propagate(const ProjectPages& pages) {
+  const DirtyPages dirty(m_selectContentFilter->fetchDirtyPages());
+  if (!dirty.allDirty() && dirty.pages().empty()) {
+    // Nothing changed in "Select Content" since the last propagation.
+    return;
+  }
+
   const PageSequence sequence(pages.toPageSequence(PAGE_VIEW));
+  const auto num_pages = static_cast<int>(sequence.numPages());
+
+  // Restrict the sweep to the pages whose content boxes changed.
+  // After a single-page adjustment that's one page, not the project.
+  std::vector<int> page_indexes;
+  for (int i = 0; i < num_pages; ++i) {
+    if (dirty.allDirty() || (dirty.pages().find(sequence.pageAt(i).id()) != dirty.pages().end())) {
+      page_indexes.push_back(i);
+    }
+  }
+
+  // Walking the cache-driven task chain is independent for each page,
+  // so the pages are dispatched across worker threads and the results
+  // are committed to the "Margins" stage in a single pass afterwards.
+  const auto num_affected = static_cast<int>(page_indexes.size());
+  std::vector<Collector> collectors(num_affected);
+  parallelForChunked(0, num_affected, [&](const int chunk_begin, const int chunk_end) {
+    for (int i = chunk_begin; i < chunk_end; ++i) {
+      m_task->process(sequence.pageAt(page_indexes[i]), &collectors[i]);
+    }
+  });
 
-  for (const PageInfo& page_info : sequence) {
-    Collector collector;
-    m_task->process(page_info, &collector);
-    if (collector.collected()) {
-      m_pageLayoutFilter->setContentBox(page_info.id(), collector.xform(), collector.contentRect());
+  for (int i = 0; i < num_affected; ++i) {
+    const PageInfo& page_info = sequence.pageAt(page_indexes[i]);
+    if (collectors[i].collected()) {
+      m_pageLayoutFilter->setContentBox(page_info.id(), collectors[i].xform(), collectors[i].contentRect());
     } else {
       m_pageLayoutFilter->invalidateContentBox(page_info.id());
     }
@@ -25,6 +25,10 @@
 class CompositeCacheDrivenTask;
 class ProjectPages;
 
+namespace select_content {
+class Filter;
+}
+
 namespace page_layout {
 class Filter;
 }
@@ -37,10 +41,16 @@ class Filter;
  * adjustments there to several pages.  Now you return to "Margins" and
  * expect to see the results of all your adjustments (not just the current page)
  * there.
+ *
+ * The propagation is delta-driven: the "Select Content" settings track
+ * which pages' content boxes actually changed, and only those pages are
+ * re-propagated.  Adjusting a single page no longer costs a sweep over
+ * the whole project.
  */
 class ContentBoxPropagator {
  public:
-  ContentBoxPropagator(intrusive_ptr<page_layout::Filter> page_layout_filter,
+  ContentBoxPropagator(intrusive_ptr<select_content::Filter> select_content_filter,
+                       intrusive_ptr<page_layout::Filter> page_layout_filter,
                        intrusive_ptr<CompositeCacheDrivenTask> task);
 
   ~ContentBoxPropagator();
@@ -50,6 +60,7 @@ class ContentBoxPropagator {
  private:
   class Collector;
 
+  intrusive_ptr<select_content::Filter> m_selectContentFilter;
   intrusive_ptr<page_layout::Filter> m_pageLayoutFilter;
   intrusive_ptr<CompositeCacheDrivenTask> m_task;
 };
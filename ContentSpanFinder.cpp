@@ -21,8 +21,7 @@
 
 using namespace imageproc;
 
-void ContentSpanFinder::findImpl(const SlicedHistogram& histogram,
-                                 const VirtualFunction<void, const Span&>& handler) const {
+void ContentSpanFinder::findImpl(const SlicedHistogram& histogram, function_ref<void(const Span&)> handler) const {
   const auto hist_size = static_cast<const int>(histogram.size());
 
   int i = 0;
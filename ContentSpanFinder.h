@@ -20,7 +20,7 @@
 #define CONTENTSPANFINDER_H_
 
 #include "Span.h"
-#include "VirtualFunction.h"
+#include "function_ref.h"
 
 namespace imageproc {
 class SlicedHistogram;
@@ -46,7 +46,7 @@ class ContentSpanFinder {
   void find(const imageproc::SlicedHistogram& histogram, T handler) const;
 
  private:
-  void findImpl(const imageproc::SlicedHistogram& histogram, const VirtualFunction<void, const Span&>& handler) const;
+  void findImpl(const imageproc::SlicedHistogram& histogram, function_ref<void(const Span&)> handler) const;
 
   int m_minContentWidth;
   int m_minWhitespaceWidth;
@@ -55,7 +55,7 @@ class ContentSpanFinder {
 
 template <typename Callable>
 void ContentSpanFinder::find(const imageproc::SlicedHistogram& histogram, Callable handler) const {
-  findImpl(histogram, ProxyFunction<Callable, void, const Span&>(handler));
+  findImpl(histogram, handler);
 }
 
 #endif  // ifndef CONTENTSPANFINDER_H_
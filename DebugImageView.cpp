@@ -71,7 +71,9 @@ DebugImageView::DebugImageView(AutoRemovingFile file,
 
 void DebugImageView::setLive(const bool live) {
   if (live && !m_isLive) {
-    ImageViewBase::backgroundExecutor().enqueueTask(make_intrusive<ImageLoader>(this, m_file.get()));
+    // Debug images are a nicety; let interactive view rebuilds go first.
+    ImageViewBase::backgroundExecutor().enqueueTask(make_intrusive<ImageLoader>(this, m_file.get()),
+                                                    BackgroundExecutor::SPECULATIVE);
   } else if (!live && m_isLive) {
     if (QWidget* wgt = currentWidget()) {
       if (wgt != m_placeholderWidget) {
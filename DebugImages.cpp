@@ -18,14 +18,151 @@
 
 #include "DebugImages.h"
 #include <QDir>
-#include <QImage>
 #include <QImageWriter>
 #include <QTemporaryFile>
-#include "imageproc/BinaryImage.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "NonCopyable.h"
+
+/**
+ * \brief Downscales and PNG-encodes captured debug images off-thread.
+ *
+ * The pattern is the same as output::OutputWriteQueue, which this class
+ * can't use directly without inverting the core/filters dependency: a
+ * lazily started worker drains a FIFO, and the destructor of the
+ * singleton drains and joins it on shutdown.  The queue is bounded by
+ * the raw image bytes the pending items pin in memory; unlike the write
+ * queue, which must not lose output files and therefore blocks, this
+ * one just drops new captures while it's over the cap, since a missing
+ * debug image beats distorting the timings being investigated.
+ */
+class DebugImageEncoder {
+  DECLARE_NON_COPYABLE(DebugImageEncoder)
+
+ public:
+  static DebugImageEncoder& instance();
+
+  /**
+   * \brief Schedules an item for encoding.
+   *
+   * \return false if the item was dropped because the pending captures
+   *         already pin too much memory.
+   */
+  bool enqueue(const intrusive_ptr<DebugImages::Item>& item, size_t raw_bytes);
+
+  /** Blocks until the encoder is done with \p item. */
+  void waitFor(const intrusive_ptr<DebugImages::Item>& item);
+
+ private:
+  struct Job {
+    intrusive_ptr<DebugImages::Item> item;
+    size_t bytes;
+  };
+
+  DebugImageEncoder();
+
+  ~DebugImageEncoder();
+
+  void backgroundThread();
+
+  static void encode(DebugImages::Item& item);
+
+  /** The pending raw captures never pin more than this much memory. */
+  static const size_t MAX_PENDING_BYTES = size_t(256) * 1024 * 1024;
+
+  /** Captured images are downscaled to fit this many pixels on a side. */
+  static const int MAX_DIMENSION = 2048;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::deque<Job> m_queue;
+  size_t m_pendingBytes = 0;
+  std::thread m_thread;
+  bool m_threadStarted = false;
+  bool m_shutdown = false;
+};
+
+
+DebugImageEncoder& DebugImageEncoder::instance() {
+  static DebugImageEncoder the_instance;
+
+  return the_instance;
+}
+
+DebugImageEncoder::DebugImageEncoder() = default;
+
+DebugImageEncoder::~DebugImageEncoder() {
+  {
+    const std::lock_guard<std::mutex> guard(m_mutex);
+    m_shutdown = true;
+  }
+  m_cond.notify_all();
+  if (m_threadStarted) {
+    // The background thread drains the queue before exiting.
+    m_thread.join();
+  }
+}
+
+bool DebugImageEncoder::enqueue(const intrusive_ptr<DebugImages::Item>& item, const size_t raw_bytes) {
+  {
+    const std::lock_guard<std::mutex> guard(m_mutex);
+    if (m_pendingBytes + raw_bytes > MAX_PENDING_BYTES) {
+      return false;
+    }
+
+    if (!m_threadStarted) {
+      m_thread = std::thread(&DebugImageEncoder::backgroundThread, this);
+      m_threadStarted = true;
+    }
+
+    m_queue.push_back(Job{item, raw_bytes});
+    m_pendingBytes += raw_bytes;
+  }
+  m_cond.notify_all();
+
+  return true;
+}
+
+void DebugImageEncoder::waitFor(const intrusive_ptr<DebugImages::Item>& item) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cond.wait(lock, [&item]() { return item->encoded; });
+}
+
+void DebugImageEncoder::backgroundThread() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    if (m_queue.empty()) {
+      if (m_shutdown) {
+        break;
+      }
+      m_cond.wait(lock);
+      continue;
+    }
+
+    const Job job(m_queue.front());
+    m_queue.pop_front();
+
+    lock.unlock();
+    encode(*job.item);
+    lock.lock();
+
+    // Dropping the raw reference is what actually releases the memory.
+    job.item->rawImage = QImage();
+    job.item->rawBinary = imageproc::BinaryImage();
+    job.item->encoded = true;
+    m_pendingBytes -= job.bytes;
+    m_cond.notify_all();
+  }
+}
+
+void DebugImageEncoder::encode(DebugImages::Item& item) {
+  QImage image(item.rawBinary.isNull() ? item.rawImage : item.rawBinary.toQImage());
+  if ((image.width() > MAX_DIMENSION) || (image.height() > MAX_DIMENSION)) {
+    image = image.scaled(MAX_DIMENSION, MAX_DIMENSION, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+  }
 
-void DebugImages::add(const QImage& image,
-                      const QString& label,
-                      const boost::function<QWidget*(const QImage&)>& image_view_factory) {
   QTemporaryFile file(QDir::tempPath() + "/scantailor-dbg-XXXXXX.png");
   if (!file.open()) {
     return;
@@ -40,13 +177,31 @@ void DebugImages::add(const QImage& image,
     return;
   }
 
-  m_sequence.push_back(make_intrusive<Item>(arem_file, label, image_view_factory));
+  item.file = arem_file;
+}
+
+/*============================= DebugImages ===========================*/
+
+void DebugImages::add(const QImage& image,
+                      const QString& label,
+                      const boost::function<QWidget*(const QImage&)>& image_view_factory) {
+  auto item = make_intrusive<Item>(label, image_view_factory);
+  item->rawImage = image;
+  addItem(item, size_t(image.bytesPerLine()) * image.height());
 }
 
 void DebugImages::add(const imageproc::BinaryImage& image,
                       const QString& label,
                       const boost::function<QWidget*(const QImage&)>& image_view_factory) {
-  add(image.toQImage(), label, image_view_factory);
+  auto item = make_intrusive<Item>(label, image_view_factory);
+  item->rawBinary = image;
+  addItem(item, size_t(image.wordsPerLine()) * 4 * image.height());
+}
+
+void DebugImages::addItem(const intrusive_ptr<Item>& item, const size_t raw_bytes) {
+  if (DebugImageEncoder::instance().enqueue(item, raw_bytes)) {
+    m_sequence.push_back(item);
+  }
 }
 
 AutoRemovingFile DebugImages::retrieveNext(QString* label,
@@ -55,6 +210,8 @@ AutoRemovingFile DebugImages::retrieveNext(QString* label,
     return AutoRemovingFile();
   }
 
+  DebugImageEncoder::instance().waitFor(m_sequence.front());
+
   AutoRemovingFile file(m_sequence.front()->file);
   if (label) {
     *label = m_sequence.front()->label;
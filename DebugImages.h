@@ -19,22 +19,26 @@
 #ifndef DEBUG_IMAGES_H_
 #define DEBUG_IMAGES_H_
 
+#include <QImage>
 #include <QString>
 #include <boost/function.hpp>
 #include <deque>
 #include "AutoRemovingFile.h"
+#include "imageproc/BinaryImage.h"
 #include "intrusive_ptr.h"
 #include "ref_countable.h"
 
-class QImage;
 class QWidget;
 
-namespace imageproc {
-class BinaryImage;
-}
-
 /**
  * \brief A sequence of image + label pairs.
+ *
+ * add() only takes a copy-on-write reference to the image; downscaling
+ * and PNG encoding happen later on a shared background thread.  That
+ * keeps debug captures cheap enough on the worker threads that enabling
+ * debug mode during a performance investigation doesn't invalidate the
+ * measurement.  Captures arriving while the encoder already holds too
+ * many raw images are dropped rather than allowed to pile up.
  */
 class DebugImages {
  public:
@@ -56,20 +60,35 @@ class DebugImages {
    * The label and viewer widget factory (that may not be bound)
    * are returned by taking pointers to them as arguments.
    * Returns a null AutoRemovingFile if image sequence is empty.
+   * Blocks until the background thread has encoded the item.
    */
   AutoRemovingFile retrieveNext(QString* label = nullptr,
                                 boost::function<QWidget*(const QImage&)>* image_view_factory = nullptr);
 
  private:
+  friend class DebugImageEncoder;
+
   struct Item : public ref_countable {
+    /**
+     * The captured image as a copy-on-write reference, held only until
+     * the encoder has turned it into a file.  Exactly one of the two
+     * is non-null.
+     */
+    QImage rawImage;
+    imageproc::BinaryImage rawBinary;
+
     AutoRemovingFile file;
     QString label;
     boost::function<QWidget*(const QImage&)> imageViewFactory;
 
-    Item(AutoRemovingFile f, const QString& l, const boost::function<QWidget*(const QImage&)>& imf)
-        : file(f), label(l), imageViewFactory(imf) {}
+    /** Set by the encoder thread, under its mutex. */
+    bool encoded = false;
+
+    Item(const QString& l, const boost::function<QWidget*(const QImage&)>& imf) : label(l), imageViewFactory(imf) {}
   };
 
+  void addItem(const intrusive_ptr<Item>& item, size_t raw_bytes);
+
   std::deque<intrusive_ptr<Item>> m_sequence;
 };
 
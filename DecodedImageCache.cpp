@@ -0,0 +1,100 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DecodedImageCache.h"
+#include "MemoryBudgetManager.h"
+
+using namespace imageproc;
+
+DecodedImageCache& DecodedImageCache::instance() {
+  static DecodedImageCache the_instance;
+
+  return the_instance;
+}
+
+DecodedImageCache::DecodedImageCache() {
+  // A decoded original is rebuilt with a single disk read and decode,
+  // so giving these up under memory pressure costs little.
+  MemoryBudgetManager::instance().registerEvictable(MemoryBudgetManager::CACHED_INTERMEDIATES,
+                                                    []() { DecodedImageCache::instance().clear(); });
+}
+
+ImageHandle DecodedImageCache::fetch(const ImageId& image_id) {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  const auto it(m_byId.find(image_id));
+  if (it == m_byId.end()) {
+    return ImageHandle();
+  }
+
+  // Move the entry to the front of the LRU.
+  m_entries.splice(m_entries.begin(), m_entries, it->second);
+
+  return m_entries.front().image;
+}
+
+void DecodedImageCache::insert(const ImageId& image_id, const ImageHandle& image) {
+  if (image.isNull()) {
+    return;
+  }
+
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  const auto it(m_byId.find(image_id));
+  if (it != m_byId.end()) {
+    m_cachedBytes -= entryBytes(*it->second);
+    m_entries.erase(it->second);
+    m_byId.erase(it);
+  }
+
+  m_entries.push_front(Entry{image_id, image});
+  m_byId[image_id] = m_entries.begin();
+  m_cachedBytes += entryBytes(m_entries.front());
+
+  while ((m_cachedBytes > MAX_CACHED_BYTES) && (m_entries.size() > 1)) {
+    m_cachedBytes -= entryBytes(m_entries.back());
+    m_byId.erase(m_entries.back().imageId);
+    m_entries.pop_back();
+  }
+}
+
+void DecodedImageCache::remove(const ImageId& image_id) {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  const auto it(m_byId.find(image_id));
+  if (it != m_byId.end()) {
+    m_cachedBytes -= entryBytes(*it->second);
+    m_entries.erase(it->second);
+    m_byId.erase(it);
+  }
+}
+
+void DecodedImageCache::clear() {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+  m_entries.clear();
+  m_byId.clear();
+  m_cachedBytes = 0;
+}
+
+size_t DecodedImageCache::entryBytes(const Entry& entry) {
+  // The grayscale version may not have been converted yet, but it's
+  // one byte per pixel once it is, so budget for it up front.
+  const QImage& orig = entry.image.origImage();
+
+  return (size_t) orig.bytesPerLine() * orig.height() + (size_t) orig.width() * orig.height();
+}
@@ -0,0 +1,85 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DECODEDIMAGECACHE_H_
+#define DECODEDIMAGECACHE_H_
+
+#include <list>
+#include <map>
+#include <mutex>
+#include "ImageHandle.h"
+#include "ImageId.h"
+#include "NonCopyable.h"
+
+/**
+ * \brief A bounded LRU of decoded originals and their grayscale versions.
+ *
+ * Every stage's task starts from a FilterData holding the decoded
+ * original, so switching between stages on the same page used to reload
+ * and re-convert the image from disk each time.  LoadFileTask consults
+ * this cache first, making stage switches on the current page and batch
+ * runs of consecutive stages reuse the decode.
+ *
+ * May be used from any thread.
+ */
+class DecodedImageCache {
+  DECLARE_NON_COPYABLE(DecodedImageCache)
+
+ public:
+  static DecodedImageCache& instance();
+
+  /**
+   * \brief Fetches the cached decode of the given image.
+   *
+   * Returns a null handle if the image is not in the cache.  The
+   * handle shares pixel buffers with the cache entry - including the
+   * lazily converted grayscale version - rather than copying them.
+   */
+  ImageHandle fetch(const ImageId& image_id);
+
+  void insert(const ImageId& image_id, const ImageHandle& image);
+
+  void remove(const ImageId& image_id);
+
+  void clear();
+
+ private:
+  struct Entry {
+    ImageId imageId;
+    ImageHandle image;
+  };
+
+  DecodedImageCache();
+
+  static size_t entryBytes(const Entry& entry);
+
+  /** The cache never grows past this many bytes of pixel data. */
+  static const size_t MAX_CACHED_BYTES = size_t(512) * 1024 * 1024;
+
+  std::mutex m_mutex;
+
+  /** Most recently used entries are at the front. */
+  std::list<Entry> m_entries;
+
+  std::map<ImageId, std::list<Entry>::iterator> m_byId;
+
+  size_t m_cachedBytes = 0;
+};
+
+
+#endif  // ifndef DECODEDIMAGECACHE_H_
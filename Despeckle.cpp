@@ -20,10 +20,12 @@
 #include <QDebug>
 #include <QImage>
 #include <cmath>
+#include <mutex>
 #include <unordered_map>
 #include "DebugImages.h"
 #include "Dpi.h"
 #include "FastQueue.h"
+#include "ParallelFor.h"
 #include "TaskStatus.h"
 #include "imageproc/BinaryImage.h"
 #include "imageproc/ConnectivityMap.h"
@@ -641,33 +643,52 @@ void voronoiDistances(const ConnectivityMap& cmap,
 
   const uint32_t* const cmap_data = cmap.data();
   const Distance* const distance_data = &distance_matrix[0] + width + 3;
-  for (int y = 0, offset = 0; y < height; ++y, offset += 2) {
-    for (int x = 0; x < width; ++x, ++offset) {
-      const uint32_t label = cmap_data[offset];
-      assert(label != 0);
-
-      const int x1 = x + distance_data[offset].vec.x;
-      const int y1 = y + distance_data[offset].vec.y;
-
-      for (int i : offsets) {
-        const int nbh_offset = offset + i;
-        const uint32_t nbh_label = cmap_data[nbh_offset];
-        if ((nbh_label == 0) || (nbh_label == label)) {
-          // label 0 can be encountered in
-          // padding lines.
-          continue;
-        }
 
-        const int x2 = x + distance_data[nbh_offset].vec.x;
-        const int y2 = y + distance_data[nbh_offset].vec.y;
-        const int dx = x1 - x2;
-        const int dy = y1 - y2;
-        const uint32_t sqdist = dx * dx + dy * dy;
+  // Rows only read the map and the distance matrix, so they can be scanned
+  // in parallel with per-chunk connection maps merged at the end.
+  std::mutex conns_mutex;
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    std::unordered_map<Connection, uint32_t, Connection::hash> chunk_conns;
+
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      int offset = y * cmap.stride();
+      for (int x = 0; x < width; ++x, ++offset) {
+        const uint32_t label = cmap_data[offset];
+        assert(label != 0);
+
+        const int x1 = x + distance_data[offset].vec.x;
+        const int y1 = y + distance_data[offset].vec.y;
+
+        for (int i : offsets) {
+          const int nbh_offset = offset + i;
+          const uint32_t nbh_label = cmap_data[nbh_offset];
+          if ((nbh_label == 0) || (nbh_label == label)) {
+            // label 0 can be encountered in
+            // padding lines.
+            continue;
+          }
 
-        updateDistance(conns, label, nbh_label, sqdist);
+          const int x2 = x + distance_data[nbh_offset].vec.x;
+          const int y2 = y + distance_data[nbh_offset].vec.y;
+          const int dx = x1 - x2;
+          const int dy = y1 - y2;
+          const uint32_t sqdist = dx * dx + dy * dy;
+
+          updateDistance(chunk_conns, label, nbh_label, sqdist);
+        }
       }
     }
-  }
+
+    const std::lock_guard<std::mutex> guard(conns_mutex);
+    for (const auto& pair : chunk_conns) {
+      auto it(conns.find(pair.first));
+      if (it == conns.end()) {
+        conns.insert(pair);
+      } else if (pair.second < it->second) {
+        it->second = pair.second;
+      }
+    }
+  });
 }  // voronoiDistances
 
 void despeckleImpl(BinaryImage& image,
@@ -675,7 +696,7 @@ void despeckleImpl(BinaryImage& image,
                    const Settings& settings,
                    const TaskStatus& status,
                    DebugImages* const dbg) {
-  ConnectivityMap cmap(image, CONN8);
+  ConnectivityMap cmap(image, CONN8, ConnectivityMap::LABEL_UNION_FIND);
   if (cmap.maxLabel() == 0) {
     // Completely white image?
     return;
@@ -692,16 +713,33 @@ void despeckleImpl(BinaryImage& image,
   uint32_t* const cmap_data = cmap.data();
 
   // Count the number of pixels and a bounding rect of each component.
-  uint32_t* cmap_line = cmap_data;
+  // Strips are scanned independently and their per-component statistics
+  // stitched together afterwards.
   const int cmap_stride = cmap.stride();
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      const uint32_t label = cmap_line[x];
-      ++components[label].num_pixels;
-      bounding_boxes[label].extend(x, y);
+  std::mutex stats_mutex;
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    std::vector<Component> chunk_components(components.size());
+    std::vector<BoundingBox> chunk_boxes(bounding_boxes.size());
+
+    const uint32_t* cmap_line = cmap_data + chunk_begin * cmap_stride;
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      for (int x = 0; x < width; ++x) {
+        const uint32_t label = cmap_line[x];
+        ++chunk_components[label].num_pixels;
+        chunk_boxes[label].extend(x, y);
+      }
+      cmap_line += cmap_stride;
     }
-    cmap_line += cmap_stride;
-  }
+
+    const std::lock_guard<std::mutex> guard(stats_mutex);
+    for (size_t label = 0; label < components.size(); ++label) {
+      components[label].num_pixels += chunk_components[label].num_pixels;
+      if (chunk_components[label].num_pixels > 0) {
+        bounding_boxes[label].extend(chunk_boxes[label].left, chunk_boxes[label].top);
+        bounding_boxes[label].extend(chunk_boxes[label].right, chunk_boxes[label].bottom);
+      }
+    }
+  });
 
   status.throwIfCancelled();
 
@@ -732,14 +770,30 @@ void despeckleImpl(BinaryImage& image,
   status.throwIfCancelled();
 
   const uint32_t max_label = next_avail_component - 1;
+
+  // The statistics above already decide the trivial cases.  The Voronoi
+  // apparatus below only exists to settle the fate of small components
+  // sitting next to bigger ones, so skip it when there is no such pair.
+  if (unified_big_component == 0) {
+    // Nothing to anchor to - every component is speckle.
+    image.fill(WHITE);
+    return;
+  }
+  if (max_label == 1) {
+    // Only big components - nothing can possibly be removed.
+    return;
+  }
+
   // Remapping individual pixels.
-  cmap_line = cmap_data;
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      cmap_line[x] = remapping_table[cmap_line[x]];
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    uint32_t* cmap_line = cmap_data + chunk_begin * cmap_stride;
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      for (int x = 0; x < width; ++x) {
+        cmap_line[x] = remapping_table[cmap_line[x]];
+      }
+      cmap_line += cmap_stride;
     }
-    cmap_line += cmap_stride;
-  }
+  });
   if (dbg) {
     dbg->add(cmap.visualized(), "big_components_unified");
   }
@@ -782,7 +836,10 @@ void despeckleImpl(BinaryImage& image,
 
   bool have_anchored_to_small_but_not_big = false;
   for (const Component& comp : components) {
-    have_anchored_to_small_but_not_big = comp.anchoredToSmallButNotBig();
+    if (comp.anchoredToSmallButNotBig()) {
+      have_anchored_to_small_but_not_big = true;
+      break;
+    }
   }
 
   if (have_anchored_to_small_but_not_big) {
@@ -908,18 +965,22 @@ void despeckleImpl(BinaryImage& image,
   status.throwIfCancelled();
   // Remove unmarked components from the binary image.
   const uint32_t msb = uint32_t(1) << 31;
-  uint32_t* image_line = image.data();
+  uint32_t* const image_data = image.data();
   const int image_stride = image.wordsPerLine();
-  cmap_line = cmap_data;
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      if (!components[cmap_line[x]].anchoredToBig()) {
-        image_line[x >> 5] &= ~(msb >> (x & 31));
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    uint32_t* image_line = image_data + chunk_begin * image_stride;
+    const uint32_t* cmap_line = cmap_data + chunk_begin * cmap_stride;
+
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      for (int x = 0; x < width; ++x) {
+        if (!components[cmap_line[x]].anchoredToBig()) {
+          image_line[x >> 5] &= ~(msb >> (x & 31));
+        }
       }
+      image_line += image_stride;
+      cmap_line += cmap_stride;
     }
-    image_line += image_stride;
-    cmap_line += cmap_stride;
-  }
+  });
 }
 }  // namespace
 
@@ -963,3 +1024,258 @@ void Despeckle::despeckleInPlace(imageproc::BinaryImage& image,
   despeckleImpl(image, dpi, settings, status, dbg);
 }
 // Despeckle::despeckleInPlace
+
+/*========================== Despeckle::Analysis ==========================*/
+
+struct Despeckle::Analysis::Data {
+  /**
+   * \brief A minimum squared distance between two Voronoi-adjacent
+   *        components.
+   */
+  struct ComponentConnection {
+    uint32_t label1;
+    uint32_t label2;
+    uint32_t sqdist;
+  };
+
+  BinaryImage src;
+
+  /**
+   * Component labels.  analyze() runs voronoi() on it, so background
+   * pixels carry the label of the nearest component, but pixels that
+   * are black in \ref src keep their original labels, which is all
+   * despeckle() needs.
+   */
+  ConnectivityMap cmap;
+
+  /** The number of pixels in each component.  Indexed by label. */
+  std::vector<uint32_t> numPixels;
+
+  /** The bounding box of each component.  Indexed by label. */
+  std::vector<BoundingBox> boundingBoxes;
+
+  std::vector<ComponentConnection> connections;
+};
+
+Despeckle::Analysis::Analysis() : m_data(new Data) {}
+
+Despeckle::Analysis::~Analysis() = default;
+
+std::shared_ptr<const Despeckle::Analysis> Despeckle::analyze(const BinaryImage& src, const TaskStatus& status) {
+  std::shared_ptr<Analysis> analysis(new Analysis);
+  Analysis::Data& data = *analysis->m_data;
+
+  data.src = src;
+  data.cmap = ConnectivityMap(src, CONN8, ConnectivityMap::LABEL_UNION_FIND);
+  if (data.cmap.maxLabel() == 0) {
+    // Completely white image?
+    return analysis;
+  }
+
+  status.throwIfCancelled();
+
+  data.numPixels.resize(data.cmap.maxLabel() + 1, 0);
+  data.boundingBoxes.resize(data.cmap.maxLabel() + 1);
+
+  const int width = src.width();
+  const int height = src.height();
+  const int cmap_stride = data.cmap.stride();
+  const uint32_t* const cmap_data = data.cmap.data();
+
+  // Count the number of pixels and a bounding rect of each component,
+  // the same way despeckleImpl() does.
+  std::mutex stats_mutex;
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    std::vector<uint32_t> chunk_pixels(data.numPixels.size(), 0);
+    std::vector<BoundingBox> chunk_boxes(data.boundingBoxes.size());
+
+    const uint32_t* cmap_line = cmap_data + chunk_begin * cmap_stride;
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      for (int x = 0; x < width; ++x) {
+        const uint32_t label = cmap_line[x];
+        ++chunk_pixels[label];
+        chunk_boxes[label].extend(x, y);
+      }
+      cmap_line += cmap_stride;
+    }
+
+    const std::lock_guard<std::mutex> guard(stats_mutex);
+    for (size_t label = 0; label < data.numPixels.size(); ++label) {
+      data.numPixels[label] += chunk_pixels[label];
+      if (chunk_pixels[label] > 0) {
+        data.boundingBoxes[label].extend(chunk_boxes[label].left, chunk_boxes[label].top);
+        data.boundingBoxes[label].extend(chunk_boxes[label].right, chunk_boxes[label].bottom);
+      }
+    }
+  });
+
+  status.throwIfCancelled();
+
+  if (data.cmap.maxLabel() == 1) {
+    // A single component has no neighbours to measure distances to.
+    data.cmap.compact();
+    return analysis;
+  }
+
+  // Build a Voronoi diagram over the original labels and measure the
+  // distances between neighbouring components.  Unlike despeckleImpl(),
+  // big components keep their individual labels here - which components
+  // count as big depends on the level, so that distinction is left to
+  // despeckle().
+  std::vector<Distance> distance_matrix;
+  voronoi(data.cmap, distance_matrix);
+
+  status.throwIfCancelled();
+
+  std::unordered_map<Connection, uint32_t, Connection::hash> conns;
+  voronoiDistances(data.cmap, distance_matrix, conns);
+
+  status.throwIfCancelled();
+
+  data.connections.reserve(conns.size());
+  for (const auto& pair : conns) {
+    data.connections.push_back({pair.first.lesser_label, pair.first.greater_label, pair.second});
+  }
+
+  // The cached map is only read by despeckle() from now on, and it may
+  // stay resident across many interactive level changes - store it in
+  // 16-bit labels when they fit.
+  data.cmap.compact();
+
+  return analysis;
+}  // Despeckle::analyze
+
+BinaryImage Despeckle::despeckle(const Analysis& analysis, const Dpi& dpi, const double level,
+                                 const TaskStatus& status) {
+  const Settings settings = Settings::get(level, dpi);
+  const Analysis::Data& data = *analysis.m_data;
+
+  BinaryImage image(data.src);
+  const uint32_t max_label = data.cmap.maxLabel();
+  if (max_label == 0) {
+    return image;
+  }
+
+  const int width = image.width();
+  const int height = image.height();
+
+  // Classify the components for this level.  Instead of unifying big
+  // components under one label like despeckleImpl() does, each big one
+  // simply gets the same "can always be attached to" weight, and all of
+  // them seed the retention pass below.
+  std::vector<Component> components(max_label + 1);
+  FastQueue<uint32_t> ok_labels;
+  bool have_big = false;
+  bool have_small = false;
+  for (uint32_t label = 1; label <= max_label; ++label) {
+    const BoundingBox& bb = data.boundingBoxes[label];
+    if ((bb.width() < settings.bigObjectThreshold) && (bb.height() < settings.bigObjectThreshold)) {
+      components[label].num_pixels = data.numPixels[label];
+      have_small = true;
+    } else {
+      components[label].num_pixels = width * height;
+      ok_labels.push(label);
+      have_big = true;
+    }
+  }
+
+  // The size and extent tests above already settle the trivial cases;
+  // the anchoring passes below only matter when small components have
+  // big ones to hold on to.
+  if (!have_small) {
+    // Everything is big enough to stay.
+    return image;
+  }
+  if (!have_big) {
+    // Nothing to anchor to - every component is speckle.
+    image.fill(WHITE);
+    return image;
+  }
+
+  status.throwIfCancelled();
+
+  // Build a directional connection map, only including connections
+  // close enough for this level.
+  std::vector<TargetSourceConn> target_source;
+  for (const Analysis::Data::ComponentConnection& conn : data.connections) {
+    const Component& comp1 = components[conn.label1];
+    const Component& comp2 = components[conn.label2];
+    if (canBeAttachedTo(comp1, comp2, conn.sqdist, settings)) {
+      target_source.emplace_back(conn.label2, conn.label1);
+    }
+    if (canBeAttachedTo(comp2, comp1, conn.sqdist, settings)) {
+      target_source.emplace_back(conn.label1, conn.label2);
+    }
+  }
+
+  std::sort(target_source.begin(), target_source.end());
+
+  status.throwIfCancelled();
+
+  // Create an index for quick access to a group of connections
+  // with a specified target.
+  std::vector<size_t> target_source_idx;
+  const size_t num_target_sources = target_source.size();
+  uint32_t prev_label = uint32_t(0) - 1;
+  for (size_t i = 0; i < num_target_sources; ++i) {
+    const TargetSourceConn& conn = target_source[i];
+    assert(conn.target != 0);
+    for (; prev_label != conn.target; ++prev_label) {
+      target_source_idx.push_back(i);
+    }
+    assert(target_source_idx.size() - 1 == conn.target);
+  }
+  for (auto label = static_cast<uint32_t>(target_source_idx.size()); label <= max_label; ++label) {
+    target_source_idx.push_back(num_target_sources);
+  }
+
+  // Spread the "to be retained" mark from the big components.
+  while (!ok_labels.empty()) {
+    const uint32_t label = ok_labels.front();
+    ok_labels.pop();
+
+    Component& comp = components[label];
+    if (comp.anchoredToBig()) {
+      continue;
+    }
+
+    comp.setAnchoredToBig();
+
+    size_t idx = target_source_idx[label];
+    while (idx < num_target_sources && target_source[idx].target == label) {
+      ok_labels.push(target_source[idx].source);
+      ++idx;
+    }
+  }
+
+  status.throwIfCancelled();
+  // Remove unmarked components from the binary image.
+  const uint32_t msb = uint32_t(1) << 31;
+  uint32_t* const image_data = image.data();
+  const int image_stride = image.wordsPerLine();
+  const int cmap_stride = data.cmap.stride();
+  const auto remove_unmarked = [&](const auto* cmap_data) {
+    parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+      uint32_t* image_line = image_data + chunk_begin * image_stride;
+      const auto* cmap_line = cmap_data + chunk_begin * cmap_stride;
+
+      for (int y = chunk_begin; y < chunk_end; ++y) {
+        for (int x = 0; x < width; ++x) {
+          if (!components[cmap_line[x]].anchoredToBig()) {
+            image_line[x >> 5] &= ~(msb >> (x & 31));
+          }
+        }
+        image_line += image_stride;
+        cmap_line += cmap_stride;
+      }
+    });
+  };
+
+  if (data.cmap.isCompact()) {
+    remove_unmarked(data.cmap.data16());
+  } else {
+    remove_unmarked(data.cmap.data());
+  }
+
+  return image;
+}  // Despeckle::despeckle
@@ -19,6 +19,8 @@
 #ifndef DESPECKLE_H_
 #define DESPECKLE_H_
 
+#include <memory>
+
 class Dpi;
 class TaskStatus;
 class DebugImages;
@@ -31,6 +33,18 @@ class Despeckle {
  public:
   enum Level { CAUTIOUS, NORMAL, AGGRESSIVE };
 
+  /**
+   * \brief The level-independent part of the despeckle computation.
+   *
+   * Labelling the connected components, collecting their statistics and
+   * measuring the distances between neighbouring components doesn't
+   * depend on the despeckle level.  An Analysis captures those results,
+   * so that re-despeckling at a different level becomes a cheap
+   * re-thresholding pass over the cached components.  Produced by
+   * analyze() and treated as opaque by client code.
+   */
+  class Analysis;
+
   /**
    * \brief Removes small speckles from a binary image.
    *
@@ -67,6 +81,46 @@ class Despeckle {
                                double level,
                                const TaskStatus& status,
                                DebugImages* dbg = nullptr);
+
+  /**
+   * \brief Performs the level-independent component analysis of an image.
+   *
+   * \param src The image to analyze.  A reference to it is kept inside
+   *        the returned object.
+   * \param status For asynchronous task cancellation.
+   */
+  static std::shared_ptr<const Analysis> analyze(const imageproc::BinaryImage& src, const TaskStatus& status);
+
+  /**
+   * \brief Like despeckle(), but reusing a cached component analysis.
+   *
+   * \note This version skips the rarely taken "second chance" pass of
+   *       the full pipeline, which re-examines components that are only
+   *       anchored to small neighbours, so in marginal cases it may
+   *       remove a component the full pipeline would keep.
+   */
+  static imageproc::BinaryImage despeckle(const Analysis& analysis,
+                                          const Dpi& dpi,
+                                          double level,
+                                          const TaskStatus& status);
+};
+
+
+/**
+ * \see Despeckle::analyze()
+ */
+class Despeckle::Analysis {
+ public:
+  ~Analysis();
+
+ private:
+  friend class Despeckle;
+
+  struct Data;
+
+  Analysis();
+
+  std::unique_ptr<Data> m_data;
 };
 
 
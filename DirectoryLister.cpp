@@ -0,0 +1,75 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DirectoryLister.h"
+#include <QDir>
+#include <QDirIterator>
+
+namespace {
+// Entries are published to the consumer in batches, so that a slow
+// (network) directory shows steady progress without taking the mutex
+// for every single entry.
+const int BATCH_SIZE = 64;
+}  // namespace
+
+DirectoryLister::DirectoryLister() : m_finished(false), m_cancel(false) {}
+
+DirectoryLister::~DirectoryLister() {
+  m_cancel = true;
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+}
+
+void DirectoryLister::start(const QString& dir) {
+  m_thread = std::thread(&DirectoryLister::listDir, this, dir);
+}
+
+size_t DirectoryLister::takeNewEntries(std::vector<QFileInfo>& out) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const size_t count = m_entries.size();
+  out.insert(out.end(), std::make_move_iterator(m_entries.begin()), std::make_move_iterator(m_entries.end()));
+  m_entries.clear();
+
+  return count;
+}
+
+void DirectoryLister::listDir(const QString& dir) {
+  std::vector<QFileInfo> batch;
+  batch.reserve(BATCH_SIZE);
+
+  QDirIterator it(dir, QDir::Files);
+  while (!m_cancel && it.hasNext()) {
+    it.next();
+    batch.push_back(it.fileInfo());
+
+    if (batch.size() >= BATCH_SIZE) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_entries.insert(m_entries.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+      batch.clear();
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.insert(m_entries.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+  }
+
+  m_finished = true;
+}
@@ -0,0 +1,87 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIRECTORYLISTER_H_
+#define DIRECTORYLISTER_H_
+
+#include <QFileInfo>
+#include <QString>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "NonCopyable.h"
+
+/**
+ * \brief Enumerates the files of one directory on a background thread.
+ *
+ * On local filesystems a directory listing is nearly instant, but on
+ * network filesystems it can take seconds for a few thousand entries,
+ * which is far too long to block the GUI thread for.  The lister
+ * walks the directory on a single worker thread and hands out
+ * whatever entries have accumulated each time takeNewEntries() is
+ * called, so the caller can fill its model incrementally from a
+ * polling timer, the same way ImageMetadataScanner is consumed.
+ *
+ * start(), the polling methods and the destructor are meant to be
+ * called from a single thread, typically the GUI thread.
+ */
+class DirectoryLister {
+  DECLARE_NON_COPYABLE(DirectoryLister)
+
+ public:
+  DirectoryLister();
+
+  /**
+   * Cancels and joins the worker if the listing didn't complete.
+   */
+  ~DirectoryLister();
+
+  /**
+   * \brief Starts listing the given directory in the background.
+   *
+   * May only be called once per instance.
+   */
+  void start(const QString& dir);
+
+  /**
+   * \brief Moves the entries accumulated since the last call to the
+   *        end of \p out.
+   *
+   * Returns the number of entries appended.
+   */
+  size_t takeNewEntries(std::vector<QFileInfo>& out);
+
+  /**
+   * Once this returns true, one more takeNewEntries() call drains
+   * whatever the worker produced last.
+   */
+  bool isFinished() const { return m_finished; }
+
+ private:
+  void listDir(const QString& dir);
+
+  std::vector<QFileInfo> m_entries;  // Guarded by m_mutex.
+  std::mutex m_mutex;
+  std::thread m_thread;
+  std::atomic<bool> m_finished;
+  std::atomic<bool> m_cancel;
+};
+
+
+#endif  // ifndef DIRECTORYLISTER_H_
@@ -0,0 +1,71 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIRTYPAGES_H_
+#define DIRTYPAGES_H_
+
+#include <unordered_set>
+#include "PageId.h"
+
+/**
+ * \brief Tracks which pages' settings changed since the dirty state
+ *        was last collected.
+ *
+ * Used by the incremental project saving code to rewrite only the
+ * affected per-page records.  This class is not thread-safe by itself -
+ * it's meant to live behind the mutex of the settings object it belongs
+ * to.  A default-constructed instance reports all pages dirty, as it
+ * can't know what's in the project file, if anything.
+ */
+class DirtyPages {
+ public:
+  DirtyPages() : m_allDirty(true) {}
+
+  void mark(const PageId& page_id) { m_pages.insert(page_id); }
+
+  /**
+   * To be used when a change isn't attributable to particular pages,
+   * like clearing the settings or re-keying them on relinking.
+   */
+  void markAll() {
+    m_pages.clear();
+    m_allDirty = true;
+  }
+
+  bool allDirty() const { return m_allDirty; }
+
+  /**
+   * The set of dirty pages.  Meaningless when allDirty() is true.
+   */
+  const std::unordered_set<PageId>& pages() const { return m_pages; }
+
+  /**
+   * Resets to the all-clean state.
+   */
+  void clear() {
+    m_pages.clear();
+    m_allDirty = false;
+  }
+
+ private:
+  std::unordered_set<PageId> m_pages;
+  bool m_allDirty;
+};
+
+
+#endif  // ifndef DIRTYPAGES_H_
@@ -116,9 +116,12 @@ static void morphologicalPreprocessingInPlace(GrayImage& image, DebugImages* dbg
     dbg->add(approximated, "approx_diff");
   }
   // Now let's take the difference between the original difference
-  // and approximated difference.
+  // and approximated difference.  Our final decision only needs the
+  // number of pixels greater than 10, so count them in the same sweep
+  // rather than histogramming the result afterwards.
+  int sum = 0;
   rasterOpGeneric(diff.data(), diff.stride(), diff.size(), approximated.data(), approximated.stride(),
-                  if_then_else(_1 > _2, _1 -= _2, _1 = _2 - _1));
+                  fusedOp(if_then_else(_1 > _2, _1 -= _2, _1 = _2 - _1), if_then(_1 > 10, ++var(sum))));
   approximated = GrayImage();  // save memory.
   if (dbg) {
     dbg->add(diff, "raw_vs_approx_diff");
@@ -129,12 +132,6 @@ static void morphologicalPreprocessingInPlace(GrayImage& image, DebugImages* dbg
   // we consider that we have a picture rather than a shadow,
   // and use method2.
 
-  int sum = 0;
-  GrayscaleHistogram hist(diff);
-  for (int i = 255; i > 10; --i) {
-    sum += hist[i];
-  }
-
   // qDebug() << "% of pixels > 10: " << 100.0 * sum / (diff.width() * diff.height());
 
   if (sum < 0.01 * (diff.width() * diff.height())) {
@@ -0,0 +1,75 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FileFingerprint.h"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <unordered_map>
+#include "Hashes.h"
+
+namespace {
+/** Bytes sampled from each end of the file. */
+const qint64 SAMPLE_BYTES = 64 * 1024;
+
+QMutex registry_mutex;
+std::unordered_map<QString, QString, hashes::hash<QString>> registry;
+}  // anonymous namespace
+
+QString FileFingerprint::compute(const QString& file_path) {
+  QFile file(file_path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return QString();
+  }
+
+  QCryptographicHash hash(QCryptographicHash::Md5);
+  const qint64 size = file.size();
+  hash.addData(QByteArray::number(size));
+
+  if (size <= 2 * SAMPLE_BYTES) {
+    hash.addData(file.readAll());
+  } else {
+    hash.addData(file.read(SAMPLE_BYTES));
+    if (!file.seek(size - SAMPLE_BYTES)) {
+      return QString();
+    }
+    hash.addData(file.read(SAMPLE_BYTES));
+  }
+
+  return QString::fromLatin1(hash.result().toHex());
+}
+
+void FileFingerprint::recordExpected(const QString& file_path, const QString& fingerprint) {
+  const QMutexLocker locker(&registry_mutex);
+  if (fingerprint.isEmpty()) {
+    registry.erase(file_path);
+  } else {
+    registry[file_path] = fingerprint;
+  }
+}
+
+QString FileFingerprint::expectedFor(const QString& file_path) {
+  const QMutexLocker locker(&registry_mutex);
+  const auto it(registry.find(file_path));
+  if (it != registry.end()) {
+    return it->second;
+  }
+
+  return QString();
+}
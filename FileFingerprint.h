@@ -0,0 +1,58 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FILE_FINGERPRINT_H_
+#define FILE_FINGERPRINT_H_
+
+#include <QString>
+
+/**
+ * \brief Quick content fingerprints for the files a project refers to.
+ *
+ * A fingerprint covers the file size plus the first and the last 64 KB
+ * of content, so it's cheap to compute even for large files on network
+ * storage, yet it detects a file that was silently replaced by another
+ * one of the same name.  Fingerprints recorded in a project file are
+ * kept in a process-wide registry and verified when the relinking
+ * dialog checks paths.
+ */
+class FileFingerprint {
+ public:
+  /**
+   * Computes the fingerprint of a file by sampling its head and tail.
+   * Returns an empty string if the file can't be read.
+   */
+  static QString compute(const QString& file_path);
+
+  /**
+   * Records the fingerprint a project file claims for \p file_path.
+   * An empty fingerprint removes the record.
+   */
+  static void recordExpected(const QString& file_path, const QString& fingerprint);
+
+  /**
+   * Returns the recorded fingerprint for \p file_path,
+   * or an empty string if none was recorded.
+   *
+   * \note May be called from any thread.
+   */
+  static QString expectedFor(const QString& file_path);
+};
+
+
+#endif  // ifndef FILE_FINGERPRINT_H_
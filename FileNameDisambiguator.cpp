@@ -20,18 +20,14 @@
 #include <QDomDocument>
 #include <QFileInfo>
 #include <QMutex>
-#include <boost/foreach.hpp>
+#include <algorithm>
 #include <boost/lambda/lambda.hpp>
-#include <boost/multi_index/composite_key.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/sequenced_index.hpp>
-#include <boost/multi_index_container.hpp>
+#include <unordered_map>
+#include <vector>
 #include "AbstractRelinker.h"
+#include "Hashes.h"
 #include "RelinkablePath.h"
 
-using namespace boost::multi_index;
-
 class FileNameDisambiguator::Impl {
  public:
   Impl();
@@ -49,39 +45,33 @@ class FileNameDisambiguator::Impl {
   void performRelinking(const AbstractRelinker& relinker);
 
  private:
-  class ItemsByFilePathTag;
-  class ItemsByFileNameLabelTag;
-
-  class UnorderedItemsTag;
-
   struct Item {
     QString filePath;
-    QString fileName;
     int label;
 
-    Item(const QString& file_path, int lbl);
-
-    Item(const QString& file_path, const QString& file_name, int lbl);
+    Item(const QString& file_path, int lbl) : filePath(file_path), label(lbl) {}
   };
 
-  typedef multi_index_container<
-      Item,
-      indexed_by<
-          ordered_unique<tag<ItemsByFilePathTag>, member<Item, QString, &Item::filePath>>,
-          ordered_unique<tag<ItemsByFileNameLabelTag>,
-                         composite_key<Item, member<Item, QString, &Item::fileName>, member<Item, int, &Item::label>>>,
-          sequenced<tag<UnorderedItemsTag>>>>
-      Container;
-
-  typedef Container::index<ItemsByFilePathTag>::type ItemsByFilePath;
-  typedef Container::index<ItemsByFileNameLabelTag>::type ItemsByFileNameLabel;
-  typedef Container::index<UnorderedItemsTag>::type UnorderedItems;
+  /**
+   * Adds a record unless the path is already known.  Call with the
+   * mutex held.  Returns the label of the file, newly assigned or not.
+   */
+  int addItemLocked(const QString& file_path, int label);
 
   mutable QMutex m_mutex;
-  Container m_items;
-  ItemsByFilePath& m_itemsByFilePath;
-  ItemsByFileNameLabel& m_itemsByFileNameLabel;
-  UnorderedItems& m_unorderedItems;
+
+  /** All the records in registration order, for toXml(). */
+  std::vector<Item> m_itemsInOrder;
+
+  /** Maps a file path to its position in m_itemsInOrder. */
+  std::unordered_map<QString, size_t, hashes::hash<QString>> m_itemsByFilePath;
+
+  /**
+   * Maps a file name (without the directory part) to the label
+   * the next file with that name is to receive.  A name that is
+   * not in the map yet corresponds to a label of zero.
+   */
+  std::unordered_map<QString, int, hashes::hash<QString>> m_nextLabelByFileName;
 };
 
 
@@ -120,18 +110,17 @@ void FileNameDisambiguator::performRelinking(const AbstractRelinker& relinker) {
 
 /*==================== FileNameDisambiguator::Impl ====================*/
 
-FileNameDisambiguator::Impl::Impl()
-    : m_items(),
-      m_itemsByFilePath(m_items.get<ItemsByFilePathTag>()),
-      m_itemsByFileNameLabel(m_items.get<ItemsByFileNameLabelTag>()),
-      m_unorderedItems(m_items.get<UnorderedItemsTag>()) {}
+FileNameDisambiguator::Impl::Impl() {}
 
 FileNameDisambiguator::Impl::Impl(const QDomElement& disambiguator_el,
-                                  const boost::function<QString(const QString&)>& file_path_unpacker)
-    : m_items(),
-      m_itemsByFilePath(m_items.get<ItemsByFilePathTag>()),
-      m_itemsByFileNameLabel(m_items.get<ItemsByFileNameLabelTag>()),
-      m_unorderedItems(m_items.get<UnorderedItemsTag>()) {
+                                  const boost::function<QString(const QString&)>& file_path_unpacker) {
+  // Bulk construction: every insertion below is O(1) amortized,
+  // so loading a project is linear in the number of records.
+  const int num_records = disambiguator_el.childNodes().count();
+  m_itemsInOrder.reserve(num_records);
+  m_itemsByFilePath.reserve(num_records);
+  m_nextLabelByFileName.reserve(num_records);
+
   QDomNode node(disambiguator_el.firstChild());
   for (; !node.isNull(); node = node.nextSibling()) {
     if (!node.isElement()) {
@@ -150,7 +139,7 @@ FileNameDisambiguator::Impl::Impl(const QDomElement& disambiguator_el,
     }
 
     const int label = file_el.attribute("label").toInt();
-    m_items.insert(Item(file_path, label));
+    addItemLocked(file_path, label);
   }
 }
 
@@ -161,7 +150,7 @@ QDomElement FileNameDisambiguator::Impl::toXml(QDomDocument& doc,
 
   QDomElement el(doc.createElement(name));
 
-  for (const Item& item : m_unorderedItems) {
+  for (const Item& item : m_itemsInOrder) {
     const QString file_path_shorthand = file_path_packer(item.filePath);
     if (file_path_shorthand.isEmpty()) {
       // Unrepresentable file path - skipping this record.
@@ -180,9 +169,9 @@ QDomElement FileNameDisambiguator::Impl::toXml(QDomDocument& doc,
 int FileNameDisambiguator::Impl::getLabel(const QString& file_path) const {
   const QMutexLocker locker(&m_mutex);
 
-  const ItemsByFilePath::iterator fp_it(m_itemsByFilePath.find(file_path));
+  const auto fp_it(m_itemsByFilePath.find(file_path));
   if (fp_it != m_itemsByFilePath.end()) {
-    return fp_it->label;
+    return m_itemsInOrder[fp_it->second].label;
   }
 
   return 0;
@@ -191,47 +180,42 @@ int FileNameDisambiguator::Impl::getLabel(const QString& file_path) const {
 int FileNameDisambiguator::Impl::registerFile(const QString& file_path) {
   const QMutexLocker locker(&m_mutex);
 
-  const ItemsByFilePath::iterator fp_it(m_itemsByFilePath.find(file_path));
+  // -1 makes addItemLocked() pick the next free label
+  // in the file's disambiguation group.
+  return addItemLocked(file_path, -1);
+}
+
+int FileNameDisambiguator::Impl::addItemLocked(const QString& file_path, int label) {
+  const auto fp_it(m_itemsByFilePath.find(file_path));
   if (fp_it != m_itemsByFilePath.end()) {
-    return fp_it->label;
+    return m_itemsInOrder[fp_it->second].label;
   }
 
-  int label = 0;
-
   const QString file_name(QFileInfo(file_path).fileName());
-  const ItemsByFileNameLabel::iterator fn_it(m_itemsByFileNameLabel.upper_bound(boost::make_tuple(file_name)));
-  // If the item preceeding fn_it has the same file name,
-  // the new file belongs to the same disambiguation group.
-  if (fn_it != m_itemsByFileNameLabel.begin()) {
-    ItemsByFileNameLabel::iterator prev(fn_it);
-    --prev;
-    if (prev->fileName == file_name) {
-      label = prev->label + 1;
-    }
-  }  // Otherwise, label remains 0.
-  const Item new_item(file_path, file_name, label);
-  m_itemsByFileNameLabel.insert(fn_it, new_item);
+  int& next_label = m_nextLabelByFileName[file_name];  // Zero for a new name.
+  if (label < 0) {
+    label = next_label;
+  }
+  // Labels loaded from a project file may come in any order,
+  // so advancing rather than incrementing keeps them unique.
+  next_label = std::max(next_label, label + 1);
+
+  m_itemsByFilePath.emplace(file_path, m_itemsInOrder.size());
+  m_itemsInOrder.emplace_back(file_path, label);
 
   return label;
 }
 
 void FileNameDisambiguator::Impl::performRelinking(const AbstractRelinker& relinker) {
   const QMutexLocker locker(&m_mutex);
-  Container new_items;
 
-  for (const Item& item : m_unorderedItems) {
+  std::vector<Item> old_items;
+  old_items.swap(m_itemsInOrder);
+  m_itemsByFilePath.clear();
+  m_nextLabelByFileName.clear();
+
+  for (const Item& item : old_items) {
     const RelinkablePath old_path(item.filePath, RelinkablePath::File);
-    Item new_item(relinker.substitutionPathFor(old_path), item.label);
-    new_items.insert(new_item);
+    addItemLocked(relinker.substitutionPathFor(old_path), item.label);
   }
-
-  m_items.swap(new_items);
 }
-
-/*============================ Impl::Item =============================*/
-
-FileNameDisambiguator::Impl::Item::Item(const QString& file_path, int lbl)
-    : filePath(file_path), fileName(QFileInfo(file_path).fileName()), label(lbl) {}
-
-FileNameDisambiguator::Impl::Item::Item(const QString& file_path, const QString& file_name, int lbl)
-    : filePath(file_path), fileName(file_name), label(lbl) {}
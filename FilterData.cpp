@@ -18,18 +18,16 @@
 
 #include "FilterData.h"
 #include "Dpm.h"
-#include "imageproc/Grayscale.h"
 
 using namespace imageproc;
 
-FilterData::FilterData(const QImage& image)
-    : m_origImage(image), m_grayImage(toGrayscale(m_origImage)), m_xform(image.rect(), Dpm(image)) {}
+FilterData::FilterData(const QImage& image) : m_image(image), m_xform(image.rect(), Dpm(image)) {}
+
+FilterData::FilterData(const ImageHandle& image)
+    : m_image(image), m_xform(image.origImage().rect(), Dpm(image.origImage())) {}
 
 FilterData::FilterData(const FilterData& other, const ImageTransformation& xform)
-    : m_origImage(other.m_origImage),
-      m_grayImage(other.m_grayImage),
-      m_xform(xform),
-      m_imageParams(other.m_imageParams) {}
+    : m_image(other.m_image), m_xform(xform), m_imageParams(other.m_imageParams) {}
 
 FilterData::FilterData(const FilterData& other) = default;
 
@@ -42,11 +40,15 @@ const ImageTransformation& FilterData::xform() const {
 }
 
 const QImage& FilterData::origImage() const {
-  return m_origImage;
+  return m_image.origImage();
 }
 
 const imageproc::GrayImage& FilterData::grayImage() const {
-  return m_grayImage;
+  return m_image.grayImage();
+}
+
+const ImageHandle& FilterData::imageHandle() const {
+  return m_image;
 }
 
 bool FilterData::isBlackOnWhite() const {
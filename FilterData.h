@@ -20,6 +20,7 @@
 #define FILTERDATA_H_
 
 #include <QImage>
+#include "ImageHandle.h"
 #include "ImageSettings.h"
 #include "ImageTransformation.h"
 #include "imageproc/BinaryThreshold.h"
@@ -30,6 +31,13 @@ class FilterData {
  public:
   explicit FilterData(const QImage& image);
 
+  /**
+   * Constructs from a shared image handle (e.g. from
+   * DecodedImageCache), so all stages work on the same pixel buffers
+   * and the grayscale version is converted at most once per decode.
+   */
+  explicit FilterData(const ImageHandle& image);
+
   FilterData(const FilterData& other, const ImageTransformation& xform);
 
   FilterData(const FilterData& other);
@@ -42,13 +50,14 @@ class FilterData {
 
   const imageproc::GrayImage& grayImage() const;
 
+  const ImageHandle& imageHandle() const;
+
   bool isBlackOnWhite() const;
 
   void updateImageParams(const ImageSettings::PageParams& imageParams);
 
  private:
-  QImage m_origImage;
-  imageproc::GrayImage m_grayImage;
+  ImageHandle m_image;
   ImageTransformation m_xform;
   ImageSettings::PageParams m_imageParams;
 };
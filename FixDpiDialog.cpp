@@ -18,10 +18,9 @@
 
 #include "FixDpiDialog.h"
 #include <QSortFilterProxyModel>
-#include <boost/foreach.hpp>
-#include <boost/lambda/bind.hpp>
-#include <boost/lambda/lambda.hpp>
+#include <cstdint>
 #include "ColorSchemeManager.h"
+#include "FlatHashMap.h"
 
 // To be able to use it in QVariant
 Q_DECLARE_METATYPE(ImageMetadata)
@@ -181,6 +180,7 @@ class FixDpiDialog::TreeModel : private QAbstractItemModel {
 
   std::vector<ImageFileInfo> m_files;
   std::vector<SizeGroup> m_sizes;
+  FlatHashMap<uint64_t, uint32_t> m_sizeGroupIdx;  // Packed size -> index into m_sizes.
   DpiCounts m_dpiCounts;
 };
 
@@ -691,9 +691,11 @@ void FixDpiDialog::TreeModel::emitAllPagesChanged(const QModelIndex& idx) {
   for (int i = 0; i < num_groups; ++i) {
     const QModelIndex group_node(index(i, 0, idx));
     const int num_items = rowCount(group_node);
-    for (int j = 0; j < num_items; ++j) {
-      const QModelIndex image_node(index(j, 0, group_node));
-      emit dataChanged(image_node, image_node);
+    if (num_items > 0) {
+      // One ranged signal per group.  With dynamicSortFilter on, every
+      // dataChanged() re-runs the "Need Fixing" filter, so signalling
+      // items one by one made a whole-project apply quadratic.
+      emit dataChanged(index(0, 0, group_node), index(num_items - 1, 0, group_node));
     }
     emit dataChanged(group_node, group_node);
   }
@@ -704,7 +706,7 @@ void FixDpiDialog::TreeModel::emitAllPagesChanged(const QModelIndex& idx) {
 
 void FixDpiDialog::TreeModel::emitSizeGroupChanged(const QModelIndex& idx) {
   // Every item in this size group.
-  emit dataChanged(index(0, 0, idx), index(rowCount(idx), 0, idx));
+  emit dataChanged(index(0, 0, idx), index(rowCount(idx) - 1, 0, idx));
 
   // The size group itself.
   emit dataChanged(idx, idx);
@@ -727,12 +729,13 @@ void FixDpiDialog::TreeModel::emitItemChanged(const QModelIndex& idx) {
 }
 
 FixDpiDialog::SizeGroup& FixDpiDialog::TreeModel::sizeGroupFor(const QSize size) {
-  using namespace boost::lambda;
+  const uint64_t key = (uint64_t(uint32_t(size.width())) << 32) | uint32_t(size.height());
 
-  const auto it(std::find_if(m_sizes.begin(), m_sizes.end(), bind(&SizeGroup::size, _1) == size));
-  if (it != m_sizes.end()) {
-    return *it;
+  const auto it(m_sizeGroupIdx.find(key));
+  if (it != m_sizeGroupIdx.end()) {
+    return m_sizes[it->second];
   } else {
+    m_sizeGroupIdx.insert(std::make_pair(key, uint32_t(m_sizes.size())));
     m_sizes.emplace_back(size);
 
     return m_sizes.back();
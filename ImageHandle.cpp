@@ -0,0 +1,81 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ImageHandle.h"
+#include <mutex>
+#include "imageproc/Grayscale.h"
+
+using namespace imageproc;
+
+struct ImageHandle::Payload {
+  QImage orig;
+
+  /** Filled at most once, under grayOnce.  Immutable afterwards. */
+  mutable GrayImage gray;
+  mutable std::once_flag grayOnce;
+};
+
+ImageHandle::ImageHandle() = default;
+
+ImageHandle::ImageHandle(const QImage& image) {
+  if (image.isNull()) {
+    return;
+  }
+
+  auto payload = std::make_shared<Payload>();
+  payload->orig = image;
+  m_payload = std::move(payload);
+}
+
+ImageHandle::ImageHandle(const QImage& image, const GrayImage& gray) {
+  if (image.isNull()) {
+    return;
+  }
+
+  auto payload = std::make_shared<Payload>();
+  payload->orig = image;
+  payload->gray = gray;
+  m_payload = std::move(payload);
+}
+
+bool ImageHandle::isNull() const {
+  return !m_payload;
+}
+
+const QImage& ImageHandle::origImage() const {
+  static const QImage null_image;
+
+  return m_payload ? m_payload->orig : null_image;
+}
+
+const GrayImage& ImageHandle::grayImage() const {
+  static const GrayImage null_gray;
+  if (!m_payload) {
+    return null_gray;
+  }
+
+  // A pre-seeded grayscale version was stored before the payload
+  // became shared, so reading it here is safe.
+  std::call_once(m_payload->grayOnce, [this]() {
+    if (m_payload->gray.isNull()) {
+      m_payload->gray = GrayImage(toGrayscale(m_payload->orig));
+    }
+  });
+
+  return m_payload->gray;
+}
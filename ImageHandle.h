@@ -0,0 +1,73 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGEHANDLE_H_
+#define IMAGEHANDLE_H_
+
+#include <QImage>
+#include <memory>
+#include "imageproc/GrayImage.h"
+
+/**
+ * \brief A shared, immutable handle to a decoded image and its
+ *        grayscale version.
+ *
+ * QImage is implicitly shared, but any non-const access detaches it,
+ * so passing raw QImages between stage tasks invites accidental deep
+ * copies.  An ImageHandle only ever hands out const references to one
+ * shared payload, so however many FilterData copies and cache entries
+ * point at an image, there is exactly one pixel buffer.
+ *
+ * The grayscale version is converted lazily on first access and then
+ * cached in the payload, so it's computed at most once per decoded
+ * image no matter which stage asks first.  Safe to share between
+ * threads: handle copies only touch the reference count, and the lazy
+ * conversion is serialized internally.
+ */
+class ImageHandle {
+  // Member-wise copying is OK, and only bumps a reference count.
+ public:
+  /** Constructs a null handle. */
+  ImageHandle();
+
+  /** A null \p image produces a null handle. */
+  explicit ImageHandle(const QImage& image);
+
+  /**
+   * Constructs from an image whose grayscale version is already
+   * available, avoiding the conversion.
+   */
+  ImageHandle(const QImage& image, const imageproc::GrayImage& gray);
+
+  bool isNull() const;
+
+  const QImage& origImage() const;
+
+  /**
+   * \brief The grayscale version of origImage(), converting on first call.
+   */
+  const imageproc::GrayImage& grayImage() const;
+
+ private:
+  struct Payload;
+
+  std::shared_ptr<const Payload> m_payload;
+};
+
+
+#endif  // ifndef IMAGEHANDLE_H_
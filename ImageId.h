@@ -68,7 +68,7 @@ namespace std {
 template <>
 struct hash<ImageId> {
   size_t operator()(const ImageId& imageId) const noexcept {
-    return (hashes::hash<QString>()(imageId.filePath()) ^ hash<int>()(imageId.page()) << 1);
+    return hashes::combine(hashes::hash<QString>()(imageId.filePath()), hash<int>()(imageId.page()));
   }
 };
 }  // namespace std
@@ -19,11 +19,19 @@
 #include "ImageLoader.h"
 #include <QFile>
 #include <QImage>
+#include <QRect>
 #include <QtGui/QImageReader>
 #include "ImageId.h"
+#include "ImagePrefetcher.h"
 #include "TiffReader.h"
+#include "Tracer.h"
 
 QImage ImageLoader::load(const ImageId& image_id) {
+  QImage image(ImagePrefetcher::instance().take(image_id));
+  if (!image.isNull()) {
+    return image;
+  }
+
   return load(image_id.filePath(), image_id.zeroBasedPage());
 }
 
@@ -37,6 +45,8 @@ QImage ImageLoader::load(const QString& file_path, const int page_num) {
 }
 
 QImage ImageLoader::load(QIODevice& io_dev, const int page_num) {
+  TRACE_SCOPE("ImageLoader: load");
+
   if (TiffReader::canRead(io_dev)) {
     return TiffReader::readImage(io_dev, page_num);
   }
@@ -51,3 +61,59 @@ QImage ImageLoader::load(QIODevice& io_dev, const int page_num) {
 
   return image;
 }
+
+QImage ImageLoader::loadRect(const ImageId& image_id, const QRect& rect) {
+  TRACE_SCOPE("ImageLoader: load rect");
+
+  if (rect.isEmpty()) {
+    return load(image_id);
+  }
+
+  QFile file(image_id.filePath());
+  if (!file.open(QIODevice::ReadOnly)) {
+    return QImage();
+  }
+
+  if (TiffReader::canRead(file)) {
+    return TiffReader::readImageRect(file, image_id.zeroBasedPage(), rect);
+  }
+
+  if (image_id.zeroBasedPage() != 0) {
+    // Qt can only load the first page of multi-page images.
+    return QImage();
+  }
+
+  QImageReader reader(&file);
+  if (reader.supportsOption(QImageIOHandler::ClipRect)) {
+    // The JPEG handler implements this by skipping the rows outside
+    // the rectangle in the decoder.
+    reader.setClipRect(rect);
+    QImage image;
+    if (reader.read(&image)) {
+      return image;
+    }
+  }
+
+  // Fall back to a full decode followed by a crop.
+  const QImage image(load(image_id.filePath(), image_id.zeroBasedPage()));
+  if (image.isNull()) {
+    return QImage();
+  }
+
+  return image.copy(rect.intersected(image.rect()));
+}
+
+QImage ImageLoader::loadDownscaled(const ImageId& image_id, const QSize& max_size) {
+  TRACE_SCOPE("ImageLoader: load downscaled");
+
+  QFile file(image_id.filePath());
+  if (!file.open(QIODevice::ReadOnly)) {
+    return QImage();
+  }
+
+  if (TiffReader::canRead(file)) {
+    return TiffReader::readDownscaledImage(file, image_id.zeroBasedPage(), max_size);
+  }
+
+  return load(file, image_id.zeroBasedPage());
+}
@@ -21,7 +21,9 @@
 
 class ImageId;
 class QImage;
+class QRect;
 class QString;
+class QSize;
 class QIODevice;
 
 class ImageLoader {
@@ -31,6 +33,33 @@ class ImageLoader {
   static QImage load(const ImageId& image_id);
 
   static QImage load(QIODevice& io_dev, int page_num);
+
+  /**
+   * \brief Loads a reduced-resolution version of the image, if possible.
+   *
+   * For formats that support it (currently TIFF), the image is decoded
+   * in a streaming fashion directly into a size that fits \p max_size,
+   * avoiding a full-resolution intermediate.  For other formats the
+   * full-sized image is returned and the caller is expected to
+   * downscale it itself.
+   */
+  static QImage loadDownscaled(const ImageId& image_id, const QSize& max_size);
+
+  /**
+   * \brief Loads only the given rectangle of the image, if possible.
+   *
+   * For TIFF only the strips or tiles intersecting \p rect are decoded;
+   * for formats whose Qt handler supports clipped reads (notably JPEG)
+   * the rows outside the rectangle are skipped by the decoder.  Other
+   * formats fall back to a full decode followed by a crop, so the
+   * result is the same either way: an image of the size of \p rect
+   * clipped to the image boundaries.
+   *
+   * Note that the result lives in its own coordinate system starting
+   * at the top-left corner of \p rect.  Callers working in full-page
+   * coordinates must account for that offset themselves.
+   */
+  static QImage loadRect(const ImageId& image_id, const QRect& rect);
 };
 
 
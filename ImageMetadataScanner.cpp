@@ -0,0 +1,194 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ImageMetadataScanner.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <algorithm>
+
+namespace {
+const quint32 MAGIC = 0x53544d43;  // "STMC"
+const quint32 FORMAT_VERSION = 1;
+
+// The I/O is what's being overlapped here, not computation, so the
+// thread count is a small constant rather than the core count.
+const int MAX_SCAN_THREADS = 8;
+
+// Enough for several large projects.  Oldest entries get pruned first.
+const int MAX_CACHE_ENTRIES = 20000;
+}  // namespace
+
+ImageMetadataScanner::ImageMetadataScanner() : m_nextIndex(0), m_numDone(0), m_cancel(false) {}
+
+ImageMetadataScanner::~ImageMetadataScanner() {
+  m_cancel = true;
+  for (std::thread& thread : m_threads) {
+    thread.join();
+  }
+}
+
+void ImageMetadataScanner::start(std::vector<QString> file_paths) {
+  m_paths.swap(file_paths);
+  m_results.resize(m_paths.size());
+
+  // The cache is loaded up front and is read-only from here on,
+  // so the workers can consult it without locking.
+  loadCache();
+
+  const int num_threads = std::min<int>(MAX_SCAN_THREADS, static_cast<int>(m_paths.size()));
+  m_threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    m_threads.emplace_back(&ImageMetadataScanner::scanFiles, this);
+  }
+}
+
+std::vector<ImageMetadataScanner::Result> ImageMetadataScanner::finish() {
+  for (std::thread& thread : m_threads) {
+    thread.join();
+  }
+  m_threads.clear();
+
+  const qint64 now = QDateTime::currentMSecsSinceEpoch();
+  for (size_t i = 0; i < m_paths.size(); ++i) {
+    const Result& result = m_results[i];
+    if (result.status != ImageMetadataLoader::LOADED) {
+      continue;
+    }
+    const QFileInfo file_info(m_paths[i]);
+    CacheEntry& entry = m_cache[m_paths[i]];
+    entry.mtime = file_info.lastModified().toMSecsSinceEpoch();
+    entry.size = file_info.size();
+    entry.lastUsed = now;
+    entry.perPageMetadata = result.perPageMetadata;
+  }
+  saveCache();
+
+  return std::move(m_results);
+}
+
+void ImageMetadataScanner::scanFiles() {
+  while (!m_cancel) {
+    const size_t idx = m_nextIndex.fetch_add(1);
+    if (idx >= m_paths.size()) {
+      break;
+    }
+
+    const QString& path = m_paths[idx];
+    Result& result = m_results[idx];
+
+    const QFileInfo file_info(path);
+    const auto it(m_cache.constFind(path));
+    if ((it != m_cache.constEnd()) && (it->mtime == file_info.lastModified().toMSecsSinceEpoch())
+        && (it->size == file_info.size())) {
+      result.status = ImageMetadataLoader::LOADED;
+      result.perPageMetadata = it->perPageMetadata;
+    } else {
+      result.status = ImageMetadataLoader::load(
+          path, [&](const ImageMetadata& metadata) { result.perPageMetadata.push_back(metadata); });
+    }
+
+    ++m_numDone;
+  }
+}
+
+QString ImageMetadataScanner::cacheFilePath() {
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/image_metadata_cache";
+}
+
+void ImageMetadataScanner::loadCache() {
+  QFile file(cacheFilePath());
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  QDataStream strm(&file);
+  strm.setVersion(QDataStream::Qt_5_0);
+
+  quint32 magic = 0;
+  quint32 version = 0;
+  quint32 num_entries = 0;
+  strm >> magic >> version >> num_entries;
+  if ((strm.status() != QDataStream::Ok) || (magic != MAGIC) || (version != FORMAT_VERSION)) {
+    return;
+  }
+
+  for (quint32 i = 0; i < num_entries; ++i) {
+    QString path;
+    CacheEntry entry;
+    quint32 num_pages = 0;
+    strm >> path >> entry.mtime >> entry.size >> entry.lastUsed >> num_pages;
+    for (quint32 page = 0; page < num_pages; ++page) {
+      QSize size;
+      qint32 xdpi = 0;
+      qint32 ydpi = 0;
+      strm >> size >> xdpi >> ydpi;
+      entry.perPageMetadata.emplace_back(size, Dpi(xdpi, ydpi));
+    }
+    if (strm.status() != QDataStream::Ok) {
+      // A truncated or corrupted cache - drop what we can't trust.
+      m_cache.clear();
+
+      return;
+    }
+    m_cache.insert(path, entry);
+  }
+}
+
+void ImageMetadataScanner::saveCache() const {
+  QHash<QString, CacheEntry> cache(m_cache);
+  if (cache.size() > MAX_CACHE_ENTRIES) {
+    std::vector<qint64> timestamps;
+    timestamps.reserve(cache.size());
+    for (const CacheEntry& entry : cache) {
+      timestamps.push_back(entry.lastUsed);
+    }
+    std::nth_element(timestamps.begin(), timestamps.end() - MAX_CACHE_ENTRIES, timestamps.end());
+    const qint64 cutoff = *(timestamps.end() - MAX_CACHE_ENTRIES);
+
+    for (auto it = cache.begin(); it != cache.end();) {
+      if (it->lastUsed < cutoff) {
+        it = cache.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  const QFileInfo file_info(cacheFilePath());
+  QDir().mkpath(file_info.absolutePath());
+
+  QFile file(file_info.absoluteFilePath());
+  if (!file.open(QIODevice::WriteOnly)) {
+    return;
+  }
+
+  QDataStream strm(&file);
+  strm.setVersion(QDataStream::Qt_5_0);
+  strm << MAGIC << FORMAT_VERSION << (quint32) cache.size();
+
+  for (auto it = cache.constBegin(); it != cache.constEnd(); ++it) {
+    strm << it.key() << it->mtime << it->size << it->lastUsed << (quint32) it->perPageMetadata.size();
+    for (const ImageMetadata& metadata : it->perPageMetadata) {
+      strm << metadata.size() << (qint32) metadata.dpi().horizontal() << (qint32) metadata.dpi().vertical();
+    }
+  }
+}
@@ -0,0 +1,111 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGEMETADATASCANNER_H_
+#define IMAGEMETADATASCANNER_H_
+
+#include <QHash>
+#include <QString>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "ImageMetadata.h"
+#include "ImageMetadataLoader.h"
+#include "NonCopyable.h"
+
+/**
+ * \brief Reads image metadata for a batch of files using a few
+ *        background threads.
+ *
+ * Reading metadata is I/O bound - a stat plus a header read per file -
+ * so running a handful of reads concurrently mostly serves to overlap
+ * network round trips on remote filesystems.  Results that were read
+ * successfully are also kept in a small on-disk cache keyed by
+ * (path, mtime, size), which makes re-scanning a directory that was
+ * already scanned nearly free.
+ *
+ * start(), the polling methods and finish() are meant to be called
+ * from a single thread, typically the GUI thread.
+ */
+class ImageMetadataScanner {
+  DECLARE_NON_COPYABLE(ImageMetadataScanner)
+
+ public:
+  struct Result {
+    ImageMetadataLoader::Status status;
+    std::vector<ImageMetadata> perPageMetadata;
+
+    Result() : status(ImageMetadataLoader::GENERIC_ERROR) {}
+  };
+
+  ImageMetadataScanner();
+
+  /**
+   * Cancels and joins the workers if the scan wasn't finish()ed.
+   */
+  ~ImageMetadataScanner();
+
+  /**
+   * \brief Starts scanning the given files in the background.
+   *
+   * May only be called once per instance.
+   */
+  void start(std::vector<QString> file_paths);
+
+  /**
+   * The number of files processed so far, for progress indication.
+   */
+  size_t numProcessed() const { return m_numDone; }
+
+  bool isFinished() const { return m_numDone == m_paths.size(); }
+
+  /**
+   * \brief Waits for the scan to complete and returns the results,
+   *        one per input file, in input order.
+   *
+   * Also folds the fresh results into the on-disk cache.
+   */
+  std::vector<Result> finish();
+
+ private:
+  struct CacheEntry {
+    qint64 mtime;
+    qint64 size;
+    qint64 lastUsed;
+    std::vector<ImageMetadata> perPageMetadata;
+  };
+
+  static QString cacheFilePath();
+
+  void loadCache();
+
+  void saveCache() const;
+
+  void scanFiles();
+
+  std::vector<QString> m_paths;
+  std::vector<Result> m_results;
+  QHash<QString, CacheEntry> m_cache;  // Read-only while the workers run.
+  std::vector<std::thread> m_threads;
+  std::atomic<size_t> m_nextIndex;
+  std::atomic<size_t> m_numDone;
+  std::atomic<bool> m_cancel;
+};
+
+
+#endif  // ifndef IMAGEMETADATASCANNER_H_
@@ -0,0 +1,146 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ImagePrefetcher.h"
+#include <algorithm>
+#include "ImageLoader.h"
+#include "MemoryBudgetManager.h"
+
+ImagePrefetcher& ImagePrefetcher::instance() {
+  static ImagePrefetcher the_instance;
+
+  return the_instance;
+}
+
+ImagePrefetcher::ImagePrefetcher() {
+  // Prefetched pages are pure speculation and the cheapest thing
+  // to give up under memory pressure.
+  MemoryBudgetManager::instance().registerEvictable(MemoryBudgetManager::PREFETCHED_PAGES,
+                                                    []() { ImagePrefetcher::instance().cancelAll(); });
+}
+
+ImagePrefetcher::~ImagePrefetcher() {
+  {
+    const std::lock_guard<std::mutex> guard(m_mutex);
+    m_shutdown = true;
+  }
+  m_cond.notify_all();
+  if (m_threadStarted) {
+    m_thread.join();
+  }
+}
+
+void ImagePrefetcher::prefetch(const ImageId& image_id) {
+  if (image_id.isNull()) {
+    return;
+  }
+
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  if (m_shutdown || (image_id == m_inProgress) || (m_cache.find(image_id) != m_cache.end())
+      || (std::find(m_queue.begin(), m_queue.end(), image_id) != m_queue.end())) {
+    return;
+  }
+
+  m_queue.push_back(image_id);
+  if (!m_threadStarted) {
+    m_thread = std::thread(&ImagePrefetcher::backgroundThread, this);
+    m_threadStarted = true;
+  }
+  m_cond.notify_all();
+}
+
+QImage ImagePrefetcher::take(const ImageId& image_id) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  // If the image is on the background thread's plate right now,
+  // waiting for it is cheaper than decoding it a second time.
+  m_cond.wait(lock, [this, &image_id] { return !(image_id == m_inProgress); });
+
+  const auto it(m_cache.find(image_id));
+  if (it == m_cache.end()) {
+    return QImage();
+  }
+
+  const QImage image(it->second);
+  m_cachedBytes -= imageBytes(image);
+  m_cache.erase(it);
+  m_cond.notify_all();
+
+  return image;
+}
+
+void ImagePrefetcher::cancel(const ImageId& image_id) {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  const auto queue_it(std::find(m_queue.begin(), m_queue.end(), image_id));
+  if (queue_it != m_queue.end()) {
+    m_queue.erase(queue_it);
+  }
+
+  const auto cache_it(m_cache.find(image_id));
+  if (cache_it != m_cache.end()) {
+    m_cachedBytes -= imageBytes(cache_it->second);
+    m_cache.erase(cache_it);
+  }
+
+  m_cond.notify_all();
+}
+
+void ImagePrefetcher::cancelAll() {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+  m_queue.clear();
+  m_cache.clear();
+  m_cachedBytes = 0;
+  m_cond.notify_all();
+}
+
+void ImagePrefetcher::backgroundThread() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while (true) {
+    m_cond.wait(lock, [this] {
+      return m_shutdown
+             || (!m_queue.empty() && (m_cache.size() < MAX_CACHED_IMAGES) && (m_cachedBytes < MAX_CACHED_BYTES));
+    });
+    if (m_shutdown) {
+      return;
+    }
+
+    m_inProgress = m_queue.front();
+    m_queue.pop_front();
+    const ImageId image_id(m_inProgress);
+
+    lock.unlock();
+    // Deliberately not ImageLoader::load(ImageId), which would consult
+    // this very prefetcher.
+    const QImage image(ImageLoader::load(image_id.filePath(), image_id.zeroBasedPage()));
+    lock.lock();
+
+    if (!image.isNull() && !m_shutdown) {
+      m_cachedBytes += imageBytes(image);
+      m_cache[image_id] = image;
+    }
+    m_inProgress = ImageId();
+    m_cond.notify_all();
+  }
+}
+
+size_t ImagePrefetcher::imageBytes(const QImage& image) {
+  return (size_t) image.bytesPerLine() * image.height();
+}
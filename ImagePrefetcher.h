@@ -0,0 +1,99 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGEPREFETCHER_H_
+#define IMAGEPREFETCHER_H_
+
+#include <QImage>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "ImageId.h"
+#include "NonCopyable.h"
+
+/**
+ * \brief Decodes images on a background thread ahead of need.
+ *
+ * The task queue announces which pages it is going to process next,
+ * and the prefetcher decodes them into a bounded cache, so that by the
+ * time their tasks start, ImageLoader::load() finds the pixels already
+ * in memory instead of paying the full disk + decode latency.
+ */
+class ImagePrefetcher {
+  DECLARE_NON_COPYABLE(ImagePrefetcher)
+
+ public:
+  static ImagePrefetcher& instance();
+
+  /**
+   * \brief Schedules an image for background decoding.
+   *
+   * Does nothing if the image is already queued, being decoded or
+   * cached.  Images are decoded in the order they were scheduled.
+   */
+  void prefetch(const ImageId& image_id);
+
+  /**
+   * \brief Returns the prefetched image and drops it from the cache.
+   *
+   * If the image is being decoded right now, waits for it to finish.
+   * Returns a null image if the image was never scheduled or has been
+   * cancelled.
+   */
+  QImage take(const ImageId& image_id);
+
+  /**
+   * \brief Drops the given image from the queue and the cache.
+   */
+  void cancel(const ImageId& image_id);
+
+  /**
+   * \brief Drops all queued and cached images.
+   */
+  void cancelAll();
+
+ private:
+  ImagePrefetcher();
+
+  ~ImagePrefetcher();
+
+  void backgroundThread();
+
+  static size_t imageBytes(const QImage& image);
+
+  /** At most this many decoded pages are kept ahead of need. */
+  static const size_t MAX_CACHED_IMAGES = 3;
+
+  /** The cache never grows past this many bytes of pixel data. */
+  static const size_t MAX_CACHED_BYTES = size_t(512) * 1024 * 1024;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::deque<ImageId> m_queue;
+  std::map<ImageId, QImage> m_cache;
+  size_t m_cachedBytes = 0;
+  ImageId m_inProgress;
+  std::thread m_thread;
+  bool m_threadStarted = false;
+  bool m_shutdown = false;
+};
+
+
+#endif  // ifndef IMAGEPREFETCHER_H_
@@ -7,12 +7,12 @@
 using namespace imageproc;
 
 void ImageSettings::clear() {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   m_perPageParams.clear();
 }
 
 void ImageSettings::performRelinking(const AbstractRelinker& relinker) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   PerPageParams newParams;
   for (const auto& kv : m_perPageParams) {
     const RelinkablePath oldPath(kv.first.imageId().filePath(), RelinkablePath::File);
@@ -25,12 +25,12 @@ void ImageSettings::performRelinking(const AbstractRelinker& relinker) {
 }
 
 void ImageSettings::setPageParams(const PageId& page_id, const PageParams& params) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   Utils::mapSetValue(m_perPageParams, page_id, params);
 }
 
 std::unique_ptr<ImageSettings::PageParams> ImageSettings::getPageParams(const PageId& page_id) const {
-  QMutexLocker locker(&m_mutex);
+  QReadLocker locker(&m_rwLock);
   const auto it(m_perPageParams.find(page_id));
   if (it != m_perPageParams.end()) {
     return std::make_unique<PageParams>(it->second);
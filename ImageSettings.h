@@ -5,7 +5,7 @@
 #include <foundation/NonCopyable.h>
 #include <foundation/ref_countable.h>
 #include <imageproc/BinaryThreshold.h>
-#include <QtCore/QMutex>
+#include <QtCore/QReadWriteLock>
 #include <QtXml/QDomDocument>
 #include <memory>
 #include <unordered_map>
@@ -54,7 +54,7 @@ class ImageSettings : public ref_countable {
  private:
   typedef std::unordered_map<PageId, PageParams> PerPageParams;
 
-  mutable QMutex m_mutex;
+  mutable QReadWriteLock m_rwLock;
   PerPageParams m_perPageParams;
 };
 
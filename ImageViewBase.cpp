@@ -40,7 +40,9 @@
 
 using namespace imageproc;
 
-class ImageViewBase::HqTransformTask : public AbstractCommand<intrusive_ptr<AbstractCommand<void>>>, public QObject {
+class ImageViewBase::HqTransformTask : public AbstractCommand<intrusive_ptr<AbstractCommand<void>>>,
+                                       public BackgroundExecutor::Cancellable,
+                                       public QObject {
   DECLARE_NON_COPYABLE(HqTransformTask)
 
  public:
@@ -48,7 +50,7 @@ class ImageViewBase::HqTransformTask : public AbstractCommand<intrusive_ptr<Abst
 
   void cancel() { m_result->cancel(); }
 
-  const bool isCancelled() const { return m_result->isCancelled(); }
+  bool isCancelled() const override { return m_result->isCancelled(); }
 
   intrusive_ptr<AbstractCommand<void>> operator()() override;
 
@@ -80,6 +82,51 @@ class ImageViewBase::HqTransformTask : public AbstractCommand<intrusive_ptr<Abst
 };
 
 
+/**
+ * \brief Builds the tile cache's downscale pyramid off the GUI thread.
+ *
+ * Until the levels arrive, ImageViewTileCache::draw() declines zoomed-out
+ * requests and paintEvent() falls back to scaling m_pixmap, so showing
+ * a freshly constructed view doesn't block on downscaling.
+ */
+class ImageViewBase::PyramidBuildTask : public AbstractCommand<intrusive_ptr<AbstractCommand<void>>>,
+                                        public BackgroundExecutor::Cancellable {
+  DECLARE_NON_COPYABLE(PyramidBuildTask)
+
+ public:
+  PyramidBuildTask(ImageViewBase* image_view, const QImage& image);
+
+  void cancel() { m_result->cancel(); }
+
+  bool isCancelled() const override { return m_result->isCancelled(); }
+
+  intrusive_ptr<AbstractCommand<void>> operator()() override;
+
+ private:
+  class Result : public AbstractCommand<void> {
+   public:
+    explicit Result(ImageViewBase* image_view);
+
+    void setData(std::vector<QImage> levels);
+
+    void cancel() { m_cancelFlag.fetchAndStoreRelaxed(1); }
+
+    bool isCancelled() const { return m_cancelFlag.fetchAndAddRelaxed(0) != 0; }
+
+    void operator()() override;
+
+   private:
+    QPointer<ImageViewBase> m_imageView;
+    std::vector<QImage> m_levels;
+    mutable QAtomicInt m_cancelFlag;
+  };
+
+
+  intrusive_ptr<Result> m_result;
+  QImage m_image;
+};
+
+
 /**
  * \brief Temporarily adjust the widget focal point, then change it back.
  *
@@ -128,6 +175,7 @@ ImageViewBase::ImageViewBase(const QImage& image,
                              const ImagePresentation& presentation,
                              const Margins& margins)
     : m_image(image),
+      m_tileCache(image),
       m_virtualImageCropArea(presentation.cropArea()),
       m_virtualDisplayArea(presentation.displayArea()),
       m_imageToVirtual(presentation.transform()),
@@ -214,9 +262,19 @@ ImageViewBase::ImageViewBase(const QImage& image,
   connect(verticalScrollBar(), SIGNAL(sliderReleased()), SLOT(updateScrollBars()));
   connect(horizontalScrollBar(), SIGNAL(valueChanged(int)), SLOT(reactToScrollBars()));
   connect(verticalScrollBar(), SIGNAL(valueChanged(int)), SLOT(reactToScrollBars()));
+
+  // Kick off building the downscale pyramid for the tile cache.
+  // PREFETCH: it's only needed once the user starts zooming out.
+  const auto pyramid_task = make_intrusive<PyramidBuildTask>(this, m_image);
+  backgroundExecutor().enqueueTask(pyramid_task, BackgroundExecutor::PREFETCH);
+  m_pyramidBuildTask = pyramid_task;
 }
 
-ImageViewBase::~ImageViewBase() = default;
+ImageViewBase::~ImageViewBase() {
+  if (m_pyramidBuildTask) {
+    m_pyramidBuildTask->cancel();
+  }
+}
 
 void ImageViewBase::hqTransformSetEnabled(const bool enabled) {
   if (!enabled && m_hqTransformEnabled) {
@@ -409,7 +467,9 @@ void ImageViewBase::paintEvent(QPaintEvent* event) {
   QPainter painter(viewport());
 
   // Fill the background as Qt::WA_OpaquePaintEvent attribute is enabled.
-  painter.fillRect(viewport()->rect(), palette().color(backgroundRole()));
+  // Only the damaged part: for a bounded update (hover feedback and
+  // the like) the rest of the viewport is untouched.
+  painter.fillRect(event->rect(), palette().color(backgroundRole()));
 
   painter.save();
 
@@ -418,13 +478,21 @@ void ImageViewBase::paintEvent(QPaintEvent* event) {
   // Width of a source pixel in mm, as it's displayed on screen.
   const double pixel_width = widthMM() * xscale / width();
 
+  // With an OpenGL viewport the painter composites through the GPU:
+  // the tile pixmaps are cached as textures after their first frame
+  // (each tile is far below any GL texture size limit) and zoom, pan
+  // and rotation come down to sampling them under a transform.
+  const QPaintEngine::Type engine_type = painter.paintEngine()->type();
+  const bool gpu_compositing = (engine_type == QPaintEngine::OpenGL) || (engine_type == QPaintEngine::OpenGL2);
+
   // Make clipping smooth.
   painter.setRenderHint(QPainter::Antialiasing, true);
 
-  // Disable antialiasing for large zoom levels.
-  painter.setRenderHint(QPainter::SmoothPixmapTransform, pixel_width < 0.5);
+  // Disable antialiasing for large zoom levels, unless the GPU
+  // does the filtering anyway.
+  painter.setRenderHint(QPainter::SmoothPixmapTransform, gpu_compositing || (pixel_width < 0.5));
 
-  if (validateHqPixmap()) {
+  if (!gpu_compositing && validateHqPixmap()) {
     // HQ pixmap maps one to one to screen pixels, so antialiasing is not necessary.
     painter.setRenderHint(QPainter::SmoothPixmapTransform, false);
 
@@ -434,16 +502,21 @@ void ImageViewBase::paintEvent(QPaintEvent* event) {
 
     painter.drawPixmap(m_hqPixmapPos, m_hqPixmap);
   } else {
-    scheduleHqVersionRebuild();
-
-    const QTransform pixmap_to_virtual(m_pixmapToImage * m_imageToVirtual);
-    painter.setWorldTransform(pixmap_to_virtual * m_virtualToWidget);
+    if (!gpu_compositing) {
+      // The software re-transform is only worth a CPU core when the
+      // painter can't do filtered scaling on the GPU.
+      scheduleHqVersionRebuild();
+    }
 
     QPainterPath clip_path;
-    clip_path.addPolygon(pixmap_to_virtual.inverted().map(m_virtualImageCropArea));
+    clip_path.addPolygon(m_virtualToWidget.map(m_virtualImageCropArea));
     painter.setClipPath(clip_path);
 
-    PixmapRenderer::drawPixmap(painter, m_pixmap);
+    if (!m_tileCache.draw(painter, m_imageToVirtual * m_virtualToWidget, event->rect())) {
+      const QTransform pixmap_to_virtual(m_pixmapToImage * m_imageToVirtual);
+      painter.setWorldTransform(pixmap_to_virtual * m_virtualToWidget);
+      PixmapRenderer::drawPixmap(painter, m_pixmap);
+    }
   }
 
   painter.restore();
@@ -967,6 +1040,15 @@ void ImageViewBase::hqVersionBuilt(const QPoint& origin, const QImage& image) {
   update();
 }
 
+/**
+ * Gets called from PyramidBuildTask::Result.
+ */
+void ImageViewBase::tilePyramidBuilt(std::vector<QImage> levels) {
+  m_tileCache.setLevels(std::move(levels));
+  m_pyramidBuildTask.reset();
+  update();
+}
+
 void ImageViewBase::updateStatusTipAndCursor() {
   updateStatusTip();
   updateCursor();
@@ -982,8 +1064,14 @@ void ImageViewBase::updateCursor() {
 
 void ImageViewBase::maybeQueueRedraw() {
   if (m_interactionState.redrawRequested()) {
+    const QRectF damage(m_interactionState.redrawArea());
     m_interactionState.setRedrawRequested(false);
-    update();
+    if (damage.isNull()) {
+      update();
+    } else {
+      // One extra pixel on each side covers antialiased edges.
+      viewport()->update(damage.toAlignedRect().adjusted(-1, -1, 1, 1));
+    }
   }
 }
 
@@ -1042,6 +1130,35 @@ intrusive_ptr<AbstractCommand<void>> ImageViewBase::HqTransformTask::operator()(
   return m_result;
 }
 
+/*==================== ImageViewBase::PyramidBuildTask =====================*/
+
+ImageViewBase::PyramidBuildTask::PyramidBuildTask(ImageViewBase* image_view, const QImage& image)
+    : m_result(new Result(image_view)), m_image(image) {}
+
+intrusive_ptr<AbstractCommand<void>> ImageViewBase::PyramidBuildTask::operator()() {
+  if (isCancelled()) {
+    return nullptr;
+  }
+
+  m_result->setData(ImageViewTileCache::buildLevels(m_image));
+
+  return m_result;
+}
+
+/*================ ImageViewBase::PyramidBuildTask::Result ================*/
+
+ImageViewBase::PyramidBuildTask::Result::Result(ImageViewBase* image_view) : m_imageView(image_view) {}
+
+void ImageViewBase::PyramidBuildTask::Result::setData(std::vector<QImage> levels) {
+  m_levels = std::move(levels);
+}
+
+void ImageViewBase::PyramidBuildTask::Result::operator()() {
+  if (m_imageView && !isCancelled()) {
+    m_imageView->tilePyramidBuilt(std::move(m_levels));
+  }
+}
+
 /*================ ImageViewBase::HqTransformTask::Result ================*/
 
 ImageViewBase::HqTransformTask::Result::Result(ImageViewBase* image_view) : m_imageView(image_view) {}
@@ -33,6 +33,7 @@
 #include <Qt>
 #include "ImagePixmapUnion.h"
 #include "ImageViewInfoProvider.h"
+#include "ImageViewTileCache.h"
 #include "InteractionHandler.h"
 #include "InteractionState.h"
 #include "Margins.h"
@@ -280,6 +281,7 @@ class ImageViewBase : public QAbstractScrollArea {
 
  private:
   class HqTransformTask;
+  class PyramidBuildTask;
   class TempFocalPointAdjuster;
 
   class TransformChangeWatcher;
@@ -306,6 +308,8 @@ class ImageViewBase : public QAbstractScrollArea {
 
   void hqVersionBuilt(const QPoint& origin, const QImage& image);
 
+  void tilePyramidBuilt(std::vector<QImage> levels);
+
   void updateStatusTipAndCursor();
 
   void updateStatusTip();
@@ -336,6 +340,13 @@ class ImageViewBase : public QAbstractScrollArea {
    */
   QPixmap m_pixmap;
 
+  /**
+   * Serves repaints during pan / zoom from lazily rendered tiles of
+   * power-of-two downscales of m_image, so that interaction doesn't
+   * rescale the whole page on every frame.
+   */
+  ImageViewTileCache m_tileCache;
+
   /**
    * The high quality, pre-transformed version of m_pixmap.
    */
@@ -369,6 +380,12 @@ class ImageViewBase : public QAbstractScrollArea {
    */
   intrusive_ptr<HqTransformTask> m_hqTransformTask;
 
+  /**
+   * The pending (if any) background task building the downscale
+   * pyramid for m_tileCache.
+   */
+  intrusive_ptr<PyramidBuildTask> m_pyramidBuildTask;
+
   /**
    * Transformation from m_pixmap coordinates to m_image coordinates.
    */
@@ -0,0 +1,150 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ImageViewTileCache.h"
+#include <QPainter>
+#include <QTransform>
+#include <cmath>
+
+ImageViewTileCache::ImageViewTileCache(const QImage& image) {
+  if (!image.isNull()) {
+    m_levels.push_back(image);
+  }
+}
+
+bool ImageViewTileCache::draw(QPainter& painter, const QTransform& image_to_widget, const QRect& viewport_rect) {
+  if (m_levels.empty()) {
+    return false;
+  }
+
+  const int level = selectLevel(image_to_widget);
+  if (level >= (int) m_levels.size()) {
+    // The pyramid hasn't been built (or delivered) yet.
+    return false;
+  }
+  const QImage& level_img = m_levels[level];
+
+  QTransform level_to_image;
+  level_to_image.scale((double) m_levels.front().width() / level_img.width(),
+                       (double) m_levels.front().height() / level_img.height());
+  const QTransform level_to_widget(level_to_image * image_to_widget);
+
+  // The tile range covering the visible part of this level.
+  const QRectF visible(level_to_widget.inverted().mapRect(QRectF(viewport_rect)).intersected(QRectF(level_img.rect())));
+  if (visible.isEmpty()) {
+    return true;
+  }
+
+  const int tx_first = (int) std::floor(visible.left()) / TILE_SIZE;
+  const int ty_first = (int) std::floor(visible.top()) / TILE_SIZE;
+  const int tx_last = ((int) std::ceil(visible.right()) - 1) / TILE_SIZE;
+  const int ty_last = ((int) std::ceil(visible.bottom()) - 1) / TILE_SIZE;
+
+  painter.save();
+  painter.setWorldTransform(level_to_widget);
+
+  for (int ty = ty_first; ty <= ty_last; ++ty) {
+    for (int tx = tx_first; tx <= tx_last; ++tx) {
+      painter.drawPixmap(QPointF(tx * TILE_SIZE, ty * TILE_SIZE), tilePixmap(level, tx, ty));
+    }
+  }
+
+  painter.restore();
+
+  return true;
+}  // ImageViewTileCache::draw
+
+int ImageViewTileCache::selectLevel(const QTransform& image_to_widget) const {
+  // The number of screen pixels a source pixel maps to.  Using the
+  // determinant keeps this meaningful under rotation.
+  const double scale = std::sqrt(std::fabs(image_to_widget.determinant()));
+
+  int level = 0;
+  while ((level + 1 < MAX_LEVELS) && (scale * (1 << level) <= 0.5)) {
+    const QImage& cur = m_levels.front();
+    if ((std::min(cur.width(), cur.height()) >> (level + 1)) < TILE_SIZE) {
+      break;
+    }
+    ++level;
+  }
+
+  return level;
+}
+
+std::vector<QImage> ImageViewTileCache::buildLevels(const QImage& image) {
+  std::vector<QImage> levels;
+  if (image.isNull()) {
+    return levels;
+  }
+
+  levels.push_back(image);
+
+  const int min_dimension = std::min(image.width(), image.height());
+  while (((int) levels.size() < MAX_LEVELS) && ((min_dimension >> (int) levels.size()) >= TILE_SIZE)) {
+    const QImage& prev = levels.back();
+    const int w = std::max(1, (prev.width() + 1) / 2);
+    const int h = std::max(1, (prev.height() + 1) / 2);
+    // Halving the previous level rather than the source makes building
+    // the whole chain cost little more than a single halving.
+    levels.push_back(prev.scaled(w, h, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+  }
+
+  return levels;
+}
+
+void ImageViewTileCache::setLevels(std::vector<QImage> levels) {
+  if (m_levels.empty() || levels.empty()) {
+    return;
+  }
+  if (levels.front().cacheKey() != m_levels.front().cacheKey()) {
+    // Built from some other image.
+    return;
+  }
+
+  // Level 0 tiles, if any, were cut from the same image and stay valid.
+  m_levels = std::move(levels);
+}
+
+const QPixmap& ImageViewTileCache::tilePixmap(const int level, const int tx, const int ty) {
+  const quint64 key = tileKey(level, tx, ty);
+
+  const auto map_it(m_tileMap.find(key));
+  if (map_it != m_tileMap.end()) {
+    // Move the tile to the front of the LRU.
+    m_tileLru.splice(m_tileLru.begin(), m_tileLru, map_it.value());
+
+    return m_tileLru.front().second;
+  }
+
+  const QImage& level_img = m_levels[level];
+  const QRect tile_rect(QRect(tx * TILE_SIZE, ty * TILE_SIZE, TILE_SIZE, TILE_SIZE).intersected(level_img.rect()));
+
+  m_tileLru.emplace_front(key, QPixmap::fromImage(level_img.copy(tile_rect)));
+  m_tileMap.insert(key, m_tileLru.begin());
+
+  while (m_tileMap.size() > MAX_CACHED_TILES) {
+    m_tileMap.remove(m_tileLru.back().first);
+    m_tileLru.pop_back();
+  }
+
+  return m_tileLru.front().second;
+}
+
+quint64 ImageViewTileCache::tileKey(const int level, const int tx, const int ty) {
+  return ((quint64) level << 56) | ((quint64) (quint32) tx << 28) | (quint64) (quint32) ty;
+}
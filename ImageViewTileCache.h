@@ -0,0 +1,120 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGEVIEWTILECACHE_H_
+#define IMAGEVIEWTILECACHE_H_
+
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+#include <list>
+#include <utility>
+#include <vector>
+#include "NonCopyable.h"
+
+class QPainter;
+class QRect;
+class QTransform;
+
+/**
+ * \brief A tiled level-of-detail cache behind ImageViewBase::paintEvent().
+ *
+ * Repainting during pan / zoom used to rescale a single big pixmap of
+ * the whole page every time, which at 600 dpi output means smoothly
+ * scaling a huge image on every frame.  This class keeps a pyramid of
+ * power-of-two downscales of the source image (each level halved from
+ * the previous one) and serves the screen from fixed-size tiles cut out
+ * of the level nearest to the current zoom.  Tiles are rendered on
+ * first use and kept in an LRU, so panning and zooming only ever
+ * touches the handful of tiles that are actually visible.  With an
+ * OpenGL viewport the tiles double as textures: the GL paint engine
+ * caches each pixmap on the GPU, so a tile is uploaded once and then
+ * merely re-sampled under the current transform.
+ *
+ * The pyramid levels are built by buildLevels(), which the owning view
+ * runs in a background thread, and installed with setLevels().  Until
+ * they arrive, draw() declines requests that would need a missing
+ * level, letting the caller fall back to its non-tiled code path.
+ *
+ * Except for buildLevels(), to be used from the GUI thread only.
+ */
+class ImageViewTileCache {
+  DECLARE_NON_COPYABLE(ImageViewTileCache)
+
+ public:
+  explicit ImageViewTileCache(const QImage& image);
+
+  /**
+   * \brief Draws the visible part of the image through \p painter.
+   *
+   * \param painter The painter to draw with.  The clip set on it is
+   *        respected; the world transform is overwritten.
+   * \param image_to_widget Maps source image coordinates to widget ones.
+   * \param viewport_rect The widget area being repainted.
+   *
+   * Returns false (drawing nothing) if the cache holds no image or
+   * the downscale level appropriate for this zoom isn't built yet.
+   */
+  bool draw(QPainter& painter, const QTransform& image_to_widget, const QRect& viewport_rect);
+
+  /**
+   * \brief Builds the full downscale pyramid for the given image.
+   *
+   * [0] is the source image itself.  Doesn't touch any shared state,
+   * so it's safe to call from a background thread.
+   */
+  static std::vector<QImage> buildLevels(const QImage& image);
+
+  /**
+   * \brief Installs a pyramid built by buildLevels().
+   *
+   * Ignored unless \p levels was built from the image this cache
+   * was constructed with.
+   */
+  void setLevels(std::vector<QImage> levels);
+
+ private:
+  enum {
+    TILE_SIZE = 256,
+
+    /** The deepest pyramid level, giving a 1:32 downscale. */
+    MAX_LEVELS = 6,
+
+    /** Roughly 64 MB of RGB32 tiles. */
+    MAX_CACHED_TILES = 256
+  };
+
+  int selectLevel(const QTransform& image_to_widget) const;
+
+  const QPixmap& tilePixmap(int level, int tx, int ty);
+
+  static quint64 tileKey(int level, int tx, int ty);
+
+  typedef std::list<std::pair<quint64, QPixmap>> TileLru;
+
+  /** [0] is the source image; deeper levels arrive via setLevels(). */
+  std::vector<QImage> m_levels;
+
+  /** Most recently used tiles are at the front. */
+  TileLru m_tileLru;
+
+  QHash<quint64, TileLru::iterator> m_tileMap;
+};
+
+
+#endif  // ifndef IMAGEVIEWTILECACHE_H_
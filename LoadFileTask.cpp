@@ -21,12 +21,14 @@
 #include <QFile>
 #include <QTextDocument>
 #include "AbstractFilter.h"
+#include "DecodedImageCache.h"
 #include "Dpm.h"
 #include "ErrorWidget.h"
 #include "FilterData.h"
 #include "FilterOptionsWidget.h"
 #include "FilterUiInterface.h"
 #include "ImageLoader.h"
+#include "PageTimingRegistry.h"
 #include "ProjectPages.h"
 #include "ThumbnailPixmapCache.h"
 #include "filters/fix_orientation/Task.h"
@@ -55,6 +57,7 @@ LoadFileTask::LoadFileTask(Type type,
                            intrusive_ptr<fix_orientation::Task> next_task)
     : BackgroundTask(type),
       m_thumbnailCache(std::move(thumbnail_cache)),
+      m_pageId(page.id()),
       m_imageId(page.imageId()),
       m_imageMetadata(page.metadata()),
       m_pages(std::move(pages)),
@@ -65,7 +68,14 @@ LoadFileTask::LoadFileTask(Type type,
 LoadFileTask::~LoadFileTask() = default;
 
 FilterResultPtr LoadFileTask::operator()() {
-  QImage image(ImageLoader::load(m_imageId));
+  // Records decode time only: the nested filter stages time themselves.
+  const PageTimingRegistry::StageScope timing_scope(m_pageId, "load");
+
+  ImageHandle image(DecodedImageCache::instance().fetch(m_imageId));
+  const bool from_cache = !image.isNull();
+  if (!from_cache) {
+    image = ImageHandle(ImageLoader::load(m_imageId));
+  }
 
   try {
     throwIfCancelled();
@@ -73,10 +83,17 @@ FilterResultPtr LoadFileTask::operator()() {
     if (image.isNull()) {
       return make_intrusive<ErrorResult>(m_imageId.filePath());
     } else {
-      updateImageSizeIfChanged(image);
-      overrideDpi(image);
-      m_thumbnailCache->ensureThumbnailExists(m_imageId, image);
+      updateImageSizeIfChanged(image.origImage());
+      image = withDpiOverridden(image);
+      m_thumbnailCache->ensureThumbnailExists(m_imageId, image.origImage());
+
+      if (!from_cache) {
+        DecodedImageCache::instance().insert(m_imageId, image);
+      }
 
+      // The handle is shared with the cache entry and every stage
+      // task downstream, so the grayscale version that the first
+      // stage needing it converts is reused by all of them.
       return m_nextTask->process(*this, FilterData(image));
     }
   } catch (const CancelledException&) {
@@ -99,12 +116,23 @@ void LoadFileTask::updateImageSizeIfChanged(const QImage& image) {
   }
 }
 
-void LoadFileTask::overrideDpi(QImage& image) const {
+ImageHandle LoadFileTask::withDpiOverridden(const ImageHandle& image) const {
   // Beware: QImage will have a default DPI when loading
   // an image that doesn't specify one.
   const Dpm dpm(m_imageMetadata.dpi());
-  image.setDotsPerMeterX(dpm.horizontal());
-  image.setDotsPerMeterY(dpm.vertical());
+  const QImage& orig = image.origImage();
+  if ((orig.dotsPerMeterX() == dpm.horizontal()) && (orig.dotsPerMeterY() == dpm.vertical())) {
+    // The common case: fresh decodes carry the project DPI already
+    // or get it fixed below once, after which the handle is cached
+    // and comes back here with matching values.
+    return image;
+  }
+
+  QImage adjusted(orig);
+  adjusted.setDotsPerMeterX(dpm.horizontal());
+  adjusted.setDotsPerMeterY(dpm.vertical());
+
+  return ImageHandle(adjusted, image.grayImage());
 }
 
 /*======================= LoadFileTask::ErrorResult ======================*/
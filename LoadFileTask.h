@@ -21,9 +21,11 @@
 
 #include "BackgroundTask.h"
 #include "FilterResult.h"
+#include "ImageHandle.h"
 #include "ImageId.h"
 #include "ImageMetadata.h"
 #include "NonCopyable.h"
+#include "PageId.h"
 #include "intrusive_ptr.h"
 
 class ThumbnailPixmapCache;
@@ -54,9 +56,10 @@ class LoadFileTask : public BackgroundTask {
 
   void updateImageSizeIfChanged(const QImage& image);
 
-  void overrideDpi(QImage& image) const;
+  ImageHandle withDpiOverridden(const ImageHandle& image) const;
 
   intrusive_ptr<ThumbnailPixmapCache> m_thumbnailCache;
+  PageId m_pageId;
   ImageId m_imageId;
   ImageMetadata m_imageMetadata;
   const intrusive_ptr<ProjectPages> m_pages;
@@ -30,6 +30,7 @@
 #include "Application.h"
 #include "AutoRemovingFile.h"
 #include "BasicImageView.h"
+#include "borrowed_ptr.h"
 #include "CommandLine.h"
 #include "ContentBoxPropagator.h"
 #include "DebugImageView.h"
@@ -54,6 +55,7 @@
 #include "ProjectOpeningContext.h"
 #include "ProjectPages.h"
 #include "ProjectReader.h"
+#include "ProjectSidecar.h"
 #include "ProjectWriter.h"
 #include "RecentProjects.h"
 #include "RelinkingDialog.h"
@@ -65,6 +67,7 @@
 #include "SystemLoadWidget.h"
 #include "TabbedDebugImages.h"
 #include "ThumbnailFactory.h"
+#include "Tracer.h"
 #include "UnitsProvider.h"
 #include "Utils.h"
 #include "WorkerThreadPool.h"
@@ -73,6 +76,7 @@
 #include "filters/fix_orientation/CacheDrivenTask.h"
 #include "filters/fix_orientation/Task.h"
 #include "filters/output/CacheDrivenTask.h"
+#include "filters/output/OutputWriteQueue.h"
 #include "filters/output/TabbedImageView.h"
 #include "filters/output/Task.h"
 #include "filters/page_layout/CacheDrivenTask.h"
@@ -253,6 +257,8 @@ MainWindow::MainWindow()
 
   connect(m_workerThreadPool.get(), SIGNAL(taskResult(const BackgroundTaskPtr&, const FilterResultPtr&)), this,
           SLOT(filterResult(const BackgroundTaskPtr&, const FilterResultPtr&)));
+  connect(m_workerThreadPool.get(), SIGNAL(taskIntermediateResult(const BackgroundTaskPtr&, const FilterResultPtr&)),
+          this, SLOT(filterIntermediateResult(const BackgroundTaskPtr&, const FilterResultPtr&)));
 
   connect(m_thumbSequence.get(),
           SIGNAL(newSelectionLeader(const PageInfo&, const QRectF&, ThumbnailSequence::SelectionFlags)), this,
@@ -341,6 +347,8 @@ void MainWindow::switchToNewProject(const intrusive_ptr<ProjectPages>& pages,
   }
   m_pages = pages;
   m_projectFile = project_file_path;
+  // The cached save document belongs to the previous project.
+  m_projectSaveCache = ProjectWriter::SaveCache();
 
   if (project_reader) {
     m_selectedPage = project_reader->selectedPage();
@@ -379,7 +387,8 @@ void MainWindow::switchToNewProject(const intrusive_ptr<ProjectPages>& pages,
   updateSortOptions();
 
   m_contentBoxPropagator = std::make_unique<ContentBoxPropagator>(
-      m_stages->pageLayoutFilter(), createCompositeCacheDrivenTask(m_stages->selectContentFilterIdx()));
+      m_stages->selectContentFilter(), m_stages->pageLayoutFilter(),
+      createCompositeCacheDrivenTask(m_stages->selectContentFilterIdx()));
 
   m_pageOrientationPropagator = std::make_unique<PageOrientationPropagator>(
       m_stages->pageSplitFilter(), createCompositeCacheDrivenTask(m_stages->fixOrientationFilterIdx()));
@@ -393,6 +402,21 @@ void MainWindow::switchToNewProject(const intrusive_ptr<ProjectPages>& pages,
   }
   resetThumbSequence(currentPageOrderProvider());
 
+  if (m_thumbnailCache) {
+    // Fill the on-disk thumbnail store ahead of scrolling, so that the
+    // first pass through a fresh project doesn't pay a full-image
+    // decode for every row.  The sweep only runs when no on-screen
+    // thumbnail is waiting to be loaded.
+    std::vector<ImageId> image_ids;
+    for (const PageInfo& page : m_thumbSequence->toPageSequence()) {
+      // Sub-pages of the same image share a thumbnail.
+      if (image_ids.empty() || (image_ids.back() != page.imageId())) {
+        image_ids.push_back(page.imageId());
+      }
+    }
+    m_thumbnailCache->schedulePregeneration(image_ids);
+  }
+
   removeFilterOptionsWidget();
   updateProjectActions();
   updateWindowTitle();
@@ -566,7 +590,7 @@ intrusive_ptr<const PageOrderProvider> MainWindow::currentPageOrderProvider() co
     return nullptr;
   }
 
-  const intrusive_ptr<AbstractFilter> filter(m_stages->filterAt(m_curFilter));
+  const borrowed_ptr<AbstractFilter> filter(m_stages->filterAt(m_curFilter));
 
   return filter->pageOrderOptions()[idx].provider();
 }
@@ -574,7 +598,7 @@ intrusive_ptr<const PageOrderProvider> MainWindow::currentPageOrderProvider() co
 void MainWindow::updateSortOptions() {
   const ScopedIncDec<int> guard(m_ignorePageOrderingChanges);
 
-  const intrusive_ptr<AbstractFilter> filter(m_stages->filterAt(m_curFilter));
+  const borrowed_ptr<AbstractFilter> filter(m_stages->filterAt(m_curFilter));
 
   sortOptions->clear();
 
@@ -875,7 +899,10 @@ void MainWindow::currentPageChanged(const PageInfo& page_info,
 
   if (flags & ThumbnailSequence::SELECTED_BY_USER) {
     if (isBatchProcessingInProgress()) {
-      stopBatchProcessing();
+      // Rather than stopping the batch (the Stop button does that),
+      // pull the clicked page to the front of the queue, so its result
+      // shows up without waiting for the sweep to reach it.
+      m_batchQueue->prioritize(page_info.id());
     } else if (!(flags & ThumbnailSequence::REDUNDANT_SELECTION)) {
       // Start loading / processing the newly selected page.
       updateMainArea();
@@ -898,7 +925,14 @@ void MainWindow::autoSaveProject() {
     return;
   }
 
-  saveProjectWithFeedback(m_projectFile);
+  ProjectWriter writer(m_pages, m_selectedPage, m_outFileNameGen);
+
+  // Re-using the document of the previous save keeps autosaving cheap
+  // on large projects: only the records of the pages that actually
+  // changed get regenerated.
+  if (!writer.writeIncremental(m_projectFile, m_stages->filters(), m_projectSaveCache)) {
+    QMessageBox::warning(this, tr("Error"), tr("Error saving the project file!"));
+  }
 }
 
 void MainWindow::pageContextMenuRequested(const PageInfo& page_info_, const QPoint& screen_pos, bool selected) {
@@ -1095,6 +1129,7 @@ void MainWindow::startBatchProcessing() {
   }
 
   m_interactiveQueue->cancelAndClear();
+  cancelSpeculativeTask();
 
   m_batchQueue.reset(new ProcessingTaskQueue);
   PageInfo page(m_thumbSequence->selectionLeader());
@@ -1144,6 +1179,11 @@ void MainWindow::stopBatchProcessing(MainAreaAction main_area) {
   m_batchQueue->cancelAndClear();
   m_batchQueue.reset();
 
+  // Wait for the output files still queued on the I/O thread, so the
+  // batch is really done when the UI says it is.  The queue is bounded,
+  // so this waits for a few pages at most.
+  output::OutputWriteQueue::instance().waitForPendingWrites();
+
   filterList->setBatchProcessingInProgress(false);
   filterList->setEnabled(true);
 
@@ -1160,12 +1200,29 @@ void MainWindow::stopBatchProcessing(MainAreaAction main_area) {
 }
 
 void MainWindow::filterResult(const BackgroundTaskPtr& task, const FilterResultPtr& result) {
+  // Runs on the GUI thread; if this span dominates the trace between a
+  // page's dispatch and the next one, the workers are waiting on us.
+  TRACE_SCOPE("MainWindow: filterResult");
+
   // Cancelled or not, we must mark it as finished.
   m_interactiveQueue->processingFinished(task);
   if (m_batchQueue) {
     m_batchQueue->processingFinished(task);
   }
 
+  if (task == m_speculativeTask) {
+    // The results, if any, were stored into the filter settings on the
+    // worker thread; there is nothing to show until the operator
+    // actually advances to that stage.  Never let a speculative result
+    // reach the filter-switching logic below.
+    m_speculativeTask.reset();
+    if (!task->isCancelled() && !isBatchProcessingInProgress()) {
+      launchSpeculativeTask();
+    }
+
+    return;
+  }
+
   if (task->isCancelled()) {
     return;
   }
@@ -1228,9 +1285,75 @@ void MainWindow::filterResult(const BackgroundTaskPtr& task, const FilterResultP
     if (!page.isNull()) {
       m_thumbSequence->setSelection(page.id());
     }
+  } else {
+    // The page under review is on screen and the workers are idle:
+    // a good moment to precompute the next stage for it.
+    launchSpeculativeTask();
   }
 }  // MainWindow::filterResult
 
+/**
+ * Runs the next stage for the currently selected page in the
+ * background, storing its results into the filter settings the same
+ * way batch processing would.  When the operator then advances the
+ * stage tab, the interactive task finds fresh params whose
+ * dependencies match and skips the heavy analysis, making the switch
+ * nearly instant.  If any parameter changes in between, the stored
+ * dependencies no longer match and the results are recomputed as
+ * usual, so a stale speculation costs nothing but the wasted cycles.
+ *
+ * The output stage is never speculated, as it writes output files.
+ * Speculation only starts when the worker pool has threads idle, so
+ * it never delays interactive work; at most one speculative task is
+ * in flight at a time.
+ */
+void MainWindow::launchSpeculativeTask() {
+  if (isBatchProcessingInProgress() || m_speculativeTask) {
+    return;
+  }
+
+  const int next_filter = m_curFilter + 1;
+  if (next_filter >= m_stages->outputFilterIdx()) {
+    return;
+  }
+
+  if (!m_workerThreadPool->hasSpareCapacity()) {
+    return;
+  }
+
+  const PageInfo page(m_thumbSequence->selectionLeader());
+  if (page.isNull()) {
+    return;
+  }
+
+  m_speculativeTask = createCompositeTask(page, next_filter, /*batch=*/true, /*debug=*/false);
+  m_workerThreadPool->submitTask(m_speculativeTask);
+}
+
+void MainWindow::cancelSpeculativeTask() {
+  if (m_speculativeTask) {
+    // Keep the pointer until the task reports back through
+    // filterResult(), so its result is still recognized and dropped
+    // even if it managed to finish before the cancellation landed.
+    m_speculativeTask->cancel();
+  }
+}
+
+void MainWindow::filterIntermediateResult(const BackgroundTaskPtr& task, const FilterResultPtr& result) {
+  // The task is still running, so unlike filterResult() we neither mark
+  // it as finished nor schedule anything else.
+  if (task->isCancelled() || isBatchProcessingInProgress()) {
+    return;
+  }
+
+  if (result->filter() != m_stages->filterAt(m_curFilter)) {
+    // A preview is only of interest while its filter is the current one.
+    return;
+  }
+
+  result->updateUI(this);
+}
+
 void MainWindow::debugToggled(const bool enabled) {
   m_debug = enabled;
 }
@@ -1354,23 +1477,24 @@ void MainWindow::openProject() {
 }
 
 void MainWindow::openProject(const QString& project_file) {
-  QFile file(project_file);
-  if (!file.open(QIODevice::ReadOnly)) {
-    QMessageBox::warning(this, tr("Error"), tr("Unable to open the project file."));
-
-    return;
-  }
+  ProjectOpeningContext* context = nullptr;
 
   QDomDocument doc;
-  if (!doc.setContent(&file)) {
-    QMessageBox::warning(this, tr("Error"), tr("The project file is broken."));
-
-    return;
-  }
+  // A fresh binary sidecar saves us parsing the XML.
+  if (ProjectSidecar::read(project_file, doc)) {
+    context = new ProjectOpeningContext(this, project_file, doc);
+  } else {
+    QFile file(project_file);
+    if (!file.open(QIODevice::ReadOnly)) {
+      QMessageBox::warning(this, tr("Error"), tr("Unable to open the project file."));
 
-  file.close();
+      return;
+    }
+    file.close();
 
-  ProjectOpeningContext* context = new ProjectOpeningContext(this, project_file, doc);
+    // The streaming parse never builds a DOM of the whole file.
+    context = new ProjectOpeningContext(this, project_file);
+  }
   connect(context, SIGNAL(done(ProjectOpeningContext*)), SLOT(projectOpened(ProjectOpeningContext*)));
   context->proceed();
 }
@@ -1559,6 +1683,7 @@ void MainWindow::loadPageInteractive(const PageInfo& page) {
   assert(!isBatchProcessingInProgress());
 
   m_interactiveQueue->cancelAndClear();
+  cancelSpeculativeTask();
 
   if (isOutputFilter() && !checkReadyForOutput(&page.id())) {
     filterList->setBatchProcessingPossible(false);
@@ -1644,6 +1769,7 @@ bool MainWindow::closeProjectInteractive() {
   if (!writer.write(backup_file_path, m_stages->filters())) {
     // Backup file could not be written???
     QFile::remove(backup_file_path);
+    QFile::remove(ProjectSidecar::sidecarPath(backup_file_path));
     switch (promptProjectSave()) {
       case SAVE:
         saveProjectTriggered();
@@ -1661,6 +1787,7 @@ bool MainWindow::closeProjectInteractive() {
   if (compareFiles(m_projectFile, backup_file_path)) {
     // The project hasn't really changed.
     QFile::remove(backup_file_path);
+    QFile::remove(ProjectSidecar::sidecarPath(backup_file_path));
     closeProjectWithoutSaving();
 
     return true;
@@ -1673,9 +1800,13 @@ bool MainWindow::closeProjectInteractive() {
 
         return false;
       }
+      // Bring the sidecar along, so the next open stays fast.
+      Utils::overwritingRename(ProjectSidecar::sidecarPath(backup_file_path),
+                               ProjectSidecar::sidecarPath(m_projectFile));
       // fall through
     case DONT_SAVE:
       QFile::remove(backup_file_path);
+      QFile::remove(ProjectSidecar::sidecarPath(backup_file_path));
       break;
     case CANCEL:
       return false;
@@ -1692,9 +1823,13 @@ void MainWindow::closeProjectWithoutSaving() {
 }
 
 bool MainWindow::saveProjectWithFeedback(const QString& project_file) {
+  // Output records are committed by the I/O thread once their files
+  // are on disk - don't save a project that misses the last few pages.
+  output::OutputWriteQueue::instance().waitForPendingWrites();
+
   ProjectWriter writer(m_pages, m_selectedPage, m_outFileNameGen);
 
-  if (!writer.write(project_file, m_stages->filters())) {
+  if (!writer.write(project_file, m_stages->filters(), &m_projectSaveCache)) {
     QMessageBox::warning(this, tr("Error"), tr("Error saving the project file!"));
 
     return false;
@@ -39,6 +39,7 @@
 #include "PageId.h"
 #include "PageRange.h"
 #include "PageView.h"
+#include "ProjectWriter.h"
 #include "SelectedPage.h"
 #include "StatusBarPanel.h"
 #include "ThumbnailSequence.h"
@@ -167,6 +168,8 @@ class MainWindow : public QMainWindow, private FilterUiInterface, private Ui::Ma
 
   void filterResult(const BackgroundTaskPtr& task, const FilterResultPtr& result);
 
+  void filterIntermediateResult(const BackgroundTaskPtr& task, const FilterResultPtr& result);
+
   void debugToggled(bool enabled);
 
   void fixDpiDialogRequested();
@@ -285,6 +288,10 @@ class MainWindow : public QMainWindow, private FilterUiInterface, private Ui::Ma
 
   BackgroundTaskPtr createCompositeTask(const PageInfo& page, int last_filter_idx, bool batch, bool debug);
 
+  void launchSpeculativeTask();
+
+  void cancelSpeculativeTask();
+
   intrusive_ptr<CompositeCacheDrivenTask> createCompositeCacheDrivenTask(int last_filter_idx);
 
   void createBatchProcessingWidget();
@@ -311,6 +318,13 @@ class MainWindow : public QMainWindow, private FilterUiInterface, private Ui::Ma
   std::unique_ptr<WorkerThreadPool> m_workerThreadPool;
   std::unique_ptr<ProcessingTaskQueue> m_batchQueue;
   std::unique_ptr<ProcessingTaskQueue> m_interactiveQueue;
+
+  /**
+   * A low-priority run of the next stage for the page under review,
+   * so that advancing the stage tab finds its results precomputed.
+   * Null when no speculation is in flight.  \see launchSpeculativeTask()
+   */
+  BackgroundTaskPtr m_speculativeTask;
   QStackedLayout* m_imageFrameLayout;
   QStackedLayout* m_optionsFrameLayout;
   QPointer<FilterOptionsWidget> m_optionsWidget;
@@ -332,6 +346,7 @@ class MainWindow : public QMainWindow, private FilterUiInterface, private Ui::Ma
   bool m_closing;
   QTimer m_autoSaveTimer;
   bool m_autoSaveProject;
+  ProjectWriter::SaveCache m_projectSaveCache;
   std::unique_ptr<StatusBarPanel> m_statusBarPanel;
   std::unique_ptr<QActionGroup> m_unitsMenuActionGroup;
   QTimer m_maxLogicalThumbSizeUpdater;
@@ -13,5 +13,21 @@ bool OrderByDeviationProvider::precedes(const PageId& lhs_page,
     return lhs_incomplete;
   }
 
-  return (m_deviationProvider->getDeviationValue(lhs_page) > m_deviationProvider->getDeviationValue(rhs_page));
+  return deviationValue(lhs_page) > deviationValue(rhs_page);
+}
+
+void OrderByDeviationProvider::invalidateCachedKeys() const {
+  m_cachedKeys.clear();
+}
+
+double OrderByDeviationProvider::deviationValue(const PageId& page) const {
+  const auto it(m_cachedKeys.find(page));
+  if (it != m_cachedKeys.end()) {
+    return it->second;
+  }
+
+  const double value = m_deviationProvider->getDeviationValue(page);
+  m_cachedKeys.insert(std::make_pair(page, value));
+
+  return value;
 }
@@ -4,6 +4,7 @@
 
 
 #include "DeviationProvider.h"
+#include "FlatHashMap.h"
 #include "PageId.h"
 #include "PageOrderProvider.h"
 
@@ -16,8 +17,13 @@ class OrderByDeviationProvider : public PageOrderProvider {
                 const PageId& rhs_page,
                 bool rhs_incomplete) const override;
 
+  void invalidateCachedKeys() const override;
+
  private:
+  double deviationValue(const PageId& page) const;
+
   const DeviationProvider<PageId>* m_deviationProvider;
+  mutable FlatHashMap<PageId, double> m_cachedKeys;
 };
 
 
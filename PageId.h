@@ -73,7 +73,7 @@ namespace std {
 template <>
 struct hash<PageId> {
   size_t operator()(const PageId& pageId) const noexcept {
-    return (hash<ImageId>()(pageId.imageId()) ^ hash<int>()(pageId.subPage()) << 1);
+    return hashes::combine(hash<ImageId>()(pageId.imageId()), hash<int>()(pageId.subPage()));
   }
 };
 }  // namespace std
@@ -37,6 +37,16 @@ class PageOrderProvider : public ref_countable {
                         bool lhs_incomplete,
                         const PageId& rhs_page,
                         bool rhs_incomplete) const = 0;
+
+  /**
+   * \brief Called right before a full reordering.
+   *
+   * Implementations whose ordering keys are expensive to derive
+   * (settings lookups behind a mutex, typically) cache them per page
+   * and drop the cache here, so a fresh sort sees fresh settings.
+   * The default does nothing.
+   */
+  virtual void invalidateCachedKeys() const {}
 };
 
 
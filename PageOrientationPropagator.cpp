@@ -19,9 +19,11 @@
 #include "PageOrientationPropagator.h"
 
 #include <utility>
+#include <vector>
 #include "CompositeCacheDrivenTask.h"
 #include "OrthogonalRotation.h"
 #include "PageSequence.h"
+#include "ParallelFor.h"
 #include "ProjectPages.h"
 #include "filter_dc/PageOrientationCollector.h"
 #include "filters/page_split/Filter.h"
@@ -45,10 +47,18 @@ PageOrientationPropagator::~PageOrientationPropagator() = default;
 
 void PageOrientationPropagator::propagate(const ProjectPages& pages) {
   const PageSequence sequence(pages.toPageSequence(PAGE_VIEW));
+  const auto num_pages = static_cast<int>(sequence.numPages());
 
-  for (const PageInfo& page_info : sequence) {
-    Collector collector;
-    m_task->process(page_info, &collector);
-    m_pageSplitFilter->pageOrientationUpdate(page_info.imageId(), collector.orientation());
+  // Same as in ContentBoxPropagator: collect in parallel, commit
+  // everything to the "Split Pages" stage serially afterwards.
+  std::vector<Collector> collectors(num_pages);
+  parallelForChunked(0, num_pages, [&](const int chunk_begin, const int chunk_end) {
+    for (int i = chunk_begin; i < chunk_end; ++i) {
+      m_task->process(sequence.pageAt(i), &collectors[i]);
+    }
+  });
+
+  for (int i = 0; i < num_pages; ++i) {
+    m_pageSplitFilter->pageOrientationUpdate(sequence.pageAt(i).imageId(), collectors[i].orientation());
   }
 }
@@ -17,8 +17,10 @@
  */
 
 #include "PageSequence.h"
+#include <cassert>
 
 void PageSequence::append(const PageInfo& page_info) {
+  m_pageNoById.insert(std::make_pair(page_info.id(), m_pages.size()));
   m_pages.push_back(page_info);
 }
 
@@ -27,20 +29,16 @@ const PageInfo& PageSequence::pageAt(const size_t idx) const {
 }
 
 const PageInfo& PageSequence::pageAt(const PageId page) const {
-  auto it(m_pages.begin());
-  const auto end(m_pages.end());
-  for (; it != end && it->id() != page; ++it) {
-  }
-  return *it;
+  const auto it(m_pageNoById.find(page));
+  assert(it != m_pageNoById.end());
+
+  return m_pages[it->second];
 }
 
 int PageSequence::pageNo(const PageId& page) const {
-  auto it(m_pages.begin());
-  const auto end(m_pages.end());
-  int res = 0;
-  for (; it != end && it->id() != page; ++it, ++res) {
-  }
-  return (it == end) ? -1 : res;
+  const auto it(m_pageNoById.find(page));
+
+  return (it == m_pageNoById.end()) ? -1 : static_cast<int>(it->second);
 }
 
 std::set<PageId> PageSequence::selectAll() const {
@@ -56,12 +54,11 @@ std::set<PageId> PageSequence::selectAll() const {
 std::set<PageId> PageSequence::selectPagePlusFollowers(const PageId& page) const {
   std::set<PageId> selection;
 
-  auto it(m_pages.begin());
-  const auto end(m_pages.end());
-  for (; it != end && it->id() != page; ++it) {
-    // Continue until we have a match.
+  const auto idx_it(m_pageNoById.find(page));
+  if (idx_it == m_pageNoById.end()) {
+    return selection;
   }
-  for (; it != end; ++it) {
+  for (auto it = m_pages.begin() + idx_it->second; it != m_pages.end(); ++it) {
     selection.insert(it->id());
   }
 
@@ -71,16 +68,12 @@ std::set<PageId> PageSequence::selectPagePlusFollowers(const PageId& page) const
 std::set<PageId> PageSequence::selectEveryOther(const PageId& base) const {
   std::set<PageId> selection;
 
-  auto it(m_pages.begin());
-  const auto end(m_pages.end());
-  for (; it != end && it->id() != base; ++it) {
-    // Continue until we have a match.
-  }
-  if (it == end) {
+  const auto idx_it(m_pageNoById.find(base));
+  if (idx_it == m_pageNoById.end()) {
     return selection;
   }
 
-  const int base_idx = static_cast<const int>(it - m_pages.begin());
+  const int base_idx = static_cast<int>(idx_it->second);
   int idx = 0;
   for (const PageInfo& page_info : m_pages) {
     if (((idx - base_idx) & 1) == 0) {
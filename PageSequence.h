@@ -22,6 +22,7 @@
 #include <cstddef>
 #include <set>
 #include <vector>
+#include "FlatHashMap.h"
 #include "PageInfo.h"
 
 class PageSequence {
@@ -53,6 +54,7 @@ class PageSequence {
 
  private:
   std::vector<PageInfo> m_pages;
+  FlatHashMap<PageId, size_t> m_pageNoById;  // Pages are only ever appended.
 };
 
 
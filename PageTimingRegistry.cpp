@@ -0,0 +1,147 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PageTimingRegistry.h"
+
+#include <algorithm>
+
+#include "MemoryBudgetManager.h"
+
+namespace {
+// The innermost active scope of the current thread.  A task chain runs
+// entirely on one thread, so this is how a scope finds its parent to
+// report the time the parent should not count as its own.
+thread_local PageTimingRegistry::StageScope* current_scope = nullptr;
+}  // namespace
+
+double PageTimingRegistry::PageBreakdown::totalSec() const {
+  double total = 0;
+  for (const auto& kv : stageSec) {
+    total += kv.second;
+  }
+
+  return total;
+}
+
+size_t PageTimingRegistry::PageBreakdown::peakBytes() const {
+  size_t peak = 0;
+  for (const auto& kv : stagePeakBytes) {
+    peak = std::max(peak, kv.second);
+  }
+
+  return peak;
+}
+
+PageTimingRegistry::StageScope::StageScope(const PageId& page_id, const char* stage_name)
+    : m_pageId(page_id),
+      m_stageName(stage_name),
+      m_start(std::chrono::steady_clock::now()),
+      m_nestedSec(0),
+      m_savedPeakBytes(MemoryBudgetManager::exchangeThreadPeak(MemoryBudgetManager::threadLiveBytes())),
+      m_parent(current_scope) {
+  current_scope = this;
+}
+
+PageTimingRegistry::StageScope::~StageScope() {
+  const double elapsed_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+  if (m_parent) {
+    m_parent->m_nestedSec += elapsed_sec;
+  }
+  current_scope = m_parent;
+
+  // Unlike times, a memory peak naturally includes the nested stages:
+  // their buffers are live while this stage is on the call stack.
+  const size_t peak_bytes = MemoryBudgetManager::threadPeakBytes();
+  MemoryBudgetManager::exchangeThreadPeak(std::max(m_savedPeakBytes, peak_bytes));
+
+  PageTimingRegistry::instance().addSample(m_pageId, m_stageName, elapsed_sec - m_nestedSec, peak_bytes);
+}
+
+PageTimingRegistry& PageTimingRegistry::instance() {
+  static PageTimingRegistry the_instance;
+
+  return the_instance;
+}
+
+PageTimingRegistry::PageBreakdown PageTimingRegistry::breakdownFor(const PageId& page_id) const {
+  PageBreakdown breakdown;
+  breakdown.pageId = page_id;
+
+  const std::lock_guard<std::mutex> guard(m_mutex);
+  const auto it = m_stats.find(page_id);
+  if (it != m_stats.end()) {
+    for (const auto& kv : it->second) {
+      breakdown.stageSec[kv.first] = kv.second.seconds;
+      breakdown.stagePeakBytes[kv.first] = kv.second.peakBytes;
+    }
+  }
+
+  return breakdown;
+}
+
+std::vector<PageTimingRegistry::PageBreakdown> PageTimingRegistry::slowestPages(const size_t max_pages) const {
+  std::vector<PageBreakdown> breakdowns;
+  {
+    const std::lock_guard<std::mutex> guard(m_mutex);
+    breakdowns.reserve(m_stats.size());
+    for (const auto& page_kv : m_stats) {
+      PageBreakdown breakdown;
+      breakdown.pageId = page_kv.first;
+      for (const auto& kv : page_kv.second) {
+        breakdown.stageSec[kv.first] = kv.second.seconds;
+        breakdown.stagePeakBytes[kv.first] = kv.second.peakBytes;
+      }
+      breakdowns.push_back(breakdown);
+    }
+  }
+
+  std::sort(breakdowns.begin(), breakdowns.end(),
+            [](const PageBreakdown& lhs, const PageBreakdown& rhs) { return lhs.totalSec() > rhs.totalSec(); });
+  if (breakdowns.size() > max_pages) {
+    breakdowns.resize(max_pages);
+  }
+
+  return breakdowns;
+}
+
+std::map<std::string, size_t> PageTimingRegistry::maxStagePeaks() const {
+  std::map<std::string, size_t> peaks;
+
+  const std::lock_guard<std::mutex> guard(m_mutex);
+  for (const auto& page_kv : m_stats) {
+    for (const auto& kv : page_kv.second) {
+      size_t& peak = peaks[kv.first];
+      peak = std::max(peak, kv.second.peakBytes);
+    }
+  }
+
+  return peaks;
+}
+
+void PageTimingRegistry::clear() {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+  m_stats.clear();
+}
+
+void PageTimingRegistry::addSample(const PageId& page_id, const char* stage_name, const double seconds,
+                                   const size_t peak_bytes) {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+  StageStats& stats = m_stats[page_id][stage_name];
+  stats.seconds += seconds;
+  stats.peakBytes = std::max(stats.peakBytes, peak_bytes);
+}
@@ -0,0 +1,123 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PAGE_TIMING_REGISTRY_H_
+#define PAGE_TIMING_REGISTRY_H_
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "NonCopyable.h"
+#include "PageId.h"
+
+/**
+ * \brief Accumulates per-page, per-stage processing times and memory peaks.
+ *
+ * Each filter's Task::process() opens a StageScope, which records the
+ * time spent in that stage for that page.  The tasks form a chain, with
+ * each stage invoking the next one from within its process(), so a
+ * scope only records its own time, not the time of the nested stages.
+ * Times accumulate across runs of the same stage on the same page;
+ * memory peaks keep the maximum.  The peaks come from the thread-local
+ * accounting in MemoryBudgetManager, fed by the BinaryImage, GrayImage
+ * and Grid allocations of the thread running the task chain.
+ *
+ * The registry feeds the per-page breakdown in the status bar and the
+ * slowest-pages summary printed at the end of a ConsoleBatch run.
+ * Unlike Tracer, which captures a full timeline for offline analysis,
+ * this is an always-on aggregate cheap enough to keep in production.
+ */
+class PageTimingRegistry {
+  DECLARE_NON_COPYABLE(PageTimingRegistry)
+
+ public:
+  /** The accumulated figures of one page, keyed by stage name. */
+  struct PageBreakdown {
+    PageId pageId;
+    std::map<std::string, double> stageSec;
+    std::map<std::string, size_t> stagePeakBytes;
+
+    double totalSec() const;
+
+    /** The highest per-stage memory peak of this page. */
+    size_t peakBytes() const;
+  };
+
+  /**
+   * \brief Records the time from construction to destruction for a page
+   *        and stage, excluding the time of scopes nested within it,
+   *        along with the peak of tracked image memory over that span.
+   *
+   * \p stage_name must outlive the scope, so pass a string literal.
+   */
+  class StageScope {
+    DECLARE_NON_COPYABLE(StageScope)
+
+   public:
+    StageScope(const PageId& page_id, const char* stage_name);
+
+    ~StageScope();
+
+   private:
+    PageId m_pageId;
+    const char* m_stageName;
+    std::chrono::steady_clock::time_point m_start;
+    double m_nestedSec;
+    size_t m_savedPeakBytes;
+    StageScope* m_parent;
+  };
+
+
+  static PageTimingRegistry& instance();
+
+  /** Returns the breakdown for a page, empty if it wasn't processed yet. */
+  PageBreakdown breakdownFor(const PageId& page_id) const;
+
+  /**
+   * Returns up to \p max_pages breakdowns, the pages with the highest
+   * total time first.
+   */
+  std::vector<PageBreakdown> slowestPages(size_t max_pages) const;
+
+  /**
+   * Returns the highest per-page memory peak of each stage, which is
+   * what sizing a machine for a batch of similar pages needs.
+   */
+  std::map<std::string, size_t> maxStagePeaks() const;
+
+  void clear();
+
+ private:
+  PageTimingRegistry() = default;
+
+  struct StageStats {
+    double seconds = 0;
+    size_t peakBytes = 0;
+  };
+
+  void addSample(const PageId& page_id, const char* stage_name, double seconds, size_t peak_bytes);
+
+  mutable std::mutex m_mutex;
+  std::map<PageId, std::map<std::string, StageStats>> m_stats;
+};
+
+
+#endif  // ifndef PAGE_TIMING_REGISTRY_H_
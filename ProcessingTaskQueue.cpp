@@ -17,6 +17,22 @@
  */
 
 #include "ProcessingTaskQueue.h"
+#include <QFileInfo>
+#include <iterator>
+#include "ImagePrefetcher.h"
+#include "Tracer.h"
+
+/** How many upcoming pages are decoded ahead of need. */
+static const int PREFETCH_DEPTH = 3;
+
+namespace {
+/** A short identification of the page for scheduling trace events. */
+std::string traceArg(const PageInfo& page_info) {
+  const PageId& page_id = page_info.id();
+
+  return (QFileInfo(page_id.imageId().filePath()).fileName() + ' ' + page_id.subPageAsString()).toStdString();
+}
+}  // namespace
 
 ProcessingTaskQueue::Entry::Entry(const PageInfo& page_info, const BackgroundTaskPtr& tsk)
     : pageInfo(page_info), task(tsk), takenForProcessing(false) {}
@@ -26,13 +42,23 @@ ProcessingTaskQueue::ProcessingTaskQueue() = default;
 void ProcessingTaskQueue::addProcessingTask(const PageInfo& page_info, const BackgroundTaskPtr& task) {
   m_queue.emplace_back(page_info, task);
   m_pageToSelectWhenDone = PageInfo();
+
+  if (Tracer::instance().isRecording()) {
+    Tracer::instance().recordInstant("queue: enqueue", traceArg(page_info));
+    Tracer::instance().recordCounter("queue depth", m_queue.size());
+  }
 }
 
 BackgroundTaskPtr ProcessingTaskQueue::takeForProcessing() {
-  for (Entry& ent : m_queue) {
+  for (auto it(m_queue.begin()); it != m_queue.end(); ++it) {
+    Entry& ent = *it;
     if (!ent.takenForProcessing) {
       ent.takenForProcessing = true;
 
+      if (Tracer::instance().isRecording()) {
+        Tracer::instance().recordInstant("queue: dispatch", traceArg(ent.pageInfo));
+      }
+
       if (m_selectedPage.isNull()) {
         // In this mode we select the most recently submitted for processing page.
         // This means question marks on selected pages, but at least this avoids
@@ -40,10 +66,27 @@ BackgroundTaskPtr ProcessingTaskQueue::takeForProcessing() {
         m_selectedPage = ent.pageInfo;
       }
 
+      // Let the prefetcher decode the pages following this one, so
+      // their tasks find the pixels already in memory.
+      int prefetched = 0;
+      for (auto next_it(std::next(it)); (next_it != m_queue.end()) && (prefetched < PREFETCH_DEPTH); ++next_it) {
+        if (!next_it->takenForProcessing) {
+          ImagePrefetcher::instance().prefetch(next_it->pageInfo.id().imageId());
+          ++prefetched;
+        }
+      }
+
       return ent.task;
     }
   }
 
+  // A worker asked for a task and got none.  A burst of these while the
+  // queue is still non-empty means the pipeline is stalled on the tasks
+  // already taken, not on a lack of workers.
+  if (Tracer::instance().isRecording()) {
+    Tracer::instance().recordInstant("queue: starved", std::to_string(m_queue.size()) + " pages pending");
+  }
+
   return nullptr;
 }
 
@@ -68,6 +111,11 @@ void ProcessingTaskQueue::processingFinished(const BackgroundTaskPtr& task) {
   }
 
 
+  if (Tracer::instance().isRecording()) {
+    Tracer::instance().recordInstant("queue: complete", traceArg(it->pageInfo));
+    Tracer::instance().recordCounter("queue depth", m_queue.size() - 1);
+  }
+
   const bool removing_selected_page = (m_selectedPage.id() == it->pageInfo.id());
 
   auto next_it(it);
@@ -88,6 +136,27 @@ void ProcessingTaskQueue::processingFinished(const BackgroundTaskPtr& task) {
   }
 }  // ProcessingTaskQueue::processingFinished
 
+void ProcessingTaskQueue::prioritize(const PageId& page_id) {
+  // Tasks already taken for processing form a prefix of the queue and
+  // can't be preempted, so the best we can do is the position right
+  // after them.
+  auto first_untaken(m_queue.begin());
+  while ((first_untaken != m_queue.end()) && first_untaken->takenForProcessing) {
+    ++first_untaken;
+  }
+
+  for (auto it(first_untaken); it != m_queue.end(); ++it) {
+    if (it->pageInfo.id() == page_id) {
+      if (it != first_untaken) {
+        m_queue.splice(first_untaken, m_queue, it);
+      }
+      // Warm up its pixels while the workers finish their current pages.
+      ImagePrefetcher::instance().prefetch(it->pageInfo.id().imageId());
+      break;
+    }
+  }
+}
+
 PageInfo ProcessingTaskQueue::selectedPage() const {
   return m_selectedPage;
 }
@@ -105,6 +174,12 @@ void ProcessingTaskQueue::cancelAndRemove(const std::set<PageId>& pages) {
     } else {
       if (it->takenForProcessing) {
         it->task->cancel();
+      } else {
+        ImagePrefetcher::instance().cancel(it->pageInfo.id().imageId());
+      }
+
+      if (Tracer::instance().isRecording()) {
+        Tracer::instance().recordInstant("queue: cancel", traceArg(it->pageInfo));
       }
 
       if (m_selectedPage.id() == it->pageInfo.id()) {
@@ -115,9 +190,18 @@ void ProcessingTaskQueue::cancelAndRemove(const std::set<PageId>& pages) {
       m_queue.erase(it++);
     }
   }
+
+  if (Tracer::instance().isRecording()) {
+    Tracer::instance().recordCounter("queue depth", m_queue.size());
+  }
 }
 
 void ProcessingTaskQueue::cancelAndClear() {
+  if (Tracer::instance().isRecording() && !m_queue.empty()) {
+    Tracer::instance().recordInstant("queue: clear", std::to_string(m_queue.size()) + " pages dropped");
+    Tracer::instance().recordCounter("queue depth", 0);
+  }
+
   while (!m_queue.empty()) {
     Entry& ent = m_queue.front();
     if (ent.takenForProcessing) {
@@ -125,5 +209,6 @@ void ProcessingTaskQueue::cancelAndClear() {
     }
     m_queue.pop_front();
   }
+  ImagePrefetcher::instance().cancelAll();
   m_selectedPage = m_pageToSelectWhenDone;
 }
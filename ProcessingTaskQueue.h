@@ -43,6 +43,13 @@ class ProcessingTaskQueue {
 
   void processingFinished(const BackgroundTaskPtr& task);
 
+  /**
+   * Moves the page, unless it's already being processed or is not in the
+   * queue at all, ahead of all other pages not yet taken for processing,
+   * so that the next takeForProcessing() call returns its task.
+   */
+  void prioritize(const PageId& page_id);
+
   /**
    * \brief Returns the page to be visually selected.
    *
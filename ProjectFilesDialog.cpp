@@ -21,8 +21,10 @@
 #include <QMessageBox>
 #include <QSettings>
 #include <QSortFilterProxyModel>
-#include <deque>
+#include <algorithm>
+#include "DirectoryLister.h"
 #include "ImageMetadataLoader.h"
+#include "ImageMetadataScanner.h"
 #include "NonCopyable.h"
 #include "SmartFilenameOrdering.h"
 
@@ -57,8 +59,6 @@ class ProjectFilesDialog::FileList : private QAbstractListModel {
   DECLARE_NON_COPYABLE(FileList)
 
  public:
-  enum LoadStatus { LOAD_OK, LOAD_FAILED, NO_MORE_FILES };
-
   FileList();
 
   ~FileList() override;
@@ -88,9 +88,17 @@ class ProjectFilesDialog::FileList : private QAbstractListModel {
 
   void remove(const QItemSelection& selection);
 
-  void prepareForLoadingFiles();
+  void startLoadingFiles();
+
+  size_t numFilesProcessed() const;
+
+  bool isLoadingFinished() const;
 
-  LoadStatus loadNextFile();
+  /**
+   * Applies the scan results to the items in one pass.
+   * Returns false if any of the files failed to load.
+   */
+  bool finishLoadingFiles();
 
  private:
   int rowCount(const QModelIndex& parent) const override;
@@ -100,7 +108,7 @@ class ProjectFilesDialog::FileList : private QAbstractListModel {
   Qt::ItemFlags flags(const QModelIndex& index) const override;
 
   std::vector<Item> m_items;
-  std::deque<int> m_itemsToLoad;
+  std::unique_ptr<ImageMetadataScanner> m_scanner;
 };
 
 
@@ -174,8 +182,10 @@ ProjectFilesDialog::ProjectFilesDialog(QWidget* parent)
       m_inProjectFiles(new FileList),
       m_inProjectFilesSorted(new SortedFileList(*m_inProjectFiles)),
       m_loadTimerId(0),
+      m_listTimerId(0),
       m_metadataLoadFailed(false),
-      m_autoOutDir(true) {
+      m_autoOutDir(true),
+      m_autoAddPending(false) {
   m_supportedExtensions.insert("png");
   m_supportedExtensions.insert("jpg");
   m_supportedExtensions.insert("jpeg");
@@ -302,26 +312,47 @@ void ProjectFilesDialog::setInputDir(const QString& dir, const bool auto_add_fil
     setOutputDir(QDir::cleanPath(QDir(dir).filePath("out")));
   }
 
-  QFileInfoList files(QDir(dir).entryInfoList(QDir::Files));
-
-  {
-    // Filter out files already in project.
-    // Here we use simple ordering, which is OK.
-
-    std::vector<QFileInfo> new_files(files.begin(), files.end());
-    std::vector<QFileInfo> existing_files;
-    m_inProjectFiles->files([&](const QFileInfo& file_info) { existing_files.push_back(file_info); });
-    std::sort(new_files.begin(), new_files.end(), FileInfoLess());
-    std::sort(existing_files.begin(), existing_files.end(), FileInfoLess());
+  stopListing();
+  m_offProjectFiles->clear();
+
+  // Entries streamed in by the lister are filtered against this
+  // snapshot of the project.  Add/remove buttons stay disabled for
+  // the duration of the listing, so the snapshot can't go stale.
+  m_existingFilesSorted.clear();
+  m_inProjectFiles->files([&](const QFileInfo& file_info) { m_existingFilesSorted.push_back(file_info); });
+  std::sort(m_existingFilesSorted.begin(), m_existingFilesSorted.end(), FileInfoLess());
+
+  const QString dir_key(QDir(dir).absolutePath());
+  const auto cached(m_dirCache.constFind(dir_key));
+  if (cached != m_dirCache.constEnd()) {
+    // This directory was already listed earlier in this session.
+    appendOffProjectFiles(*cached);
+    if (auto_add_files && (m_inProjectFiles->count() == 0)) {
+      offProjectList->selectAll();
+      addToProject();
+    }
 
-    files.clear();
-    std::set_difference(new_files.begin(), new_files.end(), existing_files.begin(), existing_files.end(),
-                        std::back_inserter(files), FileInfoLess());
+    return;
   }
 
+  m_listedDir = dir_key;
+  m_listedEntries.clear();
+  m_autoAddPending = auto_add_files;
+  addToProjectBtn->setEnabled(false);
+  removeFromProjectBtn->setEnabled(false);
+  m_dirLister = std::make_unique<DirectoryLister>();
+  m_dirLister->start(dir_key);
+  m_listTimerId = startTimer(100);
+}  // ProjectFilesDialog::setInputDir
+
+void ProjectFilesDialog::appendOffProjectFiles(const std::vector<QFileInfo>& files) {
   typedef std::vector<Item> ItemList;
   ItemList items;
   for (const QFileInfo& file : files) {
+    if (std::binary_search(m_existingFilesSorted.begin(), m_existingFilesSorted.end(), file, FileInfoLess())) {
+      // Already in the project.
+      continue;
+    }
     Qt::ItemFlags flags;
     if (m_supportedExtensions.contains(file.suffix().toLower())) {
       flags = Qt::ItemIsSelectable | Qt::ItemIsEnabled;
@@ -329,13 +360,57 @@ void ProjectFilesDialog::setInputDir(const QString& dir, const bool auto_add_fil
     items.emplace_back(file, flags);
   }
 
-  m_offProjectFiles->assign(items.begin(), items.end());
+  m_offProjectFiles->append(items.begin(), items.end());
+}
 
-  if (auto_add_files && (m_inProjectFiles->count() == 0)) {
+void ProjectFilesDialog::stopListing() {
+  if (m_listTimerId) {
+    killTimer(m_listTimerId);
+    m_listTimerId = 0;
+  }
+  if (m_dirLister) {
+    m_dirLister.reset();
+    if (m_loadTimerId == 0) {
+      addToProjectBtn->setEnabled(true);
+      removeFromProjectBtn->setEnabled(true);
+    }
+  }
+}
+
+void ProjectFilesDialog::processNewEntries() {
+  // The order matters: checking for completion before draining
+  // guarantees the final batch isn't left behind.
+  const bool finished = m_dirLister->isFinished();
+
+  std::vector<QFileInfo> batch;
+  m_dirLister->takeNewEntries(batch);
+  if (!batch.empty()) {
+    appendOffProjectFiles(batch);
+    m_listedEntries.insert(m_listedEntries.end(), batch.begin(), batch.end());
+  }
+
+  if (finished) {
+    finishListing();
+  }
+}
+
+void ProjectFilesDialog::finishListing() {
+  stopListing();
+
+  if (!m_listedEntries.empty()) {
+    // An empty result isn't cached: it's usually a directory that
+    // doesn't exist yet, typed into the line edit character by
+    // character.
+    m_dirCache[m_listedDir].swap(m_listedEntries);
+  }
+  m_listedEntries.clear();
+
+  if (m_autoAddPending && (m_inProjectFiles->count() == 0)) {
     offProjectList->selectAll();
     addToProject();
   }
-}  // ProjectFilesDialog::setInputDir
+  m_autoAddPending = false;
+}
 
 void ProjectFilesDialog::setOutputDir(const QString& dir) {
   outDirLine->setText(QDir::toNativeSeparators(dir));
@@ -424,7 +499,7 @@ void ProjectFilesDialog::onOK() {
 }  // ProjectFilesDialog::onOK
 
 void ProjectFilesDialog::startLoadingMetadata() {
-  m_inProjectFiles->prepareForLoadingFiles();
+  m_inProjectFiles->startLoadingFiles();
 
   progressBar->setMaximum(static_cast<int>(m_inProjectFiles->count()));
   inpDirLine->setEnabled(false);
@@ -440,27 +515,30 @@ void ProjectFilesDialog::startLoadingMetadata() {
   buttonBox->button(QDialogButtonBox::Ok)->setEnabled(false);
   offProjectList->clearSelection();
   inProjectList->clearSelection();
-  m_loadTimerId = startTimer(0);
+  m_loadTimerId = startTimer(100);
   m_metadataLoadFailed = false;
 }
 
 void ProjectFilesDialog::timerEvent(QTimerEvent* event) {
+  if (event->timerId() == m_listTimerId) {
+    processNewEntries();
+
+    return;
+  }
+
   if (event->timerId() != m_loadTimerId) {
     QWidget::timerEvent(event);
 
     return;
   }
 
-  switch (m_inProjectFiles->loadNextFile()) {
-    case FileList::NO_MORE_FILES:
-      finishLoadingMetadata();
-      break;
-    case FileList::LOAD_FAILED:
-      m_metadataLoadFailed = true;
-      // Fall through.
-    case FileList::LOAD_OK:
-      progressBar->setValue(progressBar->value() + 1);
-      break;
+  // The actual loading happens in the scanner's worker threads.
+  // All we do here is keep the progress bar moving.
+  progressBar->setValue(static_cast<int>(m_inProjectFiles->numFilesProcessed()));
+
+  if (m_inProjectFiles->isLoadingFinished()) {
+    m_metadataLoadFailed = !m_inProjectFiles->finishLoadingFiles();
+    finishLoadingMetadata();
   }
 }
 
@@ -564,48 +642,52 @@ Qt::ItemFlags ProjectFilesDialog::FileList::flags(const QModelIndex& index) cons
   return m_items[index.row()].flags();
 }
 
-void ProjectFilesDialog::FileList::prepareForLoadingFiles() {
-  std::deque<int> item_indexes;
-  const auto num_items = static_cast<const int>(m_items.size());
-  for (int i = 0; i < num_items; ++i) {
-    item_indexes.push_back(i);
+void ProjectFilesDialog::FileList::startLoadingFiles() {
+  std::vector<QString> paths;
+  paths.reserve(m_items.size());
+  for (const Item& item : m_items) {
+    paths.push_back(item.fileInfo().absoluteFilePath());
   }
 
-  std::sort(item_indexes.begin(), item_indexes.end(),
-            [&](int lhs, int rhs) { return ItemVisualOrdering()(m_items[lhs], m_items[rhs]); });
-
-  m_itemsToLoad.swap(item_indexes);
+  m_scanner = std::make_unique<ImageMetadataScanner>();
+  m_scanner->start(std::move(paths));
 }
 
-ProjectFilesDialog::FileList::LoadStatus ProjectFilesDialog::FileList::loadNextFile() {
-  if (m_itemsToLoad.empty()) {
-    return NO_MORE_FILES;
-  }
+size_t ProjectFilesDialog::FileList::numFilesProcessed() const {
+  return m_scanner ? m_scanner->numProcessed() : 0;
+}
 
-  const int item_idx = m_itemsToLoad.front();
-  Item& item = m_items[item_idx];
-  std::vector<ImageMetadata> per_page_metadata;
-  const QString file_path(item.fileInfo().absoluteFilePath());
-  const ImageMetadataLoader::Status st = ImageMetadataLoader::load(
-      file_path, [&](const ImageMetadata& metadata) { per_page_metadata.push_back(metadata); });
+bool ProjectFilesDialog::FileList::isLoadingFinished() const {
+  return !m_scanner || m_scanner->isFinished();
+}
 
-  LoadStatus status;
+bool ProjectFilesDialog::FileList::finishLoadingFiles() {
+  if (!m_scanner) {
+    return true;
+  }
 
-  if (st == ImageMetadataLoader::LOADED) {
-    status = LOAD_OK;
-    item.perPageMetadata().swap(per_page_metadata);
-    item.setStatus(Item::STATUS_LOAD_OK);
-  } else {
-    status = LOAD_FAILED;
-    item.setStatus(Item::STATUS_LOAD_FAILED);
+  std::vector<ImageMetadataScanner::Result> results(m_scanner->finish());
+  m_scanner.reset();
+
+  bool all_loaded = true;
+  for (size_t i = 0; i < m_items.size(); ++i) {
+    Item& item = m_items[i];
+    ImageMetadataScanner::Result& result = results[i];
+    if (result.status == ImageMetadataLoader::LOADED) {
+      item.perPageMetadata().swap(result.perPageMetadata);
+      item.setStatus(Item::STATUS_LOAD_OK);
+    } else {
+      item.setStatus(Item::STATUS_LOAD_FAILED);
+      all_loaded = false;
+    }
   }
-  const QModelIndex idx(index(item_idx, 0));
-  emit dataChanged(idx, idx);
 
-  m_itemsToLoad.pop_front();
+  if (!m_items.empty()) {
+    emit dataChanged(index(0, 0), index(static_cast<int>(m_items.size()) - 1, 0));
+  }
 
-  return status;
-}  // ProjectFilesDialog::FileList::loadNextFile
+  return all_loaded;
+}  // ProjectFilesDialog::FileList::finishLoadingFiles
 
 /*================= ProjectFilesDialog::SortedFileList ===================*/
 
@@ -20,6 +20,8 @@
 #define PROJECTFILESDIALOG_H_
 
 #include <QDialog>
+#include <QFileInfo>
+#include <QHash>
 #include <QSet>
 #include <QString>
 #include <memory>
@@ -27,6 +29,8 @@
 #include "ImageFileInfo.h"
 #include "ui_ProjectFilesDialog.h"
 
+class DirectoryLister;
+
 class ProjectFilesDialog : public QDialog, private Ui::ProjectFilesDialog {
   Q_OBJECT
  public:
@@ -72,6 +76,14 @@ class ProjectFilesDialog : public QDialog, private Ui::ProjectFilesDialog {
 
   void setOutputDir(const QString& dir);
 
+  void appendOffProjectFiles(const std::vector<QFileInfo>& files);
+
+  void stopListing();
+
+  void processNewEntries();
+
+  void finishListing();
+
   void startLoadingMetadata();
 
   void timerEvent(QTimerEvent* event) override;
@@ -83,9 +95,23 @@ class ProjectFilesDialog : public QDialog, private Ui::ProjectFilesDialog {
   std::unique_ptr<SortedFileList> m_offProjectFilesSorted;
   std::unique_ptr<FileList> m_inProjectFiles;
   std::unique_ptr<SortedFileList> m_inProjectFilesSorted;
+  std::unique_ptr<DirectoryLister> m_dirLister;
+
+  /**
+   * Directories listed earlier in this session, keyed by absolute
+   * path.  A snapshot may go stale if the directory changes behind
+   * our back, but re-entering it through the browse button refreshes
+   * it soon enough in practice.
+   */
+  QHash<QString, std::vector<QFileInfo>> m_dirCache;
+  std::vector<QFileInfo> m_listedEntries;
+  std::vector<QFileInfo> m_existingFilesSorted;
+  QString m_listedDir;
   int m_loadTimerId;
+  int m_listTimerId;
   bool m_metadataLoadFailed;
   bool m_autoOutDir;
+  bool m_autoAddPending;
 };
 
 
@@ -26,6 +26,9 @@
 ProjectOpeningContext::ProjectOpeningContext(QWidget* parent, const QString& project_file, const QDomDocument& doc)
     : m_projectFile(project_file), m_reader(doc), m_parent(parent) {}
 
+ProjectOpeningContext::ProjectOpeningContext(QWidget* parent, const QString& project_file)
+    : m_projectFile(project_file), m_reader(project_file), m_parent(parent) {}
+
 ProjectOpeningContext::~ProjectOpeningContext() {
   // Deleting a null pointer is OK.
   delete m_fixDpiDialog;
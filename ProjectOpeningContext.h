@@ -39,6 +39,12 @@ class ProjectOpeningContext : public QObject {
  public:
   ProjectOpeningContext(QWidget* parent, const QString& project_file, const QDomDocument& doc);
 
+  /**
+   * Parses the project file in a single streaming pass rather than
+   * through a QDomDocument of the whole file.
+   */
+  ProjectOpeningContext(QWidget* parent, const QString& project_file);
+
   ~ProjectOpeningContext() override;
 
   void proceed();
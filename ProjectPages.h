@@ -55,6 +55,13 @@ class ProjectPages : public QObject, public ref_countable {
 
   explicit ProjectPages(Qt::LayoutDirection layout_direction = Qt::LeftToRight);
 
+  /**
+   * Metadata for every image must already be known by the time a
+   * ProjectPages is built: on project open it comes from the project
+   * file itself and on project creation from the files dialog scan.
+   * No image file is ever touched here, so constructing one is cheap
+   * regardless of the number of pages.
+   */
   ProjectPages(const std::vector<ImageInfo>& images, Qt::LayoutDirection layout_direction);
 
   ProjectPages(const std::vector<ImageFileInfo>& files, Pages pages, Qt::LayoutDirection layout_direction);
@@ -18,8 +18,11 @@
 
 #include "ProjectReader.h"
 #include <QDir>
+#include <QFile>
+#include <QXmlStreamReader>
 #include <boost/bind.hpp>
 #include "AbstractFilter.h"
+#include "FileFingerprint.h"
 #include "FileNameDisambiguator.h"
 #include "ProjectPages.h"
 #include "XmlUnmarshaller.h"
@@ -69,17 +72,85 @@ ProjectReader::ProjectReader(const QDomDocument& doc) : m_doc(doc), m_disambigua
       = make_intrusive<FileNameDisambiguator>(disambig_el, boost::bind(&ProjectReader::expandFilePath, this, _1));
 }
 
+ProjectReader::ProjectReader(const QString& project_file) : m_disambiguator(new FileNameDisambiguator) {
+  QFile file(project_file);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  QXmlStreamReader xml(&file);
+  if (!xml.readNextStartElement() || (xml.name() != QLatin1String("project"))) {
+    return;
+  }
+
+  const QXmlStreamAttributes attrs(xml.attributes());
+
+  m_version = attrs.value("version").toString();
+  if (m_version.isNull() || (m_version.toInt() != PROJECT_VERSION)) {
+    return;
+  }
+
+  m_outDir = attrs.value("outputDirectory").toString();
+
+  Qt::LayoutDirection layout_direction = Qt::LeftToRight;
+  if (attrs.value("layoutDirection") == QLatin1String("RTL")) {
+    layout_direction = Qt::RightToLeft;
+  }
+
+  // ProjectWriter emits the sections in dependency order (directories,
+  // files, images, pages, disambiguation, filters), so handling them in
+  // document order resolves all cross-references in a single pass.
+  QDomDocument disambig_doc;
+
+  while (xml.readNextStartElement()) {
+    if (xml.name() == QLatin1String("directories")) {
+      processDirectories(xml);
+    } else if (xml.name() == QLatin1String("files")) {
+      processFiles(xml);
+    } else if (xml.name() == QLatin1String("images")) {
+      processImages(xml, layout_direction);
+    } else if (xml.name() == QLatin1String("pages")) {
+      processPages(xml);
+    } else if (xml.name() == QLatin1String("file-name-disambiguation")) {
+      readSubtreeIntoDom(xml, disambig_doc);
+    } else if (xml.name() == QLatin1String("filters")) {
+      readSubtreeIntoDom(xml, m_filtersDoc);
+    } else {
+      xml.skipCurrentElement();
+    }
+  }
+
+  if (xml.hasError()) {
+    m_pages = nullptr;
+
+    return;
+  }
+
+  // Load naming disambiguator.  This needs to be done after processing pages.
+  m_disambiguator = make_intrusive<FileNameDisambiguator>(disambig_doc.documentElement(),
+                                                          boost::bind(&ProjectReader::expandFilePath, this, _1));
+}
+
 ProjectReader::~ProjectReader() = default;
 
 void ProjectReader::readFilterSettings(const std::vector<FilterPtr>& filters) const {
-  QDomElement project_el(m_doc.documentElement());
-  QDomElement filters_el(project_el.namedItem("filters").toElement());
+  QDomElement filters_el;
+  if (!m_filtersDoc.isNull()) {
+    filters_el = m_filtersDoc.documentElement();
+  } else {
+    filters_el = m_doc.documentElement().namedItem("filters").toElement();
+  }
 
   auto it(filters.begin());
   const auto end(filters.end());
   for (; it != end; ++it) {
     (*it)->loadSettings(*this, filters_el);
   }
+
+  // The filter settings are the bulk of a big project file.  Once the
+  // filters have loaded, there is no reason to keep them alive for the
+  // lifetime of the reader, which ConsoleBatch holds for a whole run.
+  m_filtersDoc = QDomDocument();
 }
 
 void ProjectReader::processDirectories(const QDomElement& dirs_el) {
@@ -110,6 +181,30 @@ void ProjectReader::processDirectories(const QDomElement& dirs_el) {
   }
 }
 
+void ProjectReader::processDirectories(QXmlStreamReader& xml) {
+  while (xml.readNextStartElement()) {
+    if (xml.name() != QLatin1String("directory")) {
+      xml.skipCurrentElement();
+      continue;
+    }
+    const QXmlStreamAttributes attrs(xml.attributes());
+    xml.skipCurrentElement();
+
+    bool ok = true;
+    const int id = attrs.value("id").toInt(&ok);
+    if (!ok) {
+      continue;
+    }
+
+    const QString path(attrs.value("path").toString());
+    if (path.isEmpty()) {
+      continue;
+    }
+
+    m_dirMap.insert(DirMap::value_type(id, path));
+  }
+}
+
 void ProjectReader::processFiles(const QDomElement& files_el) {
   const QString file_tag_name("file");
 
@@ -149,6 +244,56 @@ void ProjectReader::processFiles(const QDomElement& files_el) {
     const QString file_path(QDir(dir_path).filePath(name));
     const FileRecord rec(file_path, compat_multi_page);
     m_fileMap.insert(FileMap::value_type(id, rec));
+
+    const QString fingerprint(el.attribute("fingerprint"));
+    if (!fingerprint.isEmpty()) {
+      // Verified when the relinking dialog checks this path.
+      FileFingerprint::recordExpected(file_path, fingerprint);
+    }
+  }
+}  // ProjectReader::processFiles
+
+void ProjectReader::processFiles(QXmlStreamReader& xml) {
+  while (xml.readNextStartElement()) {
+    if (xml.name() != QLatin1String("file")) {
+      xml.skipCurrentElement();
+      continue;
+    }
+    const QXmlStreamAttributes attrs(xml.attributes());
+    xml.skipCurrentElement();
+
+    bool ok = true;
+    const int id = attrs.value("id").toInt(&ok);
+    if (!ok) {
+      continue;
+    }
+    const int dir_id = attrs.value("dirId").toInt(&ok);
+    if (!ok) {
+      continue;
+    }
+
+    const QString name(attrs.value("name").toString());
+    if (name.isEmpty()) {
+      continue;
+    }
+
+    const QString dir_path(getDirPath(dir_id));
+    if (dir_path.isEmpty()) {
+      continue;
+    }
+
+    // Backwards compatibility.
+    const bool compat_multi_page = (attrs.value("multiPage") == QLatin1String("1"));
+
+    const QString file_path(QDir(dir_path).filePath(name));
+    const FileRecord rec(file_path, compat_multi_page);
+    m_fileMap.insert(FileMap::value_type(id, rec));
+
+    const QString fingerprint(attrs.value("fingerprint").toString());
+    if (!fingerprint.isEmpty()) {
+      // Verified when the relinking dialog checks this path.
+      FileFingerprint::recordExpected(file_path, fingerprint);
+    }
   }
 }  // ProjectReader::processFiles
 
@@ -206,6 +351,56 @@ void ProjectReader::processImages(const QDomElement& images_el, const Qt::Layout
   }
 }  // ProjectReader::processImages
 
+void ProjectReader::processImages(QXmlStreamReader& xml, const Qt::LayoutDirection layout_direction) {
+  std::vector<ImageInfo> images;
+
+  while (xml.readNextStartElement()) {
+    if (xml.name() != QLatin1String("image")) {
+      xml.skipCurrentElement();
+      continue;
+    }
+    const QXmlStreamAttributes attrs(xml.attributes());
+    // Consumes the child elements up to and including </image>.
+    const ImageMetadata metadata(processImageMetadata(xml));
+
+    bool ok = true;
+    const int id = attrs.value("id").toInt(&ok);
+    if (!ok) {
+      continue;
+    }
+    const int sub_pages = attrs.value("subPages").toInt(&ok);
+    if (!ok) {
+      continue;
+    }
+    const int file_id = attrs.value("fileId").toInt(&ok);
+    if (!ok) {
+      continue;
+    }
+    const int file_image = attrs.value("fileImage").toInt(&ok);
+    if (!ok) {
+      continue;
+    }
+
+    const QStringRef removed(attrs.value("removed"));
+    const bool left_half_removed = (removed == QLatin1String("L"));
+    const bool right_half_removed = (removed == QLatin1String("R"));
+
+    const FileRecord file_record(getFileRecord(file_id));
+    if (file_record.filePath.isEmpty()) {
+      continue;
+    }
+    const ImageId image_id(file_record.filePath, file_image + int(file_record.compatMultiPage));
+    const ImageInfo image_info(image_id, metadata, sub_pages, left_half_removed, right_half_removed);
+
+    images.push_back(image_info);
+    m_imageMap.insert(ImageMap::value_type(id, image_info));
+  }
+
+  if (!images.empty()) {
+    m_pages = make_intrusive<ProjectPages>(images, layout_direction);
+  }
+}  // ProjectReader::processImages
+
 ImageMetadata ProjectReader::processImageMetadata(const QDomElement& image_el) {
   QSize size;
   Dpi dpi;
@@ -222,6 +417,23 @@ ImageMetadata ProjectReader::processImageMetadata(const QDomElement& image_el) {
   return ImageMetadata(size, dpi);
 }
 
+ImageMetadata ProjectReader::processImageMetadata(QXmlStreamReader& xml) {
+  QSize size;
+  Dpi dpi;
+
+  while (xml.readNextStartElement()) {
+    const QXmlStreamAttributes attrs(xml.attributes());
+    if (xml.name() == QLatin1String("size")) {
+      size = QSize(attrs.value("width").toInt(), attrs.value("height").toInt());
+    } else if (xml.name() == QLatin1String("dpi")) {
+      dpi = Dpi(attrs.value("horizontal").toInt(), attrs.value("vertical").toInt());
+    }
+    xml.skipCurrentElement();
+  }
+
+  return ImageMetadata(size, dpi);
+}
+
 void ProjectReader::processPages(const QDomElement& pages_el) {
   const QString page_tag_name("page");
 
@@ -266,6 +478,81 @@ void ProjectReader::processPages(const QDomElement& pages_el) {
   }
 }  // ProjectReader::processPages
 
+void ProjectReader::processPages(QXmlStreamReader& xml) {
+  while (xml.readNextStartElement()) {
+    if (xml.name() != QLatin1String("page")) {
+      xml.skipCurrentElement();
+      continue;
+    }
+    const QXmlStreamAttributes attrs(xml.attributes());
+    xml.skipCurrentElement();
+
+    bool ok = true;
+
+    const int id = attrs.value("id").toInt(&ok);
+    if (!ok) {
+      continue;
+    }
+
+    const int image_id = attrs.value("imageId").toInt(&ok);
+    if (!ok) {
+      continue;
+    }
+
+    const PageId::SubPage sub_page = PageId::subPageFromString(attrs.value("subPage").toString(), &ok);
+    if (!ok) {
+      continue;
+    }
+
+    const ImageInfo image(getImageInfo(image_id));
+    if (image.id().filePath().isEmpty()) {
+      continue;
+    }
+
+    const PageId page_id(image.id(), sub_page);
+    m_pageMap.insert(PageMap::value_type(id, page_id));
+
+    if (attrs.value("selected") == QLatin1String("selected")) {
+      m_selectedPage.set(page_id, PAGE_VIEW);
+    }
+  }
+}  // ProjectReader::processPages
+
+void ProjectReader::readSubtreeIntoDom(QXmlStreamReader& xml, QDomDocument& doc) {
+  // Re-assembles the subtree rooted at the current start element as the
+  // document element of \p doc, leaving the stream on the corresponding
+  // end element, just like QXmlStreamReader::skipCurrentElement().
+  QDomNode cur(doc);
+  int depth = 0;
+
+  QXmlStreamReader::TokenType token = xml.tokenType();
+  for (;;) {
+    if (token == QXmlStreamReader::StartElement) {
+      QDomElement el(doc.createElement(xml.qualifiedName().toString()));
+      for (const QXmlStreamAttribute& attr : xml.attributes()) {
+        el.setAttribute(attr.qualifiedName().toString(), attr.value().toString());
+      }
+      cur.appendChild(el);
+      cur = el;
+      ++depth;
+    } else if (token == QXmlStreamReader::EndElement) {
+      cur = cur.parentNode();
+      if (--depth == 0) {
+        break;
+      }
+    } else if (token == QXmlStreamReader::Characters) {
+      if (!xml.isWhitespace()) {
+        cur.appendChild(doc.createTextNode(xml.text().toString()));
+      }
+    }
+
+    token = xml.readNext();
+    if ((token == QXmlStreamReader::Invalid) || (token == QXmlStreamReader::EndDocument)) {
+      break;
+    }
+  }
+}
+
 QString ProjectReader::getDirPath(const int id) const {
   const auto it(m_dirMap.find(id));
   if (it != m_dirMap.end()) {
@@ -32,6 +32,7 @@
 #include "intrusive_ptr.h"
 
 class QDomElement;
+class QXmlStreamReader;
 class ProjectPages;
 class FileNameDisambiguator;
 class AbstractFilter;
@@ -42,6 +43,17 @@ class ProjectReader {
 
   explicit ProjectReader(const QDomDocument& doc);
 
+  /**
+   * \brief Reads the project file in a single streaming pass.
+   *
+   * Unlike the QDomDocument-based constructor, this one never holds
+   * the whole file in memory.  Page records are built incrementally as
+   * their elements stream past; only the filter settings subtree is
+   * re-assembled as a DOM, because that's the form filters load from,
+   * and it's released as soon as readFilterSettings() is done with it.
+   */
+  explicit ProjectReader(const QString& project_file);
+
   ~ProjectReader();
 
   void readFilterSettings(const std::vector<FilterPtr>& filters) const;
@@ -88,6 +100,18 @@ class ProjectReader {
 
   void processPages(const QDomElement& pages_el);
 
+  void processDirectories(QXmlStreamReader& xml);
+
+  void processFiles(QXmlStreamReader& xml);
+
+  void processImages(QXmlStreamReader& xml, Qt::LayoutDirection layout_direction);
+
+  ImageMetadata processImageMetadata(QXmlStreamReader& xml);
+
+  void processPages(QXmlStreamReader& xml);
+
+  static void readSubtreeIntoDom(QXmlStreamReader& xml, QDomDocument& doc);
+
   QString getDirPath(int id) const;
 
   FileRecord getFileRecord(int id) const;
@@ -97,6 +121,13 @@ class ProjectReader {
   ImageInfo getImageInfo(int id) const;
 
   QDomDocument m_doc;
+
+  /**
+   * The filter settings subtree when constructed from a stream.
+   * Mutable so readFilterSettings() can release it once the filters
+   * have loaded - it's by far the largest part of a project file.
+   */
+  mutable QDomDocument m_filtersDoc;
   QString m_outDir;
   QString m_version;
   DirMap m_dirMap;
@@ -0,0 +1,213 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ProjectSidecar.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDomDocument>
+#include <QFile>
+#include <QHash>
+#include <QVector>
+
+namespace {
+const quint32 MAGIC = 0x53545042;  // "STPB"
+const quint32 FORMAT_VERSION = 1;
+
+enum NodeKind { ELEMENT_NODE = 0, TEXT_NODE = 1 };
+
+QByteArray fileChecksum(const QString& path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return QByteArray();
+  }
+
+  QCryptographicHash hash(QCryptographicHash::Md5);
+  if (!hash.addData(&file)) {
+    return QByteArray();
+  }
+
+  return hash.result();
+}
+
+/**
+ * Strings are interned: the first occurrence gets the next id and is
+ * written out, later occurrences are written as the id alone.  Tag and
+ * attribute names repeat thousands of times in a big project, so this
+ * is where most of the compactness comes from.
+ */
+void writeStringRef(QDataStream& strm, QHash<QString, quint32>& table, const QString& str) {
+  const auto it(table.constFind(str));
+  if (it != table.constEnd()) {
+    strm << it.value();
+  } else {
+    const auto id = (quint32) table.size();
+    table.insert(str, id);
+    strm << id << str;
+  }
+}
+
+QString readStringRef(QDataStream& strm, QVector<QString>& table) {
+  quint32 id = 0;
+  strm >> id;
+  if (id < (quint32) table.size()) {
+    return table[id];
+  }
+
+  QString str;
+  strm >> str;
+  table.append(str);
+
+  return str;
+}
+
+void writeElement(QDataStream& strm, QHash<QString, quint32>& names, const QDomElement& el) {
+  writeStringRef(strm, names, el.tagName());
+
+  const QDomNamedNodeMap attrs(el.attributes());
+  strm << (quint32) attrs.length();
+  for (int i = 0; i < attrs.length(); ++i) {
+    const QDomAttr attr(attrs.item(i).toAttr());
+    writeStringRef(strm, names, attr.name());
+    strm << attr.value();
+  }
+
+  // Project files only contain elements and character data
+  // (QDomText covers CDATA sections as well).
+  quint32 num_children = 0;
+  for (QDomNode node = el.firstChild(); !node.isNull(); node = node.nextSibling()) {
+    if (node.isElement() || node.isText()) {
+      ++num_children;
+    }
+  }
+  strm << num_children;
+
+  for (QDomNode node = el.firstChild(); !node.isNull(); node = node.nextSibling()) {
+    if (node.isElement()) {
+      strm << (quint8) ELEMENT_NODE;
+      writeElement(strm, names, node.toElement());
+    } else if (node.isText()) {
+      strm << (quint8) TEXT_NODE << node.toText().data();
+    }
+  }
+}
+
+bool readElement(QDataStream& strm, QVector<QString>& names, QDomDocument& doc, QDomElement& out) {
+  out = doc.createElement(readStringRef(strm, names));
+
+  quint32 num_attrs = 0;
+  strm >> num_attrs;
+  for (quint32 i = 0; i < num_attrs; ++i) {
+    const QString name(readStringRef(strm, names));
+    QString value;
+    strm >> value;
+    if (strm.status() != QDataStream::Ok) {
+      return false;
+    }
+    out.setAttribute(name, value);
+  }
+
+  quint32 num_children = 0;
+  strm >> num_children;
+  for (quint32 i = 0; i < num_children; ++i) {
+    quint8 kind = 0;
+    strm >> kind;
+    if (strm.status() != QDataStream::Ok) {
+      return false;
+    }
+
+    if (kind == ELEMENT_NODE) {
+      QDomElement child;
+      if (!readElement(strm, names, doc, child)) {
+        return false;
+      }
+      out.appendChild(child);
+    } else if (kind == TEXT_NODE) {
+      QString text;
+      strm >> text;
+      out.appendChild(doc.createTextNode(text));
+    } else {
+      return false;
+    }
+  }
+
+  return strm.status() == QDataStream::Ok;
+}
+}  // namespace
+
+QString ProjectSidecar::sidecarPath(const QString& project_file) {
+  return project_file + ".bin";
+}
+
+bool ProjectSidecar::write(const QString& project_file, const QDomDocument& doc) {
+  const QByteArray checksum(fileChecksum(project_file));
+  if (checksum.isEmpty()) {
+    return false;
+  }
+
+  QFile file(sidecarPath(project_file));
+  if (!file.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+
+  QDataStream strm(&file);
+  strm.setVersion(QDataStream::Qt_5_0);
+  strm << MAGIC << FORMAT_VERSION << checksum;
+
+  QHash<QString, quint32> names;
+  writeElement(strm, names, doc.documentElement());
+
+  file.close();
+
+  return (strm.status() == QDataStream::Ok) && (file.error() == QFileDevice::NoError);
+}
+
+bool ProjectSidecar::read(const QString& project_file, QDomDocument& doc) {
+  QFile file(sidecarPath(project_file));
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  QDataStream strm(&file);
+  strm.setVersion(QDataStream::Qt_5_0);
+
+  quint32 magic = 0;
+  quint32 version = 0;
+  QByteArray checksum;
+  strm >> magic >> version >> checksum;
+  if ((strm.status() != QDataStream::Ok) || (magic != MAGIC) || (version != FORMAT_VERSION)) {
+    return false;
+  }
+
+  // The XML remains authoritative - a sidecar that doesn't match it
+  // byte for byte is stale and gets ignored.
+  if (checksum != fileChecksum(project_file)) {
+    return false;
+  }
+
+  QDomDocument new_doc;
+  QVector<QString> names;
+  QDomElement root;
+  if (!readElement(strm, names, new_doc, root)) {
+    return false;
+  }
+
+  new_doc.appendChild(root);
+  doc = new_doc;
+
+  return true;
+}
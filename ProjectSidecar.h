@@ -0,0 +1,65 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_SIDECAR_H_
+#define PROJECT_SIDECAR_H_
+
+class QDomDocument;
+class QString;
+
+/**
+ * \brief A binary companion of the project XML, for fast opening.
+ *
+ * Parsing a large project XML through QDomDocument takes seconds and
+ * allocates heavily.  Whenever a project is saved, the same document
+ * tree is additionally written next to it in a compact binary encoding
+ * with a string table, which decodes several times faster than the XML
+ * parses.
+ *
+ * The XML file remains the authoritative, interchangeable format.  The
+ * sidecar records a checksum of the XML it was written alongside, so
+ * it's silently ignored if the XML was edited or replaced behind our
+ * back, as well as on any version mismatch.  It's therefore always
+ * safe to delete, and failing to write one is not an error.
+ */
+class ProjectSidecar {
+ public:
+  /** The path of the sidecar corresponding to the given project file. */
+  static QString sidecarPath(const QString& project_file);
+
+  /**
+   * \brief Writes the sidecar for a just-saved project file.
+   *
+   * \param project_file The project XML this document was saved to.
+   * \param doc The document that was saved there.
+   * \return true on success.  Failure only costs a slower next open.
+   */
+  static bool write(const QString& project_file, const QDomDocument& doc);
+
+  /**
+   * \brief Loads the project document from the sidecar, if possible.
+   *
+   * \return false if the sidecar is missing, of a different version
+   *         or stale with respect to the XML.  The caller falls back
+   *         to parsing the XML in that case.
+   */
+  static bool read(const QString& project_file, QDomDocument& doc);
+};
+
+
+#endif  // ifndef PROJECT_SIDECAR_H_
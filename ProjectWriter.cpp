@@ -22,6 +22,7 @@
 #include <QTextStream>
 #include <QtXml>
 #include "AbstractFilter.h"
+#include "FileFingerprint.h"
 #include "FileNameDisambiguator.h"
 #include "ImageId.h"
 #include "ImageMetadata.h"
@@ -29,6 +30,7 @@
 #include "PageInfo.h"
 #include "PageView.h"
 #include "ProjectPages.h"
+#include "ProjectSidecar.h"
 #include "version.h"
 
 #ifndef Q_MOC_RUN
@@ -77,7 +79,7 @@ ProjectWriter::ProjectWriter(const intrusive_ptr<ProjectPages>& page_sequence,
 
 ProjectWriter::~ProjectWriter() = default;
 
-bool ProjectWriter::write(const QString& file_path, const std::vector<FilterPtr>& filters) const {
+bool ProjectWriter::write(const QString& file_path, const std::vector<FilterPtr>& filters, SaveCache* cache) const {
   QDomDocument doc;
   QDomElement root_el(doc.createElement("project"));
   doc.appendChild(root_el);
@@ -100,15 +102,116 @@ bool ProjectWriter::write(const QString& file_path, const std::vector<FilterPtr>
     filters_el.appendChild((*it)->saveSettings(*this, doc));
   }
 
-  QFile file(file_path);
-  if (file.open(QIODevice::WriteOnly)) {
+  if (!saveDocument(file_path, doc)) {
+    return false;
+  }
+
+  if (cache) {
+    cache->doc = doc;
+    fillIdAssignment(*cache);
+    cache->valid = true;
+  }
+
+  return true;
+}  // ProjectWriter::write
+
+bool ProjectWriter::writeIncremental(const QString& file_path,
+                                     const std::vector<FilterPtr>& filters,
+                                     SaveCache& cache) const {
+  if (!cache.valid || !matchesIdAssignment(cache)) {
+    // Pages were added, removed or renumbered - the numeric ids woven
+    // through the cached document can no longer be trusted.
+    return write(file_path, filters, &cache);
+  }
+
+  QDomDocument& doc = cache.doc;
+  QDomElement root_el(doc.documentElement());
+  root_el.setAttribute("version", PROJECT_VERSION);
+  root_el.setAttribute("outputDirectory", m_outFileNameGen.outDir());
+  root_el.setAttribute("layoutDirection", m_layoutDirection == Qt::LeftToRight ? "LTR" : "RTL");
+
+  // These sections are cheap to rebuild compared to the filter
+  // settings, and some of them change outside of the filters
+  // anyway, like the selected page marker.
+  root_el.replaceChild(processDirectories(doc), root_el.namedItem("directories"));
+  root_el.replaceChild(processFiles(doc), root_el.namedItem("files"));
+  root_el.replaceChild(processImages(doc), root_el.namedItem("images"));
+  root_el.replaceChild(processPages(doc), root_el.namedItem("pages"));
+  root_el.replaceChild(m_outFileNameGen.disambiguator()->toXml(doc, "file-name-disambiguation",
+                                                               boost::bind(&ProjectWriter::packFilePath, this, _1)),
+                       root_el.namedItem("file-name-disambiguation"));
+
+  QDomElement filters_el(root_el.namedItem("filters").toElement());
+  QDomElement filter_el(filters_el.firstChildElement());
+  for (const FilterPtr& filter : filters) {
+    if (filter_el.isNull()) {
+      // The cached document doesn't match the filter chain.
+      cache.valid = false;
+      return write(file_path, filters, &cache);
+    }
+    if (!filter->updateSavedSettings(*this, doc, filter_el)) {
+      const QDomElement fresh_el(filter->saveSettings(*this, doc));
+      filters_el.replaceChild(fresh_el, filter_el);
+      filter_el = fresh_el;
+    }
+    filter_el = filter_el.nextSiblingElement();
+  }
+
+  return saveDocument(file_path, doc);
+}  // ProjectWriter::writeIncremental
+
+bool ProjectWriter::saveDocument(const QString& file_path, const QDomDocument& doc) const {
+  {
+    QFile file(file_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+      return false;
+    }
     QTextStream strm(&file);
     doc.save(strm, 2);
-    return true;
   }
 
-  return false;
-}  // ProjectWriter::write
+  // The sidecar makes the next open fast.  Not being able
+  // to write one is harmless.
+  ProjectSidecar::write(file_path, doc);
+
+  return true;
+}
+
+void ProjectWriter::fillIdAssignment(SaveCache& cache) const {
+  cache.pageIds.clear();
+  cache.imageIds.clear();
+
+  for (const Page& page : m_pages.get<Sequenced>()) {
+    cache.pageIds.emplace_back(page.id, page.numericId);
+  }
+  for (const Image& image : m_images.get<Sequenced>()) {
+    cache.imageIds.emplace_back(image.id, image.numericId);
+  }
+}
+
+bool ProjectWriter::matchesIdAssignment(const SaveCache& cache) const {
+  if ((cache.pageIds.size() != m_pages.size()) || (cache.imageIds.size() != m_images.size())) {
+    return false;
+  }
+
+  auto page_it(cache.pageIds.begin());
+  for (const Page& page : m_pages.get<Sequenced>()) {
+    if ((page_it->first != page.id) || (page_it->second != page.numericId)) {
+      return false;
+    }
+    ++page_it;
+  }
+
+  auto image_it(cache.imageIds.begin());
+  for (const Image& image : m_images.get<Sequenced>()) {
+    if ((image_it->first != image.id) || (image_it->second != image.numericId)) {
+      return false;
+    }
+    ++image_it;
+  }
+
+  return true;
+}
 
 QDomElement ProjectWriter::processDirectories(QDomDocument& doc) const {
   QDomElement dirs_el(doc.createElement("directories"));
@@ -133,6 +236,12 @@ QDomElement ProjectWriter::processFiles(QDomDocument& doc) const {
     file_el.setAttribute("id", file.numericId);
     file_el.setAttribute("dirId", dirId(dir_path));
     file_el.setAttribute("name", file_info.fileName());
+    const QString fingerprint(FileFingerprint::compute(file.path));
+    if (!fingerprint.isEmpty()) {
+      // Lets us detect a silently swapped file when the project is reopened.
+      file_el.setAttribute("fingerprint", fingerprint);
+      FileFingerprint::recordExpected(file.path, fingerprint);
+    }
     files_el.appendChild(file_el);
   }
 
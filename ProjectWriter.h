@@ -20,6 +20,7 @@
 #define PROJECTWRITER_H_
 
 #include <foundation/Hashes.h>
+#include <QDomDocument>
 #include <QString>
 #include <Qt>
 #include <boost/multi_index/hashed_index.hpp>
@@ -27,6 +28,7 @@
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index_container.hpp>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 #include "ImageId.h"
 #include "OutputFileNameGenerator.h"
@@ -39,7 +41,6 @@
 class AbstractFilter;
 class ProjectPages;
 class PageInfo;
-class QDomDocument;
 class QDomElement;
 
 class ProjectWriter {
@@ -54,7 +55,35 @@ class ProjectWriter {
 
   ~ProjectWriter();
 
-  bool write(const QString& file_path, const std::vector<FilterPtr>& filters) const;
+  /**
+   * \brief The document of the last successful save, for incremental
+   *        re-saving.
+   *
+   * write() fills it on request and writeIncremental() patches it in
+   * place instead of rebuilding the whole document.  The id lists
+   * record the numeric id assignment the document was built with, so
+   * that a later writer with a different assignment can be detected.
+   */
+  struct SaveCache {
+    QDomDocument doc;
+    std::vector<std::pair<PageId, int>> pageIds;
+    std::vector<std::pair<ImageId, int>> imageIds;
+    bool valid;
+
+    SaveCache() : valid(false) {}
+  };
+
+  bool write(const QString& file_path, const std::vector<FilterPtr>& filters, SaveCache* cache = nullptr) const;
+
+  /**
+   * \brief Like write(), but re-uses the cached document, only
+   *        regenerating the parts that changed since it was built.
+   *
+   * The file itself is still written out in full.  Falls back to a
+   * full write() when the cache is empty or the numeric id assignment
+   * differs from the cached one, refilling the cache along the way.
+   */
+  bool writeIncremental(const QString& file_path, const std::vector<FilterPtr>& filters, SaveCache& cache) const;
 
   /**
    * \p out will be called like this: out(ImageId, numeric_image_id)
@@ -154,6 +183,12 @@ class ProjectWriter {
 
   int pageId(const PageId& page_id) const;
 
+  bool saveDocument(const QString& file_path, const QDomDocument& doc) const;
+
+  void fillIdAssignment(SaveCache& cache) const;
+
+  bool matchesIdAssignment(const SaveCache& cache) const;
+
   void enumImagesImpl(const VirtualFunction<void, const ImageId&, int>& out) const;
 
   void enumPagesImpl(const VirtualFunction<void, const PageId&, int>& out) const;
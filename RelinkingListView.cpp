@@ -131,8 +131,8 @@ void RelinkingListView::drawStatusLayer(QPainter* painter) {
   pen.setWidthF(1.5);
   QBrush brush(QColor(0x89e74a));
 
-  // Draw existing, then missing items.
-  for (int status = RelinkingModel::Exists, i = 0; i < 2; ++i) {
+  // Draw existing, then missing, then content-mismatched items.
+  for (int status = RelinkingModel::Exists, i = 0; i < 3; ++i) {
     painter->setPen(pen);
     painter->setBrush(brush);
 
@@ -144,10 +144,17 @@ void RelinkingListView::drawStatusLayer(QPainter* painter) {
         painter->drawRoundedRect(rect, radius, radius);
       }
     }
-    // Prepare for drawing missing items.
-    status = RelinkingModel::Missing;
-    pen.setColor(QColor(0x6f2719));
-    brush.setColor(QColor(0xff674b));
+    if (i == 0) {
+      // Prepare for drawing missing items.
+      status = RelinkingModel::Missing;
+      pen.setColor(QColor(0x6f2719));
+      brush.setColor(QColor(0xff674b));
+    } else {
+      // Prepare for drawing content-mismatched items.
+      status = RelinkingModel::ContentMismatch;
+      pen.setColor(QColor(0x6f5a19));
+      brush.setColor(QColor(0xffc84b));
+    }
   }
 }  // RelinkingListView::drawStatusLayer
 
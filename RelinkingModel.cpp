@@ -27,6 +27,9 @@
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index_container.hpp>
+#include <set>
+#include <thread>
+#include "FileFingerprint.h"
 #include "OutOfMemoryHandler.h"
 #include "PayloadEvent.h"
 
@@ -84,13 +87,23 @@ class RelinkingModel::StatusUpdateThread : private QThread {
   typedef TaskList::index<HashedByPathTag>::type TasksByPath;
   typedef TaskList::index<OrderedByPriorityTag>::type TasksByPriority;
 
+  /**
+   * Path checks are I/O-bound, so a few threads probing in parallel
+   * hide most of the per-file latency of network storage.
+   */
+  static const int MAX_CHECK_THREADS = 4;
+
   void run() override;
 
+  void workerLoop();
+
+  static Status checkPath(const QString& path);
+
   RelinkingModel* m_owner;
   TaskList m_tasks;
   TasksByPath& m_tasksByPath;
   TasksByPriority& m_tasksByPriority;
-  QString m_pathBeingProcessed;
+  std::set<QString> m_pathsInProgress;
   QMutex m_mutex;
   QWaitCondition m_cond;
   bool m_exiting;
@@ -350,7 +363,7 @@ void RelinkingModel::StatusUpdateThread::requestStatusUpdate(const QString& path
     return;
   }
 
-  if (path == m_pathBeingProcessed) {
+  if (m_pathsInProgress.find(path) != m_pathsInProgress.end()) {
     // This task is currently in progress.
     return;
   }
@@ -367,7 +380,20 @@ void RelinkingModel::StatusUpdateThread::requestStatusUpdate(const QString& path
   m_cond.wakeOne();
 }
 
-void RelinkingModel::StatusUpdateThread::run() try {
+void RelinkingModel::StatusUpdateThread::run() {
+  std::vector<std::thread> extra_workers;
+  for (int i = 1; i < MAX_CHECK_THREADS; ++i) {
+    extra_workers.emplace_back(&StatusUpdateThread::workerLoop, this);
+  }
+
+  workerLoop();
+
+  for (std::thread& worker : extra_workers) {
+    worker.join();
+  }
+}
+
+void RelinkingModel::StatusUpdateThread::workerLoop() try {
   const QMutexLocker locker(&m_mutex);
 
   class MutexUnlocker {
@@ -395,25 +421,38 @@ void RelinkingModel::StatusUpdateThread::run() try {
     }
 
     const Task task(m_tasksByPriority.front());
-    m_pathBeingProcessed = task.path;
+    m_pathsInProgress.insert(task.path);
     m_tasksByPriority.pop_front();
 
     {
       const MutexUnlocker unlocker(&m_mutex);
 
-      const bool exists = QFile::exists(task.path);
-      const StatusUpdateResponse response(task.path, task.row, exists ? Exists : Missing);
+      const StatusUpdateResponse response(task.path, task.row, checkPath(task.path));
       QCoreApplication::postEvent(m_owner, new PayloadEvent<StatusUpdateResponse>(response));
     }
 
-    m_pathBeingProcessed.clear();
+    m_pathsInProgress.erase(task.path);
   }
-}  // RelinkingModel::StatusUpdateThread::run
+}  // RelinkingModel::StatusUpdateThread::workerLoop
 
 catch (const std::bad_alloc&) {
   OutOfMemoryHandler::instance().handleOutOfMemorySituation();
 }
 
+RelinkingModel::Status RelinkingModel::StatusUpdateThread::checkPath(const QString& path) {
+  if (!QFile::exists(path)) {
+    return Missing;
+  }
+
+  // Fingerprints are only recorded for files, so directories pass through.
+  const QString expected(FileFingerprint::expectedFor(path));
+  if (!expected.isEmpty() && (FileFingerprint::compute(path) != expected)) {
+    return ContentMismatch;
+  }
+
+  return Exists;
+}
+
 /*================================ Item =================================*/
 
 RelinkingModel::Item::Item(const RelinkablePath& path)
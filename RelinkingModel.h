@@ -40,7 +40,11 @@ class RelinkingModel : public QAbstractListModel {
   DECLARE_NON_COPYABLE(RelinkingModel)
 
  public:
-  enum Status { Exists, Missing, StatusUpdatePending };
+  /**
+   * ContentMismatch means the file exists but its content no longer
+   * matches the fingerprint recorded in the project file.
+   */
+  enum Status { Exists, Missing, StatusUpdatePending, ContentMismatch };
 
   enum { TypeRole = Qt::UserRole, UncommittedPathRole, UncommittedStatusRole };
 
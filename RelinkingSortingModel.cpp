@@ -33,6 +33,10 @@ bool RelinkingSortingModel::lessThan(const QModelIndex& left, const QModelIndex&
       return true;  // Missing items go before other ones.
     } else if (right_status == RelinkingModel::Missing) {
       return false;
+    } else if (left_status == RelinkingModel::ContentMismatch) {
+      return true;  // Swapped files go right after missing ones.
+    } else if (right_status == RelinkingModel::ContentMismatch) {
+      return false;
     } else if (left_status == RelinkingModel::StatusUpdatePending) {
       return true;  // These go after missing ones.
     } else if (right_status == RelinkingModel::StatusUpdatePending) {
@@ -57,6 +57,9 @@ SettingsDialog::SettingsDialog(QWidget* parent) : QDialog(parent) {
   ui.tiffCompressionBWBox->addItem(tr("LZW"), COMPRESSION_LZW);
   ui.tiffCompressionBWBox->addItem(tr("Deflate"), COMPRESSION_DEFLATE);
   ui.tiffCompressionBWBox->addItem(tr("CCITT G4"), COMPRESSION_CCITTFAX4);
+#ifdef COMPRESSION_ZSTD
+  ui.tiffCompressionBWBox->addItem(tr("Zstd"), COMPRESSION_ZSTD);
+#endif
 
   ui.tiffCompressionBWBox->setCurrentIndex(
       ui.tiffCompressionBWBox->findData(settings.value("settings/bw_compression", COMPRESSION_CCITTFAX4).toInt()));
@@ -65,10 +68,15 @@ SettingsDialog::SettingsDialog(QWidget* parent) : QDialog(parent) {
   ui.tiffCompressionColorBox->addItem(tr("LZW"), COMPRESSION_LZW);
   ui.tiffCompressionColorBox->addItem(tr("Deflate"), COMPRESSION_DEFLATE);
   ui.tiffCompressionColorBox->addItem(tr("JPEG"), COMPRESSION_JPEG);
+#ifdef COMPRESSION_ZSTD
+  ui.tiffCompressionColorBox->addItem(tr("Zstd"), COMPRESSION_ZSTD);
+#endif
 
   ui.tiffCompressionColorBox->setCurrentIndex(
       ui.tiffCompressionColorBox->findData(settings.value("settings/color_compression", COMPRESSION_LZW).toInt()));
 
+  ui.tiledTiffCB->setChecked(settings.value("settings/tiled_tiff", false).toBool());
+
   if (auto* app = dynamic_cast<Application*>(qApp)) {
     for (const QString& locale : app->getLanguagesList()) {
       QString languageName = QLocale::languageToString(QLocale(locale).language());
@@ -125,6 +133,7 @@ void SettingsDialog::commitChanges() {
 
   settings.setValue("settings/bw_compression", ui.tiffCompressionBWBox->currentData().toInt());
   settings.setValue("settings/color_compression", ui.tiffCompressionColorBox->currentData().toInt());
+  settings.setValue("settings/tiled_tiff", ui.tiledTiffCB->isChecked());
   settings.setValue("settings/language", ui.languageBox->currentData().toString());
 
   settings.setValue("settings/deskewDeviationCoef", ui.deskewDeviationCoefSB->value());
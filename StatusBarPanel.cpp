@@ -4,6 +4,7 @@
 #include <cmath>
 #include "ImageViewInfoProvider.h"
 #include "PageId.h"
+#include "PageTimingRegistry.h"
 #include "UnitsProvider.h"
 
 StatusBarPanel::StatusBarPanel() {
@@ -48,6 +49,35 @@ void StatusBarPanel::updatePage(int pageNumber, size_t pageCount, const PageId&
 
   ui.pageInfoLine->setVisible(true);
   ui.pageInfo->setText(pageFileInfo);
+
+  updatePageTiming(pageId);
+}
+
+void StatusBarPanel::updatePageTiming(const PageId& pageId) {
+  const PageTimingRegistry::PageBreakdown breakdown = PageTimingRegistry::instance().breakdownFor(pageId);
+  if (breakdown.stageSec.empty()) {
+    ui.pageTimingLine->setVisible(false);
+    ui.pageTimingLabel->clear();
+    ui.pageTimingLabel->setToolTip(QString());
+
+    return;
+  }
+
+  // In pipeline order rather than the map's alphabetic order.
+  static const char* const stage_order[]
+      = {"load", "fix_orientation", "page_split", "deskew", "select_content", "page_layout", "output"};
+
+  QString details;
+  for (const char* stage : stage_order) {
+    const auto it = breakdown.stageSec.find(stage);
+    if (it != breakdown.stageSec.end()) {
+      details += QString("%1: %2 s\n").arg(stage).arg(it->second, 0, 'f', 2);
+    }
+  }
+
+  ui.pageTimingLine->setVisible(true);
+  ui.pageTimingLabel->setText(tr("%1 s").arg(breakdown.totalSec(), 0, 'f', 1));
+  ui.pageTimingLabel->setToolTip(tr("Processing time per stage:") + QChar('\n') + details.trimmed());
 }
 
 void StatusBarPanel::clear() {
@@ -55,10 +85,12 @@ void StatusBarPanel::clear() {
   ui.physSizeLabel->clear();
   ui.pageNoLabel->clear();
   ui.pageInfo->clear();
+  ui.pageTimingLabel->clear();
 
   ui.mousePosLine->setVisible(false);
   ui.physSizeLine->setVisible(false);
   ui.pageInfoLine->setVisible(false);
+  ui.pageTimingLine->setVisible(false);
 }
 
 void StatusBarPanel::updateUnits(Units) {
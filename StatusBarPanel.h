@@ -30,6 +30,12 @@ class StatusBarPanel : public QWidget, public UnitsObserver, public ImageViewInf
 
   void updatePage(int pageNumber, size_t pageCount, const PageId& pageId);
 
+  /**
+   * Refreshes the processing time shown for the current page from
+   * PageTimingRegistry.
+   */
+  void updatePageTiming(const PageId& pageId);
+
   void clear();
 
   void updateUnits(Units) override;
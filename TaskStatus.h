@@ -19,6 +19,8 @@
 #ifndef TASKSTATUS_H_
 #define TASKSTATUS_H_
 
+#include "FilterResult.h"
+
 class TaskStatus {
  public:
   virtual ~TaskStatus() = default;
@@ -28,6 +30,15 @@ class TaskStatus {
   virtual bool isCancelled() const = 0;
 
   virtual void throwIfCancelled() const = 0;
+
+  /**
+   * \brief Hands a preliminary result to whoever is running the task.
+   *
+   * Long-running tasks may call this to get something on screen before
+   * their final result is ready.  The default implementation simply
+   * discards the result, so calling this is always safe.
+   */
+  virtual void deliverIntermediateResult(const FilterResultPtr&) const {}
 };
 
 
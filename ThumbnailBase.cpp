@@ -62,7 +62,8 @@ ThumbnailBase::ThumbnailBase(intrusive_ptr<ThumbnailPixmapCache> thumbnail_cache
       m_imageId(image_id),
       m_imageXform(image_xform),
       m_extendedClipArea(false),
-      m_displayArea(displayArea) {
+      m_displayArea(displayArea),
+      m_cachedSourceKey(-1) {
   setImageXform(m_imageXform);
 }
 
@@ -77,7 +78,11 @@ void ThumbnailBase::paint(QPainter* painter, const QStyleOptionGraphicsItem* opt
 
   if (!m_completionHandler) {
     std::shared_ptr<LoadCompletionHandler> handler(new LoadCompletionHandler(this));
-    const ThumbnailPixmapCache::Status status = m_thumbnailCache->loadRequest(m_imageId, pixmap, handler);
+    // Ask for a pyramid level close to the size we are actually going
+    // to paint at, so that changing the thumbnail size doesn't force
+    // a full-quality rescale of every visible item.
+    const QSize desired_size(painter->worldTransform().mapRect(m_boundingRect).size().toSize());
+    const ThumbnailPixmapCache::Status status = m_thumbnailCache->loadRequest(m_imageId, pixmap, handler, desired_size);
     if (status == ThumbnailPixmapCache::QUEUED) {
       m_completionHandler.swap(handler);
     }
@@ -120,6 +125,34 @@ void ThumbnailBase::paint(QPainter* painter, const QStyleOptionGraphicsItem* opt
 
   QRectF display_rect(image_to_display.map(PolygonUtils::round(m_displayArea)).boundingRect().toAlignedRect());
 
+  QTransform temp_adjustment;
+  temp_adjustment.translate(-display_rect.left(), -display_rect.top());
+
+  const QTransform pixmap_to_display(pixmap_to_thumb * thumb_to_display);
+
+  // Warping the pixmap is by far the most expensive part of painting,
+  // yet most repaints (selection changes in particular) change neither
+  // the pixmap, nor the transformation, nor the scale.  Cache the warped
+  // result and re-render it only when one of those actually changes,
+  // turning ordinary repaints into simple blits.
+  if ((m_cachedSourceKey != pixmap.cacheKey()) || (m_cachedPixmapToDisplay != pixmap_to_display)
+      || (m_cachedTransformedPixmap.width() != (int) display_rect.width())
+      || (m_cachedTransformedPixmap.height() != (int) display_rect.height())) {
+    m_cachedTransformedPixmap = QPixmap((int) display_rect.width(), (int) display_rect.height());
+    m_cachedTransformedPixmap.fill(Qt::transparent);
+
+    QPainter cache_painter(&m_cachedTransformedPixmap);
+    cache_painter.setWorldTransform(pixmap_to_display * temp_adjustment);
+    cache_painter.setCompositionMode(QPainter::CompositionMode_Source);
+    cache_painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    cache_painter.setRenderHint(QPainter::Antialiasing);
+    PixmapRenderer::drawPixmap(cache_painter, pixmap);
+    cache_painter.end();
+
+    m_cachedSourceKey = pixmap.cacheKey();
+    m_cachedPixmapToDisplay = pixmap_to_display;
+  }
+
   QPixmap temp_pixmap;
   const QString cache_key(QString::fromLatin1("ThumbnailBase::temp_pixmap"));
   if (!QPixmapCache::find(cache_key, temp_pixmap) || (temp_pixmap.width() < display_rect.width())
@@ -143,19 +176,14 @@ void ThumbnailBase::paint(QPainter* painter, const QStyleOptionGraphicsItem* opt
   QPainter temp_painter;
   temp_painter.begin(&temp_pixmap);
 
-  QTransform temp_adjustment;
-  temp_adjustment.translate(-display_rect.left(), -display_rect.top());
-
-  temp_painter.setWorldTransform(pixmap_to_thumb * thumb_to_display * temp_adjustment);
-
-  // Turn off alpha compositing.
+  // Blit the cached warped pixmap.  CompositionMode_Source both transfers
+  // its alpha channel and wipes whatever a previous item left in the
+  // shared temporary pixmap.
   temp_painter.setCompositionMode(QPainter::CompositionMode_Source);
+  temp_painter.drawPixmap(QPointF(0, 0), m_cachedTransformedPixmap);
 
-  temp_painter.setRenderHint(QPainter::SmoothPixmapTransform);
   temp_painter.setRenderHint(QPainter::Antialiasing);
 
-  PixmapRenderer::drawPixmap(temp_painter, pixmap);
-
   // Turn alpha compositing on again.
   temp_painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
   // Setup the painter for drawing in thumbnail coordinates,
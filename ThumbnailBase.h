@@ -20,6 +20,7 @@
 #define THUMBNAILBASE_H_
 
 #include <QGraphicsItem>
+#include <QPixmap>
 #include <QRectF>
 #include <QSizeF>
 #include <QTransform>
@@ -124,6 +125,16 @@ class ThumbnailBase : public QGraphicsItem {
    */
   QTransform m_postScaleXform;
 
+  /**
+   * The thumbnail pixmap warped to display coordinates, along with the
+   * keys it was rendered for.  Repaints that change neither the pixmap,
+   * nor the transformation, nor the scale (selection changes in
+   * particular) reuse it as a simple blit.
+   */
+  QPixmap m_cachedTransformedPixmap;
+  qint64 m_cachedSourceKey;
+  QTransform m_cachedPixmapToDisplay;
+
   std::shared_ptr<LoadCompletionHandler> m_completionHandler;
   bool m_extendedClipArea;
 };
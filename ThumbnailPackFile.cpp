@@ -0,0 +1,288 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ThumbnailPackFile.h"
+#include <QMutexLocker>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+const char MAGIC[4] = {'S', 'T', 'P', 'K'};
+const quint32 VERSION = 1;
+const int FILE_HEADER_SIZE = 16;
+const int KEY_SIZE = 16;
+const int RECORD_HEADER_SIZE = KEY_SIZE + 6 * sizeof(quint32);
+
+/** No sane thumbnail occupies this much; anything bigger means corruption. */
+const quint32 MAX_RECORD_DATA_SIZE = 64 * 1024 * 1024;
+
+qint64 alignUp(qint64 offset) {
+  // Records start on 8-byte boundaries, which keeps the pixel data of
+  // 32-bit formats suitably aligned for QImage.
+  return (offset + 7) & ~qint64(7);
+}
+
+bool isStorableFormat(const quint32 format) {
+  switch ((QImage::Format) format) {
+    case QImage::Format_Grayscale8:
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+      return true;
+    default:
+      return false;
+  }
+}
+}  // namespace
+
+ThumbnailPackFile::ThumbnailPackFile(const QString& file_path)
+    : m_file(file_path), m_valid(false), m_mapped(nullptr), m_mappedBytes(0), m_pendingBytes(0) {
+  m_valid = openAndScan();
+}
+
+ThumbnailPackFile::~ThumbnailPackFile() {
+  const QMutexLocker locker(&m_mutex);
+  flushLocked();
+}
+
+QImage ThumbnailPackFile::load(const QByteArray& key) {
+  const QMutexLocker locker(&m_mutex);
+
+  if (!m_valid) {
+    return QImage();
+  }
+
+  // Records not yet written out are searched newest first,
+  // as a replacement may still be sitting behind the original.
+  for (auto it = m_pending.rbegin(); it != m_pending.rend(); ++it) {
+    if (it->key == key) {
+      return it->image;
+    }
+  }
+
+  const auto index_it(m_index.find(key));
+  if (index_it == m_index.end()) {
+    return QImage();
+  }
+
+  const IndexEntry& entry = *index_it;
+  if (!ensureMappedLocked(entry.pixelOffset + entry.dataSize)) {
+    return QImage();
+  }
+
+  const QImage wrapper(m_mapped + entry.pixelOffset, entry.width, entry.height, entry.bytesPerLine,
+                       (QImage::Format) entry.format);
+
+  // The deep copy detaches the result from the mapping, which may be
+  // replaced by a later remap.  It's still a plain copy out of the
+  // page cache, with no file open and no PNG decoding.
+  return wrapper.copy();
+}
+
+bool ThumbnailPackFile::contains(const QByteArray& key) {
+  const QMutexLocker locker(&m_mutex);
+
+  if (!m_valid) {
+    return false;
+  }
+
+  for (const PendingRecord& record : m_pending) {
+    if (record.key == key) {
+      return true;
+    }
+  }
+
+  return m_index.contains(key);
+}
+
+void ThumbnailPackFile::store(const QByteArray& key, const QImage& thumbnail) {
+  if (thumbnail.isNull() || (key.size() != KEY_SIZE)) {
+    return;
+  }
+
+  const QImage image(toStorageFormat(thumbnail));
+
+  const QMutexLocker locker(&m_mutex);
+
+  if (!m_valid) {
+    return;
+  }
+
+  m_pending.push_back(PendingRecord{key, image});
+  m_pendingBytes += (size_t) image.bytesPerLine() * image.height();
+
+  if (m_pendingBytes >= FLUSH_THRESHOLD_BYTES) {
+    flushLocked();
+  }
+}
+
+void ThumbnailPackFile::flush() {
+  const QMutexLocker locker(&m_mutex);
+  flushLocked();
+}
+
+bool ThumbnailPackFile::openAndScan() {
+  if (!m_file.open(QIODevice::ReadWrite)) {
+    return false;
+  }
+
+  if (m_file.size() < FILE_HEADER_SIZE) {
+    // A new (or hopelessly short) file.  Write a fresh header.
+    char header[FILE_HEADER_SIZE] = {0};
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    qToLittleEndian(VERSION, (uchar*) header + sizeof(MAGIC));
+
+    return m_file.resize(0) && (m_file.write(header, FILE_HEADER_SIZE) == FILE_HEADER_SIZE);
+  }
+
+  char header[FILE_HEADER_SIZE];
+  if (m_file.read(header, FILE_HEADER_SIZE) != FILE_HEADER_SIZE) {
+    return false;
+  }
+  if ((memcmp(header, MAGIC, sizeof(MAGIC)) != 0)
+      || (qFromLittleEndian<quint32>((const uchar*) header + sizeof(MAGIC)) != VERSION)) {
+    // Not our file or a future version.  Thumbnails are a regenerable
+    // cache, so starting over beats refusing to work.
+    char fresh[FILE_HEADER_SIZE] = {0};
+    memcpy(fresh, MAGIC, sizeof(MAGIC));
+    qToLittleEndian(VERSION, (uchar*) fresh + sizeof(MAGIC));
+
+    return m_file.resize(0) && (m_file.write(fresh, FILE_HEADER_SIZE) == FILE_HEADER_SIZE);
+  }
+
+  // Rebuild the index by walking the record headers.  Only the headers
+  // are read; the pixel data is skipped over.
+  const qint64 file_size = m_file.size();
+  qint64 pos = FILE_HEADER_SIZE;
+  while (pos + RECORD_HEADER_SIZE <= file_size) {
+    char record_header[RECORD_HEADER_SIZE];
+    if (!m_file.seek(pos) || (m_file.read(record_header, RECORD_HEADER_SIZE) != RECORD_HEADER_SIZE)) {
+      return false;
+    }
+
+    const uchar* fields = (const uchar*) record_header + KEY_SIZE;
+    IndexEntry entry;
+    entry.pixelOffset = pos + RECORD_HEADER_SIZE;
+    entry.width = qFromLittleEndian<quint32>(fields);
+    entry.height = qFromLittleEndian<quint32>(fields + 4);
+    entry.bytesPerLine = qFromLittleEndian<quint32>(fields + 8);
+    entry.format = qFromLittleEndian<quint32>(fields + 12);
+    entry.dataSize = qFromLittleEndian<quint32>(fields + 16);
+
+    const bool sane = isStorableFormat(entry.format) && (entry.dataSize <= MAX_RECORD_DATA_SIZE)
+                      && (entry.dataSize == entry.bytesPerLine * entry.height) && (entry.width > 0)
+                      && (entry.height > 0);
+    if (!sane || (entry.pixelOffset + entry.dataSize > file_size)) {
+      // A partially written tail, most likely from a crash mid-append.
+      // Cut it off and carry on with what we have.
+      m_file.resize(pos);
+      break;
+    }
+
+    m_index.insert(QByteArray(record_header, KEY_SIZE), entry);
+    pos = alignUp(entry.pixelOffset + entry.dataSize);
+  }
+
+  return true;
+}  // ThumbnailPackFile::openAndScan
+
+bool ThumbnailPackFile::ensureMappedLocked(const qint64 end_offset) {
+  if (m_mapped && (end_offset <= m_mappedBytes)) {
+    return true;
+  }
+
+  if (m_mapped) {
+    m_file.unmap(const_cast<uchar*>(m_mapped));
+    m_mapped = nullptr;
+    m_mappedBytes = 0;
+  }
+
+  const qint64 file_size = m_file.size();
+  if (end_offset > file_size) {
+    return false;
+  }
+
+  m_mapped = m_file.map(0, file_size);
+  if (!m_mapped) {
+    return false;
+  }
+  m_mappedBytes = file_size;
+
+  return true;
+}
+
+void ThumbnailPackFile::flushLocked() {
+  if (m_pending.empty() || !m_valid) {
+    return;
+  }
+
+  qint64 pos = alignUp(m_file.size());
+  if (!m_file.resize(pos) || !m_file.seek(pos)) {
+    m_valid = false;
+    return;
+  }
+
+  for (const PendingRecord& record : m_pending) {
+    const QImage& image = record.image;
+    const quint32 data_size = (quint32) image.bytesPerLine() * image.height();
+
+    char record_header[RECORD_HEADER_SIZE] = {0};
+    memcpy(record_header, record.key.constData(), KEY_SIZE);
+    uchar* fields = (uchar*) record_header + KEY_SIZE;
+    qToLittleEndian((quint32) image.width(), fields);
+    qToLittleEndian((quint32) image.height(), fields + 4);
+    qToLittleEndian((quint32) image.bytesPerLine(), fields + 8);
+    qToLittleEndian((quint32) image.format(), fields + 12);
+    qToLittleEndian(data_size, fields + 16);
+
+    static const char zeros[8] = {0};
+    const qint64 padded_end = alignUp(pos + RECORD_HEADER_SIZE + data_size);
+    if ((m_file.write(record_header, RECORD_HEADER_SIZE) != RECORD_HEADER_SIZE)
+        || (m_file.write((const char*) image.constBits(), data_size) != data_size)
+        || (m_file.write(zeros, padded_end - (pos + RECORD_HEADER_SIZE + data_size)) < 0)) {
+      m_valid = false;
+      return;
+    }
+
+    IndexEntry entry;
+    entry.pixelOffset = pos + RECORD_HEADER_SIZE;
+    entry.width = image.width();
+    entry.height = image.height();
+    entry.bytesPerLine = image.bytesPerLine();
+    entry.format = image.format();
+    entry.dataSize = data_size;
+    m_index.insert(record.key, entry);
+
+    pos = padded_end;
+  }
+
+  m_file.flush();
+  m_pending.clear();
+  m_pendingBytes = 0;
+}  // ThumbnailPackFile::flushLocked
+
+QImage ThumbnailPackFile::toStorageFormat(const QImage& image) {
+  if (isStorableFormat(image.format())) {
+    return image;
+  }
+
+  if (image.isGrayscale()) {
+    return image.convertToFormat(QImage::Format_Grayscale8);
+  }
+
+  return image.convertToFormat(QImage::Format_ARGB32);
+}
@@ -0,0 +1,115 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THUMBNAILPACKFILE_H_
+#define THUMBNAILPACKFILE_H_
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+#include <vector>
+#include "NonCopyable.h"
+
+/**
+ * \brief A single append-only file holding all thumbnails of a project.
+ *
+ * Storing each thumbnail as an individual PNG means that opening the
+ * thumbnail view of a large project issues thousands of small file
+ * reads.  This class packs raw, fixed-format pixel blobs into one file
+ * behind an in-memory index, so that after a single mmap a thumbnail
+ * load is little more than a copy out of the page cache.  New
+ * thumbnails are buffered and appended to the file in batches.
+ *
+ * Replacing a thumbnail appends a new record under the same key.  The
+ * index always points to the newest record, and the newest record wins
+ * when the index is rebuilt on open.  A record that was only partially
+ * written (the process crashed mid-append) is truncated away on open.
+ *
+ * All methods may be called from any thread, even concurrently.
+ */
+class ThumbnailPackFile {
+  DECLARE_NON_COPYABLE(ThumbnailPackFile)
+
+ public:
+  explicit ThumbnailPackFile(const QString& file_path);
+
+  /**
+   * Flushes any batched records to disk.
+   */
+  ~ThumbnailPackFile();
+
+  /**
+   * \brief Returns the thumbnail stored under \p key, or a null image.
+   *
+   * \p key is an opaque 16-byte identifier chosen by the caller.
+   */
+  QImage load(const QByteArray& key);
+
+  bool contains(const QByteArray& key);
+
+  /**
+   * \brief Stores or replaces the thumbnail under \p key.
+   *
+   * The record is buffered and written out together with other pending
+   * records, but becomes visible to load() immediately.
+   */
+  void store(const QByteArray& key, const QImage& thumbnail);
+
+  void flush();
+
+ private:
+  struct IndexEntry {
+    qint64 pixelOffset;
+    quint32 width;
+    quint32 height;
+    quint32 bytesPerLine;
+    quint32 format;
+    quint32 dataSize;
+  };
+
+  struct PendingRecord {
+    QByteArray key;
+    QImage image;
+  };
+
+  /** Pending records are written out once they accumulate this much pixel data. */
+  enum { FLUSH_THRESHOLD_BYTES = 4 * 1024 * 1024 };
+
+  bool openAndScan();
+
+  bool ensureMappedLocked(qint64 end_offset);
+
+  void flushLocked();
+
+  static QImage toStorageFormat(const QImage& image);
+
+  QMutex m_mutex;
+  QFile m_file;
+  bool m_valid;
+  const uchar* m_mapped;
+  qint64 m_mappedBytes;
+  QHash<QByteArray, IndexEntry> m_index;
+  std::vector<PendingRecord> m_pending;
+  size_t m_pendingBytes;
+};
+
+
+#endif  // ifndef THUMBNAILPACKFILE_H_
@@ -23,16 +23,21 @@
 #include <QDir>
 #include <QFileInfo>
 #include <QThread>
+#include "ParallelFor.h"
 #include <boost/foreach.hpp>
+#include <chrono>
+#include <deque>
+#include <vector>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index_container.hpp>
-#include "AtomicFileOverwriter.h"
 #include "ImageId.h"
 #include "ImageLoader.h"
+#include "MemoryBudgetManager.h"
 #include "OutOfMemoryHandler.h"
 #include "RelinkablePath.h"
+#include "ThumbnailPackFile.h"
 #include "imageproc/GrayImage.h"
 #include "imageproc/Scale.h"
 
@@ -68,12 +73,22 @@ class ThumbnailPixmapCache::Item {
     LOAD_FAILED
   };
 
+  enum { NUM_MIP_LEVELS = 2 };
+
   ImageId imageId;
 
   mutable QPixmap pixmap;
 
   /**< Guaranteed to be set if status is LOADED */
 
+  /**
+   * Progressively halved versions of \p pixmap ([0] is half size,
+   * [1] is quarter size), filled lazily.  Painting a small on-screen
+   * thumbnail can then start from a size close to the target instead
+   * of smooth-scaling the full-quality pixmap down every time.
+   */
+  mutable QPixmap mipLevels[NUM_MIP_LEVELS];
+
   mutable std::vector<std::weak_ptr<CompletionHandler>> completionHandlers;
 
   /**
@@ -95,6 +110,39 @@ class ThumbnailPixmapCache::Item {
 };
 
 
+namespace {
+/**
+ * \brief Temporarily raises a below-normal thread back to normal priority.
+ *
+ * Batch worker threads run below normal priority so the thumbnail
+ * decode lane can preempt them.  While such a thread holds a lock the
+ * decode lane also needs (the cache mutex, the pack file), being
+ * preempted would block the lane on the very thread it outranks - the
+ * classic priority inversion.  Qt mutexes don't implement priority
+ * inheritance, so the lock-holding sections boost themselves instead.
+ */
+class ScopedPriorityBoost {
+ public:
+  ScopedPriorityBoost() : m_thread(QThread::currentThread()), m_savedPriority(m_thread->priority()) {
+    if ((m_savedPriority != QThread::InheritPriority) && (m_savedPriority < QThread::NormalPriority)) {
+      m_thread->setPriority(QThread::NormalPriority);
+    } else {
+      m_thread = nullptr;
+    }
+  }
+
+  ~ScopedPriorityBoost() {
+    if (m_thread) {
+      m_thread->setPriority(m_savedPriority);
+    }
+  }
+
+ private:
+  QThread* m_thread;
+  const QThread::Priority m_savedPriority;
+};
+}  // namespace
+
 class ThumbnailPixmapCache::Impl : public QThread {
  public:
   Impl(const QString& thumb_dir, const QSize& max_thumb_size, int max_cached_pixmaps, int expiration_threshold);
@@ -110,12 +158,21 @@ class ThumbnailPixmapCache::Impl : public QThread {
   Status request(const ImageId& image_id,
                  QPixmap& pixmap,
                  bool load_now = false,
-                 const std::weak_ptr<CompletionHandler>* completion_handler = nullptr);
+                 const std::weak_ptr<CompletionHandler>* completion_handler = nullptr,
+                 const QSize& desired_size = QSize());
 
   void ensureThumbnailExists(const ImageId& image_id, const QImage& image);
 
   void recreateThumbnail(const ImageId& image_id, const QImage& image);
 
+  void schedulePregeneration(const std::vector<ImageId>& image_ids);
+
+  void cancelPregeneration();
+
+  Stats stats() const;
+
+  void releaseCachedPixmaps();
+
  protected:
   void run() override;
 
@@ -152,10 +209,17 @@ class ThumbnailPixmapCache::Impl : public QThread {
 
   void backgroundProcessing();
 
-  static QImage loadSaveThumbnail(const ImageId& image_id, const QString& thumb_dir, const QSize& max_thumb_size);
+  static QImage loadSaveThumbnail(const ImageId& image_id,
+                                  const QString& thumb_dir,
+                                  const QSize& max_thumb_size,
+                                  const std::shared_ptr<ThumbnailPackFile>& pack);
 
   static QString getThumbFilePath(const ImageId& image_id, const QString& thumb_dir, const QSize& max_thumb_size);
 
+  static QByteArray thumbKey(const QString& thumb_file_path);
+
+  static QPixmap selectMipLevel(const Item& item, const QSize& desired_size);
+
   static QImage makeThumbnail(const QImage& image, const QSize& max_thumb_size);
 
   void queuedToInProgress(const LoadQueue::iterator& lq_it);
@@ -174,6 +238,11 @@ class ThumbnailPixmapCache::Impl : public QThread {
 
   void cachePixmapLocked(const ImageId& image_id, const QPixmap& pixmap);
 
+  /** Accounts a completed disk load.  Takes the mutex itself. */
+  void recordDiskLoad(double elapsed_ms);
+
+  static size_t pixmapBytes(const QPixmap& pixmap);
+
   mutable QMutex m_mutex;
   BackgroundLoader m_backgroundLoader;
   Container m_items;
@@ -203,7 +272,22 @@ class ThumbnailPixmapCache::Impl : public QThread {
    */
   RemoveQueue::iterator m_endOfLoadedItems;
 
+  /**
+   * Images whose on-disk thumbnails are to be created opportunistically.
+   * This queue is only serviced when m_loadQueue has no QUEUED items,
+   * so interactive requests always come first.
+   */
+  std::deque<ImageId> m_pregenQueue;
+
   QString m_thumbDir;
+
+  /**
+   * All thumbnails of a project in a single memory-mapped file.
+   * The per-file PNG store is only consulted (and imported from)
+   * when a thumbnail is not in the pack.
+   */
+  std::shared_ptr<ThumbnailPackFile> m_packFile;
+
   QSize m_maxThumbSize;
   int m_maxCachedPixmaps;
 
@@ -223,6 +307,9 @@ class ThumbnailPixmapCache::Impl : public QThread {
 
   bool m_threadStarted;
   bool m_shuttingDown;
+
+  /** Everything here except residentBytes, which is computed on demand. */
+  Stats m_stats;
 };
 
 
@@ -254,9 +341,13 @@ ThumbnailPixmapCache::ThumbnailPixmapCache(const QString& thumb_dir,
                                            const int max_cached_pixmaps,
                                            const int expiration_threshold)
     : m_impl(new Impl(RelinkablePath::normalize(thumb_dir), max_thumb_size, max_cached_pixmaps, expiration_threshold)) {
+  m_evictableId = MemoryBudgetManager::instance().registerEvictable(MemoryBudgetManager::THUMBNAIL_PIXMAPS,
+                                                                    [this]() { releaseCachedPixmaps(); });
 }
 
-ThumbnailPixmapCache::~ThumbnailPixmapCache() = default;
+ThumbnailPixmapCache::~ThumbnailPixmapCache() {
+  MemoryBudgetManager::instance().unregisterEvictable(m_evictableId);
+}
 
 void ThumbnailPixmapCache::setThumbDir(const QString& thumb_dir) {
   m_impl->setThumbDir(RelinkablePath::normalize(thumb_dir));
@@ -273,8 +364,9 @@ ThumbnailPixmapCache::Status ThumbnailPixmapCache::loadNow(const ImageId& image_
 ThumbnailPixmapCache::Status ThumbnailPixmapCache::loadRequest(
     const ImageId& image_id,
     QPixmap& pixmap,
-    const std::weak_ptr<CompletionHandler>& completion_handler) {
-  return m_impl->request(image_id, pixmap, false, &completion_handler);
+    const std::weak_ptr<CompletionHandler>& completion_handler,
+    const QSize& desired_size) {
+  return m_impl->request(image_id, pixmap, false, &completion_handler, desired_size);
 }
 
 void ThumbnailPixmapCache::ensureThumbnailExists(const ImageId& image_id, const QImage& image) {
@@ -285,10 +377,26 @@ void ThumbnailPixmapCache::recreateThumbnail(const ImageId& image_id, const QIma
   m_impl->recreateThumbnail(image_id, image);
 }
 
+void ThumbnailPixmapCache::schedulePregeneration(const std::vector<ImageId>& image_ids) {
+  m_impl->schedulePregeneration(image_ids);
+}
+
+void ThumbnailPixmapCache::cancelPregeneration() {
+  m_impl->cancelPregeneration();
+}
+
+ThumbnailPixmapCache::Stats ThumbnailPixmapCache::stats() const {
+  return m_impl->stats();
+}
+
 void ThumbnailPixmapCache::setMaxThumbSize(const QSize& max_size) {
   m_impl->setMaxThumbSize(max_size);
 }
 
+void ThumbnailPixmapCache::releaseCachedPixmaps() {
+  m_impl->releaseCachedPixmaps();
+}
+
 const QSize& ThumbnailPixmapCache::getMaxThumbSize() const {
   return m_impl->getMaxThumbSize();
 }
@@ -320,6 +428,8 @@ ThumbnailPixmapCache::Impl::Impl(const QString& thumb_dir,
   // a whole bunch of bogus directories would be created.
   QDir().mkdir(m_thumbDir);
 
+  m_packFile = std::make_shared<ThumbnailPackFile>(m_thumbDir + QLatin1String("/thumbs.pack"));
+
   m_backgroundLoader.moveToThread(this);
 }
 
@@ -346,6 +456,12 @@ void ThumbnailPixmapCache::Impl::setThumbDir(const QString& thumb_dir) {
   }
 
   m_thumbDir = thumb_dir;
+  // Pending records of the old pack get flushed when the last
+  // reference to it (possibly held by a load in flight) goes away.
+  m_packFile = std::make_shared<ThumbnailPackFile>(thumb_dir + QLatin1String("/thumbs.pack"));
+
+  // Pending pregeneration work belongs to the old directory.
+  m_pregenQueue.clear();
 
   for (const Item& item : m_loadQueue) {
     // This trick will make all queued tasks to expire.
@@ -357,7 +473,8 @@ ThumbnailPixmapCache::Status ThumbnailPixmapCache::Impl::request(
     const ImageId& image_id,
     QPixmap& pixmap,
     const bool load_now,
-    const std::weak_ptr<CompletionHandler>* completion_handler) {
+    const std::weak_ptr<CompletionHandler>* completion_handler,
+    const QSize& desired_size) {
   assert(QCoreApplication::instance()->thread() == QThread::currentThread());
 
   QMutexLocker locker(&m_mutex);
@@ -367,9 +484,14 @@ ThumbnailPixmapCache::Status ThumbnailPixmapCache::Impl::request(
   }
 
   const ItemsByKey::iterator k_it(m_itemsByKey.find(image_id));
+  if (k_it == m_itemsByKey.end()) {
+    // Nothing in memory: whatever happens next involves the disk.
+    ++m_stats.misses;
+  }
   if (k_it != m_itemsByKey.end()) {
     if (k_it->status == Item::LOADED) {
-      pixmap = k_it->pixmap;
+      ++m_stats.memHits;
+      pixmap = selectMipLevel(*k_it, desired_size);
 
       // Move it after all other candidates for removal.
       const RemoveQueue::iterator rq_it(m_items.project<RemoveQueueTag>(k_it));
@@ -386,10 +508,13 @@ ThumbnailPixmapCache::Status ThumbnailPixmapCache::Impl::request(
   if (load_now) {
     const QString thumb_dir(m_thumbDir);
     const QSize max_thumb_size(m_maxThumbSize);
+    const std::shared_ptr<ThumbnailPackFile> pack(m_packFile);
 
     locker.unlock();
 
-    pixmap = QPixmap::fromImage(loadSaveThumbnail(image_id, thumb_dir, max_thumb_size));
+    const auto load_start = std::chrono::steady_clock::now();
+    pixmap = QPixmap::fromImage(loadSaveThumbnail(image_id, thumb_dir, max_thumb_size, pack));
+    recordDiskLoad(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load_start).count());
     if (pixmap.isNull()) {
       return LOAD_FAILED;
     }
@@ -456,23 +581,22 @@ void ThumbnailPixmapCache::Impl::ensureThumbnailExists(const ImageId& image_id,
     return;
   }
 
+  // Likely called from a below-normal-priority batch thread.
+  const ScopedPriorityBoost priority_boost;
+
   QMutexLocker locker(&m_mutex);
   const QString thumb_dir(m_thumbDir);
   const QSize max_thumb_size(m_maxThumbSize);
+  const std::shared_ptr<ThumbnailPackFile> pack(m_packFile);
   locker.unlock();
 
-  const QString thumb_file_path(getThumbFilePath(image_id, thumb_dir, m_maxThumbSize));
-  if (QFile::exists(thumb_file_path)) {
+  const QString thumb_file_path(getThumbFilePath(image_id, thumb_dir, max_thumb_size));
+  const QByteArray key(thumbKey(thumb_file_path));
+  if (pack->contains(key) || QFile::exists(thumb_file_path)) {
     return;
   }
 
-  const QImage thumbnail(makeThumbnail(image, max_thumb_size));
-
-  AtomicFileOverwriter overwriter;
-  QIODevice* iodev = overwriter.startWriting(thumb_file_path);
-  if (iodev && thumbnail.save(iodev, "PNG")) {
-    overwriter.commit();
-  }
+  pack->store(key, makeThumbnail(image, max_thumb_size));
 }
 
 void ThumbnailPixmapCache::Impl::recreateThumbnail(const ImageId& image_id, const QImage& image) {
@@ -484,27 +608,22 @@ void ThumbnailPixmapCache::Impl::recreateThumbnail(const ImageId& image_id, cons
     return;
   }
 
+  // Likely called from a below-normal-priority batch thread.
+  const ScopedPriorityBoost priority_boost;
+
   QMutexLocker locker(&m_mutex);
   const QString thumb_dir(m_thumbDir);
   const QSize max_thumb_size(m_maxThumbSize);
+  const std::shared_ptr<ThumbnailPackFile> pack(m_packFile);
   locker.unlock();
 
-  const QString thumb_file_path(getThumbFilePath(image_id, thumb_dir, m_maxThumbSize));
+  const QString thumb_file_path(getThumbFilePath(image_id, thumb_dir, max_thumb_size));
   const QImage thumbnail(makeThumbnail(image, max_thumb_size));
-  bool thumb_written = false;
 
   // Note that we may be called from multiple threads at the same time.
-  AtomicFileOverwriter overwriter;
-  QIODevice* iodev = overwriter.startWriting(thumb_file_path);
-  if (iodev && thumbnail.save(iodev, "PNG")) {
-    thumb_written = overwriter.commit();
-  } else {
-    overwriter.abort();
-  }
-
-  if (!thumb_written) {
-    return;
-  }
+  // The pack always serves its newest record, so a stale per-file
+  // thumbnail left behind by an older version is harmless.
+  pack->store(thumbKey(thumb_file_path), thumbnail);
 
   const QMutexLocker locker2(&m_mutex);
 
@@ -531,13 +650,55 @@ void ThumbnailPixmapCache::Impl::recreateThumbnail(const ImageId& image_id, cons
   }
 }  // ThumbnailPixmapCache::Impl::recreateThumbnail
 
+void ThumbnailPixmapCache::Impl::schedulePregeneration(const std::vector<ImageId>& image_ids) {
+  const QMutexLocker locker(&m_mutex);
+
+  if (m_shuttingDown || image_ids.empty()) {
+    return;
+  }
+
+  m_pregenQueue.insert(m_pregenQueue.end(), image_ids.begin(), image_ids.end());
+
+  if (m_threadStarted) {
+    // Wake the background thread up.
+    QCoreApplication::postEvent(&m_backgroundLoader, new QEvent(QEvent::User));
+  } else {
+    // Start the background thread.
+    start();
+    m_threadStarted = true;
+  }
+}
+
+void ThumbnailPixmapCache::Impl::cancelPregeneration() {
+  const QMutexLocker locker(&m_mutex);
+  m_pregenQueue.clear();
+}
+
 void ThumbnailPixmapCache::Impl::run() {
   backgroundProcessing();
   exec();  // Wait for further processing requests (via custom events).
 }
 
 void ThumbnailPixmapCache::Impl::customEvent(QEvent* e) {
-  processLoadResult(dynamic_cast<LoadResultEvent*>(e));
+  if (auto* evt = dynamic_cast<LoadResultEvent*>(e)) {
+    processLoadResult(evt);
+
+    return;
+  }
+
+  // A request to shed the in-memory pixmaps, posted from a non-GUI thread.
+  const QMutexLocker locker(&m_mutex);
+  removeLoadedItemsLocked();
+}
+
+void ThumbnailPixmapCache::Impl::releaseCachedPixmaps() {
+  if (QCoreApplication::instance()->thread() == QThread::currentThread()) {
+    const QMutexLocker locker(&m_mutex);
+    removeLoadedItemsLocked();
+  } else {
+    // QPixmap may only be touched by the GUI thread, so hop there.
+    QCoreApplication::postEvent(this, new QEvent(QEvent::User));
+  }
 }
 
 void ThumbnailPixmapCache::Impl::backgroundProcessing() {
@@ -547,56 +708,105 @@ void ThumbnailPixmapCache::Impl::backgroundProcessing() {
   while (true) {
     try {
       // We are going to initialize these while holding the mutex.
-      LoadQueue::iterator lq_it;
-      ImageId image_id;
+      std::vector<LoadQueue::iterator> batch;
+      std::vector<ImageId> image_ids;
+      ImageId pregen_image_id;
       QString thumb_dir;
       QSize max_thumb_size;
+      std::shared_ptr<ThumbnailPackFile> pack;
+      bool pregenerate = false;
+
+      // Consecutive requests are independent, so up to this many of
+      // them are claimed at once and decoded concurrently below.
+      const int max_batch = parallelForNumThreads();
 
       {
         const QMutexLocker locker(&m_mutex);
 
-        if (m_shuttingDown || m_items.empty()) {
+        if (m_shuttingDown) {
           break;
         }
 
-        lq_it = m_loadQueue.begin();
-        image_id = lq_it->imageId;
+        while (int(batch.size()) < max_batch && !m_items.empty() && (m_loadQueue.begin()->status == Item::QUEUED)) {
+          const LoadQueue::iterator lq_it(m_loadQueue.begin());
 
-        if (lq_it->status != Item::QUEUED) {
-          // All QUEUED items precede any other items
-          // in the load queue, so it means there are no
-          // QUEUED items at all.
-          assert(m_numQueuedItems == 0);
-          break;
-        }
+          // By marking the item as IN_PROGRESS, we prevent it
+          // from being processed again before the GUI thread
+          // receives our LoadResultEvent.
+          queuedToInProgress(lq_it);
+
+          if (m_totalLoadAttempts - lq_it->precedingLoadAttempts > m_expirationThreshold) {
+            // Expire this request.  The reasoning behind
+            // request expiration is described in
+            // ThumbnailLoadResult::REQUEST_EXPIRED
+            // documentation.
 
-        // By marking the item as IN_PROGRESS, we prevent it
-        // from being processed again before the GUI thread
-        // receives our LoadResultEvent.
-        queuedToInProgress(lq_it);
+            postLoadResult(lq_it, QImage(), ThumbnailLoadResult::REQUEST_EXPIRED);
+            continue;
+          }
 
-        if (m_totalLoadAttempts - lq_it->precedingLoadAttempts > m_expirationThreshold) {
-          // Expire this request.  The reasoning behind
-          // request expiration is described in
-          // ThumbnailLoadResult::REQUEST_EXPIRED
-          // documentation.
+          // Expired requests don't count as load attempts.
+          ++m_totalLoadAttempts;
 
-          postLoadResult(lq_it, QImage(), ThumbnailLoadResult::REQUEST_EXPIRED);
-          continue;
+          batch.push_back(lq_it);
+          image_ids.push_back(lq_it->imageId);
         }
 
-        // Expired requests don't count as load attempts.
-        ++m_totalLoadAttempts;
+        if (batch.empty()) {
+          if (!m_pregenQueue.empty()) {
+            // All QUEUED items precede any other items in the load
+            // queue, so there are no interactive requests pending at
+            // all.  Idle time - spend it on pregeneration.
+            assert(m_numQueuedItems == 0);
+            pregen_image_id = m_pregenQueue.front();
+            m_pregenQueue.pop_front();
+            pregenerate = true;
+          } else {
+            assert(m_numQueuedItems == 0);
+            break;
+          }
+        }
 
         // Copy those while holding the mutex.
         thumb_dir = m_thumbDir;
         max_thumb_size = m_maxThumbSize;
+        pack = m_packFile;
       }  // mutex scope
-      const QImage image(loadSaveThumbnail(image_id, thumb_dir, max_thumb_size));
 
-      const ThumbnailLoadResult::Status status
-          = image.isNull() ? ThumbnailLoadResult::LOAD_FAILED : ThumbnailLoadResult::LOADED;
-      postLoadResult(lq_it, image, status);
+      if (pregenerate) {
+        const QByteArray key(thumbKey(getThumbFilePath(pregen_image_id, thumb_dir, max_thumb_size)));
+        if (!pack->contains(key)) {
+          const auto load_start = std::chrono::steady_clock::now();
+          loadSaveThumbnail(pregen_image_id, thumb_dir, max_thumb_size, pack);
+          recordDiskLoad(
+              std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load_start).count());
+
+          // A pause between thumbnails keeps the sweep from
+          // saturating the disk and the CPU.  Interactive requests
+          // arriving meanwhile are picked up by the next iteration.
+          msleep(50);
+        }
+        continue;
+      }
+      // This thread counts against the machine-wide thread budget
+      // while it works, and parallelForChunked() draws any helpers
+      // from the same budget, so the batch decodes on however many
+      // cores the concurrently running page tasks leave free - at
+      // worst on this thread alone.
+      const ParallelForActiveThread active_thread;
+
+      parallelForChunked(0, int(batch.size()), [&](const int chunk_begin, const int chunk_end) {
+        for (int i = chunk_begin; i < chunk_end; ++i) {
+          const auto load_start = std::chrono::steady_clock::now();
+          const QImage image(loadSaveThumbnail(image_ids[i], thumb_dir, max_thumb_size, pack));
+          recordDiskLoad(
+              std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load_start).count());
+
+          const ThumbnailLoadResult::Status status
+              = image.isNull() ? ThumbnailLoadResult::LOAD_FAILED : ThumbnailLoadResult::LOADED;
+          postLoadResult(batch[i], image, status);
+        }
+      });
     } catch (const std::bad_alloc&) {
       OutOfMemoryHandler::instance().handleOutOfMemorySituation();
     }
@@ -605,21 +815,32 @@ void ThumbnailPixmapCache::Impl::backgroundProcessing() {
 
 QImage ThumbnailPixmapCache::Impl::loadSaveThumbnail(const ImageId& image_id,
                                                      const QString& thumb_dir,
-                                                     const QSize& max_thumb_size) {
+                                                     const QSize& max_thumb_size,
+                                                     const std::shared_ptr<ThumbnailPackFile>& pack) {
   const QString thumb_file_path(getThumbFilePath(image_id, thumb_dir, max_thumb_size));
+  const QByteArray key(thumbKey(thumb_file_path));
+
+  QImage image(pack->load(key));
+  if (!image.isNull()) {
+    return image;
+  }
 
-  QImage image(ImageLoader::load(thumb_file_path, 0));
+  // Fall back to the legacy per-file store, importing what we find,
+  // so old projects migrate into the pack as their thumbnails get used.
+  image = ImageLoader::load(thumb_file_path, 0);
   if (!image.isNull()) {
+    pack->store(key, image);
+
     return image;
   }
 
-  image = ImageLoader::load(image_id);
+  image = ImageLoader::loadDownscaled(image_id, max_thumb_size);
   if (image.isNull()) {
     return QImage();
   }
 
   const QImage thumbnail(makeThumbnail(image, max_thumb_size));
-  thumbnail.save(thumb_file_path, "PNG");
+  pack->store(key, thumbnail);
 
   return thumbnail;
 }
@@ -650,6 +871,39 @@ QString ThumbnailPixmapCache::Impl::getThumbFilePath(const ImageId& image_id,
   return thumb_file_path;
 }
 
+QByteArray ThumbnailPixmapCache::Impl::thumbKey(const QString& thumb_file_path) {
+  // The per-file name already encodes the page number, the hash of the
+  // original image path and the thumbnail quality, so its digest makes
+  // a compact fixed-size pack key that stays compatible with the
+  // per-file store.
+  return QCryptographicHash::hash(QFileInfo(thumb_file_path).fileName().toUtf8(), QCryptographicHash::Md5);
+}
+
+QPixmap ThumbnailPixmapCache::Impl::selectMipLevel(const Item& item, const QSize& desired_size) {
+  if (desired_size.isEmpty() || item.pixmap.isNull()) {
+    return item.pixmap;
+  }
+
+  // Walk down the pyramid while the next level still covers the
+  // desired size.  Each level is produced from the previous one,
+  // so building the whole chain costs little more than one halving.
+  QPixmap best(item.pixmap);
+  for (int level = 0; level < Item::NUM_MIP_LEVELS; ++level) {
+    const QSize level_size(item.pixmap.width() >> (level + 1), item.pixmap.height() >> (level + 1));
+    if (level_size.isEmpty() || (level_size.width() < desired_size.width())
+        || (level_size.height() < desired_size.height())) {
+      break;
+    }
+
+    if (item.mipLevels[level].isNull()) {
+      item.mipLevels[level] = best.scaled(level_size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    best = item.mipLevels[level];
+  }
+
+  return best;
+}
+
 QImage ThumbnailPixmapCache::Impl::makeThumbnail(const QImage& image, const QSize& max_thumb_size) {
   if ((image.width() < max_thumb_size.width()) && (image.height() < max_thumb_size.height())) {
     return image;
@@ -762,6 +1016,7 @@ void ThumbnailPixmapCache::Impl::removeExcessLocked() {
     assert(m_numLoadedItems > 0);
     assert(!m_removeQueue.empty());
     assert(m_removeQueue.front().status == Item::LOADED);
+    ++m_stats.evictions;
     removeItemLocked(m_removeQueue.begin());
   }
 }
@@ -791,6 +1046,8 @@ void ThumbnailPixmapCache::Impl::removeLoadedItemsLocked() {
     return;
   }
 
+  m_stats.evictions += m_numLoadedItems;
+
   for (auto it = m_removeQueue.begin(); it != m_removeQueue.end();) {
     if (it->status == Item::LOADED) {
       it = m_removeQueue.erase(it);
@@ -879,6 +1136,44 @@ void ThumbnailPixmapCache::Impl::cachePixmapLocked(const ImageId& image_id, cons
   }
 }  // ThumbnailPixmapCache::Impl::cachePixmapLocked
 
+ThumbnailPixmapCache::Stats ThumbnailPixmapCache::Impl::stats() const {
+  assert(QCoreApplication::instance()->thread() == QThread::currentThread());
+
+  const QMutexLocker locker(&m_mutex);
+
+  Stats stats(m_stats);
+  for (const Item& item : m_removeQueue) {
+    if (item.status != Item::LOADED) {
+      continue;
+    }
+    stats.residentBytes += pixmapBytes(item.pixmap);
+    for (const QPixmap& mip : item.mipLevels) {
+      stats.residentBytes += pixmapBytes(mip);
+    }
+  }
+
+  return stats;
+}
+
+void ThumbnailPixmapCache::Impl::recordDiskLoad(const double elapsed_ms) {
+  int bucket = 0;
+  while ((bucket < Stats::NUM_DECODE_BUCKETS - 1) && (elapsed_ms >= double(1 << bucket))) {
+    ++bucket;
+  }
+
+  const QMutexLocker locker(&m_mutex);
+  ++m_stats.diskLoads;
+  ++m_stats.decodeMsHistogram[bucket];
+}
+
+size_t ThumbnailPixmapCache::Impl::pixmapBytes(const QPixmap& pixmap) {
+  if (pixmap.isNull()) {
+    return 0;
+  }
+
+  return size_t(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+
 const QSize& ThumbnailPixmapCache::Impl::getMaxThumbSize() const {
   return m_maxThumbSize;
 }
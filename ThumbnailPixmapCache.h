@@ -19,8 +19,12 @@
 #ifndef THUMBNAILPIXMAPCACHE_H_
 #define THUMBNAILPIXMAPCACHE_H_
 
+#include <QSize>
 #include <boost/weak_ptr.hpp>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <vector>
 #include "AbstractCommand.h"
 #include "NonCopyable.h"
 #include "ThumbnailLoadResult.h"
@@ -30,7 +34,6 @@ class ImageId;
 class QImage;
 class QPixmap;
 class QString;
-class QSize;
 
 class ThumbnailPixmapCache : public ref_countable {
   DECLARE_NON_COPYABLE(ThumbnailPixmapCache)
@@ -40,6 +43,39 @@ class ThumbnailPixmapCache : public ref_countable {
 
   typedef AbstractCommand<void, const ThumbnailLoadResult&> CompletionHandler;
 
+  /**
+   * \brief A snapshot of what the cache has been doing.
+   *
+   * Meant for sizing the in-memory pixmap limit from data: a high
+   * eviction count with a high miss count means the limit is too low
+   * for the way the project is being browsed, while residentBytes
+   * shows what the current limit actually costs.
+   */
+  struct Stats {
+    enum { NUM_DECODE_BUCKETS = 8 };
+
+    /** Requests served from the in-memory pixmap set. */
+    uint64_t memHits = 0;
+
+    /** Requests that found nothing in memory. */
+    uint64_t misses = 0;
+
+    /** Thumbnails actually read from or (re)built on disk. */
+    uint64_t diskLoads = 0;
+
+    /** Loaded pixmaps dropped to stay within the cache limit. */
+    uint64_t evictions = 0;
+
+    /**
+     * Disk load times: bucket \p i counts loads that took less than
+     * 2^i milliseconds, the last bucket everything slower.
+     */
+    uint64_t decodeMsHistogram[NUM_DECODE_BUCKETS] = {};
+
+    /** Memory held by the cached pixmaps, including their mip levels. */
+    size_t residentBytes = 0;
+  };
+
   /**
    * \brief Constructor.  To be called from the GUI thread only.
    *
@@ -119,10 +155,17 @@ class ThumbnailPixmapCache : public ref_countable {
    * x is only safe when done from the GUI thread.  Another thing to
    * keep in mind is that only boost::bind() can handle trackable binds.
    * Other methods, for example boost::lambda::bind() can't do that.
+   * \param desired_size The size, in device pixels, the thumbnail is
+   * going to be painted at.  When provided, the cache may return a
+   * pyramid level of the cached pixmap whose resolution is closest to
+   * (but not below) the desired one, making the caller's paint-time
+   * scaling much cheaper.  Pass an empty size to always get the
+   * full-quality pixmap.
    */
   Status loadRequest(const ImageId& image_id,
                      QPixmap& pixmap,
-                     const std::weak_ptr<CompletionHandler>& completion_handler);
+                     const std::weak_ptr<CompletionHandler>& completion_handler,
+                     const QSize& desired_size = QSize());
 
   /**
    * \brief If no thumbnail exists for this image, create it.
@@ -148,11 +191,47 @@ class ThumbnailPixmapCache : public ref_countable {
    */
   void recreateThumbnail(const ImageId& image_id, const QImage& image);
 
+  /**
+   * \brief Queues thumbnails to be created on disk during idle time.
+   *
+   * The images are processed in the given order, but only when no
+   * on-screen thumbnail is waiting to be loaded, and with a pause after
+   * each thumbnail actually created, so that sweeping a whole project
+   * doesn't compete with interactive work for the disk or the CPU.
+   * Images that already have an on-disk thumbnail are skipped cheaply.
+   * Only the on-disk store is filled - no pixmaps are retained in memory.
+   *
+   * \note This function is to be called from the GUI thread only.
+   */
+  void schedulePregeneration(const std::vector<ImageId>& image_ids);
+
+  /**
+   * \brief Drops any pending pregeneration work.
+   */
+  void cancelPregeneration();
+
+  /**
+   * \brief Returns a snapshot of the cache statistics.
+   *
+   * \note To be called from the GUI thread only, as it sizes up the
+   *       cached pixmaps.
+   */
+  Stats stats() const;
+
+  /**
+   * \brief Drops all in-memory pixmaps, keeping the on-disk thumbnails.
+   *
+   * Used to shed memory under pressure.  May be called from any thread;
+   * the pixmaps themselves are released on the GUI thread.
+   */
+  void releaseCachedPixmaps();
+
  private:
   class Item;
   class Impl;
 
   std::unique_ptr<Impl> m_impl;
+  int m_evictableId;
 };
 
 
@@ -22,13 +22,16 @@
 #include <QGraphicsScene>
 #include <QGraphicsSceneMouseEvent>
 #include <QGraphicsView>
+#include <QScrollBar>
 #include <QStyleOptionGraphicsItem>
+#include <QTimer>
 #include <boost/foreach.hpp>
 #include <boost/function.hpp>
 #include <boost/lambda/bind.hpp>
 #include <boost/lambda/lambda.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
+#include <boost/multi_index/random_access_index.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index_container.hpp>
 #include "ColorSchemeManager.h"
@@ -149,10 +152,13 @@ class ThumbnailSequence::Impl {
   class ItemsInOrderTag;
   class SelectedThenUnselectedTag;
 
+  // The ordered index is random_access rather than sequenced so that an
+  // item's position in the sequence is available in O(1), which the
+  // grid layout model relies upon.
   typedef multi_index_container<
       Item,
       indexed_by<hashed_unique<tag<ItemsByIdTag>, const_mem_fun<Item, const PageId&, &Item::pageId>, std::hash<PageId>>,
-                 sequenced<tag<ItemsInOrderTag>>,
+                 random_access<tag<ItemsInOrderTag>>,
                  sequenced<tag<SelectedThenUnselectedTag>>>>
       Container;
 
@@ -162,6 +168,10 @@ class ThumbnailSequence::Impl {
 
   void invalidateThumbnailImpl(ItemsById::iterator id_it);
 
+  void scheduleDelayedLayout();
+
+  void flushDelayedLayout();
+
   void sceneContextMenuEvent(QGraphicsSceneContextMenuEvent* evt);
 
   void selectItemNoModifiers(const ItemsById::iterator& it);
@@ -213,6 +223,29 @@ class ThumbnailSequence::Impl {
 
   void orderItems();
 
+  /**
+   * The uniform cell of the layout grid.  Measured once from a
+   * placeholder-sized composite, so it's O(1) in the number of pages.
+   */
+  QSizeF cellSize();
+
+  /** Layout grid cell of the item at the given sequence position. */
+  QRectF cellRect(int index) const;
+
+  /**
+   * Scene-space rectangle of an item, whether or not its graphics
+   * item is currently instantiated.
+   */
+  QRectF itemSceneRect(const Item& item) const;
+
+  void instantiateItem(const Item& item, int index);
+
+  /**
+   * Creates graphics items for pages within the visible range plus
+   * a margin, and destroys them for pages that scrolled out of it.
+   */
+  void updateInstantiatedItems();
+
   static const int SPACING = 3;
   ThumbnailSequence& m_owner;
   QSizeF m_maxLogicalThumbSize;
@@ -230,7 +263,20 @@ class ThumbnailSequence::Impl {
   intrusive_ptr<ThumbnailFactory> m_factory;
   intrusive_ptr<const PageOrderProvider> m_orderProvider;
   GraphicsScene m_graphicsScene;
+  QGraphicsView* m_view;
+
+  /**
+   * Coalesces the reordering and relayout caused by thumbnail
+   * invalidations.  Batch processing at full speed invalidates
+   * hundreds of thumbnails per second, and a layout pass per
+   * invalidation would saturate the GUI thread.
+   */
+  QTimer m_delayedLayoutTimer;
+
   QRectF m_sceneRect;
+  QSizeF m_cellSize;
+  double m_hSpacing;
+  int m_columns;
 };
 
 
@@ -274,8 +320,6 @@ class ThumbnailSequence::CompositeItem : public QGraphicsItemGroup {
 
   bool incompleteThumbnail() const;
 
-  void updateSceneRect(QRectF& scene_rect);
-
   void updateAppearence(bool selected, bool selection_leader);
 
   virtual QRectF boundingRect() const;
@@ -396,9 +440,8 @@ std::vector<PageRange> ThumbnailSequence::selectedRanges() const {
 }
 
 void ThumbnailSequence::emitNewSelectionLeader(const PageInfo& page_info,
-                                               const CompositeItem* composite,
+                                               const QRectF& thumb_rect,
                                                const SelectionFlags flags) {
-  const QRectF thumb_rect(composite->mapToScene(composite->boundingRect()).boundingRect());
   emit newSelectionLeader(page_info, thumb_rect, flags);
 }
 
@@ -423,9 +466,16 @@ ThumbnailSequence::Impl::Impl(ThumbnailSequence& owner, const QSizeF& max_logica
       m_itemsById(m_items.get<ItemsByIdTag>()),
       m_itemsInOrder(m_items.get<ItemsInOrderTag>()),
       m_selectedThenUnselected(m_items.get<SelectedThenUnselectedTag>()),
-      m_selectionLeader(nullptr) {
+      m_selectionLeader(nullptr),
+      m_view(nullptr),
+      m_hSpacing(SPACING),
+      m_columns(1) {
   m_graphicsScene.setContextMenuEventCallback(
       [&](QGraphicsSceneContextMenuEvent* evt) { this->sceneContextMenuEvent(evt); });
+
+  m_delayedLayoutTimer.setSingleShot(true);
+  m_delayedLayoutTimer.setInterval(100);
+  QObject::connect(&m_delayedLayoutTimer, &QTimer::timeout, &m_owner, [this]() { flushDelayedLayout(); });
 }
 
 ThumbnailSequence::Impl::~Impl() {}
@@ -435,7 +485,13 @@ void ThumbnailSequence::Impl::setThumbnailFactory(intrusive_ptr<ThumbnailFactory
 }
 
 void ThumbnailSequence::Impl::attachView(QGraphicsView* const view) {
+  m_view = view;
   view->setScene(&m_graphicsScene);
+
+  // Scrolling doesn't change the layout, it only shifts the window
+  // of instantiated graphics items.
+  QObject::connect(view->verticalScrollBar(), &QScrollBar::valueChanged, &m_owner,
+                   [this](int) { updateInstantiatedItems(); });
 }
 
 void ThumbnailSequence::Impl::reset(const PageSequence& pages,
@@ -459,12 +515,15 @@ void ThumbnailSequence::Impl::reset(const PageSequence& pages,
     return;
   }
 
+  // Labels may have changed, so the layout cell is measured anew.
+  m_cellSize = QSizeF();
+
   const Item* some_selected_item = nullptr;
   for (const PageInfo& page_info : pages) {
-    std::unique_ptr<CompositeItem> composite(getCompositeItem(0, page_info));
-    m_itemsInOrder.push_back(Item(page_info, composite.release()));
+    // Graphics items are not created here.  Pages get them lazily,
+    // once they enter the visible range.
+    m_itemsInOrder.push_back(Item(page_info, nullptr));
     const Item* item = &m_itemsInOrder.back();
-    item->composite->setItem(item);
 
     const ImageId& image_id = page_info.id().imageId();
 
@@ -502,7 +561,7 @@ void ThumbnailSequence::Impl::reset(const PageSequence& pages,
   }
   if (m_selectionLeader) {
     m_selectionLeader->setSelectionLeader(true);
-    m_owner.emitNewSelectionLeader(selection_leader, m_selectionLeader->composite, DEFAULT_SELECTION_FLAGS);
+    m_owner.emitNewSelectionLeader(selection_leader, itemSceneRect(*m_selectionLeader), DEFAULT_SELECTION_FLAGS);
   }
 }  // ThumbnailSequence::Impl::reset
 
@@ -552,6 +611,7 @@ int ThumbnailSequence::Impl::getGraphicsViewWidth() const {
 void ThumbnailSequence::Impl::orderItems() {
   // Sort pages in m_itemsInOrder using m_orderProvider.
   if (m_orderProvider) {
+    m_orderProvider->invalidateCachedKeys();
     m_itemsInOrder.sort([this](const Item& lhs, const Item& rhs) {
       return m_orderProvider->precedes(lhs.pageId(), lhs.incompleteThumbnail, rhs.pageId(), rhs.incompleteThumbnail);
     });
@@ -559,105 +619,183 @@ void ThumbnailSequence::Impl::orderItems() {
 }
 
 void ThumbnailSequence::Impl::updateSceneItemsPos() {
+  // The layout is computed from a uniform cell size, so its cost
+  // doesn't depend on the number of pages.  Only the graphics items
+  // within the instantiation window get touched.
   m_sceneRect = QRectF(0.0, 0.0, 0.0, 0.0);
 
+  if (m_items.empty()) {
+    m_columns = 1;
+    commitSceneRect();
+    return;
+  }
+
   const int view_width = getGraphicsViewWidth();
   assert(view_width > 0);
-  double y_offset = SPACING;
-
-  ItemsInOrder::iterator ord_it = m_itemsInOrder.begin();
-  const ItemsInOrder::iterator ord_end(m_itemsInOrder.end());
-
-  while (ord_it != ord_end) {
-    int items_in_row = 0;
-    double sum_item_widths = 0;
-    double x_offset = SPACING;
-
-    // Determine how many items can fit into the current row.
-    for (ItemsInOrder::iterator row_it = ord_it; row_it != ord_end; ++row_it) {
-      const double item_width = row_it->composite->boundingRect().width();
-      x_offset += item_width + SPACING;
-      if (x_offset > view_width) {
-        if (items_in_row == 0) {
-          // At least one page must be in a row.
-          items_in_row = 1;
-          sum_item_widths = item_width;
-        }
-        break;
-      }
-      items_in_row++;
-      sum_item_widths += item_width;
-    }
 
-    // Split free space between the items in the current row.
-    const double adj_spacing = std::floor((view_width - sum_item_widths) / (items_in_row + 1));
-    x_offset = adj_spacing;
-    double next_y_offset = 0;
-    for (; items_in_row > 0; --items_in_row, ++ord_it) {
-      CompositeItem* composite = ord_it->composite;
-      composite->setPos(x_offset, y_offset);
-      composite->updateSceneRect(m_sceneRect);
-      x_offset += composite->boundingRect().width() + adj_spacing;
-      next_y_offset = std::max(composite->boundingRect().height() + SPACING, next_y_offset);
-    }
+  const QSizeF cell(cellSize());
+  m_columns = std::max(1, int((view_width - SPACING) / (cell.width() + SPACING)));
 
-    if (ord_it != ord_end) {
-      y_offset += next_y_offset;
-    }
-  }
+  // Split free space between the items in a row.
+  m_hSpacing = std::floor((view_width - m_columns * cell.width()) / (m_columns + 1));
+
+  const auto num_items = int(m_itemsInOrder.size());
+  const int num_rows = (num_items + m_columns - 1) / m_columns;
+  m_sceneRect = QRectF(0.0, 0.0, view_width, SPACING + num_rows * (cell.height() + SPACING));
 
   commitSceneRect();
+  updateInstantiatedItems();
+}
+
+QSizeF ThumbnailSequence::Impl::cellSize() {
+  if (!m_cellSize.isValid()) {
+    // Every thumbnail is bounded by m_maxLogicalThumbSize and labels
+    // are elided to a fixed length, so one composite built around a
+    // placeholder-sized thumbnail bounds the whole sequence.
+    assert(!m_items.empty());
+    const PageInfo& page_info = m_itemsInOrder.front().pageInfo;
+    std::unique_ptr<QGraphicsItem> thumb(new PlaceholderThumb(m_maxLogicalThumbSize));
+    CompositeItem sample(*this, std::move(thumb), getLabelGroup(page_info));
+    m_cellSize = sample.boundingRect().size();
+  }
+
+  return m_cellSize;
+}
+
+QRectF ThumbnailSequence::Impl::cellRect(const int index) const {
+  const int row = index / m_columns;
+  const int col = index % m_columns;
+  const double x = m_hSpacing + col * (m_cellSize.width() + m_hSpacing);
+  const double y = SPACING + row * (m_cellSize.height() + SPACING);
+
+  return QRectF(QPointF(x, y), m_cellSize);
+}
+
+QRectF ThumbnailSequence::Impl::itemSceneRect(const Item& item) const {
+  if (item.composite) {
+    return item.composite->mapToScene(item.composite->boundingRect()).boundingRect();
+  }
+
+  // Not instantiated - derive the rectangle from the layout model.
+  const auto index = int(m_itemsInOrder.iterator_to(item) - m_itemsInOrder.begin());
+
+  return cellRect(index);
+}
+
+void ThumbnailSequence::Impl::instantiateItem(const Item& item, const int index) {
+  CompositeItem* const composite = getCompositeItem(&item, item.pageInfo).release();
+  item.composite = composite;
+  item.incompleteThumbnail = composite->incompleteThumbnail();
+  composite->updateAppearence(item.isSelected(), item.isSelectionLeader());
+
+  // Center the composite within its cell.
+  const QRectF cell(cellRect(index));
+  const QRectF bounding_rect(composite->boundingRect());
+  composite->setPos(cell.left() + 0.5 * (cell.width() - bounding_rect.width()) - bounding_rect.left(),
+                    cell.top() - bounding_rect.top());
+
+  m_graphicsScene.addItem(composite);
+}
+
+void ThumbnailSequence::Impl::updateInstantiatedItems() {
+  if (!m_view || m_items.empty() || !m_cellSize.isValid()) {
+    return;
+  }
+
+  // The instantiation window covers the visible range plus one
+  // viewport height of margin on each side.
+  const QRectF visible(m_view->mapToScene(m_view->viewport()->rect()).boundingRect());
+  const double margin = visible.height();
+  const double row_pitch = m_cellSize.height() + SPACING;
+
+  const int first_row = std::max(0, int((visible.top() - margin) / row_pitch));
+  const int last_row = std::max(0, int((visible.bottom() + margin) / row_pitch));
+  const int window_begin = first_row * m_columns;
+  const int window_end = std::min(int(m_itemsInOrder.size()), (last_row + 1) * m_columns);
+
+  int index = 0;
+  for (const Item& item : m_itemsInOrder) {
+    const bool wanted = (index >= window_begin) && (index < window_end);
+    if (wanted && !item.composite) {
+      instantiateItem(item, index);
+    } else if (wanted) {
+      // The cell may have moved after a relayout.
+      const QRectF cell(cellRect(index));
+      const QRectF bounding_rect(item.composite->boundingRect());
+      item.composite->setPos(cell.left() + 0.5 * (cell.width() - bounding_rect.width()) - bounding_rect.left(),
+                             cell.top() - bounding_rect.top());
+    } else if (item.composite) {
+      // Recycle the item that scrolled out of the window.
+      delete item.composite;
+      item.composite = nullptr;
+    }
+    ++index;
+  }
 }
 
 void ThumbnailSequence::Impl::invalidateThumbnailImpl(const ItemsById::iterator id_it) {
-  CompositeItem* const new_composite = getCompositeItem(&*id_it, id_it->pageInfo).release();
-  CompositeItem* const old_composite = id_it->composite;
-  const QSizeF old_size(old_composite->boundingRect().size());
-  const QSizeF new_size(new_composite->boundingRect().size());
-  const QPointF old_pos(new_composite->pos());
-
-  id_it->composite = new_composite;
-  id_it->incompleteThumbnail = new_composite->incompleteThumbnail();
-  delete old_composite;
-
-  new_composite->updateAppearence(id_it->isSelected(), id_it->isSelectionLeader());
-  m_graphicsScene.addItem(new_composite);
-
-  ItemsInOrder::iterator after_old(m_items.project<ItemsInOrderTag>(id_it));
-  // Notice after_old++ below.
-  // Move our item to the beginning of m_itemsInOrder, to make it out of range
-  // we are going to pass to itemInsertPosition().
-  m_itemsInOrder.relocate(m_itemsInOrder.begin(), after_old++);
-  const ItemsInOrder::iterator after_new(itemInsertPosition(
-      ++m_itemsInOrder.begin(), m_itemsInOrder.end(), id_it->pageInfo.id(), id_it->incompleteThumbnail, after_old));
-  // Move our item to its intended position.
-  m_itemsInOrder.relocate(after_new, m_itemsInOrder.begin());
+  if (id_it->composite) {
+    // Refresh the graphics item in place, repainting just this
+    // thumbnail's portion of the viewport.  Pages without a graphics
+    // item will pick up fresh content when they get instantiated.
+    delete id_it->composite;
+    id_it->composite = nullptr;
+    const auto index = int(m_itemsInOrder.iterator_to(*id_it) - m_itemsInOrder.begin());
+    instantiateItem(*id_it, index);
+  }
+
+  // Reordering and relayout are deferred and coalesced: batch
+  // processing at full speed invalidates thumbnails faster than
+  // full layout passes can be afforded.
+  scheduleDelayedLayout();
+}  // ThumbnailSequence::Impl::invalidateThumbnailImpl
+
+void ThumbnailSequence::Impl::scheduleDelayedLayout() {
+  // The timer isn't restarted on every invalidation, so under a
+  // sustained stream of them the layout still updates periodically.
+  if (!m_delayedLayoutTimer.isActive()) {
+    m_delayedLayoutTimer.start();
+  }
+}
+
+void ThumbnailSequence::Impl::flushDelayedLayout() {
+  const Item* const leader = m_selectionLeader;
+  QRectF old_leader_rect;
+  if (leader) {
+    old_leader_rect = itemSceneRect(*leader);
+  }
 
+  // A full resort stands in for the per-item repositioning the
+  // coalesced invalidations would have done.  Like in the old
+  // one-layout-per-invalidation scheme, the order only changes
+  // if an order provider is set.
+  orderItems();
   updateSceneItemsPos();
 
   // Possibly emit the newSelectionLeader() signal.
-  if (m_selectionLeader == &*id_it) {
-    if ((old_size != new_size) || (old_pos != id_it->composite->pos())) {
-      m_owner.emitNewSelectionLeader(id_it->pageInfo, id_it->composite, REDUNDANT_SELECTION);
+  if (leader && (leader == m_selectionLeader)) {
+    const QRectF new_rect(itemSceneRect(*leader));
+    if (old_leader_rect != new_rect) {
+      m_owner.emitNewSelectionLeader(leader->pageInfo, new_rect, REDUNDANT_SELECTION);
     }
   }
-}  // ThumbnailSequence::Impl::invalidateThumbnailImpl
+}  // ThumbnailSequence::Impl::flushDelayedLayout
 
 void ThumbnailSequence::Impl::invalidateAllThumbnails() {
-  // Recreate thumbnails now, whether a thumbnail is incomplete
-  // is taken into account when sorting.
-  ItemsInOrder::iterator ord_it(m_itemsInOrder.begin());
-  const ItemsInOrder::iterator ord_end(m_itemsInOrder.end());
-  for (; ord_it != ord_end; ++ord_it) {
-    CompositeItem* const old_composite = ord_it->composite;
-    CompositeItem* const new_composite = getCompositeItem(&*ord_it, ord_it->pageInfo).release();
-
-    ord_it->composite = new_composite;
-    ord_it->incompleteThumbnail = new_composite->incompleteThumbnail();
-    delete old_composite;
-
-    new_composite->updateAppearence(ord_it->isSelected(), ord_it->isSelectionLeader());
-    m_graphicsScene.addItem(new_composite);
+  // Any deferred per-page layout work is subsumed by this full pass.
+  m_delayedLayoutTimer.stop();
+
+  // Drop the instantiated graphics items.  The ones within the
+  // instantiation window get recreated with fresh content by
+  // updateSceneItemsPos(), the rest when they are scrolled into view.
+  // Note that whether a thumbnail is incomplete is only known for
+  // pages that had a graphics item at some point - that's the price
+  // of not instantiating the whole sequence.
+  for (const Item& item : m_itemsInOrder) {
+    if (item.composite) {
+      delete item.composite;
+      item.composite = nullptr;
+    }
   }
 
   orderItems();
@@ -712,7 +850,7 @@ bool ThumbnailSequence::Impl::setSelection(const PageId& page_id, const Selectio
     flags |= REDUNDANT_SELECTION;
   }
 
-  m_owner.emitNewSelectionLeader(id_it->pageInfo, id_it->composite, flags);
+  m_owner.emitNewSelectionLeader(id_it->pageInfo, itemSceneRect(*id_it), flags);
 
   return true;
 }  // ThumbnailSequence::Impl::setSelection
@@ -860,64 +998,33 @@ void ThumbnailSequence::Impl::insert(const PageInfo& page_info, BeforeOrAfter be
   ord_it = itemInsertPosition(m_itemsInOrder.begin(), m_itemsInOrder.end(), page_info.id(),
                               /*page_incomplete=*/true, ord_it);
 
-  double offset = 0.0;
-  if (!m_items.empty()) {
-    if (ord_it != m_itemsInOrder.end()) {
-      offset = ord_it->composite->pos().y();
-    } else {
-      ItemsInOrder::iterator it(ord_it);
-      --it;
-      offset = it->composite->y() + it->composite->boundingRect().height() + SPACING;
-    }
-  }
-  std::unique_ptr<CompositeItem> composite(getCompositeItem(0, page_info));
-  composite->setPos(0.0, offset);
-  composite->updateSceneRect(m_sceneRect);
-
-  const QPointF pos_delta(0.0, composite->boundingRect().height() + SPACING);
-
-  const Item item(page_info, composite.get());
-  const std::pair<ItemsInOrder::iterator, bool> ins(m_itemsInOrder.insert(ord_it, item));
-  composite->setItem(&*ins.first);
-  m_graphicsScene.addItem(composite.release());
+  // The graphics item is created lazily, once the page enters the
+  // visible range.  A full relayout only touches the instantiation
+  // window, so there is no point in shifting the followers manually.
+  m_itemsInOrder.insert(ord_it, Item(page_info, nullptr));
 
-  const ItemsInOrder::iterator ord_end(m_itemsInOrder.end());
-  for (; ord_it != ord_end; ++ord_it) {
-    ord_it->composite->setPos(ord_it->composite->pos() + pos_delta);
-    ord_it->composite->updateSceneRect(m_sceneRect);
-  }
-
-  commitSceneRect();
+  updateSceneItemsPos();
 }  // ThumbnailSequence::Impl::insert
 
 void ThumbnailSequence::Impl::removePages(const std::set<PageId>& to_remove) {
-  m_sceneRect = QRectF(0, 0, 0, 0);
-
   const std::set<PageId>::const_iterator to_remove_end(to_remove.end());
-  QPointF pos_delta(0, 0);
 
   ItemsInOrder::iterator ord_it(m_itemsInOrder.begin());
-  const ItemsInOrder::iterator ord_end(m_itemsInOrder.end());
-  while (ord_it != ord_end) {
+  while (ord_it != m_itemsInOrder.end()) {
     if (to_remove.find(ord_it->pageInfo.id()) == to_remove_end) {
       // Keeping this page.
-      if (pos_delta != QPointF(0, 0)) {
-        ord_it->composite->setPos(ord_it->composite->pos() + pos_delta);
-      }
-      ord_it->composite->updateSceneRect(m_sceneRect);
       ++ord_it;
     } else {
       // Removing this page.
       if (m_selectionLeader == &*ord_it) {
         m_selectionLeader = nullptr;
       }
-      pos_delta.ry() -= ord_it->composite->boundingRect().height() + SPACING;
       delete ord_it->composite;
-      m_itemsInOrder.erase(ord_it++);
+      ord_it = m_itemsInOrder.erase(ord_it);
     }
   }
 
-  commitSceneRect();
+  updateSceneItemsPos();
 }
 
 bool ThumbnailSequence::Impl::multipleItemsSelected() const {
@@ -945,7 +1052,7 @@ QRectF ThumbnailSequence::Impl::selectionLeaderSceneRect() const {
     return QRectF();
   }
 
-  return m_selectionLeader->composite->mapToScene(m_selectionLeader->composite->boundingRect()).boundingRect();
+  return itemSceneRect(*m_selectionLeader);
 }
 
 std::set<PageId> ThumbnailSequence::Impl::selectedItems() const {
@@ -989,8 +1096,7 @@ void ThumbnailSequence::Impl::contextMenuRequested(const PageInfo& page_info, co
 
 void ThumbnailSequence::Impl::sceneContextMenuEvent(QGraphicsSceneContextMenuEvent* evt) {
   if (!m_itemsInOrder.empty()) {
-    CompositeItem* composite = m_itemsInOrder.back().composite;
-    const QRectF last_thumb_rect(composite->mapToScene(composite->boundingRect()).boundingRect());
+    const QRectF last_thumb_rect(itemSceneRect(m_itemsInOrder.back()));
     if (evt->scenePos().y() <= last_thumb_rect.bottom()) {
       return;
     }
@@ -1022,7 +1128,7 @@ void ThumbnailSequence::Impl::selectItemWithControl(const ItemsById::iterator& i
     m_selectionLeader->setSelectionLeader(true);
     moveToSelected(m_selectionLeader);
 
-    m_owner.emitNewSelectionLeader(m_selectionLeader->pageInfo, m_selectionLeader->composite, flags);
+    m_owner.emitNewSelectionLeader(m_selectionLeader->pageInfo, itemSceneRect(*m_selectionLeader), flags);
 
     return;
   }
@@ -1030,7 +1136,7 @@ void ThumbnailSequence::Impl::selectItemWithControl(const ItemsById::iterator& i
   if (!multipleItemsSelected()) {
     // Clicked on the only selected item.
     flags |= REDUNDANT_SELECTION;
-    m_owner.emitNewSelectionLeader(m_selectionLeader->pageInfo, m_selectionLeader->composite, flags);
+    m_owner.emitNewSelectionLeader(m_selectionLeader->pageInfo, itemSceneRect(*m_selectionLeader), flags);
 
     return;
   }
@@ -1071,7 +1177,7 @@ void ThumbnailSequence::Impl::selectItemWithControl(const ItemsById::iterator& i
   m_selectionLeader->setSelectionLeader(true);
   // No need to moveToSelected() as it was and remains selected.
 
-  m_owner.emitNewSelectionLeader(m_selectionLeader->pageInfo, m_selectionLeader->composite, flags);
+  m_owner.emitNewSelectionLeader(m_selectionLeader->pageInfo, itemSceneRect(*m_selectionLeader), flags);
 }  // ThumbnailSequence::Impl::selectItemWithControl
 
 void ThumbnailSequence::Impl::selectItemWithShift(const ItemsById::iterator& id_it) {
@@ -1129,7 +1235,7 @@ void ThumbnailSequence::Impl::selectItemWithShift(const ItemsById::iterator& id_
   m_selectionLeader = &*id_it;
   m_selectionLeader->setSelectionLeader(true);
 
-  m_owner.emitNewSelectionLeader(id_it->pageInfo, id_it->composite, flags);
+  m_owner.emitNewSelectionLeader(id_it->pageInfo, itemSceneRect(*id_it), flags);
 }  // ThumbnailSequence::Impl::selectItemWithShift
 
 void ThumbnailSequence::Impl::selectItemNoModifiers(const ItemsById::iterator& id_it) {
@@ -1144,17 +1250,16 @@ void ThumbnailSequence::Impl::selectItemNoModifiers(const ItemsById::iterator& i
   m_selectionLeader->setSelectionLeader(true);
   moveToSelected(m_selectionLeader);
 
-  m_owner.emitNewSelectionLeader(id_it->pageInfo, id_it->composite, flags);
+  m_owner.emitNewSelectionLeader(id_it->pageInfo, itemSceneRect(*id_it), flags);
 }
 
 void ThumbnailSequence::Impl::clear() {
   m_selectionLeader = nullptr;
 
   ItemsInOrder::iterator it(m_itemsInOrder.begin());
-  const ItemsInOrder::iterator end(m_itemsInOrder.end());
-  while (it != end) {
+  while (it != m_itemsInOrder.end()) {
     delete it->composite;
-    m_itemsInOrder.erase(it++);
+    it = m_itemsInOrder.erase(it);
   }
 
   assert(m_graphicsScene.items().empty());
@@ -1329,6 +1434,7 @@ const QSizeF& ThumbnailSequence::Impl::getMaxLogicalThumbSize() const {
 
 void ThumbnailSequence::Impl::setMaxLogicalThumbSize(const QSizeF& size) {
   m_maxLogicalThumbSize = size;
+  m_cellSize = QSizeF();  // Invalidate the layout cell.
 }
 
 /*==================== ThumbnailSequence::Item ======================*/
@@ -1336,7 +1442,7 @@ void ThumbnailSequence::Impl::setMaxLogicalThumbSize(const QSizeF& size) {
 ThumbnailSequence::Item::Item(const PageInfo& page_info, CompositeItem* comp_item)
     : pageInfo(page_info),
       composite(comp_item),
-      incompleteThumbnail(comp_item->incompleteThumbnail()),
+      incompleteThumbnail(comp_item ? comp_item->incompleteThumbnail() : false),
       m_isSelected(false),
       m_isSelectionLeader(false) {}
 
@@ -1346,7 +1452,7 @@ void ThumbnailSequence::Item::setSelected(bool selected) const {
   m_isSelected = selected;
   m_isSelectionLeader = m_isSelectionLeader && selected;
 
-  if ((was_selected != m_isSelected) || (was_selection_leader != m_isSelectionLeader)) {
+  if (composite && ((was_selected != m_isSelected) || (was_selection_leader != m_isSelectionLeader))) {
     composite->updateAppearence(m_isSelected, m_isSelectionLeader);
     composite->update();
   }
@@ -1358,7 +1464,7 @@ void ThumbnailSequence::Item::setSelectionLeader(bool selection_leader) const {
   m_isSelected = m_isSelected || selection_leader;
   m_isSelectionLeader = selection_leader;
 
-  if ((was_selected != m_isSelected) || (was_selection_leader != m_isSelectionLeader)) {
+  if (composite && ((was_selected != m_isSelected) || (was_selection_leader != m_isSelectionLeader))) {
     composite->updateAppearence(m_isSelected, m_isSelectionLeader);
     composite->update();
   }
@@ -1441,20 +1547,6 @@ bool ThumbnailSequence::CompositeItem::incompleteThumbnail() const {
   return dynamic_cast<IncompleteThumbnail*>(m_thumb) != 0;
 }
 
-void ThumbnailSequence::CompositeItem::updateSceneRect(QRectF& scene_rect) {
-  QRectF rect(m_thumb->boundingRect());
-  rect.translate(m_thumb->pos());
-  rect.translate(pos());
-
-  QRectF bounding_rect(boundingRect());
-  bounding_rect.translate(pos());
-
-  rect.setTop(bounding_rect.top());
-  rect.setBottom(bounding_rect.bottom());
-
-  scene_rect |= rect;
-}
-
 void ThumbnailSequence::CompositeItem::updateAppearence(bool selected, bool selection_leader) {
   m_labelGroup->updateAppearence(selected, selection_leader);
 }
@@ -113,11 +113,12 @@ class ThumbnailSequence : public QObject {
    * is a selection leader, newSelectionLeader() signal will be emitted
    * with REDUNDANT_SELECTION flag set.
    *
-   * \note This function assumes the thumbnail specified by page_id
-   *       is the only thumbnail at incorrect position.  If you do
-   *       something that changes the logical position of more than
-   *       one thumbnail at once, use invalidateAllThumbnails()
-   *       instead of sequentially calling invalidateThumbnail().
+   * \note The appearance of the thumbnail is refreshed immediately,
+   *       while reordering and relayout are coalesced and applied
+   *       once per burst of invalidations, shortly afterwards.
+   *       Sequential calls for multiple pages are therefore fine,
+   *       though invalidateAllThumbnails() is still cheaper when
+   *       every page is affected.
    */
   void invalidateThumbnail(const PageId& page_id);
 
@@ -258,7 +259,7 @@ class ThumbnailSequence : public QObject {
   class LabelGroup;
   class CompositeItem;
 
-  void emitNewSelectionLeader(const PageInfo& page_info, const CompositeItem* composite, SelectionFlags flags);
+  void emitNewSelectionLeader(const PageInfo& page_info, const QRectF& thumb_rect, SelectionFlags flags);
 
   std::unique_ptr<Impl> m_impl;
 };
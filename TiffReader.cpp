@@ -22,8 +22,11 @@
 #include <QDebug>
 #include <QIODevice>
 #include <QImage>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstring>
+#include <vector>
 #include "Dpm.h"
 #include "ImageMetadata.h"
 #include "NonCopyable.h"
@@ -288,56 +291,320 @@ QImage TiffReader::readImage(QIODevice& device, const int page_num) {
 
   const ImageMetadata metadata(currentPageMetadata(tif));
 
+  QImage image(decodeCurrentPage(tif, info));
+
+  if (!metadata.dpi().isNull()) {
+    const Dpm dpm(metadata.dpi());
+    image.setDotsPerMeterX(dpm.horizontal());
+    image.setDotsPerMeterY(dpm.vertical());
+  }
+
+  return image;
+}  // TiffReader::readImage
+
+QImage TiffReader::readDownscaledImage(QIODevice& device, const int page_num, const QSize& max_size) {
+  if (!device.isReadable()) {
+    return QImage();
+  }
+  if (device.isSequential()) {
+    // libtiff needs to be able to seek.
+    return QImage();
+  }
+
+  TiffHeader header(readHeader(device));
+  if (!checkHeader(header)) {
+    return QImage();
+  }
+
+  TiffHandle tif(TIFFClientOpen("file", "rBm", &device, &deviceRead, &deviceWrite, &deviceSeek, &deviceClose,
+                                &deviceSize, &deviceMap, &deviceUnmap));
+  if (!tif.handle()) {
+    return QImage();
+  }
+
+  if (!TIFFSetDirectory(tif.handle(), (uint16) page_num)) {
+    return QImage();
+  }
+
+  const TiffInfo info(tif, header);
+  if ((info.width < 1) || (info.height < 1)) {
+    return QImage();
+  }
+
+  const ImageMetadata metadata(currentPageMetadata(tif));
+
+  int factor = 1;
+  if (!max_size.isEmpty()) {
+    factor = std::max((info.width + max_size.width() - 1) / max_size.width(),
+                      (info.height + max_size.height() - 1) / max_size.height());
+  }
+
   QImage image;
+  if ((factor <= 1) || TIFFIsTiled(tif.handle())) {
+    // Nothing to reduce, or a tiled layout our strip streaming
+    // doesn't handle.  Decode the page as usual.
+    image = decodeCurrentPage(tif, info);
+    if (!image.isNull() && (factor > 1)) {
+      image = image.scaled(max_size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+  } else if (info.mapsToBinaryOrIndexed8()) {
+    image = readDownscaledGrayOrIndexed(tif, info, factor);
+  } else {
+    image = readDownscaledRgba(tif, info, factor);
+  }
+  if (image.isNull()) {
+    return QImage();
+  }
 
-  if (info.mapsToBinaryOrIndexed8()) {
-    // Common case optimization.
-    image = extractBinaryOrIndexed8Image(tif, info);
+  if (!metadata.dpi().isNull()) {
+    const Dpm dpm(metadata.dpi());
+    image.setDotsPerMeterX(dpm.horizontal() / factor);
+    image.setDotsPerMeterY(dpm.vertical() / factor);
+  }
+
+  return image;
+}  // TiffReader::readDownscaledImage
+
+QImage TiffReader::readImageRect(QIODevice& device, const int page_num, const QRect& rect) {
+  if (!device.isReadable()) {
+    return QImage();
+  }
+  if (device.isSequential()) {
+    // libtiff needs to be able to seek.
+    return QImage();
+  }
+
+  TiffHeader header(readHeader(device));
+  if (!checkHeader(header)) {
+    return QImage();
+  }
+
+  TiffHandle tif(TIFFClientOpen("file", "rBm", &device, &deviceRead, &deviceWrite, &deviceSeek, &deviceClose,
+                                &deviceSize, &deviceMap, &deviceUnmap));
+  if (!tif.handle()) {
+    return QImage();
+  }
+
+  if (!TIFFSetDirectory(tif.handle(), (uint16) page_num)) {
+    return QImage();
+  }
+
+  const TiffInfo info(tif, header);
+
+  const QRect image_rect(0, 0, info.width, info.height);
+  const QRect bounded(rect.intersected(image_rect));
+  if (bounded.isEmpty()) {
+    return QImage();
+  }
+
+  const ImageMetadata metadata(currentPageMetadata(tif));
+
+  QImage image;
+  if (bounded == image_rect) {
+    // Nothing to skip.
+    image = decodeCurrentPage(tif, info);
+  } else if (TIFFIsTiled(tif.handle())) {
+    image = readRectRgbaTiled(tif, info, bounded);
+  } else if (info.mapsToBinaryOrIndexed8()) {
+    image = readRectBinaryOrIndexed8(tif, info, bounded);
   } else {
-    // General case.
-    image = QImage(info.width, info.height, info.samples_per_pixel == 3 ? QImage::Format_RGB32 : QImage::Format_ARGB32);
-    if (image.isNull()) {
-      throw std::bad_alloc();
+    image = readRectRgbaStripped(tif, info, bounded);
+  }
+  if (image.isNull()) {
+    return QImage();
+  }
+
+  if (!metadata.dpi().isNull()) {
+    const Dpm dpm(metadata.dpi());
+    image.setDotsPerMeterX(dpm.horizontal());
+    image.setDotsPerMeterY(dpm.vertical());
+  }
+
+  return image;
+}  // TiffReader::readImageRect
+
+QImage TiffReader::readRectBinaryOrIndexed8(const TiffHandle& tif, const TiffInfo& info, const QRect& rect) {
+  std::vector<uint32_t> lut;
+  if (!currentPageColorLut(tif, info, lut)) {
+    return QImage();
+  }
+  const int num_colors = 1 << info.bits_per_sample;
+
+  // For 1 bit per sample we copy whole bytes, so the left edge is
+  // extended to a byte boundary and the surplus is cut off afterwards.
+  const int x_shift = (info.bits_per_sample == 1) ? rect.left() % 8 : 0;
+  const int left = rect.left() - x_shift;
+
+  QImage image(x_shift + rect.width(), rect.height(),
+               (info.bits_per_sample == 1) ? QImage::Format_Mono : QImage::Format_Indexed8);
+  if (image.isNull()) {
+    throw std::bad_alloc();
+  }
+  image.setColorCount(num_colors);
+  for (int i = 0; i < num_colors; ++i) {
+    image.setColor(i, lut[i]);
+  }
+
+  TiffBuffer<uint8> buf(TIFFScanlineSize(tif.handle()));
+  const int bits_per_sample = info.bits_per_sample;
+  const unsigned dst_mask = (1 << bits_per_sample) - 1;
+
+  for (int y = rect.top(); y <= rect.bottom(); ++y) {
+    // For compressions without random row access, libtiff decodes and
+    // discards the preceding rows of the strip internally, so only the
+    // strips covering our rows are ever touched.
+    if (TIFFReadScanline(tif.handle(), buf.data(), y) == -1) {
+      return QImage();
+    }
+
+    auto* dst = image.scanLine(y - rect.top());
+    if (bits_per_sample == 1) {
+      memcpy(dst, buf.data() + left / 8, (x_shift + rect.width() + 7) / 8);
+    } else if (bits_per_sample == 8) {
+      memcpy(dst, buf.data() + left, rect.width());
+    } else {
+      // 2 or 4 bits per sample.  Decode the line and keep our columns.
+      unsigned accum = 0;
+      int bits_in_accum = 0;
+      const uint8* src = buf.data();
+      for (int x = 0; x <= rect.right(); ++x) {
+        while (bits_in_accum < bits_per_sample) {
+          accum <<= 8;
+          accum |= *src;
+          bits_in_accum += 8;
+          ++src;
+        }
+        bits_in_accum -= bits_per_sample;
+        if (x >= rect.left()) {
+          *dst = static_cast<uint8>((accum >> bits_in_accum) & dst_mask);
+          ++dst;
+        }
+      }
+    }
+  }
+
+  if (x_shift > 0) {
+    // QImage::copy() does the bit shifting for us.
+    image = image.copy(x_shift, 0, rect.width(), rect.height());
+  }
+
+  return image;
+}  // TiffReader::readRectBinaryOrIndexed8
+
+QImage TiffReader::readRectRgbaStripped(const TiffHandle& tif, const TiffInfo& info, const QRect& rect) {
+  QImage image(rect.width(), rect.height(), info.samples_per_pixel == 3 ? QImage::Format_RGB32 : QImage::Format_ARGB32);
+  if (image.isNull()) {
+    throw std::bad_alloc();
+  }
+
+  uint32 rows_per_strip = 0;
+  TIFFGetFieldDefaulted(tif.handle(), TIFFTAG_ROWSPERSTRIP, &rows_per_strip);
+  if ((rows_per_strip == 0) || (rows_per_strip > (uint32) info.height)) {
+    rows_per_strip = info.height;
+  }
+
+  TiffBuffer<uint32> strip((tsize_t) info.width * rows_per_strip);
+
+  for (int strip_row = (rect.top() / (int) rows_per_strip) * (int) rows_per_strip; strip_row <= rect.bottom();
+       strip_row += rows_per_strip) {
+    if (!TIFFReadRGBAStrip(tif.handle(), strip_row, strip.data())) {
+      return QImage();
     }
+    const int strip_num_rows = std::min((int) rows_per_strip, info.height - strip_row);
+
+    const int y_first = std::max(rect.top(), strip_row);
+    const int y_last = std::min(rect.bottom(), strip_row + strip_num_rows - 1);
+    for (int y = y_first; y <= y_last; ++y) {
+      // Rows within the strip buffer are in bottom-up order.
+      const uint32* src_line = strip.data() + (tsize_t)(strip_num_rows - 1 - (y - strip_row)) * info.width;
+      auto* dst_line = (uint32*) image.scanLine(y - rect.top());
+      convertAbgrToArgb(src_line + rect.left(), dst_line, rect.width());
+    }
+  }
 
-    // For ABGR -> ARGB conversion.
-    TiffBuffer<uint32> tmp_buffer;
-    const uint32* src_line = nullptr;
+  return image;
+}  // TiffReader::readRectRgbaStripped
 
-    if (image.bytesPerLine() == 4 * info.width) {
-      // We can avoid creating a temporary buffer in this case.
-      if (!TIFFReadRGBAImageOriented(tif.handle(), info.width, info.height, (uint32*) image.bits(), ORIENTATION_TOPLEFT,
-                                     0)) {
+QImage TiffReader::readRectRgbaTiled(const TiffHandle& tif, const TiffInfo& info, const QRect& rect) {
+  uint32 tile_w = 0, tile_h = 0;
+  TIFFGetField(tif.handle(), TIFFTAG_TILEWIDTH, &tile_w);
+  TIFFGetField(tif.handle(), TIFFTAG_TILELENGTH, &tile_h);
+  if ((tile_w == 0) || (tile_h == 0)) {
+    return QImage();
+  }
+
+  QImage image(rect.width(), rect.height(), info.samples_per_pixel == 3 ? QImage::Format_RGB32 : QImage::Format_ARGB32);
+  if (image.isNull()) {
+    throw std::bad_alloc();
+  }
+
+  TiffBuffer<uint32> tile((tsize_t) tile_w * tile_h);
+
+  for (int ty = (rect.top() / (int) tile_h) * (int) tile_h; ty <= rect.bottom(); ty += tile_h) {
+    for (int tx = (rect.left() / (int) tile_w) * (int) tile_w; tx <= rect.right(); tx += tile_w) {
+      if (!TIFFReadRGBATile(tif.handle(), tx, ty, tile.data())) {
         return QImage();
       }
-      src_line = (const uint32*) image.bits();
-    } else {
-      TiffBuffer<uint32>(info.width * info.height).swap(tmp_buffer);
-      if (!TIFFReadRGBAImageOriented(tif.handle(), info.width, info.height, tmp_buffer.data(), ORIENTATION_TOPLEFT,
-                                     0)) {
-        return QImage();
+
+      const int y_first = std::max(rect.top(), ty);
+      const int y_last = std::min(rect.bottom(), std::min(ty + (int) tile_h, info.height) - 1);
+      const int x_first = std::max(rect.left(), tx);
+      const int x_last = std::min(rect.right(), std::min(tx + (int) tile_w, info.width) - 1);
+
+      for (int y = y_first; y <= y_last; ++y) {
+        // Rows within the tile buffer are in bottom-up order.
+        const uint32* src_line = tile.data() + (tsize_t)(tile_h - 1 - (y - ty)) * tile_w;
+        auto* dst_line = (uint32*) image.scanLine(y - rect.top()) + (x_first - rect.left());
+        convertAbgrToArgb(src_line + (x_first - tx), dst_line, x_last - x_first + 1);
       }
-      src_line = tmp_buffer.data();
     }
+  }
+
+  return image;
+}  // TiffReader::readRectRgbaTiled
+
+QImage TiffReader::decodeCurrentPage(const TiffHandle& tif, const TiffInfo& info) {
+  if (info.mapsToBinaryOrIndexed8()) {
+    // Common case optimization.
+    return extractBinaryOrIndexed8Image(tif, info);
+  }
+
+  // General case.
+  QImage image(info.width, info.height, info.samples_per_pixel == 3 ? QImage::Format_RGB32 : QImage::Format_ARGB32);
+  if (image.isNull()) {
+    throw std::bad_alloc();
+  }
 
-    auto* dst_line = (uint32*) image.bits();
-    assert(image.bytesPerLine() % 4 == 0);
-    const int dst_stride = image.bytesPerLine() / 4;
-    for (int y = 0; y < info.height; ++y) {
-      convertAbgrToArgb(src_line, dst_line, info.width);
-      src_line += info.width;
-      dst_line += dst_stride;
+  // For ABGR -> ARGB conversion.
+  TiffBuffer<uint32> tmp_buffer;
+  const uint32* src_line = nullptr;
+
+  if (image.bytesPerLine() == 4 * info.width) {
+    // We can avoid creating a temporary buffer in this case.
+    if (!TIFFReadRGBAImageOriented(tif.handle(), info.width, info.height, (uint32*) image.bits(), ORIENTATION_TOPLEFT,
+                                   0)) {
+      return QImage();
+    }
+    src_line = (const uint32*) image.bits();
+  } else {
+    TiffBuffer<uint32>(info.width * info.height).swap(tmp_buffer);
+    if (!TIFFReadRGBAImageOriented(tif.handle(), info.width, info.height, tmp_buffer.data(), ORIENTATION_TOPLEFT, 0)) {
+      return QImage();
     }
+    src_line = tmp_buffer.data();
   }
 
-  if (!metadata.dpi().isNull()) {
-    const Dpm dpm(metadata.dpi());
-    image.setDotsPerMeterX(dpm.horizontal());
-    image.setDotsPerMeterY(dpm.vertical());
+  auto* dst_line = (uint32*) image.bits();
+  assert(image.bytesPerLine() % 4 == 0);
+  const int dst_stride = image.bytesPerLine() / 4;
+  for (int y = 0; y < info.height; ++y) {
+    convertAbgrToArgb(src_line, dst_line, info.width);
+    src_line += info.width;
+    dst_line += dst_stride;
   }
 
   return image;
-}  // TiffReader::readImage
+}  // TiffReader::decodeCurrentPage
 
 TiffReader::TiffHeader TiffReader::readHeader(QIODevice& device) {
   unsigned char data[4];
@@ -398,21 +665,13 @@ Dpi TiffReader::getDpi(float xres, float yres, unsigned res_unit) {
   return Dpi();
 }
 
-QImage TiffReader::extractBinaryOrIndexed8Image(const TiffHandle& tif, const TiffInfo& info) {
-  QImage::Format format = QImage::Format_Indexed8;
-  if (info.bits_per_sample == 1) {
-    // Because we specify B option when opening, we can
-    // always use Format_Mono, and not Format_MonoLSB.
-    format = QImage::Format_Mono;
-  }
-
-  QImage image(info.width, info.height, format);
-  if (image.isNull()) {
-    throw std::bad_alloc();
-  }
-
+/**
+ * Resolves every sample value of a binary / grayscale / palette page
+ * to an ARGB color, so that per-pixel work becomes a table lookup.
+ */
+bool TiffReader::currentPageColorLut(const TiffHandle& tif, const TiffInfo& info, std::vector<uint32_t>& lut) {
   const int num_colors = 1 << info.bits_per_sample;
-  image.setColorCount(num_colors);
+  lut.assign(num_colors, 0);
 
   if (info.photometric == PHOTOMETRIC_PALETTE) {
     uint16* pr = nullptr;
@@ -420,7 +679,7 @@ QImage TiffReader::extractBinaryOrIndexed8Image(const TiffHandle& tif, const Tif
     uint16* pb = nullptr;
     TIFFGetField(tif.handle(), TIFFTAG_COLORMAP, &pr, &pg, &pb);
     if (!pr || !pg || !pb) {
-      return QImage();
+      return false;
     }
     if (info.host_big_endian != info.file_big_endian) {
       TIFFSwabArrayOfShort(pr, num_colors);
@@ -433,25 +692,217 @@ QImage TiffReader::extractBinaryOrIndexed8Image(const TiffHandle& tif, const Tif
       const auto g = (uint32) std::lround(pg[i] * f);
       const auto b = (uint32) std::lround(pb[i] * f);
       const uint32 a = 0xFF000000;
-      image.setColor(i, a | (r << 16) | (g << 8) | b);
+      lut[i] = a | (r << 16) | (g << 8) | b;
     }
   } else if (info.photometric == PHOTOMETRIC_MINISBLACK) {
     const double f = 255.0 / (num_colors - 1);
     for (int i = 0; i < num_colors; ++i) {
       const auto gray = (int) std::lround(i * f);
-      image.setColor(i, qRgb(gray, gray, gray));
+      lut[i] = qRgb(gray, gray, gray);
     }
   } else if (info.photometric == PHOTOMETRIC_MINISWHITE) {
     const double f = 255.0 / (num_colors - 1);
     int c = num_colors - 1;
     for (int i = 0; i < num_colors; ++i, --c) {
       const auto gray = (int) std::lround(c * f);
-      image.setColor(i, qRgb(gray, gray, gray));
+      lut[i] = qRgb(gray, gray, gray);
     }
   } else {
+    return false;
+  }
+
+  return true;
+}  // TiffReader::currentPageColorLut
+
+QImage TiffReader::readDownscaledGrayOrIndexed(const TiffHandle& tif, const TiffInfo& info, const int factor) {
+  std::vector<uint32_t> lut;
+  if (!currentPageColorLut(tif, info, lut)) {
     return QImage();
   }
 
+  bool gray = true;
+  for (const uint32_t color : lut) {
+    if ((qRed(color) != qGreen(color)) || (qRed(color) != qBlue(color))) {
+      gray = false;
+      break;
+    }
+  }
+
+  const int dst_width = (info.width + factor - 1) / factor;
+  const int dst_height = (info.height + factor - 1) / factor;
+
+  QImage image(dst_width, dst_height, gray ? QImage::Format_Indexed8 : QImage::Format_RGB32);
+  if (image.isNull()) {
+    throw std::bad_alloc();
+  }
+  if (gray) {
+    image.setColorCount(256);
+    for (int i = 0; i < 256; ++i) {
+      image.setColor(i, qRgb(i, i, i));
+    }
+  }
+
+  TiffBuffer<uint8> buf(TIFFScanlineSize(tif.handle()));
+
+  std::vector<uint32_t> sum_r(dst_width, 0);
+  std::vector<uint32_t> sum_g(dst_width, 0);
+  std::vector<uint32_t> sum_b(dst_width, 0);
+  std::vector<int> col_counts(dst_width);
+  for (int xd = 0; xd < dst_width; ++xd) {
+    col_counts[xd] = std::min(factor, info.width - xd * factor);
+  }
+
+  const int bits_per_sample = info.bits_per_sample;
+  const unsigned src_mask = (1 << bits_per_sample) - 1;
+  int rows_in_group = 0;
+  int yd = 0;
+
+  for (int y = 0; y < info.height; ++y) {
+    if (TIFFReadScanline(tif.handle(), buf.data(), y) == -1) {
+      return QImage();
+    }
+
+    const uint8* src = buf.data();
+    unsigned accum = 0;
+    int bits_in_accum = 0;
+    for (int x = 0; x < info.width; ++x) {
+      while (bits_in_accum < bits_per_sample) {
+        accum <<= 8;
+        accum |= *src;
+        bits_in_accum += 8;
+        ++src;
+      }
+      bits_in_accum -= bits_per_sample;
+      const uint32_t color = lut[(accum >> bits_in_accum) & src_mask];
+      const int xd = x / factor;
+      sum_r[xd] += qRed(color);
+      sum_g[xd] += qGreen(color);
+      sum_b[xd] += qBlue(color);
+    }
+    ++rows_in_group;
+
+    if ((rows_in_group == factor) || (y == info.height - 1)) {
+      if (gray) {
+        uint8_t* dst_line = image.scanLine(yd);
+        for (int xd = 0; xd < dst_width; ++xd) {
+          const int count = col_counts[xd] * rows_in_group;
+          dst_line[xd] = static_cast<uint8_t>((sum_r[xd] + (count >> 1)) / count);
+        }
+      } else {
+        auto* dst_line = (uint32_t*) image.scanLine(yd);
+        for (int xd = 0; xd < dst_width; ++xd) {
+          const int count = col_counts[xd] * rows_in_group;
+          dst_line[xd] = qRgb((sum_r[xd] + (count >> 1)) / count, (sum_g[xd] + (count >> 1)) / count,
+                              (sum_b[xd] + (count >> 1)) / count);
+        }
+      }
+      std::fill(sum_r.begin(), sum_r.end(), 0);
+      std::fill(sum_g.begin(), sum_g.end(), 0);
+      std::fill(sum_b.begin(), sum_b.end(), 0);
+      rows_in_group = 0;
+      ++yd;
+    }
+  }
+
+  return image;
+}  // TiffReader::readDownscaledGrayOrIndexed
+
+QImage TiffReader::readDownscaledRgba(const TiffHandle& tif, const TiffInfo& info, const int factor) {
+  const int dst_width = (info.width + factor - 1) / factor;
+  const int dst_height = (info.height + factor - 1) / factor;
+
+  QImage image(dst_width, dst_height, info.samples_per_pixel == 3 ? QImage::Format_RGB32 : QImage::Format_ARGB32);
+  if (image.isNull()) {
+    throw std::bad_alloc();
+  }
+
+  uint32 rows_per_strip = 0;
+  TIFFGetFieldDefaulted(tif.handle(), TIFFTAG_ROWSPERSTRIP, &rows_per_strip);
+  if ((rows_per_strip == 0) || (rows_per_strip > (uint32) info.height)) {
+    rows_per_strip = info.height;
+  }
+
+  // One decoded strip at a time instead of the whole page.
+  TiffBuffer<uint32> strip((tsize_t) info.width * rows_per_strip);
+
+  std::vector<uint32_t> sum_r(dst_width, 0);
+  std::vector<uint32_t> sum_g(dst_width, 0);
+  std::vector<uint32_t> sum_b(dst_width, 0);
+  std::vector<uint32_t> sum_a(dst_width, 0);
+  std::vector<int> col_counts(dst_width);
+  for (int xd = 0; xd < dst_width; ++xd) {
+    col_counts[xd] = std::min(factor, info.width - xd * factor);
+  }
+
+  int strip_first_row = 0;
+  int strip_num_rows = 0;
+  int rows_in_group = 0;
+  int yd = 0;
+
+  for (int y = 0; y < info.height; ++y) {
+    if (y >= strip_first_row + strip_num_rows) {
+      strip_first_row = y;
+      strip_num_rows = std::min((int) rows_per_strip, info.height - y);
+      if (!TIFFReadRGBAStrip(tif.handle(), y, strip.data())) {
+        return QImage();
+      }
+    }
+    // Rows within the strip buffer are in bottom-up order.
+    const uint32* src_line = strip.data() + (tsize_t)(strip_num_rows - 1 - (y - strip_first_row)) * info.width;
+
+    for (int x = 0; x < info.width; ++x) {
+      const uint32 abgr = src_line[x];
+      const int xd = x / factor;
+      sum_r[xd] += TIFFGetR(abgr);
+      sum_g[xd] += TIFFGetG(abgr);
+      sum_b[xd] += TIFFGetB(abgr);
+      sum_a[xd] += TIFFGetA(abgr);
+    }
+    ++rows_in_group;
+
+    if ((rows_in_group == factor) || (y == info.height - 1)) {
+      auto* dst_line = (uint32_t*) image.scanLine(yd);
+      for (int xd = 0; xd < dst_width; ++xd) {
+        const int count = col_counts[xd] * rows_in_group;
+        dst_line[xd] = qRgba((sum_r[xd] + (count >> 1)) / count, (sum_g[xd] + (count >> 1)) / count,
+                             (sum_b[xd] + (count >> 1)) / count, (sum_a[xd] + (count >> 1)) / count);
+      }
+      std::fill(sum_r.begin(), sum_r.end(), 0);
+      std::fill(sum_g.begin(), sum_g.end(), 0);
+      std::fill(sum_b.begin(), sum_b.end(), 0);
+      std::fill(sum_a.begin(), sum_a.end(), 0);
+      rows_in_group = 0;
+      ++yd;
+    }
+  }
+
+  return image;
+}  // TiffReader::readDownscaledRgba
+
+QImage TiffReader::extractBinaryOrIndexed8Image(const TiffHandle& tif, const TiffInfo& info) {
+  QImage::Format format = QImage::Format_Indexed8;
+  if (info.bits_per_sample == 1) {
+    // Because we specify B option when opening, we can
+    // always use Format_Mono, and not Format_MonoLSB.
+    format = QImage::Format_Mono;
+  }
+
+  QImage image(info.width, info.height, format);
+  if (image.isNull()) {
+    throw std::bad_alloc();
+  }
+
+  const int num_colors = 1 << info.bits_per_sample;
+  image.setColorCount(num_colors);
+
+  std::vector<uint32_t> lut;
+  if (!currentPageColorLut(tif, info, lut)) {
+    return QImage();
+  }
+  for (int i = 0; i < num_colors; ++i) {
+    image.setColor(i, lut[i]);
+  }
+
   if ((info.bits_per_sample == 1) || (info.bits_per_sample == 8)) {
     readLines(tif, image);
   } else {
@@ -19,11 +19,15 @@
 #ifndef TIFFREADER_H_
 #define TIFFREADER_H_
 
+#include <cstdint>
+#include <vector>
 #include "ImageMetadataLoader.h"
 #include "VirtualFunction.h"
 
 class QIODevice;
 class QImage;
+class QRect;
+class QSize;
 class ImageMetadata;
 class Dpi;
 
@@ -45,6 +49,43 @@ class TiffReader {
    */
   static QImage readImage(QIODevice& device, int page_num = 0);
 
+  /**
+   * \brief Reads a reduced-resolution version of the image.
+   *
+   * The page is decoded strip by strip and box-filtered on the fly,
+   * so the full-resolution pixels are never materialized in memory.
+   * The reduction factor is an integer chosen so that the result
+   * fits into \p max_size.
+   *
+   * \param device The device to read from.  This device must be
+   *        opened for reading and must be seekable.
+   * \param page_num A zero-based page number within a multi-page
+   *        TIFF file.
+   * \param max_size The maximum size of the resulting image.
+   *        An empty size means no downscaling.
+   * \return The resulting image, or a null image in case of failure.
+   */
+  static QImage readDownscaledImage(QIODevice& device, int page_num, const QSize& max_size);
+
+  /**
+   * \brief Reads only the given rectangle of the image.
+   *
+   * For tiled files only the tiles intersecting \p rect are decoded;
+   * for stripped files only the strips covering its rows.  Memory is
+   * allocated for the rectangle rather than the whole page.
+   *
+   * \param device The device to read from.  This device must be
+   *        opened for reading and must be seekable.
+   * \param page_num A zero-based page number within a multi-page
+   *        TIFF file.
+   * \param rect The area to read, in image coordinates.  It's clipped
+   *        to the image boundaries.  A null or full-page rectangle
+   *        results in an ordinary full decode.
+   * \return The resulting image of the size of the clipped rectangle,
+   *         or a null image in case of failure.
+   */
+  static QImage readImageRect(QIODevice& device, int page_num, const QRect& rect);
+
  private:
   class TiffHeader;
   class TiffHandle;
@@ -62,6 +103,20 @@ class TiffReader {
 
   static Dpi getDpi(float xres, float yres, unsigned res_unit);
 
+  static QImage decodeCurrentPage(const TiffHandle& tif, const TiffInfo& info);
+
+  static bool currentPageColorLut(const TiffHandle& tif, const TiffInfo& info, std::vector<uint32_t>& lut);
+
+  static QImage readDownscaledGrayOrIndexed(const TiffHandle& tif, const TiffInfo& info, int factor);
+
+  static QImage readDownscaledRgba(const TiffHandle& tif, const TiffInfo& info, int factor);
+
+  static QImage readRectBinaryOrIndexed8(const TiffHandle& tif, const TiffInfo& info, const QRect& rect);
+
+  static QImage readRectRgbaStripped(const TiffHandle& tif, const TiffInfo& info, const QRect& rect);
+
+  static QImage readRectRgbaTiled(const TiffHandle& tif, const TiffInfo& info, const QRect& rect);
+
   static QImage extractBinaryOrIndexed8Image(const TiffHandle& tif, const TiffInfo& info);
 
   static void readLines(const TiffHandle& tif, QImage& image);
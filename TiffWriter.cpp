@@ -18,12 +18,17 @@
 
 #include "TiffWriter.h"
 #include <tiffio.h>
+#include <zlib.h>
 #include <QDebug>
 #include <QtCore/QFile>
 #include <QtCore/QSettings>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <vector>
+#include "AtomicFileOverwriter.h"
 #include "Dpm.h"
+#include "ParallelFor.h"
 #include "imageproc/Constants.h"
 #include "imageproc/Grayscale.h"
 
@@ -117,6 +122,144 @@ static void deviceUnmap(thandle_t, tdata_t, toff_t) {
   // Not implemented.
 }
 
+static void setCompression(TIFF* tif, const uint16 compression) {
+  TIFFSetField(tif, TIFFTAG_COMPRESSION, compression);
+#if defined(COMPRESSION_ZSTD) && defined(TIFFTAG_ZSTD_LEVEL)
+  if (compression == COMPRESSION_ZSTD) {
+    // Level 3 compresses about as well as deflate at several times
+    // the speed.  Higher levels cost much more encode time for very
+    // little gain on scanned pages.
+    TIFFSetField(tif, TIFFTAG_ZSTD_LEVEL, 3);
+  }
+#endif
+}
+
+static bool isTiledOutput() {
+  return QSettings().value("settings/tiled_tiff", false).toBool();
+}
+
+static bool isParallelDeflate(const uint16 compression) {
+  // Deflate strips are plain zlib streams, so we can produce them ourselves
+  // with compress2() on worker threads and hand them to libtiff pre-compressed.
+  // Other codecs would require reimplementing the encoder, as a TIFF* handle
+  // itself must not be touched from multiple threads.
+  if ((compression != COMPRESSION_DEFLATE) && (compression != COMPRESSION_ADOBE_DEFLATE)) {
+    return false;
+  }
+
+  return parallelForNumThreads() > 1;
+}
+
+/**
+ * Writes the image as deflate-compressed strips, compressing the strips
+ * on worker threads and passing them to libtiff in order through
+ * TIFFWriteRawStrip().  fill_row(y, buf) must fill buf with exactly
+ * bytes_per_row bytes of scanline y in TIFF layout.
+ */
+template <typename RowFiller>
+static bool writeDeflateStrips(TIFF* tif, const int height, const int bytes_per_row, RowFiller fill_row) {
+  // Aim for strips of ~256 KB uncompressed, so that there is enough
+  // parallelism even for moderately sized pages.
+  const int rows_per_strip = std::max(1, std::min(height, (256 * 1024) / bytes_per_row));
+  TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, uint32(rows_per_strip));
+
+  const int num_strips = (height + rows_per_strip - 1) / rows_per_strip;
+  // Compressing in batches of num_threads strips bounds the memory we hold
+  // on to while still keeping every worker busy.
+  const int batch_size = parallelForNumThreads();
+
+  std::vector<std::vector<uint8_t>> compressed(batch_size);
+
+  for (int batch_begin = 0; batch_begin < num_strips; batch_begin += batch_size) {
+    const int batch_end = std::min(num_strips, batch_begin + batch_size);
+    std::vector<char> success(batch_end - batch_begin, 1);
+
+    parallelForChunked(batch_begin, batch_end, [&](const int chunk_begin, const int chunk_end) {
+      std::vector<uint8_t> raw;
+      for (int strip = chunk_begin; strip < chunk_end; ++strip) {
+        const int row_begin = strip * rows_per_strip;
+        const int row_end = std::min(height, row_begin + rows_per_strip);
+        raw.resize((row_end - row_begin) * bytes_per_row);
+        for (int y = row_begin; y < row_end; ++y) {
+          fill_row(y, &raw[(y - row_begin) * bytes_per_row]);
+        }
+
+        std::vector<uint8_t>& dst = compressed[strip - batch_begin];
+        uLongf dst_len = compressBound(uLong(raw.size()));
+        dst.resize(dst_len);
+        if (compress2(&dst[0], &dst_len, &raw[0], uLong(raw.size()), Z_DEFAULT_COMPRESSION) == Z_OK) {
+          dst.resize(dst_len);
+        } else {
+          success[strip - batch_begin] = 0;
+        }
+      }
+    });
+
+    for (int strip = batch_begin; strip < batch_end; ++strip) {
+      std::vector<uint8_t>& dst = compressed[strip - batch_begin];
+      if (!success[strip - batch_begin]) {
+        return false;
+      }
+      if (TIFFWriteRawStrip(tif, uint32(strip), &dst[0], tsize_t(dst.size())) == -1) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}  // writeDeflateStrips
+
+/**
+ * Writes the image as 512x512 tiles through libtiff's encoder.
+ * fill_row(y, buf) must fill buf with a complete scanline y in TIFF
+ * layout; the tiles are then carved out of a band of such scanlines.
+ * \p bits_per_pixel must divide the tile width into whole bytes,
+ * which holds for the 1, 8, 24 and 32 bpp layouts we produce.
+ */
+template <typename RowFiller>
+static bool writeEncodedTiles(TIFF* tif, const int width, const int height, const int bits_per_pixel, RowFiller fill_row) {
+  // Tile dimensions must be multiples of 16.
+  const uint32 tile_w = 512;
+  const uint32 tile_h = 512;
+  TIFFSetField(tif, TIFFTAG_TILEWIDTH, tile_w);
+  TIFFSetField(tif, TIFFTAG_TILELENGTH, tile_h);
+
+  const int bytes_per_row = (width * bits_per_pixel + 7) / 8;
+  const int tile_row_bytes = tile_w * bits_per_pixel / 8;
+  const int tiles_across = (width + tile_w - 1) / tile_w;
+
+  std::vector<uint8_t> band(size_t(tile_h) * bytes_per_row);
+  std::vector<uint8_t> tile(size_t(tile_h) * tile_row_bytes);
+
+  for (int ty = 0; ty < height; ty += tile_h) {
+    // Fill a band of full scanlines once, then carve all the tiles
+    // of this band out of it.
+    const int band_rows = std::min<int>(tile_h, height - ty);
+    for (int r = 0; r < band_rows; ++r) {
+      fill_row(ty + r, &band[size_t(r) * bytes_per_row]);
+    }
+
+    for (int tx = 0; tx < tiles_across; ++tx) {
+      const int x_bytes = tx * tile_row_bytes;
+      const int copy_bytes = std::min(tile_row_bytes, bytes_per_row - x_bytes);
+      if (copy_bytes < tile_row_bytes || band_rows < int(tile_h)) {
+        // An edge tile - pad the area beyond the image.
+        std::fill(tile.begin(), tile.end(), uint8_t(0));
+      }
+      for (int r = 0; r < band_rows; ++r) {
+        memcpy(&tile[size_t(r) * tile_row_bytes], &band[size_t(r) * bytes_per_row + x_bytes], copy_bytes);
+      }
+
+      const ttile_t tile_idx = TIFFComputeTile(tif, uint32(tx * tile_w), uint32(ty), 0, 0);
+      if (TIFFWriteEncodedTile(tif, tile_idx, &tile[0], tsize_t(tile.size())) == -1) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}  // writeEncodedTiles
+
 bool TiffWriter::writeImage(const QString& file_path, const QImage& image) {
   if (image.isNull()) {
     return false;
@@ -136,6 +279,26 @@ bool TiffWriter::writeImage(const QString& file_path, const QImage& image) {
   return true;
 }
 
+bool TiffWriter::writeImageAtomically(const QString& file_path, const QImage& image) {
+  if (image.isNull()) {
+    return false;
+  }
+
+  AtomicFileOverwriter overwriter;
+  QIODevice* device = overwriter.startWriting(file_path);
+  if (!device) {
+    return false;
+  }
+
+  if (!writeImage(*device, image)) {
+    overwriter.abort();
+
+    return false;
+  }
+
+  return overwriter.commit();
+}
+
 bool TiffWriter::writeImage(QIODevice& device, const QImage& image) {
   if (image.isNull()) {
     return false;
@@ -240,11 +403,9 @@ bool TiffWriter::writeBitonalOrIndexed8Image(const TiffHandle& tif, const QImage
   }
 
   if (image.format() == QImage::Format_Indexed8) {
-    TIFFSetField(tif.handle(), TIFFTAG_COMPRESSION,
-                 uint16(QSettings().value("settings/color_compression", COMPRESSION_LZW).toInt()));
+    setCompression(tif.handle(), uint16(QSettings().value("settings/color_compression", COMPRESSION_LZW).toInt()));
   } else {
-    TIFFSetField(tif.handle(), TIFFTAG_COMPRESSION,
-                 uint16(QSettings().value("settings/bw_compression", COMPRESSION_CCITTFAX4).toInt()));
+    setCompression(tif.handle(), uint16(QSettings().value("settings/bw_compression", COMPRESSION_CCITTFAX4).toInt()));
   }
 
   TIFFSetField(tif.handle(), TIFFTAG_BITSPERSAMPLE, bits_per_sample);
@@ -283,21 +444,17 @@ bool TiffWriter::writeRGB32Image(const TiffHandle& tif, const QImage& image) {
   assert(image.format() == QImage::Format_RGB32);
 
   TIFFSetField(tif.handle(), TIFFTAG_SAMPLESPERPIXEL, uint16(3));
-  TIFFSetField(tif.handle(), TIFFTAG_COMPRESSION,
-               uint16(QSettings().value("settings/color_compression", COMPRESSION_LZW).toInt()));
+  setCompression(tif.handle(), uint16(QSettings().value("settings/color_compression", COMPRESSION_LZW).toInt()));
   TIFFSetField(tif.handle(), TIFFTAG_BITSPERSAMPLE, uint16(8));
   TIFFSetField(tif.handle(), TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
 
   const int width = image.width();
   const int height = image.height();
 
-  std::vector<uint8_t> tmp_line(width * 3);
-
   // Libtiff expects "RR GG BB" sequences regardless of CPU byte order.
 
-  for (int y = 0; y < height; ++y) {
+  const auto fill_row = [&image, width](const int y, uint8_t* p_dst) {
     const auto* p_src = (const uint32_t*) image.scanLine(y);
-    uint8_t* p_dst = &tmp_line[0];
     for (int x = 0; x < width; ++x) {
       const uint32_t ARGB = *p_src;
       p_dst[0] = static_cast<uint8_t>(ARGB >> 16);
@@ -306,6 +463,22 @@ bool TiffWriter::writeRGB32Image(const TiffHandle& tif, const QImage& image) {
       ++p_src;
       p_dst += 3;
     }
+  };
+
+  if (isTiledOutput()) {
+    return writeEncodedTiles(tif.handle(), width, height, 24, fill_row);
+  }
+
+  uint16 compression = COMPRESSION_NONE;
+  TIFFGetField(tif.handle(), TIFFTAG_COMPRESSION, &compression);
+  if (isParallelDeflate(compression)) {
+    return writeDeflateStrips(tif.handle(), height, width * 3, fill_row);
+  }
+
+  std::vector<uint8_t> tmp_line(width * 3);
+
+  for (int y = 0; y < height; ++y) {
+    fill_row(y, &tmp_line[0]);
     if (TIFFWriteScanline(tif.handle(), &tmp_line[0], y) == -1) {
       return false;
     }
@@ -318,21 +491,17 @@ bool TiffWriter::writeARGB32Image(const TiffHandle& tif, const QImage& image) {
   assert(image.format() == QImage::Format_ARGB32);
 
   TIFFSetField(tif.handle(), TIFFTAG_SAMPLESPERPIXEL, uint16(4));
-  TIFFSetField(tif.handle(), TIFFTAG_COMPRESSION,
-               uint16(QSettings().value("settings/color_compression", COMPRESSION_LZW).toInt()));
+  setCompression(tif.handle(), uint16(QSettings().value("settings/color_compression", COMPRESSION_LZW).toInt()));
   TIFFSetField(tif.handle(), TIFFTAG_BITSPERSAMPLE, uint16(8));
   TIFFSetField(tif.handle(), TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
 
   const int width = image.width();
   const int height = image.height();
 
-  std::vector<uint8_t> tmp_line(width * 4);
-
   // Libtiff expects "RR GG BB AA" sequences regardless of CPU byte order.
 
-  for (int y = 0; y < height; ++y) {
+  const auto fill_row = [&image, width](const int y, uint8_t* p_dst) {
     const auto* p_src = (const uint32_t*) image.scanLine(y);
-    uint8_t* p_dst = &tmp_line[0];
     for (int x = 0; x < width; ++x) {
       const uint32_t ARGB = *p_src;
       p_dst[0] = static_cast<uint8_t>(ARGB >> 16);
@@ -342,6 +511,22 @@ bool TiffWriter::writeARGB32Image(const TiffHandle& tif, const QImage& image) {
       ++p_src;
       p_dst += 4;
     }
+  };
+
+  if (isTiledOutput()) {
+    return writeEncodedTiles(tif.handle(), width, height, 32, fill_row);
+  }
+
+  uint16 compression = COMPRESSION_NONE;
+  TIFFGetField(tif.handle(), TIFFTAG_COMPRESSION, &compression);
+  if (isParallelDeflate(compression)) {
+    return writeDeflateStrips(tif.handle(), height, width * 4, fill_row);
+  }
+
+  std::vector<uint8_t> tmp_line(width * 4);
+
+  for (int y = 0; y < height; ++y) {
+    fill_row(y, &tmp_line[0]);
     if (TIFFWriteScanline(tif.handle(), &tmp_line[0], y) == -1) {
       return false;
     }
@@ -354,6 +539,18 @@ bool TiffWriter::write8bitLines(const TiffHandle& tif, const QImage& image) {
   const int width = image.width();
   const int height = image.height();
 
+  const auto fill_row = [&image, width](const int y, uint8_t* p_dst) { memcpy(p_dst, image.scanLine(y), width); };
+
+  if (isTiledOutput()) {
+    return writeEncodedTiles(tif.handle(), width, height, 8, fill_row);
+  }
+
+  uint16 compression = COMPRESSION_NONE;
+  TIFFGetField(tif.handle(), TIFFTAG_COMPRESSION, &compression);
+  if (isParallelDeflate(compression)) {
+    return writeDeflateStrips(tif.handle(), height, width, fill_row);
+  }
+
   // TIFFWriteScanline() can actually modify the data you pass it,
   // so we have to use a temporary buffer even when no coversion
   // is required.
@@ -373,10 +570,23 @@ bool TiffWriter::write8bitLines(const TiffHandle& tif, const QImage& image) {
 bool TiffWriter::writeBinaryLinesAsIs(const TiffHandle& tif, const QImage& image) {
   const int width = image.width();
   const int height = image.height();
+  const int bpl = (width + 7) / 8;
+
+  const auto fill_row = [&image, bpl](const int y, uint8_t* p_dst) { memcpy(p_dst, image.scanLine(y), bpl); };
+
+  if (isTiledOutput()) {
+    return writeEncodedTiles(tif.handle(), width, height, 1, fill_row);
+  }
+
+  uint16 compression = COMPRESSION_NONE;
+  TIFFGetField(tif.handle(), TIFFTAG_COMPRESSION, &compression);
+  if (isParallelDeflate(compression)) {
+    return writeDeflateStrips(tif.handle(), height, bpl, fill_row);
+  }
+
   // TIFFWriteScanline() can actually modify the data you pass it,
   // so we have to use a temporary buffer even when no coversion
   // is required.
-  const int bpl = (width + 7) / 8;
   std::vector<uint8_t> tmp_line(bpl, 0);
 
   for (int y = 0; y < height; ++y) {
@@ -395,13 +605,28 @@ bool TiffWriter::writeBinaryLinesReversed(const TiffHandle& tif, const QImage& i
   const int height = image.height();
 
   const int bpl = (width + 7) / 8;
-  std::vector<uint8_t> tmp_line(bpl, 0);
 
-  for (int y = 0; y < height; ++y) {
+  const auto fill_row = [&image, bpl](const int y, uint8_t* p_dst) {
     const uint8_t* src_line = image.scanLine(y);
     for (int i = 0; i < bpl; ++i) {
-      tmp_line[i] = m_reverseBitsLUT[src_line[i]];
+      p_dst[i] = m_reverseBitsLUT[src_line[i]];
     }
+  };
+
+  if (isTiledOutput()) {
+    return writeEncodedTiles(tif.handle(), width, height, 1, fill_row);
+  }
+
+  uint16 compression = COMPRESSION_NONE;
+  TIFFGetField(tif.handle(), TIFFTAG_COMPRESSION, &compression);
+  if (isParallelDeflate(compression)) {
+    return writeDeflateStrips(tif.handle(), height, bpl, fill_row);
+  }
+
+  std::vector<uint8_t> tmp_line(bpl, 0);
+
+  for (int y = 0; y < height; ++y) {
+    fill_row(y, &tmp_line[0]);
     if (TIFFWriteScanline(tif.handle(), &tmp_line[0], y) == -1) {
       return false;
     }
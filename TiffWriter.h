@@ -49,6 +49,15 @@ class TiffWriter {
    */
   static bool writeImage(QIODevice& device, const QImage& image);
 
+  /**
+   * \brief Like writeImage(const QString&, ...), but overwrites the
+   *        target atomically via a same-directory temporary file.
+   *
+   * Readers never observe a partially written file: the target either
+   * keeps its previous content or gets the complete new one.
+   */
+  static bool writeImageAtomically(const QString& file_path, const QImage& image);
+
  private:
   class TiffHandle;
 
@@ -22,6 +22,7 @@
 #include <QString>
 #include <map>
 #include <unordered_map>
+#include "FlatHashMap.h"
 #include "ThumbnailPixmapCache.h"
 
 class Utils {
@@ -35,6 +36,11 @@ class Utils {
   static typename std::unordered_map<K, V, Hash, Pred, Alloc>::iterator
   mapSetValue(std::unordered_map<K, V, Hash, Pred, Alloc>& map, const K& key, const V& val);
 
+  template <typename K, typename V, typename Hash, typename Pred>
+  static typename FlatHashMap<K, V, Hash, Pred>::iterator mapSetValue(FlatHashMap<K, V, Hash, Pred>& map,
+                                                                      const K& key,
+                                                                      const V& val);
+
   template <typename T>
   static T castOrFindChild(QObject* object);
 
@@ -104,6 +110,20 @@ Utils::mapSetValue(std::unordered_map<K, V, Hash, Pred, Alloc>& map, const K& ke
   }
 }
 
+template <typename K, typename V, typename Hash, typename Pred>
+typename FlatHashMap<K, V, Hash, Pred>::iterator Utils::mapSetValue(FlatHashMap<K, V, Hash, Pred>& map,
+                                                                    const K& key,
+                                                                    const V& val) {
+  const auto it(map.find(key));
+  if (it == map.end()) {
+    return map.insert(typename FlatHashMap<K, V, Hash, Pred>::value_type(key, val)).first;
+  } else {
+    it->second = val;
+
+    return it;
+  }
+}
+
 template <typename T>
 T Utils::castOrFindChild(QObject* object) {
   if (object == nullptr) {
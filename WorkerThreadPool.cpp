@@ -18,26 +18,24 @@
 
 #include "WorkerThreadPool.h"
 #include <QCoreApplication>
+#include <QThread>
 #include <QThreadPool>
 #include <utility>
 #include "OutOfMemoryHandler.h"
+#include "ParallelFor.h"
 
+/**
+ * A wake-up marker for the GUI thread.  The results themselves travel
+ * through m_resultQueue, so a single event covers any number of them.
+ */
 class WorkerThreadPool::TaskResultEvent : public QEvent {
  public:
-  TaskResultEvent(BackgroundTaskPtr task, FilterResultPtr result)
-      : QEvent(User), m_task(std::move(task)), m_result(std::move(result)) {}
-
-  const BackgroundTaskPtr& task() const { return m_task; }
-
-  const FilterResultPtr& result() const { return m_result; }
-
- private:
-  BackgroundTaskPtr m_task;
-  FilterResultPtr m_result;
+  TaskResultEvent() : QEvent(User) {}
 };
 
 
-WorkerThreadPool::WorkerThreadPool(QObject* parent) : QObject(parent), m_pool(new QThreadPool(this)) {
+WorkerThreadPool::WorkerThreadPool(QObject* parent)
+    : QObject(parent), m_pool(new QThreadPool(this)), m_resultQueue(ResultQueue::UNBOUNDED) {
   updateNumberOfThreads();
 }
 
@@ -65,10 +63,42 @@ void WorkerThreadPool::submitTask(const BackgroundTaskPtr& task) {
         return;
       }
 
+      // Count this task thread against the machine-wide thread
+      // budget.  The parallel kernels inside the task then draw
+      // helper tokens from the same budget, so the total number of
+      // active threads stays put no matter how many pages are being
+      // processed concurrently.
+      const ParallelForActiveThread active_thread;
+
+      // Batch tasks saturate every core for minutes at a time, so
+      // they run below normal priority: the thumbnail decode lane
+      // and interactive tasks stay responsive at a small, bounded
+      // cost to batch throughput.  The pool reuses its threads, so
+      // the priority is restored once the task is done.
+      class ScopedLowPriority {
+       public:
+        explicit ScopedLowPriority(bool lower) : m_lowered(lower) {
+          if (m_lowered) {
+            QThread::currentThread()->setPriority(QThread::LowPriority);
+          }
+        }
+
+        ~ScopedLowPriority() {
+          if (m_lowered) {
+            QThread::currentThread()->setPriority(QThread::NormalPriority);
+          }
+        }
+
+       private:
+        const bool m_lowered;
+      };
+
+      const ScopedLowPriority priority_scope(m_task->type() == BackgroundTask::BATCH);
+
       try {
         const FilterResultPtr result((*m_task)());
         if (result) {
-          QCoreApplication::postEvent(&m_owner, new TaskResultEvent(m_task, result));
+          m_owner.postResult(m_task, result, /*intermediate=*/false);
         }
       } catch (const std::bad_alloc&) {
         OutOfMemoryHandler::instance().handleOutOfMemorySituation();
@@ -80,14 +110,52 @@ void WorkerThreadPool::submitTask(const BackgroundTaskPtr& task) {
     BackgroundTaskPtr m_task;
   };
 
+  class IntermediateResultSink : public BackgroundTask::IntermediateResultSink {
+   public:
+    IntermediateResultSink(WorkerThreadPool& owner, BackgroundTask& task) : m_owner(owner), m_task(task) {}
+
+    // Called from a worker thread while the task is still running.
+    void operator()(const FilterResultPtr& result) override {
+      m_owner.postResult(BackgroundTaskPtr(&m_task), result, /*intermediate=*/true);
+    }
+
+   private:
+    WorkerThreadPool& m_owner;
+
+    // A plain reference, as holding a BackgroundTaskPtr here would form
+    // an ownership cycle with the task that owns this sink.
+    BackgroundTask& m_task;
+  };
+
+
+  task->setIntermediateResultSink(make_intrusive<IntermediateResultSink>(*this, *task));
 
   updateNumberOfThreads();
   m_pool->start(new Runnable(*this, task));
 }  // WorkerThreadPool::submitTask
 
 void WorkerThreadPool::customEvent(QEvent* event) {
-  if (auto* evt = dynamic_cast<TaskResultEvent*>(event)) {
-    emit taskResult(evt->task(), evt->result());
+  if (dynamic_cast<TaskResultEvent*>(event)) {
+    // Clearing the flag before draining guarantees that a result
+    // pushed after the drain gets a wake-up event of its own.
+    m_resultEventPending.store(false);
+    ResultItem item;
+    while (m_resultQueue.pop(item)) {
+      if (item.intermediate) {
+        emit taskIntermediateResult(item.task, item.result);
+      } else {
+        emit taskResult(item.task, item.result);
+      }
+    }
+  }
+}
+
+void WorkerThreadPool::postResult(const BackgroundTaskPtr& task, const FilterResultPtr& result, bool intermediate) {
+  m_resultQueue.push(ResultItem{task, result, intermediate});
+  // Coalesce wake-ups: only post an event if the previously
+  // posted one hasn't been processed yet.
+  if (!m_resultEventPending.exchange(true)) {
+    QCoreApplication::postEvent(this, new TaskResultEvent);
   }
 }
 
@@ -107,4 +175,8 @@ void WorkerThreadPool::updateNumberOfThreads() {
   int num_threads = m_settings.value("settings/batch_processing_threads", max_threads).toInt();
   num_threads = std::min<int>(num_threads, max_threads);
   m_pool->setMaxThreadCount(num_threads);
+
+  // The same setting is the machine-wide budget the parallel kernels
+  // inside the tasks draw their helper threads from.
+  parallelForSetGlobalBudget(num_threads);
 }
@@ -21,9 +21,12 @@
 
 #include <QObject>
 #include <QSettings>
+#include <atomic>
 #include <memory>
+#include <utility>
 #include "BackgroundTask.h"
 #include "FilterResult.h"
+#include "LockFreeQueue.h"
 
 class QThreadPool;
 
@@ -50,15 +53,50 @@ class WorkerThreadPool : public QObject {
 
   void taskResult(const BackgroundTaskPtr& task, const FilterResultPtr& result);
 
+  /**
+   * \brief Emitted for results a still-running task delivered through
+   *        BackgroundTask::deliverIntermediateResult().
+   *
+   * Any intermediate results of a task are always emitted before its
+   * final taskResult().
+   */
+  void taskIntermediateResult(const BackgroundTaskPtr& task, const FilterResultPtr& result);
+
  private:
   class TaskResultEvent;
 
+  struct ResultItem {
+    BackgroundTaskPtr task;
+    FilterResultPtr result;
+    bool intermediate = false;
+  };
+
+  typedef LockFreeQueue<ResultItem> ResultQueue;
+
   void customEvent(QEvent* event) override;
 
+  /**
+   * \brief Queues a result and wakes the GUI thread up.
+   *
+   * May be called from any thread.
+   */
+  void postResult(const BackgroundTaskPtr& task, const FilterResultPtr& result, bool intermediate);
+
   void updateNumberOfThreads();
 
   QThreadPool* m_pool;
   QSettings m_settings;
+
+  /**
+   * Finished tasks hand their results over through this queue rather
+   * than through one event posting per result.  Intermediate results
+   * travel through the same queue, which keeps them ordered before
+   * the final result of their task.  A wake-up event is only posted
+   * on an empty -> non-empty transition, as tracked by
+   * m_resultEventPending, and customEvent() drains the whole queue.
+   */
+  ResultQueue m_resultQueue;
+  std::atomic<bool> m_resultEventPending{false};
 };
 
 
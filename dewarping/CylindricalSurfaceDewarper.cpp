@@ -120,6 +120,22 @@ CylindricalSurfaceDewarper::Generatrix CylindricalSurfaceDewarper::mapGeneratrix
 QPointF CylindricalSurfaceDewarper::mapToDewarpedSpace(const QPointF& img_pt) const {
   State state;
 
+  return mapToDewarpedSpace(img_pt, state);
+}
+
+std::vector<QPointF> CylindricalSurfaceDewarper::mapToDewarpedSpace(const std::vector<QPointF>& img_pts) const {
+  State state;
+
+  std::vector<QPointF> crv_pts;
+  crv_pts.reserve(img_pts.size());
+  for (const QPointF& img_pt : img_pts) {
+    crv_pts.push_back(mapToDewarpedSpace(img_pt, state));
+  }
+
+  return crv_pts;
+}
+
+QPointF CylindricalSurfaceDewarper::mapToDewarpedSpace(const QPointF& img_pt, State& state) const {
   const double pln_x = m_img2pln(img_pt)[0];
   const double crv_x = m_arcLengthMapper.xToArcLen(pln_x, state.m_arcLengthHint);
 
@@ -321,6 +337,9 @@ void CylindricalSurfaceDewarper::initArcLengthMapper(const std::vector<QPointF>&
   m_directrixArcLength = m_arcLengthMapper.totalArcLength();
   // Scale arc lengths to the range of [0, 1].
   m_arcLengthMapper.normalizeRange(1);
+  // Dewarping issues a huge number of queries, so have them
+  // answered by table lookups rather than binary searches.
+  m_arcLengthMapper.buildLookupTables();
 }  // CylindricalSurfaceDewarper::initArcLengthMapper
 
 /*======================= CoupledPolylinesIterator =========================*/
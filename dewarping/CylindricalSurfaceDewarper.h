@@ -74,6 +74,16 @@ class CylindricalSurfaceDewarper {
    */
   QPointF mapToDewarpedSpace(const QPointF& img_pt) const;
 
+  /**
+   * \brief Maps a sequence of points to dewarped normalized coordinates.
+   *
+   * Equivalent to mapping each point individually, but a single State
+   * is carried through the whole sequence, so the arc length and
+   * polyline intersection hints warm up once rather than per point.
+   * Worth using for polylines with many vertices.
+   */
+  std::vector<QPointF> mapToDewarpedSpace(const std::vector<QPointF>& img_pts) const;
+
   /**
    * Transforms a point from dewarped normalized coordinates
    * to warped image coordinates.  See comments in the beginning
@@ -85,6 +95,8 @@ class CylindricalSurfaceDewarper {
  private:
   class CoupledPolylinesIterator;
 
+  QPointF mapToDewarpedSpace(const QPointF& img_pt, State& state) const;
+
   static HomographicTransform<2, double> calcPlnToImgHomography(const std::vector<QPointF>& img_directrix1,
                                                                 const std::vector<QPointF>& img_directrix2);
 
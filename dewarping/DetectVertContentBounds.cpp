@@ -22,7 +22,9 @@
 #include <boost/foreach.hpp>
 #include <boost/lambda/bind.hpp>
 #include <boost/lambda/lambda.hpp>
+#include <mutex>
 #include "DebugImages.h"
+#include "ParallelFor.h"
 #include "VecNT.h"
 #include "imageproc/BinaryImage.h"
 #include "imageproc/Constants.h"
@@ -268,13 +270,42 @@ QLineF SequentialColumnProcessor::approximateWithLine(std::vector<Segment>* dbg_
   std::partial_sort(
       segments.begin(), segments.begin() + num_best_segments, segments.end(),
       bind(&Segment::distToVertLine, _1, m_leadingTop.x()) < bind(&Segment::distToVertLine, _2, m_leadingTop.x()));
+  // Continue with random samples.  The random indexes get drawn up
+  // front, so the result stays reproducible while the scoring below
+  // runs in parallel.
+  const int ransac_iterations = segments.empty() ? 0 : 200;
+  std::vector<size_t> seed_indexes;
+  seed_indexes.reserve(num_best_segments + ransac_iterations);
   for (size_t i = 0; i < num_best_segments; ++i) {
-    ransac.buildAndAssessModel(segments[i]);
+    seed_indexes.push_back(i);
   }
-  // Continue with random samples.
-  const int ransac_iterations = segments.empty() ? 0 : 200;
   for (int i = 0; i < ransac_iterations; ++i) {
-    ransac.buildAndAssessModel(segments[qrand() % segments.size()]);
+    seed_indexes.push_back(qrand() % segments.size());
+  }
+
+  // Score the candidates in parallel, one best model per chunk, then
+  // merge the chunk winners in chunk order, so that ties resolve
+  // exactly as they would in a serial run.
+  std::mutex merge_mutex;
+  std::vector<std::pair<int, RansacModel>> chunk_models;
+  parallelForChunked(0, static_cast<int>(seed_indexes.size()), [&](const int begin, const int end) {
+    RansacAlgo chunk_ransac(segments);
+    for (int i = begin; i < end; ++i) {
+      chunk_ransac.buildAndAssessModel(segments[seed_indexes[i]]);
+    }
+
+    const std::lock_guard<std::mutex> guard(merge_mutex);
+    chunk_models.emplace_back(begin, std::move(chunk_ransac.bestModel()));
+  });
+
+  std::sort(chunk_models.begin(), chunk_models.end(),
+            [](const std::pair<int, RansacModel>& lhs, const std::pair<int, RansacModel>& rhs) {
+              return lhs.first < rhs.first;
+            });
+  for (std::pair<int, RansacModel>& chunk_model : chunk_models) {
+    if (chunk_model.second.betterThan(ransac.bestModel())) {
+      chunk_model.second.swap(ransac.bestModel());
+    }
   }
 
   if (ransac.bestModel().segments.empty()) {
@@ -376,32 +407,34 @@ void calculateVertRanges(const imageproc::BinaryImage& image, std::vector<VertRa
   const int image_stride = image.wordsPerLine();
   const uint32_t msb = uint32_t(1) << 31;
 
-  ranges.reserve(width);
+  ranges.resize(width);
 
-  for (int x = 0; x < width; ++x) {
-    ranges.emplace_back();
-    VertRange& range = ranges.back();
+  // Columns are independent of each other, so scan them in strips in parallel.
+  parallelForChunked(0, width, [&](const int x_begin, const int x_end) {
+    for (int x = x_begin; x < x_end; ++x) {
+      VertRange& range = ranges[x];
 
-    const uint32_t mask = msb >> (x & 31);
-    const uint32_t* p_word = image_data + (x >> 5);
+      const uint32_t mask = msb >> (x & 31);
+      const uint32_t* p_word = image_data + (x >> 5);
 
-    int top_y = 0;
-    for (; top_y < height; ++top_y, p_word += image_stride) {
-      if (*p_word & mask) {
-        range.top = top_y;
-        break;
+      int top_y = 0;
+      for (; top_y < height; ++top_y, p_word += image_stride) {
+        if (*p_word & mask) {
+          range.top = top_y;
+          break;
+        }
       }
-    }
 
-    int bottom_y = height - 1;
-    p_word = image_data + bottom_y * image_stride + (x >> 5);
-    for (; bottom_y >= top_y; --bottom_y, p_word -= image_stride) {
-      if (*p_word & mask) {
-        range.bottom = bottom_y;
-        break;
+      int bottom_y = height - 1;
+      p_word = image_data + bottom_y * image_stride + (x >> 5);
+      for (; bottom_y >= top_y; --bottom_y, p_word -= image_stride) {
+        if (*p_word & mask) {
+          range.bottom = bottom_y;
+          break;
+        }
       }
     }
-  }
+  });
 }  // calculateVertRanges
 
 QLineF extendLine(const QLineF& line, int height) {
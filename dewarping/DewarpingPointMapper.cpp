@@ -29,7 +29,8 @@ DewarpingPointMapper::DewarpingPointMapper(const DistortionModel& distortion_mod
     : m_dewarper(CylindricalSurfaceDewarper(distortion_model.topCurve().polyline(),
                                             distortion_model.bottomCurve().polyline(),
                                             depth_perception)),
-      m_postTransform(postTransform) {
+      m_postTransform(postTransform),
+      m_invPostTransform(postTransform.inverted()) {
   // Model domain is a rectangle in output image coordinates that
   // will be mapped to our curved quadrilateral.
   const QRect model_domain(
@@ -56,11 +57,23 @@ QPointF DewarpingPointMapper::mapToDewarpedSpace(const QPointF& warped_pt) const
 }
 
 QPointF DewarpingPointMapper::mapToWarpedSpace(const QPointF& dewarped_pt) const {
-  QPointF dewarped_pt_m = m_postTransform.inverted().map(dewarped_pt);
+  const QPointF dewarped_pt_m = m_invPostTransform.map(dewarped_pt);
 
   const double crv_x = (dewarped_pt_m.x() - m_modelDomainLeft) * m_modelXScaleToNormalized;
   const double crv_y = (dewarped_pt_m.y() - m_modelDomainTop) * m_modelYScaleToNormalized;
 
   return m_dewarper.mapToWarpedSpace(QPointF(crv_x, crv_y));
 }
+
+std::vector<QPointF> DewarpingPointMapper::mapPolylineToDewarpedSpace(
+    const std::vector<QPointF>& warped_polyline) const {
+  std::vector<QPointF> dewarped_polyline(m_dewarper.mapToDewarpedSpace(warped_polyline));
+  for (QPointF& pt : dewarped_polyline) {
+    const double dewarped_x = pt.x() * m_modelXScaleFromNormalized + m_modelDomainLeft;
+    const double dewarped_y = pt.y() * m_modelYScaleFromNormalized + m_modelDomainTop;
+    pt = m_postTransform.map(QPointF(dewarped_x, dewarped_y));
+  }
+
+  return dewarped_polyline;
+}
 }  // namespace dewarping
\ No newline at end of file
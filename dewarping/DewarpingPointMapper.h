@@ -49,6 +49,13 @@ class DewarpingPointMapper {
    */
   QPointF mapToWarpedSpace(const QPointF& dewarped_pt) const;
 
+  /**
+   * Maps a whole polyline to dewarped image coordinates.  Unlike
+   * per-point mapToDewarpedSpace() calls, the dewarper state is
+   * shared across the vertices.
+   */
+  std::vector<QPointF> mapPolylineToDewarpedSpace(const std::vector<QPointF>& warped_polyline) const;
+
  private:
   CylindricalSurfaceDewarper m_dewarper;
   double m_modelDomainLeft;
@@ -58,6 +65,7 @@ class DewarpingPointMapper {
   double m_modelXScaleToNormalized;
   double m_modelYScaleToNormalized;
   QTransform m_postTransform;
+  QTransform m_invPostTransform;
 };
 }  // namespace dewarping
 #endif  // ifndef DEWARPING_DEWARPING_POINT_MAPPER_H_
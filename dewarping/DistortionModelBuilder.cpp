@@ -442,10 +442,8 @@ void DistortionModelBuilder::RansacAlgo::buildAndAssessModel(const TracedCurve*
     std::vector<double> B;
     B.reserve(polyline_size);
 
-    for (const QPointF& warped_pt : curve.trimmedPolyline) {
-      // TODO: add another signature with hint for efficiency.
-      const QPointF dewarped_pt(dewarper.mapToDewarpedSpace(warped_pt));
-
+    // The batch version shares the mapping hints across the polyline.
+    for (const QPointF& dewarped_pt : dewarper.mapToDewarpedSpace(curve.trimmedPolyline)) {
       // ax + b = y  <-> x * a + 1 * b = y
       At.push_back(dewarped_pt.x());
       At.push_back(1);
@@ -20,6 +20,8 @@
 #include <QDebug>
 #include <cmath>
 #include "CylindricalSurfaceDewarper.h"
+#include "ParallelFor.h"
+#include "imageproc/AccelBackend.h"
 #include "imageproc/ColorMixer.h"
 #include "imageproc/GrayImage.h"
 
@@ -48,34 +50,38 @@ void dewarpGeneric(const PixelType* const src_data,
   const int dst_width = dst_size.width();
   const int dst_height = dst_size.height();
 
-  CylindricalSurfaceDewarper::State state;
-
   const double model_domain_left = model_domain.left();
   const double model_x_scale = 1.0 / (model_domain.right() - model_domain.left());
 
   const float model_domain_top = model_domain.top();
   const float model_y_scale = 1.0 / (model_domain.bottom() - model_domain.top());
 
-  for (int dst_x = 0; dst_x < dst_width; ++dst_x) {
-    const double model_x = (dst_x - model_domain_left) * model_x_scale;
-    const CylindricalSurfaceDewarper::Generatrix generatrix(distortion_model.mapGeneratrix(model_x, state));
+  // Destination columns are independent, so the image splits into
+  // vertical strips, each with its own State.
+  parallelForChunked(0, dst_width, [&](const int x_begin, const int x_end) {
+    CylindricalSurfaceDewarper::State state;
+
+    for (int dst_x = x_begin; dst_x < x_end; ++dst_x) {
+      const double model_x = (dst_x - model_domain_left) * model_x_scale;
+      const CylindricalSurfaceDewarper::Generatrix generatrix(distortion_model.mapGeneratrix(model_x, state));
+
+      const HomographicTransform<1, float> homog(generatrix.pln2img.mat());
+      const Vec2f origin(generatrix.imgLine.p1());
+      const Vec2f vec(generatrix.imgLine.p2() - generatrix.imgLine.p1());
+      for (int dst_y = 0; dst_y < dst_height; ++dst_y) {
+        const float model_y = (float(dst_y) - model_domain_top) * model_y_scale;
+        const Vec2f src_pt(origin + vec * homog(model_y));
+        const int src_x = qRound(src_pt[0]);
+        const int src_y = qRound(src_pt[1]);
+        if ((src_x < 0) || (src_x >= src_width) || (src_y < 0) || (src_y >= src_height)) {
+          dst_data[dst_y * dst_stride + dst_x] = bg_color;
+          continue;
+        }
 
-    const HomographicTransform<1, float> homog(generatrix.pln2img.mat());
-    const Vec2f origin(generatrix.imgLine.p1());
-    const Vec2f vec(generatrix.imgLine.p2() - generatrix.imgLine.p1());
-    for (int dst_y = 0; dst_y < dst_height; ++dst_y) {
-      const float model_y = (float(dst_y) - model_domain_top) * model_y_scale;
-      const Vec2f src_pt(origin + vec * homog(model_y));
-      const int src_x = qRound(src_pt[0]);
-      const int src_y = qRound(src_pt[1]);
-      if ((src_x < 0) || (src_x >= src_width) || (src_y < 0) || (src_y >= src_height)) {
-        dst_data[dst_y * dst_stride + dst_x] = bg_color;
-        continue;
+        dst_data[dst_y * dst_stride + dst_x] = src_data[src_y * src_stride + src_x];
       }
-
-      dst_data[dst_y * dst_stride + dst_x] = src_data[src_y * src_stride + src_x];
     }
-  }
+  });
 }  // dewarpGeneric
 
 #elif INTERPOLATION_METHOD == INTERP_BILLINEAR
@@ -94,60 +100,64 @@ void dewarpGeneric(const PixelType* const src_data,
   const int dst_width = dst_size.width();
   const int dst_height = dst_size.height();
 
-  CylindricalSurfaceDewarper::State state;
-
   const double model_domain_left = model_domain.left() - 0.5f;
   const double model_x_scale = 1.0 / (model_domain.right() - model_domain.left());
 
   const float model_domain_top = model_domain.top() - 0.5f;
   const float model_y_scale = 1.0 / (model_domain.bottom() - model_domain.top());
 
-  for (int dst_x = 0; dst_x < dst_width; ++dst_x) {
-    const double model_x = (dst_x - model_domain_left) * model_x_scale;
-    const CylindricalSurfaceDewarper::Generatrix generatrix(distortion_model.mapGeneratrix(model_x, state));
+  // Destination columns are independent, so the image splits into
+  // vertical strips, each with its own State.
+  parallelForChunked(0, dst_width, [&](const int x_begin, const int x_end) {
+    CylindricalSurfaceDewarper::State state;
+
+    for (int dst_x = x_begin; dst_x < x_end; ++dst_x) {
+      const double model_x = (dst_x - model_domain_left) * model_x_scale;
+      const CylindricalSurfaceDewarper::Generatrix generatrix(distortion_model.mapGeneratrix(model_x, state));
+
+      const HomographicTransform<1, float> homog(generatrix.pln2img.mat());
+      const Vec2f origin(generatrix.imgLine.p1());
+      const Vec2f vec(generatrix.imgLine.p2() - generatrix.imgLine.p1());
+      for (int dst_y = 0; dst_y < dst_height; ++dst_y) {
+        const float model_y = ((float) dst_y - model_domain_top) * model_y_scale;
+        const Vec2f src_pt(origin + vec * homog(model_y));
+
+        const int src_x0 = (int) std::floor(src_pt[0] - 0.5f);
+        const int src_y0 = (int) std::floor(src_pt[1] - 0.5f);
+        const int src_x1 = src_x0 + 1;
+        const int src_y1 = src_y0 + 1;
+        const float x = src_pt[0] - src_x0;
+        const float y = src_pt[1] - src_y0;
+
+        PixelType tl_color = bg_color;
+        if ((src_x0 >= 0) && (src_x0 < src_width) && (src_y0 >= 0) && (src_y0 < src_height)) {
+          tl_color = src_data[src_y0 * src_stride + src_x0];
+        }
 
-    const HomographicTransform<1, float> homog(generatrix.pln2img.mat());
-    const Vec2f origin(generatrix.imgLine.p1());
-    const Vec2f vec(generatrix.imgLine.p2() - generatrix.imgLine.p1());
-    for (int dst_y = 0; dst_y < dst_height; ++dst_y) {
-      const float model_y = ((float) dst_y - model_domain_top) * model_y_scale;
-      const Vec2f src_pt(origin + vec * homog(model_y));
-
-      const int src_x0 = (int) std::floor(src_pt[0] - 0.5f);
-      const int src_y0 = (int) std::floor(src_pt[1] - 0.5f);
-      const int src_x1 = src_x0 + 1;
-      const int src_y1 = src_y0 + 1;
-      const float x = src_pt[0] - src_x0;
-      const float y = src_pt[1] - src_y0;
-
-      PixelType tl_color = bg_color;
-      if ((src_x0 >= 0) && (src_x0 < src_width) && (src_y0 >= 0) && (src_y0 < src_height)) {
-        tl_color = src_data[src_y0 * src_stride + src_x0];
-      }
+        PixelType tr_color = bg_color;
+        if ((src_x1 >= 0) && (src_x1 < src_width) && (src_y0 >= 0) && (src_y0 < src_height)) {
+          tr_color = src_data[src_y0 * src_stride + src_x1];
+        }
 
-      PixelType tr_color = bg_color;
-      if ((src_x1 >= 0) && (src_x1 < src_width) && (src_y0 >= 0) && (src_y0 < src_height)) {
-        tr_color = src_data[src_y0 * src_stride + src_x1];
-      }
+        PixelType bl_color = bg_color;
+        if ((src_x0 >= 0) && (src_x0 < src_width) && (src_y1 >= 0) && (src_y1 < src_height)) {
+          bl_color = src_data[src_y1 * src_stride + src_x0];
+        }
 
-      PixelType bl_color = bg_color;
-      if ((src_x0 >= 0) && (src_x0 < src_width) && (src_y1 >= 0) && (src_y1 < src_height)) {
-        bl_color = src_data[src_y1 * src_stride + src_x0];
-      }
+        PixelType br_color = bg_color;
+        if ((src_x1 >= 0) && (src_x1 < src_width) && (src_y1 >= 0) && (src_y1 < src_height)) {
+          br_color = src_data[src_y1 * src_stride + src_x1];
+        }
 
-      PixelType br_color = bg_color;
-      if ((src_x1 >= 0) && (src_x1 < src_width) && (src_y1 >= 0) && (src_y1 < src_height)) {
-        br_color = src_data[src_y1 * src_stride + src_x1];
+        ColorMixer mixer;
+        mixer.add(tl_color, (1.5f - y) * (1.5f - x));
+        mixer.add(tr_color, (1.5f - y) * (x - 0.5f));
+        mixer.add(bl_color, (y - 0.5f) * (1.5f - x));
+        mixer.add(br_color, (y - 0.5f) * (x - 0.5f));
+        dst_data[dst_y * dst_stride + dst_x] = mixer.mix(1.0f);
       }
-
-      ColorMixer mixer;
-      mixer.add(tl_color, (1.5f - y) * (1.5f - x));
-      mixer.add(tr_color, (1.5f - y) * (x - 0.5f));
-      mixer.add(bl_color, (y - 0.5f) * (1.5f - x));
-      mixer.add(br_color, (y - 0.5f) * (x - 0.5f));
-      dst_data[dst_y * dst_stride + dst_x] = mixer.mix(1.0f);
     }
-  }
+  });
 }  // dewarpGeneric
 
 #elif INTERPOLATION_METHOD == INTERP_AREA_MAPPING
@@ -417,41 +427,57 @@ void dewarpGeneric(const PixelType* const src_data,
                    const CylindricalSurfaceDewarper& distortion_model,
                    const QRectF& model_domain,
                    const PixelType bg_color) {
-  const int src_width = src_size.width();
-  const int src_height = src_size.height();
   const int dst_width = dst_size.width();
   const int dst_height = dst_size.height();
 
-  CylindricalSurfaceDewarper::State state;
-
   const double model_domain_left = model_domain.left();
   const double model_x_scale = 1.0 / (model_domain.right() - model_domain.left());
 
   const auto model_domain_top = static_cast<const float>(model_domain.top());
   const auto model_y_scale = static_cast<const float>(1.0 / (model_domain.bottom() - model_domain.top()));
 
-  std::vector<Vec2f> prev_grid_column(dst_height + 1);
-  std::vector<Vec2f> next_grid_column(dst_height + 1);
+  // The model y coordinates are the same for every grid column.
+  std::vector<float> model_ys(dst_height + 1);
+  for (int dst_y = 0; dst_y <= dst_height; ++dst_y) {
+    model_ys[dst_y] = (float(dst_y) - model_domain_top) * model_y_scale;
+  }
 
-  for (int dst_x = 0; dst_x <= dst_width; ++dst_x) {
-    const double model_x = (dst_x - model_domain_left) * model_x_scale;
+  const auto compute_grid_column = [&](const int grid_x, std::vector<Vec2f>& column, std::vector<float>& homog_ys,
+                                       CylindricalSurfaceDewarper::State& state) {
+    const double model_x = (grid_x - model_domain_left) * model_x_scale;
     const CylindricalSurfaceDewarper::Generatrix generatrix(distortion_model.mapGeneratrix(model_x, state));
 
     const HomographicTransform<1, float> homog(generatrix.pln2img.mat());
     const Vec2f origin(generatrix.imgLine.p1());
     const Vec2f vec(generatrix.imgLine.p2() - generatrix.imgLine.p1());
+
+    // Push the whole column through the homography in one batch,
+    // so the divides get vectorized.
+    homog(&model_ys[0], &homog_ys[0], model_ys.size());
     for (int dst_y = 0; dst_y <= dst_height; ++dst_y) {
-      const float model_y = (float(dst_y) - model_domain_top) * model_y_scale;
-      next_grid_column[dst_y] = origin + vec * homog(model_y);
+      column[dst_y] = origin + vec * homog_ys[dst_y];
     }
-
-    if (dst_x != 0) {
+  };
+
+  // A destination column depends only on the two grid columns that
+  // bound it, so the image splits into independent vertical strips.
+  // Each strip carries its own State and re-computes its leading
+  // grid column; that's one extra generatrix per strip, which is
+  // noise next to the per-pixel area mapping.
+  parallelForChunked(0, dst_width, [&](const int x_begin, const int x_end) {
+    CylindricalSurfaceDewarper::State state;
+    std::vector<Vec2f> prev_grid_column(dst_height + 1);
+    std::vector<Vec2f> next_grid_column(dst_height + 1);
+    std::vector<float> homog_ys(dst_height + 1);
+
+    compute_grid_column(x_begin, prev_grid_column, homog_ys, state);
+    for (int dst_x = x_begin + 1; dst_x <= x_end; ++dst_x) {
+      compute_grid_column(dst_x, next_grid_column, homog_ys, state);
       areaMapGeneratrix<ColorMixer, PixelType>(src_data, src_size, src_stride, dst_data + dst_x - 1, dst_size,
                                                dst_stride, bg_color, prev_grid_column, next_grid_column);
+      prev_grid_column.swap(next_grid_column);
     }
-
-    prev_grid_column.swap(next_grid_column);
-  }
+  });
 }  // dewarpGeneric
 #endif  // INTERPOLATION_METHOD
 #if INTERPOLATION_METHOD == INTERP_BILLINEAR
@@ -512,6 +538,23 @@ QImage RasterDewarper::dewarp(const QImage& src,
     throw std::invalid_argument("RasterDewarper: model_domain is empty.");
   }
 
+  AccelBackend& accel = accelBackend();
+  if (accel.supports(AccelBackend::DEWARP)) {
+    // The same mapping the CPU paths below evaluate incrementally
+    // per column, in a form the backend can sample at any point.
+    const auto dst_to_src = [&distortion_model, &model_domain](const QPointF& dst_pt) {
+      const double model_x = (dst_pt.x() - model_domain.left()) / model_domain.width();
+      const double model_y = (dst_pt.y() - model_domain.top()) / model_domain.height();
+
+      return distortion_model.mapToWarpedSpace(QPointF(model_x, model_y));
+    };
+
+    QImage dst;
+    if (accel.dewarp(src, dst_size, bg_color, dst_to_src, dst)) {
+      return dst;
+    }
+  }
+
   switch (src.format()) {
     case QImage::Format_Invalid:
       return QImage();
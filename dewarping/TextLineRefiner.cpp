@@ -25,6 +25,7 @@
 #include <cmath>
 #include "DebugImages.h"
 #include "NumericTraits.h"
+#include "ParallelFor.h"
 #include "imageproc/GaussBlur.h"
 #include "imageproc/Sobel.h"
 
@@ -72,7 +73,30 @@ class TextLineRefiner::Optimizer {
   bool normalMovement(Snake& snake, const Grid<float>& gradient);
 
  private:
-  static float calcExternalEnergy(const Grid<float>& gradient, const SnakeNode& node, Vec2f down_normal);
+  /**
+   * Computes the external energy of several candidate positions of a
+   * node at once: center_k = base_node.center + offsets[k] * offset_dir.
+   * The per-node setup is hoisted out of the candidate loop, leaving
+   * just two bilinear gradient fetches per candidate.
+   */
+  static void calcExternalEnergies(const Grid<float>& gradient,
+                                   const SnakeNode& base_node,
+                                   Vec2f down_normal,
+                                   Vec2f offset_dir,
+                                   const float* offsets,
+                                   int count,
+                                   float* energies);
+
+  /**
+   * Like calcExternalEnergies(), but the candidates share the node
+   * center and differ in rib half length instead.
+   */
+  static void calcRibEnergies(const Grid<float>& gradient,
+                              const SnakeNode& base_node,
+                              Vec2f down_normal,
+                              const float* ribs,
+                              int count,
+                              float* energies);
 
   static float calcElasticityEnergy(const SnakeNode& node1, const SnakeNode& node2, float avg_dist);
 
@@ -115,9 +139,12 @@ void TextLineRefiner::refine(std::list<std::vector<QPointF>>& polylines, const i
   float v_sigma = (4.0f / 200.f) * m_dpi.vertical();
   calcBlurredGradient(gradient, h_sigma, v_sigma);
 
-  for (Snake& snake : snakes) {
-    evolveSnake(snake, gradient, ON_CONVERGENCE_STOP);
-  }
+  // Text lines are independent of each other, so evolve them in parallel.
+  parallelForChunked(0, static_cast<int>(snakes.size()), [&](const int begin, const int end) {
+    for (int i = begin; i < end; ++i) {
+      evolveSnake(snakes[i], gradient, ON_CONVERGENCE_STOP);
+    }
+  });
   if (dbg) {
     dbg->add(visualizeSnakes(snakes, &gradient), "evolved_snakes1");
   }
@@ -127,9 +154,11 @@ void TextLineRefiner::refine(std::list<std::vector<QPointF>>& polylines, const i
   v_sigma *= 0.5f;
   calcBlurredGradient(gradient, h_sigma, v_sigma);
 
-  for (Snake& snake : snakes) {
-    evolveSnake(snake, gradient, ON_CONVERGENCE_GO_FINER);
-  }
+  parallelForChunked(0, static_cast<int>(snakes.size()), [&](const int begin, const int end) {
+    for (int i = begin; i < end; ++i) {
+      evolveSnake(snakes[i], gradient, ON_CONVERGENCE_GO_FINER);
+    }
+  });
   if (dbg) {
     dbg->add(visualizeSnakes(snakes, &gradient), "evolved_snakes2");
   }
@@ -151,11 +180,10 @@ void TextLineRefiner::calcBlurredGradient(Grid<float>& gradient, float h_sigma,
 
   const float downscale = 1.0f / (255.0f * 8.0f);
   Grid<float> vert_grad(m_image.width(), m_image.height(), /*padding=*/0);
-  horizontalSobel<float>(m_image.width(), m_image.height(), m_image.data(), m_image.stride(), _1 * downscale,
-                         gradient.data(), gradient.stride(), _1 = _2, _1, gradient.data(), gradient.stride(), _1 = _2);
-  verticalSobel<float>(m_image.width(), m_image.height(), m_image.data(), m_image.stride(), _1 * downscale,
-                       vert_grad.data(), vert_grad.stride(), _1 = _2, _1, gradient.data(), gradient.stride(),
-                       _1 = _1 * m_unitDownVec[0] + _2 * m_unitDownVec[1]);
+  horizontalSobel(m_image.width(), m_image.height(), m_image.data(), m_image.stride(), downscale, gradient.data(),
+                  gradient.stride(), gradient.data(), gradient.stride());
+  verticalSobel(m_image.width(), m_image.height(), m_image.data(), m_image.stride(), downscale * m_unitDownVec[1],
+                vert_grad.data(), vert_grad.stride(), gradient.data(), gradient.stride(), m_unitDownVec[0]);
   Grid<float>().swap(vert_grad);  // Save memory.
   gaussBlurGeneric(m_image.size(), h_sigma, v_sigma, gradient.data(), gradient.stride(), _1, gradient.data(),
                    gradient.stride(), _1 = _2);
@@ -455,9 +483,16 @@ bool TextLineRefiner::Optimizer::thicknessAdjustment(Snake& snake, const Grid<fl
   const float rib_adjustments[] = {0.0f * m_factor, 0.5f * m_factor, -0.5f * m_factor};
   enum { NUM_RIB_ADJUSTMENTS = sizeof(rib_adjustments) / sizeof(rib_adjustments[0]) };
 
-  int best_i = 0;
-  int best_j = 0;
-  float best_cost = NumericTraits<float>::max();
+  // Each candidate is a combination of head and tail rib adjustments.
+  struct Candidate {
+    int i;  // Head adjustment index.
+    int j;  // Tail adjustment index.
+    float headRib;
+    float tailRib;
+  };
+
+  Candidate candidates[NUM_RIB_ADJUSTMENTS * NUM_RIB_ADJUSTMENTS];
+  int num_candidates = 0;
   for (int i = 0; i < NUM_RIB_ADJUSTMENTS; ++i) {
     const float head_rib = snake.nodes.front().ribHalfLength + rib_adjustments[i];
     if (head_rib <= std::numeric_limits<float>::epsilon()) {
@@ -470,21 +505,37 @@ bool TextLineRefiner::Optimizer::thicknessAdjustment(Snake& snake, const Grid<fl
         continue;
       }
 
-      float cost = 0;
-      for (size_t node_idx = 0; node_idx < num_nodes; ++node_idx) {
-        const float t = m_snakeLength.arcLengthFractionAt(node_idx);
-        const float rib = head_rib + t * (tail_rib - head_rib);
-        const Vec2f down_normal(m_frenetFrames[node_idx].unitDownNormal);
+      candidates[num_candidates++] = Candidate{i, j, head_rib, tail_rib};
+    }
+  }
 
-        SnakeNode node(snake.nodes[node_idx]);
-        node.ribHalfLength = rib;
-        cost += calcExternalEnergy(gradient, node, down_normal);
-      }
-      if (cost < best_cost) {
-        best_cost = cost;
-        best_i = i;
-        best_j = j;
-      }
+  // A single pass over the nodes, evaluating every candidate at once.
+  // This touches each node's gradient neighborhood once rather than
+  // once per candidate combination.
+  float costs[NUM_RIB_ADJUSTMENTS * NUM_RIB_ADJUSTMENTS] = {0};
+  float ribs[NUM_RIB_ADJUSTMENTS * NUM_RIB_ADJUSTMENTS];
+  float energies[NUM_RIB_ADJUSTMENTS * NUM_RIB_ADJUSTMENTS];
+  for (size_t node_idx = 0; node_idx < num_nodes; ++node_idx) {
+    const float t = m_snakeLength.arcLengthFractionAt(node_idx);
+    const Vec2f down_normal(m_frenetFrames[node_idx].unitDownNormal);
+
+    for (int k = 0; k < num_candidates; ++k) {
+      ribs[k] = candidates[k].headRib + t * (candidates[k].tailRib - candidates[k].headRib);
+    }
+    calcRibEnergies(gradient, snake.nodes[node_idx], down_normal, ribs, num_candidates, energies);
+    for (int k = 0; k < num_candidates; ++k) {
+      costs[k] += energies[k];
+    }
+  }
+
+  int best_i = 0;
+  int best_j = 0;
+  float best_cost = NumericTraits<float>::max();
+  for (int k = 0; k < num_candidates; ++k) {
+    if (costs[k] < best_cost) {
+      best_cost = costs[k];
+      best_i = candidates[k].i;
+      best_j = candidates[k].j;
     }
   }
   const float head_rib = snake.nodes.front().ribHalfLength + rib_adjustments[best_i];
@@ -525,14 +576,18 @@ bool TextLineRefiner::Optimizer::tangentMovement(Snake& snake, const Grid<float>
     const Vec2f unit_tangent(m_frenetFrames[node_idx].unitTangent);
     const Vec2f down_normal(m_frenetFrames[node_idx].unitDownNormal);
 
-    for (float tangent_movement : tangent_movements) {
+    float external_energies[NUM_TANGENT_MOVEMENTS];
+    calcExternalEnergies(gradient, snake.nodes[node_idx], down_normal, unit_tangent, tangent_movements,
+                         NUM_TANGENT_MOVEMENTS, external_energies);
+
+    for (int k = 0; k < NUM_TANGENT_MOVEMENTS; ++k) {
       Step step;
       step.prevStepIdx = ~uint32_t(0);
-      step.node.center = initial_pos + tangent_movement * unit_tangent;
+      step.node.center = initial_pos + tangent_movements[k] * unit_tangent;
       step.node.ribHalfLength = rib;
       step.pathCost = NumericTraits<float>::max();
 
-      float base_cost = calcExternalEnergy(gradient, step.node, down_normal);
+      float base_cost = external_energies[k];
 
       if (node_idx == num_nodes - 2) {
         // Take into account the distance to the last node as well.
@@ -605,29 +660,36 @@ bool TextLineRefiner::Optimizer::normalMovement(Snake& snake, const Grid<float>&
   // our calculations less accurate.  The proper solution is to provide not N but N*N
   // paths to the 3rd node, each path corresponding to a combination of movement of
   // the first and the second node.  That's the approach we are taking here.
-  for (float normal_movement : normal_movements) {
+  float first_energies[NUM_NORMAL_MOVEMENTS];
+  float second_energies[NUM_NORMAL_MOVEMENTS];
+  calcExternalEnergies(gradient, snake.nodes[0], m_frenetFrames[0].unitDownNormal, m_frenetFrames[0].unitDownNormal,
+                       normal_movements, NUM_NORMAL_MOVEMENTS, first_energies);
+  calcExternalEnergies(gradient, snake.nodes[1], m_frenetFrames[1].unitDownNormal, m_frenetFrames[1].unitDownNormal,
+                       normal_movements, NUM_NORMAL_MOVEMENTS, second_energies);
+
+  for (int i = 0; i < NUM_NORMAL_MOVEMENTS; ++i) {
     const auto prev_step_idx = static_cast<const uint32_t>(step_storage.size());
     {
       // Movements of the first node.
       const Vec2f down_normal(m_frenetFrames[0].unitDownNormal);
       Step step;
-      step.node.center = snake.nodes[0].center + normal_movement * down_normal;
+      step.node.center = snake.nodes[0].center + normal_movements[i] * down_normal;
       step.node.ribHalfLength = snake.nodes[0].ribHalfLength;
       step.prevStepIdx = ~uint32_t(0);
-      step.pathCost = calcExternalEnergy(gradient, step.node, down_normal);
+      step.pathCost = first_energies[i];
 
       step_storage.push_back(step);
     }
 
-    for (float j : normal_movements) {
+    for (int j = 0; j < NUM_NORMAL_MOVEMENTS; ++j) {
       // Movements of the second node.
       const Vec2f down_normal(m_frenetFrames[1].unitDownNormal);
 
       Step step;
-      step.node.center = snake.nodes[1].center + j * down_normal;
+      step.node.center = snake.nodes[1].center + normal_movements[j] * down_normal;
       step.node.ribHalfLength = snake.nodes[1].ribHalfLength;
       step.prevStepIdx = prev_step_idx;
-      step.pathCost = step_storage[prev_step_idx].pathCost + calcExternalEnergy(gradient, step.node, down_normal);
+      step.pathCost = step_storage[prev_step_idx].pathCost + second_energies[j];
 
       paths.push_back(static_cast<unsigned int&&>(step_storage.size()));
       step_storage.push_back(step);
@@ -638,14 +700,18 @@ bool TextLineRefiner::Optimizer::normalMovement(Snake& snake, const Grid<float>&
     const SnakeNode& node = snake.nodes[node_idx];
     const Vec2f down_normal(m_frenetFrames[node_idx].unitDownNormal);
 
-    for (float normal_movement : normal_movements) {
+    float external_energies[NUM_NORMAL_MOVEMENTS];
+    calcExternalEnergies(gradient, node, down_normal, down_normal, normal_movements, NUM_NORMAL_MOVEMENTS,
+                         external_energies);
+
+    for (int k = 0; k < NUM_NORMAL_MOVEMENTS; ++k) {
       Step step;
       step.prevStepIdx = ~uint32_t(0);
-      step.node.center = node.center + normal_movement * down_normal;
+      step.node.center = node.center + normal_movements[k] * down_normal;
       step.node.ribHalfLength = node.ribHalfLength;
       step.pathCost = NumericTraits<float>::max();
 
-      const float base_cost = calcExternalEnergy(gradient, step.node, down_normal);
+      const float base_cost = external_energies[k];
 
       // Now find the best step for the previous node to combine with.
       for (uint32_t prev_step_idx : paths) {
@@ -697,25 +763,55 @@ bool TextLineRefiner::Optimizer::normalMovement(Snake& snake, const Grid<float>&
   return max_sqdist > std::numeric_limits<float>::epsilon();
 }  // TextLineRefiner::Optimizer::normalMovement
 
-float TextLineRefiner::Optimizer::calcExternalEnergy(const Grid<float>& gradient,
-                                                     const SnakeNode& node,
-                                                     const Vec2f down_normal) {
-  const Vec2f top(node.center - node.ribHalfLength * down_normal);
-  const Vec2f bottom(node.center + node.ribHalfLength * down_normal);
-
-  const float top_grad = externalEnergyAt(gradient, top, 0.0f);
-  const float bottom_grad = externalEnergyAt(gradient, bottom, 0.0f);
-
-  // Surprisingly, it turns out it's a bad idea to penalize for the opposite
-  // sign in the gradient.  Sometimes a snake's edge has to move over the
-  // "wrong" gradient ridge before it gets into a good position.
-  // Those std::min and std::max prevent such penalties.
-  const float top_energy = m_topExternalWeight * std::min<float>(top_grad, 0.0f);
-  const float bottom_energy = m_bottomExternalWeight * std::max<float>(bottom_grad, 0.0f);
-
-  // Positive gradient indicates the bottom edge and vice versa.
-  // Note that negative energies are fine with us - the less the better.
-  return top_energy - bottom_energy;
+void TextLineRefiner::Optimizer::calcExternalEnergies(const Grid<float>& gradient,
+                                                      const SnakeNode& base_node,
+                                                      const Vec2f down_normal,
+                                                      const Vec2f offset_dir,
+                                                      const float* offsets,
+                                                      const int count,
+                                                      float* energies) {
+  const Vec2f rib_vec(base_node.ribHalfLength * down_normal);
+  const Vec2f top_base(base_node.center - rib_vec);
+  const Vec2f bottom_base(base_node.center + rib_vec);
+
+  // A flat candidate loop with everything shared hoisted out of it.
+  // The two bilinear fetches are the only memory accesses per candidate.
+  for (int k = 0; k < count; ++k) {
+    const Vec2f shift(offsets[k] * offset_dir);
+    const float top_grad = externalEnergyAt(gradient, top_base + shift, 0.0f);
+    const float bottom_grad = externalEnergyAt(gradient, bottom_base + shift, 0.0f);
+
+    // Surprisingly, it turns out it's a bad idea to penalize for the opposite
+    // sign in the gradient.  Sometimes a snake's edge has to move over the
+    // "wrong" gradient ridge before it gets into a good position.
+    // Those std::min and std::max prevent such penalties.
+    const float top_energy = m_topExternalWeight * std::min<float>(top_grad, 0.0f);
+    const float bottom_energy = m_bottomExternalWeight * std::max<float>(bottom_grad, 0.0f);
+
+    // Positive gradient indicates the bottom edge and vice versa.
+    // Note that negative energies are fine with us - the less the better.
+    energies[k] = top_energy - bottom_energy;
+  }
+}
+
+void TextLineRefiner::Optimizer::calcRibEnergies(const Grid<float>& gradient,
+                                                 const SnakeNode& base_node,
+                                                 const Vec2f down_normal,
+                                                 const float* ribs,
+                                                 const int count,
+                                                 float* energies) {
+  // See calcExternalEnergies() for why the gradient signs are clamped
+  // rather than penalized.
+  for (int k = 0; k < count; ++k) {
+    const Vec2f rib_vec(ribs[k] * down_normal);
+    const float top_grad = externalEnergyAt(gradient, base_node.center - rib_vec, 0.0f);
+    const float bottom_grad = externalEnergyAt(gradient, base_node.center + rib_vec, 0.0f);
+
+    const float top_energy = m_topExternalWeight * std::min<float>(top_grad, 0.0f);
+    const float bottom_energy = m_bottomExternalWeight * std::max<float>(bottom_grad, 0.0f);
+
+    energies[k] = top_energy - bottom_energy;
+  }
 }
 
 float TextLineRefiner::Optimizer::calcElasticityEnergy(const SnakeNode& node1, const SnakeNode& node2, float avg_dist) {
@@ -88,10 +88,33 @@ void TextLineTracer::trace(const GrayImage& input,
     dbg->add(visualizeVerticalBounds(binarized.toQImage(), vert_bounds), "vert_bounds");
   }
 
+  // Coarse-to-fine tracing.  Line topology is stable under downsampling,
+  // so the expensive gradient filtering, binarization and tracing run on
+  // a half-size image (a quarter of the pixels).  Only the polylines
+  // found there get refined at the working resolution below.
+  const double coarse_factor = 0.5;
+  const QSize coarse_size(std::max(1, qRound(downscaled_width * coarse_factor)),
+                          std::max(1, qRound(downscaled_height * coarse_factor)));
+  const GrayImage coarse(scaleToGray(downscaled, coarse_size));
+
+  QTransform coarse_to_working;
+  coarse_to_working.scale(double(downscaled_width) / coarse_size.width(),
+                          double(downscaled_height) / coarse_size.height());
+  const QTransform working_to_coarse(coarse_to_working.inverted());
+
+  const std::pair<QLineF, QLineF> coarse_bounds(working_to_coarse.map(vert_bounds.first),
+                                                working_to_coarse.map(vert_bounds.second));
+
   std::list<std::vector<QPointF>> polylines;
-  extractTextLines(polylines, stretchGrayRange(downscaled), vert_bounds, dbg);
+  extractTextLines(polylines, stretchGrayRange(coarse), coarse_bounds, coarse_factor, dbg);
   if (dbg) {
-    dbg->add(visualizePolylines(downscaled, polylines), "traced");
+    dbg->add(visualizePolylines(coarse, polylines), "traced");
+  }
+
+  for (std::vector<QPointF>& polyline : polylines) {
+    for (QPointF& pt : polyline) {
+      pt = coarse_to_working.map(pt);
+    }
   }
 
   filterShortCurves(polylines, vert_bounds.first, vert_bounds.second);
@@ -282,6 +305,7 @@ void TextLineTracer::filterEdgyCurves(std::list<std::vector<QPointF>>& polylines
 void TextLineTracer::extractTextLines(std::list<std::vector<QPointF>>& out,
                                       const imageproc::GrayImage& image,
                                       const std::pair<QLineF, QLineF>& bounds,
+                                      const double scale,
                                       DebugImages* dbg) {
   using namespace boost::lambda;
 
@@ -293,32 +317,41 @@ void TextLineTracer::extractTextLines(std::list<std::vector<QPointF>>& out,
   Grid<float> aux_grid(image.width(), image.height(), 0);
 
   const float downscale = 1.0f / (255.0f * 8.0f);
-  horizontalSobel<float>(width, height, image.data(), image.stride(), _1 * downscale, aux_grid.data(),
-                         aux_grid.stride(), _1 = _2, _1, main_grid.data(), main_grid.stride(), _1 = _2);
-  verticalSobel<float>(width, height, image.data(), image.stride(), _1 * downscale, aux_grid.data(), aux_grid.stride(),
-                       _1 = _2, _1, main_grid.data(), main_grid.stride(), _1 = _1 * direction[0] + _2 * direction[1]);
+  horizontalSobel(width, height, image.data(), image.stride(), downscale, aux_grid.data(), aux_grid.stride(),
+                  main_grid.data(), main_grid.stride());
+  verticalSobel(width, height, image.data(), image.stride(), downscale * direction[1], aux_grid.data(),
+                aux_grid.stride(), main_grid.data(), main_grid.stride(), direction[0]);
   if (dbg) {
     dbg->add(visualizeGradient(image, main_grid), "first_dir_deriv");
   }
 
-  gaussBlurGeneric(size, 6.0f, 6.0f, main_grid.data(), main_grid.stride(), _1, main_grid.data(), main_grid.stride(),
-                   _1 = _2);
+  // The sigmas, the closing brick and the tracing step below are all
+  // in working resolution units and get scaled to the actual scale of
+  // the image we were given.
+  const auto line_blur_sigma = static_cast<float>(6.0 * scale);
+  const auto mask_blur_sigma = static_cast<float>(12.0 * scale);
+  const int close_brick_size = std::max(3, qRound(21 * scale) | 1);
+  const auto trace_step = static_cast<float>(10.0 * scale);
+
+  gaussBlurGeneric(size, line_blur_sigma, line_blur_sigma, main_grid.data(), main_grid.stride(), _1, main_grid.data(),
+                   main_grid.stride(), _1 = _2);
   if (dbg) {
     dbg->add(visualizeGradient(image, main_grid), "first_dir_deriv_blurred");
   }
 
-  horizontalSobel<float>(width, height, main_grid.data(), main_grid.stride(), _1, aux_grid.data(), aux_grid.stride(),
-                         _1 = _2, _1, aux_grid.data(), aux_grid.stride(), _1 = _2);
-  verticalSobel<float>(width, height, main_grid.data(), main_grid.stride(), _1, main_grid.data(), main_grid.stride(),
-                       _1 = _2, _1, main_grid.data(), main_grid.stride(), _1 = _2);
+  horizontalSobel(width, height, main_grid.data(), main_grid.stride(), 1.0f, aux_grid.data(), aux_grid.stride(),
+                  aux_grid.data(), aux_grid.stride());
+  verticalSobel(width, height, main_grid.data(), main_grid.stride(), 1.0f, main_grid.data(), main_grid.stride(),
+                main_grid.data(), main_grid.stride());
+  // The maximum is needed right after for the threshold, so track it
+  // in the same traversal instead of sweeping the grid a second time.
+  float max = 0;
   rasterOpGeneric(aux_grid.data(), aux_grid.stride(), size, main_grid.data(), main_grid.stride(),
-                  _2 = _1 * direction[0] + _2 * direction[1]);
+                  fusedOp(_2 = _1 * direction[0] + _2 * direction[1], if_then(_2 > var(max), var(max) = _2)));
   if (dbg) {
     dbg->add(visualizeGradient(image, main_grid), "second_dir_deriv");
   }
 
-  float max = 0;
-  rasterOpGeneric(main_grid.data(), main_grid.stride(), size, if_then(_1 > var(max), var(max) = _1));
   const float threshold = max * 15.0f / 255.0f;
 
   BinaryImage initial_binarization(image.size());
@@ -334,8 +367,8 @@ void TextLineTracer::extractTextLines(std::list<std::vector<QPointF>>& out,
     dbg->add(visualizeGradient(image, aux_grid), "abs");
   }
 
-  gaussBlurGeneric(size, 12.0f, 12.0f, aux_grid.data(), aux_grid.stride(), _1, aux_grid.data(), aux_grid.stride(),
-                   _1 = _2);
+  gaussBlurGeneric(size, mask_blur_sigma, mask_blur_sigma, aux_grid.data(), aux_grid.stride(), _1, aux_grid.data(),
+                   aux_grid.stride(), _1 = _2);
   if (dbg) {
     dbg->add(visualizeGradient(image, aux_grid), "blurred");
   }
@@ -361,7 +394,8 @@ void TextLineTracer::extractTextLines(std::list<std::vector<QPointF>>& out,
   }
 
   Grid<float>().swap(aux_grid);  // Save memory.
-  initial_binarization = closeWithObstacles(initial_binarization, obstacles, QSize(21, 21));
+  initial_binarization
+      = closeWithObstacles(initial_binarization, obstacles, QSize(close_brick_size, close_brick_size));
   if (dbg) {
     dbg->add(initial_binarization, "initial_closed");
   }
@@ -388,7 +422,7 @@ void TextLineTracer::extractTextLines(std::list<std::vector<QPointF>>& out,
 
     {
       TowardsLineTracer tracer(&sedm, &main_grid, bounds.first, seed);
-      while (const QPoint* pt = tracer.trace(10.0f)) {
+      while (const QPoint* pt = tracer.trace(trace_step)) {
         polyline.emplace_back(*pt);
       }
       std::reverse(polyline.begin(), polyline.end());
@@ -398,7 +432,7 @@ void TextLineTracer::extractTextLines(std::list<std::vector<QPointF>>& out,
 
     {
       TowardsLineTracer tracer(&sedm, &main_grid, bounds.second, seed);
-      while (const QPoint* pt = tracer.trace(10.0f)) {
+      while (const QPoint* pt = tracer.trace(trace_step)) {
         polyline.emplace_back(*pt);
       }
     }
@@ -60,9 +60,15 @@ class TextLineTracer {
 
   static void sanitizeBinaryImage(imageproc::BinaryImage& image, const QRect& content_rect);
 
+  /**
+   * \p scale is the linear downsampling factor of \p image relative
+   * to the working resolution.  Metric parameters (blur sigmas, the
+   * closing brick, the tracing step) are scaled accordingly.
+   */
   static void extractTextLines(std::list<std::vector<QPointF>>& out,
                                const imageproc::GrayImage& image,
                                const std::pair<QLineF, QLineF>& bounds,
+                               double scale,
                                DebugImages* dbg);
 
   static Vec2f calcAvgUnitVector(const std::pair<QLineF, QLineF>& bounds);
@@ -29,7 +29,6 @@
 #include "LineBoundedByRect.h"
 #include "MatrixCalc.h"
 #include "NumericTraits.h"
-#include "PriorityQueue.h"
 #include "TaskStatus.h"
 #include "ToLineProjector.h"
 #include "imageproc/Constants.h"
@@ -42,22 +41,22 @@ using namespace imageproc;
 namespace dewarping {
 struct TopBottomEdgeTracer::GridNode {
  private:
-  static const uint32_t HEAP_IDX_BITS = 28;
+  static const uint32_t BUCKET_IDX_BITS = 28;
   static const uint32_t PREV_NEIGHBOUR_BITS = 3;
   static const uint32_t PATH_CONTINUATION_BITS = 1;
 
-  static const uint32_t HEAP_IDX_SHIFT = 0;
-  static const uint32_t PREV_NEIGHBOUR_SHIFT = HEAP_IDX_SHIFT + HEAP_IDX_BITS;
+  static const uint32_t BUCKET_IDX_SHIFT = 0;
+  static const uint32_t PREV_NEIGHBOUR_SHIFT = BUCKET_IDX_SHIFT + BUCKET_IDX_BITS;
   static const uint32_t PATH_CONTINUATION_SHIFT = PREV_NEIGHBOUR_SHIFT + PREV_NEIGHBOUR_BITS;
 
-  static const uint32_t HEAP_IDX_MASK = ((uint32_t(1) << HEAP_IDX_BITS) - uint32_t(1)) << HEAP_IDX_SHIFT;
+  static const uint32_t BUCKET_IDX_MASK = ((uint32_t(1) << BUCKET_IDX_BITS) - uint32_t(1)) << BUCKET_IDX_SHIFT;
   static const uint32_t PREV_NEIGHBOUR_MASK = ((uint32_t(1) << PREV_NEIGHBOUR_BITS) - uint32_t(1))
                                               << PREV_NEIGHBOUR_SHIFT;
   static const uint32_t PATH_CONTINUATION_MASK = ((uint32_t(1) << PATH_CONTINUATION_BITS) - uint32_t(1))
                                                  << PATH_CONTINUATION_SHIFT;
 
  public:
-  static const uint32_t INVALID_HEAP_IDX = HEAP_IDX_MASK >> HEAP_IDX_SHIFT;
+  static const uint32_t INVALID_BUCKET_IDX = BUCKET_IDX_MASK >> BUCKET_IDX_SHIFT;
 
   union {
     float dirDeriv;  // Directional derivative.
@@ -80,7 +79,7 @@ struct TopBottomEdgeTracer::GridNode {
   void setupForPadding() {
     dirDeriv = 0;
     pathCost = -1;
-    packedData = INVALID_HEAP_IDX;
+    packedData = INVALID_BUCKET_IDX;
   }
 
   /**
@@ -88,14 +87,14 @@ struct TopBottomEdgeTracer::GridNode {
    */
   void setupForInterior() {
     pathCost = NumericTraits<float>::max();
-    packedData = INVALID_HEAP_IDX;
+    packedData = INVALID_BUCKET_IDX;
   }
 
-  uint32_t heapIdx() const { return (packedData & HEAP_IDX_MASK) >> HEAP_IDX_SHIFT; }
+  uint32_t bucketIdx() const { return (packedData & BUCKET_IDX_MASK) >> BUCKET_IDX_SHIFT; }
 
-  void setHeapIdx(uint32_t idx) {
-    assert(!(idx & ~(HEAP_IDX_MASK >> HEAP_IDX_SHIFT)));
-    packedData = idx | (packedData & ~HEAP_IDX_MASK);
+  void setBucketIdx(uint32_t idx) {
+    assert(!(idx & ~(BUCKET_IDX_MASK >> BUCKET_IDX_SHIFT)));
+    packedData = idx | (packedData & ~BUCKET_IDX_MASK);
   }
 
   bool hasPathContinuation() const { return static_cast<bool>(packedData & PATH_CONTINUATION_MASK); }
@@ -120,18 +119,74 @@ struct TopBottomEdgeTracer::GridNode {
 };
 
 
-class TopBottomEdgeTracer::PrioQueue : public PriorityQueue<uint32_t, PrioQueue> {
+/**
+ * A Dial (bucket) priority queue.  Path costs are bounded to [0, 1]
+ * (see propagateShortestPaths()), so instead of a comparison-based
+ * heap we quantize the cost into NUM_BUCKETS buckets and drain them
+ * in order, making push and pop O(1) instead of O(log n).  The
+ * quantization only affects the processing order: nodes keep their
+ * exact float costs and improved nodes get re-queued, so the final
+ * path costs come out the same.
+ */
+class TopBottomEdgeTracer::BucketQueue {
  public:
-  explicit PrioQueue(Grid<GridNode>& grid) : m_data(grid.data()) {}
+  enum { NUM_BUCKETS = 1024 };
+
+  explicit BucketQueue(Grid<GridNode>& grid) : m_buckets(NUM_BUCKETS), m_data(grid.data()), m_curBucket(0), m_size(0) {}
+
+  static uint32_t bucketFor(const float cost) {
+    const auto bucket = static_cast<int>(cost * (NUM_BUCKETS - 1));
+
+    return static_cast<uint32_t>(qBound(0, bucket, NUM_BUCKETS - 1));
+  }
+
+  bool empty() const { return m_size == 0; }
+
+  uint32_t curBucket() const { return m_curBucket; }
+
+  /**
+   * Queues a node under its current path cost.  An entry the node may
+   * have left in a higher bucket goes stale and is skipped by popNext().
+   */
+  void push(const uint32_t grid_idx) {
+    const uint32_t bucket = bucketFor(m_data[grid_idx].pathCost);
+    assert(bucket >= m_curBucket);
+    m_data[grid_idx].setBucketIdx(bucket);
+    m_buckets[bucket].push_back(grid_idx);
+    ++m_size;
+  }
 
-  bool higherThan(uint32_t lhs, uint32_t rhs) const { return m_data[lhs].pathCost < m_data[rhs].pathCost; }
+  /**
+   * Removes and returns the next queued node, advancing to higher
+   * buckets as the lower ones drain.  Returns ~uint32_t(0) if only
+   * stale entries remained.
+   */
+  uint32_t popNext() {
+    while (m_size > 0) {
+      while (m_buckets[m_curBucket].empty()) {
+        ++m_curBucket;
+        assert(m_curBucket < NUM_BUCKETS);
+      }
 
-  void setIndex(uint32_t grid_idx, size_t heap_idx) { m_data[grid_idx].setHeapIdx(static_cast<uint32_t>(heap_idx)); }
+      std::vector<uint32_t>& bucket = m_buckets[m_curBucket];
+      const uint32_t grid_idx = bucket.back();
+      bucket.pop_back();
+      --m_size;
 
-  void reposition(GridNode* node) { PriorityQueue<uint32_t, PrioQueue>::reposition(node->heapIdx()); }
+      if (m_data[grid_idx].bucketIdx() == m_curBucket) {
+        return grid_idx;
+      }
+      // A stale entry, superseded by a cheaper push.
+    }
+
+    return ~uint32_t(0);
+  }
 
  private:
+  std::vector<std::vector<uint32_t>> m_buckets;
   GridNode* const m_data;
+  uint32_t m_curBucket;
+  size_t m_size;
 };
 
 
@@ -217,12 +272,12 @@ void TopBottomEdgeTracer::trace(const imageproc::GrayImage& image,
 
   status.throwIfCancelled();
 
-  PrioQueue queue(grid);
+  BucketQueue queue(grid);
 
   // Shortest paths from bounds.first towards bounds.second.
   prepareForShortestPathsFrom(queue, grid, bounds.first);
   const Vec2f dir_1st_to_2nd(directionFromPointToLine(bounds.first.pointAt(0.5), bounds.second));
-  propagateShortestPaths(dir_1st_to_2nd, queue, grid);
+  propagateShortestPaths(dir_1st_to_2nd, queue, grid, bounds.second);
   const std::vector<QPoint> endpoints1(locateBestPathEndpoints(grid, bounds.second));
   if (dbg) {
     dbg->add(visualizePaths(downscaled, grid, bounds, endpoints1), "best_paths_ltr");
@@ -433,7 +488,7 @@ Vec2f TopBottomEdgeTracer::directionFromPointToLine(const QPointF& pt, const QLi
   return vec;
 }
 
-void TopBottomEdgeTracer::prepareForShortestPathsFrom(PrioQueue& queue, Grid<GridNode>& grid, const QLineF& from) {
+void TopBottomEdgeTracer::prepareForShortestPathsFrom(BucketQueue& queue, Grid<GridNode>& grid, const QLineF& from) {
   GridNode padding_node{};
   padding_node.setupForPadding();
   grid.initPadding(padding_node);
@@ -454,10 +509,9 @@ void TopBottomEdgeTracer::prepareForShortestPathsFrom(PrioQueue& queue, Grid<Gri
     line += stride;
   }
 
-  GridLineTraverser traverser(from);
-  while (traverser.hasNext()) {
-    const QPoint pt(traverser.next());
-
+  std::vector<QPoint> cells;
+  GridLineTraverser(from).traverse(cells);
+  for (const QPoint& pt : cells) {
     // intersectWithRect() ensures that.
     assert(pt.x() >= 0 && pt.y() >= 0 && pt.x() < width && pt.y() < height);
 
@@ -467,19 +521,54 @@ void TopBottomEdgeTracer::prepareForShortestPathsFrom(PrioQueue& queue, Grid<Gri
   }
 }
 
-void TopBottomEdgeTracer::propagateShortestPaths(const Vec2f& direction, PrioQueue& queue, Grid<GridNode>& grid) {
+void TopBottomEdgeTracer::propagateShortestPaths(const Vec2f& direction,
+                                                 BucketQueue& queue,
+                                                 Grid<GridNode>& grid,
+                                                 const QLineF& to_line) {
   GridNode* const data = grid.data();
 
   int next_nbh_offsets[8];
   int prev_nbh_indexes[8];
   const int num_neighbours = initNeighbours(next_nbh_offsets, prev_nbh_indexes, grid.stride(), direction);
 
+  // Only the costs along to_line matter to locateBestPathEndpoints().
+  // Since nodes get finalized in the order of increasing cost buckets,
+  // we can stop as soon as every node on that line has dropped below
+  // the bucket being drained, instead of flooding the rest of the page.
+  std::vector<uint32_t> dest_offsets;
+  std::vector<QPoint> dest_cells;
+  GridLineTraverser(to_line).traverse(dest_cells);
+  dest_offsets.reserve(dest_cells.size());
+  for (const QPoint& pt : dest_cells) {
+    dest_offsets.push_back(pt.y() * grid.stride() + pt.x());
+  }
+
+  uint32_t last_bucket = 0;
+
   while (!queue.empty()) {
-    const int grid_idx = queue.front();
+    const uint32_t grid_idx = queue.popNext();
+    if (grid_idx == ~uint32_t(0)) {
+      break;
+    }
+
+    if (queue.curBucket() != last_bucket) {
+      last_bucket = queue.curBucket();
+
+      bool dests_finalized = true;
+      for (const uint32_t offset : dest_offsets) {
+        if (BucketQueue::bucketFor(data[offset].pathCost) >= last_bucket) {
+          dests_finalized = false;
+          break;
+        }
+      }
+      if (dests_finalized) {
+        break;
+      }
+    }
+
     GridNode* node = data + grid_idx;
     assert(node->pathCost >= 0);
-    queue.pop();
-    node->setHeapIdx(GridNode::INVALID_HEAP_IDX);
+    node->setBucketIdx(GridNode::INVALID_BUCKET_IDX);
 
     for (int i = 0; i < num_neighbours; ++i) {
       const int nbh_grid_idx = grid_idx + next_nbh_offsets[i];
@@ -491,11 +580,11 @@ void TopBottomEdgeTracer::propagateShortestPaths(const Vec2f& direction, PrioQue
       if (new_cost < nbh_node->pathCost) {
         nbh_node->pathCost = new_cost;
         nbh_node->setPrevNeighbourIdx(prev_nbh_indexes[i]);
-        if (nbh_node->heapIdx() == GridNode::INVALID_HEAP_IDX) {
+        if (nbh_node->bucketIdx() != BucketQueue::bucketFor(new_cost)) {
           queue.push(nbh_grid_idx);
-        } else {
-          queue.reposition(nbh_node);
         }
+        // Otherwise it's already queued in the right bucket and will
+        // be processed with the updated cost.
       }
     }
   }
@@ -51,7 +51,7 @@ class TopBottomEdgeTracer {
  private:
   struct GridNode;
 
-  class PrioQueue;
+  class BucketQueue;
 
   struct Step;
 
@@ -71,9 +71,12 @@ class TopBottomEdgeTracer {
 
   static Vec2f directionFromPointToLine(const QPointF& pt, const QLineF& line);
 
-  static void prepareForShortestPathsFrom(PrioQueue& queue, Grid<GridNode>& grid, const QLineF& from);
+  static void prepareForShortestPathsFrom(BucketQueue& queue, Grid<GridNode>& grid, const QLineF& from);
 
-  static void propagateShortestPaths(const Vec2f& direction, PrioQueue& queue, Grid<GridNode>& grid);
+  static void propagateShortestPaths(const Vec2f& direction,
+                                     BucketQueue& queue,
+                                     Grid<GridNode>& grid,
+                                     const QLineF& to_line);
 
   static int initNeighbours(int* next_nbh_offsets, int* prev_nbh_indexes, int stride, const Vec2f& direction);
 
@@ -36,11 +36,10 @@
 
 namespace deskew {
 Filter::Filter(const PageSelectionAccessor& page_selection_accessor)
-    : m_settings(new Settings), m_imageSettings(new ImageSettings), m_selectedPageOrder(0) {
-  if (CommandLine::get().isGui()) {
-    m_optionsWidget.reset(new OptionsWidget(m_settings, page_selection_accessor));
-  }
-
+    : m_settings(new Settings),
+      m_imageSettings(new ImageSettings),
+      m_pageSelectionAccessor(page_selection_accessor),
+      m_selectedPageOrder(0) {
   const PageOrderOption::ProviderPtr default_order;
   const auto order_by_deviation = make_intrusive<OrderByDeviationProvider>(m_settings->deviationProvider());
   m_pageOrderOptions.emplace_back(tr("Natural order"), default_order);
@@ -63,8 +62,9 @@ void Filter::performRelinking(const AbstractRelinker& relinker) {
 }
 
 void Filter::preUpdateUI(FilterUiInterface* const ui, const PageInfo& page_info) {
-  m_optionsWidget->preUpdateUI(page_info.id());
-  ui->setOptionsWidget(m_optionsWidget.get(), ui->KEEP_OWNERSHIP);
+  OptionsWidget* const options_widget = optionsWidget();
+  options_widget->preUpdateUI(page_info.id());
+  ui->setOptionsWidget(options_widget, ui->KEEP_OWNERSHIP);
 }
 
 QDomElement Filter::saveSettings(const ProjectWriter& writer, QDomDocument& doc) const {
@@ -167,6 +167,10 @@ void Filter::loadDefaultSettings(const PageInfo& page_info) {
 }
 
 OptionsWidget* Filter::optionsWidget() {
+  if (!m_optionsWidget.get() && CommandLine::get().isGui()) {
+    m_optionsWidget.reset(new OptionsWidget(m_settings, m_pageSelectionAccessor));
+  }
+
   return m_optionsWidget.get();
 }
 
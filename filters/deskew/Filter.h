@@ -23,13 +23,13 @@
 #include "AbstractFilter.h"
 #include "FilterResult.h"
 #include "NonCopyable.h"
+#include "PageSelectionAccessor.h"
 #include "PageView.h"
 #include "SafeDeletingQObjectPtr.h"
 #include "Settings.h"
 #include "intrusive_ptr.h"
 
 class QString;
-class PageSelectionAccessor;
 class ImageSettings;
 
 namespace select_content {
@@ -92,6 +92,7 @@ class Filter : public AbstractFilter {
 
   intrusive_ptr<Settings> m_settings;
   intrusive_ptr<ImageSettings> m_imageSettings;
+  PageSelectionAccessor m_pageSelectionAccessor;
   SafeDeletingQObjectPtr<OptionsWidget> m_optionsWidget;
   std::vector<PageOrderOption> m_pageOrderOptions;
   int m_selectedPageOrder;
@@ -38,13 +38,13 @@ Settings::Settings() {
 Settings::~Settings() = default;
 
 void Settings::clear() {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   m_perPageParams.clear();
   m_deviationProvider.clear();
 }
 
 void Settings::performRelinking(const AbstractRelinker& relinker) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   PerPageParams new_params;
 
   for (const PerPageParams::value_type& kv : m_perPageParams) {
@@ -63,19 +63,19 @@ void Settings::performRelinking(const AbstractRelinker& relinker) {
 }
 
 void Settings::setPageParams(const PageId& page_id, const Params& params) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   Utils::mapSetValue(m_perPageParams, page_id, params);
   m_deviationProvider.addOrUpdate(page_id);
 }
 
 void Settings::clearPageParams(const PageId& page_id) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   m_perPageParams.erase(page_id);
   m_deviationProvider.remove(page_id);
 }
 
 std::unique_ptr<Params> Settings::getPageParams(const PageId& page_id) const {
-  QMutexLocker locker(&m_mutex);
+  QReadLocker locker(&m_rwLock);
 
   auto it(m_perPageParams.find(page_id));
   if (it != m_perPageParams.end()) {
@@ -86,7 +86,7 @@ std::unique_ptr<Params> Settings::getPageParams(const PageId& page_id) const {
 }
 
 void Settings::setDegrees(const std::set<PageId>& pages, const Params& params) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
   for (const PageId& page : pages) {
     Utils::mapSetValue(m_perPageParams, page, params);
     m_deviationProvider.addOrUpdate(page);
@@ -94,7 +94,7 @@ void Settings::setDegrees(const std::set<PageId>& pages, const Params& params) {
 }
 
 bool Settings::isParamsNull(const PageId& page_id) const {
-  QMutexLocker locker(&m_mutex);
+  QReadLocker locker(&m_rwLock);
 
   return (m_perPageParams.find(page_id) == m_perPageParams.end());
 }
@@ -20,10 +20,10 @@
 #define DESKEW_SETTINGS_H_
 
 #include <DeviationProvider.h>
-#include <QMutex>
+#include <QReadWriteLock>
 #include <memory>
 #include <set>
-#include <unordered_map>
+#include "FlatHashMap.h"
 #include "NonCopyable.h"
 #include "PageId.h"
 #include "Params.h"
@@ -57,9 +57,9 @@ class Settings : public ref_countable {
   const DeviationProvider<PageId>& deviationProvider() const;
 
  private:
-  typedef std::unordered_map<PageId, Params> PerPageParams;
+  typedef FlatHashMap<PageId, Params> PerPageParams;
 
-  mutable QMutex m_mutex;
+  mutable QReadWriteLock m_rwLock;
   PerPageParams m_perPageParams;
   DeviationProvider<PageId> m_deviationProvider;
 };
@@ -22,6 +22,8 @@
 #include <imageproc/Grayscale.h>
 #include <imageproc/PolygonRasterizer.h>
 #include <QSettings>
+#include <algorithm>
+#include <cmath>
 #include <utility>
 #include "DebugImages.h"
 #include "Dpm.h"
@@ -30,8 +32,11 @@
 #include "FilterUiInterface.h"
 #include "ImageView.h"
 #include "OptionsWidget.h"
+#include "PageTimingRegistry.h"
 #include "Task.h"
+#include "BookPriors.h"
 #include "TaskStatus.h"
+#include "Tracer.h"
 #include "filters/select_content/Task.h"
 #include "imageproc/BinaryImage.h"
 #include "imageproc/Morphology.h"
@@ -92,6 +97,9 @@ Task::Task(intrusive_ptr<Filter> filter,
 Task::~Task() = default;
 
 FilterResultPtr Task::process(const TaskStatus& status, FilterData data) {
+  TRACE_SCOPE("deskew: process");
+  const PageTimingRegistry::StageScope timing_scope(m_pageId, "deskew");
+
   status.throwIfCancelled();
 
   const Dependencies deps(data.xform().preCropArea(), data.xform().preRotation());
@@ -141,10 +149,26 @@ FilterResultPtr Task::process(const TaskStatus& status, FilterData data) {
 
       SkewFinder skew_finder;
       skew_finder.setResolutionRatio((double) rotated_dpm.horizontal() / rotated_dpm.vertical());
-      const Skew skew(skew_finder.findSkew(rotated_image));
+
+      // The coarse scan cost is proportional to the angle range, so a
+      // book whose pages skew consistently gets a much narrower scan.
+      double prior_center, prior_half_width;
+      const bool have_prior = BookPriors::instance().skewBand(prior_center, prior_half_width);
+      if (have_prior) {
+        skew_finder.setMaxAngle(
+            std::min(SkewFinder::DEFAULT_MAX_ANGLE, std::fabs(prior_center) + prior_half_width));
+      }
+
+      Skew skew(skew_finder.findSkew(rotated_image));
+      if (have_prior && (skew.confidence() < Skew::GOOD_CONFIDENCE)) {
+        // This page isn't like the rest of the book - redo unrestricted.
+        skew_finder.setMaxAngle();
+        skew = skew_finder.findSkew(rotated_image);
+      }
 
       if (skew.confidence() >= skew.GOOD_CONFIDENCE) {
         ui_data.setEffectiveDeskewAngle(-skew.angle());
+        BookPriors::instance().addSkewSample(-skew.angle());
       } else {
         ui_data.setEffectiveDeskewAngle(0);
       }
@@ -38,11 +38,7 @@
 
 namespace fix_orientation {
 Filter::Filter(const PageSelectionAccessor& page_selection_accessor)
-    : m_settings(new Settings), m_imageSettings(new ImageSettings) {
-  if (CommandLine::get().isGui()) {
-    m_optionsWidget.reset(new OptionsWidget(m_settings, page_selection_accessor));
-  }
-}
+    : m_settings(new Settings), m_imageSettings(new ImageSettings), m_pageSelectionAccessor(page_selection_accessor) {}
 
 Filter::~Filter() = default;
 
@@ -60,10 +56,10 @@ void Filter::performRelinking(const AbstractRelinker& relinker) {
 }
 
 void Filter::preUpdateUI(FilterUiInterface* ui, const PageInfo& page_info) {
-  if (m_optionsWidget.get()) {
+  if (OptionsWidget* const options_widget = optionsWidget()) {
     const OrthogonalRotation rotation(m_settings->getRotationFor(page_info.id().imageId()));
-    m_optionsWidget->preUpdateUI(page_info.id(), rotation);
-    ui->setOptionsWidget(m_optionsWidget.get(), ui->KEEP_OWNERSHIP);
+    options_widget->preUpdateUI(page_info.id(), rotation);
+    ui->setOptionsWidget(options_widget, ui->KEEP_OWNERSHIP);
   }
 }
 
@@ -148,6 +144,12 @@ void Filter::loadDefaultSettings(const PageInfo& page_info) {
 }
 
 OptionsWidget* Filter::optionsWidget() {
+  if (!m_optionsWidget.get() && CommandLine::get().isGui()) {
+    // Built on first request: the options widgets are heavyweight
+    // and don't all need to exist before the main window shows.
+    m_optionsWidget.reset(new OptionsWidget(m_settings, m_pageSelectionAccessor));
+  }
+
   return m_optionsWidget.get();
 }
 
@@ -22,12 +22,12 @@
 #include "AbstractFilter.h"
 #include "FilterResult.h"
 #include "NonCopyable.h"
+#include "PageSelectionAccessor.h"
 #include "PageView.h"
 #include "SafeDeletingQObjectPtr.h"
 #include "intrusive_ptr.h"
 
 class ImageId;
-class PageSelectionAccessor;
 class QString;
 class QDomDocument;
 class QDomElement;
@@ -89,6 +89,7 @@ class Filter : public AbstractFilter {
 
   intrusive_ptr<Settings> m_settings;
   intrusive_ptr<ImageSettings> m_imageSettings;
+  PageSelectionAccessor m_pageSelectionAccessor;
   SafeDeletingQObjectPtr<OptionsWidget> m_optionsWidget;
 };
 }  // namespace fix_orientation
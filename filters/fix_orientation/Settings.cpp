@@ -27,12 +27,12 @@ Settings::Settings() = default;
 Settings::~Settings() = default;
 
 void Settings::clear() {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   m_perImageRotation.clear();
 }
 
 void Settings::performRelinking(const AbstractRelinker& relinker) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   PerImageRotation new_rotations;
 
   for (const PerImageRotation::value_type& kv : m_perImageRotation) {
@@ -46,12 +46,12 @@ void Settings::performRelinking(const AbstractRelinker& relinker) {
 }
 
 void Settings::applyRotation(const ImageId& image_id, const OrthogonalRotation rotation) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   setImageRotationLocked(image_id, rotation);
 }
 
 void Settings::applyRotation(const std::set<PageId>& pages, const OrthogonalRotation rotation) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
 
   for (const PageId& page : pages) {
     setImageRotationLocked(page.imageId(), rotation);
@@ -59,7 +59,7 @@ void Settings::applyRotation(const std::set<PageId>& pages, const OrthogonalRota
 }
 
 OrthogonalRotation Settings::getRotationFor(const ImageId& image_id) const {
-  QMutexLocker locker(&m_mutex);
+  QReadLocker locker(&m_rwLock);
 
   auto it(m_perImageRotation.find(image_id));
   if (it != m_perImageRotation.end()) {
@@ -74,7 +74,7 @@ void Settings::setImageRotationLocked(const ImageId& image_id, const OrthogonalR
 }
 
 bool Settings::isRotationNull(const ImageId& image_id) const {
-  QMutexLocker locker(&m_mutex);
+  QReadLocker locker(&m_rwLock);
 
   return (m_perImageRotation.find(image_id) == m_perImageRotation.end());
 }
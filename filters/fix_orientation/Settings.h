@@ -19,7 +19,7 @@
 #ifndef FIX_ORIENTATION_SETTINGS_H_
 #define FIX_ORIENTATION_SETTINGS_H_
 
-#include <QMutex>
+#include <QReadWriteLock>
 #include <set>
 #include <unordered_map>
 #include "ImageId.h"
@@ -56,7 +56,7 @@ class Settings : public ref_countable {
 
   void setImageRotationLocked(const ImageId& image_id, const OrthogonalRotation& rotation);
 
-  mutable QMutex m_mutex;
+  mutable QReadWriteLock m_rwLock;
   PerImageRotation m_perImageRotation;
 };
 }  // namespace fix_orientation
@@ -24,9 +24,11 @@
 #include "FilterUiInterface.h"
 #include "ImageView.h"
 #include "OptionsWidget.h"
+#include "PageTimingRegistry.h"
 #include "Settings.h"
 #include "Task.h"
 #include "TaskStatus.h"
+#include "Tracer.h"
 #include "filters/page_split/Task.h"
 
 namespace fix_orientation {
@@ -72,6 +74,8 @@ Task::~Task() = default;
 
 FilterResultPtr Task::process(const TaskStatus& status, FilterData data) {
   // This function is executed from the worker thread.
+  TRACE_SCOPE("fix_orientation: process");
+  const PageTimingRegistry::StageScope timing_scope(m_pageId, "fix_orientation");
 
   status.throwIfCancelled();
 
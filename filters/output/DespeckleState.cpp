@@ -30,13 +30,19 @@ DespeckleState::DespeckleState(const QImage& output,
                                const imageproc::BinaryImage& speckles,
                                const double level,
                                const Dpi& dpi)
-    : m_speckles(speckles), m_dpi(dpi), m_despeckleLevel(level) {
-  m_everythingMixed = overlaySpeckles(output, speckles);
-  m_everythingBW = extractBW(m_everythingMixed);
+    : m_output(output), m_dpi(dpi), m_despeckleLevel(level) {
+  m_everythingBW = extractBW(output);
+  if (!speckles.isNull()) {
+    rasterOp<RopOr<RopSrc, RopDst>>(m_everythingBW, speckles);
+  }
+  m_speckles = encodeSpeckles(speckles);
 }
 
 DespeckleVisualization DespeckleState::visualize() const {
-  return DespeckleVisualization(m_everythingMixed, m_speckles, m_dpi);
+  // Painting all of m_everythingBW black reproduces the old
+  // "everything mixed" image: the non-speckle pixels of it are
+  // black in m_output already, so only the speckles change.
+  return DespeckleVisualization(overlaySpeckles(m_output, m_everythingBW), speckles(), m_dpi);
 }
 
 DespeckleState DespeckleState::redespeckle(const double level, const TaskStatus& status, DebugImages* dbg) const {
@@ -49,17 +55,28 @@ DespeckleState DespeckleState::redespeckle(const double level, const TaskStatus&
   new_state.m_despeckleLevel = level;
 
   if (level == 0) {
-    // Null speckles image is equivalent to a white one.
-    new_state.m_speckles.release();
+    // Null speckles is equivalent to having no speckles at all.
+    new_state.m_speckles.reset();
 
     return new_state;
   }
 
-  new_state.m_speckles = Despeckle::despeckle(m_everythingBW, m_dpi, level, status, dbg);
+  BinaryImage speckles;
+  if (dbg) {
+    // The intermediate stages only exist in the full pipeline.
+    speckles = Despeckle::despeckle(m_everythingBW, m_dpi, level, status, dbg);
+  } else {
+    if (!m_analysis) {
+      m_analysis = Despeckle::analyze(m_everythingBW, status);
+    }
+    new_state.m_analysis = m_analysis;
+    speckles = Despeckle::despeckle(*m_analysis, m_dpi, level, status);
+  }
 
   status.throwIfCancelled();
 
-  rasterOp<RopSubtract<RopSrc, RopDst>>(new_state.m_speckles, m_everythingBW);
+  rasterOp<RopSubtract<RopSrc, RopDst>>(speckles, m_everythingBW);
+  new_state.m_speckles = encodeSpeckles(speckles);
 
   return new_state;
 }  // DespeckleState::redespeckle
@@ -103,10 +120,15 @@ QImage DespeckleState::overlaySpeckles(const QImage& mixed, const imageproc::Bin
  * generating output files.
  */
 BinaryImage DespeckleState::extractBW(const QImage& mixed) {
-  BinaryImage result(mixed.size(), WHITE);
+  const QImage rgb32(mixed.convertToFormat(QImage::Format_RGB32));
+  if (rgb32.isNull() && !mixed.isNull()) {
+    throw std::bad_alloc();
+  }
 
-  const auto* mixed_line = (const uint32_t*) mixed.bits();
-  const int mixed_stride = mixed.bytesPerLine() / 4;
+  BinaryImage result(rgb32.size(), WHITE);
+
+  const auto* mixed_line = (const uint32_t*) rgb32.bits();
+  const int mixed_stride = rgb32.bytesPerLine() / 4;
 
   uint32_t* result_line = result.data();
   const int result_stride = result.wordsPerLine();
@@ -128,7 +150,75 @@ BinaryImage DespeckleState::extractBW(const QImage& mixed) {
   return result;
 }
 
+std::shared_ptr<const DespeckleState::SpeckleRuns> DespeckleState::encodeSpeckles(const BinaryImage& speckles) {
+  if (speckles.isNull()) {
+    return nullptr;
+  }
+
+  auto speckle_runs = std::make_shared<SpeckleRuns>();
+  speckle_runs->size = speckles.size();
+
+  const uint32_t* line = speckles.data();
+  const int stride = speckles.wordsPerLine();
+  const uint32_t msb = uint32_t(1) << 31;
+
+  const int width = speckles.width();
+  const int height = speckles.height();
+
+  for (int y = 0; y < height; ++y) {
+    int run_start = -1;
+    for (int x = 0; x < width; ++x) {
+      // Speckle images are mostly white; skip empty words wholesale.
+      if ((run_start < 0) && ((x & 31) == 0) && (line[x >> 5] == 0)) {
+        x += 31;
+        continue;
+      }
+
+      if (line[x >> 5] & (msb >> (x & 31))) {
+        if (run_start < 0) {
+          run_start = x;
+        }
+      } else if (run_start >= 0) {
+        speckle_runs->runs.push_back(SpeckleRuns::Run{y, run_start, x - run_start});
+        run_start = -1;
+      }
+    }
+    if (run_start >= 0) {
+      speckle_runs->runs.push_back(SpeckleRuns::Run{y, run_start, width - run_start});
+    }
+    line += stride;
+  }
+
+  return speckle_runs;
+}  // DespeckleState::encodeSpeckles
+
+BinaryImage DespeckleState::decodeSpeckles(const SpeckleRuns& speckle_runs) {
+  BinaryImage speckles(speckle_runs.size, WHITE);
+
+  uint32_t* const data = speckles.data();
+  const int stride = speckles.wordsPerLine();
+  const uint32_t msb = uint32_t(1) << 31;
+
+  for (const SpeckleRuns::Run& run : speckle_runs.runs) {
+    uint32_t* const line = data + run.y * stride;
+    for (int i = 0; i < run.len; ++i) {
+      const int x = run.x + i;
+      line[x >> 5] |= msb >> (x & 31);
+    }
+  }
+
+  return speckles;
+}
+
+BinaryImage DespeckleState::speckles() const {
+  if (!m_speckles) {
+    return BinaryImage();
+  }
+
+  return decodeSpeckles(*m_speckles);
+}
+
 double DespeckleState::level() const {
   return m_despeckleLevel;
 }
-}  // namespace output
\ No newline at end of file
+}  // namespace output
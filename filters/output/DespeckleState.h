@@ -21,6 +21,9 @@
 #define OUTPUT_DESPECKLE_STATE_H_
 
 #include <QImage>
+#include <memory>
+#include <vector>
+#include "Despeckle.h"
 #include "DespeckleLevel.h"
 #include "Dpi.h"
 #include "imageproc/BinaryImage.h"
@@ -47,31 +50,68 @@ class DespeckleState {
   DespeckleState redespeckle(double level, const TaskStatus& status, DebugImages* dbg = nullptr) const;
 
  private:
+  /**
+   * Speckles are sparse, so a full-resolution bitmap per despeckling
+   * candidate is wasteful.  Instead we keep them as horizontal black
+   * runs relative to m_everythingBW, which costs kilobytes rather
+   * than megabytes per level.  Shared between the states derived
+   * from one another and never modified after encoding.
+   */
+  struct SpeckleRuns {
+    struct Run {
+      int y;
+      int x;
+      int len;
+    };
+
+    std::vector<Run> runs;
+    QSize size;
+  };
+
   static QImage overlaySpeckles(const QImage& mixed, const imageproc::BinaryImage& speckles);
 
   static imageproc::BinaryImage extractBW(const QImage& mixed);
 
+  /** \return null for a null \p speckles image, which means no speckles. */
+  static std::shared_ptr<const SpeckleRuns> encodeSpeckles(const imageproc::BinaryImage& speckles);
+
+  static imageproc::BinaryImage decodeSpeckles(const SpeckleRuns& speckle_runs);
+
+  /** Expands m_speckles back into a bitmap.  May return a null image. */
+  imageproc::BinaryImage speckles() const;
+
   /**
-   * This image is the output image produced by OutputGenerator
-   * with speckles added as black regions.  This image is always in RGB32,
-   * because it only exists for display purposes, namely for being fed to
-   * DespeckleVisualization.
+   * The output image produced by OutputGenerator, with speckles
+   * already removed.  QImage is implicitly shared, so this is the
+   * same data the output stage holds anyway, not a copy.  The
+   * "everything mixed" image fed to DespeckleVisualization is
+   * rebuilt from it on demand instead of being kept around.
    */
-  QImage m_everythingMixed;
+  QImage m_output;
 
   /**
-   * The B/W part of m_everythingMixed.
+   * The B/W part of m_output with the construction-time speckles
+   * added back.  This is the image despeckling operates on.
    */
   imageproc::BinaryImage m_everythingBW;
 
   /**
-   * The speckles detected in m_everythingBW.
-   * This image may be null, which is equivalent to having it all white.
+   * The speckles detected in m_everythingBW, run-length encoded.
+   * Null is equivalent to having no speckles at all.
+   */
+  std::shared_ptr<const SpeckleRuns> m_speckles;
+
+  /**
+   * The level-independent component analysis of m_everythingBW.
+   * Built lazily by redespeckle() and shared with the states derived
+   * from this one, making a change of the despeckle level a cheap
+   * re-thresholding pass.  Mutable, as filling the cache doesn't
+   * change the visible state.
    */
-  imageproc::BinaryImage m_speckles;
+  mutable std::shared_ptr<const Despeckle::Analysis> m_analysis;
 
   /**
-   * The DPI of all 3 above images.
+   * The DPI of the images above.
    */
   Dpi m_dpi;
 
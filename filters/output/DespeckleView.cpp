@@ -54,7 +54,8 @@ class DespeckleView::TaskCancelHandle : public TaskStatus, public ref_countable
 };
 
 
-class DespeckleView::DespeckleTask : public AbstractCommand<BackgroundExecutor::TaskResultPtr> {
+class DespeckleView::DespeckleTask : public AbstractCommand<BackgroundExecutor::TaskResultPtr>,
+                                     public BackgroundExecutor::Cancellable {
  public:
   DespeckleTask(DespeckleView* owner,
                 const DespeckleState& despeckle_state,
@@ -62,6 +63,8 @@ class DespeckleView::DespeckleTask : public AbstractCommand<BackgroundExecutor::
                 double level,
                 bool debug);
 
+  bool isCancelled() const override { return m_cancelHandle->isCancelled(); }
+
   BackgroundExecutor::TaskResultPtr operator()() override;
 
  private:
@@ -49,7 +49,8 @@ DewarpingView::DewarpingView(const QImage& image,
       m_distortionModel(distortion_model),
       m_depthPerception(depth_perception),
       m_dragHandler(*this),
-      m_zoomHandler(*this) {
+      m_zoomHandler(*this),
+      m_validGridCache(false) {
   setMouseTracking(true);
 
   const QPolygonF source_content_rect(virtualToImage().map(virt_content_rect));
@@ -160,6 +161,7 @@ void DewarpingView::fitSpline(XSpline& spline, const std::vector<QPointF>& polyl
 
 void DewarpingView::depthPerceptionChanged(double val) {
   m_depthPerception.setValue(val);
+  m_validGridCache = false;
   update();
 }
 
@@ -181,38 +183,19 @@ void DewarpingView::onPaint(QPainter& painter, const InteractionState& interacti
   painter.setPen(grid_pen);
   painter.setBrush(Qt::NoBrush);
 
-  const int num_vert_grid_lines = 30;
-  const int num_hor_grid_lines = 30;
-
   bool valid_model = m_distortionModel.isValid();
 
   if (valid_model) {
-    try {
-      std::vector<QVector<QPointF>> curves(num_hor_grid_lines);
-
-      dewarping::CylindricalSurfaceDewarper dewarper(m_distortionModel.topCurve().polyline(),
-                                                     m_distortionModel.bottomCurve().polyline(),
-                                                     m_depthPerception.value());
-      dewarping::CylindricalSurfaceDewarper::State state;
-
-      for (int j = 0; j < num_vert_grid_lines; ++j) {
-        const double x = j / (num_vert_grid_lines - 1.0);
-        const dewarping::CylindricalSurfaceDewarper::Generatrix gtx(dewarper.mapGeneratrix(x, state));
-        const QPointF gtx_p0(gtx.imgLine.pointAt(gtx.pln2img(0)));
-        const QPointF gtx_p1(gtx.imgLine.pointAt(gtx.pln2img(1)));
-        painter.drawLine(gtx_p0, gtx_p1);
-        for (int i = 0; i < num_hor_grid_lines; ++i) {
-          const double y = i / (num_hor_grid_lines - 1.0);
-          curves[i].push_back(gtx.imgLine.pointAt(gtx.pln2img(y)));
-        }
+    if (!m_validGridCache) {
+      valid_model = rebuildDewarpGrid();
+    }
+    if (valid_model) {
+      for (const QLineF& generatrix : m_gridGeneratrices) {
+        painter.drawLine(generatrix);
       }
-
-      for (const QVector<QPointF>& curve : curves) {
+      for (const QVector<QPointF>& curve : m_gridCurves) {
         painter.drawPolyline(curve);
       }
-    } catch (const std::runtime_error&) {
-      // Still probably a bad model, even though DistortionModel::isValid() was true.
-      valid_model = false;
     }
   }  // valid_model
   if (!valid_model) {
@@ -273,12 +256,45 @@ void DewarpingView::paintXSpline(QPainter& painter,
   painter.restore();
 }  // DewarpingView::paintXSpline
 
+bool DewarpingView::rebuildDewarpGrid() {
+  const int num_vert_grid_lines = 30;
+  const int num_hor_grid_lines = 30;
+
+  m_gridGeneratrices.clear();
+  m_gridCurves.assign(num_hor_grid_lines, QVector<QPointF>());
+
+  try {
+    dewarping::CylindricalSurfaceDewarper dewarper(m_distortionModel.topCurve().polyline(),
+                                                   m_distortionModel.bottomCurve().polyline(),
+                                                   m_depthPerception.value());
+    dewarping::CylindricalSurfaceDewarper::State state;
+
+    for (int j = 0; j < num_vert_grid_lines; ++j) {
+      const double x = j / (num_vert_grid_lines - 1.0);
+      const dewarping::CylindricalSurfaceDewarper::Generatrix gtx(dewarper.mapGeneratrix(x, state));
+      m_gridGeneratrices.emplace_back(gtx.imgLine.pointAt(gtx.pln2img(0)), gtx.imgLine.pointAt(gtx.pln2img(1)));
+      for (int i = 0; i < num_hor_grid_lines; ++i) {
+        const double y = i / (num_hor_grid_lines - 1.0);
+        m_gridCurves[i].push_back(gtx.imgLine.pointAt(gtx.pln2img(y)));
+      }
+    }
+  } catch (const std::runtime_error&) {
+    // Still probably a bad model, even though DistortionModel::isValid() was true.
+    return false;
+  }
+
+  m_validGridCache = true;
+
+  return true;
+}
+
 void DewarpingView::curveModified(int curve_idx) {
   if (curve_idx == 0) {
     m_distortionModel.setTopCurve(dewarping::Curve(m_topSpline.spline()));
   } else {
     m_distortionModel.setBottomCurve(dewarping::Curve(m_bottomSpline.spline()));
   }
+  m_validGridCache = false;
   update();
 }
 
@@ -19,10 +19,12 @@
 #ifndef OUTPUT_DEWARPING_VIEW_H_
 #define OUTPUT_DEWARPING_VIEW_H_
 
+#include <QLineF>
 #include <QPointF>
 #include <QPolygonF>
 #include <QRectF>
 #include <QTransform>
+#include <QVector>
 #include <vector>
 #include "DepthPerception.h"
 #include "DewarpingOptions.h"
@@ -73,6 +75,14 @@ class DewarpingView : public ImageViewBase, protected InteractionHandler {
 
   void paintXSpline(QPainter& painter, const InteractionState& interaction, const InteractiveXSpline& ispline);
 
+  /**
+   * Rebuilds the cached dewarping grid from the current distortion
+   * model and depth perception.  Returns false if the model turned
+   * out to be bad, in which case onPaint() falls back to drawing
+   * just the frame.
+   */
+  bool rebuildDewarpGrid();
+
   void curveModified(int curve_idx);
 
   void dragFinished();
@@ -92,6 +102,15 @@ class DewarpingView : public ImageViewBase, protected InteractionHandler {
   InteractiveXSpline m_bottomSpline;
   DragHandler m_dragHandler;
   ZoomHandler m_zoomHandler;
+
+  // The grid we draw over a valid distortion model.  Building it means
+  // constructing a CylindricalSurfaceDewarper and mapping a generatrix
+  // for every vertical grid line, which is too expensive to redo on
+  // every repaint.  The grid is therefore cached until the model or
+  // the depth perception change.
+  std::vector<QLineF> m_gridGeneratrices;
+  std::vector<QVector<QPointF>> m_gridCurves;
+  bool m_validGridCache;
 };
 }  // namespace output
 #endif  // ifndef OUTPUT_DEWARPING_VIEW_H_
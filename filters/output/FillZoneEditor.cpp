@@ -103,7 +103,13 @@ void FillZoneEditor::onPaint(QPainter& painter, const InteractionState& interact
     typedef FillColorProperty FCP;
     const QColor color(zone.properties()->locateOrDefault<FCP>()->color());
     painter.setBrush(m_colorAdapter(color));
-    painter.drawPolygon(zone.spline()->toPolygon(), Qt::WindingFill);
+    // The cached outline is closed and uses Qt::WindingFill.
+    const QPainterPath* const path = m_zones.spatialIndex().outlinePath(zone.spline());
+    if (path) {
+      painter.drawPath(*path);
+    } else {
+      painter.drawPolygon(zone.spline()->toPolygon(), Qt::WindingFill);
+    }
   }
 }
 
@@ -23,9 +23,11 @@
 #include <tiff.h>
 #include <boost/lambda/bind.hpp>
 #include <boost/lambda/lambda.hpp>
+#include <unordered_map>
 #include <utility>
 #include "CacheDrivenTask.h"
 #include "CommandLine.h"
+#include "DirtyPages.h"
 #include "FilterUiInterface.h"
 #include "OptionsWidget.h"
 #include "ProjectReader.h"
@@ -36,11 +38,7 @@
 
 namespace output {
 Filter::Filter(const PageSelectionAccessor& page_selection_accessor)
-    : m_settings(new Settings), m_selectedPageOrder(0) {
-  if (CommandLine::get().isGui()) {
-    m_optionsWidget.reset(new OptionsWidget(m_settings, page_selection_accessor));
-  }
-
+    : m_settings(new Settings), m_pageSelectionAccessor(page_selection_accessor), m_selectedPageOrder(0) {
   const PageOrderOption::ProviderPtr default_order;
   const auto order_by_completeness = make_intrusive<OrderByCompletenessProvider>();
   m_pageOrderOptions.emplace_back(tr("Natural order"), default_order);
@@ -62,8 +60,9 @@ void Filter::performRelinking(const AbstractRelinker& relinker) {
 }
 
 void Filter::preUpdateUI(FilterUiInterface* ui, const PageInfo& page_info) {
-  m_optionsWidget->preUpdateUI(page_info.id());
-  ui->setOptionsWidget(m_optionsWidget.get(), ui->KEEP_OWNERSHIP);
+  OptionsWidget* const options_widget = optionsWidget();
+  options_widget->preUpdateUI(page_info.id());
+  ui->setOptionsWidget(options_widget, ui->KEEP_OWNERSHIP);
 }
 
 QDomElement Filter::saveSettings(const ProjectWriter& writer, QDomDocument& doc) const {
@@ -75,6 +74,35 @@ QDomElement Filter::saveSettings(const ProjectWriter& writer, QDomDocument& doc)
   return filter_el;
 }
 
+bool Filter::updateSavedSettings(const ProjectWriter& writer, QDomDocument& doc, QDomElement& filter_el) {
+  const DirtyPages dirty(m_settings->fetchDirtyPages());
+  if (dirty.allDirty()) {
+    return false;
+  }
+
+  // Index the existing records, so that stale ones can be located
+  // without rescanning the element for every dirty page.
+  std::unordered_map<int, QDomElement> page_els;
+  for (QDomNode node = filter_el.firstChild(); !node.isNull(); node = node.nextSibling()) {
+    if (node.isElement() && (node.nodeName() == "page")) {
+      page_els[node.toElement().attribute("id").toInt()] = node.toElement();
+    }
+  }
+
+  writer.enumPages([&](const PageId& page_id, int numeric_id) {
+    if (dirty.pages().find(page_id) == dirty.pages().end()) {
+      return;
+    }
+    const auto it(page_els.find(numeric_id));
+    if (it != page_els.end()) {
+      filter_el.removeChild(it->second);
+    }
+    this->writePageSettings(doc, filter_el, page_id, numeric_id);
+  });
+
+  return true;
+}
+
 void Filter::writePageSettings(QDomDocument& doc, QDomElement& filter_el, const PageId& page_id, int numeric_id) const {
   const Params params(m_settings->getParams(page_id));
 
@@ -184,6 +212,10 @@ void Filter::loadDefaultSettings(const PageInfo& page_info) {
 }
 
 OptionsWidget* Filter::optionsWidget() {
+  if (!m_optionsWidget.get() && CommandLine::get().isGui()) {
+    m_optionsWidget.reset(new OptionsWidget(m_settings, m_pageSelectionAccessor));
+  }
+
   return m_optionsWidget.get();
 }
 
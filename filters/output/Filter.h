@@ -25,12 +25,12 @@
 #include "FillZonePropFactory.h"
 #include "FilterResult.h"
 #include "NonCopyable.h"
+#include "PageSelectionAccessor.h"
 #include "PageView.h"
 #include "PictureZonePropFactory.h"
 #include "SafeDeletingQObjectPtr.h"
 #include "intrusive_ptr.h"
 
-class PageSelectionAccessor;
 class ThumbnailPixmapCache;
 class OutputFileNameGenerator;
 class QString;
@@ -60,6 +60,8 @@ class Filter : public AbstractFilter {
 
   QDomElement saveSettings(const ProjectWriter& writer, QDomDocument& doc) const override;
 
+  bool updateSavedSettings(const ProjectWriter& writer, QDomDocument& doc, QDomElement& filter_el) override;
+
   void loadSettings(const ProjectReader& reader, const QDomElement& filters_el) override;
 
   void loadDefaultSettings(const PageInfo& page_info) override;
@@ -84,6 +86,7 @@ class Filter : public AbstractFilter {
   void writePageSettings(QDomDocument& doc, QDomElement& filter_el, const PageId& page_id, int numeric_id) const;
 
   intrusive_ptr<Settings> m_settings;
+  PageSelectionAccessor m_pageSelectionAccessor;
   SafeDeletingQObjectPtr<OptionsWidget> m_optionsWidget;
   PictureZonePropFactory m_pictureZonePropFactory;
   FillZonePropFactory m_fillZonePropFactory;
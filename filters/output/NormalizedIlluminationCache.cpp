@@ -0,0 +1,106 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "NormalizedIlluminationCache.h"
+#include <QImage>
+#include <algorithm>
+#include <cstring>
+
+namespace output {
+namespace {
+/**
+ * FNV-1a over 8-byte blocks of the pixel data.  Padding bytes at the end
+ * of scan lines are excluded, as Qt doesn't guarantee their contents.
+ */
+uint64_t hashImage(const QImage& image) {
+  const uint64_t prime = UINT64_C(1099511628211);
+  uint64_t h = UINT64_C(1469598103934665603);
+
+  const int bytes_per_pixel = std::max(image.depth() / 8, 1);
+  const int row_bytes = image.width() * bytes_per_pixel;
+  const int height = image.height();
+
+  for (int y = 0; y < height; ++y) {
+    const uchar* const line = image.constScanLine(y);
+    int i = 0;
+    for (; i + 8 <= row_bytes; i += 8) {
+      uint64_t block;
+      std::memcpy(&block, line + i, 8);
+      h = (h ^ block) * prime;
+    }
+    for (; i < row_bytes; ++i) {
+      h = (h ^ line[i]) * prime;
+    }
+  }
+
+  return h;
+}
+}  // namespace
+
+NormalizedIlluminationCache& NormalizedIlluminationCache::instance() {
+  static NormalizedIlluminationCache cache;
+
+  return cache;
+}
+
+NormalizedIlluminationCache::Key NormalizedIlluminationCache::makeKey(const QImage& input,
+                                                                      const QPolygonF& area_to_consider,
+                                                                      const QTransform& xform,
+                                                                      const QRect& target_rect) {
+  Key key;
+  key.image_hash = hashImage(input);
+  key.xform = xform;
+  key.target_rect = target_rect;
+  key.area_to_consider = area_to_consider;
+
+  return key;
+}
+
+bool NormalizedIlluminationCache::lookup(const Key& key, Entry& entry) {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    if (it->first == key) {
+      entry = it->second;
+      m_entries.splice(m_entries.begin(), m_entries, it);
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void NormalizedIlluminationCache::store(const Key& key, const Entry& entry) {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    if (it->first == key) {
+      it->second = entry;
+      m_entries.splice(m_entries.begin(), m_entries, it);
+
+      return;
+    }
+  }
+
+  m_entries.emplace_front(key, entry);
+  while (m_entries.size() > MAX_ENTRIES) {
+    m_entries.pop_back();
+  }
+}
+}  // namespace output
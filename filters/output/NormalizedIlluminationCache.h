@@ -0,0 +1,95 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OUTPUT_NORMALIZED_ILLUMINATION_CACHE_H_
+#define OUTPUT_NORMALIZED_ILLUMINATION_CACHE_H_
+
+#include <QPolygonF>
+#include <QRect>
+#include <QTransform>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <utility>
+#include "imageproc/GrayImage.h"
+
+class QImage;
+
+namespace output {
+/**
+ * \brief A small in-memory cache of illumination-normalized intermediates.
+ *
+ * Estimating and rendering the background polynomial is by far the most
+ * expensive part of re-rendering a page, yet its inputs don't change when
+ * the user only tweaks parameters downstream of normalization (binarization
+ * threshold, despeckling, fill zones).  This cache lets OutputGenerator skip
+ * the estimation entirely in that common interactive scenario.
+ *
+ * The cache is keyed by a content hash of the source image together with
+ * the transformation parameters, so a changed source or a changed crop /
+ * rotation / dpi simply misses.  Capacity is deliberately tiny: interactive
+ * tweaking touches one page at a time, and each entry holds two full-page
+ * grayscale images.
+ */
+class NormalizedIlluminationCache {
+ public:
+  struct Key {
+    uint64_t image_hash = 0;
+    QTransform xform;
+    QRect target_rect;
+    QPolygonF area_to_consider;
+
+    bool operator==(const Key& other) const {
+      return image_hash == other.image_hash && xform == other.xform && target_rect == other.target_rect
+             && area_to_consider == other.area_to_consider;
+    }
+  };
+
+  struct Entry {
+    imageproc::GrayImage normalized;
+    imageproc::GrayImage background;
+  };
+
+  static NormalizedIlluminationCache& instance();
+
+  /**
+   * Builds a key from the inputs of the normalization step.
+   * Involves hashing the image contents, which is cheap relative
+   * to background estimation but not free.
+   */
+  static Key makeKey(const QImage& input, const QPolygonF& area_to_consider, const QTransform& xform,
+                     const QRect& target_rect);
+
+  /**
+   * Returns true and fills \p entry on a hit.  A hit refreshes
+   * the entry's position in the eviction order.
+   */
+  bool lookup(const Key& key, Entry& entry);
+
+  void store(const Key& key, const Entry& entry);
+
+ private:
+  NormalizedIlluminationCache() = default;
+
+  static const size_t MAX_ENTRIES = 2;
+
+  std::mutex m_mutex;
+  std::list<std::pair<Key, Entry>> m_entries;  // Most recently used in front.
+};
+}  // namespace output
+#endif  // ifndef OUTPUT_NORMALIZED_ILLUMINATION_CACHE_H_
@@ -239,6 +239,14 @@ void OptionsWidget::changeDpiButtonClicked() {
   dialog->show();
 }
 
+void OptionsWidget::draftPreviewToggled(const bool checked) {
+  m_settings->setDraftPreviewEnabled(checked);
+
+  // The stored params are untouched; only the render path changes,
+  // so a reload is all that's needed in either direction.
+  emit reloadRequested();
+}
+
 void OptionsWidget::applyColorsButtonClicked() {
   auto* dialog = new ApplyColorsDialog(this, m_pageId, m_pageSelectionAccessor);
   dialog->setAttribute(Qt::WA_DeleteOnClose);
@@ -549,6 +557,7 @@ void OptionsWidget::updateDpiDisplay() {
   } else {
     dpiLabel->setText(QString::number(m_outputDpi.horizontal()));
   }
+  draftPreviewCB->setChecked(m_settings->isDraftPreviewEnabled());
 }
 
 void OptionsWidget::updateColorsDisplay() {
@@ -895,6 +904,7 @@ void OptionsWidget::sendReloadRequested() {
 
 void OptionsWidget::setupUiConnections() {
   CONNECT(changeDpiButton, SIGNAL(clicked()), this, SLOT(changeDpiButtonClicked()));
+  CONNECT(draftPreviewCB, SIGNAL(clicked(bool)), this, SLOT(draftPreviewToggled(bool)));
   CONNECT(colorModeSelector, SIGNAL(currentIndexChanged(int)), this, SLOT(colorModeChanged(int)));
   CONNECT(thresholdMethodBox, SIGNAL(currentIndexChanged(int)), this, SLOT(thresholdMethodChanged(int)));
   CONNECT(fillingColorBox, SIGNAL(currentIndexChanged(int)), this, SLOT(fillingColorChanged(int)));
@@ -79,6 +79,8 @@ class OptionsWidget : public FilterOptionsWidget, private Ui::OutputOptionsWidge
 
   void changeDpiButtonClicked();
 
+  void draftPreviewToggled(bool checked);
+
   void applyColorsButtonClicked();
 
   void applySplittingButtonClicked();
@@ -26,15 +26,23 @@
 #include <QDebug>
 #include <QPainter>
 #include <QtCore/QSettings>
+#include <algorithm>
 #include <boost/bind.hpp>
+#include <cstring>
 #include "DebugImages.h"
 #include "Dpm.h"
 #include "EstimateBackground.h"
 #include "FillColorProperty.h"
 #include "FilterData.h"
+#include "NormalizedIlluminationCache.h"
+#include "ParallelFor.h"
+#include "PictureMaskCache.h"
 #include "RenderParams.h"
+#include "SegmentationCache.h"
 #include "TaskStatus.h"
+#include "Tracer.h"
 #include "Utils.h"
+#include "ZoneMaskCache.h"
 #include "dewarping/CylindricalSurfaceDewarper.h"
 #include "dewarping/DewarpingPointMapper.h"
 #include "dewarping/DistortionModelBuilder.h"
@@ -53,8 +61,10 @@
 #include "imageproc/Morphology.h"
 #include "imageproc/OrthogonalRotation.h"
 #include "imageproc/PolygonRasterizer.h"
+#include "imageproc/PolygonUtils.h"
 #include "imageproc/PolynomialSurface.h"
 #include "imageproc/RasterOp.h"
+#include "imageproc/RleMask.h"
 #include "imageproc/SavGolFilter.h"
 #include "imageproc/Scale.h"
 #include "imageproc/SeedFill.h"
@@ -123,15 +133,19 @@ void reserveBlackAndWhite(QImage& img) {
   const int width = img.width();
   const int height = img.height();
 
-  auto* image_line = reinterpret_cast<PixelType*>(img.bits());
+  auto* const image_data = reinterpret_cast<PixelType*>(img.bits());
   const int image_stride = img.bytesPerLine() / sizeof(PixelType);
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      image_line[x] = reserveBlackAndWhite<PixelType>(image_line[x]);
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    PixelType* image_line = image_data + chunk_begin * image_stride;
+
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      for (int x = 0; x < width; ++x) {
+        image_line[x] = reserveBlackAndWhite<PixelType>(image_line[x]);
+      }
+      image_line += image_stride;
     }
-    image_line += image_stride;
-  }
+  });
 }
 
 void reserveBlackAndWhite(QImage& img) {
@@ -154,21 +168,26 @@ void reserveBlackAndWhite(QImage& img, const BinaryImage& mask) {
   const int width = img.width();
   const int height = img.height();
 
-  auto* image_line = reinterpret_cast<PixelType*>(img.bits());
+  auto* const image_data = reinterpret_cast<PixelType*>(img.bits());
   const int image_stride = img.bytesPerLine() / sizeof(PixelType);
-  const uint32_t* mask_line = mask.data();
+  const uint32_t* const mask_data = mask.data();
   const int mask_stride = mask.wordsPerLine();
   const uint32_t msb = uint32_t(1) << 31;
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      if (mask_line[x >> 5] & (msb >> (x & 31))) {
-        image_line[x] = reserveBlackAndWhite<PixelType>(image_line[x]);
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    PixelType* image_line = image_data + chunk_begin * image_stride;
+    const uint32_t* mask_line = mask_data + chunk_begin * mask_stride;
+
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      for (int x = 0; x < width; ++x) {
+        if (mask_line[x >> 5] & (msb >> (x & 31))) {
+          image_line[x] = reserveBlackAndWhite<PixelType>(image_line[x]);
+        }
       }
+      image_line += image_stride;
+      mask_line += mask_stride;
     }
-    image_line += image_stride;
-    mask_line += mask_stride;
-  }
+  });
 }
 
 void reserveBlackAndWhite(QImage& img, const BinaryImage& mask) {
@@ -188,48 +207,64 @@ void reserveBlackAndWhite(QImage& img, const BinaryImage& mask) {
 
 template <typename MixedPixel>
 void fillExcept(QImage& image, const BinaryImage& bw_mask, const QColor& color) {
-  auto* image_line = reinterpret_cast<MixedPixel*>(image.bits());
+  auto* const image_data = reinterpret_cast<MixedPixel*>(image.bits());
   const int image_stride = image.bytesPerLine() / sizeof(MixedPixel);
-  const uint32_t* bw_mask_line = bw_mask.data();
+  const uint32_t* const bw_mask_data = bw_mask.data();
   const int bw_mask_stride = bw_mask.wordsPerLine();
   const int width = image.width();
   const int height = image.height();
   const uint32_t msb = uint32_t(1) << 31;
   const auto fillingPixel = static_cast<MixedPixel>(color.rgba());
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      if (!(bw_mask_line[x >> 5] & (msb >> (x & 31)))) {
-        image_line[x] = fillingPixel;
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    MixedPixel* image_line = image_data + chunk_begin * image_stride;
+    const uint32_t* bw_mask_line = bw_mask_data + chunk_begin * bw_mask_stride;
+
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      for (int x = 0; x < width; ++x) {
+        if (!(bw_mask_line[x >> 5] & (msb >> (x & 31)))) {
+          image_line[x] = fillingPixel;
+        }
       }
+      image_line += image_stride;
+      bw_mask_line += bw_mask_stride;
     }
-    image_line += image_stride;
-    bw_mask_line += bw_mask_stride;
-  }
+  });
 }
 
 void fillExcept(BinaryImage& image, const BinaryImage& bw_mask, const BWColor color) {
-  uint32_t* image_line = image.data();
+  uint32_t* const image_data = image.data();
   const int image_stride = image.wordsPerLine();
-  const uint32_t* bw_mask_line = bw_mask.data();
+  const uint32_t* const bw_mask_data = bw_mask.data();
   const int bw_mask_stride = bw_mask.wordsPerLine();
   const int width = image.width();
   const int height = image.height();
   const uint32_t msb = uint32_t(1) << 31;
-
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      if (!(bw_mask_line[x >> 5] & (msb >> (x & 31)))) {
+  const int last_word_idx = (width - 1) >> 5;
+  // Only bits of the last word that correspond to real pixels.
+  const uint32_t last_word_mask = ~uint32_t(0) << (31 - ((width - 1) & 31));
+
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    uint32_t* image_line = image_data + chunk_begin * image_stride;
+    const uint32_t* bw_mask_line = bw_mask_data + chunk_begin * bw_mask_stride;
+
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      // Word-at-a-time rather than bit-at-a-time.
+      for (int i = 0; i <= last_word_idx; ++i) {
+        uint32_t fill_mask = ~bw_mask_line[i];
+        if (i == last_word_idx) {
+          fill_mask &= last_word_mask;
+        }
         if (color == BLACK) {
-          image_line[x >> 5] |= (msb >> (x & 31));
+          image_line[i] |= fill_mask;
         } else {
-          image_line[x >> 5] &= ~(msb >> (x & 31));
+          image_line[i] &= ~fill_mask;
         }
       }
+      image_line += image_stride;
+      bw_mask_line += bw_mask_stride;
     }
-    image_line += image_stride;
-    bw_mask_line += bw_mask_stride;
-  }
+  });
 }
 
 void removeAutoPictureZones(ZoneSet& picture_zones) {
@@ -270,6 +305,52 @@ BackgroundColorCalculator getBackgroundColorCalculator(const PageId& pageId, con
     return BackgroundColorCalculator(false);
   }
 }
+
+/**
+ * Rasterizes the fill zones under an affine mapping into one RLE mask
+ * per zone, the form ZoneMaskCache keeps them in.
+ */
+ZoneMaskCache::FillLayers rasterizeFillZones(const ZoneSet& zones, const QTransform& total_xform, const QSize& size) {
+  ZoneMaskCache::FillLayers layers;
+  for (const Zone& zone : zones) {
+    const QColor color(zone.properties().locateOrDefault<FillColorProperty>()->color());
+    RleMask mask(size);
+    PolygonRasterizer::fillRle(mask, total_xform.map(zone.spline().toPolygon()), Qt::WindingFill);
+    layers.emplace_back(std::move(mask), color.rgb());
+  }
+
+  return layers;
+}
+
+/**
+ * Writes the black runs of \p mask into the image with \p color.
+ * The image must be RGB32, ARGB32 or grayscale Indexed8 and have the
+ * same size as the mask.  Pixel semantics match the batch
+ * PolygonRasterizer::fill() overload for these formats.
+ */
+void fillRuns(QImage& img, const RleMask& mask, const QRgb color) {
+  const int height = mask.height();
+  if (img.format() == QImage::Format_Indexed8) {
+    const auto gray = static_cast<uint8_t>(qGray(color));
+    uint8_t* line = img.bits();
+    const int bpl = img.bytesPerLine();
+    for (int y = 0; y < height; ++y, line += bpl) {
+      for (const RleMask::Run& run : mask.runs(y)) {
+        memset(line + run.xBegin, gray, run.xEnd - run.xBegin);
+      }
+    }
+  } else {
+    const auto px = uint32_t(color);
+    uint8_t* raw = img.bits();
+    const int bpl = img.bytesPerLine();
+    for (int y = 0; y < height; ++y, raw += bpl) {
+      auto* line = reinterpret_cast<uint32_t*>(raw);
+      for (const RleMask::Run& run : mask.runs(y)) {
+        std::fill(line + run.xBegin, line + run.xEnd, px);
+      }
+    }
+  }
+}
 }  // namespace
 
 OutputGenerator::OutputGenerator(const Dpi& dpi,
@@ -350,6 +431,24 @@ GrayImage OutputGenerator::normalizeIlluminationGray(const TaskStatus& status,
                                                      const QRect& target_rect,
                                                      GrayImage* background,
                                                      DebugImages* const dbg) {
+  TRACE_SCOPE("output: normalize illumination");
+
+  // Debug runs want the intermediate images recomputed every time.
+  const bool cacheable = !dbg;
+  NormalizedIlluminationCache::Key cache_key;
+  if (cacheable) {
+    cache_key = NormalizedIlluminationCache::makeKey(input, area_to_consider, xform, target_rect);
+
+    NormalizedIlluminationCache::Entry cached;
+    if (NormalizedIlluminationCache::instance().lookup(cache_key, cached)) {
+      if (background) {
+        *background = cached.background;
+      }
+
+      return cached.normalized;
+    }
+  }
+
   GrayImage to_be_normalized(transformToGray(input, xform, target_rect, OutsidePixels::assumeWeakNearest()));
   if (dbg) {
     dbg->add(to_be_normalized, "to_be_normalized");
@@ -372,6 +471,12 @@ GrayImage OutputGenerator::normalizeIlluminationGray(const TaskStatus& status,
     *background = bg_img;
   }
 
+  // A cheap shared copy - grayRasterOp() below detaches bg_img.
+  GrayImage bg_for_cache;
+  if (cacheable) {
+    bg_for_cache = bg_img;
+  }
+
   status.throwIfCancelled();
 
   grayRasterOp<RaiseAboveBackground>(bg_img, to_be_normalized);
@@ -379,6 +484,13 @@ GrayImage OutputGenerator::normalizeIlluminationGray(const TaskStatus& status,
     dbg->add(bg_img, "normalized_illumination");
   }
 
+  if (cacheable) {
+    NormalizedIlluminationCache::Entry entry;
+    entry.normalized = bg_img;
+    entry.background = bg_for_cache;
+    NormalizedIlluminationCache::instance().store(cache_key, entry);
+  }
+
   return bg_img;
 }  // OutputGenerator::normalizeIlluminationGray
 
@@ -387,8 +499,26 @@ imageproc::BinaryImage OutputGenerator::estimateBinarizationMask(const TaskStatu
                                                                  const QRect& source_rect,
                                                                  const QRect& source_sub_rect,
                                                                  DebugImages* const dbg) const {
+  TRACE_SCOPE("output: estimate binarization mask");
+
   assert(source_rect.contains(source_sub_rect));
 
+  // Picture detection only depends on the source image, the geometry
+  // and the shape options, so re-renders triggered by unrelated
+  // parameter changes can reuse the previous mask.  With a debug sink
+  // attached the detection is always redone, so that the debugging
+  // images get generated.
+  const bool cacheable = !dbg;
+  PictureMaskCache::Key cache_key;
+  if (cacheable) {
+    cache_key = PictureMaskCache::makeKey(gray_source, source_rect, source_sub_rect, m_dpi, m_pictureShapeOptions);
+
+    BinaryImage cached_mask;
+    if (PictureMaskCache::instance().lookup(cache_key, cached_mask)) {
+      return cached_mask;
+    }
+  }
+
   // If we need to strip some of the margins from a grayscale
   // image, we may actually do it without copying anything.
   // We are going to construct a QImage from existing data.
@@ -429,7 +559,13 @@ imageproc::BinaryImage OutputGenerator::estimateBinarizationMask(const TaskStatu
   // Scale back to original size.
   picture_areas = scaleToGray(picture_areas, source_sub_rect.size());
 
-  return BinaryImage(picture_areas, threshold);
+  BinaryImage mask(picture_areas, threshold);
+
+  if (cacheable) {
+    PictureMaskCache::instance().store(cache_key, mask);
+  }
+
+  return mask;
 }  // OutputGenerator::estimateBinarizationMask
 
 void OutputGenerator::modifyBinarizationMask(imageproc::BinaryImage& bw_mask,
@@ -440,29 +576,45 @@ void OutputGenerator::modifyBinarizationMask(imageproc::BinaryImage& bw_mask,
 
   typedef PictureLayerProperty PLP;
 
-  // Pass 1: ERASER1
-  for (const Zone& zone : zones) {
-    if (zone.properties().locateOrDefault<PLP>()->layer() == PLP::ERASER1) {
-      const QPolygonF poly(zone.spline().toPolygon());
-      PolygonRasterizer::fill(bw_mask, BLACK, xform.map(poly), Qt::WindingFill);
-    }
-  }
+  // The rasterized layers depend only on the zones and the output
+  // geometry, so re-renders triggered by non-zone parameter changes
+  // reuse them from the cache without touching any polygon math.
+  const ZoneMaskCache::Key key(ZoneMaskCache::makeKey(zones, xform, QRect(QPoint(0, 0), bw_mask.size())));
+  ZoneMaskCache::PictureLayers layers;
 
-  // Pass 2: PAINTER2
-  for (const Zone& zone : zones) {
-    if (zone.properties().locateOrDefault<PLP>()->layer() == PLP::PAINTER2) {
-      const QPolygonF poly(zone.spline().toPolygon());
-      PolygonRasterizer::fill(bw_mask, WHITE, xform.map(poly), Qt::WindingFill);
-    }
-  }
+  if (!ZoneMaskCache::instance().lookupPictureLayers(key, layers)) {
+    // Rasterize each layer into an RLE overlay, then apply the layers
+    // in order.  Zones typically cover a small fraction of the page,
+    // and applying runs only touches the words they overlap.
+    layers.eraser1 = RleMask(bw_mask.size());
+    layers.painter2 = RleMask(bw_mask.size());
+    layers.eraser3 = RleMask(bw_mask.size());
 
-  // Pass 1: ERASER3
-  for (const Zone& zone : zones) {
-    if (zone.properties().locateOrDefault<PLP>()->layer() == PLP::ERASER3) {
+    for (const Zone& zone : zones) {
+      RleMask* layer_mask;
+      switch (zone.properties().locateOrDefault<PLP>()->layer()) {
+        case PLP::ERASER1:
+          layer_mask = &layers.eraser1;
+          break;
+        case PLP::PAINTER2:
+          layer_mask = &layers.painter2;
+          break;
+        case PLP::ERASER3:
+          layer_mask = &layers.eraser3;
+          break;
+        default:
+          continue;
+      }
       const QPolygonF poly(zone.spline().toPolygon());
-      PolygonRasterizer::fill(bw_mask, BLACK, xform.map(poly), Qt::WindingFill);
+      PolygonRasterizer::fillRle(*layer_mask, xform.map(poly), Qt::WindingFill);
     }
+
+    ZoneMaskCache::instance().storePictureLayers(key, layers);
   }
+
+  layers.eraser1.fill(bw_mask, BLACK);
+  layers.painter2.fill(bw_mask, WHITE);
+  layers.eraser3.fill(bw_mask, BLACK);
 }
 
 QImage OutputGenerator::processImpl(const TaskStatus& status,
@@ -497,6 +649,8 @@ QImage OutputGenerator::processWithoutDewarping(const TaskStatus& status,
                                                 const PageId& pageId,
                                                 const intrusive_ptr<Settings>& settings,
                                                 SplitImage* splitImage) {
+  TRACE_SCOPE("output: render");
+
   const RenderParams render_params(m_colorParams, m_splittingOptions);
 
   const QPolygonF preCropArea = [this, &render_params]() {
@@ -504,13 +658,13 @@ QImage OutputGenerator::processWithoutDewarping(const TaskStatus& status,
       return m_xform.resultingPreCropArea();
     } else {
       const QPolygonF imageRectInOutputCs = m_xform.transform().map(m_xform.origRect());
-      return imageRectInOutputCs.intersected(QRectF(m_outRect));
+      return PolygonUtils::clipToRect(imageRectInOutputCs, QRectF(m_outRect));
     }
   }();
   const QPolygonF contentArea
-      = preCropArea.intersected(QRectF(render_params.fillMargins() ? m_contentRect : m_outRect));
+      = PolygonUtils::clipToRect(preCropArea, QRectF(render_params.fillMargins() ? m_contentRect : m_outRect));
   const QRect contentRect = contentArea.boundingRect().toRect();
-  const QPolygonF outCropArea = preCropArea.intersected(QRectF(m_outRect));
+  const QPolygonF outCropArea = PolygonUtils::clipToRect(preCropArea, QRectF(m_outRect));
 
   const QSize target_size(m_outRect.size().expandedTo(QSize(1, 1)));
   // If the content area is empty or outside the cropping area, return a blank page.
@@ -537,8 +691,8 @@ QImage OutputGenerator::processWithoutDewarping(const TaskStatus& status,
   // some garbage that connects the content to the edge of the
   // image area.
   const QRect workingBoundingRect(
-      preCropArea
-          .intersected(QRectF(contentRect.adjusted(-content_margin, -content_margin, content_margin, content_margin)))
+      PolygonUtils::clipToRect(
+          preCropArea, QRectF(contentRect.adjusted(-content_margin, -content_margin, content_margin, content_margin)))
           .boundingRect()
           .toRect());
   const QRect contentRectInWorkingCs(contentRect.translated(-workingBoundingRect.topLeft()));
@@ -1002,6 +1156,8 @@ QImage OutputGenerator::processWithDewarping(const TaskStatus& status,
                                              const PageId& pageId,
                                              const intrusive_ptr<Settings>& settings,
                                              SplitImage* splitImage) {
+  TRACE_SCOPE("output: render with dewarping");
+
   const RenderParams render_params(m_colorParams, m_splittingOptions);
 
   const QPolygonF preCropArea = [this, &render_params]() {
@@ -1009,13 +1165,13 @@ QImage OutputGenerator::processWithDewarping(const TaskStatus& status,
       return m_xform.resultingPreCropArea();
     } else {
       const QPolygonF imageRectInOutputCs = m_xform.transform().map(m_xform.origRect());
-      return imageRectInOutputCs.intersected(QRectF(m_outRect));
+      return PolygonUtils::clipToRect(imageRectInOutputCs, QRectF(m_outRect));
     }
   }();
   const QPolygonF contentArea
-      = preCropArea.intersected(QRectF(render_params.fillMargins() ? m_contentRect : m_outRect));
+      = PolygonUtils::clipToRect(preCropArea, QRectF(render_params.fillMargins() ? m_contentRect : m_outRect));
   const QRect contentRect = contentArea.boundingRect().toRect();
-  const QPolygonF outCropArea = preCropArea.intersected(QRectF(m_outRect));
+  const QPolygonF outCropArea = PolygonUtils::clipToRect(preCropArea, QRectF(m_outRect));
 
   const QSize target_size(m_outRect.size().expandedTo(QSize(1, 1)));
   // If the content area is empty or outside the cropping area, return a blank page.
@@ -1042,8 +1198,8 @@ QImage OutputGenerator::processWithDewarping(const TaskStatus& status,
   // some garbage that connects the content to the edge of the
   // image area.
   const QRect workingBoundingRect(
-      preCropArea
-          .intersected(QRectF(contentRect.adjusted(-content_margin, -content_margin, content_margin, content_margin)))
+      PolygonUtils::clipToRect(
+          preCropArea, QRectF(contentRect.adjusted(-content_margin, -content_margin, content_margin, content_margin)))
           .boundingRect()
           .toRect());
   const QRect contentRectInWorkingCs(contentRect.translated(-workingBoundingRect.topLeft()));
@@ -1216,7 +1372,11 @@ QImage OutputGenerator::processWithDewarping(const TaskStatus& status,
     status.throwIfCancelled();
   }
 
-  if (m_dewarpingOptions.dewarpingMode() == AUTO) {
+  if ((m_dewarpingOptions.dewarpingMode() == AUTO) && distortion_model.isValid()) {
+    // The caller restored a model fitted on a previous run of this
+    // page.  Nothing it was built from has changed, so don't re-run
+    // the text line tracing below.
+  } else if (m_dewarpingOptions.dewarpingMode() == AUTO) {
     DistortionModelBuilder model_builder(Vec2d(0, 1));
 
     TextLineTracer::trace(warped_gray_output, m_dpi, contentRectInWorkingCs, model_builder, status, dbg);
@@ -1849,6 +2009,8 @@ QImage OutputGenerator::dewarp(const QTransform& orig_to_src,
                                const DistortionModel& distortion_model,
                                const DepthPerception& depth_perception,
                                const QColor& bg_color) const {
+  TRACE_SCOPE("output: dewarp");
+
   const CylindricalSurfaceDewarper dewarper(createDewarper(distortion_model, orig_to_src, depth_perception.value()));
 
   // Model domain is a rectangle in output image coordinates that
@@ -1959,6 +2121,8 @@ void OutputGenerator::fillMarginsInPlace(BinaryImage& image, const BinaryImage&
 GrayImage OutputGenerator::detectPictures(const GrayImage& input_300dpi,
                                           const TaskStatus& status,
                                           DebugImages* const dbg) const {
+  TRACE_SCOPE("output: detect pictures");
+
   // We stretch the range of gray levels to cover the whole
   // range of [0, 255].  We do it because we want text
   // and background to be equally far from the center
@@ -2143,6 +2307,8 @@ BinaryImage OutputGenerator::binarize(const QImage& image, const BinaryImage& ma
 }
 
 BinaryImage OutputGenerator::binarize(const QImage& image, const QPolygonF& crop_area, const BinaryImage* mask) const {
+  TRACE_SCOPE("output: binarize");
+
   QPainterPath path;
   path.addPolygon(crop_area);
 
@@ -2194,6 +2360,8 @@ void OutputGenerator::maybeDespeckleInPlace(imageproc::BinaryImage& image,
                                             const Dpi& dpi,
                                             const TaskStatus& status,
                                             DebugImages* dbg) const {
+  TRACE_SCOPE("output: despeckle");
+
   const QRect src_rect(mask_rect.translated(-image_rect.topLeft()));
   const QRect dst_rect(mask_rect);
 
@@ -2220,6 +2388,8 @@ void OutputGenerator::maybeDespeckleInPlace(imageproc::BinaryImage& image,
 }  // OutputGenerator::maybeDespeckleInPlace
 
 void OutputGenerator::morphologicalSmoothInPlace(BinaryImage& bin_img, const TaskStatus& status) {
+  TRACE_SCOPE("output: morphological smoothing");
+
   // When removing black noise, remove small ones first.
 
   {
@@ -2372,6 +2542,27 @@ void OutputGenerator::applyFillZonesInPlace(QImage& img,
     return;
   }
 
+  const QImage::Format format = img.format();
+  const bool spans_supported = (format == QImage::Format_RGB32) || (format == QImage::Format_ARGB32)
+                               || ((format == QImage::Format_Indexed8) && img.isGrayscale());
+
+  if (spans_supported) {
+    // All zones go into a single scanline sweep written directly on
+    // the image rows.  Unlike the QPainter path below, this performs
+    // no whole-image format conversions and only touches the filled
+    // spans; the zone edges come out hard, like on the bitonal
+    // rendering path.
+    std::vector<std::pair<QPolygonF, QRgb>> polys;
+    for (const Zone& zone : zones) {
+      const QColor color(zone.properties().locateOrDefault<FillColorProperty>()->color());
+      polys.emplace_back(postTransform.map(zone.spline().transformed(orig_to_output).toPolygon()), color.rgb());
+    }
+    PolygonRasterizer::fill(img, polys, Qt::WindingFill);
+
+    return;
+  }
+
+  // Exotic formats keep the QPainter path and its antialiasing.
   QImage canvas(img.convertToFormat(QImage::Format_ARGB32_Premultiplied));
 
   {
@@ -2405,15 +2596,42 @@ void OutputGenerator::applyFillZonesInPlace(QImage& img,
                                             const ZoneSet& zones,
                                             const QTransform& postTransform,
                                             const bool antialiasing) const {
-  typedef QPointF (QTransform::*MapPointFunc)(const QPointF&) const;
-  applyFillZonesInPlace(img, zones, boost::bind((MapPointFunc) &QTransform::map, m_xform.transform(), _1),
-                        postTransform, antialiasing);
+  if (zones.empty()) {
+    return;
+  }
+
+  const QImage::Format format = img.format();
+  const bool spans_supported = (format == QImage::Format_RGB32) || (format == QImage::Format_ARGB32)
+                               || ((format == QImage::Format_Indexed8) && img.isGrayscale());
+
+  if (!spans_supported) {
+    typedef QPointF (QTransform::*MapPointFunc)(const QPointF&) const;
+    applyFillZonesInPlace(img, zones, boost::bind((MapPointFunc) &QTransform::map, m_xform.transform(), _1),
+                          postTransform, antialiasing);
+
+    return;
+  }
+
+  // The whole mapping is affine here, so the rasterization can be
+  // cached and replayed across re-renders with non-zone parameter
+  // changes.  Replaying the masks in zone order is equivalent to the
+  // single scanline sweep of the uncached path.
+  const QTransform total_xform(m_xform.transform() * postTransform);
+  const ZoneMaskCache::Key key(ZoneMaskCache::makeKey(zones, total_xform, img.rect()));
+  ZoneMaskCache::FillLayers layers;
+
+  if (!ZoneMaskCache::instance().lookupFillLayers(key, layers)) {
+    layers = rasterizeFillZones(zones, total_xform, img.size());
+    ZoneMaskCache::instance().storeFillLayers(key, layers);
+  }
+
+  for (const auto& mask_and_color : layers) {
+    fillRuns(img, mask_and_color.first, mask_and_color.second);
+  }
 }
 
 void OutputGenerator::applyFillZonesInPlace(QImage& img, const ZoneSet& zones, const bool antialiasing) const {
-  typedef QPointF (QTransform::*MapPointFunc)(const QPointF&) const;
-  applyFillZonesInPlace(img, zones, boost::bind((MapPointFunc) &QTransform::map, m_xform.transform(), _1),
-                        antialiasing);
+  applyFillZonesInPlace(img, zones, QTransform(), antialiasing);
 }
 
 void OutputGenerator::applyFillZonesInPlace(imageproc::BinaryImage& img,
@@ -2424,12 +2642,14 @@ void OutputGenerator::applyFillZonesInPlace(imageproc::BinaryImage& img,
     return;
   }
 
+  // All zones go into a single scanline sweep.
+  std::vector<std::pair<QPolygonF, BWColor>> polys;
   for (const Zone& zone : zones) {
     const QColor color(zone.properties().locateOrDefault<FillColorProperty>()->color());
     const BWColor bw_color = qGray(color.rgb()) < 128 ? BLACK : WHITE;
-    const QPolygonF poly(postTransform.map(zone.spline().transformed(orig_to_output).toPolygon()));
-    PolygonRasterizer::fill(img, bw_color, poly, Qt::WindingFill);
+    polys.emplace_back(postTransform.map(zone.spline().transformed(orig_to_output).toPolygon()), bw_color);
   }
+  PolygonRasterizer::fill(img, polys, Qt::WindingFill);
 }
 
 void OutputGenerator::applyFillZonesInPlace(imageproc::BinaryImage& img,
@@ -2441,9 +2661,24 @@ void OutputGenerator::applyFillZonesInPlace(imageproc::BinaryImage& img,
 void OutputGenerator::applyFillZonesInPlace(imageproc::BinaryImage& img,
                                             const ZoneSet& zones,
                                             const QTransform& postTransform) const {
-  typedef QPointF (QTransform::*MapPointFunc)(const QPointF&) const;
-  applyFillZonesInPlace(img, zones, boost::bind((MapPointFunc) &QTransform::map, m_xform.transform(), _1),
-                        postTransform);
+  if (zones.empty()) {
+    return;
+  }
+
+  // See the QImage overload above for why the affine path caches.
+  const QTransform total_xform(m_xform.transform() * postTransform);
+  const ZoneMaskCache::Key key(ZoneMaskCache::makeKey(zones, total_xform, img.rect()));
+  ZoneMaskCache::FillLayers layers;
+
+  if (!ZoneMaskCache::instance().lookupFillLayers(key, layers)) {
+    layers = rasterizeFillZones(zones, total_xform, img.size());
+    ZoneMaskCache::instance().storeFillLayers(key, layers);
+  }
+
+  for (const auto& mask_and_color : layers) {
+    const BWColor bw_color = qGray(mask_and_color.second) < 128 ? BLACK : WHITE;
+    mask_and_color.first.fill(img, bw_color);
+  }
 }
 
 /**
@@ -2451,8 +2686,7 @@ void OutputGenerator::applyFillZonesInPlace(imageproc::BinaryImage& img,
  * from original image to output image coordinates.
  */
 void OutputGenerator::applyFillZonesInPlace(imageproc::BinaryImage& img, const ZoneSet& zones) const {
-  typedef QPointF (QTransform::*MapPointFunc)(const QPointF&) const;
-  applyFillZonesInPlace(img, zones, boost::bind((MapPointFunc) &QTransform::map, m_xform.transform(), _1));
+  applyFillZonesInPlace(img, zones, QTransform());
 }
 
 void OutputGenerator::movePointToTopMargin(BinaryImage& bw_image, XSpline& spline, int idx) const {
@@ -2647,14 +2881,31 @@ void OutputGenerator::applyFillZonesToMixedInPlace(QImage& img,
 QImage OutputGenerator::segmentImage(const BinaryImage& image, const QImage& color_image) const {
   const BlackWhiteOptions::ColorSegmenterOptions& segmenterOptions
       = m_colorParams.blackWhiteOptions().getColorSegmenterOptions();
+
+  // The segmented foreground depends only on these inputs, so re-renders
+  // triggered by parameter changes downstream of segmentation reuse the
+  // previous result.  A binarization change alters the foreground image
+  // itself and misses as it should.
+  const SegmentationCache::Key cache_key(SegmentationCache::makeKey(image, color_image, m_dpi, segmenterOptions));
+
+  QImage segmented;
+  if (SegmentationCache::instance().lookup(cache_key, segmented)) {
+    return segmented;
+  }
+
   if (!color_image.allGray()) {
-    return ColorSegmenter(image, color_image, m_dpi, segmenterOptions.getNoiseReduction(),
-                          segmenterOptions.getRedThresholdAdjustment(), segmenterOptions.getGreenThresholdAdjustment(),
-                          segmenterOptions.getBlueThresholdAdjustment())
-        .getImage();
+    segmented = ColorSegmenter(image, color_image, m_dpi, segmenterOptions.getNoiseReduction(),
+                               segmenterOptions.getRedThresholdAdjustment(),
+                               segmenterOptions.getGreenThresholdAdjustment(),
+                               segmenterOptions.getBlueThresholdAdjustment())
+                    .getImage();
   } else {
-    return ColorSegmenter(image, GrayImage(color_image), m_dpi, segmenterOptions.getNoiseReduction()).getImage();
+    segmented = ColorSegmenter(image, GrayImage(color_image), m_dpi, segmenterOptions.getNoiseReduction()).getImage();
   }
+
+  SegmentationCache::instance().store(cache_key, segmented);
+
+  return segmented;
 }
 
 QImage OutputGenerator::posterizeImage(const QImage& image, const QColor& background_color) const {
@@ -144,6 +144,50 @@ bool OutputImageParams::matches(const OutputImageParams& other) const {
   return true;
 }  // OutputImageParams::matches
 
+bool OutputImageParams::matchesDistortionModelInputs(const OutputImageParams& other) const {
+  // The model is traced on the warped grayscale image, which depends
+  // on the geometry and the grayscale-stage color settings, but not on
+  // binarization-stage parameters like the despeckle level, nor on
+  // zones or depth perception.
+  if (m_size != other.m_size) {
+    return false;
+  }
+
+  if (m_contentRect != other.m_contentRect) {
+    return false;
+  }
+
+  if (m_cropArea != other.m_cropArea) {
+    return false;
+  }
+
+  if (!m_partialXform.matches(other.m_partialXform)) {
+    return false;
+  }
+
+  if (m_dpi != other.m_dpi) {
+    return false;
+  }
+
+  if (m_colorParams.colorMode() != other.m_colorParams.colorMode()) {
+    return false;
+  }
+
+  if (m_colorParams.blackWhiteOptions() != other.m_colorParams.blackWhiteOptions()) {
+    return false;
+  }
+
+  if (m_dewarpingOptions != other.m_dewarpingOptions) {
+    return false;
+  }
+
+  if (m_blackOnWhite != other.m_blackOnWhite) {
+    return false;
+  }
+
+  return true;
+}  // OutputImageParams::matchesDistortionModelInputs
+
 bool OutputImageParams::colorParamsMatch(const ColorParams& cp1,
                                          const double dl1,
                                          const SplittingOptions& so1,
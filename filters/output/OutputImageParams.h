@@ -84,6 +84,16 @@ class OutputImageParams {
    */
   bool matches(const OutputImageParams& other) const;
 
+  /**
+   * \brief Returns true if everything the auto distortion model is
+   *        built from is the same in both sets of parameters.
+   *
+   * When this holds, a model fitted on a previous run can be reused
+   * instead of re-running the text line tracers, even though the
+   * output image itself needs re-generating.
+   */
+  bool matchesDistortionModelInputs(const OutputImageParams& other) const;
+
  private:
   class PartialXform {
    public:
@@ -0,0 +1,104 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "OutputWriteQueue.h"
+#include <new>
+#include "OutOfMemoryHandler.h"
+
+namespace output {
+OutputWriteQueue& OutputWriteQueue::instance() {
+  static OutputWriteQueue the_instance;
+
+  return the_instance;
+}
+
+OutputWriteQueue::OutputWriteQueue() = default;
+
+OutputWriteQueue::~OutputWriteQueue() {
+  {
+    const std::lock_guard<std::mutex> guard(m_mutex);
+    m_shutdown = true;
+  }
+  m_cond.notify_all();
+
+  if (m_threadStarted) {
+    // The background thread drains the queue before exiting,
+    // so no writes are lost.
+    m_thread.join();
+  }
+}
+
+void OutputWriteQueue::enqueue(const std::function<void()>& job, const size_t pending_bytes) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  m_cond.wait(lock, [this, pending_bytes] {
+    return m_shutdown || m_queue.empty() || (m_pendingBytes + pending_bytes <= MAX_PENDING_BYTES);
+  });
+  if (m_shutdown) {
+    return;
+  }
+
+  m_queue.push_back(Job{job, pending_bytes});
+  m_pendingBytes += pending_bytes;
+
+  if (!m_threadStarted) {
+    m_thread = std::thread(&OutputWriteQueue::backgroundThread, this);
+    m_threadStarted = true;
+  }
+
+  m_cond.notify_all();
+}
+
+void OutputWriteQueue::waitForPendingWrites() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cond.wait(lock, [this] { return m_queue.empty() && !m_jobRunning; });
+}
+
+void OutputWriteQueue::backgroundThread() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while (true) {
+    if (m_queue.empty()) {
+      if (m_shutdown) {
+        break;
+      }
+      m_cond.wait(lock);
+      continue;
+    }
+
+    Job job(std::move(m_queue.front()));
+    m_queue.pop_front();
+    m_jobRunning = true;
+    lock.unlock();
+
+    try {
+      job.func();
+    } catch (const std::bad_alloc&) {
+      OutOfMemoryHandler::instance().handleOutOfMemorySituation();
+    }
+    // Release the images the job was holding before touching the
+    // accounting, so a blocked enqueue never briefly exceeds the bound.
+    job.func = nullptr;
+
+    lock.lock();
+    m_jobRunning = false;
+    m_pendingBytes -= job.bytes;
+    m_cond.notify_all();
+  }
+}
+}  // namespace output
@@ -0,0 +1,91 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OUTPUT_OUTPUTWRITEQUEUE_H_
+#define OUTPUT_OUTPUTWRITEQUEUE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "NonCopyable.h"
+
+namespace output {
+/**
+ * \brief Executes output file writes on a dedicated I/O thread.
+ *
+ * Rendering a page and writing the results to disk have nothing to
+ * share, so a page task hands its writes over here and moves on to the
+ * next page instead of blocking on the disk.  Jobs run strictly in the
+ * order they were enqueued, which makes the per-page bookkeeping done
+ * at the end of each job an ordered commit.  The queue is bounded by
+ * the amount of image data the pending jobs pin in memory: enqueue()
+ * blocks once the bound is reached, so a slow disk throttles rendering
+ * rather than piling up an unbounded backlog of images.
+ */
+class OutputWriteQueue {
+  DECLARE_NON_COPYABLE(OutputWriteQueue)
+
+ public:
+  static OutputWriteQueue& instance();
+
+  /**
+   * \brief Schedules a job for execution on the I/O thread.
+   *
+   * \p pending_bytes is an estimate of the image data the job holds
+   * on to until it has run.  An oversized job is still admitted once
+   * the queue drains, so it can't get stuck.
+   */
+  void enqueue(const std::function<void()>& job, size_t pending_bytes);
+
+  /**
+   * \brief Waits until every job enqueued so far has finished.
+   *
+   * This is the barrier at the end of a batch: once it returns, all
+   * output files are on disk and all per-page records are committed.
+   */
+  void waitForPendingWrites();
+
+ private:
+  struct Job {
+    std::function<void()> func;
+    size_t bytes;
+  };
+
+  OutputWriteQueue();
+
+  ~OutputWriteQueue();
+
+  void backgroundThread();
+
+  /** The queued jobs never pin more than this much image data. */
+  static const size_t MAX_PENDING_BYTES = size_t(512) * 1024 * 1024;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::deque<Job> m_queue;
+  size_t m_pendingBytes = 0;
+  bool m_jobRunning = false;
+  std::thread m_thread;
+  bool m_threadStarted = false;
+  bool m_shutdown = false;
+};
+}  // namespace output
+
+#endif  // ifndef OUTPUT_OUTPUTWRITEQUEUE_H_
@@ -0,0 +1,107 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PictureMaskCache.h"
+#include <cstring>
+#include "imageproc/GrayImage.h"
+
+namespace output {
+namespace {
+/**
+ * FNV-1a over 8-byte blocks of the gray pixel data, skipping the
+ * scan line padding whose contents are unspecified.
+ */
+uint64_t hashGrayImage(const imageproc::GrayImage& image) {
+  const uint64_t prime = UINT64_C(1099511628211);
+  uint64_t h = UINT64_C(1469598103934665603);
+
+  const int width = image.width();
+  const int height = image.height();
+  const int stride = image.stride();
+  const uint8_t* line = image.data();
+
+  for (int y = 0; y < height; ++y, line += stride) {
+    int i = 0;
+    for (; i + 8 <= width; i += 8) {
+      uint64_t block;
+      std::memcpy(&block, line + i, 8);
+      h = (h ^ block) * prime;
+    }
+    for (; i < width; ++i) {
+      h = (h ^ line[i]) * prime;
+    }
+  }
+
+  return h;
+}
+}  // namespace
+
+PictureMaskCache& PictureMaskCache::instance() {
+  static PictureMaskCache cache;
+
+  return cache;
+}
+
+PictureMaskCache::Key PictureMaskCache::makeKey(const imageproc::GrayImage& gray_source,
+                                                const QRect& source_rect,
+                                                const QRect& source_sub_rect,
+                                                const Dpi& dpi,
+                                                const PictureShapeOptions& shape_options) {
+  Key key;
+  key.image_hash = hashGrayImage(gray_source);
+  key.source_rect = source_rect;
+  key.source_sub_rect = source_sub_rect;
+  key.dpi = dpi;
+  key.shape_options = shape_options;
+
+  return key;
+}
+
+bool PictureMaskCache::lookup(const Key& key, imageproc::BinaryImage& mask) {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    if (it->first == key) {
+      mask = it->second;
+      m_entries.splice(m_entries.begin(), m_entries, it);
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void PictureMaskCache::store(const Key& key, const imageproc::BinaryImage& mask) {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    if (it->first == key) {
+      it->second = mask;
+      m_entries.splice(m_entries.begin(), m_entries, it);
+
+      return;
+    }
+  }
+
+  m_entries.emplace_front(key, mask);
+  while (m_entries.size() > MAX_ENTRIES) {
+    m_entries.pop_back();
+  }
+}
+}  // namespace output
@@ -0,0 +1,91 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OUTPUT_PICTURE_MASK_CACHE_H_
+#define OUTPUT_PICTURE_MASK_CACHE_H_
+
+#include <QRect>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <utility>
+#include "Dpi.h"
+#include "PictureShapeOptions.h"
+#include "imageproc/BinaryImage.h"
+
+namespace imageproc {
+class GrayImage;
+}
+
+namespace output {
+/**
+ * \brief A small in-memory cache of auto-detected picture masks.
+ *
+ * Picture detection is one of the most expensive sub-steps of mixed-mode
+ * rendering, yet it only depends on the normalized source image, the output
+ * geometry and the picture shape options.  Re-renders triggered by unrelated
+ * parameter changes (binarization, despeckling, fill zones) can therefore
+ * reuse the previously detected mask.
+ *
+ * The key includes a content hash of the source image, so a changed source
+ * simply misses.  Entries hold a single 1-bit image, which is cheap next to
+ * the grayscale intermediates cached elsewhere.
+ */
+class PictureMaskCache {
+ public:
+  struct Key {
+    uint64_t image_hash = 0;
+    QRect source_rect;
+    QRect source_sub_rect;
+    Dpi dpi;
+    PictureShapeOptions shape_options;
+
+    bool operator==(const Key& other) const {
+      return image_hash == other.image_hash && source_rect == other.source_rect
+             && source_sub_rect == other.source_sub_rect && dpi == other.dpi && shape_options == other.shape_options;
+    }
+  };
+
+  static PictureMaskCache& instance();
+
+  /**
+   * Builds a key from the inputs of the picture detection step.
+   * Involves hashing the image contents, which is cheap relative
+   * to the detection itself.
+   */
+  static Key makeKey(const imageproc::GrayImage& gray_source, const QRect& source_rect, const QRect& source_sub_rect,
+                     const Dpi& dpi, const PictureShapeOptions& shape_options);
+
+  /**
+   * Returns true and fills \p mask on a hit.  A hit refreshes
+   * the entry's position in the eviction order.
+   */
+  bool lookup(const Key& key, imageproc::BinaryImage& mask);
+
+  void store(const Key& key, const imageproc::BinaryImage& mask);
+
+ private:
+  PictureMaskCache() = default;
+
+  static const size_t MAX_ENTRIES = 4;
+
+  std::mutex m_mutex;
+  std::list<std::pair<Key, imageproc::BinaryImage>> m_entries;  // Most recently used in front.
+};
+}  // namespace output
+#endif  // ifndef OUTPUT_PICTURE_MASK_CACHE_H_
@@ -40,6 +40,7 @@ static const QRgb mask_color = 0xff587ff4;
 using namespace imageproc;
 
 class PictureZoneEditor::MaskTransformTask : public AbstractCommand<intrusive_ptr<AbstractCommand<void>>>,
+                                             public BackgroundExecutor::Cancellable,
                                              public QObject {
   DECLARE_NON_COPYABLE(MaskTransformTask)
 
@@ -51,7 +52,7 @@ class PictureZoneEditor::MaskTransformTask : public AbstractCommand<intrusive_pt
 
   void cancel() { m_result->cancel(); }
 
-  const bool isCancelled() const { return m_result->isCancelled(); }
+  bool isCancelled() const override { return m_result->isCancelled(); }
 
   intrusive_ptr<AbstractCommand<void>> operator()() override;
 
@@ -224,12 +225,24 @@ void PictureZoneEditor::paintOverPictureMask(QPainter& painter) {
 
   typedef PictureLayerProperty PLP;
 
+  // The cached outlines are closed and use Qt::WindingFill.  This
+  // runs on every animation frame, so the fallback should never be
+  // needed in practice.
+  const auto fill_zone = [&](const EditableZoneSet::Zone& zone) {
+    const QPainterPath* const path = m_zones.spatialIndex().outlinePath(zone.spline());
+    if (path) {
+      painter.drawPath(*path);
+    } else {
+      painter.drawPolygon(zone.spline()->toPolygon(), Qt::WindingFill);
+    }
+  };
+
   painter.setCompositionMode(QPainter::CompositionMode_Clear);
 
   // First pass: ERASER1
   for (const EditableZoneSet::Zone& zone : m_zones) {
     if (zone.properties()->locateOrDefault<PLP>()->layer() == PLP::ERASER1) {
-      painter.drawPolygon(zone.spline()->toPolygon(), Qt::WindingFill);
+      fill_zone(zone);
     }
   }
 
@@ -238,7 +251,7 @@ void PictureZoneEditor::paintOverPictureMask(QPainter& painter) {
   // Second pass: PAINTER2
   for (const EditableZoneSet::Zone& zone : m_zones) {
     if (zone.properties()->locateOrDefault<PLP>()->layer() == PLP::PAINTER2) {
-      painter.drawPolygon(zone.spline()->toPolygon(), Qt::WindingFill);
+      fill_zone(zone);
     }
   }
 
@@ -247,7 +260,7 @@ void PictureZoneEditor::paintOverPictureMask(QPainter& painter) {
   // Third pass: ERASER3
   for (const EditableZoneSet::Zone& zone : m_zones) {
     if (zone.properties()->locateOrDefault<PLP>()->layer() == PLP::ERASER3) {
-      painter.drawPolygon(zone.spline()->toPolygon(), Qt::WindingFill);
+      fill_zone(zone);
     }
   }
 }  // PictureZoneEditor::paintOverPictureMask
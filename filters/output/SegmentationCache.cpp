@@ -0,0 +1,132 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SegmentationCache.h"
+#include <algorithm>
+#include <cstring>
+#include "imageproc/BinaryImage.h"
+
+namespace output {
+namespace {
+const uint64_t kFnvPrime = UINT64_C(1099511628211);
+const uint64_t kFnvBasis = UINT64_C(1469598103934665603);
+
+/**
+ * FNV-1a over 8-byte blocks of the pixel data, skipping the scan line
+ * padding whose contents are unspecified.
+ */
+uint64_t hashImage(const QImage& image) {
+  uint64_t h = kFnvBasis;
+
+  const int bytes_per_pixel = std::max(image.depth() / 8, 1);
+  const int row_bytes = image.width() * bytes_per_pixel;
+  const int height = image.height();
+
+  for (int y = 0; y < height; ++y) {
+    const uchar* const line = image.constScanLine(y);
+    int i = 0;
+    for (; i + 8 <= row_bytes; i += 8) {
+      uint64_t block;
+      std::memcpy(&block, line + i, 8);
+      h = (h ^ block) * kFnvPrime;
+    }
+    for (; i < row_bytes; ++i) {
+      h = (h ^ line[i]) * kFnvPrime;
+    }
+  }
+
+  return h;
+}
+
+/**
+ * FNV-1a over the packed words of a binary image.  The unused bits at
+ * the end of a line are masked off, as their contents are unspecified.
+ */
+uint64_t hashBinaryImage(const imageproc::BinaryImage& image) {
+  uint64_t h = kFnvBasis;
+
+  const int width = image.width();
+  const int height = image.height();
+  const int wpl = image.wordsPerLine();
+  const int last_word_idx = (width - 1) >> 5;
+  const uint32_t last_word_mask = ~uint32_t(0) << (31 - ((width - 1) & 31));
+  const uint32_t* line = image.data();
+
+  for (int y = 0; y < height; ++y, line += wpl) {
+    for (int idx = 0; idx < last_word_idx; ++idx) {
+      h = (h ^ line[idx]) * kFnvPrime;
+    }
+    h = (h ^ (line[last_word_idx] & last_word_mask)) * kFnvPrime;
+  }
+
+  return h;
+}
+}  // namespace
+
+SegmentationCache& SegmentationCache::instance() {
+  static SegmentationCache cache;
+
+  return cache;
+}
+
+SegmentationCache::Key SegmentationCache::makeKey(const imageproc::BinaryImage& bw_image,
+                                                  const QImage& color_image,
+                                                  const Dpi& dpi,
+                                                  const BlackWhiteOptions::ColorSegmenterOptions& segmenter_options) {
+  Key key;
+  key.bw_hash = hashBinaryImage(bw_image);
+  key.color_hash = hashImage(color_image);
+  key.dpi = dpi;
+  key.segmenter_options = segmenter_options;
+
+  return key;
+}
+
+bool SegmentationCache::lookup(const Key& key, QImage& segmented) {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    if (it->first == key) {
+      segmented = it->second;
+      m_entries.splice(m_entries.begin(), m_entries, it);
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void SegmentationCache::store(const Key& key, const QImage& segmented) {
+  const std::lock_guard<std::mutex> guard(m_mutex);
+
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    if (it->first == key) {
+      it->second = segmented;
+      m_entries.splice(m_entries.begin(), m_entries, it);
+
+      return;
+    }
+  }
+
+  m_entries.emplace_front(key, segmented);
+  while (m_entries.size() > MAX_ENTRIES) {
+    m_entries.pop_back();
+  }
+}
+}  // namespace output
@@ -0,0 +1,87 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OUTPUT_SEGMENTATION_CACHE_H_
+#define OUTPUT_SEGMENTATION_CACHE_H_
+
+#include <QImage>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <utility>
+#include "BlackWhiteOptions.h"
+#include "Dpi.h"
+
+namespace imageproc {
+class BinaryImage;
+}
+
+namespace output {
+/**
+ * \brief A small in-memory cache of color-segmented foreground layers.
+ *
+ * Running ColorSegmenter over the foreground is an expensive part of
+ * mixed-mode rendering with splitting enabled.  Its output depends only
+ * on the binarized foreground, the color source, the dpi and the
+ * segmenter options, so re-renders triggered by parameter changes
+ * downstream of segmentation (posterization, splitting, despeckling)
+ * can reuse the previous result.  A changed binarization threshold
+ * changes the foreground itself and misses as it should.
+ */
+class SegmentationCache {
+ public:
+  struct Key {
+    uint64_t bw_hash = 0;
+    uint64_t color_hash = 0;
+    Dpi dpi;
+    BlackWhiteOptions::ColorSegmenterOptions segmenter_options;
+
+    bool operator==(const Key& other) const {
+      return bw_hash == other.bw_hash && color_hash == other.color_hash && dpi == other.dpi
+             && segmenter_options == other.segmenter_options;
+    }
+  };
+
+  static SegmentationCache& instance();
+
+  /**
+   * Builds a key from the inputs of the segmentation step.
+   * Involves hashing both images, which is cheap relative
+   * to the segmentation itself.
+   */
+  static Key makeKey(const imageproc::BinaryImage& bw_image, const QImage& color_image, const Dpi& dpi,
+                     const BlackWhiteOptions::ColorSegmenterOptions& segmenter_options);
+
+  /**
+   * Returns true and fills \p segmented on a hit.  A hit refreshes
+   * the entry's position in the eviction order.
+   */
+  bool lookup(const Key& key, QImage& segmented);
+
+  void store(const Key& key, const QImage& segmented);
+
+ private:
+  SegmentationCache() = default;
+
+  static const size_t MAX_ENTRIES = 2;
+
+  std::mutex m_mutex;
+  std::list<std::pair<Key, QImage>> m_entries;  // Most recently used in front.
+};
+}  // namespace output
+#endif  // ifndef OUTPUT_SEGMENTATION_CACHE_H_
@@ -24,12 +24,14 @@
 
 namespace output {
 Settings::Settings()
-    : m_defaultPictureZoneProps(initialPictureZoneProps()), m_defaultFillZoneProps(initialFillZoneProps()) {}
+    : m_defaultPictureZoneProps(initialPictureZoneProps()),
+      m_defaultFillZoneProps(initialFillZoneProps()),
+      m_draftPreviewEnabled(false) {}
 
 Settings::~Settings() = default;
 
 void Settings::clear() {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   initialPictureZoneProps().swap(m_defaultPictureZoneProps);
   initialFillZoneProps().swap(m_defaultFillZoneProps);
@@ -38,10 +40,11 @@ void Settings::clear() {
   m_perPagePictureZones.clear();
   m_perPageFillZones.clear();
   m_perPageOutputProcessingParams.clear();
+  m_dirtyPages.markAll();
 }
 
 void Settings::performRelinking(const AbstractRelinker& relinker) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   PerPageParams new_params;
   PerPageOutputParams new_output_params;
@@ -89,10 +92,11 @@ void Settings::performRelinking(const AbstractRelinker& relinker) {
   m_perPagePictureZones.swap(new_picture_zones);
   m_perPageFillZones.swap(new_fill_zones);
   m_perPageOutputProcessingParams.swap(new_output_processing_params);
+  m_dirtyPages.markAll();
 }  // Settings::performRelinking
 
 Params Settings::getParams(const PageId& page_id) const {
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   const auto it(m_perPageParams.find(page_id));
   if (it != m_perPageParams.end()) {
@@ -103,12 +107,13 @@ Params Settings::getParams(const PageId& page_id) const {
 }
 
 void Settings::setParams(const PageId& page_id, const Params& params) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
   Utils::mapSetValue(m_perPageParams, page_id, params);
+  m_dirtyPages.mark(page_id);
 }
 
 void Settings::setColorParams(const PageId& page_id, const ColorParams& prms) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   const auto it(m_perPageParams.find(page_id));
   if (it == m_perPageParams.end()) {
@@ -118,10 +123,11 @@ void Settings::setColorParams(const PageId& page_id, const ColorParams& prms) {
   } else {
     it->second.setColorParams(prms);
   }
+  m_dirtyPages.mark(page_id);
 }
 
 void Settings::setPictureShapeOptions(const PageId& page_id, PictureShapeOptions picture_shape_options) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   const auto it(m_perPageParams.find(page_id));
   if (it == m_perPageParams.end()) {
@@ -131,10 +137,11 @@ void Settings::setPictureShapeOptions(const PageId& page_id, PictureShapeOptions
   } else {
     it->second.setPictureShapeOptions(picture_shape_options);
   }
+  m_dirtyPages.mark(page_id);
 }
 
 void Settings::setDpi(const PageId& page_id, const Dpi& dpi) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   const auto it(m_perPageParams.find(page_id));
   if (it == m_perPageParams.end()) {
@@ -144,10 +151,11 @@ void Settings::setDpi(const PageId& page_id, const Dpi& dpi) {
   } else {
     it->second.setOutputDpi(dpi);
   }
+  m_dirtyPages.mark(page_id);
 }
 
 void Settings::setDewarpingOptions(const PageId& page_id, const DewarpingOptions& opt) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   const auto it(m_perPageParams.find(page_id));
   if (it == m_perPageParams.end()) {
@@ -157,10 +165,11 @@ void Settings::setDewarpingOptions(const PageId& page_id, const DewarpingOptions
   } else {
     it->second.setDewarpingOptions(opt);
   }
+  m_dirtyPages.mark(page_id);
 }
 
 void Settings::setSplittingOptions(const PageId& page_id, const SplittingOptions& opt) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   const auto it(m_perPageParams.find(page_id));
   if (it == m_perPageParams.end()) {
@@ -170,10 +179,11 @@ void Settings::setSplittingOptions(const PageId& page_id, const SplittingOptions
   } else {
     it->second.setSplittingOptions(opt);
   }
+  m_dirtyPages.mark(page_id);
 }
 
 void Settings::setDistortionModel(const PageId& page_id, const dewarping::DistortionModel& model) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   const auto it(m_perPageParams.find(page_id));
   if (it == m_perPageParams.end()) {
@@ -183,10 +193,11 @@ void Settings::setDistortionModel(const PageId& page_id, const dewarping::Distor
   } else {
     it->second.setDistortionModel(model);
   }
+  m_dirtyPages.mark(page_id);
 }
 
 void Settings::setDepthPerception(const PageId& page_id, const DepthPerception& depth_perception) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   const auto it(m_perPageParams.find(page_id));
   if (it == m_perPageParams.end()) {
@@ -196,10 +207,11 @@ void Settings::setDepthPerception(const PageId& page_id, const DepthPerception&
   } else {
     it->second.setDepthPerception(depth_perception);
   }
+  m_dirtyPages.mark(page_id);
 }
 
 void Settings::setDespeckleLevel(const PageId& page_id, double level) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   const auto it(m_perPageParams.find(page_id));
   if (it == m_perPageParams.end()) {
@@ -209,10 +221,11 @@ void Settings::setDespeckleLevel(const PageId& page_id, double level) {
   } else {
     it->second.setDespeckleLevel(level);
   }
+  m_dirtyPages.mark(page_id);
 }
 
 std::unique_ptr<OutputParams> Settings::getOutputParams(const PageId& page_id) const {
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   const auto it(m_perPageOutputParams.find(page_id));
   if (it != m_perPageOutputParams.end()) {
@@ -223,17 +236,19 @@ std::unique_ptr<OutputParams> Settings::getOutputParams(const PageId& page_id) c
 }
 
 void Settings::removeOutputParams(const PageId& page_id) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
   m_perPageOutputParams.erase(page_id);
+  m_dirtyPages.mark(page_id);
 }
 
 void Settings::setOutputParams(const PageId& page_id, const OutputParams& params) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
   Utils::mapSetValue(m_perPageOutputParams, page_id, params);
+  m_dirtyPages.mark(page_id);
 }
 
 ZoneSet Settings::pictureZonesForPage(const PageId& page_id) const {
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   const auto it(m_perPagePictureZones.find(page_id));
   if (it != m_perPagePictureZones.end()) {
@@ -244,7 +259,7 @@ ZoneSet Settings::pictureZonesForPage(const PageId& page_id) const {
 }
 
 ZoneSet Settings::fillZonesForPage(const PageId& page_id) const {
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   const auto it(m_perPageFillZones.find(page_id));
   if (it != m_perPageFillZones.end()) {
@@ -255,34 +270,36 @@ ZoneSet Settings::fillZonesForPage(const PageId& page_id) const {
 }
 
 void Settings::setPictureZones(const PageId& page_id, const ZoneSet& zones) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
   Utils::mapSetValue(m_perPagePictureZones, page_id, zones);
+  m_dirtyPages.mark(page_id);
 }
 
 void Settings::setFillZones(const PageId& page_id, const ZoneSet& zones) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
   Utils::mapSetValue(m_perPageFillZones, page_id, zones);
+  m_dirtyPages.mark(page_id);
 }
 
 PropertySet Settings::defaultPictureZoneProperties() const {
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   return m_defaultPictureZoneProps;
 }
 
 PropertySet Settings::defaultFillZoneProperties() const {
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   return m_defaultFillZoneProps;
 }
 
 void Settings::setDefaultPictureZoneProperties(const PropertySet& props) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
   m_defaultPictureZoneProps = props;
 }
 
 void Settings::setDefaultFillZoneProperties(const PropertySet& props) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
   m_defaultFillZoneProps = props;
 }
 
@@ -301,7 +318,7 @@ PropertySet Settings::initialFillZoneProps() {
 }
 
 OutputProcessingParams Settings::getOutputProcessingParams(const PageId& page_id) const {
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   const auto it(m_perPageOutputProcessingParams.find(page_id));
   if (it != m_perPageOutputProcessingParams.end()) {
@@ -313,18 +330,19 @@ OutputProcessingParams Settings::getOutputProcessingParams(const PageId& page_id
 
 void Settings::setOutputProcessingParams(const PageId& page_id,
                                          const OutputProcessingParams& output_processing_params) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
   Utils::mapSetValue(m_perPageOutputProcessingParams, page_id, output_processing_params);
+  m_dirtyPages.mark(page_id);
 }
 
 bool Settings::isParamsNull(const PageId& page_id) const {
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   return m_perPageParams.find(page_id) == m_perPageParams.end();
 }
 
 void Settings::setBlackOnWhite(const PageId& page_id, const bool black_on_white) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   const auto it(m_perPageParams.find(page_id));
   if (it == m_perPageParams.end()) {
@@ -334,5 +352,27 @@ void Settings::setBlackOnWhite(const PageId& page_id, const bool black_on_white)
   } else {
     it->second.setBlackOnWhite(black_on_white);
   }
+  m_dirtyPages.mark(page_id);
+}
+
+bool Settings::isDraftPreviewEnabled() const {
+  const QReadLocker locker(&m_rwLock);
+
+  return m_draftPreviewEnabled;
+}
+
+void Settings::setDraftPreviewEnabled(const bool enabled) {
+  const QWriteLocker locker(&m_rwLock);
+
+  m_draftPreviewEnabled = enabled;
+}
+
+DirtyPages Settings::fetchDirtyPages() {
+  const QWriteLocker locker(&m_rwLock);
+
+  DirtyPages dirty(m_dirtyPages);
+  m_dirtyPages.clear();
+
+  return dirty;
 }
 }  // namespace output
\ No newline at end of file
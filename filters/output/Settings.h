@@ -19,11 +19,12 @@
 #ifndef OUTPUT_SETTINGS_H_
 #define OUTPUT_SETTINGS_H_
 
-#include <QMutex>
+#include <QReadWriteLock>
 #include <memory>
 #include <unordered_map>
 #include "ColorParams.h"
 #include "DespeckleLevel.h"
+#include "DirtyPages.h"
 #include "DewarpingOptions.h"
 #include "Dpi.h"
 #include "NonCopyable.h"
@@ -107,6 +108,26 @@ class Settings : public ref_countable {
 
   void setBlackOnWhite(const PageId& page_id, bool black_on_white);
 
+  /**
+   * When enabled, the output stage renders previews at a reduced
+   * intermediate DPI and skips writing output files, so parameter
+   * tweaks come back quickly.  The per-page params keep their full
+   * DPI; turning the mode off re-renders at full quality.
+   * Not persisted with the project.
+   */
+  bool isDraftPreviewEnabled() const;
+
+  void setDraftPreviewEnabled(bool enabled);
+
+  /**
+   * \brief Returns the pages modified since the last call and resets
+   *        the dirty state.
+   *
+   * Used by Filter::updateSavedSettings() to rewrite only the affected
+   * per-page records of the project file.
+   */
+  DirtyPages fetchDirtyPages();
+
  private:
   typedef std::unordered_map<PageId, Params> PerPageParams;
   typedef std::unordered_map<PageId, OutputParams> PerPageOutputParams;
@@ -117,7 +138,7 @@ class Settings : public ref_countable {
 
   static PropertySet initialFillZoneProps();
 
-  mutable QMutex m_mutex;
+  mutable QReadWriteLock m_rwLock;
   PerPageParams m_perPageParams;
   PerPageOutputParams m_perPageOutputParams;
   PerPageZones m_perPagePictureZones;
@@ -125,6 +146,8 @@ class Settings : public ref_countable {
   PropertySet m_defaultPictureZoneProps;
   PropertySet m_defaultFillZoneProps;
   PerPageOutputProcessingParams m_perPageOutputProcessingParams;
+  DirtyPages m_dirtyPages;
+  bool m_draftPreviewEnabled;
 };
 }  // namespace output
 #endif  // ifndef OUTPUT_SETTINGS_H_
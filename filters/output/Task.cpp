@@ -19,8 +19,10 @@
 #include "Task.h"
 #include <UnitsProvider.h>
 #include <QDir>
+#include <QPainter>
 #include <boost/bind.hpp>
 #include <utility>
+#include "BasicImageView.h"
 #include "CommandLine.h"
 #include "DebugImages.h"
 #include "DespeckleState.h"
@@ -34,16 +36,20 @@
 #include "Filter.h"
 #include "FilterData.h"
 #include "FilterUiInterface.h"
+#include "PageTimingRegistry.h"
 #include "ImageLoader.h"
 #include "ImageView.h"
 #include "OptionsWidget.h"
 #include "OutputGenerator.h"
+#include "OutputMargins.h"
+#include "OutputWriteQueue.h"
 #include "PictureZoneComparator.h"
 #include "PictureZoneEditor.h"
 #include "RenderParams.h"
 #include "Settings.h"
 #include "TabbedImageView.h"
 #include "TaskStatus.h"
+#include "Tracer.h"
 #include "ThumbnailPixmapCache.h"
 #include "Utils.h"
 #include "dewarping/DewarpingPointMapper.h"
@@ -97,6 +103,104 @@ class Task::UiUpdater : public FilterResult {
 };
 
 
+/**
+ * Shows a coarse render of the page while the full-resolution pass is
+ * still running.  Delivered through TaskStatus::deliverIntermediateResult()
+ * and later replaced by the regular UiUpdater.
+ */
+class Task::PreviewUiUpdater : public FilterResult {
+ public:
+  PreviewUiUpdater(intrusive_ptr<Filter> filter, const QImage& preview_image)
+      : m_filter(std::move(filter)),
+        m_previewImage(preview_image),
+        m_downscaledPreviewImage(ImageView::createDownscaledImage(preview_image)) {}
+
+  void updateUI(FilterUiInterface* ui) override;
+
+  intrusive_ptr<AbstractFilter> filter() override { return m_filter; }
+
+ private:
+  intrusive_ptr<Filter> m_filter;
+  QImage m_previewImage;
+  QImage m_downscaledPreviewImage;
+};
+
+
+/**
+ * Shows the reduced-DPI, watermarked render produced in draft preview
+ * mode.  Unlike PreviewUiUpdater, this is the final result of the
+ * task, so the options widget gets updated as well.
+ */
+class Task::DraftUiUpdater : public FilterResult {
+ public:
+  DraftUiUpdater(intrusive_ptr<Filter> filter, const QImage& draft_image)
+      : m_filter(std::move(filter)),
+        m_draftImage(draft_image),
+        m_downscaledDraftImage(ImageView::createDownscaledImage(draft_image)) {}
+
+  void updateUI(FilterUiInterface* ui) override;
+
+  intrusive_ptr<AbstractFilter> filter() override { return m_filter; }
+
+ private:
+  intrusive_ptr<Filter> m_filter;
+  QImage m_draftImage;
+  QImage m_downscaledDraftImage;
+};
+
+
+/**
+ * Reports an untouched, up-to-date page during batch output.  The
+ * stored records already proved the files on disk match the current
+ * params, so no images were decoded and there's nothing to show
+ * beyond refreshing the thumbnail.
+ */
+class Task::BatchFreshUiUpdater : public FilterResult {
+ public:
+  BatchFreshUiUpdater(intrusive_ptr<Filter> filter, const PageId& page_id)
+      : m_filter(std::move(filter)), m_pageId(page_id) {}
+
+  void updateUI(FilterUiInterface* ui) override;
+
+  intrusive_ptr<AbstractFilter> filter() override { return m_filter; }
+
+ private:
+  intrusive_ptr<Filter> m_filter;
+  PageId m_pageId;
+};
+
+
+namespace {
+/**
+ * Stamps a translucent "DRAFT" across the image, so a reduced-DPI
+ * render can't be mistaken for the real output.
+ */
+void watermarkDraft(QImage& image) {
+  if (image.isNull()) {
+    return;
+  }
+  if ((image.format() != QImage::Format_RGB32) && (image.format() != QImage::Format_ARGB32)) {
+    image = image.convertToFormat(QImage::Format_RGB32);
+  }
+
+  QPainter painter(&image);
+  painter.setRenderHint(QPainter::Antialiasing);
+  painter.setRenderHint(QPainter::TextAntialiasing);
+  painter.setPen(QColor(255, 0, 0, 80));
+
+  QFont font(painter.font());
+  font.setBold(true);
+  font.setPixelSize(std::max(20, image.width() / 6));
+  painter.setFont(font);
+
+  painter.translate(QRectF(image.rect()).center());
+  painter.rotate(-45.0);
+  painter.drawText(QRectF(-image.width(), -image.height(), image.width() * 2.0, image.height() * 2.0), Qt::AlignCenter,
+                   QLatin1String("DRAFT"));
+}
+}  // namespace
+
+
 Task::Task(intrusive_ptr<Filter> filter,
            intrusive_ptr<Settings> settings,
            intrusive_ptr<ThumbnailPixmapCache> thumbnail_cache,
@@ -121,11 +225,23 @@ Task::Task(intrusive_ptr<Filter> filter,
 Task::~Task() = default;
 
 FilterResultPtr Task::process(const TaskStatus& status, const FilterData& data, const QPolygonF& content_rect_phys) {
+  TRACE_SCOPE("output: process");
+  const PageTimingRegistry::StageScope timing_scope(m_pageId, "output");
+
   status.throwIfCancelled();
 
   Params params(m_settings->getParams(m_pageId));
 
   RenderParams render_params(params.colorParams(), params.splittingOptions());
+
+  if (!m_batchProcessing && CommandLine::get().isGui() && m_settings->isDraftPreviewEnabled()) {
+    // Draft mode renders this page at a reduced DPI and touches
+    // neither the output files nor the stored output params, so
+    // switching it off (or batch processing) redoes the page at
+    // full quality as if the draft render never happened.
+    return processDraftPreview(status, data, content_rect_phys, params, render_params);
+  }
+
   const QString out_file_path(m_outFileNameGen.filePathFor(m_pageId));
   const QFileInfo out_file_info(out_file_path);
 
@@ -262,6 +378,20 @@ FilterResultPtr Task::process(const TaskStatus& status, const FilterData& data,
     }
   } while (false);
 
+  if (!need_reprocess && m_batchProcessing) {
+    // The stored records say the files on disk were produced from
+    // exactly these params and haven't been touched since.  In batch
+    // mode nothing is displayed beyond the thumbnail, so there's no
+    // point decoding the full-resolution images just to throw them
+    // away.  Re-outputting a book where only a few pages changed then
+    // costs a stat() per unchanged page instead of a TIFF decode.
+    if (CommandLine::get().isGui()) {
+      return make_intrusive<BatchFreshUiUpdater>(m_filter, m_pageId);
+    }
+
+    return nullptr;
+  }
+
   QImage out_img;
   BinaryImage automask_img;
   BinaryImage speckles_img;
@@ -330,10 +460,63 @@ FilterResultPtr Task::process(const TaskStatus& status, const FilterData& data,
     speckles_img = BinaryImage();
 
     // OutputGenerator will write a new distortion model
-    // there, if dewarping mode is AUTO.
+    // there, if dewarping mode is AUTO and we don't provide one.
     DistortionModel distortion_model;
     if (params.dewarpingOptions().dewarpingMode() == MANUAL) {
       distortion_model = params.distortionModel();
+    } else if ((params.dewarpingOptions().dewarpingMode() == AUTO) && params.distortionModel().isValid()) {
+      // Reuse the model fitted on a previous run if everything it was
+      // built from is unchanged.  Toggling binarization-stage settings
+      // such as despeckling then skips re-running the text line tracers.
+      const std::unique_ptr<OutputParams> stored_output_params(m_settings->getOutputParams(m_pageId));
+      if (stored_output_params
+          && stored_output_params->outputImageParams().matchesDistortionModelInputs(new_output_image_params)) {
+        distortion_model = params.distortionModel();
+      }
+    }
+
+    if (!m_batchProcessing && CommandLine::get().isGui()) {
+      // Get a coarse render on screen while the full-resolution pass
+      // below is still running.  A quarter of the output DPI means
+      // roughly 1/16 of the pixels to process, which makes the preview
+      // nearly instant even when dewarping is enabled.
+      const Dpi preview_dpi(std::max(72, params.outputDpi().horizontal() / 4),
+                            std::max(72, params.outputDpi().vertical() / 4));
+      if ((preview_dpi.horizontal() < params.outputDpi().horizontal())
+          && (preview_dpi.vertical() < params.outputDpi().vertical())) {
+        // The generator stores auto-detected picture zones and processing
+        // flags back into settings.  Snapshot them, so that the preview
+        // pass leaves no trace and the full pass behaves exactly as it
+        // would without one.
+        const ZoneSet saved_picture_zones(m_settings->pictureZonesForPage(m_pageId));
+        const OutputProcessingParams saved_processing_params(m_settings->getOutputProcessingParams(m_pageId));
+
+        ImageTransformation preview_xform(data.xform());
+        preview_xform.postScaleToDpi(preview_dpi);
+
+        OutputGenerator preview_generator(preview_dpi, params.colorParams(), params.splittingOptions(),
+                                          params.pictureShapeOptions(), params.dewarpingOptions(),
+                                          saved_processing_params, params.despeckleLevel(), preview_xform,
+                                          content_rect_phys);
+
+        ZoneSet preview_picture_zones(new_picture_zones);
+        DistortionModel preview_distortion_model(distortion_model);
+        SplitImage preview_split_image;
+        QImage preview_img = preview_generator.process(status, data, preview_picture_zones, new_fill_zones,
+                                                       preview_distortion_model, params.depthPerception(), nullptr,
+                                                       nullptr, nullptr, m_pageId, m_settings, &preview_split_image);
+        if (render_params.splitOutput()) {
+          preview_img = preview_split_image.toImage();
+        }
+
+        m_settings->setPictureZones(m_pageId, saved_picture_zones);
+        m_settings->setOutputProcessingParams(m_pageId, saved_processing_params);
+
+        status.throwIfCancelled();
+        if (!preview_img.isNull()) {
+          status.deliverIntermediateResult(make_intrusive<PreviewUiUpdater>(m_filter, preview_img));
+        }
+      }
     }
 
     SplitImage splitImage;
@@ -356,37 +539,8 @@ FilterResultPtr Task::process(const TaskStatus& status, const FilterData& data,
     new_output_image_params.setBlackOnWhite(m_settings->getParams(m_pageId).isBlackOnWhite());
     new_output_image_params.setOutputProcessingParams(m_settings->getOutputProcessingParams(m_pageId));
 
-    bool invalidate_params = false;
-
     if (render_params.splitOutput()) {
-      QDir().mkdir(foreground_dir);
-      QDir().mkdir(background_dir);
-
-      if (!TiffWriter::writeImage(foreground_file_path, splitImage.getForegroundImage())
-          || !TiffWriter::writeImage(background_file_path, splitImage.getBackgroundImage())) {
-        invalidate_params = true;
-      }
-
-      if (render_params.originalBackground()) {
-        QDir().mkdir(original_background_dir);
-
-        if (!TiffWriter::writeImage(original_background_file_path, splitImage.getOriginalBackgroundImage())) {
-          invalidate_params = true;
-        }
-      }
-
       out_img = splitImage.toImage();
-      splitImage = SplitImage();
-    } else {
-      // Remove layers if the mode was changed.
-      QFile(foreground_file_path).remove();
-      QFile(background_file_path).remove();
-      QFile(original_background_file_path).remove();
-    }
-    if (!TiffWriter::writeImage(out_file_path, out_img)) {
-      invalidate_params = true;
-    } else {
-      deleteMutuallyExclusiveOutputFiles();
     }
 
     if (write_speckles_file && speckles_img.isNull()) {
@@ -396,45 +550,94 @@ FilterResultPtr Task::process(const TaskStatus& status, const FilterData& data,
       BinaryImage(out_img.size(), WHITE).swap(speckles_img);
     }
 
-    if (write_automask) {
-      // Note that QDir::mkdir() will fail if the parent directory,
-      // that is $OUT/cache doesn't exist. We want that behaviour,
-      // as otherwise when loading a project from a different machine,
-      // a whole bunch of bogus directories would be created.
-      QDir().mkdir(automask_dir);
-      // Also note that QDir::mkdir() will fail if the directory already exists,
-      // so we ignore its return value here.
-      if (!TiffWriter::writeImage(automask_file_path, automask_img.toQImage())) {
-        invalidate_params = true;
+    // The disk writes are handed to a dedicated I/O thread, so this
+    // worker can move on to the next page instead of blocking on the
+    // disk.  The jobs run in enqueue order, and each one commits its
+    // page's records only after all of its files have landed, so a
+    // later run never sees records describing files that aren't there.
+    // Keeping a reference to this task keeps everything the job uses
+    // alive until it has run.
+    const intrusive_ptr<Task> task(this);
+    const auto write_job = [=]() {
+      bool invalidate_params = false;
+
+      if (render_params.splitOutput()) {
+        QDir().mkdir(foreground_dir);
+        QDir().mkdir(background_dir);
+
+        if (!TiffWriter::writeImageAtomically(foreground_file_path, splitImage.getForegroundImage())
+            || !TiffWriter::writeImageAtomically(background_file_path, splitImage.getBackgroundImage())) {
+          invalidate_params = true;
+        }
+
+        if (render_params.originalBackground()) {
+          QDir().mkdir(original_background_dir);
+
+          if (!TiffWriter::writeImageAtomically(original_background_file_path,
+                                                splitImage.getOriginalBackgroundImage())) {
+            invalidate_params = true;
+          }
+        }
+      } else {
+        // Remove layers if the mode was changed.
+        QFile(foreground_file_path).remove();
+        QFile(background_file_path).remove();
+        QFile(original_background_file_path).remove();
       }
-    }
-    if (write_speckles_file) {
-      if (!QDir().mkpath(speckles_dir)) {
-        invalidate_params = true;
-      } else if (!TiffWriter::writeImage(speckles_file_path, speckles_img.toQImage())) {
+      if (!TiffWriter::writeImageAtomically(out_file_path, out_img)) {
         invalidate_params = true;
+      } else {
+        task->deleteMutuallyExclusiveOutputFiles();
       }
-    }
 
-    if (invalidate_params) {
-      m_settings->removeOutputParams(m_pageId);
-    } else {
-      // Note that we can't reuse *_file_info objects
-      // as we've just overwritten those files.
-      const OutputParams out_params(
-          new_output_image_params, OutputFileParams(QFileInfo(out_file_path)),
-          render_params.splitOutput() ? OutputFileParams(QFileInfo(foreground_file_path)) : OutputFileParams(),
-          render_params.splitOutput() ? OutputFileParams(QFileInfo(background_file_path)) : OutputFileParams(),
-          render_params.originalBackground() ? OutputFileParams(QFileInfo(original_background_file_path))
-                                             : OutputFileParams(),
-          write_automask ? OutputFileParams(QFileInfo(automask_file_path)) : OutputFileParams(),
-          write_speckles_file ? OutputFileParams(QFileInfo(speckles_file_path)) : OutputFileParams(), new_picture_zones,
-          new_fill_zones);
-
-      m_settings->setOutputParams(m_pageId, out_params);
-    }
+      if (write_automask) {
+        // Note that QDir::mkdir() will fail if the parent directory,
+        // that is $OUT/cache doesn't exist. We want that behaviour,
+        // as otherwise when loading a project from a different machine,
+        // a whole bunch of bogus directories would be created.
+        QDir().mkdir(automask_dir);
+        // Also note that QDir::mkdir() will fail if the directory already exists,
+        // so we ignore its return value here.
+        if (!TiffWriter::writeImageAtomically(automask_file_path, automask_img.toQImage())) {
+          invalidate_params = true;
+        }
+      }
+      if (write_speckles_file) {
+        if (!QDir().mkpath(speckles_dir)) {
+          invalidate_params = true;
+        } else if (!TiffWriter::writeImageAtomically(speckles_file_path, speckles_img.toQImage())) {
+          invalidate_params = true;
+        }
+      }
+
+      if (invalidate_params) {
+        task->m_settings->removeOutputParams(task->m_pageId);
+      } else {
+        // Note that we can't reuse *_file_info objects
+        // as we've just overwritten those files.
+        const OutputParams out_params(
+            new_output_image_params, OutputFileParams(QFileInfo(out_file_path)),
+            render_params.splitOutput() ? OutputFileParams(QFileInfo(foreground_file_path)) : OutputFileParams(),
+            render_params.splitOutput() ? OutputFileParams(QFileInfo(background_file_path)) : OutputFileParams(),
+            render_params.originalBackground() ? OutputFileParams(QFileInfo(original_background_file_path))
+                                               : OutputFileParams(),
+            write_automask ? OutputFileParams(QFileInfo(automask_file_path)) : OutputFileParams(),
+            write_speckles_file ? OutputFileParams(QFileInfo(speckles_file_path)) : OutputFileParams(),
+            new_picture_zones, new_fill_zones);
+
+        task->m_settings->setOutputParams(task->m_pageId, out_params);
+      }
+
+      task->m_thumbnailCache->recreateThumbnail(ImageId(out_file_path), out_img);
+    };
 
-    m_thumbnailCache->recreateThumbnail(ImageId(out_file_path), out_img);
+    // An estimate of the image data the job pins until it has run.
+    size_t pending_bytes = static_cast<size_t>(out_img.bytesPerLine()) * out_img.height();
+    if (render_params.splitOutput()) {
+      // The split layers roughly double it.
+      pending_bytes *= 2;
+    }
+    OutputWriteQueue::instance().enqueue(write_job, pending_bytes);
   }
 
   const DespeckleState despeckle_state(out_img, speckles_img, params.despeckleLevel(), params.outputDpi());
@@ -457,6 +660,56 @@ FilterResultPtr Task::process(const TaskStatus& status, const FilterData& data,
   }
 }  // Task::process
 
+FilterResultPtr Task::processDraftPreview(const TaskStatus& status,
+                                          const FilterData& data,
+                                          const QPolygonF& content_rect_phys,
+                                          const Params& params,
+                                          const RenderParams& render_params) {
+  // A quarter of the output DPI means roughly 1/16 of the pixels
+  // to process.  The params keep their full DPI.
+  const Dpi draft_dpi(std::max(72, params.outputDpi().horizontal() / 4),
+                      std::max(72, params.outputDpi().vertical() / 4));
+
+  ImageTransformation draft_xform(data.xform());
+  draft_xform.postScaleToDpi(draft_dpi);
+
+  // The generator stores auto-detected picture zones and processing
+  // flags back into settings.  Snapshot them, so that the draft pass
+  // leaves no trace in the stored full-DPI state.
+  const ZoneSet saved_picture_zones(m_settings->pictureZonesForPage(m_pageId));
+  const OutputProcessingParams saved_processing_params(m_settings->getOutputProcessingParams(m_pageId));
+
+  OutputGenerator generator(draft_dpi, params.colorParams(), params.splittingOptions(), params.pictureShapeOptions(),
+                            params.dewarpingOptions(), saved_processing_params, params.despeckleLevel(), draft_xform,
+                            content_rect_phys);
+
+  ZoneSet picture_zones(saved_picture_zones);
+  const ZoneSet fill_zones(m_settings->fillZonesForPage(m_pageId));
+
+  DistortionModel distortion_model;
+  if ((params.dewarpingOptions().dewarpingMode() == MANUAL)
+      || ((params.dewarpingOptions().dewarpingMode() == AUTO) && params.distortionModel().isValid())) {
+    distortion_model = params.distortionModel();
+  }
+
+  SplitImage split_image;
+  QImage draft_img
+      = generator.process(status, data, picture_zones, fill_zones, distortion_model, params.depthPerception(), nullptr,
+                          nullptr, m_dbg.get(), m_pageId, m_settings, &split_image);
+  if (render_params.splitOutput()) {
+    draft_img = split_image.toImage();
+  }
+
+  m_settings->setPictureZones(m_pageId, saved_picture_zones);
+  m_settings->setOutputProcessingParams(m_pageId, saved_processing_params);
+
+  status.throwIfCancelled();
+
+  watermarkDraft(draft_img);
+
+  return make_intrusive<DraftUiUpdater>(m_filter, draft_img);
+}  // Task::processDraftPreview
+
 /**
  * Delete output files mutually exclusive to m_pageId.
  */
@@ -601,4 +854,35 @@ void Task::UiUpdater::updateUI(FilterUiInterface* ui) {
 
   ui->setImageWidget(tab_widget.release(), ui->TRANSFER_OWNERSHIP, m_dbg.get());
 }  // Task::UiUpdater::updateUI
-}  // namespace output
\ No newline at end of file
+
+/*======================== Task::PreviewUiUpdater ========================*/
+
+void Task::PreviewUiUpdater::updateUI(FilterUiInterface* ui) {
+  // This function is executed from the GUI thread.
+  ui->setImageWidget(new BasicImageView(m_previewImage, m_downscaledPreviewImage, OutputMargins()),
+                     ui->TRANSFER_OWNERSHIP);
+}
+
+/*======================= Task::BatchFreshUiUpdater ======================*/
+
+void Task::BatchFreshUiUpdater::updateUI(FilterUiInterface* ui) {
+  // This function is executed from the GUI thread.
+  OptionsWidget* const opt_widget = m_filter->optionsWidget();
+  opt_widget->postUpdateUI();
+  ui->setOptionsWidget(opt_widget, ui->KEEP_OWNERSHIP);
+
+  ui->invalidateThumbnail(m_pageId);
+}
+
+/*========================= Task::DraftUiUpdater =========================*/
+
+void Task::DraftUiUpdater::updateUI(FilterUiInterface* ui) {
+  // This function is executed from the GUI thread.
+  OptionsWidget* const opt_widget = m_filter->optionsWidget();
+  opt_widget->postUpdateUI();
+  ui->setOptionsWidget(opt_widget, ui->KEEP_OWNERSHIP);
+
+  ui->setImageWidget(new BasicImageView(m_draftImage, m_downscaledDraftImage, OutputMargins()),
+                     ui->TRANSFER_OWNERSHIP);
+}
+}  // namespace output
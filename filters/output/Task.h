@@ -45,6 +45,8 @@ class BinaryImage;
 
 namespace output {
 class Filter;
+class Params;
+class RenderParams;
 class Settings;
 
 class Task : public ref_countable {
@@ -66,6 +68,15 @@ class Task : public ref_countable {
 
  private:
   class UiUpdater;
+  class PreviewUiUpdater;
+  class DraftUiUpdater;
+  class BatchFreshUiUpdater;
+
+  FilterResultPtr processDraftPreview(const TaskStatus& status,
+                                      const FilterData& data,
+                                      const QPolygonF& content_rect_phys,
+                                      const Params& params,
+                                      const RenderParams& render_params);
 
   void deleteMutuallyExclusiveOutputFiles();
 
@@ -0,0 +1,89 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ZoneMaskCache.h"
+#include "ZoneSet.h"
+
+namespace output {
+ZoneMaskCache& ZoneMaskCache::instance() {
+  static ZoneMaskCache cache;
+
+  return cache;
+}
+
+ZoneMaskCache::Key ZoneMaskCache::makeKey(const ZoneSet& zones, const QTransform& xform, const QRect& target_rect) {
+  Key key;
+  key.zone_revision = zones.revision();
+  key.xform = xform;
+  key.target_rect = target_rect;
+
+  return key;
+}
+
+template <typename Layers>
+bool ZoneMaskCache::lookupImpl(std::list<std::pair<Key, Layers>>& entries, const Key& key, Layers& layers) {
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    if (it->first == key) {
+      layers = it->second;
+      entries.splice(entries.begin(), entries, it);
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+template <typename Layers>
+void ZoneMaskCache::storeImpl(std::list<std::pair<Key, Layers>>& entries, const Key& key, const Layers& layers) {
+  for (const auto& entry : entries) {
+    if (entry.first == key) {
+      return;
+    }
+  }
+
+  entries.emplace_front(key, layers);
+  while (entries.size() > MAX_ENTRIES) {
+    entries.pop_back();
+  }
+}
+
+bool ZoneMaskCache::lookupPictureLayers(const Key& key, PictureLayers& layers) {
+  const std::lock_guard<std::mutex> lock(m_mutex);
+
+  return lookupImpl(m_pictureEntries, key, layers);
+}
+
+void ZoneMaskCache::storePictureLayers(const Key& key, const PictureLayers& layers) {
+  const std::lock_guard<std::mutex> lock(m_mutex);
+
+  storeImpl(m_pictureEntries, key, layers);
+}
+
+bool ZoneMaskCache::lookupFillLayers(const Key& key, FillLayers& layers) {
+  const std::lock_guard<std::mutex> lock(m_mutex);
+
+  return lookupImpl(m_fillEntries, key, layers);
+}
+
+void ZoneMaskCache::storeFillLayers(const Key& key, const FillLayers& layers) {
+  const std::lock_guard<std::mutex> lock(m_mutex);
+
+  storeImpl(m_fillEntries, key, layers);
+}
+}  // namespace output
@@ -0,0 +1,109 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OUTPUT_ZONE_MASK_CACHE_H_
+#define OUTPUT_ZONE_MASK_CACHE_H_
+
+#include <QRect>
+#include <QRgb>
+#include <QTransform>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "imageproc/RleMask.h"
+
+class ZoneSet;
+
+namespace output {
+/**
+ * \brief A small in-memory cache of rasterized zone masks.
+ *
+ * Rendering a page rasterizes its picture and fill zones afresh every
+ * time, even though the zones only change when the user edits them.
+ * When only non-zone parameters change (binarization options being the
+ * typical interactive case), the rasterization from the previous render
+ * is still valid, so this cache keeps it around.
+ *
+ * Entries are keyed by the ZoneSet revision together with the transform
+ * and target rectangle the zones were rasterized under, so an edited
+ * zone set or a changed output geometry simply misses.  The masks are
+ * run-length encoded, which makes an entry for a typical page a few
+ * kilobytes; capacity is still kept tiny because interactive tweaking
+ * touches one page at a time.
+ */
+class ZoneMaskCache {
+ public:
+  struct Key {
+    uint64_t zone_revision = 0;
+    QTransform xform;
+    QRect target_rect;
+
+    bool operator==(const Key& other) const {
+      return zone_revision == other.zone_revision && xform == other.xform && target_rect == other.target_rect;
+    }
+  };
+
+  /** The three picture zone layers of modifyBinarizationMask(). */
+  struct PictureLayers {
+    imageproc::RleMask eraser1;
+    imageproc::RleMask painter2;
+    imageproc::RleMask eraser3;
+  };
+
+  /**
+   * One mask per fill zone, in application order, with the zone's
+   * fill color.  Kept per zone rather than merged so that overlapping
+   * zones of different colors replay in the right order.
+   */
+  typedef std::vector<std::pair<imageproc::RleMask, QRgb>> FillLayers;
+
+  static ZoneMaskCache& instance();
+
+  static Key makeKey(const ZoneSet& zones, const QTransform& xform, const QRect& target_rect);
+
+  /**
+   * Returns true and fills \p layers on a hit.  A hit refreshes
+   * the entry's position in the eviction order.
+   */
+  bool lookupPictureLayers(const Key& key, PictureLayers& layers);
+
+  void storePictureLayers(const Key& key, const PictureLayers& layers);
+
+  bool lookupFillLayers(const Key& key, FillLayers& layers);
+
+  void storeFillLayers(const Key& key, const FillLayers& layers);
+
+ private:
+  ZoneMaskCache() = default;
+
+  static const size_t MAX_ENTRIES = 4;
+
+  template <typename Layers>
+  static bool lookupImpl(std::list<std::pair<Key, Layers>>& entries, const Key& key, Layers& layers);
+
+  template <typename Layers>
+  static void storeImpl(std::list<std::pair<Key, Layers>>& entries, const Key& key, const Layers& layers);
+
+  std::mutex m_mutex;
+  std::list<std::pair<Key, PictureLayers>> m_pictureEntries;  // Most recently used in front.
+  std::list<std::pair<Key, FillLayers>> m_fillEntries;
+};
+}  // namespace output
+#endif  // ifndef OUTPUT_ZONE_MASK_CACHE_H_
@@ -25,9 +25,11 @@
 #include <filters/output/Task.h>
 #include <boost/lambda/bind.hpp>
 #include <boost/lambda/lambda.hpp>
+#include <unordered_map>
 #include <utility>
 #include "CacheDrivenTask.h"
 #include "CommandLine.h"
+#include "DirtyPages.h"
 #include "FilterUiInterface.h"
 #include "OptionsWidget.h"
 #include "OrderByHeightProvider.h"
@@ -42,11 +44,10 @@
 
 namespace page_layout {
 Filter::Filter(intrusive_ptr<ProjectPages> pages, const PageSelectionAccessor& page_selection_accessor)
-    : m_pages(std::move(pages)), m_settings(new Settings), m_selectedPageOrder(0) {
-  if (CommandLine::get().isGui()) {
-    m_optionsWidget.reset(new OptionsWidget(m_settings, page_selection_accessor));
-  }
-
+    : m_pages(std::move(pages)),
+      m_settings(new Settings),
+      m_pageSelectionAccessor(page_selection_accessor),
+      m_selectedPageOrder(0) {
   const PageOrderOption::ProviderPtr default_order;
   const auto order_by_width = make_intrusive<OrderByWidthProvider>(m_settings);
   const auto order_by_height = make_intrusive<OrderByHeightProvider>(m_settings);
@@ -91,8 +92,9 @@ void Filter::performRelinking(const AbstractRelinker& relinker) {
 void Filter::preUpdateUI(FilterUiInterface* ui, const PageInfo& page_info) {
   const Margins margins_mm(m_settings->getHardMarginsMM(page_info.id()));
   const Alignment alignment(m_settings->getPageAlignment(page_info.id()));
-  m_optionsWidget->preUpdateUI(page_info, margins_mm, alignment);
-  ui->setOptionsWidget(m_optionsWidget.get(), ui->KEEP_OWNERSHIP);
+  OptionsWidget* const options_widget = optionsWidget();
+  options_widget->preUpdateUI(page_info, margins_mm, alignment);
+  ui->setOptionsWidget(options_widget, ui->KEEP_OWNERSHIP);
 }
 
 QDomElement Filter::saveSettings(const ProjectWriter& writer, QDomDocument& doc) const {
@@ -114,6 +116,53 @@ QDomElement Filter::saveSettings(const ProjectWriter& writer, QDomDocument& doc)
   return filter_el;
 }
 
+bool Filter::updateSavedSettings(const ProjectWriter& writer, QDomDocument& doc, QDomElement& filter_el) {
+  const DirtyPages dirty(m_settings->fetchDirtyPages());
+  if (dirty.allDirty()) {
+    return false;
+  }
+
+  // The globals are not covered by per-page dirty tracking
+  // and are cheap enough to rewrite every time.
+  filter_el.setAttribute("showMiddleRect", m_settings->isShowingMiddleRectEnabled() ? "1" : "0");
+
+  const QDomElement old_guides_el(filter_el.namedItem("guides").toElement());
+  if (!old_guides_el.isNull()) {
+    filter_el.removeChild(old_guides_el);
+  }
+  if (!m_settings->guides().empty()) {
+    QDomElement guides_el(doc.createElement("guides"));
+    for (const Guide& guide : m_settings->guides()) {
+      guides_el.appendChild(guide.toXml(doc, "guide"));
+    }
+    filter_el.appendChild(guides_el);
+  }
+
+  // Index the existing records, so that stale ones can be located
+  // without rescanning the element for every dirty page.
+  std::unordered_map<int, QDomElement> page_els;
+  for (QDomNode node = filter_el.firstChild(); !node.isNull(); node = node.nextSibling()) {
+    if (node.isElement() && (node.nodeName() == "page")) {
+      page_els[node.toElement().attribute("id").toInt()] = node.toElement();
+    }
+  }
+
+  writer.enumPages([&](const PageId& page_id, int numeric_id) {
+    if (dirty.pages().find(page_id) == dirty.pages().end()) {
+      return;
+    }
+    const auto it(page_els.find(numeric_id));
+    if (it != page_els.end()) {
+      filter_el.removeChild(it->second);
+    }
+    // Appends nothing for pages without parameters, which makes
+    // a plain removal the right thing for them.
+    this->writePageSettings(doc, filter_el, page_id, numeric_id);
+  });
+
+  return true;
+}
+
 void Filter::writePageSettings(QDomDocument& doc, QDomElement& filter_el, const PageId& page_id, int numeric_id) const {
   const std::unique_ptr<Params> params(m_settings->getPageParams(page_id));
   if (!params) {
@@ -226,6 +275,10 @@ void Filter::loadDefaultSettings(const PageInfo& page_info) {
 }
 
 OptionsWidget* Filter::optionsWidget() {
+  if (!m_optionsWidget.get() && CommandLine::get().isGui()) {
+    m_optionsWidget.reset(new OptionsWidget(m_settings, m_pageSelectionAccessor));
+  }
+
   return m_optionsWidget.get();
 }
 }  // namespace page_layout
\ No newline at end of file
@@ -25,12 +25,12 @@
 #include "FilterResult.h"
 #include "NonCopyable.h"
 #include "PageOrderOption.h"
+#include "PageSelectionAccessor.h"
 #include "PageView.h"
 #include "SafeDeletingQObjectPtr.h"
 #include "intrusive_ptr.h"
 
 class ProjectPages;
-class PageSelectionAccessor;
 class ImageTransformation;
 class QString;
 class QRectF;
@@ -73,6 +73,8 @@ class Filter : public AbstractFilter {
 
   QDomElement saveSettings(const ProjectWriter& writer, QDomDocument& doc) const override;
 
+  bool updateSavedSettings(const ProjectWriter& writer, QDomDocument& doc, QDomElement& filter_el) override;
+
   void loadSettings(const ProjectReader& reader, const QDomElement& filters_el) override;
 
   void loadDefaultSettings(const PageInfo& page_info) override;
@@ -94,6 +96,7 @@ class Filter : public AbstractFilter {
 
   intrusive_ptr<ProjectPages> m_pages;
   intrusive_ptr<Settings> m_settings;
+  PageSelectionAccessor m_pageSelectionAccessor;
   SafeDeletingQObjectPtr<OptionsWidget> m_optionsWidget;
   std::vector<PageOrderOption> m_pageOrderOptions;
   int m_selectedPageOrder;
@@ -344,6 +344,8 @@ void OptionsWidget::applyMargins(const std::set<PageId>& pages) {
     return;
   }
 
+  const QSizeF agg_size_before(m_settings->getAggregateHardSizeMM());
+
   const bool autoMarginsEnabled = m_settings->isPageAutoMarginsEnabled(m_pageId);
   for (const PageId& page_id : pages) {
     if (page_id == m_pageId) {
@@ -359,7 +361,15 @@ void OptionsWidget::applyMargins(const std::set<PageId>& pages) {
   }
 
   emit aggregateHardSizeChanged();
-  emit invalidateAllThumbnails();
+  if (m_settings->getAggregateHardSizeMM() == agg_size_before) {
+    // The widest and tallest pages are still the same, so the
+    // alignment of the untouched pages didn't move.
+    for (const PageId& page_id : pages) {
+      emit invalidateThumbnail(page_id);
+    }
+  } else {
+    emit invalidateAllThumbnails();
+  }
 }
 
 void OptionsWidget::applyAlignment(const std::set<PageId>& pages) {
@@ -367,15 +377,24 @@ void OptionsWidget::applyAlignment(const std::set<PageId>& pages) {
     return;
   }
 
+  bool agg_size_changed = false;
   for (const PageId& page_id : pages) {
     if (page_id == m_pageId) {
       continue;
     }
 
-    m_settings->setPageAlignment(page_id, m_alignment);
+    if (m_settings->setPageAlignment(page_id, m_alignment) == Settings::AGGREGATE_SIZE_CHANGED) {
+      agg_size_changed = true;
+    }
   }
 
-  emit invalidateAllThumbnails();
+  if (agg_size_changed) {
+    emit invalidateAllThumbnails();
+  } else {
+    for (const PageId& page_id : pages) {
+      emit invalidateThumbnail(page_id);
+    }
+  }
 }
 
 void OptionsWidget::updateMarginsDisplay() {
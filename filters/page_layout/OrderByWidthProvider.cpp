@@ -28,21 +28,8 @@ bool OrderByWidthProvider::precedes(const PageId& lhs_page,
                                     const bool lhs_incomplete,
                                     const PageId& rhs_page,
                                     const bool rhs_incomplete) const {
-  const std::unique_ptr<Params> lhs_params(m_settings->getPageParams(lhs_page));
-  const std::unique_ptr<Params> rhs_params(m_settings->getPageParams(rhs_page));
-
-  QSizeF lhs_size;
-  if (lhs_params) {
-    const Margins margins(lhs_params->hardMarginsMM());
-    lhs_size = lhs_params->contentSizeMM();
-    lhs_size += QSizeF(margins.left() + margins.right(), margins.top() + margins.bottom());
-  }
-  QSizeF rhs_size;
-  if (rhs_params) {
-    const Margins margins(rhs_params->hardMarginsMM());
-    rhs_size = rhs_params->contentSizeMM();
-    rhs_size += QSizeF(margins.left() + margins.right(), margins.top() + margins.bottom());
-  }
+  const QSizeF lhs_size(pageSize(lhs_page));
+  const QSizeF rhs_size(pageSize(rhs_page));
 
   const bool lhs_valid = !lhs_incomplete && lhs_size.isValid();
   const bool rhs_valid = !rhs_incomplete && rhs_size.isValid();
@@ -54,4 +41,26 @@ bool OrderByWidthProvider::precedes(const PageId& lhs_page,
 
   return lhs_size.width() < rhs_size.width();
 }  // OrderByWidthProvider::precedes
+
+void OrderByWidthProvider::invalidateCachedKeys() const {
+  m_cachedSizes.clear();
+}
+
+QSizeF OrderByWidthProvider::pageSize(const PageId& page) const {
+  const auto it(m_cachedSizes.find(page));
+  if (it != m_cachedSizes.end()) {
+    return it->second;
+  }
+
+  QSizeF size;
+  const std::unique_ptr<Params> params(m_settings->getPageParams(page));
+  if (params) {
+    const Margins margins(params->hardMarginsMM());
+    size = params->contentSizeMM();
+    size += QSizeF(margins.left() + margins.right(), margins.top() + margins.bottom());
+  }
+  m_cachedSizes.insert(std::make_pair(page, size));
+
+  return size;
+}
 }  // namespace page_layout
\ No newline at end of file
@@ -19,6 +19,8 @@
 #ifndef PAGE_LAYOUT_ORDER_BY_WIDTH_PROVIDER_H_
 #define PAGE_LAYOUT_ORDER_BY_WIDTH_PROVIDER_H_
 
+#include <QSizeF>
+#include "FlatHashMap.h"
 #include "PageOrderProvider.h"
 #include "Settings.h"
 #include "intrusive_ptr.h"
@@ -33,8 +35,13 @@ class OrderByWidthProvider : public PageOrderProvider {
                 const PageId& rhs_page,
                 bool rhs_incomplete) const override;
 
+  void invalidateCachedKeys() const override;
+
  private:
+  QSizeF pageSize(const PageId& page) const;
+
   intrusive_ptr<Settings> m_settings;
+  mutable FlatHashMap<PageId, QSizeF> m_cachedSizes;
 };
 }  // namespace page_layout
 #endif
@@ -18,7 +18,7 @@
 
 #include "Settings.h"
 #include <DeviationProvider.h>
-#include <QMutex>
+#include <QReadWriteLock>
 #include <boost/foreach.hpp>
 #include <boost/multi_index/composite_key.hpp>
 #include <boost/multi_index/hashed_index.hpp>
@@ -171,6 +171,8 @@ class Settings::Impl {
 
   void enableShowingMiddleRect(bool state);
 
+  DirtyPages fetchDirtyPages();
+
  private:
   class SequencedTag;
   class DescWidthTag;
@@ -198,7 +200,7 @@ class Settings::Impl {
   typedef Container::index<DescWidthTag>::type DescWidthOrder;
   typedef Container::index<DescHeightTag>::type DescHeightOrder;
 
-  mutable QMutex m_mutex;
+  mutable QReadWriteLock m_rwLock;
   Container m_items;
   UnorderedItems& m_unorderedItems;
   DescWidthOrder& m_descWidthOrder;
@@ -211,6 +213,7 @@ class Settings::Impl {
   DeviationProvider<PageId> m_deviationProvider;
   std::vector<Guide> m_guides;
   bool m_showMiddleRect;
+  DirtyPages m_dirtyPages;
 };
 
 
@@ -316,6 +319,10 @@ void Settings::enableShowingMiddleRect(const bool state) {
   m_impl->enableShowingMiddleRect(state);
 }
 
+DirtyPages Settings::fetchDirtyPages() {
+  return m_impl->fetchDirtyPages();
+}
+
 /*============================== Settings::Item =============================*/
 
 Settings::Item::Item(const PageId& page_id,
@@ -379,13 +386,14 @@ Settings::Impl::Impl()
 Settings::Impl::~Impl() = default;
 
 void Settings::Impl::clear() {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
   m_items.clear();
   m_deviationProvider.clear();
+  m_dirtyPages.markAll();
 }
 
 void Settings::Impl::performRelinking(const AbstractRelinker& relinker) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   Container new_items;
 
   for (const Item& item : m_unorderedItems) {
@@ -401,10 +409,12 @@ void Settings::Impl::performRelinking(const AbstractRelinker& relinker) {
   for (const Item& item : m_unorderedItems) {
     m_deviationProvider.addOrUpdate(item.pageId);
   }
+
+  m_dirtyPages.markAll();
 }
 
 void Settings::Impl::removePagesMissingFrom(const PageSequence& pages) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   std::vector<PageId> sorted_pages;
 
@@ -422,12 +432,13 @@ void Settings::Impl::removePagesMissingFrom(const PageSequence& pages) {
     } else {
       m_deviationProvider.remove(it->pageId);
       m_unorderedItems.erase(it++);
+      m_dirtyPages.markAll();
     }
   }
 }
 
 bool Settings::Impl::checkEverythingDefined(const PageSequence& pages, const PageId* ignore) const {
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   for (const PageInfo& page_info : pages) {
     if (ignore && (*ignore == page_info.id())) {
@@ -443,7 +454,7 @@ bool Settings::Impl::checkEverythingDefined(const PageSequence& pages, const Pag
 }
 
 std::unique_ptr<Params> Settings::Impl::getPageParams(const PageId& page_id) const {
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   const Container::iterator it(m_items.find(page_id));
   if (it == m_items.end()) {
@@ -455,7 +466,7 @@ std::unique_ptr<Params> Settings::Impl::getPageParams(const PageId& page_id) con
 }
 
 void Settings::Impl::setPageParams(const PageId& page_id, const Params& params) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   const Item new_item(page_id, params.hardMarginsMM(), params.pageRect(), params.contentRect(), params.contentSizeMM(),
                       params.alignment(), params.isAutoMarginsEnabled());
@@ -468,6 +479,7 @@ void Settings::Impl::setPageParams(const PageId& page_id, const Params& params)
   }
 
   m_deviationProvider.addOrUpdate(page_id);
+  m_dirtyPages.mark(page_id);
 }
 
 Params Settings::Impl::updateContentSizeAndGetParams(const PageId& page_id,
@@ -476,7 +488,7 @@ Params Settings::Impl::updateContentSizeAndGetParams(const PageId& page_id,
                                                      const QSizeF& content_size_mm,
                                                      QSizeF* agg_hard_size_before,
                                                      QSizeF* agg_hard_size_after) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   if (agg_hard_size_before) {
     *agg_hard_size_before = getAggregateHardSizeMMLocked();
@@ -497,13 +509,14 @@ Params Settings::Impl::updateContentSizeAndGetParams(const PageId& page_id,
   }
 
   m_deviationProvider.addOrUpdate(page_id);
+  m_dirtyPages.mark(page_id);
 
   return Params(item_it->hardMarginsMM, item_it->pageRect, item_it->contentRect, item_it->contentSizeMM,
                 item_it->alignment, item_it->autoMargins);
 }  // Settings::Impl::updateContentSizeAndGetParams
 
 Margins Settings::Impl::getHardMarginsMM(const PageId& page_id) const {
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   const Container::iterator it(m_items.find(page_id));
   if (it == m_items.end()) {
@@ -514,7 +527,7 @@ Margins Settings::Impl::getHardMarginsMM(const PageId& page_id) const {
 }
 
 void Settings::Impl::setHardMarginsMM(const PageId& page_id, const Margins& margins_mm) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   const Container::iterator it(m_items.find(page_id));
   if (it == m_items.end()) {
@@ -526,10 +539,11 @@ void Settings::Impl::setHardMarginsMM(const PageId& page_id, const Margins& marg
   }
 
   m_deviationProvider.addOrUpdate(page_id);
+  m_dirtyPages.mark(page_id);
 }
 
 Alignment Settings::Impl::getPageAlignment(const PageId& page_id) const {
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   const Container::iterator it(m_items.find(page_id));
   if (it == m_items.end()) {
@@ -540,7 +554,7 @@ Alignment Settings::Impl::getPageAlignment(const PageId& page_id) const {
 }
 
 Settings::AggregateSizeChanged Settings::Impl::setPageAlignment(const PageId& page_id, const Alignment& alignment) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   const QSizeF agg_size_before(getAggregateHardSizeMMLocked());
 
@@ -554,6 +568,7 @@ Settings::AggregateSizeChanged Settings::Impl::setPageAlignment(const PageId& pa
   }
 
   m_deviationProvider.addOrUpdate(page_id);
+  m_dirtyPages.mark(page_id);
 
   const QSizeF agg_size_after(getAggregateHardSizeMMLocked());
   if (agg_size_before == agg_size_after) {
@@ -564,7 +579,7 @@ Settings::AggregateSizeChanged Settings::Impl::setPageAlignment(const PageId& pa
 }
 
 Settings::AggregateSizeChanged Settings::Impl::setContentSizeMM(const PageId& page_id, const QSizeF& content_size_mm) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   const QSizeF agg_size_before(getAggregateHardSizeMMLocked());
 
@@ -578,6 +593,7 @@ Settings::AggregateSizeChanged Settings::Impl::setContentSizeMM(const PageId& pa
   }
 
   m_deviationProvider.addOrUpdate(page_id);
+  m_dirtyPages.mark(page_id);
 
   const QSizeF agg_size_after(getAggregateHardSizeMMLocked());
   if (agg_size_before == agg_size_after) {
@@ -588,7 +604,7 @@ Settings::AggregateSizeChanged Settings::Impl::setContentSizeMM(const PageId& pa
 }
 
 void Settings::Impl::invalidateContentSize(const PageId& page_id) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   const Container::iterator it(m_items.find(page_id));
   if (it != m_items.end()) {
@@ -596,10 +612,11 @@ void Settings::Impl::invalidateContentSize(const PageId& page_id) {
   }
 
   m_deviationProvider.addOrUpdate(page_id);
+  m_dirtyPages.mark(page_id);
 }
 
 QSizeF Settings::Impl::getAggregateHardSizeMM() const {
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   return getAggregateHardSizeMMLocked();
 }
@@ -625,7 +642,7 @@ QSizeF Settings::Impl::getAggregateHardSizeMM(const PageId& page_id,
     return getAggregateHardSizeMM();
   }
 
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   if (m_items.empty()) {
     return QSizeF(0.0, 0.0);
@@ -667,7 +684,7 @@ QSizeF Settings::Impl::getAggregateHardSizeMM(const PageId& page_id,
 }  // Settings::Impl::getAggregateHardSizeMM
 
 bool Settings::Impl::isPageAutoMarginsEnabled(const PageId& page_id) {
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   const Container::iterator it(m_items.find(page_id));
   if (it == m_items.end()) {
@@ -678,7 +695,7 @@ bool Settings::Impl::isPageAutoMarginsEnabled(const PageId& page_id) {
 }
 
 void Settings::Impl::setPageAutoMarginsEnabled(const PageId& page_id, const bool state) {
-  const QMutexLocker locker(&m_mutex);
+  const QWriteLocker locker(&m_rwLock);
 
   const Container::iterator it(m_items.find(page_id));
   if (it == m_items.end()) {
@@ -688,10 +705,12 @@ void Settings::Impl::setPageAutoMarginsEnabled(const PageId& page_id, const bool
   } else {
     m_items.modify(it, ModifyMargins(it->hardMarginsMM, state));
   }
+
+  m_dirtyPages.mark(page_id);
 }
 
 bool Settings::Impl::isParamsNull(const PageId& page_id) const {
-  const QMutexLocker locker(&m_mutex);
+  const QReadLocker locker(&m_rwLock);
 
   return (m_items.find(page_id) == m_items.end());
 }
@@ -711,4 +730,13 @@ bool Settings::Impl::isShowingMiddleRectEnabled() const {
 void Settings::Impl::enableShowingMiddleRect(const bool state) {
   m_showMiddleRect = state;
 }
+
+DirtyPages Settings::Impl::fetchDirtyPages() {
+  const QWriteLocker locker(&m_rwLock);
+
+  DirtyPages dirty(m_dirtyPages);
+  m_dirtyPages.clear();
+
+  return dirty;
+}
 }  // namespace page_layout
\ No newline at end of file
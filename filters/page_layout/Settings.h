@@ -21,6 +21,7 @@
 
 #include <DeviationProvider.h>
 #include <memory>
+#include "DirtyPages.h"
 #include "Guide.h"
 #include "Margins.h"
 #include "NonCopyable.h"
@@ -167,6 +168,15 @@ class Settings : public ref_countable {
 
   void enableShowingMiddleRect(bool state);
 
+  /**
+   * \brief Returns the pages modified since the last call and resets
+   *        the dirty state.
+   *
+   * Used by Filter::updateSavedSettings() to rewrite only the affected
+   * per-page records of the project file.
+   */
+  DirtyPages fetchDirtyPages();
+
  private:
   class Impl;
   class Item;
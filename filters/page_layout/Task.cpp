@@ -25,9 +25,11 @@
 #include "FilterUiInterface.h"
 #include "ImageView.h"
 #include "OptionsWidget.h"
+#include "PageTimingRegistry.h"
 #include "Params.h"
 #include "Settings.h"
 #include "TaskStatus.h"
+#include "Tracer.h"
 #include "Utils.h"
 #include "filters/output/Task.h"
 
@@ -82,6 +84,9 @@ FilterResultPtr Task::process(const TaskStatus& status,
                               const FilterData& data,
                               const QRectF& page_rect,
                               const QRectF& content_rect) {
+  TRACE_SCOPE("page_layout: process");
+  const PageTimingRegistry::StageScope timing_scope(m_pageId, "page_layout");
+
   status.throwIfCancelled();
 
   const QSizeF content_size_mm(Utils::calcRectSizeMM(data.xform(), content_rect));
@@ -25,6 +25,7 @@
 #include "FilterResult.h"
 #include "NonCopyable.h"
 #include "PageOrderOption.h"
+#include "PageSelectionAccessor.h"
 #include "PageView.h"
 #include "SafeDeletingQObjectPtr.h"
 #include "intrusive_ptr.h"
@@ -32,7 +33,6 @@
 class ImageId;
 class PageInfo;
 class ProjectPages;
-class PageSelectionAccessor;
 class OrthogonalRotation;
 
 namespace deskew {
@@ -93,6 +93,7 @@ class Filter : public AbstractFilter {
 
   intrusive_ptr<ProjectPages> m_pages;
   intrusive_ptr<Settings> m_settings;
+  PageSelectionAccessor m_pageSelectionAccessor;
   SafeDeletingQObjectPtr<OptionsWidget> m_optionsWidget;
   std::vector<PageOrderOption> m_pageOrderOptions;
   int m_selectedPageOrder;
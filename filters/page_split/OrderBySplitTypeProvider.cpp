@@ -41,32 +41,38 @@ bool OrderBySplitTypeProvider::precedes(const PageId& lhs_page,
   assert(!lhs_incomplete);
   assert(!rhs_incomplete);
 
-  const Settings::Record lhs_record(m_settings->getPageRecord(lhs_page.imageId()));
-  const Settings::Record rhs_record(m_settings->getPageRecord(rhs_page.imageId()));
+  const int lhs_layout_type = layoutTypeKey(lhs_page);
+  const int rhs_layout_type = layoutTypeKey(rhs_page);
 
-  const Params* lhs_params = lhs_record.params();
-  const Params* rhs_params = rhs_record.params();
-
-  int lhs_layout_type = lhs_record.combinedLayoutType();
-  if (lhs_params) {
-    lhs_layout_type = lhs_params->pageLayout().toLayoutType();
+  if (lhs_layout_type == rhs_layout_type) {
+    return lhs_page < rhs_page;
+  } else {
+    return lhs_layout_type < rhs_layout_type;
   }
-  if (lhs_layout_type == AUTO_LAYOUT_TYPE) {
-    lhs_layout_type = 100;  // To force it below pages with known layout.
+}
+
+void OrderBySplitTypeProvider::invalidateCachedKeys() const {
+  m_cachedKeys.clear();
+}
+
+int OrderBySplitTypeProvider::layoutTypeKey(const PageId& page) const {
+  const auto it(m_cachedKeys.find(page));
+  if (it != m_cachedKeys.end()) {
+    return it->second;
   }
 
-  int rhs_layout_type = rhs_record.combinedLayoutType();
-  if (rhs_params) {
-    rhs_layout_type = rhs_params->pageLayout().toLayoutType();
+  const Settings::Record record(m_settings->getPageRecord(page.imageId()));
+  const Params* params = record.params();
+
+  int layout_type = record.combinedLayoutType();
+  if (params) {
+    layout_type = params->pageLayout().toLayoutType();
   }
-  if (rhs_layout_type == AUTO_LAYOUT_TYPE) {
-    rhs_layout_type = 100;  // To force it below pages with known layout.
+  if (layout_type == AUTO_LAYOUT_TYPE) {
+    layout_type = 100;  // To force it below pages with known layout.
   }
+  m_cachedKeys.insert(std::make_pair(page, layout_type));
 
-  if (lhs_layout_type == rhs_layout_type) {
-    return lhs_page < rhs_page;
-  } else {
-    return lhs_layout_type < rhs_layout_type;
-  }
+  return layout_type;
 }  // OrderBySplitTypeProvider::precedes
 }  // namespace page_split
\ No newline at end of file
@@ -20,6 +20,7 @@
 #ifndef PAGE_SPLIT_ORDER_BY_SPLIT_TYPE_PROVIDER_H_
 #define PAGE_SPLIT_ORDER_BY_SPLIT_TYPE_PROVIDER_H_
 
+#include "FlatHashMap.h"
 #include "PageOrderProvider.h"
 #include "Settings.h"
 #include "intrusive_ptr.h"
@@ -34,8 +35,13 @@ class OrderBySplitTypeProvider : public PageOrderProvider {
                 const PageId& rhs_page,
                 bool rhs_incomplete) const override;
 
+  void invalidateCachedKeys() const override;
+
  private:
+  int layoutTypeKey(const PageId& page) const;
+
   intrusive_ptr<Settings> m_settings;
+  mutable FlatHashMap<PageId, int> m_cachedKeys;
 };
 }  // namespace page_split
 
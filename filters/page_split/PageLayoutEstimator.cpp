@@ -18,12 +18,16 @@
 
 #include "PageLayoutEstimator.h"
 #include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QPainter>
 #include <boost/foreach.hpp>
 #include <boost/lambda/bind.hpp>
 #include <boost/lambda/lambda.hpp>
+#include <map>
 #include "ContentSpanFinder.h"
 #include "DebugImages.h"
+#include "ImageId.h"
 #include "ImageMetadata.h"
 #include "ImageTransformation.h"
 #include "OrthogonalRotation.h"
@@ -33,7 +37,7 @@
 #include "imageproc/Binarize.h"
 #include "imageproc/BinaryThreshold.h"
 #include "imageproc/ConnComp.h"
-#include "imageproc/ConnCompEraserExt.h"
+#include "imageproc/ConnCompExtractor.h"
 #include "imageproc/Connectivity.h"
 #include "imageproc/Constants.h"
 #include "imageproc/GrayRasterOp.h"
@@ -186,23 +190,69 @@ int numPages(const LayoutType layout_type, const ImageTransformation& pre_xform)
 
   return num_pages;
 }
+
+/**
+ * \brief Cached per-page image analysis results.
+ *
+ * The expensive part of layout estimation - line finding, binarization,
+ * garbage removal, deskewing and projection profiles - depends only on
+ * the page image, its pre-rotation and the binarization threshold, not
+ * on the requested layout type.  Caching it makes re-estimation after
+ * a layout type or split line mode change only redo the cheap line
+ * search over the cached data.
+ */
+struct AnalysisCache {
+  QSize imageSize;
+  int rotationDegrees = -1;
+
+  bool haveFoldLines = false;
+  std::vector<QLineF> foldLines;
+
+  int bwThreshold = -1;  // The threshold the whitespace analysis was done with.
+  bool haveWhitespaceAnalysis = false;
+  QTransform deskewXform;
+  QSize deskewedSize;
+  bool leftOffcut = false;
+  bool rightOffcut = false;
+  std::deque<Span> contentSpans;
+};
+
+QMutex analysis_cache_mutex;
+std::map<ImageId, AnalysisCache> analysis_cache;
+
+/**
+ * Returns the cache entry for the given page, resetting it first
+ * if it was built from a different image size or pre-rotation.
+ * The caller must be holding analysis_cache_mutex.
+ */
+AnalysisCache& cacheEntryLocked(const ImageId& image_id, const QSize& image_size, const int rotation_degrees) {
+  AnalysisCache& entry = analysis_cache[image_id];
+  if ((entry.imageSize != image_size) || (entry.rotationDegrees != rotation_degrees)) {
+    entry = AnalysisCache();
+    entry.imageSize = image_size;
+    entry.rotationDegrees = rotation_degrees;
+  }
+
+  return entry;
+}
 }  // anonymous namespace
 
 PageLayout PageLayoutEstimator::estimatePageLayout(const LayoutType layout_type,
                                                    const QImage& input,
                                                    const ImageTransformation& pre_xform,
                                                    const BinaryThreshold bw_threshold,
+                                                   const ImageId& image_id,
                                                    DebugImages* const dbg) {
   if (layout_type == SINGLE_PAGE_UNCUT) {
     return PageLayout(pre_xform.resultingRect());
   }
 
-  std::unique_ptr<PageLayout> layout(tryCutAtFoldingLine(layout_type, input, pre_xform, dbg));
+  std::unique_ptr<PageLayout> layout(tryCutAtFoldingLine(layout_type, input, pre_xform, image_id, dbg));
   if (layout) {
     return *layout;
   }
 
-  return cutAtWhitespace(layout_type, input, pre_xform, bw_threshold, dbg);
+  return cutAtWhitespace(layout_type, input, pre_xform, bw_threshold, image_id, dbg);
 }
 
 namespace {
@@ -245,18 +295,40 @@ class BadTwoPageSplitter {
 std::unique_ptr<PageLayout> PageLayoutEstimator::tryCutAtFoldingLine(const LayoutType layout_type,
                                                                      const QImage& input,
                                                                      const ImageTransformation& pre_xform,
+                                                                     const ImageId& image_id,
                                                                      DebugImages* const dbg) {
   const int num_pages = numPages(layout_type, pre_xform);
+  const int rotation_degrees = pre_xform.preRotation().toDegrees();
 
   GrayImage gray_downscaled;
   QTransform out_to_downscaled;
 
-  const int max_lines = 8;
-  std::vector<QLineF> lines(VertLineFinder::findLines(input, pre_xform, max_lines, dbg,
-                                                      num_pages == 1 ? &gray_downscaled : nullptr,
-                                                      num_pages == 1 ? &out_to_downscaled : nullptr));
+  std::vector<QLineF> lines;
+  bool from_cache = false;
+
+  if (!dbg) {
+    // With a debug sink attached we always redo the search,
+    // so that the debugging images get generated.
+    const QMutexLocker locker(&analysis_cache_mutex);
+    const AnalysisCache& entry = cacheEntryLocked(image_id, input.size(), rotation_degrees);
+    if (entry.haveFoldLines) {
+      lines = entry.foldLines;
+      from_cache = true;
+    }
+  }
+
+  if (!from_cache) {
+    const int max_lines = 8;
+    lines = VertLineFinder::findLines(input, pre_xform, max_lines, dbg, num_pages == 1 ? &gray_downscaled : nullptr,
+                                      num_pages == 1 ? &out_to_downscaled : nullptr);
+
+    std::sort(lines.begin(), lines.end(), CenterComparator());
 
-  std::sort(lines.begin(), lines.end(), CenterComparator());
+    const QMutexLocker locker(&analysis_cache_mutex);
+    AnalysisCache& entry = cacheEntryLocked(image_id, input.size(), rotation_degrees);
+    entry.haveFoldLines = true;
+    entry.foldLines = lines;
+  }
 
   const QRectF virtual_image_rect(pre_xform.transform().mapRect(input.rect()));
   const QPointF center(virtual_image_rect.center());
@@ -322,64 +394,116 @@ PageLayout PageLayoutEstimator::cutAtWhitespace(const LayoutType layout_type,
                                                 const QImage& input,
                                                 const ImageTransformation& pre_xform,
                                                 const BinaryThreshold bw_threshold,
+                                                const ImageId& image_id,
                                                 DebugImages* const dbg) {
-  QTransform xform;
+  const int rotation_degrees = pre_xform.preRotation().toDegrees();
 
-  // Convert to B/W and rotate.
-  BinaryImage img(to300DpiBinary(input, xform, bw_threshold));
-  // Note: here we assume the only transformation applied
-  // to the input image is orthogonal rotation.
-  img = orthogonalRotation(img, pre_xform.preRotation().toDegrees());
-  if (dbg) {
-    dbg->add(img, "bw300");
+  QTransform xform;
+  QSize deskewed_size;
+  bool left_offcut = false;
+  bool right_offcut = false;
+  std::deque<Span> spans;
+  bool from_cache = false;
+
+  if (!dbg) {
+    const QMutexLocker locker(&analysis_cache_mutex);
+    const AnalysisCache& entry = cacheEntryLocked(image_id, input.size(), rotation_degrees);
+    if (entry.haveWhitespaceAnalysis && (entry.bwThreshold == int(bw_threshold))) {
+      xform = entry.deskewXform;
+      deskewed_size = entry.deskewedSize;
+      left_offcut = entry.leftOffcut;
+      right_offcut = entry.rightOffcut;
+      spans = entry.contentSpans;
+      from_cache = true;
+    }
   }
 
-  img = removeGarbageAnd2xDownscale(img, dbg);
-  xform.scale(0.5, 0.5);
-  if (dbg) {
-    dbg->add(img, "no_garbage");
-  }
+  BinaryImage img;
+  if (!from_cache) {
+    // Convert to B/W and rotate.
+    img = to300DpiBinary(input, xform, bw_threshold);
+    // Note: here we assume the only transformation applied
+    // to the input image is orthogonal rotation.
+    img = orthogonalRotation(img, rotation_degrees);
+    if (dbg) {
+      dbg->add(img, "bw300");
+    }
 
-  // From now on we work with 150 dpi images.
-
-  const bool left_offcut = checkForLeftOffcut(img);
-  const bool right_offcut = checkForRightOffcut(img);
-
-  SkewFinder skew_finder;
-  // We work with 150dpi image, so no further reduction.
-  skew_finder.setCoarseReduction(0);
-  skew_finder.setFineReduction(0);
-  skew_finder.setDesiredAccuracy(0.5);  // fine accuracy is not required.
-  const Skew skew(skew_finder.findSkew(img));
-  if ((skew.angle() != 0.0) && (skew.confidence() >= Skew::GOOD_CONFIDENCE)) {
-    const int w = img.width();
-    const int h = img.height();
-    const double angle_deg = skew.angle();
-    const double tg = std::tan(angle_deg * constants::DEG2RAD);
-
-    const auto margin = (int) std::ceil(std::fabs(0.5 * h * tg));
-    const int new_width = w - margin * 2;
-    if (new_width > 0) {
-      hShearInPlace(img, tg, 0.5 * h, WHITE);
-      BinaryImage new_img(new_width, h);
-      rasterOp<RopSrc>(new_img, new_img.rect(), img, QPoint(margin, 0));
-      img.swap(new_img);
-      if (dbg) {
-        dbg->add(img, "shear_applied");
-      }
+    img = removeGarbageAnd2xDownscale(img, dbg);
+    xform.scale(0.5, 0.5);
+    if (dbg) {
+      dbg->add(img, "no_garbage");
+    }
 
-      QTransform t1;
-      t1.translate(-0.5 * w, -0.5 * h);
-      QTransform t2;
-      t2.shear(tg, 0.0);
-      QTransform t3;
-      t3.translate(0.5 * w - margin, 0.5 * h);
-      xform = xform * t1 * t2 * t3;
+    // From now on we work with 150 dpi images.
+
+    left_offcut = checkForLeftOffcut(img);
+    right_offcut = checkForRightOffcut(img);
+
+    SkewFinder skew_finder;
+    // We work with 150dpi image, so no further reduction.
+    skew_finder.setCoarseReduction(0);
+    skew_finder.setFineReduction(0);
+    skew_finder.setDesiredAccuracy(0.5);  // fine accuracy is not required.
+    const Skew skew(skew_finder.findSkew(img));
+    if ((skew.angle() != 0.0) && (skew.confidence() >= Skew::GOOD_CONFIDENCE)) {
+      const int w = img.width();
+      const int h = img.height();
+      const double angle_deg = skew.angle();
+      const double tg = std::tan(angle_deg * constants::DEG2RAD);
+
+      const auto margin = (int) std::ceil(std::fabs(0.5 * h * tg));
+      const int new_width = w - margin * 2;
+      if (new_width > 0) {
+        hShearInPlace(img, tg, 0.5 * h, WHITE);
+        BinaryImage new_img(new_width, h);
+        rasterOp<RopSrc>(new_img, new_img.rect(), img, QPoint(margin, 0));
+        img.swap(new_img);
+        if (dbg) {
+          dbg->add(img, "shear_applied");
+        }
+
+        QTransform t1;
+        t1.translate(-0.5 * w, -0.5 * h);
+        QTransform t2;
+        t2.shear(tg, 0.0);
+        QTransform t3;
+        t3.translate(0.5 * w - margin, 0.5 * h);
+        xform = xform * t1 * t2 * t3;
+      }
     }
+
+    spans = computeContentSpans(img, dbg);
+    deskewed_size = img.size();
+
+    const QMutexLocker locker(&analysis_cache_mutex);
+    AnalysisCache& entry = cacheEntryLocked(image_id, input.size(), rotation_degrees);
+    entry.bwThreshold = bw_threshold;
+    entry.haveWhitespaceAnalysis = true;
+    entry.deskewXform = xform;
+    entry.deskewedSize = deskewed_size;
+    entry.leftOffcut = left_offcut;
+    entry.rightOffcut = right_offcut;
+    entry.contentSpans = spans;
   }
 
   const int num_pages = numPages(layout_type, pre_xform);
-  const PageLayout layout(cutAtWhitespaceDeskewed150(layout_type, num_pages, img, left_offcut, right_offcut, dbg));
+  const int width = deskewed_size.width();
+  const int height = deskewed_size.height();
+
+  PageLayout layout;
+  if (num_pages == 1) {
+    layout = processContentSpansSinglePage(layout_type, spans, width, height, left_offcut, right_offcut);
+  } else {
+    // This helps if we have 2 pages with one page containing nothing
+    // but a small amount of garbage.
+    removeInsignificantEdgeSpans(spans);
+    if (dbg && !img.isNull()) {
+      visualizeSpans(*dbg, spans, img, "spans_refined");
+    }
+
+    layout = processContentSpansTwoPages(layout_type, spans, width, height);
+  }
 
   PageLayout transformed_layout(layout.transformed(xform.inverted()));
   // We don't want a skewed outline!
@@ -389,33 +513,15 @@ PageLayout PageLayoutEstimator::cutAtWhitespace(const LayoutType layout_type,
 }  // PageLayoutEstimator::cutAtWhitespace
 
 /**
- * \brief Attempts to find a suitable whitespace to draw a splitting line through.
- *
- * \param layout_type The type of a layout to detect.  If set to
- *        something other than AUTO_LAYOUT_TYPE, the returned
- *        layout will have the same type.
- * \param num_pages The number of pages (1 or 2) in the layout.
- * \param input The black and white, 150 DPI input image.
- * \param left_offcut True if there seems to be garbage on the left side.
- * \param right_offcut True if there seems to be garbage on the right side.
- * \param dbg An optional sink for debugging images.
- * \return A PageLAyout consistent with the layout_type requested.
+ * \brief Computes the content spans of a black and white, 150 DPI,
+ *        deskewed image by its vertical projection profile.
  */
-PageLayout PageLayoutEstimator::cutAtWhitespaceDeskewed150(const LayoutType layout_type,
-                                                           const int num_pages,
-                                                           const BinaryImage& input,
-                                                           const bool left_offcut,
-                                                           const bool right_offcut,
-                                                           DebugImages* dbg) {
-  const int width = input.width();
-  const int height = input.height();
-
+std::deque<Span> PageLayoutEstimator::computeContentSpans(const BinaryImage& input, DebugImages* dbg) {
   BinaryImage cc_img(input.size(), WHITE);
 
   {
-    ConnCompEraser cc_eraser(input, CONN8);
-    ConnComp cc;
-    while (!(cc = cc_eraser.nextConnComp()).isNull()) {
+    const ConnCompExtractor extractor(input, CONN8);
+    for (const ConnComp& cc : extractor.components()) {
       if ((cc.width() < 5) || (cc.height() < 5)) {
         continue;
       }
@@ -442,19 +548,8 @@ PageLayout PageLayoutEstimator::cutAtWhitespaceDeskewed150(const LayoutType layo
     visualizeSpans(*dbg, spans, input, "spans");
   }
 
-  if (num_pages == 1) {
-    return processContentSpansSinglePage(layout_type, spans, width, height, left_offcut, right_offcut);
-  } else {
-    // This helps if we have 2 pages with one page containing nothing
-    // but a small amount of garbage.
-    removeInsignificantEdgeSpans(spans);
-    if (dbg) {
-      visualizeSpans(*dbg, spans, input, "spans_refined");
-    }
-
-    return processContentSpansTwoPages(layout_type, spans, width, height);
-  }
-}  // PageLayoutEstimator::cutAtWhitespaceDeskewed150
+  return spans;
+}  // PageLayoutEstimator::computeContentSpans
 
 imageproc::BinaryImage PageLayoutEstimator::to300DpiBinary(const QImage& img,
                                                            QTransform& xform,
@@ -29,6 +29,7 @@ class QRect;
 class QPoint;
 class QImage;
 class QTransform;
+class ImageId;
 class ImageTransformation;
 class DebugImages;
 class Span;
@@ -55,6 +56,9 @@ class PageLayoutEstimator {
    *        The resulting page layout will be in transformed coordinates.
    * \param bw_threshold The global binarization threshold for the
    *        input image.
+   * \param image_id The identifier of the page image.  Used as a key
+   *        for caching the image analysis, so that re-estimating the
+   *        layout for the same page only redoes the cheap line search.
    * \param dbg An optional sink for debugging images.
    * \return The estimated PageLayout of type consistent with the
    *         requested layout type.
@@ -63,26 +67,24 @@ class PageLayoutEstimator {
                                        const QImage& input,
                                        const ImageTransformation& pre_xform,
                                        imageproc::BinaryThreshold bw_threshold,
+                                       const ImageId& image_id,
                                        DebugImages* dbg = nullptr);
 
  private:
   static std::unique_ptr<PageLayout> tryCutAtFoldingLine(LayoutType layout_type,
                                                          const QImage& input,
                                                          const ImageTransformation& pre_xform,
+                                                         const ImageId& image_id,
                                                          DebugImages* dbg);
 
   static PageLayout cutAtWhitespace(LayoutType layout_type,
                                     const QImage& input,
                                     const ImageTransformation& pre_xform,
                                     imageproc::BinaryThreshold bw_threshold,
+                                    const ImageId& image_id,
                                     DebugImages* dbg);
 
-  static PageLayout cutAtWhitespaceDeskewed150(LayoutType layout_type,
-                                               int num_pages,
-                                               const imageproc::BinaryImage& input,
-                                               bool left_offcut,
-                                               bool right_offcut,
-                                               DebugImages* dbg);
+  static std::deque<Span> computeContentSpans(const imageproc::BinaryImage& input, DebugImages* dbg);
 
   static imageproc::BinaryImage to300DpiBinary(const QImage& img,
                                                QTransform& xform,
@@ -27,14 +27,14 @@ Settings::Settings() : m_defaultLayoutType(AUTO_LAYOUT_TYPE) {}
 Settings::~Settings() = default;
 
 void Settings::clear() {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
 
   m_perPageRecords.clear();
   m_defaultLayoutType = AUTO_LAYOUT_TYPE;
 }
 
 void Settings::performRelinking(const AbstractRelinker& relinker) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   PerPageRecords new_records;
 
   for (const PerPageRecords::value_type& kv : m_perPageRecords) {
@@ -48,13 +48,13 @@ void Settings::performRelinking(const AbstractRelinker& relinker) {
 }
 
 LayoutType Settings::defaultLayoutType() const {
-  QMutexLocker locker(&m_mutex);
+  QReadLocker locker(&m_rwLock);
 
   return m_defaultLayoutType;
 }
 
 void Settings::setLayoutTypeForAllPages(const LayoutType layout_type) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
 
   auto it(m_perPageRecords.begin());
   const auto end(m_perPageRecords.end());
@@ -71,7 +71,7 @@ void Settings::setLayoutTypeForAllPages(const LayoutType layout_type) {
 }
 
 void Settings::setLayoutTypeFor(const LayoutType layout_type, const std::set<PageId>& pages) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
 
   UpdateAction action;
 
@@ -81,7 +81,7 @@ void Settings::setLayoutTypeFor(const LayoutType layout_type, const std::set<Pag
 }
 
 Settings::Record Settings::getPageRecord(const ImageId& image_id) const {
-  QMutexLocker locker(&m_mutex);
+  QReadLocker locker(&m_rwLock);
 
   return getPageRecordLocked(image_id);
 }
@@ -96,7 +96,7 @@ Settings::Record Settings::getPageRecordLocked(const ImageId& image_id) const {
 }
 
 void Settings::updatePage(const ImageId& image_id, const UpdateAction& action) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   updatePageLocked(image_id, action);
 }
 
@@ -137,7 +137,7 @@ void Settings::updatePageLocked(const PerPageRecords::iterator it, const UpdateA
 }
 
 Settings::Record Settings::conditionalUpdate(const ImageId& image_id, const UpdateAction& action, bool* conflict) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
 
   auto it(m_perPageRecords.find(image_id));
   if (it == m_perPageRecords.end()) {
@@ -19,7 +19,7 @@
 #ifndef PAGE_SPLIT_SETTINGS_H_
 #define PAGE_SPLIT_SETTINGS_H_
 
-#include <QMutex>
+#include <QReadWriteLock>
 #include <memory>
 #include <set>
 #include <unordered_map>
@@ -180,7 +180,7 @@ class Settings : public ref_countable {
 
   void updatePageLocked(PerPageRecords::iterator it, const UpdateAction& action);
 
-  mutable QMutex m_mutex;
+  mutable QReadWriteLock m_rwLock;
   PerPageRecords m_perPageRecords;
   LayoutType m_defaultLayoutType;
 };
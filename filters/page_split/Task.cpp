@@ -27,11 +27,14 @@
 #include "ImageView.h"
 #include "OptionsWidget.h"
 #include "PageLayoutAdapter.h"
+#include "PageTimingRegistry.h"
 #include "PageLayoutEstimator.h"
 #include "ProjectPages.h"
 #include "Settings.h"
 #include "Task.h"
+#include "BookPriors.h"
 #include "TaskStatus.h"
+#include "Tracer.h"
 #include "filters/deskew/Task.h"
 
 namespace page_split {
@@ -100,6 +103,9 @@ Task::Task(intrusive_ptr<Filter> filter,
 Task::~Task() = default;
 
 FilterResultPtr Task::process(const TaskStatus& status, const FilterData& data) {
+  TRACE_SCOPE("page_split: process");
+  const PageTimingRegistry::StageScope timing_scope(m_pageInfo.id(), "page_split");
+
   status.throwIfCancelled();
 
   Settings::Record record(m_settings->getPageRecord(m_pageInfo.imageId()));
@@ -115,7 +121,17 @@ FilterResultPtr Task::process(const TaskStatus& status, const FilterData& data)
     if (!params || !deps.compatibleWith(*params)) {
       if (!params || (record.combinedLayoutType() == AUTO_LAYOUT_TYPE)) {
         new_layout = PageLayoutEstimator::estimatePageLayout(record.combinedLayoutType(), data.grayImage(),
-                                                             data.xform(), data.bwThreshold(), m_dbg.get());
+                                                             data.xform(), data.bwThreshold(), m_pageInfo.imageId(),
+                                                             m_dbg.get());
+
+        if (new_layout.type() == PageLayout::TWO_PAGES) {
+          const QRectF outline_rect(new_layout.uncutOutline().boundingRect());
+          const QLineF cutter(new_layout.inscribedCutterLine(0));
+          if (outline_rect.width() > 0) {
+            BookPriors::instance().addSplitPositionSample(
+                (0.5 * (cutter.p1().x() + cutter.p2().x()) - outline_rect.left()) / outline_rect.width());
+          }
+        }
 
         status.throwIfCancelled();
       } else {
@@ -48,7 +48,8 @@ void UnremoveButton::onProximityUpdate(const QPointF& screen_mouse_pos, Interact
   const bool hovered = rect.contains(screen_mouse_pos);
   if (hovered != m_wasHovered) {
     m_wasHovered = hovered;
-    interaction.setRedrawRequested(true);
+    // Only the button itself needs repainting.
+    interaction.requestRedraw(rect);
   }
 
   interaction.updateProximity(m_proximityInteraction, Proximity::fromSqDist(hovered ? 0.0 : 1e10));
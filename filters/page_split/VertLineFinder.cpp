@@ -20,7 +20,10 @@
 #include <QDebug>
 #include <QPainter>
 #include <cmath>
+#include <map>
+#include <mutex>
 #include "DebugImages.h"
+#include "ParallelFor.h"
 #include "ImageTransformation.h"
 #include "imageproc/Constants.h"
 #include "imageproc/GrayImage.h"
@@ -127,15 +130,41 @@ std::vector<QLineF> VertLineFinder::findLines(const QImage& image,
 
   const int x_limit = raster_lines.width() - margin;
   const int height = raster_lines.height();
-  const uint8_t* line = raster_lines.data();
+  const uint8_t* const raster_data = raster_lines.data();
   const int stride = raster_lines.stride();
-  for (int y = 0; y < height; ++y, line += stride) {
-    for (int x = margin; x < x_limit; ++x) {
-      const unsigned val = line[x];
-      if (val > 1) {
-        line_detector.process(x, y, weight_table[val]);
+
+  // The scan only reads the image, so strips of rows collect their
+  // candidate points in parallel.  Integer vote accumulation is exact
+  // and order-independent, but the chunks are still fed to the detector
+  // in row order to keep the whole search bit-for-bit reproducible.
+  struct WeightedPoint {
+    int x, y;
+    unsigned weight;
+  };
+
+  std::mutex chunks_mutex;
+  std::map<int, std::vector<WeightedPoint>> point_chunks;  // keyed by the chunk's first row
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    std::vector<WeightedPoint> points;
+
+    const uint8_t* line = raster_data + chunk_begin * stride;
+    for (int y = chunk_begin; y < chunk_end; ++y, line += stride) {
+      for (int x = margin; x < x_limit; ++x) {
+        const unsigned val = line[x];
+        if (val > 1) {
+          points.push_back({x, y, weight_table[val]});
+        }
       }
     }
+
+    const std::lock_guard<std::mutex> guard(chunks_mutex);
+    point_chunks.emplace(chunk_begin, std::move(points));
+  });
+
+  for (const auto& pair : point_chunks) {
+    for (const WeightedPoint& pt : pair.second) {
+      line_detector.process(pt.x, pt.y, pt.weight);
+    }
   }
 
   const unsigned min_quality = (unsigned) (height * line_thickness * 1.8) + 1;
@@ -37,6 +37,7 @@
 #include "imageproc/Morphology.h"
 #include "imageproc/PolygonRasterizer.h"
 #include "imageproc/RasterOp.h"
+#include "imageproc/ReduceThreshold.h"
 #include "imageproc/SEDM.h"
 #include "imageproc/SeedFill.h"
 #include "imageproc/SlicedHistogram.h"
@@ -119,14 +120,24 @@ QRectF ContentBoxFinder::findContentBox(const TaskStatus& status,
     dbg->add(bw150, "page_mask_applied");
   }
 
-  BinaryImage hor_shadows_seed(openBrick(bw150, QSize(200, 14), BLACK));
+  status.throwIfCancelled();
+
+  // The content box is a low-frequency feature, so the bulk of the
+  // analysis is done on a 2x reduced image.  The final box edges
+  // are refined at full resolution afterwards.
+  BinaryImage bw75(ReduceThreshold(bw150)(2));
+  if (dbg) {
+    dbg->add(bw75, "bw75");
+  }
+
+  BinaryImage hor_shadows_seed(openBrick(bw75, QSize(100, 7), BLACK));
   if (dbg) {
     dbg->add(hor_shadows_seed, "hor_shadows_seed");
   }
 
   status.throwIfCancelled();
 
-  BinaryImage ver_shadows_seed(openBrick(bw150, QSize(14, 300), BLACK));
+  BinaryImage ver_shadows_seed(openBrick(bw75, QSize(7, 150), BLACK));
   if (dbg) {
     dbg->add(ver_shadows_seed, "ver_shadows_seed");
   }
@@ -142,7 +153,7 @@ QRectF ContentBoxFinder::findContentBox(const TaskStatus& status,
 
   status.throwIfCancelled();
 
-  BinaryImage dilated(dilateBrick(bw150, QSize(3, 3)));
+  BinaryImage dilated(dilateBrick(bw75, QSize(3, 3)));
   if (dbg) {
     dbg->add(dilated, "dilated");
   }
@@ -157,7 +168,7 @@ QRectF ContentBoxFinder::findContentBox(const TaskStatus& status,
 
   status.throwIfCancelled();
 
-  rasterOp<RopAnd<RopSrc, RopDst>>(shadows_dilated, bw150);
+  rasterOp<RopAnd<RopSrc, RopDst>>(shadows_dilated, bw75);
   BinaryImage garbage(shadows_dilated.release());
   if (dbg) {
     dbg->add(garbage, "shadows");
@@ -172,7 +183,7 @@ QRectF ContentBoxFinder::findContentBox(const TaskStatus& status,
 
   status.throwIfCancelled();
 
-  BinaryImage content(bw150.release());
+  BinaryImage content(bw75.release());
   rasterOp<RopSubtract<RopDst, RopSrc>>(content, garbage);
   if (dbg) {
     dbg->add(content, "content");
@@ -182,7 +193,7 @@ QRectF ContentBoxFinder::findContentBox(const TaskStatus& status,
 
   Despeckle::Level despeckleLevel = Despeckle::NORMAL;
 
-  BinaryImage despeckled(Despeckle::despeckle(content, Dpi(150, 150), despeckleLevel, status, dbg));
+  BinaryImage despeckled(Despeckle::despeckle(content, Dpi(75, 75), despeckleLevel, status, dbg));
   if (dbg) {
     dbg->add(despeckled, "despeckled");
   }
@@ -190,7 +201,9 @@ QRectF ContentBoxFinder::findContentBox(const TaskStatus& status,
   status.throwIfCancelled();
 
   BinaryImage content_blocks(content.size(), BLACK);
-  const int area_threshold = std::min(content.width(), content.height());
+  // Halved rather than quartered, to keep the area threshold
+  // proportionally the same as it was at 150 dpi.
+  const int area_threshold = std::min(content.width(), content.height()) / 2;
 
   {
     MaxWhitespaceFinder hor_ws_finder(PreferHorizontal(), despeckled);
@@ -244,7 +257,7 @@ QRectF ContentBoxFinder::findContentBox(const TaskStatus& status,
   {
     BinaryImage tmp(content);
     rasterOp<RopOr<RopNot<RopSrc>, RopDst>>(tmp, content_blocks);
-    MaxWhitespaceFinder ws_finder(tmp.release(), QSize(4, 4));
+    MaxWhitespaceFinder ws_finder(tmp.release(), QSize(2, 2));
 
     for (int i = 0; i < 10; ++i) {
       QRect ws(ws_finder.next());
@@ -377,17 +390,24 @@ QRectF ContentBoxFinder::findContentBox(const TaskStatus& status,
       }
     }
 
-    if ((content_rect.width() < 8) || (content_rect.height() < 8)) {
+    if ((content_rect.width() < 4) || (content_rect.height() < 4)) {
       content_rect = QRect();
       break;
-    } else if ((content_rect.width() < 30) && (content_rect.height() > content_rect.width() * 20)) {
+    } else if ((content_rect.width() < 15) && (content_rect.height() > content_rect.width() * 20)) {
       content_rect = QRect();
       break;
     }
   }
 
-  // Increase the content rect due to cutting off the content at edges because of rescaling made.
   if (!content_rect.isEmpty()) {
+    // Map from the reduced image back to 150 dpi.  A pixel of the
+    // reduced image covers a 2x2 block, so each edge is only a couple
+    // of pixels off at most.
+    content_rect
+        = QRect(content_rect.x() * 2, content_rect.y() * 2, content_rect.width() * 2, content_rect.height() * 2);
+    content_rect = refineEdgesAtFullRes(bw150, content_rect);
+
+    // Increase the content rect due to cutting off the content at edges because of rescaling made.
     content_rect.adjust(-1, -1, 1, 1);
   }
 
@@ -398,6 +418,44 @@ QRectF ContentBoxFinder::findContentBox(const TaskStatus& status,
   return combined_xform.map(QRectF(content_rect)).boundingRect().intersected(data.xform().resultingRect());
 }  // ContentBoxFinder::findContentBox
 
+QRect ContentBoxFinder::refineEdgesAtFullRes(const imageproc::BinaryImage& bw150, const QRect& content_rect) {
+  // Each edge position is only known up to the reduction error,
+  // so snap it to the outermost black pixels within a search area
+  // inflated by that error.
+  const QRect search_area(content_rect.adjusted(-2, -2, 2, 2).intersected(bw150.rect()));
+  if (search_area.isEmpty()) {
+    return content_rect;
+  }
+
+  const SlicedHistogram cols(bw150, search_area, SlicedHistogram::COLS);
+  const SlicedHistogram rows(bw150, search_area, SlicedHistogram::ROWS);
+
+  int left = 0;
+  while (left < static_cast<int>(cols.size()) && cols[left] == 0) {
+    ++left;
+  }
+  if (left == static_cast<int>(cols.size())) {
+    // No black pixels at full resolution.
+    return content_rect;
+  }
+
+  int right = static_cast<int>(cols.size()) - 1;
+  while (cols[right] == 0) {
+    --right;
+  }
+  int top = 0;
+  while (rows[top] == 0) {
+    ++top;
+  }
+  int bottom = static_cast<int>(rows.size()) - 1;
+  while (rows[bottom] == 0) {
+    --bottom;
+  }
+
+  return QRect(QPoint(search_area.left() + left, search_area.top() + top),
+               QPoint(search_area.left() + right, search_area.top() + bottom));
+}  // ContentBoxFinder::refineEdgesAtFullRes
+
 namespace {
 struct Bounds {
   // All are inclusive.
@@ -597,7 +655,7 @@ void ContentBoxFinder::segmentGarbage(const imageproc::BinaryImage& garbage,
                                       imageproc::BinaryImage& hor_garbage,
                                       imageproc::BinaryImage& vert_garbage,
                                       DebugImages* dbg) {
-  hor_garbage = openBrick(garbage, QSize(200, 1), WHITE);
+  hor_garbage = openBrick(garbage, QSize(100, 1), WHITE);
 
   QRect rect(garbage.rect());
   rect.setHeight(1);
@@ -605,7 +663,7 @@ void ContentBoxFinder::segmentGarbage(const imageproc::BinaryImage& garbage,
   rect.moveBottom(garbage.rect().bottom());
   rasterOp<RopOr<RopSrc, RopDst>>(hor_garbage, rect, garbage, rect.topLeft());
 
-  vert_garbage = openBrick(garbage, QSize(1, 200), WHITE);
+  vert_garbage = openBrick(garbage, QSize(1, 100), WHITE);
 
   rect = garbage.rect();
   rect.setWidth(1);
@@ -692,7 +750,7 @@ imageproc::BinaryImage ContentBoxFinder::estimateTextMask(const imageproc::Binar
 
   BinaryImage text_mask(content.size(), WHITE);
 
-  const int min_text_height = 6;
+  const int min_text_height = 3;  // At 75 dpi.
 
   ConnCompEraserExt eraser(content_blocks, CONN4);
   while (true) {
@@ -1103,7 +1161,7 @@ QRect ContentBoxFinder::trim(const imageproc::BinaryImage& content,
 
     // There is a special case when there is nothing but
     // garbage on the page.  Let's try to handle it here.
-    if ((removed_area.width() < 6) || (removed_area.height() < 6)) {
+    if ((removed_area.width() < 3) || (removed_area.height() < 3)) {
       break;
     }
 
@@ -1142,7 +1200,7 @@ QRect ContentBoxFinder::trim(const imageproc::BinaryImage& content,
     ++total_pixels;  // just in case
     const double min_text_influence = 0.2;
     const double max_text_influence = 1.0;
-    const int upper_threshold = 5000;
+    const int upper_threshold = 1250;  // ~5000 at 150 dpi.
     double text_influence = max_text_influence;
     if (num_text_pixels < upper_threshold) {
       text_influence = min_text_influence
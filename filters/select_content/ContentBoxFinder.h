@@ -46,6 +46,13 @@ class ContentBoxFinder {
  private:
   class Garbage;
 
+  /**
+   * Takes a content rectangle detected on the 2x reduced image, already
+   * mapped to full resolution coordinates, and snaps its edges to the
+   * actual content of the full resolution image.
+   */
+  static QRect refineEdgesAtFullRes(const imageproc::BinaryImage& bw150, const QRect& content_rect);
+
   static void segmentGarbage(const imageproc::BinaryImage& garbage,
                              imageproc::BinaryImage& hor_garbage,
                              imageproc::BinaryImage& vert_garbage,
@@ -41,11 +41,7 @@
 
 namespace select_content {
 Filter::Filter(const PageSelectionAccessor& page_selection_accessor)
-    : m_settings(new Settings), m_selectedPageOrder(0) {
-  if (CommandLine::get().isGui()) {
-    m_optionsWidget.reset(new OptionsWidget(m_settings, page_selection_accessor));
-  }
-
+    : m_settings(new Settings), m_pageSelectionAccessor(page_selection_accessor), m_selectedPageOrder(0) {
   const PageOrderOption::ProviderPtr default_order;
   const auto order_by_width = make_intrusive<OrderByWidthProvider>(m_settings);
   const auto order_by_height = make_intrusive<OrderByHeightProvider>(m_settings);
@@ -84,8 +80,9 @@ void Filter::performRelinking(const AbstractRelinker& relinker) {
 }
 
 void Filter::preUpdateUI(FilterUiInterface* ui, const PageInfo& page_info) {
-  m_optionsWidget->preUpdateUI(page_info);
-  ui->setOptionsWidget(m_optionsWidget.get(), ui->KEEP_OWNERSHIP);
+  OptionsWidget* const options_widget = optionsWidget();
+  options_widget->preUpdateUI(page_info);
+  ui->setOptionsWidget(options_widget, ui->KEEP_OWNERSHIP);
 }
 
 QDomElement Filter::saveSettings(const ProjectWriter& writer, QDomDocument& doc) const {
@@ -160,6 +157,10 @@ intrusive_ptr<Task> Filter::createTask(const PageId& page_id,
   return make_intrusive<Task>(intrusive_ptr<Filter>(this), std::move(next_task), m_settings, page_id, batch, debug);
 }
 
+DirtyPages Filter::fetchDirtyPages() {
+  return m_settings->fetchDirtyPages();
+}
+
 intrusive_ptr<CacheDrivenTask> Filter::createCacheDrivenTask(intrusive_ptr<page_layout::CacheDrivenTask> next_task) {
   return make_intrusive<CacheDrivenTask>(m_settings, std::move(next_task));
 }
@@ -185,6 +186,10 @@ void Filter::loadDefaultSettings(const PageInfo& page_info) {
 }
 
 OptionsWidget* Filter::optionsWidget() {
+  if (!m_optionsWidget.get() && CommandLine::get().isGui()) {
+    m_optionsWidget.reset(new OptionsWidget(m_settings, m_pageSelectionAccessor));
+  }
+
   return m_optionsWidget.get();
 }
 
@@ -25,12 +25,12 @@
 #include "FilterResult.h"
 #include "NonCopyable.h"
 #include "PageOrderOption.h"
+#include "PageSelectionAccessor.h"
 #include "PageView.h"
 #include "SafeDeletingQObjectPtr.h"
 #include "Settings.h"
 #include "intrusive_ptr.h"
 
-class PageSelectionAccessor;
 class QString;
 
 namespace page_layout {
@@ -82,11 +82,15 @@ class Filter : public AbstractFilter {
 
   OptionsWidget* optionsWidget();
 
+  /** \see Settings::fetchDirtyPages() */
+  DirtyPages fetchDirtyPages();
+
  private:
   void writePageSettings(QDomDocument& doc, QDomElement& filter_el, const PageId& page_id, int numeric_id) const;
 
 
   intrusive_ptr<Settings> m_settings;
+  PageSelectionAccessor m_pageSelectionAccessor;
   SafeDeletingQObjectPtr<OptionsWidget> m_optionsWidget;
   std::vector<PageOrderOption> m_pageOrderOptions;
   int m_selectedPageOrder;
@@ -19,6 +19,8 @@
 #ifndef SELECT_CONTENT_ORDER_BY_HEIGHT_PROVIDER_H_
 #define SELECT_CONTENT_ORDER_BY_HEIGHT_PROVIDER_H_
 
+#include <QSizeF>
+#include "FlatHashMap.h"
 #include "PageOrderProvider.h"
 #include "Settings.h"
 #include "intrusive_ptr.h"
@@ -33,8 +35,13 @@ class OrderByHeightProvider : public PageOrderProvider {
                 const PageId& rhs_page,
                 bool rhs_incomplete) const override;
 
+  void invalidateCachedKeys() const override;
+
  private:
+  QSizeF pageSize(const PageId& page) const;
+
   intrusive_ptr<Settings> m_settings;
+  mutable FlatHashMap<PageId, QSizeF> m_cachedSizes;
 };
 }  // namespace select_content
 #endif
@@ -27,17 +27,8 @@ bool OrderByWidthProvider::precedes(const PageId& lhs_page,
                                     const bool lhs_incomplete,
                                     const PageId& rhs_page,
                                     const bool rhs_incomplete) const {
-  const std::unique_ptr<Params> lhs_params(m_settings->getPageParams(lhs_page));
-  const std::unique_ptr<Params> rhs_params(m_settings->getPageParams(rhs_page));
-
-  QSizeF lhs_size;
-  if (lhs_params) {
-    lhs_size = lhs_params->contentSizeMM();
-  }
-  QSizeF rhs_size;
-  if (rhs_params) {
-    rhs_size = rhs_params->contentSizeMM();
-  }
+  const QSizeF lhs_size(pageSize(lhs_page));
+  const QSizeF rhs_size(pageSize(rhs_page));
 
   const bool lhs_valid = !lhs_incomplete && lhs_size.isValid();
   const bool rhs_valid = !rhs_incomplete && rhs_size.isValid();
@@ -49,4 +40,24 @@ bool OrderByWidthProvider::precedes(const PageId& lhs_page,
 
   return lhs_size.width() < rhs_size.width();
 }
+
+void OrderByWidthProvider::invalidateCachedKeys() const {
+  m_cachedSizes.clear();
+}
+
+QSizeF OrderByWidthProvider::pageSize(const PageId& page) const {
+  const auto it(m_cachedSizes.find(page));
+  if (it != m_cachedSizes.end()) {
+    return it->second;
+  }
+
+  QSizeF size;
+  const std::unique_ptr<Params> params(m_settings->getPageParams(page));
+  if (params) {
+    size = params->contentSizeMM();
+  }
+  m_cachedSizes.insert(std::make_pair(page, size));
+
+  return size;
+}
 }  // namespace select_content
\ No newline at end of file
@@ -40,13 +40,14 @@ Settings::Settings() : m_pageDetectionBox(0.0, 0.0), m_pageDetectionTolerance(0.
 Settings::~Settings() = default;
 
 void Settings::clear() {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   m_pageParams.clear();
   m_deviationProvider.clear();
+  m_dirtyPages.markAll();
 }
 
 void Settings::performRelinking(const AbstractRelinker& relinker) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   PageParams new_params;
 
   for (const PageParams::value_type& kv : m_pageParams) {
@@ -62,22 +63,34 @@ void Settings::performRelinking(const AbstractRelinker& relinker) {
   for (const PageParams::value_type& kv : m_pageParams) {
     m_deviationProvider.addOrUpdate(kv.first);
   }
+
+  m_dirtyPages.markAll();
 }
 
 void Settings::setPageParams(const PageId& page_id, const Params& params) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
+
+  const auto it(m_pageParams.find(page_id));
+  const bool box_changed = (it == m_pageParams.end()) || (it->second.contentRect() != params.contentRect())
+                           || (it->second.pageRect() != params.pageRect())
+                           || !it->second.dependencies().compatibleWith(params.dependencies());
+  if (box_changed) {
+    m_dirtyPages.mark(page_id);
+  }
+
   Utils::mapSetValue(m_pageParams, page_id, params);
   m_deviationProvider.addOrUpdate(page_id);
 }
 
 void Settings::clearPageParams(const PageId& page_id) {
-  QMutexLocker locker(&m_mutex);
+  QWriteLocker locker(&m_rwLock);
   m_pageParams.erase(page_id);
   m_deviationProvider.remove(page_id);
+  m_dirtyPages.mark(page_id);
 }
 
 std::unique_ptr<Params> Settings::getPageParams(const PageId& page_id) const {
-  QMutexLocker locker(&m_mutex);
+  QReadLocker locker(&m_rwLock);
 
   const auto it(m_pageParams.find(page_id));
   if (it != m_pageParams.end()) {
@@ -88,7 +101,7 @@ std::unique_ptr<Params> Settings::getPageParams(const PageId& page_id) const {
 }
 
 bool Settings::isParamsNull(const PageId& page_id) const {
-  QMutexLocker locker(&m_mutex);
+  QReadLocker locker(&m_rwLock);
 
   return (m_pageParams.find(page_id) == m_pageParams.end());
 }
@@ -113,4 +126,13 @@ const DeviationProvider<PageId>& Settings::deviationProvider() const {
   return m_deviationProvider;
 }
 
+DirtyPages Settings::fetchDirtyPages() {
+  QWriteLocker locker(&m_rwLock);
+
+  DirtyPages dirty(m_dirtyPages);
+  m_dirtyPages.clear();
+
+  return dirty;
+}
+
 }  // namespace select_content
\ No newline at end of file
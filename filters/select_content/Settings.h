@@ -20,9 +20,10 @@
 #define SELECT_CONTENT_SETTINGS_H_
 
 #include <DeviationProvider.h>
-#include <QMutex>
+#include <QReadWriteLock>
 #include <memory>
-#include <unordered_map>
+#include "DirtyPages.h"
+#include "FlatHashMap.h"
 #include "NonCopyable.h"
 #include "PageId.h"
 #include "Params.h"
@@ -61,11 +62,22 @@ class Settings : public ref_countable {
 
   const DeviationProvider<PageId>& deviationProvider() const;
 
+  /**
+   * \brief Returns the pages whose content boxes changed since the
+   *        last call and resets the dirty state.
+   *
+   * Used by ContentBoxPropagator to restrict the propagation to the
+   * "Margins" stage to the affected pages.  Re-running the content
+   * detection with an unchanged result doesn't mark a page.
+   */
+  DirtyPages fetchDirtyPages();
+
  private:
-  typedef std::unordered_map<PageId, Params> PageParams;
+  typedef FlatHashMap<PageId, Params> PageParams;
 
-  mutable QMutex m_mutex;
+  mutable QReadWriteLock m_rwLock;
   PageParams m_pageParams;
+  DirtyPages m_dirtyPages;
   QSizeF m_pageDetectionBox;
   double m_pageDetectionTolerance;
   DeviationProvider<PageId> m_deviationProvider;
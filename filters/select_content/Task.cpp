@@ -17,6 +17,7 @@
  */
 
 #include "Task.h"
+#include "BookPriors.h"
 #include "ContentBoxFinder.h"
 #include "DebugImages.h"
 #include "Filter.h"
@@ -25,7 +26,9 @@
 #include "ImageView.h"
 #include "OptionsWidget.h"
 #include "PageFinder.h"
+#include "PageTimingRegistry.h"
 #include "TaskStatus.h"
+#include "Tracer.h"
 #include "filters/page_layout/Task.h"
 
 #include <UnitsProvider.h>
@@ -36,6 +39,16 @@
 using namespace imageproc;
 
 namespace select_content {
+namespace {
+/** True when \p inner lies on or beyond an edge of \p outer. */
+bool touchesBoundary(const QRectF& inner, const QRectF& outer) {
+  const double eps = 1e-3;
+
+  return (inner.left() <= outer.left() + eps) || (inner.top() <= outer.top() + eps)
+         || (inner.right() >= outer.right() - eps) || (inner.bottom() >= outer.bottom() - eps);
+}
+}  // namespace
+
 class Task::UiUpdater : public FilterResult {
  public:
   UiUpdater(intrusive_ptr<Filter> filter,
@@ -83,6 +96,9 @@ Task::Task(intrusive_ptr<Filter> filter,
 Task::~Task() = default;
 
 FilterResultPtr Task::process(const TaskStatus& status, const FilterData& data) {
+  TRACE_SCOPE("select_content: process");
+  const PageTimingRegistry::StageScope timing_scope(m_pageId, "select_content");
+
   status.throwIfCancelled();
 
   std::unique_ptr<Params> params(m_settings->getPageParams(m_pageId));
@@ -128,7 +144,25 @@ FilterResultPtr Task::process(const TaskStatus& status, const FilterData& data)
 
     if (need_update_content_box) {
       if (new_params.contentDetectionMode() == MODE_AUTO) {
-        content_rect = ContentBoxFinder::findContentBox(status, data, page_rect, m_dbg.get());
+        // A book with consistent margins gets its content searched for
+        // only where the previous pages had it, with a generous slack.
+        QRectF search_rect(page_rect);
+        const bool have_prior = BookPriors::instance().shrinkToContentBand(search_rect);
+
+        content_rect = ContentBoxFinder::findContentBox(status, data, search_rect, m_dbg.get());
+        if (have_prior && (!content_rect.isValid() || touchesBoundary(content_rect, search_rect))) {
+          // Content at the edge of the narrowed search area may
+          // continue beyond it - redo against the whole page box.
+          content_rect = ContentBoxFinder::findContentBox(status, data, page_rect, m_dbg.get());
+        }
+
+        if (content_rect.isValid() && (page_rect.width() > 0) && (page_rect.height() > 0)) {
+          BookPriors::instance().addContentMarginsSample(
+              (content_rect.left() - page_rect.left()) / page_rect.width(),
+              (content_rect.top() - page_rect.top()) / page_rect.height(),
+              (page_rect.right() - content_rect.right()) / page_rect.width(),
+              (page_rect.bottom() - content_rect.bottom()) / page_rect.height());
+        }
       } else if (new_params.contentDetectionMode() == MODE_DISABLED) {
         content_rect = page_rect;
       }
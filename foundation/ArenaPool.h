@@ -0,0 +1,174 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARENA_POOL_H_
+#define ARENA_POOL_H_
+
+#include <boost/intrusive/list.hpp>
+#include <cstddef>
+#include <type_traits>
+#include "NonCopyable.h"
+#include "RecyclingPool.h"
+
+/**
+ * \brief A resettable variant of DynamicPool.
+ *
+ * Like DynamicPool, this one bump-allocates sequences of objects from
+ * chunks, with no way of freeing them individually.  The differences:
+ * reset() rewinds the pool in bulk, keeping the chunks for the next
+ * round of allocations, and chunk storage comes from RecyclingPool, so
+ * it recycles through the calling thread's freelists instead of the
+ * global heap.  Code that builds and drops a pool per iteration -- the
+ * linear algebra temporaries behind spline fitting being the motivating
+ * case -- keeps reusing the same warm blocks, and parallel page tasks
+ * doing so never contend on the heap lock.
+ *
+ * Since neither reset() nor chunk reuse runs destructors, T is required
+ * to be trivially destructible.  The returned objects are uninitialized.
+ *
+ * A pool instance is meant to be used by one thread at a time, just
+ * like DynamicPool.
+ */
+template <typename T>
+class ArenaPool {
+  DECLARE_NON_COPYABLE(ArenaPool)
+
+  static_assert(std::is_trivially_destructible<T>::value, "ArenaPool recycles storage without running destructors");
+
+ public:
+  ArenaPool() {}
+
+  ~ArenaPool();
+
+  /**
+   * \brief Allocates a sequence of uninitialized objects.
+   */
+  T* alloc(size_t num_elements);
+
+  /**
+   * \brief Invalidates everything allocated so far, keeping the chunks.
+   *
+   * Subsequent allocations are served from the retained chunks before
+   * any new storage is requested.
+   */
+  void reset();
+
+ private:
+  enum { OVERALLOCATION_FACTOR = 3 };
+
+  /**< Allocate 3 times the requested size. */
+  enum { OVERALLOCATION_LIMIT = 256 };
+
+  /**< Don't overallocate too much. */
+
+  struct Chunk : public boost::intrusive::list_base_hook<> {
+    T* storage;
+    size_t sizeElements;
+    T* pData;
+    size_t remainingElements;
+
+    Chunk(size_t size)
+        : storage(static_cast<T*>(RecyclingPool::alloc(size * sizeof(T)))),
+          sizeElements(size),
+          pData(storage),
+          remainingElements(size) {}
+
+    ~Chunk() { RecyclingPool::release(storage, sizeElements * sizeof(T)); }
+
+    void rewind() {
+      pData = storage;
+      remainingElements = sizeElements;
+    }
+  };
+
+  struct DeleteDisposer {
+    void operator()(Chunk* chunk) { delete chunk; }
+  };
+
+  typedef boost::intrusive::list<Chunk, boost::intrusive::constant_time_size<false>> ChunkList;
+
+  static size_t adviseChunkSize(size_t num_elements);
+
+  ChunkList m_chunkList;
+
+  /** Chunks rewound by reset(), waiting to be re-used. */
+  ChunkList m_freeChunks;
+};
+
+
+template <typename T>
+ArenaPool<T>::~ArenaPool() {
+  m_chunkList.clear_and_dispose(DeleteDisposer());
+  m_freeChunks.clear_and_dispose(DeleteDisposer());
+}
+
+template <typename T>
+T* ArenaPool<T>::alloc(size_t num_elements) {
+  Chunk* chunk = 0;
+
+  if (!m_chunkList.empty()) {
+    chunk = &m_chunkList.back();
+    if (chunk->remainingElements < num_elements) {
+      chunk = 0;
+    }
+  }
+
+  if (!chunk) {
+    // Try one of the chunks retained by reset().
+    for (typename ChunkList::iterator it(m_freeChunks.begin()); it != m_freeChunks.end(); ++it) {
+      if (it->remainingElements >= num_elements) {
+        chunk = &*it;
+        m_chunkList.splice(m_chunkList.end(), m_freeChunks, it);
+        break;
+      }
+    }
+  }
+
+  if (!chunk) {
+    // Create a new chunk.
+    const size_t chunk_size = adviseChunkSize(num_elements);
+    chunk = &*m_chunkList.insert(m_chunkList.end(), *new Chunk(chunk_size));
+  }
+
+  // Allocate from chunk.
+  T* data = chunk->pData;
+  chunk->pData += num_elements;
+  chunk->remainingElements -= num_elements;
+
+  return data;
+}
+
+template <typename T>
+void ArenaPool<T>::reset() {
+  for (typename ChunkList::iterator it(m_chunkList.begin()); it != m_chunkList.end(); ++it) {
+    it->rewind();
+  }
+  m_freeChunks.splice(m_freeChunks.end(), m_chunkList);
+}
+
+template <typename T>
+size_t ArenaPool<T>::adviseChunkSize(size_t num_elements) {
+  size_t factor = OVERALLOCATION_LIMIT / num_elements;
+  if (factor > (size_t) OVERALLOCATION_FACTOR) {
+    factor = OVERALLOCATION_FACTOR;
+  }
+
+  return num_elements * (factor + 1);
+}
+
+#endif  // ifndef ARENA_POOL_H_
@@ -0,0 +1,304 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLAT_HASH_MAP_H_
+#define FLAT_HASH_MAP_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief An open-addressing hash map with linear probing.
+ *
+ * Entries live in one contiguous array with no per-node allocations,
+ * so a lookup is a hash, a couple of adjacent probes and done -- no
+ * pointer chasing through separately allocated nodes the way
+ * std::unordered_map does it.  Deletion backward-shifts the following
+ * probe run instead of leaving tombstones, keeping probe distances
+ * short no matter the workload.
+ *
+ * The interface follows the std::unordered_map subset the per-page
+ * settings tables actually use.  The important difference: iterators
+ * AND references are invalidated by any insertion or erasure.  Don't
+ * hold either across a modification.
+ */
+template <typename Key, typename T, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class FlatHashMap {
+ public:
+  typedef std::pair<Key, T> value_type;
+
+  template <typename MapPtr, typename ValueRef>
+  class iter {
+    friend class FlatHashMap;
+
+   public:
+    iter() : m_map(nullptr), m_index(0) {}
+
+    // Allows implicit iterator -> const_iterator conversion.
+    template <typename OtherMapPtr, typename OtherValueRef>
+    iter(const iter<OtherMapPtr, OtherValueRef>& other) : m_map(other.m_map), m_index(other.m_index) {}
+
+    ValueRef& operator*() const { return m_map->valueAt(m_index); }
+
+    ValueRef* operator->() const { return &m_map->valueAt(m_index); }
+
+    iter& operator++() {
+      ++m_index;
+      skipEmpty();
+
+      return *this;
+    }
+
+    bool operator==(const iter& other) const { return m_index == other.m_index; }
+
+    bool operator!=(const iter& other) const { return m_index != other.m_index; }
+
+   private:
+    template <typename OtherMapPtr, typename OtherValueRef>
+    friend class iter;
+
+    iter(MapPtr map, std::size_t index) : m_map(map), m_index(index) {}
+
+    void skipEmpty() {
+      while ((m_index < m_map->bucketCount()) && !m_map->m_states[m_index]) {
+        ++m_index;
+      }
+    }
+
+    MapPtr m_map;
+    std::size_t m_index;
+  };
+
+  typedef iter<FlatHashMap*, value_type> iterator;
+  typedef iter<const FlatHashMap*, const value_type> const_iterator;
+
+  FlatHashMap() = default;
+
+  FlatHashMap(const FlatHashMap& other) {
+    for (const value_type& kv : other) {
+      insert(kv);
+    }
+  }
+
+  FlatHashMap(FlatHashMap&& other) noexcept { swap(other); }
+
+  FlatHashMap& operator=(const FlatHashMap& other) {
+    if (this != &other) {
+      FlatHashMap(other).swap(*this);
+    }
+
+    return *this;
+  }
+
+  FlatHashMap& operator=(FlatHashMap&& other) noexcept {
+    FlatHashMap(std::move(other)).swap(*this);
+
+    return *this;
+  }
+
+  ~FlatHashMap() { clear(); }
+
+  bool empty() const { return m_size == 0; }
+
+  std::size_t size() const { return m_size; }
+
+  void clear() {
+    for (std::size_t i = 0; i < bucketCount(); ++i) {
+      if (m_states[i]) {
+        destroyAt(i);
+      }
+    }
+    m_states.assign(m_states.size(), 0);
+    m_size = 0;
+  }
+
+  void swap(FlatHashMap& other) noexcept {
+    m_states.swap(other.m_states);
+    m_slots.swap(other.m_slots);
+    std::swap(m_size, other.m_size);
+  }
+
+  iterator begin() {
+    iterator it(this, 0);
+    it.skipEmpty();
+
+    return it;
+  }
+
+  const_iterator begin() const {
+    const_iterator it(this, 0);
+    it.skipEmpty();
+
+    return it;
+  }
+
+  iterator end() { return iterator(this, bucketCount()); }
+
+  const_iterator end() const { return const_iterator(this, bucketCount()); }
+
+  iterator find(const Key& key) { return iterator(this, findIndex(key)); }
+
+  const_iterator find(const Key& key) const { return const_iterator(this, findIndex(key)); }
+
+  std::size_t count(const Key& key) const { return findIndex(key) == bucketCount() ? 0 : 1; }
+
+  std::pair<iterator, bool> insert(const value_type& kv) {
+    const std::size_t existing = findIndex(kv.first);
+    if (existing != bucketCount()) {
+      return std::make_pair(iterator(this, existing), false);
+    }
+
+    growIfNeeded();
+    const std::size_t index = placeAt(firstFreeSlot(kv.first), value_type(kv));
+
+    return std::make_pair(iterator(this, index), true);
+  }
+
+  T& operator[](const Key& key) {
+    const std::size_t existing = findIndex(key);
+    if (existing != bucketCount()) {
+      return valueAt(existing).second;
+    }
+
+    growIfNeeded();
+    const std::size_t index = placeAt(firstFreeSlot(key), value_type(key, T()));
+
+    return valueAt(index).second;
+  }
+
+  std::size_t erase(const Key& key) {
+    std::size_t index = findIndex(key);
+    if (index == bucketCount()) {
+      return 0;
+    }
+
+    const std::size_t mask = bucketCount() - 1;
+    destroyAt(index);
+
+    // Backward-shift the probe run that follows, so lookups never
+    // need tombstones.  An element moves into the vacated slot if its
+    // home bucket precedes it (cyclically) by at least as much as the
+    // vacancy does.
+    std::size_t hole = index;
+    for (std::size_t probe = (hole + 1) & mask; m_states[probe]; probe = (probe + 1) & mask) {
+      const std::size_t home = homeBucket(valueAt(probe).first);
+      if (((probe - home) & mask) >= ((probe - hole) & mask)) {
+        constructAt(hole, std::move(valueAt(probe)));
+        destroyAt(probe);
+        m_states[hole] = 1;
+        m_states[probe] = 0;
+        hole = probe;
+      }
+    }
+    m_states[hole] = 0;
+    --m_size;
+
+    return 1;
+  }
+
+ private:
+  struct Slot {
+    typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage;
+  };
+
+  std::size_t bucketCount() const { return m_states.size(); }
+
+  value_type& valueAt(std::size_t index) { return *reinterpret_cast<value_type*>(&m_slots[index].storage); }
+
+  const value_type& valueAt(std::size_t index) const {
+    return *reinterpret_cast<const value_type*>(&m_slots[index].storage);
+  }
+
+  void constructAt(std::size_t index, value_type&& kv) { new (&m_slots[index].storage) value_type(std::move(kv)); }
+
+  void destroyAt(std::size_t index) { valueAt(index).~value_type(); }
+
+  std::size_t homeBucket(const Key& key) const { return Hash()(key) & (bucketCount() - 1); }
+
+  /** The index of the key, or bucketCount() when absent. */
+  std::size_t findIndex(const Key& key) const {
+    if (m_size == 0) {
+      return bucketCount();
+    }
+
+    const std::size_t mask = bucketCount() - 1;
+    for (std::size_t i = homeBucket(key); m_states[i]; i = (i + 1) & mask) {
+      if (KeyEqual()(valueAt(i).first, key)) {
+        return i;
+      }
+    }
+
+    return bucketCount();
+  }
+
+  std::size_t firstFreeSlot(const Key& key) const {
+    const std::size_t mask = bucketCount() - 1;
+    std::size_t i = homeBucket(key);
+    while (m_states[i]) {
+      i = (i + 1) & mask;
+    }
+
+    return i;
+  }
+
+  std::size_t placeAt(std::size_t index, value_type&& kv) {
+    constructAt(index, std::move(kv));
+    m_states[index] = 1;
+    ++m_size;
+
+    return index;
+  }
+
+  /** Keeps the load factor below 3/4, rehashing into twice the buckets. */
+  void growIfNeeded() {
+    if ((m_size + 1) * 4 <= bucketCount() * 3) {
+      return;
+    }
+
+    const std::size_t new_buckets = bucketCount() == 0 ? 16 : bucketCount() * 2;
+
+    std::vector<uint8_t> old_states;
+    std::vector<Slot> old_slots;
+    old_states.swap(m_states);
+    old_slots.swap(m_slots);
+
+    m_states.assign(new_buckets, 0);
+    m_slots.resize(new_buckets);
+    m_size = 0;
+
+    for (std::size_t i = 0; i < old_states.size(); ++i) {
+      if (old_states[i]) {
+        value_type& kv = *reinterpret_cast<value_type*>(&old_slots[i].storage);
+        placeAt(firstFreeSlot(kv.first), std::move(kv));
+        kv.~value_type();
+      }
+    }
+  }
+
+  std::vector<uint8_t> m_states;  // 1 for an occupied bucket.  Sized to a power of two.
+  std::vector<Slot> m_slots;
+  std::size_t m_size = 0;
+};
+
+#endif  // ifndef FLAT_HASH_MAP_H_
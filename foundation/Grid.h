@@ -19,7 +19,11 @@
 #ifndef GRID_H_
 #define GRID_H_
 
-#include <boost/scoped_array.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "MemoryBudgetManager.h"
+#include "RecyclingPool.h"
 
 template <typename Node>
 class Grid {
@@ -31,6 +35,11 @@ class Grid {
 
   /**
    * \brief Creates a width x height grid with specified padding on each side.
+   *
+   * When sizeof(Node) is a power of 2 not exceeding 64, the first interior
+   * node of every row is aligned on a 64 byte boundary, with the stride
+   * rounded up as necessary.  The extra nodes this introduces behave like
+   * additional right-side padding.
    */
   Grid(int width, int height, int padding);
 
@@ -41,6 +50,10 @@ class Grid {
    */
   Grid(const Grid& other);
 
+  ~Grid();
+
+  Grid& operator=(const Grid&) = delete;
+
   bool isNull() const { return m_width <= 0 || m_height <= 0; }
 
   void initPadding(const Node& padding_node);
@@ -60,12 +73,12 @@ class Grid {
   /**
    * \brief Returns a pointer to the beginning of padded data.
    */
-  Node* paddedData() { return m_storage.get(); }
+  Node* paddedData() { return m_paddedData; }
 
   /**
    * \brief Returns a pointer to the beginning of padded data.
    */
-  const Node* paddedData() const { return m_storage.get(); }
+  const Node* paddedData() const { return m_paddedData; }
 
   /**
    * Returns the number of nodes in a row, including padding nodes.
@@ -90,6 +103,8 @@ class Grid {
   void swap(Grid& other);
 
  private:
+  enum { ALIGNMENT_BYTES = 64 };
+
   template <typename T>
   static void basicSwap(T& o1, T& o2) {
     // Just to avoid incoduing the heavy <algorithm> header.
@@ -98,8 +113,20 @@ class Grid {
     o2 = tmp;
   }
 
-  boost::scoped_array<Node> m_storage;
+  /** The number of nodes per ALIGNMENT_BYTES, or 1 if unattainable. */
+  static int alignmentUnits();
+
+  /** width + padding * 2, rounded up to a multiple of alignmentUnits(). */
+  static int alignedStride(int width, int padding);
+
+  void allocStorage(int height_with_padding);
+
+  void freeStorage();
+
+  Node* m_storage;
+  Node* m_paddedData;
   Node* m_data;
+  size_t m_storageSize;
   int m_width;
   int m_height;
   int m_stride;
@@ -108,39 +135,99 @@ class Grid {
 
 
 template <typename Node>
-Grid<Node>::Grid() : m_data(0), m_width(0), m_height(0), m_stride(0), m_padding(0) {}
+Grid<Node>::Grid()
+    : m_storage(0), m_paddedData(0), m_data(0), m_storageSize(0), m_width(0), m_height(0), m_stride(0), m_padding(0) {}
 
 template <typename Node>
 Grid<Node>::Grid(int width, int height, int padding)
-    : m_storage(new Node[(width + padding * 2) * (height + padding * 2)]),
-      m_data(m_storage.get() + (width + padding * 2) * padding + padding),
-      m_width(width),
-      m_height(height),
-      m_stride(width + padding * 2),
-      m_padding(padding) {}
+    : m_width(width), m_height(height), m_stride(alignedStride(width, padding)), m_padding(padding) {
+  allocStorage(height + padding * 2);
+}
 
 template <typename Node>
 Grid<Node>::Grid(const Grid& other)
-    : m_storage(new Node[(other.stride() * (other.height() + other.padding() * 2))]),
-      m_data(m_storage.get() + other.stride() * other.padding() + other.padding()),
-      m_width(other.width()),
-      m_height(other.height()),
-      m_stride(other.stride()),
-      m_padding(other.padding()) {
-  const int len = m_stride * (m_height + m_padding * 2);
-  for (int i = 0; i < len; ++i) {
-    m_storage[i] = other.m_storage[i];
+    : m_width(other.width()), m_height(other.height()), m_stride(other.stride()), m_padding(other.padding()) {
+  allocStorage(m_height + m_padding * 2);
+
+  const size_t len = size_t(m_stride) * (m_height + m_padding * 2);
+  for (size_t i = 0; i < len; ++i) {
+    m_paddedData[i] = other.m_paddedData[i];
+  }
+}
+
+template <typename Node>
+Grid<Node>::~Grid() {
+  freeStorage();
+}
+
+template <typename Node>
+int Grid<Node>::alignmentUnits() {
+  // Alignment is only attainable for node sizes that divide the boundary.
+  if (((sizeof(Node) & (sizeof(Node) - 1)) != 0) || (sizeof(Node) > size_t(ALIGNMENT_BYTES))) {
+    return 1;
+  }
+
+  return int(size_t(ALIGNMENT_BYTES) / sizeof(Node));
+}
+
+template <typename Node>
+int Grid<Node>::alignedStride(const int width, const int padding) {
+  const int units = alignmentUnits();
+  const int min_stride = width + padding * 2;
+
+  return (min_stride + units - 1) / units * units;
+}
+
+template <typename Node>
+void Grid<Node>::allocStorage(const int height_with_padding) {
+  const int units = alignmentUnits();
+  m_storageSize = size_t(m_stride) * height_with_padding + (units - 1);
+
+  if (std::is_trivial<Node>::value) {
+    // Trivial nodes don't need construction, so their storage can come
+    // from the recycling pool.  Hot loops repeatedly allocating
+    // same-shape grids then reuse one block instead of hitting the heap.
+    m_storage = static_cast<Node*>(RecyclingPool::alloc(m_storageSize * sizeof(Node)));
+  } else {
+    m_storage = new Node[m_storageSize];
+  }
+  MemoryBudgetManager::instance().recordAllocation(m_storageSize * sizeof(Node));
+
+  Node* padded_data = m_storage;
+  if (units > 1) {
+    const uintptr_t interior_addr = uintptr_t(padded_data + size_t(m_stride) * m_padding + m_padding);
+    const uintptr_t misalignment = interior_addr % ALIGNMENT_BYTES;
+    if (misalignment != 0) {
+      padded_data += (ALIGNMENT_BYTES - misalignment) / sizeof(Node);
+    }
+  }
+  m_paddedData = padded_data;
+  m_data = m_paddedData + size_t(m_stride) * m_padding + m_padding;
+}
+
+template <typename Node>
+void Grid<Node>::freeStorage() {
+  if (!m_storage) {
+    return;
+  }
+
+  if (std::is_trivial<Node>::value) {
+    RecyclingPool::release(m_storage, m_storageSize * sizeof(Node));
+  } else {
+    delete[] m_storage;
   }
+  MemoryBudgetManager::instance().recordRelease(m_storageSize * sizeof(Node));
+  m_storage = 0;
 }
 
 template <typename Node>
 void Grid<Node>::initPadding(const Node& padding_node) {
-  if (m_padding == 0) {
+  if ((m_padding == 0) && (m_stride == m_width)) {
     // No padding.
     return;
   }
 
-  Node* line = m_storage.get();
+  Node* line = m_paddedData;
   for (int row = 0; row < m_padding; ++row) {
     for (int x = 0; x < m_stride; ++x) {
       line[x] = padding_node;
@@ -152,7 +239,8 @@ void Grid<Node>::initPadding(const Node& padding_node) {
     for (int col = 0; col < m_padding; ++col) {
       line[col] = padding_node;
     }
-    for (int col = m_stride - m_padding; col < m_stride; ++col) {
+    // Alignment nodes at the end of a row act as extra padding.
+    for (int col = m_padding + m_width; col < m_stride; ++col) {
       line[col] = padding_node;
     }
     line += m_stride;
@@ -179,8 +267,10 @@ void Grid<Node>::initInterior(const Node& interior_node) {
 
 template <typename Node>
 void Grid<Node>::swap(Grid& other) {
-  m_storage.swap(other.m_storage);
+  basicSwap(m_storage, other.m_storage);
+  basicSwap(m_paddedData, other.m_paddedData);
   basicSwap(m_data, other.m_data);
+  basicSwap(m_storageSize, other.m_storageSize);
   basicSwap(m_width, other.m_width);
   basicSwap(m_height, other.m_height);
   basicSwap(m_stride, other.m_stride);
@@ -49,3 +49,19 @@ QPoint GridLineTraverser::next() {
 
   return pt.toPoint();
 }
+
+void GridLineTraverser::traverse(std::vector<QPoint>& cells) {
+  cells.reserve(cells.size() + (m_totalStops - m_stopsDone));
+
+  // Same arithmetic as next(), so the emitted cells match exactly.
+  for (int i = m_stopsDone; i < m_totalStops; ++i) {
+    cells.push_back(m_line.pointAt(i * m_dt).toPoint());
+  }
+  m_stopsDone = m_totalStops;
+}
+
+void GridLineTraverser::traverse(const std::vector<QLineF>& lines, std::vector<QPoint>& cells) {
+  for (const QLineF& line : lines) {
+    GridLineTraverser(line).traverse(cells);
+  }
+}
@@ -20,6 +20,7 @@
 #define GRID_LINE_TRAVERSER_H_
 
 #include <QLineF>
+#include <vector>
 
 /**
  * \brief Traverses a grid along a line segment.
@@ -35,6 +36,21 @@ class GridLineTraverser {
 
   QPoint next();
 
+  /**
+   * \brief Appends all remaining cells to \p cells in one call.
+   *
+   * Equivalent to draining next() in a loop, minus the per-step call
+   * overhead; the generation loop is a plain arithmetic sweep the
+   * compiler can vectorize.  The buffer isn't cleared, so the cells
+   * of several lines can be collected back to back.
+   */
+  void traverse(std::vector<QPoint>& cells);
+
+  /**
+   * \brief Collects the cells of a bundle of lines into one buffer.
+   */
+  static void traverse(const std::vector<QLineF>& lines, std::vector<QPoint>& cells);
+
  private:
   QLineF m_line;
   double m_dt;
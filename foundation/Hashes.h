@@ -3,21 +3,98 @@
 #define SCANTAILOR_HASHES_H
 
 #include <QtCore/QString>
+#include <cstdint>
+#include <cstring>
 
 namespace hashes {
+namespace detail {
+/** Multiplies two 64-bit values and folds the 128-bit product into 64 bits. */
+inline uint64_t mum(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+  const unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+
+  return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#else
+  // The same thing built from four 32x32 -> 64 products.
+  const uint64_t ha = a >> 32, la = static_cast<uint32_t>(a);
+  const uint64_t hb = b >> 32, lb = static_cast<uint32_t>(b);
+  const uint64_t rh = ha * hb;
+  const uint64_t rm0 = ha * lb;
+  const uint64_t rm1 = hb * la;
+  const uint64_t rl = la * lb;
+  const uint64_t t = rl + (rm0 << 32);
+  const uint64_t lo = t + (rm1 << 32);
+  const uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+
+  return lo ^ hi;
+#endif
+}
+
+inline uint64_t load64(const unsigned char* p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+
+  return v;
+}
+
+inline uint64_t load32(const unsigned char* p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+
+  return v;
+}
+}  // namespace detail
+
+/**
+ * \brief A fast wyhash-style hash over a byte buffer.
+ *
+ * Consumes 16 bytes per multiply-fold round, so long keys (file paths)
+ * cost a fraction of what a byte-at-a-time hash does, while short keys
+ * still get full 64-bit avalanche from the final rounds.
+ */
+inline std::size_t hashBytes(const void* data, std::size_t len, uint64_t seed = 0) {
+  const uint64_t k1 = 0xe7037ed1a0b428dbull;
+  const uint64_t k2 = 0x8ebc6af09c88c6e3ull;
+  const uint64_t k3 = 0x589965cc75374cc3ull;
+  const auto* p = static_cast<const unsigned char*>(data);
+  uint64_t h = seed ^ 0xa0761d6478bd642full;
+
+  std::size_t remaining = len;
+  while (remaining >= 16) {
+    h = detail::mum(detail::load64(p) ^ k1, detail::load64(p + 8) ^ h ^ k2);
+    p += 16;
+    remaining -= 16;
+  }
+
+  uint64_t a = 0, b = 0;
+  if (remaining >= 8) {
+    a = detail::load64(p);
+    b = detail::load64(p + remaining - 8);
+  } else if (remaining >= 4) {
+    a = detail::load32(p);
+    b = detail::load32(p + remaining - 4);
+  } else if (remaining > 0) {
+    a = (uint64_t(p[0]) << 16) | (uint64_t(p[remaining >> 1]) << 8) | p[remaining - 1];
+  }
+  h = detail::mum(a ^ h ^ k1, b ^ k2);
+  h = detail::mum(h ^ len, k3);
+
+  return static_cast<std::size_t>(h);
+}
+
+/** Mixes another hash value into a seed, avalanching both. */
+inline std::size_t combine(std::size_t seed, std::size_t value) {
+  return static_cast<std::size_t>(detail::mum(seed ^ 0x9e3779b97f4a7c15ull, value ^ 0x165667b19e3779f9ull));
+}
+
 template <typename>
 struct hash;
 
 template <>
 struct hash<QString> {
   std::size_t operator()(const QString& str) const noexcept {
-    const QChar* data = str.constData();
-    std::size_t hash = 5381;
-    for (int i = 0; i < str.size(); ++i) {
-      hash = ((hash << 5) + hash) ^ ((data[i].row() << 8) | data[i].cell());
-    }
-
-    return hash;
+    // QString data is a contiguous array of 16-bit units.
+    return hashBytes(str.constData(), std::size_t(str.size()) * sizeof(QChar));
   }
 };
 }  // namespace hashes
@@ -0,0 +1,338 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOCK_FREE_QUEUE_H_
+#define LOCK_FREE_QUEUE_H_
+
+#include <atomic>
+#include <boost/scoped_array.hpp>
+#include <cassert>
+#include <cstddef>
+#include "NonCopyable.h"
+
+/**
+ * \brief A multi-producer / multi-consumer FIFO queue.
+ *
+ * Like FastQueue, storage is allocated in chunks of many elements,
+ * but unlike FastQueue, push() and pop() may be called from any
+ * number of threads concurrently.
+ *
+ * In BOUNDED mode the queue is a fixed-capacity ring buffer
+ * (the algorithm is Vyukov's bounded MPMC queue) and all operations
+ * are lock-free.  In UNBOUNDED mode chunks are chained on demand;
+ * operations within a chunk are lock-free, while the rare chunk
+ * switches take a short spin lock.
+ *
+ * \note T must be default-constructible and assignable.  pop() may
+ *       transiently report an empty queue while a concurrent push()
+ *       is still writing its element.
+ */
+template <typename T>
+class LockFreeQueue {
+  DECLARE_NON_COPYABLE(LockFreeQueue)
+
+ public:
+  enum Mode { BOUNDED, UNBOUNDED };
+
+  /**
+   * In BOUNDED mode, \p chunk_capacity is the total capacity and is
+   * rounded up to a power of two.  In UNBOUNDED mode it's the size
+   * of each chunk.
+   */
+  explicit LockFreeQueue(Mode mode, size_t chunk_capacity = defaultChunkCapacity());
+
+  ~LockFreeQueue();
+
+  /**
+   * \brief Appends an element to the queue.
+   *
+   * \return false only in BOUNDED mode, when the queue is full.
+   */
+  bool push(const T& t);
+
+  /**
+   * \brief Removes the head element, writing it to \p t.
+   *
+   * \return false if the queue was empty.
+   */
+  bool pop(T& t);
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    T value;
+  };
+
+  struct Chunk {
+    Chunk(size_t capacity, bool single_use) : cells(new Cell[capacity]), enqueuePos(0), dequeuePos(0), next(nullptr) {
+      // Single-use chunks mark filled cells with seq == 1, while in
+      // a ring buffer seq tracks the position a cell is ready for.
+      for (size_t i = 0; i < capacity; ++i) {
+        cells[i].seq.store(single_use ? 0 : i, std::memory_order_relaxed);
+      }
+    }
+
+    boost::scoped_array<Cell> cells;
+    std::atomic<size_t> enqueuePos;
+    std::atomic<size_t> dequeuePos;
+    std::atomic<Chunk*> next;
+  };
+
+  class SpinLockGuard {
+   public:
+    explicit SpinLockGuard(std::atomic_flag& lock) : m_lock(lock) {
+      while (m_lock.test_and_set(std::memory_order_acquire)) {
+      }
+    }
+
+    ~SpinLockGuard() { m_lock.clear(std::memory_order_release); }
+
+   private:
+    std::atomic_flag& m_lock;
+  };
+
+  static size_t defaultChunkCapacity() { return (sizeof(T) >= 4096) ? 64 : 4096 / sizeof(T); }
+
+  static size_t ceilPowerOfTwo(size_t val);
+
+  bool pushBounded(const T& t);
+
+  bool popBounded(T& t);
+
+  bool pushUnbounded(const T& t);
+
+  bool popUnbounded(T& t);
+
+  void maybeFreeRetiredChunks();
+
+  const Mode m_mode;
+  const size_t m_chunkCapacity;
+  std::atomic<Chunk*> m_pushChunk;
+  std::atomic<Chunk*> m_popChunk;
+
+  /**
+   * Retired chunks can't be freed right away, as a stalled consumer
+   * may still hold a pointer to one.  They go to this list instead,
+   * to be freed when nobody is inside push() or pop().
+   */
+  Chunk* m_retiredChunks;
+  std::atomic<int> m_threadsInside;
+  std::atomic_flag m_chunkSwitchLock;
+};
+
+
+template <typename T>
+LockFreeQueue<T>::LockFreeQueue(const Mode mode, const size_t chunk_capacity)
+    : m_mode(mode),
+      m_chunkCapacity(mode == BOUNDED ? ceilPowerOfTwo(chunk_capacity) : chunk_capacity),
+      m_retiredChunks(nullptr),
+      m_threadsInside(0) {
+  assert(chunk_capacity > 0);
+  m_chunkSwitchLock.clear();
+
+  auto* const chunk = new Chunk(m_chunkCapacity, m_mode == UNBOUNDED);
+  m_pushChunk.store(chunk, std::memory_order_relaxed);
+  m_popChunk.store(chunk, std::memory_order_relaxed);
+}
+
+template <typename T>
+LockFreeQueue<T>::~LockFreeQueue() {
+  Chunk* chunk = m_popChunk.load(std::memory_order_relaxed);
+  while (chunk) {
+    Chunk* const next = chunk->next.load(std::memory_order_relaxed);
+    delete chunk;
+    chunk = next;
+  }
+
+  chunk = m_retiredChunks;
+  while (chunk) {
+    Chunk* const next = chunk->next.load(std::memory_order_relaxed);
+    delete chunk;
+    chunk = next;
+  }
+}
+
+template <typename T>
+size_t LockFreeQueue<T>::ceilPowerOfTwo(size_t val) {
+  size_t pot = 1;
+  while (pot < val) {
+    pot <<= 1;
+  }
+
+  return pot;
+}
+
+template <typename T>
+bool LockFreeQueue<T>::push(const T& t) {
+  ++m_threadsInside;
+  const bool ret = (m_mode == BOUNDED) ? pushBounded(t) : pushUnbounded(t);
+  --m_threadsInside;
+
+  return ret;
+}
+
+template <typename T>
+bool LockFreeQueue<T>::pop(T& t) {
+  ++m_threadsInside;
+  const bool ret = (m_mode == BOUNDED) ? popBounded(t) : popUnbounded(t);
+  --m_threadsInside;
+
+  return ret;
+}
+
+template <typename T>
+bool LockFreeQueue<T>::pushBounded(const T& t) {
+  Chunk* const chunk = m_pushChunk.load(std::memory_order_relaxed);
+  const size_t mask = m_chunkCapacity - 1;
+
+  size_t pos = chunk->enqueuePos.load(std::memory_order_relaxed);
+  for (;;) {
+    Cell& cell = chunk->cells[pos & mask];
+    const size_t seq = cell.seq.load(std::memory_order_acquire);
+    if (seq == pos) {
+      if (chunk->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        cell.value = t;
+        cell.seq.store(pos + 1, std::memory_order_release);
+
+        return true;
+      }
+      // pos was reloaded by compare_exchange_weak().
+    } else if (seq < pos) {
+      // A whole lap behind - the queue is full.
+      return false;
+    } else {
+      pos = chunk->enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template <typename T>
+bool LockFreeQueue<T>::popBounded(T& t) {
+  Chunk* const chunk = m_popChunk.load(std::memory_order_relaxed);
+  const size_t mask = m_chunkCapacity - 1;
+
+  size_t pos = chunk->dequeuePos.load(std::memory_order_relaxed);
+  for (;;) {
+    Cell& cell = chunk->cells[pos & mask];
+    const size_t seq = cell.seq.load(std::memory_order_acquire);
+    if (seq == pos + 1) {
+      if (chunk->dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        t = cell.value;
+        cell.value = T();
+        cell.seq.store(pos + mask + 1, std::memory_order_release);
+
+        return true;
+      }
+      // pos was reloaded by compare_exchange_weak().
+    } else if (seq <= pos) {
+      // The cell is yet to be filled - the queue is empty.
+      return false;
+    } else {
+      pos = chunk->dequeuePos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template <typename T>
+bool LockFreeQueue<T>::pushUnbounded(const T& t) {
+  for (;;) {
+    Chunk* const chunk = m_pushChunk.load(std::memory_order_acquire);
+
+    // Unbounded chunks are single-use: positions never wrap around.
+    const size_t pos = chunk->enqueuePos.fetch_add(1, std::memory_order_relaxed);
+    if (pos < m_chunkCapacity) {
+      Cell& cell = chunk->cells[pos];
+      cell.value = t;
+      cell.seq.store(1, std::memory_order_release);
+
+      return true;
+    }
+
+    // The chunk is full - link a new one, unless another producer
+    // has done that already.
+    const SpinLockGuard guard(m_chunkSwitchLock);
+    if (m_pushChunk.load(std::memory_order_relaxed) == chunk) {
+      auto* const new_chunk = new Chunk(m_chunkCapacity, true);
+      chunk->next.store(new_chunk, std::memory_order_release);
+      m_pushChunk.store(new_chunk, std::memory_order_release);
+    }
+  }
+}
+
+template <typename T>
+bool LockFreeQueue<T>::popUnbounded(T& t) {
+  for (;;) {
+    Chunk* const chunk = m_popChunk.load(std::memory_order_acquire);
+
+    size_t pos = chunk->dequeuePos.load(std::memory_order_relaxed);
+    for (;;) {
+      if (pos >= m_chunkCapacity) {
+        // The chunk is fully consumed.
+        break;
+      }
+      if (chunk->cells[pos].seq.load(std::memory_order_acquire) != 1) {
+        // The cell is yet to be filled - the queue is empty.
+        return false;
+      }
+      if (chunk->dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        t = chunk->cells[pos].value;
+        chunk->cells[pos].value = T();
+
+        return true;
+      }
+      // pos was reloaded by compare_exchange_weak().
+    }
+
+    if (!chunk->next.load(std::memory_order_acquire)) {
+      // Fully consumed and nothing follows.
+      return false;
+    }
+
+    // Advance to the next chunk, retiring the consumed one.
+    const SpinLockGuard guard(m_chunkSwitchLock);
+    if (m_popChunk.load(std::memory_order_relaxed) == chunk) {
+      m_popChunk.store(chunk->next.load(std::memory_order_relaxed), std::memory_order_release);
+      chunk->next.store(m_retiredChunks, std::memory_order_relaxed);
+      m_retiredChunks = chunk;
+      maybeFreeRetiredChunks();
+    }
+  }
+}
+
+/**
+ * Frees retired chunks, provided the calling thread is the only one
+ * inside push() or pop().  Any thread that enters later will see the
+ * already advanced m_popChunk and therefore can't obtain a pointer
+ * to a retired chunk.  Must be called with m_chunkSwitchLock held.
+ */
+template <typename T>
+void LockFreeQueue<T>::maybeFreeRetiredChunks() {
+  if (m_threadsInside.load(std::memory_order_acquire) != 1) {
+    return;
+  }
+
+  Chunk* chunk = m_retiredChunks;
+  m_retiredChunks = nullptr;
+  while (chunk) {
+    Chunk* const next = chunk->next.load(std::memory_order_relaxed);
+    delete chunk;
+    chunk = next;
+  }
+}
+
+#endif  // ifndef LOCK_FREE_QUEUE_H_
@@ -0,0 +1,80 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MemoryBudgetManager.h"
+#include <QSettings>
+#include "RecyclingPool.h"
+
+MemoryBudgetManager::MemoryBudgetManager() : m_nextId(0), m_liveBytes(0), m_ceiling(0), m_shedArmed(true) {
+  const qlonglong megabytes = QSettings().value("settings/memory_ceiling_mb", 0).toLongLong();
+  if (megabytes > 0) {
+    m_ceiling.store(size_t(megabytes) * 1024 * 1024, std::memory_order_relaxed);
+  }
+}
+
+thread_local size_t MemoryBudgetManager::tls_liveBytes = 0;
+thread_local size_t MemoryBudgetManager::tls_peakBytes = 0;
+
+MemoryBudgetManager& MemoryBudgetManager::instance() {
+  static MemoryBudgetManager object;
+
+  return object;
+}
+
+void MemoryBudgetManager::setCeiling(const size_t bytes) {
+  m_ceiling.store(bytes, std::memory_order_relaxed);
+}
+
+int MemoryBudgetManager::registerEvictable(const EvictionTier tier, const std::function<void()>& shed) {
+  const QMutexLocker locker(&m_mutex);
+
+  const int id = m_nextId++;
+  m_evictables[tier][id] = shed;
+
+  return id;
+}
+
+void MemoryBudgetManager::unregisterEvictable(const int id) {
+  const QMutexLocker locker(&m_mutex);
+
+  for (auto& tier : m_evictables) {
+    tier.erase(id);
+  }
+}
+
+void MemoryBudgetManager::shedCaches() {
+  // The calling thread is the one that's allocating and therefore under
+  // pressure, so its parked allocator blocks go first.
+  RecyclingPool::trimThreadCache();
+
+  // Holding the mutex while the callbacks run keeps unregisterEvictable()
+  // from pulling a cache out from under us.  The callbacks themselves
+  // only release memory, which is lock-free on our side.
+  const QMutexLocker locker(&m_mutex);
+
+  const size_t ceiling = m_ceiling.load(std::memory_order_relaxed);
+  for (const auto& tier : m_evictables) {
+    if ((ceiling == 0) || (liveBytes() < ceiling - ceiling / 4)) {
+      // Pressure is off; don't punish the remaining caches.
+      break;
+    }
+    for (const auto& entry : tier) {
+      entry.second();
+    }
+  }
+}
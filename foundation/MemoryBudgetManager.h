@@ -0,0 +1,161 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEMORY_BUDGET_MANAGER_H_
+#define MEMORY_BUDGET_MANAGER_H_
+
+#include <QMutex>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include "NonCopyable.h"
+
+/**
+ * \brief Keeps tracked image memory under a configurable ceiling.
+ *
+ * OutOfMemoryHandler only reacts once an allocation has already failed.
+ * This class acts earlier: image classes report their allocations, and
+ * when usage approaches the ceiling, registered caches are asked to shed
+ * memory, cheapest first, before allocations start to fail.
+ */
+class MemoryBudgetManager {
+  DECLARE_NON_COPYABLE(MemoryBudgetManager)
+
+ public:
+  enum EvictionTier {
+    /** Speculatively decoded pages.  They can always be decoded again. */
+    PREFETCHED_PAGES = 0,
+
+    /** In-memory thumbnail pixmaps.  They reload from disk quickly. */
+    THUMBNAIL_PIXMAPS,
+
+    /** Pooled buffers and cached intermediates.  Freeing them only costs re-allocation. */
+    CACHED_INTERMEDIATES,
+
+    NUM_TIERS
+  };
+
+  static MemoryBudgetManager& instance();
+
+  /**
+   * \brief Sets the ceiling in bytes.  Zero disables budgeting.
+   *
+   * The initial value comes from the "settings/memory_ceiling_mb"
+   * setting, with budgeting disabled when it's unset.
+   */
+  void setCeiling(size_t bytes);
+
+  size_t ceiling() const { return m_ceiling.load(std::memory_order_relaxed); }
+
+  /** The number of tracked image bytes currently allocated. */
+  size_t liveBytes() const { return m_liveBytes.load(std::memory_order_relaxed); }
+
+  /** To be called by tracked image classes.  Any thread. */
+  void recordAllocation(size_t bytes);
+
+  void recordRelease(size_t bytes);
+
+  /**
+   * \brief Tracked image bytes allocated and not yet released by the
+   *        calling thread.
+   *
+   * A block released by a different thread than the one that allocated
+   * it is clamped rather than going negative, so the figure is exact
+   * for single-threaded task chains and approximate otherwise.
+   */
+  static size_t threadLiveBytes() { return tls_liveBytes; }
+
+  /** The highest threadLiveBytes() seen since the peak was last set. */
+  static size_t threadPeakBytes() { return tls_peakBytes; }
+
+  /**
+   * \brief Replaces the calling thread's peak, returning the old value.
+   *
+   * Scopes measuring per-stage peaks set the peak to threadLiveBytes()
+   * on entry and restore the maximum of the old and measured peaks on
+   * exit, so that nested scopes compose.
+   */
+  static size_t exchangeThreadPeak(size_t new_peak) {
+    const size_t old_peak = tls_peakBytes;
+    tls_peakBytes = new_peak;
+
+    return old_peak;
+  }
+
+  /**
+   * \brief Registers a cache to be asked to shed memory under pressure.
+   *
+   * The callback may be invoked from any thread and must be thread-safe.
+   * Returns an id to pass to unregisterEvictable() before the cache dies.
+   */
+  int registerEvictable(EvictionTier tier, const std::function<void()>& shed);
+
+  void unregisterEvictable(int id);
+
+ private:
+  MemoryBudgetManager();
+
+  void shedCaches();
+
+  mutable QMutex m_mutex;
+  std::map<int, std::function<void()>> m_evictables[NUM_TIERS];
+  int m_nextId;
+  std::atomic<size_t> m_liveBytes;
+  std::atomic<size_t> m_ceiling;
+
+  /**
+   * Allows one shedding pass per excursion above the high-water mark.
+   * Re-armed once usage falls back below the low-water mark.
+   */
+  std::atomic<bool> m_shedArmed;
+
+  static thread_local size_t tls_liveBytes;
+  static thread_local size_t tls_peakBytes;
+};
+
+
+inline void MemoryBudgetManager::recordAllocation(const size_t bytes) {
+  tls_liveBytes += bytes;
+  if (tls_liveBytes > tls_peakBytes) {
+    tls_peakBytes = tls_liveBytes;
+  }
+
+  const size_t live = m_liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+  const size_t ceiling = m_ceiling.load(std::memory_order_relaxed);
+  if ((ceiling != 0) && (live > ceiling - ceiling / 10)) {
+    if (m_shedArmed.exchange(false, std::memory_order_relaxed)) {
+      shedCaches();
+    }
+  }
+}
+
+inline void MemoryBudgetManager::recordRelease(const size_t bytes) {
+  tls_liveBytes -= std::min(tls_liveBytes, bytes);
+
+  const size_t live = m_liveBytes.fetch_sub(bytes, std::memory_order_relaxed) - bytes;
+
+  const size_t ceiling = m_ceiling.load(std::memory_order_relaxed);
+  if ((ceiling == 0) || (live < ceiling / 2)) {
+    m_shedArmed.store(true, std::memory_order_relaxed);
+  }
+}
+
+#endif  // ifndef MEMORY_BUDGET_MANAGER_H_
@@ -0,0 +1,54 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "OpCounters.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+const char* const counter_names[OpCounters::NUM_COUNTERS] = {
+    "raster_op.calls",      "raster_op.bytes", "morphology.calls", "morphology.bytes",      "transform.calls",
+    "transform.pixels",     "seed_fill.calls", "seed_fill.bytes",  "seed_fill.queue_pops",  "draw_over.bulk_copies",
+    "draw_over.slow_calls",
+};
+}  // namespace
+
+OpCounters::OpCounters() {
+  for (auto& counter : m_counters) {
+    counter.store(0, std::memory_order_relaxed);
+  }
+}
+
+OpCounters::~OpCounters() {
+  if (!std::getenv("SCANTAILOR_OP_COUNTERS")) {
+    return;
+  }
+
+  std::fprintf(stderr, "Operation counters:\n");
+  for (int i = 0; i < NUM_COUNTERS; ++i) {
+    std::fprintf(stderr, "  %-24s %llu\n", counter_names[i],
+                 (unsigned long long) m_counters[i].load(std::memory_order_relaxed));
+  }
+}
+
+OpCounters& OpCounters::instance() {
+  static OpCounters the_instance;
+
+  return the_instance;
+}
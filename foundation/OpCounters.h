@@ -0,0 +1,79 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OP_COUNTERS_H_
+#define OP_COUNTERS_H_
+
+#include <atomic>
+#include <cstdint>
+#include "NonCopyable.h"
+
+/**
+ * \brief Always-on counters of work done by the hot imageproc kernels.
+ *
+ * When a batch is mysteriously slow, these tell apart "doing more work"
+ * (say, a pathological number of seed fill queue pops) from "doing the
+ * same work slower".  Counting is a relaxed atomic add with no branch,
+ * cheap enough to stay compiled in; hot loops accumulate locally and
+ * add once per call.  Setting the SCANTAILOR_OP_COUNTERS environment
+ * variable dumps the totals to stderr at exit.
+ *
+ * Unlike Tracer, which answers "where did the time go", this answers
+ * "how much work was requested", so the two complement each other.
+ */
+class OpCounters {
+  DECLARE_NON_COPYABLE(OpCounters)
+
+ public:
+  enum Counter {
+    RASTER_OP_CALLS,
+    RASTER_OP_BYTES,
+    MORPHOLOGY_CALLS,
+    MORPHOLOGY_BYTES,
+    TRANSFORM_CALLS,
+    TRANSFORM_PIXELS,
+    SEED_FILL_CALLS,
+    SEED_FILL_BYTES,
+    SEED_FILL_QUEUE_POPS,
+    DRAW_OVER_BULK_COPIES,
+    DRAW_OVER_SLOW_CALLS,
+
+    NUM_COUNTERS
+  };
+
+  static void add(const Counter counter, const uint64_t amount) {
+    instance().m_counters[counter].fetch_add(amount, std::memory_order_relaxed);
+  }
+
+  static uint64_t value(const Counter counter) {
+    return instance().m_counters[counter].load(std::memory_order_relaxed);
+  }
+
+ private:
+  OpCounters();
+
+  /** Dumps the totals to stderr if SCANTAILOR_OP_COUNTERS is set. */
+  ~OpCounters();
+
+  static OpCounters& instance();
+
+  std::atomic<uint64_t> m_counters[NUM_COUNTERS];
+};
+
+
+#endif  // ifndef OP_COUNTERS_H_
@@ -0,0 +1,207 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARALLEL_FOR_H_
+#define PARALLEL_FOR_H_
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "NonCopyable.h"
+
+namespace parallel_for_impl {
+inline std::atomic<int>& globalBudgetRef() {
+  static std::atomic<int> budget(0);  // 0 means "all hardware threads".
+
+  return budget;
+}
+
+/** Threads currently counted against the budget: task threads plus helpers. */
+inline std::atomic<int>& activeThreadsRef() {
+  static std::atomic<int> active(0);
+
+  return active;
+}
+
+inline int globalBudget() {
+  const int budget = globalBudgetRef().load(std::memory_order_relaxed);
+  if (budget > 0) {
+    return budget;
+  }
+
+  const unsigned num = std::thread::hardware_concurrency();
+
+  return num > 0 ? int(num) : 1;
+}
+
+/**
+ * Grants between 0 and \p wanted helper tokens, leaving the total
+ * number of active threads within the budget.
+ */
+inline int acquireHelperTokens(const int wanted) {
+  if (wanted <= 0) {
+    return 0;
+  }
+
+  std::atomic<int>& active = activeThreadsRef();
+  const int budget = globalBudget();
+
+  int cur = active.load(std::memory_order_relaxed);
+  while (true) {
+    const int grant = std::min(wanted, budget - cur);
+    if (grant <= 0) {
+      return 0;
+    }
+    if (active.compare_exchange_weak(cur, cur + grant, std::memory_order_relaxed)) {
+      return grant;
+    }
+  }
+}
+
+inline void releaseHelperTokens(const int count) {
+  if (count > 0) {
+    activeThreadsRef().fetch_sub(count, std::memory_order_relaxed);
+  }
+}
+}  // namespace parallel_for_impl
+
+/**
+ * \brief Returns the machine-wide thread budget.  Never less than 1.
+ *
+ * The number of hardware threads by default; the GUI routes the
+ * "system load" setting here through parallelForSetGlobalBudget().
+ */
+inline int parallelForNumThreads() {
+  return parallel_for_impl::globalBudget();
+}
+
+/**
+ * \brief Sets the machine-wide thread budget; zero restores the
+ *        hardware default.
+ *
+ * The budget covers task threads and the helper threads the parallel
+ * kernels inside them spawn, combined: with N tasks in flight, their
+ * kernels share the budget - N remaining tokens dynamically instead
+ * of each assuming it owns the whole machine.
+ */
+inline void parallelForSetGlobalBudget(const int total_threads) {
+  parallel_for_impl::globalBudgetRef().store(std::max(0, total_threads), std::memory_order_relaxed);
+}
+
+/**
+ * \brief Marks the current thread as drawing on the thread budget.
+ *
+ * Task runners (the worker pool, the CLI batch workers) keep one of
+ * these alive for the duration of a task, so that the helper tokens
+ * granted to parallel kernels account for the task threads
+ * themselves.
+ */
+class ParallelForActiveThread {
+  DECLARE_NON_COPYABLE(ParallelForActiveThread)
+
+ public:
+  ParallelForActiveThread() { parallel_for_impl::activeThreadsRef().fetch_add(1, std::memory_order_relaxed); }
+
+  ~ParallelForActiveThread() { parallel_for_impl::activeThreadsRef().fetch_sub(1, std::memory_order_relaxed); }
+};
+
+/**
+ * \brief Splits [begin, end) into contiguous chunks and processes them in parallel.
+ *
+ * \p func is invoked as func(chunk_begin, chunk_end), one chunk per thread,
+ * including the calling thread.  The call returns when all chunks are done.
+ * An exception thrown by any chunk is rethrown in the calling thread once
+ * every worker has joined.  Degenerates to a plain call of
+ * func(begin, end) for single-threaded machines and trivial ranges.
+ *
+ * \p max_threads limits the number of threads used; zero means
+ * "use all hardware threads".
+ */
+template <typename Func>
+void parallelForChunked(const int begin, const int end, Func func, const int max_threads = 0) {
+  const int range = end - begin;
+  if (range <= 0) {
+    return;
+  }
+
+  int num_threads = max_threads > 0 ? std::min(max_threads, parallelForNumThreads()) : parallelForNumThreads();
+  num_threads = std::min(num_threads, range);
+
+  if (num_threads <= 1) {
+    func(begin, end);
+
+    return;
+  }
+
+  // Draw helper tokens from the machine-wide budget.  When concurrent
+  // tasks have the machine busy, few or no tokens are granted and the
+  // loop degenerates toward an inline call; the total number of
+  // active threads stays within the budget no matter how kernels and
+  // tasks compose.
+  const int helper_tokens = parallel_for_impl::acquireHelperTokens(num_threads - 1);
+  if (helper_tokens == 0) {
+    func(begin, end);
+
+    return;
+  }
+  num_threads = helper_tokens + 1;
+
+  const int chunk = (range + num_threads - 1) / num_threads;
+
+  std::mutex eptr_mutex;
+  std::exception_ptr eptr;
+
+  const auto run_chunk = [&](const int chunk_begin, const int chunk_end) {
+    try {
+      func(chunk_begin, chunk_end);
+    } catch (...) {
+      const std::lock_guard<std::mutex> guard(eptr_mutex);
+      if (!eptr) {
+        eptr = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  for (int i = 1; i < num_threads; ++i) {
+    const int chunk_begin = begin + i * chunk;
+    const int chunk_end = std::min(end, chunk_begin + chunk);
+    if (chunk_begin >= chunk_end) {
+      break;
+    }
+    threads.emplace_back(run_chunk, chunk_begin, chunk_end);
+  }
+
+  run_chunk(begin, std::min(end, begin + chunk));
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  parallel_for_impl::releaseHelperTokens(helper_tokens);
+
+  if (eptr) {
+    std::rethrow_exception(eptr);
+  }
+}
+
+#endif  // ifndef PARALLEL_FOR_H_
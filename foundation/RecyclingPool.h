@@ -0,0 +1,168 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RECYCLING_POOL_H_
+#define RECYCLING_POOL_H_
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+/**
+ * \brief Recycles raw memory blocks through thread-local freelists.
+ *
+ * Unlike DynamicPool, which only ever hands memory out, this one takes
+ * blocks back and reuses them.  Sizes are rounded up to powers of two,
+ * so pipelines that create and destroy many same-sized temporaries, as
+ * morphological operations do, keep hitting the freelist instead of the
+ * heap.  The freelists are thread-local: no locking, and a block released
+ * by a worker is handed back to that same worker while it's still warm
+ * in its cache.  Any thread may release a block, whichever thread
+ * allocated it.
+ */
+class RecyclingPool {
+ public:
+  /**
+   * \brief Allocates a block of at least \p size bytes.
+   *
+   * Throws std::bad_alloc on failure.
+   */
+  static void* alloc(size_t size);
+
+  /**
+   * \brief Returns a block obtained from alloc() with the same \p size.
+   */
+  static void release(void* addr, size_t size);
+
+  /**
+   * \brief Frees the blocks parked in the calling thread's freelists.
+   */
+  static void trimThreadCache();
+
+ private:
+  enum { MIN_BUCKET_BITS = 8 };
+
+  /**< Blocks below 256 bytes share the smallest bucket. */
+  enum { MAX_BUCKET_BITS = 24 };
+
+  /**< Blocks beyond 16 MB bypass the pool. */
+  enum { NUM_BUCKETS = MAX_BUCKET_BITS - MIN_BUCKET_BITS + 1 };
+
+  /** Per-thread bound on memory parked in the freelists. */
+  static const size_t MAX_CACHED_BYTES = size_t(64) * 1024 * 1024;
+
+  struct ThreadCache {
+    std::vector<void*> freelists[NUM_BUCKETS];
+    size_t cachedBytes = 0;
+
+    ~ThreadCache();
+  };
+
+  static int bucketFor(size_t size);
+
+  static ThreadCache& threadCache();
+};
+
+
+inline int RecyclingPool::bucketFor(const size_t size) {
+  if (size > (size_t(1) << MAX_BUCKET_BITS)) {
+    return -1;
+  }
+
+  int bits = MIN_BUCKET_BITS;
+  while ((size_t(1) << bits) < size) {
+    ++bits;
+  }
+
+  return bits - MIN_BUCKET_BITS;
+}
+
+inline RecyclingPool::ThreadCache& RecyclingPool::threadCache() {
+  static thread_local ThreadCache cache;
+
+  return cache;
+}
+
+inline RecyclingPool::ThreadCache::~ThreadCache() {
+  for (std::vector<void*>& freelist : freelists) {
+    for (void* block : freelist) {
+      free(block);
+    }
+  }
+}
+
+inline void RecyclingPool::trimThreadCache() {
+  ThreadCache& cache = threadCache();
+  for (std::vector<void*>& freelist : cache.freelists) {
+    for (void* block : freelist) {
+      free(block);
+    }
+    freelist.clear();
+  }
+  cache.cachedBytes = 0;
+}
+
+inline void* RecyclingPool::alloc(const size_t size) {
+  const int bucket = bucketFor(size);
+  if (bucket >= 0) {
+    ThreadCache& cache = threadCache();
+    std::vector<void*>& freelist = cache.freelists[bucket];
+    if (!freelist.empty()) {
+      void* block = freelist.back();
+      freelist.pop_back();
+      cache.cachedBytes -= size_t(1) << (bucket + MIN_BUCKET_BITS);
+
+      return block;
+    }
+  }
+
+  const size_t block_size = (bucket >= 0) ? (size_t(1) << (bucket + MIN_BUCKET_BITS)) : size;
+  void* block = malloc(block_size);
+  if (!block) {
+    throw std::bad_alloc();
+  }
+
+  return block;
+}
+
+inline void RecyclingPool::release(void* addr, const size_t size) {
+  if (!addr) {
+    return;
+  }
+
+  const int bucket = bucketFor(size);
+  if (bucket >= 0) {
+    ThreadCache& cache = threadCache();
+    const size_t block_size = size_t(1) << (bucket + MIN_BUCKET_BITS);
+    if (cache.cachedBytes + block_size <= MAX_CACHED_BYTES) {
+      try {
+        cache.freelists[bucket].push_back(addr);
+        cache.cachedBytes += block_size;
+
+        return;
+      } catch (const std::bad_alloc&) {
+        // Fall through and free the block.
+      }
+    }
+  }
+
+  free(addr);
+}
+
+#endif  // ifndef RECYCLING_POOL_H_
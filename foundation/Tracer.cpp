@@ -0,0 +1,131 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Tracer.h"
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+std::string escapeJson(const std::string& str) {
+  std::string escaped;
+  escaped.reserve(str.size());
+  for (const char ch : str) {
+    if ((ch == '"') || (ch == '\\')) {
+      escaped.push_back('\\');
+    }
+    escaped.push_back(ch);
+  }
+
+  return escaped;
+}
+}  // namespace
+
+Tracer& Tracer::instance() {
+  static Tracer the_instance;
+
+  return the_instance;
+}
+
+Tracer::Tracer() : m_origin(std::chrono::steady_clock::now()), m_recording(false) {
+  if (const char* path = std::getenv("SCANTAILOR_TRACE")) {
+    m_autoTracePath = path;
+    startRecording();
+  }
+}
+
+Tracer::~Tracer() {
+  if (!m_autoTracePath.empty()) {
+    stopRecording();
+    writeTraceFile(m_autoTracePath);
+  }
+}
+
+void Tracer::startRecording() {
+  m_recording.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::stopRecording() {
+  m_recording.store(false, std::memory_order_relaxed);
+}
+
+bool Tracer::writeTraceFile(const std::string& path) {
+  FILE* const file = std::fopen(path.c_str(), "w");
+  if (!file) {
+    return false;
+  }
+
+  std::fputs("{\"traceEvents\":[", file);
+
+  const std::lock_guard<std::mutex> guard(m_mutex);
+  bool first = true;
+  for (const std::unique_ptr<ThreadBuffer>& buffer : m_buffers) {
+    for (const Event& evt : buffer->events) {
+      std::fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":0,\"tid\":%d,\"ts\":%.1f", first ? "" : ",",
+                   evt.name, evt.phase, buffer->tid, evt.startUs);
+      switch (evt.phase) {
+        case 'X':
+          std::fprintf(file, ",\"dur\":%.1f}", evt.durUs);
+          break;
+        case 'i':
+          std::fprintf(file, ",\"s\":\"t\",\"args\":{\"arg\":\"%s\"}}", escapeJson(evt.arg).c_str());
+          break;
+        case 'C':
+          std::fprintf(file, ",\"args\":{\"value\":%.1f}}", evt.durUs);
+          break;
+      }
+      first = false;
+    }
+  }
+
+  std::fputs("\n]}\n", file);
+  std::fclose(file);
+
+  return true;
+}
+
+void Tracer::recordSpan(const char* name, const std::chrono::steady_clock::time_point start) {
+  const auto end = std::chrono::steady_clock::now();
+  const double start_us = std::chrono::duration<double, std::micro>(start - m_origin).count();
+  const double dur_us = std::chrono::duration<double, std::micro>(end - start).count();
+
+  threadBuffer().events.push_back(Event{name, start_us, dur_us, 'X', std::string()});
+}
+
+void Tracer::recordInstant(const char* name, const std::string& arg) {
+  const double ts_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_origin).count();
+  threadBuffer().events.push_back(Event{name, ts_us, 0.0, 'i', arg});
+}
+
+void Tracer::recordCounter(const char* name, const double value) {
+  const double ts_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_origin).count();
+  threadBuffer().events.push_back(Event{name, ts_us, value, 'C', std::string()});
+}
+
+Tracer::ThreadBuffer& Tracer::threadBuffer() {
+  thread_local ThreadBuffer* buffer = nullptr;
+  if (!buffer) {
+    auto new_buffer = std::make_unique<ThreadBuffer>();
+    buffer = new_buffer.get();
+
+    const std::lock_guard<std::mutex> guard(m_mutex);
+    new_buffer->tid = static_cast<int>(m_buffers.size());
+    m_buffers.push_back(std::move(new_buffer));
+  }
+
+  return *buffer;
+}
@@ -0,0 +1,148 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACER_H_
+#define TRACER_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "NonCopyable.h"
+
+/**
+ * \brief Records named time spans and exports them in the Chrome
+ *        trace-event format.
+ *
+ * Unlike PerformanceTimer, which prints a single elapsed time, this
+ * class collects a whole timeline.  Code is instrumented with
+ * TRACE_SCOPE(), which costs a single atomic load when recording
+ * is off.  Spans go to per-thread buffers, so threads never contend
+ * with each other while recording.
+ *
+ * Setting the SCANTAILOR_TRACE environment variable to a file path
+ * starts recording at startup and writes the trace on exit.  The
+ * resulting file loads into chrome://tracing or https://ui.perfetto.dev
+ */
+class Tracer {
+  DECLARE_NON_COPYABLE(Tracer)
+
+ public:
+  static Tracer& instance();
+
+  void startRecording();
+
+  void stopRecording();
+
+  bool isRecording() const { return m_recording.load(std::memory_order_relaxed); }
+
+  /**
+   * \brief Writes the collected spans to \p path as trace-event JSON.
+   *
+   * \return false if the file could not be opened for writing.
+   */
+  bool writeTraceFile(const std::string& path);
+
+  /**
+   * \brief Records a point-in-time event with a free-form argument.
+   *
+   * Unlike spans, instants have no duration, so they suit scheduling
+   * events like a task being enqueued or dispatched.  \p name must be
+   * a string literal; \p arg is copied.  Callers should check
+   * isRecording() first, as building \p arg typically costs more than
+   * the check.
+   */
+  void recordInstant(const char* name, const std::string& arg);
+
+  /** \brief Records the current value of a named quantity, e.g. a queue depth. */
+  void recordCounter(const char* name, double value);
+
+ private:
+  friend class TraceSpan;
+
+  struct Event {
+    const char* name;
+    double startUs;
+    double durUs;       // Duration for spans, value for counters.
+    char phase;         // 'X' for spans, 'i' for instants, 'C' for counters.
+    std::string arg;    // Only for instants.
+  };
+
+  struct ThreadBuffer {
+    int tid;
+    std::vector<Event> events;
+  };
+
+  Tracer();
+
+  ~Tracer();
+
+  void recordSpan(const char* name, std::chrono::steady_clock::time_point start);
+
+  ThreadBuffer& threadBuffer();
+
+  const std::chrono::steady_clock::time_point m_origin;
+  std::atomic<bool> m_recording;
+
+  /** Guards m_buffers; individual buffers are only touched by their thread. */
+  std::mutex m_mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+  std::string m_autoTracePath;
+};
+
+
+/**
+ * \brief Measures the time from construction to destruction.
+ *
+ * \p name must outlive the trace, so pass a string literal.
+ * Use through TRACE_SCOPE() rather than directly.
+ */
+class TraceSpan {
+  DECLARE_NON_COPYABLE(TraceSpan)
+
+ public:
+  explicit TraceSpan(const char* name) : m_name(nullptr) {
+    if (Tracer::instance().isRecording()) {
+      m_name = name;
+      m_start = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~TraceSpan() {
+    if (m_name) {
+      Tracer::instance().recordSpan(m_name, m_start);
+    }
+  }
+
+ private:
+  const char* m_name;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+
+#define TRACE_SCOPE_CONCAT_IMPL(a, b) a##b
+#define TRACE_SCOPE_CONCAT(a, b) TRACE_SCOPE_CONCAT_IMPL(a, b)
+
+/**
+ * Records the time spent in the enclosing scope under the given name.
+ */
+#define TRACE_SCOPE(name) const TraceSpan TRACE_SCOPE_CONCAT(trace_span_, __LINE__)(name)
+
+#endif  // ifndef TRACER_H_
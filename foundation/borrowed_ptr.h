@@ -0,0 +1,73 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef borrowed_ptr_H_
+#define borrowed_ptr_H_
+
+#include <cstddef>
+#include "intrusive_ptr.h"
+
+/**
+ * \brief A non-owning view of an intrusively counted object.
+ *
+ * A borrowed_ptr neither increments nor decrements the reference
+ * counter, so passing one around costs the same as a raw pointer.
+ * The idiom: a call path that only observes an object someone else is
+ * known to keep alive for the duration (a member of the caller, a
+ * local intrusive_ptr up the stack) borrows instead of copying,
+ * keeping the atomic refcount traffic off hot paths.
+ *
+ * A borrow must not outlive the owning reference it was taken from.
+ * Anything that stores the pointer or lets it escape the current
+ * call tree should take an intrusive_ptr instead.
+ */
+template <typename T>
+class borrowed_ptr {
+ public:
+  constexpr borrowed_ptr(std::nullptr_t = nullptr) noexcept : m_obj(nullptr) {}
+
+  explicit borrowed_ptr(T* obj) noexcept : m_obj(obj) {}
+
+  borrowed_ptr(const intrusive_ptr<T>& owner) noexcept : m_obj(owner.get()) {}
+
+  T& operator*() const { return *m_obj; }
+
+  T* operator->() const noexcept { return m_obj; }
+
+  T* get() const noexcept { return m_obj; }
+
+  explicit operator bool() const noexcept { return (m_obj != nullptr); }
+
+  /** Takes an owning reference, for the rare escape out of a borrow. */
+  intrusive_ptr<T> lock() const noexcept { return intrusive_ptr<T>(m_obj); }
+
+ private:
+  T* m_obj;
+};
+
+template <typename T>
+inline bool operator==(const borrowed_ptr<T>& lhs, const borrowed_ptr<T>& rhs) {
+  return (lhs.get() == rhs.get());
+}
+
+template <typename T>
+inline bool operator!=(const borrowed_ptr<T>& lhs, const borrowed_ptr<T>& rhs) {
+  return (lhs.get() != rhs.get());
+}
+
+#endif  // ifndef borrowed_ptr_H_
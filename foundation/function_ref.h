@@ -0,0 +1,73 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef function_ref_H_
+#define function_ref_H_
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+/**
+ * \brief A non-owning reference to a callable.
+ *
+ * Like VirtualFunction, this lets a callback cross a translation unit
+ * boundary without templating the callee on the callable's type.
+ * Unlike VirtualFunction, there's no class hierarchy and no wrapper
+ * object to construct at the call site: a lambda, functor or function
+ * pointer converts implicitly, and a call goes through a single stored
+ * function pointer rather than a vtable.  That makes it the better fit
+ * for callbacks invoked in loops.
+ *
+ * The referenced callable must outlive the function_ref.  Passing a
+ * temporary as a function argument is fine -- the temporary lives for
+ * the duration of the call -- but storing a function_ref is not.
+ */
+template <typename Signature>
+class function_ref;
+
+template <typename Res, typename... ArgTypes>
+class function_ref<Res(ArgTypes...)> {
+ public:
+  template <typename Callable,
+            typename = typename std::enable_if<
+                !std::is_same<typename std::decay<Callable>::type, function_ref>::value
+                && !std::is_function<typename std::remove_reference<Callable>::type>::value>::type>
+  function_ref(Callable&& callable) noexcept
+      : m_obj(const_cast<void*>(static_cast<const void*>(std::addressof(callable)))), m_thunk(&thunk<Callable>) {}
+
+  function_ref(Res (*func)(ArgTypes...)) noexcept
+      : m_obj(reinterpret_cast<void*>(func)), m_thunk(&functionThunk) {}
+
+  Res operator()(ArgTypes... args) const { return m_thunk(m_obj, std::forward<ArgTypes>(args)...); }
+
+ private:
+  template <typename Callable>
+  static Res thunk(void* obj, ArgTypes... args) {
+    return (*static_cast<typename std::remove_reference<Callable>::type*>(obj))(std::forward<ArgTypes>(args)...);
+  }
+
+  static Res functionThunk(void* obj, ArgTypes... args) {
+    return reinterpret_cast<Res (*)(ArgTypes...)>(obj)(std::forward<ArgTypes>(args)...);
+  }
+
+  void* m_obj;
+  Res (*m_thunk)(void*, ArgTypes...);
+};
+
+#endif  // ifndef function_ref_H_
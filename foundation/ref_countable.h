@@ -23,11 +23,11 @@
 #include <config.h>
 #endif
 
-#include <QAtomicInt>
+#include <atomic>
 
 class ref_countable {
  public:
-  ref_countable() : m_counter(0) {}
+  ref_countable() = default;
 
   ref_countable(const ref_countable& other) {
     // don't copy the reference counter!
@@ -41,16 +41,30 @@ class ref_countable {
 
   virtual ~ref_countable() = default;
 
-  void ref() const { m_counter.fetchAndAddRelaxed(1); }
-
+  /**
+   * Incrementing carries no ordering obligations: the thread taking
+   * the reference already holds one (directly or through whoever
+   * handed it the pointer), so relaxed is enough and keeps pointer
+   * copies on hot paths down to a single uncontended instruction.
+   */
+  void ref() const { m_counter.fetch_add(1, std::memory_order_relaxed); }
+
+  /**
+   * The release/acquire pair makes every access performed while
+   * holding a reference visible to the thread that ends up running
+   * the destructor.
+   */
   void unref() const {
-    if (m_counter.fetchAndAddRelease(-1) == 1) {
+    if (m_counter.fetch_sub(1, std::memory_order_release) == 1) {
+      std::atomic_thread_fence(std::memory_order_acquire);
       delete this;
     }
   }
 
  private:
-  mutable QAtomicInt m_counter;
+  // Initialized here rather than in constructors, so that no
+  // constructor (the copy one in particular) can leave it indeterminate.
+  mutable std::atomic<int> m_counter{0};
 };
 
 
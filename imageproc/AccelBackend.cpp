@@ -0,0 +1,39 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AccelBackend.h"
+
+namespace imageproc {
+namespace {
+// The base class itself is the CPU-only stub: it supports nothing,
+// so every caller takes its regular code path.
+std::shared_ptr<AccelBackend> the_backend = std::make_shared<AccelBackend>();
+}  // namespace
+
+AccelBackend& accelBackend() {
+  return *the_backend;
+}
+
+void setAccelBackend(std::shared_ptr<AccelBackend> backend) {
+  if (backend) {
+    the_backend = std::move(backend);
+  } else {
+    the_backend = std::make_shared<AccelBackend>();
+  }
+}
+}  // namespace imageproc
@@ -0,0 +1,111 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGEPROC_ACCELBACKEND_H_
+#define IMAGEPROC_ACCELBACKEND_H_
+
+#include <QColor>
+#include <QImage>
+#include <QPointF>
+#include <QRect>
+#include <QSizeF>
+#include <QTransform>
+#include <functional>
+#include <memory>
+
+namespace imageproc {
+class BinaryImage;
+class GrayImage;
+class OutsidePixels;
+
+/**
+ * \brief Capability interface for accelerated implementations of the
+ *        most bandwidth-bound kernels.
+ *
+ * The portable CPU code paths remain the default and the reference.
+ * A backend (OpenCL, Vulkan compute, ...) overrides supports() for
+ * the operations it implements, plus the corresponding hooks.  A
+ * hook either produces the complete result and returns true, or
+ * returns false, in which case the caller runs its regular CPU
+ * implementation — for example when the device is out of memory or
+ * the image format isn't handled.  Hooks are called from worker
+ * threads concurrently and must be thread-safe.
+ */
+class AccelBackend {
+ public:
+  enum Operation {
+    /** The area-mapping affine resampler behind transform() and transformToGray(). */
+    AFFINE_TRANSFORM,
+
+    /** The windowed mean / deviation thresholding of binarizeSauvola(). */
+    SAUVOLA_BINARIZATION,
+
+    /** The per-pixel resampling of RasterDewarper, driven by an arbitrary dst -> src mapping. */
+    DEWARP
+  };
+
+  virtual ~AccelBackend() = default;
+
+  virtual bool supports(Operation) const { return false; }
+
+  /** \see transform() in Transform.h for the parameter semantics. */
+  virtual bool affineTransform(const QImage& src,
+                               const QTransform& xform,
+                               const QRect& dst_rect,
+                               const OutsidePixels& outside_pixels,
+                               const QSizeF& min_mapping_area,
+                               QImage& dst) {
+    return false;
+  }
+
+  /** \see binarizeSauvola() in Binarize.h.  \p gray is already grayscale. */
+  virtual bool sauvola(const GrayImage& gray, const QSize& window_size, double k, BinaryImage& dst) { return false; }
+
+  /**
+   * \brief Resamples \p src into an image of \p dst_size through an
+   *        arbitrary mapping from destination to source coordinates.
+   *
+   * Evaluating \p dst_to_src is cheap relative to the per-pixel work,
+   * so the backend may sample it at whatever granularity it needs —
+   * typically a coarse grid uploaded alongside the image.  Pixels
+   * mapped outside the source are filled with \p bg_color.
+   */
+  virtual bool dewarp(const QImage& src,
+                      const QSize& dst_size,
+                      const QColor& bg_color,
+                      const std::function<QPointF(const QPointF&)>& dst_to_src,
+                      QImage& dst) {
+    return false;
+  }
+};
+
+/**
+ * \return the active backend.  Never null: with no backend installed,
+ *         this is a built-in stub that supports nothing, so callers
+ *         take their CPU paths.
+ */
+AccelBackend& accelBackend();
+
+/**
+ * Installs \p backend, or restores the CPU-only stub when null.
+ * Meant to be called once at startup, before any processing threads
+ * exist; it does not synchronize with in-flight hook calls.
+ */
+void setAccelBackend(std::shared_ptr<AccelBackend> backend);
+}  // namespace imageproc
+#endif  // ifndef IMAGEPROC_ACCELBACKEND_H_
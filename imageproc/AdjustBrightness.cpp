@@ -18,6 +18,7 @@
 
 #include "AdjustBrightness.h"
 #include <QImage>
+#include "ParallelFor.h"
 
 namespace imageproc {
 void adjustBrightness(QImage& rgb_image, const QImage& brightness, const double wr, const double wb) {
@@ -37,47 +38,53 @@ void adjustBrightness(QImage& rgb_image, const QImage& brightness, const double
     throw std::invalid_argument("adjustBrightness: image and brightness have different sizes");
   }
 
-  auto* rgb_line = reinterpret_cast<uint32_t*>(rgb_image.bits());
+  // Per pixel, the YUV round trip this function used to do boils down
+  // to shifting all three channels by the same delta: new_Y - Y.  With
+  // Y expressed through 16.16 fixed-point lookup tables, no per-pixel
+  // multiplies or divisions remain, and the integer loop vectorizes.
+  int y_r[256];
+  int y_g[256];
+  int y_b[256];
+  const double wg = 1.0 - wr - wb;
+  for (int i = 0; i < 256; ++i) {
+    y_r[i] = int(wr * i * 65536 + 0.5);
+    y_g[i] = int(wg * i * 65536 + 0.5);
+    y_b[i] = int(wb * i * 65536 + 0.5);
+  }
+
+  auto* const rgb_data = reinterpret_cast<uint32_t*>(rgb_image.bits());
   const int rgb_wpl = rgb_image.bytesPerLine() / 4;
 
-  const uint8_t* br_line = brightness.bits();
+  const uint8_t* const br_data = brightness.bits();
   const int br_bpl = brightness.bytesPerLine();
 
   const int width = rgb_image.width();
   const int height = rgb_image.height();
 
-  const double wg = 1.0 - wr - wb;
-  const double wu = (1.0 - wb);
-  const double wv = (1.0 - wr);
-  const double r_wg = 1.0 / wg;
-  const double r_wu = 1.0 / wu;
-  const double r_wv = 1.0 / wv;
-
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      uint32_t RGB = rgb_line[x];
-      const double R = (RGB >> 16) & 0xFF;
-      const double G = (RGB >> 8) & 0xFF;
-      const double B = RGB & 0xFF;
-
-      const double Y = wr * R + wg * G + wb * B;
-      const double U = (B - Y) * r_wu;
-      const double V = (R - Y) * r_wv;
-
-      double new_Y = br_line[x];
-      double new_R = new_Y + V * wv;
-      double new_B = new_Y + U * wu;
-      double new_G = (new_Y - new_R * wr - new_B * wb) * r_wg;
-
-      RGB &= 0xFF000000;  // preserve alpha
-      RGB |= uint32_t(qBound(0, int(new_R + 0.5), 255)) << 16;
-      RGB |= uint32_t(qBound(0, int(new_G + 0.5), 255)) << 8;
-      RGB |= uint32_t(qBound(0, int(new_B + 0.5), 255));
-      rgb_line[x] = RGB;
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      uint32_t* const rgb_line = rgb_data + y * rgb_wpl;
+      const uint8_t* const br_line = br_data + y * br_bpl;
+
+      for (int x = 0; x < width; ++x) {
+        const uint32_t rgb = rgb_line[x];
+        const int r = (rgb >> 16) & 0xff;
+        const int g = (rgb >> 8) & 0xff;
+        const int b = rgb & 0xff;
+
+        // new_Y - Y, rounded to the nearest integer.  The arithmetic
+        // right shift is a floor division, so negative deltas round
+        // the same way the old floating-point code did.
+        const int delta = ((br_line[x] << 16) - (y_r[r] + y_g[g] + y_b[b]) + 32768) >> 16;
+
+        uint32_t out = rgb & 0xff000000;  // preserve alpha
+        out |= uint32_t(qBound(0, r + delta, 255)) << 16;
+        out |= uint32_t(qBound(0, g + delta, 255)) << 8;
+        out |= uint32_t(qBound(0, b + delta, 255));
+        rgb_line[x] = out;
+      }
     }
-    rgb_line += rgb_wpl;
-    br_line += br_bpl;
-  }
+  });
 }  // adjustBrightness
 
 void adjustBrightnessYUV(QImage& rgb_image, const QImage& brightness) {
@@ -1,5 +1,6 @@
 
 #include "BackgroundColorCalculator.h"
+#include <algorithm>
 #include <cassert>
 #include "Binarize.h"
 #include "DebugImages.h"
@@ -11,11 +12,36 @@
 
 namespace imageproc {
 namespace {
+// Sampling one pixel out of SAMPLE_STEP x SAMPLE_STEP looks at roughly
+// 2% of the image, which is plenty for a 256-bucket histogram of the
+// page background.  An odd step also avoids always probing the same
+// bit position within the mask words.
+const int SAMPLE_STEP = 7;
+
+// How many sampled rows go into one accumulation band.  The dominant
+// color is re-estimated after each band, and once two consecutive
+// estimates agree the sweep stops early.
+const int BAND_SAMPLED_ROWS = 256;
+
+// Band agreement means nothing while the histograms are nearly empty,
+// e.g. when the mask only covers the bottom of the page.
+const int MIN_SAMPLES_FOR_CONVERGENCE = 4096;
+
 class RgbHistogram {
  public:
-  explicit RgbHistogram(const QImage& img);
+  RgbHistogram() : m_numSamples(0) {
+    memset(m_red, 0, sizeof(m_red));
+    memset(m_green, 0, sizeof(m_green));
+    memset(m_blue, 0, sizeof(m_blue));
+  }
 
-  RgbHistogram(const QImage& img, const BinaryImage& mask);
+  /**
+   * Accumulates the grid samples of rows [y_begin, y_end), stepping
+   * SAMPLE_STEP in both directions.  \p y_begin must be a multiple of
+   * SAMPLE_STEP to keep the grid phase across bands.  A null \p mask
+   * means all pixels participate.
+   */
+  void accumulateSampled(const QImage& img, const BinaryImage* mask, int y_begin, int y_end);
 
   const int* redChannel() const { return m_red; }
 
@@ -23,97 +49,108 @@ class RgbHistogram {
 
   const int* blueChannel() const { return m_blue; }
 
- private:
-  void fromRgbImage(const QImage& img);
-
-  void fromRgbImage(const QImage& img, const BinaryImage& mask);
+  uint64_t numSamples() const { return m_numSamples; }
 
+ private:
   int m_red[256];
   int m_green[256];
   int m_blue[256];
+  uint64_t m_numSamples;
 };
 
-RgbHistogram::RgbHistogram(const QImage& img) {
-  memset(m_red, 0, sizeof(m_red));
-  memset(m_green, 0, sizeof(m_green));
-  memset(m_blue, 0, sizeof(m_blue));
-
-  if (img.isNull()) {
-    return;
-  }
-
-  if (!((img.format() == QImage::Format_RGB32) || (img.format() == QImage::Format_ARGB32))) {
-    throw std::invalid_argument("RgbHistogram: wrong image format");
-  }
-
-  fromRgbImage(img);
-}
+void RgbHistogram::accumulateSampled(const QImage& img, const BinaryImage* mask, const int y_begin, const int y_end) {
+  const auto* img_data = reinterpret_cast<const uint32_t*>(img.bits());
+  const int img_stride = img.bytesPerLine() / sizeof(uint32_t);
+  const uint32_t* mask_data = mask ? mask->data() : nullptr;
+  const int mask_stride = mask ? mask->wordsPerLine() : 0;
 
-RgbHistogram::RgbHistogram(const QImage& img, const BinaryImage& mask) {
-  memset(m_red, 0, sizeof(m_red));
-  memset(m_green, 0, sizeof(m_green));
-  memset(m_blue, 0, sizeof(m_blue));
+  const int width = img.width();
+  const uint32_t msb = uint32_t(1) << 31;
 
-  if (img.isNull()) {
-    return;
+  // Two accumulator lanes per channel: a page background is mostly a
+  // single color, and alternating banks keeps consecutive increments
+  // of the same bucket from serializing on one histogram word.
+  int red[2][256];
+  int green[2][256];
+  int blue[2][256];
+  memset(red, 0, sizeof(red));
+  memset(green, 0, sizeof(green));
+  memset(blue, 0, sizeof(blue));
+  int lane = 0;
+  uint64_t num_samples = 0;
+
+  for (int y = y_begin; y < y_end; y += SAMPLE_STEP) {
+    const uint32_t* const img_line = img_data + y * img_stride;
+    const uint32_t* const mask_line = mask_data ? mask_data + y * mask_stride : nullptr;
+    for (int x = 0; x < width; x += SAMPLE_STEP) {
+      if (mask_line && !(mask_line[x >> 5] & (msb >> (x & 31)))) {
+        continue;
+      }
+      const uint32_t pixel = img_line[x];
+      ++red[lane][(pixel >> 16) & 0xff];
+      ++green[lane][(pixel >> 8) & 0xff];
+      ++blue[lane][pixel & 0xff];
+      lane ^= 1;
+      ++num_samples;
+    }
   }
 
-  if (!((img.format() == QImage::Format_RGB32) || (img.format() == QImage::Format_ARGB32))) {
-    throw std::invalid_argument("RgbHistogram: wrong image format");
+  for (int i = 0; i < 256; ++i) {
+    m_red[i] += red[0][i] + red[1][i];
+    m_green[i] += green[0][i] + green[1][i];
+    m_blue[i] += blue[0][i] + blue[1][i];
   }
+  m_numSamples += num_samples;
+}  // RgbHistogram::accumulateSampled
 
-  if (img.size() != mask.size()) {
-    throw std::invalid_argument("RgbHistogram: img and mask have different sizes");
-  }
+class GrayHistogram {
+ public:
+  GrayHistogram() : m_numSamples(0) { memset(m_hist, 0, sizeof(m_hist)); }
 
-  fromRgbImage(img, mask);
-}
+  /** \see RgbHistogram::accumulateSampled() */
+  void accumulateSampled(const QImage& img, const BinaryImage* mask, int y_begin, int y_end);
 
-void RgbHistogram::fromRgbImage(const QImage& img) {
-  const auto* img_line = reinterpret_cast<const uint32_t*>(img.bits());
-  const int img_stride = img.bytesPerLine() / sizeof(uint32_t);
+  const int* data() const { return m_hist; }
 
-  const int width = img.width();
-  const int height = img.height();
+  uint64_t numSamples() const { return m_numSamples; }
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      ++m_red[(img_line[x] >> 16) & 0xff];
-      ++m_green[(img_line[x] >> 8) & 0xff];
-      ++m_blue[img_line[x] & 0xff];
-    }
-    img_line += img_stride;
-  }
-}
+ private:
+  int m_hist[256];
+  uint64_t m_numSamples;
+};
 
-void RgbHistogram::fromRgbImage(const QImage& img, const BinaryImage& mask) {
-  const auto* img_line = reinterpret_cast<const uint32_t*>(img.bits());
-  const int img_stride = img.bytesPerLine() / sizeof(uint32_t);
-  const uint32_t* mask_line = mask.data();
-  const int mask_stride = mask.wordsPerLine();
+void GrayHistogram::accumulateSampled(const QImage& img, const BinaryImage* mask, const int y_begin, const int y_end) {
+  const uint8_t* const img_data = img.bits();
+  const int img_stride = img.bytesPerLine();
+  const uint32_t* mask_data = mask ? mask->data() : nullptr;
+  const int mask_stride = mask ? mask->wordsPerLine() : 0;
 
   const int width = img.width();
-  const int height = img.height();
   const uint32_t msb = uint32_t(1) << 31;
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      if (mask_line[x >> 5] & (msb >> (x & 31))) {
-        ++m_red[(img_line[x] >> 16) & 0xff];
-        ++m_green[(img_line[x] >> 8) & 0xff];
-        ++m_blue[img_line[x] & 0xff];
+  int hist[2][256];
+  memset(hist, 0, sizeof(hist));
+  int lane = 0;
+  uint64_t num_samples = 0;
+
+  for (int y = y_begin; y < y_end; y += SAMPLE_STEP) {
+    const uint8_t* const img_line = img_data + y * img_stride;
+    const uint32_t* const mask_line = mask_data ? mask_data + y * mask_stride : nullptr;
+    for (int x = 0; x < width; x += SAMPLE_STEP) {
+      if (mask_line && !(mask_line[x >> 5] & (msb >> (x & 31)))) {
+        continue;
       }
+      ++hist[lane][img_line[x]];
+      lane ^= 1;
+      ++num_samples;
     }
-    img_line += img_stride;
-    mask_line += mask_stride;
   }
-}
 
-void grayHistToArray(int* raw_hist, GrayscaleHistogram hist) {
   for (int i = 0; i < 256; ++i) {
-    raw_hist[i] = hist[i];
+    m_hist[i] += hist[0][i] + hist[1][i];
   }
-}
+  m_numSamples += num_samples;
+}  // GrayHistogram::accumulateSampled
 
 void checkImageIsValid(const QImage& img) {
   if (!((img.format() == QImage::Format_RGB32) || (img.format() == QImage::Format_ARGB32)
@@ -207,21 +244,59 @@ QColor BackgroundColorCalculator::calcDominantBackgroundColor(const QImage& img,
 }
 
 QColor BackgroundColorCalculator::calcDominantColor(const QImage& img, const BinaryImage& background_mask) {
-  if ((img.format() == QImage::Format_Indexed8) && img.isGrayscale()) {
-    const GrayscaleHistogram hist(img, background_mask);
-    int raw_hist[256];
-    grayHistToArray(raw_hist, hist);
-    uint8_t dominant_gray = calcDominantLevel(raw_hist);
+  // The histograms are built from a sparse pixel grid, band by band.
+  // Each band re-estimates the dominant color; once two consecutive
+  // estimates agree over a meaningful number of samples, the rest of
+  // the page cannot realistically change the answer.
+  const int height = img.height();
+  const int band_height = BAND_SAMPLED_ROWS * SAMPLE_STEP;
+  const bool grayscale = (img.format() == QImage::Format_Indexed8) && img.isGrayscale();
+
+  RgbHistogram rgb_hist;
+  GrayHistogram gray_hist;
+
+  QColor estimate;
+  bool have_estimate = false;
+
+  for (int y = 0; y < height; y += band_height) {
+    const int band_end = std::min(y + band_height, height);
+
+    QColor band_estimate;
+    uint64_t num_samples;
+    if (grayscale) {
+      const uint64_t samples_before = gray_hist.numSamples();
+      gray_hist.accumulateSampled(img, &background_mask, y, band_end);
+      num_samples = gray_hist.numSamples();
+      if (num_samples == samples_before) {
+        // Nothing under the mask here; the estimate didn't change.
+        continue;
+      }
+      const uint8_t gray = calcDominantLevel(gray_hist.data());
+      band_estimate = QColor(gray, gray, gray);
+    } else {
+      const uint64_t samples_before = rgb_hist.numSamples();
+      rgb_hist.accumulateSampled(img, &background_mask, y, band_end);
+      num_samples = rgb_hist.numSamples();
+      if (num_samples == samples_before) {
+        continue;
+      }
+      band_estimate = QColor(calcDominantLevel(rgb_hist.redChannel()), calcDominantLevel(rgb_hist.greenChannel()),
+                             calcDominantLevel(rgb_hist.blueChannel()));
+    }
 
-    return QColor(dominant_gray, dominant_gray, dominant_gray);
-  } else {
-    const RgbHistogram hist(img, background_mask);
-    uint8_t dominant_red = calcDominantLevel(hist.redChannel());
-    uint8_t dominant_green = calcDominantLevel(hist.greenChannel());
-    uint8_t dominant_blue = calcDominantLevel(hist.blueChannel());
+    if (have_estimate && (band_estimate == estimate) && (num_samples >= MIN_SAMPLES_FOR_CONVERGENCE)) {
+      return estimate;
+    }
+    estimate = band_estimate;
+    have_estimate = true;
+  }
 
-    return QColor(dominant_red, dominant_green, dominant_blue);
+  if (!have_estimate) {
+    // An all-white mask used to yield black from empty histograms.
+    return QColor(0, 0, 0);
   }
+
+  return estimate;
 }
 
 BackgroundColorCalculator::BackgroundColorCalculator(bool internalBlackOnWhiteDetection)
@@ -20,9 +20,12 @@
 #include <QDebug>
 #include <cassert>
 #include <cmath>
+#include <mutex>
+#include "AccelBackend.h"
 #include "BinaryImage.h"
 #include "Grayscale.h"
 #include "IntegralImage.h"
+#include "ParallelFor.h"
 
 namespace imageproc {
 BinaryImage binarizeOtsu(const QImage& src) {
@@ -44,25 +47,24 @@ BinaryImage binarizeSauvola(const QImage& src, const QSize window_size, const do
     return BinaryImage();
   }
 
-  const QImage gray(toGrayscale(src));
+  const GrayImage gray(toGrayscale(src));
+
+  AccelBackend& accel = accelBackend();
+  if (accel.supports(AccelBackend::SAUVOLA_BINARIZATION)) {
+    BinaryImage dst;
+    if (accel.sauvola(gray, window_size, k, dst)) {
+      return dst;
+    }
+  }
+
   const int w = gray.width();
   const int h = gray.height();
 
   IntegralImage<uint32_t> integral_image(w, h);
   IntegralImage<uint64_t> integral_sqimage(w, h);
+  buildGrayIntegralImages(gray, integral_image, integral_sqimage);
 
-  const uint8_t* gray_line = gray.bits();
-  const int gray_bpl = gray.bytesPerLine();
-
-  for (int y = 0; y < h; ++y, gray_line += gray_bpl) {
-    integral_image.beginRow();
-    integral_sqimage.beginRow();
-    for (int x = 0; x < w; ++x) {
-      const uint32_t pixel = gray_line[x];
-      integral_image.push(pixel);
-      integral_sqimage.push(pixel * pixel);
-    }
-  }
+  const int gray_bpl = gray.stride();
 
   const int window_lower_half = window_size.height() >> 1;
   const int window_upper_half = window_size.height() - window_lower_half;
@@ -70,45 +72,54 @@ BinaryImage binarizeSauvola(const QImage& src, const QSize window_size, const do
   const int window_right_half = window_size.width() - window_left_half;
 
   BinaryImage bw_img(w, h);
-  uint32_t* bw_line = bw_img.data();
+  uint32_t* const bw_data = bw_img.data();
   const int bw_wpl = bw_img.wordsPerLine();
-
-  gray_line = gray.bits();
-  for (int y = 0; y < h; ++y) {
-    const int top = std::max(0, y - window_lower_half);
-    const int bottom = std::min(h, y + window_upper_half);  // exclusive
-    for (int x = 0; x < w; ++x) {
-      const int left = std::max(0, x - window_left_half);
-      const int right = std::min(w, x + window_right_half);  // exclusive
-      const int area = (bottom - top) * (right - left);
-      assert(area > 0);  // because window_size > 0 and w > 0 and h > 0
-      const QRect rect(left, top, right - left, bottom - top);
-      const double window_sum = integral_image.sum(rect);
-      const double window_sqsum = integral_sqimage.sum(rect);
-
-      const double r_area = 1.0 / area;
-      const double mean = window_sum * r_area;
-      const double sqmean = window_sqsum * r_area;
-
-      const double variance = sqmean - mean * mean;
-      const double deviation = std::sqrt(std::fabs(variance));
-
-      const double threshold = mean * (1.0 + k * (deviation / 128.0 - 1.0));
-
-      const uint32_t msb = uint32_t(1) << 31;
-      const uint32_t mask = msb >> (x & 31);
-      if (int(gray_line[x]) < threshold) {
-        // black
-        bw_line[x >> 5] |= mask;
-      } else {
-        // white
-        bw_line[x >> 5] &= ~mask;
+  const uint8_t* const gray_data = gray.data();
+
+  // With the integral images in place each threshold is O(1),
+  // so rows are independent and can be split across threads.
+  parallelForChunked(0, h, [&](const int y_begin, const int y_end) {
+    const uint8_t* gray_line = gray_data + y_begin * gray_bpl;
+    uint32_t* bw_line = bw_data + y_begin * bw_wpl;
+
+    for (int y = y_begin; y < y_end; ++y) {
+      const int top = std::max(0, y - window_lower_half);
+      const int bottom = std::min(h, y + window_upper_half);  // exclusive
+      uint32_t word = 0;
+      for (int x = 0; x < w; ++x) {
+        const int left = std::max(0, x - window_left_half);
+        const int right = std::min(w, x + window_right_half);  // exclusive
+        const int area = (bottom - top) * (right - left);
+        assert(area > 0);  // because window_size > 0 and w > 0 and h > 0
+        const QRect rect(left, top, right - left, bottom - top);
+        const double window_sum = integral_image.sum(rect);
+        const double window_sqsum = integral_sqimage.sum(rect);
+
+        const double r_area = 1.0 / area;
+        const double mean = window_sum * r_area;
+        const double sqmean = window_sqsum * r_area;
+
+        const double variance = sqmean - mean * mean;
+        const double deviation = std::sqrt(std::fabs(variance));
+
+        const double threshold = mean * (1.0 + k * (deviation / 128.0 - 1.0));
+
+        // Branch-free bit assembly: a full word is written at a time
+        // instead of read-modify-write per pixel.
+        word = (word << 1) | uint32_t(int(gray_line[x]) < threshold);
+        if ((x & 31) == 31) {
+          bw_line[x >> 5] = word;
+          word = 0;
+        }
+      }
+      if (w & 31) {
+        bw_line[(w - 1) >> 5] = word << (32 - (w & 31));
       }
-    }
 
-    gray_line += gray_bpl;
-    bw_line += bw_wpl;
-  }
+      gray_line += gray_bpl;
+      bw_line += bw_wpl;
+    }
+  });
 
   return bw_img;
 }  // binarizeSauvola
@@ -126,26 +137,24 @@ BinaryImage binarizeWolf(const QImage& src,
     return BinaryImage();
   }
 
-  const QImage gray(toGrayscale(src));
+  const GrayImage gray(toGrayscale(src));
   const int w = gray.width();
   const int h = gray.height();
 
   IntegralImage<uint32_t> integral_image(w, h);
   IntegralImage<uint64_t> integral_sqimage(w, h);
+  buildGrayIntegralImages(gray, integral_image, integral_sqimage);
 
-  const uint8_t* gray_line = gray.bits();
-  const int gray_bpl = gray.bytesPerLine();
+  const uint8_t* gray_line = gray.data();
+  const int gray_bpl = gray.stride();
 
+  // A simple reduction with no loop-carried dependencies,
+  // unlike the integral image construction it used to share
+  // a loop with, so the compiler is free to vectorize it.
   uint32_t min_gray_level = 255;
-
   for (int y = 0; y < h; ++y, gray_line += gray_bpl) {
-    integral_image.beginRow();
-    integral_sqimage.beginRow();
     for (int x = 0; x < w; ++x) {
-      const uint32_t pixel = gray_line[x];
-      integral_image.push(pixel);
-      integral_sqimage.push(pixel * pixel);
-      min_gray_level = std::min(min_gray_level, pixel);
+      min_gray_level = std::min(min_gray_level, uint32_t(gray_line[x]));
     }
   }
 
@@ -158,56 +167,73 @@ BinaryImage binarizeWolf(const QImage& src,
   std::vector<float> deviations(w * h, 0);
 
   double max_deviation = 0;
-
-  for (int y = 0; y < h; ++y) {
-    const int top = std::max(0, y - window_lower_half);
-    const int bottom = std::min(h, y + window_upper_half);  // exclusive
-    for (int x = 0; x < w; ++x) {
-      const int left = std::max(0, x - window_left_half);
-      const int right = std::min(w, x + window_right_half);  // exclusive
-      const int area = (bottom - top) * (right - left);
-      assert(area > 0);  // because window_size > 0 and w > 0 and h > 0
-      const QRect rect(left, top, right - left, bottom - top);
-      const double window_sum = integral_image.sum(rect);
-      const double window_sqsum = integral_sqimage.sum(rect);
-
-      const double r_area = 1.0 / area;
-      const double mean = window_sum * r_area;
-      const double sqmean = window_sqsum * r_area;
-
-      const double variance = sqmean - mean * mean;
-      const double deviation = std::sqrt(std::fabs(variance));
-      max_deviation = std::max(max_deviation, deviation);
-      means[w * y + x] = (float) mean;
-      deviations[w * y + x] = (float) deviation;
+  std::mutex max_deviation_mutex;
+
+  // Rows are independent here: each thread accumulates its own maximum
+  // deviation and merges it under the mutex once per chunk.
+  parallelForChunked(0, h, [&](const int y_begin, const int y_end) {
+    double chunk_max_deviation = 0;
+
+    for (int y = y_begin; y < y_end; ++y) {
+      const int top = std::max(0, y - window_lower_half);
+      const int bottom = std::min(h, y + window_upper_half);  // exclusive
+      for (int x = 0; x < w; ++x) {
+        const int left = std::max(0, x - window_left_half);
+        const int right = std::min(w, x + window_right_half);  // exclusive
+        const int area = (bottom - top) * (right - left);
+        assert(area > 0);  // because window_size > 0 and w > 0 and h > 0
+        const QRect rect(left, top, right - left, bottom - top);
+        const double window_sum = integral_image.sum(rect);
+        const double window_sqsum = integral_sqimage.sum(rect);
+
+        const double r_area = 1.0 / area;
+        const double mean = window_sum * r_area;
+        const double sqmean = window_sqsum * r_area;
+
+        const double variance = sqmean - mean * mean;
+        const double deviation = std::sqrt(std::fabs(variance));
+        chunk_max_deviation = std::max(chunk_max_deviation, deviation);
+        means[w * y + x] = (float) mean;
+        deviations[w * y + x] = (float) deviation;
+      }
     }
-  }
+
+    const std::lock_guard<std::mutex> guard(max_deviation_mutex);
+    max_deviation = std::max(max_deviation, chunk_max_deviation);
+  });
 
   // TODO: integral images can be disposed at this point.
 
   BinaryImage bw_img(w, h);
-  uint32_t* bw_line = bw_img.data();
+  uint32_t* const bw_data = bw_img.data();
   const int bw_wpl = bw_img.wordsPerLine();
-
-  gray_line = gray.bits();
-  for (int y = 0; y < h; ++y, gray_line += gray_bpl, bw_line += bw_wpl) {
-    for (int x = 0; x < w; ++x) {
-      const float mean = means[y * w + x];
-      const float deviation = deviations[y * w + x];
-      const double a = 1.0 - deviation / max_deviation;
-      const double threshold = mean - k * a * (mean - min_gray_level);
-
-      const uint32_t msb = uint32_t(1) << 31;
-      const uint32_t mask = msb >> (x & 31);
-      if ((gray_line[x] < lower_bound) || ((gray_line[x] <= upper_bound) && (int(gray_line[x]) < threshold))) {
-        // black
-        bw_line[x >> 5] |= mask;
-      } else {
-        // white
-        bw_line[x >> 5] &= ~mask;
+  const uint8_t* const gray_data = gray.data();
+
+  parallelForChunked(0, h, [&](const int y_begin, const int y_end) {
+    const uint8_t* gray_line = gray_data + y_begin * gray_bpl;
+    uint32_t* bw_line = bw_data + y_begin * bw_wpl;
+
+    for (int y = y_begin; y < y_end; ++y, gray_line += gray_bpl, bw_line += bw_wpl) {
+      uint32_t word = 0;
+      for (int x = 0; x < w; ++x) {
+        const float mean = means[y * w + x];
+        const float deviation = deviations[y * w + x];
+        const double a = 1.0 - deviation / max_deviation;
+        const double threshold = mean - k * a * (mean - min_gray_level);
+
+        const uint32_t black = (gray_line[x] < lower_bound)
+                               || ((gray_line[x] <= upper_bound) && (int(gray_line[x]) < threshold));
+        word = (word << 1) | black;
+        if ((x & 31) == 31) {
+          bw_line[x >> 5] = word;
+          word = 0;
+        }
+      }
+      if (w & 31) {
+        bw_line[(w - 1) >> 5] = word << (32 - (w & 31));
       }
     }
-  }
+  });
 
   return bw_img;
 }  // binarizeWolf
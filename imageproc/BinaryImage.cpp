@@ -21,6 +21,7 @@
 #include <QImage>
 #include <QRect>
 #include <algorithm>
+#include <atomic>
 #include <boost/foreach.hpp>
 #include <cassert>
 #include <cstddef>
@@ -29,8 +30,11 @@
 #include <memory>
 #include <new>
 #include <stdexcept>
+#include <utility>
 #include "BitOps.h"
 #include "ByteOrder.h"
+#include "MemoryBudgetManager.h"
+#include "RecyclingPool.h"
 
 namespace imageproc {
 class BinaryImage::SharedData {
@@ -49,7 +53,7 @@ class BinaryImage::SharedData {
   };
 
  public:
-  static SharedData* create(size_t num_words) { return new (NumWords(num_words)) SharedData(); }
+  static SharedData* create(size_t num_words) { return new (NumWords(num_words)) SharedData(num_words); }
 
   uint32_t* data() { return m_data; }
 
@@ -66,11 +70,15 @@ class BinaryImage::SharedData {
   static void operator delete(void* addr, NumWords num_words);
 
  private:
-  SharedData() : m_counter(1) {}
+  explicit SharedData(size_t num_words) : m_counter(1), m_numWords(num_words) {}
 
   SharedData& operator=(const SharedData&) = delete;  // forbidden
 
+  /** The number of bytes occupied by a SharedData with this many words. */
+  static size_t allocSize(size_t num_words);
+
   mutable QAtomicInt m_counter;
+  size_t m_numWords;
   uint32_t m_data[1]{};  // more data follows
 };
 
@@ -118,6 +126,8 @@ BinaryImage::BinaryImage(const QSize size, const BWColor color)
 BinaryImage::BinaryImage(const int width, const int height, SharedData* const data)
     : m_data(data), m_width(width), m_height(height), m_wpl((width + 31) / 32) {}
 
+static std::atomic<size_t> s_deep_copy_count(0);
+
 BinaryImage::BinaryImage(const BinaryImage& other)
     : m_data(other.m_data), m_width(other.m_width), m_height(other.m_height), m_wpl(other.m_wpl) {
   if (m_data) {
@@ -125,6 +135,14 @@ BinaryImage::BinaryImage(const BinaryImage& other)
   }
 }
 
+BinaryImage::BinaryImage(BinaryImage&& other) noexcept
+    : m_data(other.m_data), m_width(other.m_width), m_height(other.m_height), m_wpl(other.m_wpl) {
+  other.m_data = nullptr;
+  other.m_width = 0;
+  other.m_height = 0;
+  other.m_wpl = 0;
+}
+
 BinaryImage::BinaryImage(const QImage& image, const BinaryThreshold threshold)
     : m_data(nullptr), m_width(0), m_height(0), m_wpl(0) {
   const QRect image_rect(image.rect());
@@ -203,6 +221,12 @@ BinaryImage& BinaryImage::operator=(const BinaryImage& other) {
   return *this;
 }
 
+BinaryImage& BinaryImage::operator=(BinaryImage&& other) noexcept {
+  BinaryImage(std::move(other)).swap(*this);
+
+  return *this;
+}
+
 void BinaryImage::swap(BinaryImage& other) {
   std::swap(m_data, other.m_data);
   std::swap(m_width, other.m_width);
@@ -394,12 +418,11 @@ int BinaryImage::countBlackPixels(const QRect& rect) const {
     }
   } else {
     for (int y = top; y <= bottom; ++y, line += m_wpl) {
-      int idx = first_word_idx;
-      count += countNonZeroBits(line[idx] & first_word_mask);
-      for (++idx; idx != last_word_idx; ++idx) {
-        count += countNonZeroBits(line[idx]);
-      }
-      count += countNonZeroBits(line[idx] & last_word_mask);
+      count += countNonZeroBits(line[first_word_idx] & first_word_mask);
+      // The whole words in between go through the bulk counter,
+      // which uses hardware popcount where available.
+      count += int(countNonZeroBits(line + first_word_idx + 1, last_word_idx - first_word_idx - 1));
+      count += countNonZeroBits(line[last_word_idx] & last_word_mask);
     }
   }
 
@@ -780,12 +803,22 @@ QImage BinaryImage::toAlphaMask(const QColor& color) const {
   return dst;
 }  // BinaryImage::toAlphaMask
 
+size_t BinaryImage::deepCopyCount() {
+  return s_deep_copy_count.load(std::memory_order_relaxed);
+}
+
+void BinaryImage::resetDeepCopyCount() {
+  s_deep_copy_count.store(0, std::memory_order_relaxed);
+}
+
 void BinaryImage::copyIfShared() {
   assert(m_data);
   if (!m_data->isShared()) {
     return;
   }
 
+  s_deep_copy_count.fetch_add(1, std::memory_order_relaxed);
+
   const size_t num_words = m_height * m_wpl;
   SharedData* new_data = SharedData::create(num_words);
   memcpy(new_data->data(), m_data->data(), num_words * 4);
@@ -1279,22 +1312,29 @@ bool operator==(const BinaryImage& lhs, const BinaryImage& rhs) {
 
 void BinaryImage::SharedData::unref() const {
   if (!m_counter.deref()) {
+    const size_t num_words = m_numWords;
     this->~SharedData();
-    free((void*) this);
+    RecyclingPool::release((void*) this, allocSize(num_words));
+    MemoryBudgetManager::instance().recordRelease(allocSize(num_words));
   }
 }
 
-void* BinaryImage::SharedData::operator new(size_t, const NumWords num_words) {
+size_t BinaryImage::SharedData::allocSize(const size_t num_words) {
   SharedData* sd = nullptr;
-  void* addr = malloc(((char*) &sd->m_data[0] - (char*) sd) + num_words.numWords * 4);
-  if (!addr) {
-    throw std::bad_alloc();
-  }
 
-  return addr;
+  return ((char*) &sd->m_data[0] - (char*) sd) + num_words * 4;
+}
+
+void* BinaryImage::SharedData::operator new(size_t, const NumWords num_words) {
+  // Recording before allocating gives the budget manager a chance
+  // to shed caches and make this very allocation succeed.
+  MemoryBudgetManager::instance().recordAllocation(allocSize(num_words.numWords));
+
+  return RecyclingPool::alloc(allocSize(num_words.numWords));
 }
 
-void BinaryImage::SharedData::operator delete(void* addr, NumWords) {
-  free(addr);
+void BinaryImage::SharedData::operator delete(void* addr, const NumWords num_words) {
+  RecyclingPool::release(addr, allocSize(num_words.numWords));
+  MemoryBudgetManager::instance().recordRelease(allocSize(num_words.numWords));
 }
 }  // namespace imageproc
\ No newline at end of file
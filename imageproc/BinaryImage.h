@@ -82,6 +82,14 @@ class BinaryImage {
    */
   BinaryImage(const BinaryImage& other);
 
+  /**
+   * \brief Takes over the data of another image, which becomes null.
+   *
+   * Unlike copying, this doesn't leave the data shared, so a subsequent
+   * write won't trigger copy-on-write.
+   */
+  BinaryImage(BinaryImage&& other) noexcept;
+
   /**
    * \brief Create a new image by copying the contents of a QImage.
    *
@@ -112,6 +120,11 @@ class BinaryImage {
    */
   BinaryImage& operator=(const BinaryImage& other);
 
+  /**
+   * \brief Replaces the current image with another one, which becomes null.
+   */
+  BinaryImage& operator=(BinaryImage&& other) noexcept;
+
   /**
    * \brief Returns true if the image is null.
    *
@@ -249,6 +262,18 @@ class BinaryImage {
 
   BWColor getPixel(int x, int y);
 
+  /**
+   * \brief The number of copy-on-write events since startup or the last reset.
+   *
+   * Each such event copies the whole image, which on large pages is many
+   * megabytes of memory traffic.  Sampling this counter around a pipeline
+   * run verifies that the pipeline doesn't deep-copy behind our back.
+   * The count is accumulated across all threads.
+   */
+  static size_t deepCopyCount();
+
+  static void resetDeepCopyCount();
+
  private:
   class SharedData;
 
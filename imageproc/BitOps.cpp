@@ -17,6 +17,17 @@
  */
 
 #include "BitOps.h"
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMAGEPROC_BITOPS_POPCNT 1
+#include <nmmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define IMAGEPROC_BITOPS_NEON 1
+#include <arm_neon.h>
+#endif
 
 namespace imageproc {
 namespace detail {
@@ -45,4 +56,64 @@ const unsigned char reversedBits[256]
        0x27, 0xa7, 0x67, 0xe7, 0x17, 0x97, 0x57, 0xd7, 0x37, 0xb7, 0x77, 0xf7, 0x0f, 0x8f, 0x4f, 0xcf, 0x2f, 0xaf, 0x6f,
        0xef, 0x1f, 0x9f, 0x5f, 0xdf, 0x3f, 0xbf, 0x7f, 0xff};
 }  // namespace detail
+
+namespace {
+size_t countRunScalar(const uint32_t* const words, const size_t num_words) {
+  size_t count = 0;
+  for (size_t i = 0; i < num_words; ++i) {
+    count += countNonZeroBits(words[i]);
+  }
+
+  return count;
+}
+
+#if defined(IMAGEPROC_BITOPS_POPCNT)
+__attribute__((target("popcnt"))) size_t countRunPopcnt(const uint32_t* const words, const size_t num_words) {
+  size_t count = 0;
+
+  size_t i = 0;
+  for (; i + 2 <= num_words; i += 2) {
+    uint64_t pair;
+    std::memcpy(&pair, words + i, sizeof(pair));
+    count += size_t(_mm_popcnt_u64(pair));
+  }
+  if (i < num_words) {
+    count += size_t(_mm_popcnt_u32(words[i]));
+  }
+
+  return count;
+}
+#endif
+
+#if defined(IMAGEPROC_BITOPS_NEON)
+size_t countRunNeon(const uint32_t* const words, const size_t num_words) {
+  size_t count = 0;
+
+  size_t i = 0;
+  for (; i + 4 <= num_words; i += 4) {
+    const uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t*>(words + i));
+    const uint64x2_t sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(vcntq_u8(bytes))));
+    count += vgetq_lane_u64(sums, 0) + vgetq_lane_u64(sums, 1);
+  }
+  for (; i < num_words; ++i) {
+    count += countNonZeroBits(words[i]);
+  }
+
+  return count;
+}
+#endif
+}  // namespace
+
+size_t countNonZeroBits(const uint32_t* const words, const size_t num_words) {
+#if defined(IMAGEPROC_BITOPS_POPCNT)
+  static size_t (*const kernel)(const uint32_t*, size_t)
+      = __builtin_cpu_supports("popcnt") ? &countRunPopcnt : &countRunScalar;
+
+  return kernel(words, num_words);
+#elif defined(IMAGEPROC_BITOPS_NEON)
+  return countRunNeon(words, num_words);
+#else
+  return countRunScalar(words, num_words);
+#endif
+}
 }  // namespace imageproc
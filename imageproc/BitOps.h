@@ -19,6 +19,9 @@
 #ifndef IMAGEPROC_BITOPS_H_
 #define IMAGEPROC_BITOPS_H_
 
+#include <cstddef>
+#include <cstdint>
+
 namespace imageproc {
 namespace detail {
 extern const unsigned char bitCounts[256];
@@ -140,6 +143,15 @@ int countNonZeroBits(const T val) {
   return detail::NonZeroBits<T, sizeof(T)>::count(val);
 }
 
+/**
+ * \brief Returns the number of non-zero bits in a run of words.
+ *
+ * Equivalent to summing countNonZeroBits() over the run, except the
+ * count is done with the hardware population count instruction where
+ * one is available at run time.
+ */
+size_t countNonZeroBits(const uint32_t* words, size_t num_words);
+
 template <typename T>
 T reverseBits(const T val) {
   return detail::ReverseBytes<T, sizeof(T), 0>::result(val);
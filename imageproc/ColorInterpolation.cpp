@@ -33,4 +33,18 @@ QColor colorInterpolation(const QColor& from, const QColor& to, double dist) {
 
   return QColor::fromRgbF(r, g, b, a);
 }
+
+ColorInterpolationTable::ColorInterpolationTable(const QColor& from, const QColor& to) {
+  for (int i = 0; i < 256; ++i) {
+    const QColor color(colorInterpolation(from, to, i / 255.0));
+    m_table[i] = color.rgba();
+    m_premultiplied[i] = qPremultiply(m_table[i]);
+  }
+}
+
+void ColorInterpolationTable::mapPremultiplied(const uint8_t* dists, uint32_t* colors, size_t len) const {
+  for (size_t i = 0; i < len; ++i) {
+    colors[i] = m_premultiplied[dists[i]];
+  }
+}
 }  // namespace imageproc
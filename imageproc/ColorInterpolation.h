@@ -20,6 +20,9 @@
 #define IMAGEPROC_COLORINTERPOLATION_H_
 
 #include <QColor>
+#include <QRgb>
+#include <cstddef>
+#include <cstdint>
 
 namespace imageproc {
 /**
@@ -29,5 +32,38 @@ namespace imageproc {
  * \p dist 0 corresponds to \p from, while \p dist 1 corresponds to \p to.
  */
 QColor colorInterpolation(const QColor& from, const QColor& to, double dist);
+
+/**
+ * \brief Precomputed interpolation between two fixed endpoint colors.
+ *
+ * When the same pair of colors is interpolated across many pixels,
+ * going through colorInterpolation() converts both endpoints to
+ * floating point and back for every call.  This class does the
+ * floating point work once for all 256 quantized distances, after
+ * which a lookup replaces the per-pixel math.  Entry \p i matches
+ * colorInterpolation(from, to, i / 255.0) exactly, premultiplication
+ * aside.
+ */
+class ColorInterpolationTable {
+ public:
+  ColorInterpolationTable(const QColor& from, const QColor& to);
+
+  /** \p dist 0 corresponds to \e from, 255 to \e to. */
+  QRgb operator[](uint8_t dist) const { return m_table[dist]; }
+
+  QColor color(uint8_t dist) const { return QColor::fromRgba(m_table[dist]); }
+
+  /**
+   * \brief Maps a buffer of quantized distances to premultiplied colors.
+   *
+   * Suitable for filling the scanlines of a Format_ARGB32_Premultiplied
+   * image directly from a grayscale distance field.
+   */
+  void mapPremultiplied(const uint8_t* dists, uint32_t* colors, size_t len) const;
+
+ private:
+  QRgb m_table[256];
+  uint32_t m_premultiplied[256];
+};
 }  // namespace imageproc
 #endif
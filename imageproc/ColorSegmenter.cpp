@@ -2,10 +2,12 @@
 #include "ColorSegmenter.h"
 #include <QImage>
 #include <cmath>
+#include <mutex>
 #include "BinaryImage.h"
 #include "Dpi.h"
 #include "GrayImage.h"
 #include "InfluenceMap.h"
+#include "ParallelFor.h"
 #include "RasterOp.h"
 
 namespace imageproc {
@@ -124,30 +126,38 @@ GrayImage ColorSegmenter::getRgbChannel(const QImage& image, const ColorSegmente
   }
 
   GrayImage dst(image.size());
-  const auto* img_line = reinterpret_cast<const uint32_t*>(image.bits());
+  const auto* const img_data = reinterpret_cast<const uint32_t*>(image.bits());
   const int img_stride = image.bytesPerLine() / sizeof(uint32_t);
-  uint8_t* dst_line = dst.data();
+  uint8_t* const dst_data = dst.data();
   const int dst_stride = dst.stride();
   const int width = image.width();
   const int height = image.height();
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      switch (channel) {
-        case RED_CHANNEL:
-          dst_line[x] = static_cast<uint8_t>((img_line[x] >> 16) & 0xff);
-          break;
-        case GREEN_CHANNEL:
-          dst_line[x] = static_cast<uint8_t>((img_line[x] >> 8) & 0xff);
-          break;
-        case BLUE_CHANNEL:
-          dst_line[x] = static_cast<uint8_t>(img_line[x] & 0xff);
-          break;
+  int shift = 0;
+  switch (channel) {
+    case RED_CHANNEL:
+      shift = 16;
+      break;
+    case GREEN_CHANNEL:
+      shift = 8;
+      break;
+    case BLUE_CHANNEL:
+      shift = 0;
+      break;
+  }
+
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    const uint32_t* img_line = img_data + chunk_begin * img_stride;
+    uint8_t* dst_line = dst_data + chunk_begin * dst_stride;
+
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      for (int x = 0; x < width; ++x) {
+        dst_line[x] = static_cast<uint8_t>((img_line[x] >> shift) & 0xff);
       }
+      img_line += img_stride;
+      dst_line += dst_stride;
     }
-    img_line += img_stride;
-    dst_line += dst_stride;
-  }
+  });
 
   return dst;
 }
@@ -223,11 +233,16 @@ void ColorSegmenter::fromRgb(const BinaryImage& image,
   BinaryImage remainingComponents(image);
   rasterOp<RopSubtract<RopDst, RopSrc>>(remainingComponents, m_segmentsMap.getBinaryMask());
   m_segmentsMap.addComponents(remainingComponents, CONN8);
+
+  // The map is only read from here on, and getImage() sweeps it
+  // several times - keep it in 16-bit labels when they fit.
+  m_segmentsMap.compact();
 }
 
 void ColorSegmenter::fromGrayscale(const BinaryImage& image, const GrayImage& originalImage) {
   this->m_originalImage = originalImage;
   this->m_segmentsMap = ConnectivityMap(image, CONN8);
+  this->m_segmentsMap.compact();
 }
 
 void ColorSegmenter::reduceNoise() {
@@ -239,16 +254,33 @@ void ColorSegmenter::reduceNoise() {
   const int height = size.height();
 
   // Count the number of pixels and the bounding rect of each component.
-  const uint32_t* map_line = m_segmentsMap.data();
+  // Strips are scanned independently with their statistics merged afterwards.
+  const uint32_t* const map_data = m_segmentsMap.data();
   const int map_stride = m_segmentsMap.stride();
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      const uint32_t label = map_line[x];
-      ++components[label].pixelsCount;
-      boundingBoxes[label].extend(x, y);
+  std::mutex stats_mutex;
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    std::vector<Component> chunk_components(components.size());
+    std::vector<BoundingBox> chunk_boxes(boundingBoxes.size());
+
+    const uint32_t* map_line = map_data + chunk_begin * map_stride;
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      for (int x = 0; x < width; ++x) {
+        const uint32_t label = map_line[x];
+        ++chunk_components[label].pixelsCount;
+        chunk_boxes[label].extend(x, y);
+      }
+      map_line += map_stride;
     }
-    map_line += map_stride;
-  }
+
+    const std::lock_guard<std::mutex> guard(stats_mutex);
+    for (size_t label = 0; label < components.size(); ++label) {
+      components[label].pixelsCount += chunk_components[label].pixelsCount;
+      if (chunk_components[label].pixelsCount > 0) {
+        boundingBoxes[label].extend(chunk_boxes[label].left, chunk_boxes[label].top);
+        boundingBoxes[label].extend(chunk_boxes[label].right, chunk_boxes[label].bottom);
+      }
+    }
+  });
 
   // creating set of labels determining components to be removed
   std::unordered_set<uint32_t> labels;
@@ -272,28 +304,51 @@ QImage ColorSegmenter::buildRgbImage() const {
   std::vector<uint32_t> colorMap(m_segmentsMap.maxLabel() + 1, 0);
 
   {
-    const uint32_t* map_line = m_segmentsMap.data();
     const int map_stride = m_segmentsMap.stride();
 
-    const auto* img_line = reinterpret_cast<const uint32_t*>(m_originalImage.bits());
+    const auto* const img_data = reinterpret_cast<const uint32_t*>(m_originalImage.bits());
     const int img_stride = m_originalImage.bytesPerLine() / sizeof(uint32_t);
 
     std::vector<Component> components(m_segmentsMap.maxLabel() + 1);
     std::vector<RgbColor> rgbSumMap(m_segmentsMap.maxLabel() + 1);
-    for (int y = 0; y < height; ++y) {
-      for (int x = 0; x < width; ++x) {
-        const uint32_t label = map_line[x];
-        if (label == 0) {
-          continue;
+    std::mutex sums_mutex;
+    const auto accumulate = [&](const auto* map_data) {
+      parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+        std::vector<Component> chunk_components(components.size());
+        std::vector<RgbColor> chunk_sums(rgbSumMap.size());
+
+        const auto* map_line = map_data + chunk_begin * map_stride;
+        const uint32_t* img_line = img_data + chunk_begin * img_stride;
+        for (int y = chunk_begin; y < chunk_end; ++y) {
+          for (int x = 0; x < width; ++x) {
+            const uint32_t label = map_line[x];
+            if (label == 0) {
+              continue;
+            }
+
+            ++chunk_components[label].pixelsCount;
+            chunk_sums[label].red += static_cast<uint8_t>((img_line[x] >> 16) & 0xff);
+            chunk_sums[label].green += static_cast<uint8_t>((img_line[x] >> 8) & 0xff);
+            chunk_sums[label].blue += static_cast<uint8_t>(img_line[x] & 0xff);
+          }
+          map_line += map_stride;
+          img_line += img_stride;
         }
 
-        ++components[label].pixelsCount;
-        rgbSumMap[label].red += static_cast<uint8_t>((img_line[x] >> 16) & 0xff);
-        rgbSumMap[label].green += static_cast<uint8_t>((img_line[x] >> 8) & 0xff);
-        rgbSumMap[label].blue += static_cast<uint8_t>(img_line[x] & 0xff);
-      }
-      map_line += map_stride;
-      img_line += img_stride;
+        const std::lock_guard<std::mutex> guard(sums_mutex);
+        for (size_t label = 0; label < components.size(); ++label) {
+          components[label].pixelsCount += chunk_components[label].pixelsCount;
+          rgbSumMap[label].red += chunk_sums[label].red;
+          rgbSumMap[label].green += chunk_sums[label].green;
+          rgbSumMap[label].blue += chunk_sums[label].blue;
+        }
+      });
+    };
+
+    if (m_segmentsMap.isCompact()) {
+      accumulate(m_segmentsMap.data16());
+    } else {
+      accumulate(m_segmentsMap.data());
     }
 
     for (int label = 1; label <= m_segmentsMap.maxLabel(); label++) {
@@ -310,23 +365,35 @@ QImage ColorSegmenter::buildRgbImage() const {
   QImage dst(m_originalImage.size(), QImage::Format_ARGB32_Premultiplied);
   dst.fill(Qt::white);
 
-  auto* dst_line = reinterpret_cast<uint32_t*>(dst.bits());
+  auto* const dst_data = reinterpret_cast<uint32_t*>(dst.bits());
   const int dst_stride = dst.bytesPerLine() / sizeof(uint32_t);
 
-  const uint32_t* map_line = m_segmentsMap.data();
   const int map_stride = m_segmentsMap.stride();
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      const uint32_t label = map_line[x];
-      if (label == 0) {
-        continue;
+  const auto render = [&](const auto* map_data) {
+    parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+      const auto* map_line = map_data + chunk_begin * map_stride;
+      uint32_t* dst_line = dst_data + chunk_begin * dst_stride;
+
+      for (int y = chunk_begin; y < chunk_end; ++y) {
+        for (int x = 0; x < width; ++x) {
+          const uint32_t label = map_line[x];
+          if (label == 0) {
+            continue;
+          }
+
+          dst_line[x] = colorMap[label];
+        }
+        map_line += map_stride;
+        dst_line += dst_stride;
       }
+    });
+  };
 
-      dst_line[x] = colorMap[label];
-    }
-    map_line += map_stride;
-    dst_line += dst_stride;
+  if (m_segmentsMap.isCompact()) {
+    render(m_segmentsMap.data16());
+  } else {
+    render(m_segmentsMap.data());
   }
 
   return dst.convertToFormat(QImage::Format_RGB32);
@@ -343,26 +410,47 @@ QImage ColorSegmenter::buildGrayImage() const {
   std::vector<uint8_t> colorMap(m_segmentsMap.maxLabel() + 1, 0);
 
   {
-    const uint32_t* map_line = m_segmentsMap.data();
     const int map_stride = m_segmentsMap.stride();
 
-    const auto* img_line = m_originalImage.bits();
+    const auto* const img_data = m_originalImage.bits();
     const int img_stride = m_originalImage.bytesPerLine();
 
     std::vector<Component> components(m_segmentsMap.maxLabel() + 1);
     std::vector<uint32_t> graySumMap(m_segmentsMap.maxLabel() + 1, 0);
-    for (int y = 0; y < height; ++y) {
-      for (int x = 0; x < width; ++x) {
-        const uint32_t label = map_line[x];
-        if (label == 0) {
-          continue;
+    std::mutex sums_mutex;
+    const auto accumulate = [&](const auto* map_data) {
+      parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+        std::vector<Component> chunk_components(components.size());
+        std::vector<uint32_t> chunk_sums(graySumMap.size(), 0);
+
+        const auto* map_line = map_data + chunk_begin * map_stride;
+        const uint8_t* img_line = img_data + chunk_begin * img_stride;
+        for (int y = chunk_begin; y < chunk_end; ++y) {
+          for (int x = 0; x < width; ++x) {
+            const uint32_t label = map_line[x];
+            if (label == 0) {
+              continue;
+            }
+
+            ++chunk_components[label].pixelsCount;
+            chunk_sums[label] += img_line[x];
+          }
+          map_line += map_stride;
+          img_line += img_stride;
         }
 
-        ++components[label].pixelsCount;
-        graySumMap[label] += img_line[x];
-      }
-      map_line += map_stride;
-      img_line += img_stride;
+        const std::lock_guard<std::mutex> guard(sums_mutex);
+        for (size_t label = 0; label < components.size(); ++label) {
+          components[label].pixelsCount += chunk_components[label].pixelsCount;
+          graySumMap[label] += chunk_sums[label];
+        }
+      });
+    };
+
+    if (m_segmentsMap.isCompact()) {
+      accumulate(m_segmentsMap.data16());
+    } else {
+      accumulate(m_segmentsMap.data());
     }
 
     for (int label = 1; label <= m_segmentsMap.maxLabel(); label++) {
@@ -373,23 +461,35 @@ QImage ColorSegmenter::buildGrayImage() const {
   GrayImage dst(m_originalImage.size());
   dst.fill(0xff);
 
-  uint8_t* dst_line = dst.data();
+  uint8_t* const dst_data = dst.data();
   const int dst_stride = dst.stride();
 
-  const uint32_t* map_line = m_segmentsMap.data();
   const int map_stride = m_segmentsMap.stride();
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      const uint32_t label = map_line[x];
-      if (label == 0) {
-        continue;
+  const auto render = [&](const auto* map_data) {
+    parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+      const auto* map_line = map_data + chunk_begin * map_stride;
+      uint8_t* dst_line = dst_data + chunk_begin * dst_stride;
+
+      for (int y = chunk_begin; y < chunk_end; ++y) {
+        for (int x = 0; x < width; ++x) {
+          const uint32_t label = map_line[x];
+          if (label == 0) {
+            continue;
+          }
+
+          dst_line[x] = colorMap[label];
+        }
+        map_line += map_stride;
+        dst_line += dst_stride;
       }
+    });
+  };
 
-      dst_line[x] = colorMap[label];
-    }
-    map_line += map_stride;
-    dst_line += dst_stride;
+  if (m_segmentsMap.isCompact()) {
+    render(m_segmentsMap.data16());
+  } else {
+    render(m_segmentsMap.data());
   }
 
   return dst;
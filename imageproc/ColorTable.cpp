@@ -1,11 +1,92 @@
 
 #include "ColorTable.h"
 #include <cassert>
+#include <mutex>
 #include <set>
 #include <unordered_set>
+#include <vector>
 #include "BinaryImage.h"
+#include "ParallelFor.h"
 
 namespace imageproc {
+namespace {
+/**
+ * \brief An open-addressing hash map from packed RGB(A) values to counts.
+ *
+ * Color counting is the inner loop of palette building, and the generic
+ * node-based std::unordered_map spends most of its time on allocation and
+ * pointer chasing there.  This counter keeps flat slots with linear probing;
+ * a count of zero marks an empty slot, which works because counts are
+ * always positive.
+ */
+class PackedColorCounter {
+ public:
+  PackedColorCounter() : m_slots(INITIAL_CAPACITY), m_mask(INITIAL_CAPACITY - 1), m_size(0) {}
+
+  void add(const uint32_t color, const int count) {
+    if (m_size * 2 >= m_slots.size()) {
+      grow();
+    }
+
+    size_t idx = hash(color) & m_mask;
+    while (true) {
+      Slot& slot = m_slots[idx];
+      if (slot.count == 0) {
+        slot.color = color;
+        slot.count = count;
+        ++m_size;
+
+        return;
+      }
+      if (slot.color == color) {
+        slot.count += count;
+
+        return;
+      }
+      idx = (idx + 1) & m_mask;
+    }
+  }
+
+  template <typename Func>
+  void forEach(Func func) const {
+    for (const Slot& slot : m_slots) {
+      if (slot.count != 0) {
+        func(slot.color, slot.count);
+      }
+    }
+  }
+
+ private:
+  struct Slot {
+    uint32_t color = 0;
+    int count = 0;
+  };
+
+  static const size_t INITIAL_CAPACITY = 1024;  // Must be a power of two.
+
+  static size_t hash(const uint32_t color) {
+    // Fibonacci hashing - a single multiply spreads the packed
+    // channels over the whole range.
+    return static_cast<size_t>((color * UINT64_C(0x9E3779B97F4A7C15)) >> 32);
+  }
+
+  void grow() {
+    std::vector<Slot> old_slots(m_slots.size() * 2);
+    old_slots.swap(m_slots);
+    m_mask = m_slots.size() - 1;
+    m_size = 0;
+    for (const Slot& slot : old_slots) {
+      if (slot.count != 0) {
+        add(slot.color, slot.count);
+      }
+    }
+  }
+
+  std::vector<Slot> m_slots;
+  size_t m_mask;
+  size_t m_size;
+};
+}  // namespace
 
 ColorTable::ColorTable(const QImage& image) {
   if ((image.format() != QImage::Format_Indexed8) && (image.format() != QImage::Format_RGB32)
@@ -140,19 +221,36 @@ std::unordered_map<uint32_t, int> ColorTable::paletteFromIndexedWithStatistics()
   const int width = m_image.width();
   const int height = m_image.height();
 
-  const uint8_t* img_line = m_image.bits();
+  const uint8_t* const img_data = m_image.bits();
   const int img_stride = m_image.bytesPerLine();
 
   QVector<QRgb> colorTable = m_image.colorTable();
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      uint8_t colorIndex = img_line[x];
-      uint32_t color = colorTable[colorIndex];
+  // An indexed image can only reference 256 colors, so a single-pass
+  // histogram of indices replaces per-pixel hash lookups entirely.
+  int hist[256] = {};
+  std::mutex hist_mutex;
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    int chunk_hist[256] = {};
 
-      ++palette[color];
+    const uint8_t* img_line = img_data + chunk_begin * img_stride;
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      for (int x = 0; x < width; ++x) {
+        ++chunk_hist[img_line[x]];
+      }
+      img_line += img_stride;
+    }
+
+    const std::lock_guard<std::mutex> guard(hist_mutex);
+    for (int i = 0; i < 256; ++i) {
+      hist[i] += chunk_hist[i];
+    }
+  });
+
+  for (int i = 0; i < colorTable.size() && i < 256; ++i) {
+    if (hist[i] != 0) {
+      palette[colorTable[i]] += hist[i];
     }
-    img_line += img_stride;
   }
 
   return palette;
@@ -164,17 +262,33 @@ std::unordered_map<uint32_t, int> ColorTable::paletteFromRgbWithStatistics() con
   const int width = m_image.width();
   const int height = m_image.height();
 
-  const auto* img_line = reinterpret_cast<const uint32_t*>(m_image.bits());
+  const auto* const img_data = reinterpret_cast<const uint32_t*>(m_image.bits());
   const int img_stride = m_image.bytesPerLine() / sizeof(uint32_t);
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      uint32_t color = img_line[x];
-
-      ++palette[color];
+  std::mutex palette_mutex;
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    PackedColorCounter counter;
+
+    const uint32_t* img_line = img_data + chunk_begin * img_stride;
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      // Scanned pages are dominated by long runs of identical pixels,
+      // so count a whole run with a single hash probe.
+      int x = 0;
+      while (x < width) {
+        const uint32_t color = img_line[x];
+        int run = 1;
+        while (x + run < width && img_line[x + run] == color) {
+          ++run;
+        }
+        counter.add(color, run);
+        x += run;
+      }
+      img_line += img_stride;
     }
-    img_line += img_stride;
-  }
+
+    const std::lock_guard<std::mutex> guard(palette_mutex);
+    counter.forEach([&palette](const uint32_t color, const int count) { palette[color] += count; });
+  });
 
   return palette;
 }
@@ -192,19 +306,30 @@ void ColorTable::remapColorsInIndexedImage(const std::unordered_map<uint32_t, ui
     const int width = m_image.width();
     const int height = m_image.height();
 
-    uint8_t* img_line = m_image.bits();
+    uint8_t* const img_data = m_image.bits();
     const int img_stride = m_image.bytesPerLine();
 
     QVector<QRgb> colorTable = m_image.colorTable();
 
-    for (int y = 0; y < height; ++y) {
-      for (int x = 0; x < width; ++x) {
-        uint32_t color = colorTable[img_line[x]];
-        uint32_t newColor = colorMap.at(color);
-        img_line[x] = colorToIndexMap[newColor];
+    // Resolve color table entries to new indices once, reducing the
+    // per-pixel work to a plain table lookup.
+    std::vector<uint8_t> indexRemap(colorTable.size(), 0);
+    for (int i = 0; i < colorTable.size(); ++i) {
+      const auto it = colorMap.find(colorTable[i]);
+      if (it != colorMap.end()) {
+        indexRemap[i] = colorToIndexMap[it->second];
       }
-      img_line += img_stride;
     }
+
+    parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+      uint8_t* img_line = img_data + chunk_begin * img_stride;
+      for (int y = chunk_begin; y < chunk_end; ++y) {
+        for (int x = 0; x < width; ++x) {
+          img_line[x] = indexRemap[img_line[x]];
+        }
+        img_line += img_stride;
+      }
+    });
   }
 
   QVector<QRgb> newColorTable(static_cast<int>(colorToIndexMap.size()));
@@ -219,16 +344,30 @@ void ColorTable::remapColorsInRgbImage(const std::unordered_map<uint32_t, uint32
   const int width = m_image.width();
   const int height = m_image.height();
 
-  auto* img_line = reinterpret_cast<uint32_t*>(m_image.bits());
+  auto* const img_data = reinterpret_cast<uint32_t*>(m_image.bits());
   const int img_stride = m_image.bytesPerLine() / sizeof(uint32_t);
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      uint32_t color = img_line[x];
-      img_line[x] = colorMap.at(color);
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    // Consecutive pixels usually share a color - remember the last
+    // lookup to skip most of the hash probes.
+    uint32_t last_color = 0;
+    uint32_t last_mapped = 0;
+    bool have_last = false;
+
+    uint32_t* img_line = img_data + chunk_begin * img_stride;
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      for (int x = 0; x < width; ++x) {
+        const uint32_t color = img_line[x];
+        if (!have_last || color != last_color) {
+          last_mapped = colorMap.at(color);
+          last_color = color;
+          have_last = true;
+        }
+        img_line[x] = last_mapped;
+      }
+      img_line += img_stride;
     }
-    img_line += img_stride;
-  }
+  });
 }
 
 void ColorTable::buildIndexedImageFromRgb(const std::unordered_map<uint32_t, uint32_t>& colorMap) {
@@ -365,10 +504,10 @@ QImage ColorTable::toIndexedImage(const QVector<QRgb>* colorTable) const {
   const int width = m_image.width();
   const int height = m_image.height();
 
-  const auto* img_line = reinterpret_cast<const uint32_t*>(m_image.bits());
+  const auto* const img_data = reinterpret_cast<const uint32_t*>(m_image.bits());
   const int img_stride = m_image.bytesPerLine() / sizeof(uint32_t);
 
-  uint8_t* dst_line = dst.bits();
+  uint8_t* const dst_data = dst.bits();
   const int dst_stride = dst.bytesPerLine();
 
   std::unordered_map<uint32_t, uint8_t> colorToIndex;
@@ -376,13 +515,28 @@ QImage ColorTable::toIndexedImage(const QVector<QRgb>* colorTable) const {
     colorToIndex[palette[i]] = static_cast<uint8_t>(i);
   }
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      dst_line[x] = colorToIndex[img_line[x]];
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    uint32_t last_color = 0;
+    uint8_t last_index = 0;
+    bool have_last = false;
+
+    const uint32_t* img_line = img_data + chunk_begin * img_stride;
+    uint8_t* dst_line = dst_data + chunk_begin * dst_stride;
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      for (int x = 0; x < width; ++x) {
+        const uint32_t color = img_line[x];
+        if (!have_last || color != last_color) {
+          const auto it = colorToIndex.find(color);
+          last_index = (it != colorToIndex.end()) ? it->second : uint8_t(0);
+          last_color = color;
+          have_last = true;
+        }
+        dst_line[x] = last_index;
+      }
+      img_line += img_stride;
+      dst_line += dst_stride;
     }
-    img_line += img_stride;
-    dst_line += dst_stride;
-  }
+  });
 
   dst.setDotsPerMeterX(m_image.dotsPerMeterX());
   dst.setDotsPerMeterY(m_image.dotsPerMeterY());
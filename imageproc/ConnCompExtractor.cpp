@@ -0,0 +1,114 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ConnCompExtractor.h"
+#include <QRect>
+#include "BWColor.h"
+
+namespace imageproc {
+namespace {
+struct Accumulator {
+  int minX;
+  int minY;
+  int maxX;
+  int maxY;
+  int pixCount;
+  QPoint seed;
+
+  Accumulator() : minX(0), minY(0), maxX(0), maxY(0), pixCount(0) {}
+};
+}  // namespace
+
+ConnCompExtractor::ConnCompExtractor(const BinaryImage& image, const Connectivity conn)
+    : m_cmap(image, conn, ConnectivityMap::LABEL_UNION_FIND) {
+  const uint32_t max_label = m_cmap.maxLabel();
+  if (max_label == 0) {
+    return;
+  }
+
+  std::vector<Accumulator> accums(max_label);
+
+  const int width = m_cmap.size().width();
+  const int height = m_cmap.size().height();
+  const int stride = m_cmap.stride();
+  const uint32_t* line = m_cmap.data();
+  for (int y = 0; y < height; ++y, line += stride) {
+    for (int x = 0; x < width; ++x) {
+      const uint32_t label = line[x];
+      if (label == 0) {
+        continue;
+      }
+
+      Accumulator& accum = accums[label - 1];
+      if (accum.pixCount == 0) {
+        accum.seed = QPoint(x, y);
+        accum.minX = accum.maxX = x;
+        accum.minY = accum.maxY = y;
+      } else {
+        if (x < accum.minX) {
+          accum.minX = x;
+        } else if (x > accum.maxX) {
+          accum.maxX = x;
+        }
+        // Rows are visited top to bottom.
+        accum.maxY = y;
+      }
+      ++accum.pixCount;
+    }
+  }
+
+  m_components.reserve(max_label);
+  for (const Accumulator& accum : accums) {
+    const QRect rect(QPoint(accum.minX, accum.minY), QPoint(accum.maxX, accum.maxY));
+    m_components.push_back(ConnComp(accum.seed, rect, accum.pixCount));
+  }
+}
+
+BinaryImage ConnCompExtractor::extract(const size_t idx) const {
+  return extractRect(static_cast<uint32_t>(idx + 1), m_components[idx].rect());
+}
+
+BinaryImage ConnCompExtractor::extractAligned(const size_t idx, QRect* const rect) const {
+  QRect r(m_components[idx].rect());
+  r.setX((r.x() >> 5) << 5);
+  if (rect) {
+    *rect = r;
+  }
+
+  return extractRect(static_cast<uint32_t>(idx + 1), r);
+}
+
+BinaryImage ConnCompExtractor::extractRect(const uint32_t label, const QRect& rect) const {
+  BinaryImage dst(rect.width(), rect.height(), WHITE);
+
+  const int stride = m_cmap.stride();
+  const uint32_t* src_line = m_cmap.data() + rect.top() * stride + rect.left();
+  const size_t dst_wpl = dst.wordsPerLine();
+  uint32_t* dst_line = dst.data();
+  const int width = rect.width();
+  for (int y = 0; y < rect.height(); ++y, src_line += stride, dst_line += dst_wpl) {
+    for (int x = 0; x < width; ++x) {
+      if (src_line[x] == label) {
+        dst_line[x >> 5] |= uint32_t(0x80000000) >> (x & 31);
+      }
+    }
+  }
+
+  return dst;
+}
+}  // namespace imageproc
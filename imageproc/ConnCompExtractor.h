@@ -0,0 +1,88 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGEPROC_CONNCOMPEXTRACTOR_H_
+#define IMAGEPROC_CONNCOMPEXTRACTOR_H_
+
+#include <cstddef>
+#include <vector>
+#include "BinaryImage.h"
+#include "ConnComp.h"
+#include "ConnectivityMap.h"
+#include "Connectivity.h"
+
+class QRect;
+
+namespace imageproc {
+/**
+ * \brief Extracts all connected components of an image in one labeling pass.
+ *
+ * ConnCompEraser and ConnCompEraserExt discover components one at a time,
+ * flood-filling and erasing each in turn, which on pages with thousands of
+ * components means thousands of passes over overlapping areas.  This class
+ * labels the image once and accumulates the metadata of every component
+ * (bounding box, pixel count, seed point) in a single scan of the label map.
+ * Component pixels are only materialized for the components the caller
+ * actually asks for.
+ */
+class ConnCompExtractor {
+ public:
+  /**
+   * \param image The image whose connected components are to be extracted.
+   * \param conn Defines which neighbouring pixels are considered to be connected.
+   */
+  ConnCompExtractor(const BinaryImage& image, Connectivity conn);
+
+  /**
+   * \brief The number of connected components, background excluded.
+   */
+  size_t numComponents() const { return m_components.size(); }
+
+  /**
+   * \brief Metadata of component \p idx, in [0, numComponents()).
+   */
+  const ConnComp& component(size_t idx) const { return m_components[idx]; }
+
+  const std::vector<ConnComp>& components() const { return m_components; }
+
+  /**
+   * \brief Materializes the image of component \p idx.
+   *
+   * The image is sized to the component's bounding box.
+   */
+  BinaryImage extract(size_t idx) const;
+
+  /**
+   * \brief Same as extract(), but with the left coordinate word-aligned.
+   *
+   * The image may have some white padding on the left, to make
+   * its left coordinate word-aligned, which makes it faster to
+   * draw back to its position.
+   * \param rect If specified, the position and size of the
+   *        aligned image, including padding, will be written into it.
+   */
+  BinaryImage extractAligned(size_t idx, QRect* rect = nullptr) const;
+
+ private:
+  BinaryImage extractRect(uint32_t label, const QRect& rect) const;
+
+  ConnectivityMap m_cmap;
+  std::vector<ConnComp> m_components;
+};
+}  // namespace imageproc
+#endif  // ifndef IMAGEPROC_CONNCOMPEXTRACTOR_H_
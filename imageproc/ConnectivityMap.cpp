@@ -19,17 +19,22 @@
 #include "ConnectivityMap.h"
 #include <QDebug>
 #include <QImage>
+#include <cstring>
+#include <type_traits>
 #include "BinaryImage.h"
 #include "BitOps.h"
 #include "InfluenceMap.h"
+#include "ParallelFor.h"
 
 namespace imageproc {
 const uint32_t ConnectivityMap::BACKGROUND = ~uint32_t(0);
 const uint32_t ConnectivityMap::UNTAGGED_FG = BACKGROUND - 1;
 
-ConnectivityMap::ConnectivityMap() : m_plainData(nullptr), m_size(), m_stride(0), m_maxLabel(0) {}
+ConnectivityMap::ConnectivityMap()
+    : m_plainData(nullptr), m_plainData16(nullptr), m_size(), m_stride(0), m_maxLabel(0) {}
 
-ConnectivityMap::ConnectivityMap(const QSize& size) : m_plainData(nullptr), m_size(size), m_stride(0), m_maxLabel(0) {
+ConnectivityMap::ConnectivityMap(const QSize& size)
+    : m_plainData(nullptr), m_plainData16(nullptr), m_size(size), m_stride(0), m_maxLabel(0) {
   if (m_size.isEmpty()) {
     return;
   }
@@ -42,8 +47,8 @@ ConnectivityMap::ConnectivityMap(const QSize& size) : m_plainData(nullptr), m_si
   m_plainData = &m_data[0] + 1 + m_stride;
 }
 
-ConnectivityMap::ConnectivityMap(const BinaryImage& image, const Connectivity conn)
-    : m_plainData(nullptr), m_size(image.size()), m_stride(0), m_maxLabel(0) {
+ConnectivityMap::ConnectivityMap(const BinaryImage& image, const Connectivity conn, const LabelingMethod method)
+    : m_plainData(nullptr), m_plainData16(nullptr), m_size(image.size()), m_stride(0), m_maxLabel(0) {
   if (m_size.isEmpty()) {
     return;
   }
@@ -72,22 +77,35 @@ ConnectivityMap::ConnectivityMap(const BinaryImage& image, const Connectivity co
     dst += dst_stride;
   }
 
-  assignIds(conn);
+  if (method == LABEL_UNION_FIND) {
+    assignIdsUnionFind(conn);
+  } else {
+    assignIds(conn);
+  }
 }
 
 ConnectivityMap::ConnectivityMap(const ConnectivityMap& other)
     : m_data(other.m_data),
+      m_data16(other.m_data16),
       m_plainData(nullptr),
+      m_plainData16(nullptr),
       m_size(other.size()),
       m_stride(other.stride()),
       m_maxLabel(other.m_maxLabel) {
-  if (!m_size.isEmpty()) {
+  if (!m_data.empty()) {
     m_plainData = &m_data[0] + m_stride + 1;
   }
+  if (!m_data16.empty()) {
+    m_plainData16 = &m_data16[0] + m_stride + 1;
+  }
 }
 
 ConnectivityMap::ConnectivityMap(const InfluenceMap& imap)
-    : m_plainData(nullptr), m_size(imap.size()), m_stride(imap.stride()), m_maxLabel(imap.maxLabel()) {
+    : m_plainData(nullptr),
+      m_plainData16(nullptr),
+      m_size(imap.size()),
+      m_stride(imap.stride()),
+      m_maxLabel(imap.maxLabel()) {
   if (m_size.isEmpty()) {
     return;
   }
@@ -105,6 +123,7 @@ ConnectivityMap& ConnectivityMap::operator=(const ConnectivityMap& other) {
 ConnectivityMap& ConnectivityMap::operator=(const InfluenceMap& imap) {
   if ((m_size == imap.size()) && !m_size.isEmpty()) {
     // Common case optimization.
+    expand();
     copyFromInfluenceMap(imap);
   } else {
     ConnectivityMap(imap).swap(*this);
@@ -115,7 +134,9 @@ ConnectivityMap& ConnectivityMap::operator=(const InfluenceMap& imap) {
 
 void ConnectivityMap::swap(ConnectivityMap& other) {
   m_data.swap(other.m_data);
+  m_data16.swap(other.m_data16);
   std::swap(m_plainData, other.m_plainData);
+  std::swap(m_plainData16, other.m_plainData16);
   std::swap(m_size, other.m_size);
   std::swap(m_stride, other.m_stride);
   std::swap(m_maxLabel, other.m_maxLabel);
@@ -129,6 +150,8 @@ void ConnectivityMap::addComponent(const BinaryImage& image) {
     return;
   }
 
+  expand();
+
   const int width = m_size.width();
   const int height = m_size.height();
 
@@ -172,30 +195,37 @@ void ConnectivityMap::addComponents(const ConnectivityMap& other) {
     return;
   }
 
+  expand();
+
   const int width = m_size.width();
   const int height = m_size.height();
 
   uint32_t* dst_line = m_plainData;
   const int dst_stride = m_stride;
 
-  const uint32_t* src_line = other.m_plainData;
-  const int src_stride = other.m_stride;
-
   uint32_t new_max_label = m_maxLabel;
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      const uint32_t src_label = src_line[x];
-      if (src_label == 0) {
-        continue;
+  const auto add_from = [&](const auto* src_line, const int src_stride) {
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        const uint32_t src_label = src_line[x];
+        if (src_label == 0) {
+          continue;
+        }
+
+        const uint32_t dst_label = m_maxLabel + src_label;
+        new_max_label = std::max(new_max_label, dst_label);
+
+        dst_line[x] = dst_label;
       }
-
-      const uint32_t dst_label = m_maxLabel + src_label;
-      new_max_label = std::max(new_max_label, dst_label);
-
-      dst_line[x] = dst_label;
+      src_line += src_stride;
+      dst_line += dst_stride;
     }
-    src_line += src_stride;
-    dst_line += dst_stride;
+  };
+
+  if (other.m_plainData16) {
+    add_from(other.m_plainData16, other.m_stride);
+  } else {
+    add_from(other.m_plainData, other.m_stride);
   }
 
   m_maxLabel = new_max_label;
@@ -215,15 +245,57 @@ void ConnectivityMap::removeComponents(const std::unordered_set<uint32_t>& label
     }
   }
 
-  for (uint32_t& label : m_data) {
-    if (label != 0) {
-      label = map[label - 1];
+  // Remapping only shrinks labels, so it can be applied to either
+  // storage width in place.
+  const auto remap = [&map](auto& data) {
+    for (auto& label : data) {
+      if (label != 0) {
+        label = static_cast<std::remove_reference_t<decltype(label)>>(map[label - 1]);
+      }
     }
+  };
+
+  if (m_plainData16) {
+    remap(m_data16);
+  } else {
+    remap(m_data);
   }
 
   m_maxLabel = next_label - 1;
 }
 
+void ConnectivityMap::compact() {
+  if (!m_plainData || (m_maxLabel > 0xffff)) {
+    return;
+  }
+
+  const size_t size = m_data.size();
+  m_data16.resize(size);
+  for (size_t i = 0; i < size; ++i) {
+    m_data16[i] = static_cast<uint16_t>(m_data[i]);
+  }
+
+  std::vector<uint32_t>().swap(m_data);
+  m_plainData = nullptr;
+  m_plainData16 = &m_data16[0] + 1 + m_stride;
+}
+
+void ConnectivityMap::expand() {
+  if (!m_plainData16) {
+    return;
+  }
+
+  const size_t size = m_data16.size();
+  m_data.resize(size);
+  for (size_t i = 0; i < size; ++i) {
+    m_data[i] = m_data16[i];
+  }
+
+  std::vector<uint16_t>().swap(m_data16);
+  m_plainData16 = nullptr;
+  m_plainData = &m_data[0] + 1 + m_stride;
+}
+
 BinaryImage ConnectivityMap::getBinaryMask() const {
   if (m_size.isEmpty()) {
     return BinaryImage();
@@ -237,18 +309,25 @@ BinaryImage ConnectivityMap::getBinaryMask() const {
   uint32_t* dst_line = dst.data();
   const int dst_stride = dst.wordsPerLine();
 
-  const uint32_t* src_line = m_plainData;
   const int src_stride = m_stride;
 
   const uint32_t msb = uint32_t(1) << 31;
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      if (src_line[x] != 0) {
-        dst_line[x >> 5] |= (msb >> (x & 31));
+  const auto build_mask = [&](const auto* src_line) {
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        if (src_line[x] != 0) {
+          dst_line[x >> 5] |= (msb >> (x & 31));
+        }
       }
+      src_line += src_stride;
+      dst_line += dst_stride;
     }
-    src_line += src_stride;
-    dst_line += dst_stride;
+  };
+
+  if (m_plainData16) {
+    build_mask(m_plainData16);
+  } else {
+    build_mask(m_plainData);
   }
 
   return dst;
@@ -270,33 +349,40 @@ QImage ConnectivityMap::visualized(QColor bg_color) const {
   QImage dst(m_size, QImage::Format_ARGB32);
   dst.fill(bg_color.rgba());
 
-  const uint32_t* src_line = m_plainData;
   const int src_stride = m_stride;
 
   auto* dst_line = reinterpret_cast<uint32_t*>(dst.bits());
   const int dst_stride = dst.bytesPerLine() / sizeof(uint32_t);
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      const uint32_t val = src_line[x];
-      if (val == 0) {
-        continue;
+  const auto visualize = [&](const auto* src_line) {
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        const uint32_t val = src_line[x];
+        if (val == 0) {
+          continue;
+        }
+
+        const int bits_unused = countMostSignificantZeroes(val);
+        const uint32_t reversed = reverseBits(val) >> bits_unused;
+        const uint32_t mask = ~uint32_t(0) >> bits_unused;
+
+        const double H = 0.99 * (double(reversed) / mask);
+        const double S = 1.0;
+        const double V = 1.0;
+        QColor color;
+        color.setHsvF(H, S, V, 1.0);
+
+        dst_line[x] = color.rgba();
       }
-
-      const int bits_unused = countMostSignificantZeroes(val);
-      const uint32_t reversed = reverseBits(val) >> bits_unused;
-      const uint32_t mask = ~uint32_t(0) >> bits_unused;
-
-      const double H = 0.99 * (double(reversed) / mask);
-      const double S = 1.0;
-      const double V = 1.0;
-      QColor color;
-      color.setHsvF(H, S, V, 1.0);
-
-      dst_line[x] = color.rgba();
+      src_line += src_stride;
+      dst_line += dst_stride;
     }
-    src_line += src_stride;
-    dst_line += dst_stride;
+  };
+
+  if (m_plainData16) {
+    visualize(m_plainData16);
+  } else {
+    visualize(m_plainData);
   }
 
   return dst;
@@ -346,6 +432,165 @@ void ConnectivityMap::assignIds(const Connectivity conn) {
   m_maxLabel = next_label - 1;
 }
 
+void ConnectivityMap::assignIdsUnionFind(const Connectivity conn) {
+  const int width = m_size.width();
+  const int height = m_size.height();
+  const int stride = m_stride;
+
+  struct Run {
+    int begin;  // inclusive
+    int end;    // exclusive
+  };
+
+  // Phase 1: count runs of consecutive foreground pixels in each row.
+  std::vector<int> row_offsets(height + 1, 0);
+  parallelForChunked(0, height, [&](const int y_begin, const int y_end) {
+    const uint32_t* line = m_plainData + y_begin * stride;
+    for (int y = y_begin; y < y_end; ++y, line += stride) {
+      int num_runs = 0;
+      for (int x = 0; x < width;) {
+        if (line[x] != BACKGROUND) {
+          ++num_runs;
+          do {
+            ++x;
+          } while (x < width && line[x] != BACKGROUND);
+        } else {
+          ++x;
+        }
+      }
+      row_offsets[y + 1] = num_runs;
+    }
+  });
+  for (int y = 0; y < height; ++y) {
+    row_offsets[y + 1] += row_offsets[y];
+  }
+  const auto total_runs = uint32_t(row_offsets[height]);
+
+  // Phase 2: record the runs.  Provisional labels are run indices
+  // in raster order, which keeps the label array flat and compact.
+  std::vector<Run> runs(total_runs);
+  parallelForChunked(0, height, [&](const int y_begin, const int y_end) {
+    const uint32_t* line = m_plainData + y_begin * stride;
+    for (int y = y_begin; y < y_end; ++y, line += stride) {
+      int run_idx = row_offsets[y];
+      for (int x = 0; x < width;) {
+        if (line[x] != BACKGROUND) {
+          const int begin = x;
+          do {
+            ++x;
+          } while (x < width && line[x] != BACKGROUND);
+          runs[run_idx].begin = begin;
+          runs[run_idx].end = x;
+          ++run_idx;
+        } else {
+          ++x;
+        }
+      }
+    }
+  });
+
+  std::vector<uint32_t> parent(total_runs);
+  for (uint32_t i = 0; i < total_runs; ++i) {
+    parent[i] = i;
+  }
+
+  const auto find = [&parent](uint32_t i) {
+    while (parent[i] != i) {
+      parent[i] = parent[parent[i]];  // path compression
+      i = parent[i];
+    }
+
+    return i;
+  };
+  const auto unite = [&parent, &find](uint32_t a, uint32_t b) {
+    a = find(a);
+    b = find(b);
+    if (a != b) {
+      // Linking to the smaller root keeps the earliest run
+      // in raster order as the component representative.
+      if (a < b) {
+        parent[b] = a;
+      } else {
+        parent[a] = b;
+      }
+    }
+  };
+
+  // Horizontal overlap extended by 1 pixel for 8-connectivity.
+  const int ext = (conn == CONN8) ? 1 : 0;
+  const auto merge_rows = [&](const int y) {
+    int ai = row_offsets[y - 1];
+    const int a_end = row_offsets[y];
+    int bi = row_offsets[y];
+    const int b_end = row_offsets[y + 1];
+    while (ai < a_end && bi < b_end) {
+      const Run& a = runs[ai];
+      const Run& b = runs[bi];
+      if ((a.begin < b.end + ext) && (b.begin < a.end + ext)) {
+        unite(ai, bi);
+      }
+      if (a.end <= b.end) {
+        ++ai;
+      } else {
+        ++bi;
+      }
+    }
+  };
+
+  // Phase 3: merge vertically adjacent runs.  Row strips are merged
+  // in parallel; the rows on strip boundaries are merged sequentially
+  // afterwards, so concurrent unions never touch the same strips.
+  const int num_strips = parallelForNumThreads();
+  const int strip_h = (height + num_strips - 1) / num_strips;
+  parallelForChunked(0, num_strips, [&](const int t_begin, const int t_end) {
+    for (int t = t_begin; t < t_end; ++t) {
+      const int strip_end = std::min(height, (t + 1) * strip_h);
+      for (int y = t * strip_h + 1; y < strip_end; ++y) {
+        merge_rows(y);
+      }
+    }
+  });
+  for (int t = 1; t < num_strips; ++t) {
+    const int y = t * strip_h;
+    if (y < height) {
+      merge_rows(y);
+    }
+  }
+
+  // Phase 4: flatten the forest, then assign consecutive final labels
+  // to component roots.  After flattening parent[] is read-only, so
+  // the write phase below can run multithreaded.
+  std::vector<uint32_t> compact(total_runs, 0);
+  uint32_t next_label = 0;
+  for (uint32_t i = 0; i < total_runs; ++i) {
+    parent[i] = find(i);
+    if (parent[i] == i) {
+      compact[i] = ++next_label;
+    }
+  }
+
+  // Phase 5: write the final labels, zeroing background and padding.
+  parallelForChunked(0, height, [&](const int y_begin, const int y_end) {
+    for (int y = y_begin; y < y_end; ++y) {
+      uint32_t* const padded_line = &m_data[(y + 1) * stride];
+      memset(padded_line, 0, stride * sizeof(uint32_t));
+
+      uint32_t* const line = padded_line + 1;
+      for (int run_idx = row_offsets[y]; run_idx < row_offsets[y + 1]; ++run_idx) {
+        const Run& run = runs[run_idx];
+        const uint32_t label = compact[parent[run_idx]];
+        for (int x = run.begin; x < run.end; ++x) {
+          line[x] = label;
+        }
+      }
+    }
+  });
+  memset(&m_data[0], 0, stride * sizeof(uint32_t));
+  memset(&m_data[(height + 1) * stride], 0, stride * sizeof(uint32_t));
+
+  m_maxLabel = next_label;
+}  // ConnectivityMap::assignIdsUnionFind
+
 /**
  * Tags every object pixel that has a non-object pixel to the left.
  */
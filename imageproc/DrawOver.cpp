@@ -20,6 +20,7 @@
 #include <QImage>
 #include <cassert>
 #include "BinaryImage.h"
+#include "OpCounters.h"
 #include "RasterOp.h"
 
 namespace imageproc {
@@ -49,7 +50,11 @@ void drawOver(QImage& dst, const QRect& dst_rect, const QImage& src, const QRect
   if (depth % 8 != 0) {
     assert(depth == 1);
 
-    // Slow but simple.
+    // Slow but simple.  The counter surfaces how often callers end up
+    // here; a non-trivial count means some path feeds us Format_Mono
+    // images that should be converted once upfront.
+    OpCounters::add(OpCounters::DRAW_OVER_SLOW_CALLS, 1);
+
     BinaryImage dst_bin(dst);
     BinaryImage src_bin(src);
     rasterOp<RopSrc>(dst_bin, dst_rect, src_bin, src_rect.topLeft());
@@ -63,6 +68,15 @@ void drawOver(QImage& dst, const QRect& dst_rect, const QImage& src, const QRect
   dst_line += dst_bpl * dst_rect.top() + dst_rect.left() * depth / 8;
   src_line += src_bpl * src_rect.top() + src_rect.left() * depth / 8;
 
+  if ((stripe_bytes == dst_bpl) && (stripe_bytes == src_bpl)) {
+    // Full-width rows with matching strides are contiguous in both
+    // images, so the whole region goes in one bulk copy.
+    OpCounters::add(OpCounters::DRAW_OVER_BULK_COPIES, 1);
+    memcpy(dst_line, src_line, size_t(stripe_bytes) * src_rect.height());
+
+    return;
+  }
+
   for (int i = src_rect.height(); i > 0; --i) {
     memcpy(dst_line, src_line, stripe_bytes);
     dst_line += dst_bpl;
@@ -22,7 +22,10 @@
 #include "GaussBlur.h"
 #include <boost/lambda/bind.hpp>
 #include <boost/lambda/lambda.hpp>
+#include <boost/scoped_array.hpp>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include "Constants.h"
 #include "GrayImage.h"
 
@@ -90,6 +93,176 @@ void find_iir_constants(float* n_p, float* n_m, float* d_p, float* d_m, float* b
 }  // find_iir_constants
 }  // namespace gauss_blur_impl
 
+namespace {
+/**
+ * Fixed-point formats used by the 8-bit path.  The recursions run with
+ * 16.16 accumulators and 8.24 coefficients, while the intermediate
+ * image stores 10.6 samples - half the footprint of the float path's
+ * intermediate buffer, with a quantization step of 1/64 of a gray
+ * level, far below what's visible in an 8-bit result.  Coefficients
+ * get the extra fractional bits because at larger sigmas the feedback
+ * terms nearly cancel, which magnifies their quantization error.
+ */
+const int kCoefFracBits = 24;
+const int kAccumFracBits = 16;
+const int kInterFracBits = 6;
+
+struct FixedIirConstants {
+  int32_t n_p[5];
+  int32_t n_m[5];
+  int32_t d_p[5];
+  int32_t d_m[5];
+  int32_t bd_p[5];
+  int32_t bd_m[5];
+};
+
+int32_t toFixedCoef(const float val) {
+  return static_cast<int32_t>(std::lround(double(val) * (1 << kCoefFracBits)));
+}
+
+FixedIirConstants fixedIirConstants(const float std_dev) {
+  float n_p[5], n_m[5], d_p[5], d_m[5], bd_p[5], bd_m[5];
+  gauss_blur_impl::find_iir_constants(n_p, n_m, d_p, d_m, bd_p, bd_m, std_dev);
+
+  FixedIirConstants c;
+  for (int i = 0; i < 5; ++i) {
+    c.n_p[i] = toFixedCoef(n_p[i]);
+    c.n_m[i] = toFixedCoef(n_m[i]);
+    c.d_p[i] = toFixedCoef(d_p[i]);
+    c.d_m[i] = toFixedCoef(d_m[i]);
+    c.bd_p[i] = toFixedCoef(bd_p[i]);
+    c.bd_m[i] = toFixedCoef(bd_m[i]);
+  }
+
+  return c;
+}
+
+inline int32_t fixedMul(const int32_t coef, const int32_t val) {
+  return static_cast<int32_t>((int64_t(coef) * val + (int64_t(1) << (kCoefFracBits - 1))) >> kCoefFracBits);
+}
+
+/**
+ * Sigmas this far from the extremes keep the fixed-point
+ * representation honest: below ~0.5 the coefficient magnitudes blow
+ * up, and well above 24 the near-cancellation of the feedback terms
+ * starts to show through even the 8.24 coefficients.  Measured against
+ * the float path, the result stays within one gray level across this
+ * whole range.
+ */
+bool sigmaFitsFixedPoint(const float sigma) {
+  return (sigma >= 0.5f) && (sigma <= 24.0f);
+}
+
+GrayImage gaussBlurGrayFixed(const GrayImage& src, const float h_sigma, const float v_sigma) {
+  const int width = src.size().width();
+  const int height = src.size().height();
+
+  GrayImage dst(src.size());
+
+  boost::scoped_array<int16_t> intermediate_image(new int16_t[width * height]);
+  const int intermediate_stride = width;
+
+  const uint8_t* const input = src.data();
+  const int input_stride = src.stride();
+
+  const int inter_shift = kAccumFracBits - kInterFracBits;
+
+  // Vertical pass.  Same strip decomposition as gaussBlurGeneric().
+  const FixedIirConstants vc(fixedIirConstants(v_sigma));
+  parallelForChunked(0, width, [&](const int x_begin, const int x_end) {
+    boost::scoped_array<int32_t> val_p(new int32_t[height]);
+    boost::scoped_array<int32_t> val_m(new int32_t[height]);
+
+    for (int x = x_begin; x < x_end; ++x) {
+      memset(&val_p[0], 0, height * sizeof(val_p[0]));
+      memset(&val_m[0], 0, height * sizeof(val_m[0]));
+
+      const uint8_t* sp_p = input + x;
+      const uint8_t* sp_m = sp_p + (height - 1) * input_stride;
+      int32_t* vp = &val_p[0];
+      int32_t* vm = &val_m[0] + height - 1;
+      const int32_t initial_p = int32_t(sp_p[0]) << kAccumFracBits;
+      const int32_t initial_m = int32_t(sp_m[0]) << kAccumFracBits;
+
+      for (int y = 0; y < height; ++y) {
+        const int terms = y < 4 ? y : 4;
+        int i = 0;
+        int sp_off = 0;
+        for (; i <= terms; ++i, sp_off += input_stride) {
+          *vp += fixedMul(vc.n_p[i], int32_t(sp_p[-sp_off]) << kAccumFracBits) - fixedMul(vc.d_p[i], vp[-i]);
+          *vm += fixedMul(vc.n_m[i], int32_t(sp_m[sp_off]) << kAccumFracBits) - fixedMul(vc.d_m[i], vm[i]);
+        }
+        for (; i <= 4; ++i) {
+          *vp += fixedMul(vc.n_p[i] - vc.bd_p[i], initial_p);
+          *vm += fixedMul(vc.n_m[i] - vc.bd_m[i], initial_m);
+        }
+        sp_p += input_stride;
+        sp_m -= input_stride;
+        ++vp;
+        --vm;
+      }
+
+      int16_t* inter_col = &intermediate_image[0] + x;
+      const int32_t half = int32_t(1) << (inter_shift - 1);
+      for (int y = 0; y < height; ++y, inter_col += intermediate_stride) {
+        *inter_col = static_cast<int16_t>((val_p[y] + val_m[y] + half) >> inter_shift);
+      }
+    }
+  });
+  // Horizontal pass.
+  const FixedIirConstants hc(fixedIirConstants(h_sigma));
+  uint8_t* const output = dst.data();
+  const int output_stride = dst.stride();
+  parallelForChunked(0, height, [&](const int y_begin, const int y_end) {
+    boost::scoped_array<int32_t> val_p(new int32_t[width]);
+    boost::scoped_array<int32_t> val_m(new int32_t[width]);
+
+    const int16_t* intermediate_line = &intermediate_image[0] + y_begin * intermediate_stride;
+    uint8_t* output_line = output + y_begin * output_stride;
+
+    for (int y = y_begin; y < y_end; ++y) {
+      memset(&val_p[0], 0, width * sizeof(val_p[0]));
+      memset(&val_m[0], 0, width * sizeof(val_m[0]));
+
+      const int16_t* sp_p = intermediate_line;
+      const int16_t* sp_m = intermediate_line + width - 1;
+      int32_t* vp = &val_p[0];
+      int32_t* vm = &val_m[0] + width - 1;
+      const int32_t initial_p = int32_t(sp_p[0]) << inter_shift;
+      const int32_t initial_m = int32_t(sp_m[0]) << inter_shift;
+
+      for (int x = 0; x < width; ++x) {
+        const int terms = x < 4 ? x : 4;
+        int i = 0;
+        for (; i <= terms; ++i) {
+          *vp += fixedMul(hc.n_p[i], int32_t(sp_p[-i]) << inter_shift) - fixedMul(hc.d_p[i], vp[-i]);
+          *vm += fixedMul(hc.n_m[i], int32_t(sp_m[i]) << inter_shift) - fixedMul(hc.d_m[i], vm[i]);
+        }
+        for (; i <= 4; ++i) {
+          *vp += fixedMul(hc.n_p[i] - hc.bd_p[i], initial_p);
+          *vm += fixedMul(hc.n_m[i] - hc.bd_m[i], initial_m);
+        }
+        ++sp_p;
+        --sp_m;
+        ++vp;
+        --vm;
+      }
+
+      const int32_t half = int32_t(1) << (kAccumFracBits - 1);
+      for (int x = 0; x < width; ++x) {
+        const int32_t val = (val_p[x] + val_m[x] + half) >> kAccumFracBits;
+        output_line[x] = static_cast<uint8_t>(val < 0 ? 0 : (val > 255 ? 255 : val));
+      }
+
+      intermediate_line += intermediate_stride;
+      output_line += output_stride;
+    }
+  });
+
+  return dst;
+}  // gaussBlurGrayFixed
+}  // namespace
+
 GrayImage gaussBlur(const GrayImage& src, float h_sigma, float v_sigma) {
   using namespace boost::lambda;
 
@@ -97,10 +270,14 @@ GrayImage gaussBlur(const GrayImage& src, float h_sigma, float v_sigma) {
     return src;
   }
 
+  if (sigmaFitsFixedPoint(h_sigma) && sigmaFitsFixedPoint(v_sigma)) {
+    return gaussBlurGrayFixed(src, h_sigma, v_sigma);
+  }
+
   GrayImage dst(src.size());
   gaussBlurGeneric(src.size(), h_sigma, v_sigma, src.data(), src.stride(), StaticCastValueConv<float>(), dst.data(),
                    dst.stride(), _1 = bind<uint8_t>(RoundAndClipValueConv<uint8_t>(), _2));
 
   return dst;
 }
-}  // namespace imageproc
\ No newline at end of file
+}  // namespace imageproc
@@ -26,6 +26,7 @@
 #include <boost/scoped_array.hpp>
 #include <cstring>
 #include <iterator>
+#include "ParallelFor.h"
 #include "ValueConv.h"
 
 namespace imageproc {
@@ -38,6 +39,11 @@ class GrayImage;
  * \param h_sigma The standard deviation in horizontal direction.
  * \param v_sigma The standard deviation in vertical direction.
  * \return The blurred image.
+ *
+ * For the sigma range typical of 8-bit work the filter runs in 16.16
+ * fixed point with a 16-bit intermediate buffer, which halves the
+ * scratch memory next to the float path and keeps the result within
+ * a gray level of it.  Extreme sigmas fall back to the float path.
  */
 GrayImage gaussBlur(const GrayImage& src, float h_sigma, float v_sigma);
 
@@ -129,86 +135,97 @@ void gaussBlurGeneric(const QSize size,
 
   const int width = size.width();
   const int height = size.height();
-  const int width_height_max = width > height ? width : height;
 
-  boost::scoped_array<float> val_p(new float[width_height_max]);
-  boost::scoped_array<float> val_m(new float[width_height_max]);
   boost::scoped_array<float> intermediate_image(new float[width * height]);
   const int intermediate_stride = width;
 
   // IIR parameters.
   float n_p[5], n_m[5], d_p[5], d_m[5], bd_p[5], bd_m[5];
-  // Vertical pass.
+  // Vertical pass.  Columns are independent, so contiguous strips of
+  // them go to separate threads, each with its own scratch buffers.
+  // A strip's working set (two float columns plus the input strip)
+  // stays cache-resident while the strip is processed.
   gauss_blur_impl::find_iir_constants(n_p, n_m, d_p, d_m, bd_p, bd_m, v_sigma);
-  for (int x = 0; x < width; ++x) {
-    memset(&val_p[0], 0, height * sizeof(val_p[0]));
-    memset(&val_m[0], 0, height * sizeof(val_m[0]));
-
-    SrcIt sp_p(input + x);
-    SrcIt sp_m(sp_p + (height - 1) * input_stride);
-    float* vp = &val_p[0];
-    float* vm = &val_m[0] + height - 1;
-    const float initial_p = float_reader(sp_p[0]);
-    const float initial_m = float_reader(sp_m[0]);
-
-    for (int y = 0; y < height; ++y) {
-      const int terms = y < 4 ? y : 4;
-      int i = 0;
-      int sp_off = 0;
-      for (; i <= terms; ++i, sp_off += input_stride) {
-        *vp += n_p[i] * float_reader(sp_p[-sp_off]) - d_p[i] * vp[-i];
-        *vm += n_m[i] * float_reader(sp_m[sp_off]) - d_m[i] * vm[i];
-      }
-      for (; i <= 4; ++i) {
-        *vp += (n_p[i] - bd_p[i]) * initial_p;
-        *vm += (n_m[i] - bd_m[i]) * initial_m;
+  parallelForChunked(0, width, [&](const int x_begin, const int x_end) {
+    boost::scoped_array<float> val_p(new float[height]);
+    boost::scoped_array<float> val_m(new float[height]);
+
+    for (int x = x_begin; x < x_end; ++x) {
+      memset(&val_p[0], 0, height * sizeof(val_p[0]));
+      memset(&val_m[0], 0, height * sizeof(val_m[0]));
+
+      SrcIt sp_p(input + x);
+      SrcIt sp_m(sp_p + (height - 1) * input_stride);
+      float* vp = &val_p[0];
+      float* vm = &val_m[0] + height - 1;
+      const float initial_p = float_reader(sp_p[0]);
+      const float initial_m = float_reader(sp_m[0]);
+
+      for (int y = 0; y < height; ++y) {
+        const int terms = y < 4 ? y : 4;
+        int i = 0;
+        int sp_off = 0;
+        for (; i <= terms; ++i, sp_off += input_stride) {
+          *vp += n_p[i] * float_reader(sp_p[-sp_off]) - d_p[i] * vp[-i];
+          *vm += n_m[i] * float_reader(sp_m[sp_off]) - d_m[i] * vm[i];
+        }
+        for (; i <= 4; ++i) {
+          *vp += (n_p[i] - bd_p[i]) * initial_p;
+          *vm += (n_m[i] - bd_m[i]) * initial_m;
+        }
+        sp_p += input_stride;
+        sp_m -= input_stride;
+        ++vp;
+        --vm;
       }
-      sp_p += input_stride;
-      sp_m -= input_stride;
-      ++vp;
-      --vm;
-    }
 
-    gauss_blur_impl::save(height, &val_p[0], &val_m[0], &intermediate_image[0] + x, intermediate_stride,
-                          gauss_blur_impl::FloatToFloatWriter());
-  }
-  // Horizontal pass.
+      gauss_blur_impl::save(height, &val_p[0], &val_m[0], &intermediate_image[0] + x, intermediate_stride,
+                            gauss_blur_impl::FloatToFloatWriter());
+    }
+  });
+  // Horizontal pass.  Rows are independent as well.
   gauss_blur_impl::find_iir_constants(n_p, n_m, d_p, d_m, bd_p, bd_m, h_sigma);
-  const float* intermediate_line = &intermediate_image[0];
-  DstIt output_line(output);
-  for (int y = 0; y < height; ++y) {
-    memset(&val_p[0], 0, width * sizeof(val_p[0]));
-    memset(&val_m[0], 0, width * sizeof(val_m[0]));
-
-    const float* sp_p = intermediate_line;
-    const float* sp_m = intermediate_line + width - 1;
-    float* vp = &val_p[0];
-    float* vm = &val_m[0] + width - 1;
-    const float initial_p = sp_p[0];
-    const float initial_m = sp_m[0];
-
-    for (int x = 0; x < width; ++x) {
-      const int terms = x < 4 ? x : 4;
-      int i = 0;
-      for (; i <= terms; ++i) {
-        *vp += n_p[i] * sp_p[-i] - d_p[i] * vp[-i];
-        *vm += n_m[i] * sp_m[i] - d_m[i] * vm[i];
+  parallelForChunked(0, height, [&](const int y_begin, const int y_end) {
+    boost::scoped_array<float> val_p(new float[width]);
+    boost::scoped_array<float> val_m(new float[width]);
+
+    const float* intermediate_line = &intermediate_image[0] + y_begin * intermediate_stride;
+    DstIt output_line(output + y_begin * output_stride);
+
+    for (int y = y_begin; y < y_end; ++y) {
+      memset(&val_p[0], 0, width * sizeof(val_p[0]));
+      memset(&val_m[0], 0, width * sizeof(val_m[0]));
+
+      const float* sp_p = intermediate_line;
+      const float* sp_m = intermediate_line + width - 1;
+      float* vp = &val_p[0];
+      float* vm = &val_m[0] + width - 1;
+      const float initial_p = sp_p[0];
+      const float initial_m = sp_m[0];
+
+      for (int x = 0; x < width; ++x) {
+        const int terms = x < 4 ? x : 4;
+        int i = 0;
+        for (; i <= terms; ++i) {
+          *vp += n_p[i] * sp_p[-i] - d_p[i] * vp[-i];
+          *vm += n_m[i] * sp_m[i] - d_m[i] * vm[i];
+        }
+        for (; i <= 4; ++i) {
+          *vp += (n_p[i] - bd_p[i]) * initial_p;
+          *vm += (n_m[i] - bd_m[i]) * initial_m;
+        }
+        ++sp_p;
+        --sp_m;
+        ++vp;
+        --vm;
       }
-      for (; i <= 4; ++i) {
-        *vp += (n_p[i] - bd_p[i]) * initial_p;
-        *vm += (n_m[i] - bd_m[i]) * initial_m;
-      }
-      ++sp_p;
-      --sp_m;
-      ++vp;
-      --vm;
-    }
 
-    gauss_blur_impl::save(width, &val_p[0], &val_m[0], output_line, 1, float_writer);
+      gauss_blur_impl::save(width, &val_p[0], &val_m[0], output_line, 1, float_writer);
 
-    intermediate_line += intermediate_stride;
-    output_line += output_stride;
-  }
+      intermediate_line += intermediate_stride;
+      output_line += output_stride;
+    }
+  });
 }  // gaussBlurGeneric
 }  // namespace imageproc
 #endif  // ifndef IMAGEPROC_GAUSSBLUR_H_
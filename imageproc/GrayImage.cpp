@@ -17,19 +17,53 @@
  */
 
 #include "GrayImage.h"
+#include <memory>
+#include <new>
 #include "Grayscale.h"
+#include "MemoryBudgetManager.h"
+#include "RecyclingPool.h"
 
 namespace imageproc {
+namespace {
+/** Travels with the buffer of a GrayImage; see releaseBuffer(). */
+struct BufferInfo {
+  uchar* buffer;
+  size_t bytes;
+};
+
+/** Invoked by QImage when the last copy sharing the buffer is destroyed. */
+void releaseBuffer(void* info) {
+  auto* buffer_info = static_cast<BufferInfo*>(info);
+  RecyclingPool::release(buffer_info->buffer, buffer_info->bytes);
+  MemoryBudgetManager::instance().recordRelease(buffer_info->bytes);
+  delete buffer_info;
+}
+}  // namespace
+
 GrayImage::GrayImage(QSize size) {
   if (size.isEmpty()) {
     return;
   }
 
-  m_image = QImage(size, QImage::Format_Indexed8);
-  m_image.setColorTable(createGrayscalePalette());
+  // Allocating the buffer ourselves rather than leaving it to QImage
+  // serves two purposes: the recycling pool absorbs the frequent
+  // same-shape temporaries, and the budget manager sees both ends of
+  // the buffer's life, however many copies end up sharing it.
+  const size_t stride = (size.width() + 3) & ~size_t(3);  // QImage wants 32-bit aligned scanlines.
+  const size_t bytes = stride * size.height();
+  std::unique_ptr<BufferInfo> info(new BufferInfo);
+  info->buffer = static_cast<uchar*>(RecyclingPool::alloc(bytes));
+  info->bytes = bytes;
+  MemoryBudgetManager::instance().recordAllocation(bytes);
+
+  m_image = QImage(info->buffer, size.width(), size.height(), int(stride), QImage::Format_Indexed8, &releaseBuffer,
+                   info.get());
   if (m_image.isNull()) {
+    releaseBuffer(info.release());
     throw std::bad_alloc();
   }
+  info.release();
+  m_image.setColorTable(createGrayscalePalette());
 }
 
 GrayImage::GrayImage(const QImage& image) : m_image(toGrayscale(image)) {}
@@ -31,6 +31,11 @@ class BinaryImage;
 
 class GrayscaleHistogram {
  public:
+  /**
+   * \brief Constructs an all-zero histogram, to be filled through operator[].
+   */
+  GrayscaleHistogram();
+
   explicit GrayscaleHistogram(const QImage& img);
 
   GrayscaleHistogram(const QImage& img, const BinaryImage& mask);
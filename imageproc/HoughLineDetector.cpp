@@ -26,6 +26,7 @@
 #include "Constants.h"
 #include "Grayscale.h"
 #include "Morphology.h"
+#include "ParallelFor.h"
 #include "RasterOp.h"
 #include "SeedFill.h"
 
@@ -41,7 +42,9 @@ HoughLineDetector::HoughLineDetector(const QSize& input_dimensions,
                                      const double start_angle,
                                      const double angle_delta,
                                      const int num_angles)
-    : m_distanceResolution(distance_resolution), m_recipDistanceResolution(1.0 / distance_resolution) {
+    : m_histogramReady(false),
+      m_distanceResolution(distance_resolution),
+      m_recipDistanceResolution(1.0 / distance_resolution) {
   const int max_x = input_dimensions.width() - 1;
   const int max_y = input_dimensions.height() - 1;
 
@@ -75,25 +78,54 @@ HoughLineDetector::HoughLineDetector(const QSize& input_dimensions,
 
   m_histWidth = max_bin + 1;
   m_histHeight = num_angles;
-  m_histogram.resize(m_histWidth * m_histHeight, 0);
 }
 
 void HoughLineDetector::process(int x, int y, unsigned weight) {
-  unsigned* hist_line = &m_histogram[0];
+  m_pointXs.push_back(float(x));
+  m_pointYs.push_back(float(y));
+  m_pointWeights.push_back(weight);
+  m_histogramReady = false;
+}
 
-  for (const QPointF& uv : m_angleUnitVectors) {
-    const double distance = uv.x() * x + uv.y() * y;
-    const double biased_distance = distance + m_distanceBias;
+void HoughLineDetector::buildHistogram() const {
+  if (m_histogramReady) {
+    return;
+  }
 
-    const auto bin = (int) (biased_distance * m_recipDistanceResolution + 0.5);
-    assert(bin >= 0 && bin < m_histWidth);
-    hist_line[bin] += weight;
+  m_histogram.assign(m_histWidth * m_histHeight, 0);
+
+  const size_t num_points = m_pointXs.size();
+  const float* const xs = m_pointXs.empty() ? nullptr : &m_pointXs[0];
+  const float* const ys = m_pointYs.empty() ? nullptr : &m_pointYs[0];
+  const unsigned* const weights = m_pointWeights.empty() ? nullptr : &m_pointWeights[0];
+
+  // Each thread accumulates into its own band of angle rows, so no
+  // synchronization is needed, and each band stays within a small
+  // window of the accumulator.  The distance computation runs over
+  // flat float arrays that the compiler can vectorize.
+  parallelForChunked(0, m_histHeight, [&](const int band_begin, const int band_end) {
+    for (int angle_idx = band_begin; angle_idx < band_end; ++angle_idx) {
+      const auto unit_x = float(m_angleUnitVectors[angle_idx].x());
+      const auto unit_y = float(m_angleUnitVectors[angle_idx].y());
+      const auto bias = float(m_distanceBias);
+      const auto recip = float(m_recipDistanceResolution);
+      unsigned* const hist_line = &m_histogram[angle_idx * m_histWidth];
+
+      for (size_t i = 0; i < num_points; ++i) {
+        const float biased_distance = unit_x * xs[i] + unit_y * ys[i] + bias;
+        const auto bin = (int) (biased_distance * recip + 0.5f);
+        assert(bin >= 0 && bin < m_histWidth);
+        hist_line[bin] += weights[i];
+      }
+    }
+  });
 
-    hist_line += m_histWidth;
-  }
+  m_histogramReady = true;
 }
 
 QImage HoughLineDetector::visualizeHoughSpace(const unsigned lower_bound) const {
+  buildHistogram();
+
   QImage intensity(m_histWidth, m_histHeight, QImage::Format_Indexed8);
   intensity.setColorTable(createGrayscalePalette());
   if ((m_histWidth > 0) && (m_histHeight > 0) && intensity.isNull()) {
@@ -152,6 +184,8 @@ QImage HoughLineDetector::visualizeHoughSpace(const unsigned lower_bound) const
 }  // HoughLineDetector::visualizeHoughSpace
 
 std::vector<HoughLine> HoughLineDetector::findLines(const unsigned quality_lower_bound) const {
+  buildHistogram();
+
   BinaryImage peaks(findHistogramPeaks(m_histogram, m_histWidth, m_histHeight, quality_lower_bound));
 
   std::vector<HoughLine> lines;
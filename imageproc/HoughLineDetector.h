@@ -99,6 +99,10 @@ class HoughLineDetector {
 
   /**
    * \brief Processes a point with a specified weight.
+   *
+   * The point is only buffered here.  The actual voting happens when
+   * the results are requested, which lets it run over all angles at
+   * once with the accumulator rows split between worker threads.
    */
   void process(int x, int y, unsigned weight = 1);
 
@@ -117,6 +121,12 @@ class HoughLineDetector {
  private:
   class GreaterQualityFirst;
 
+  /**
+   * \brief Casts the votes of all buffered points, unless that has
+   *        already been done since the last process() call.
+   */
+  void buildHistogram() const;
+
   static BinaryImage findHistogramPeaks(const std::vector<unsigned>& hist, int width, int height, unsigned lower_bound);
 
   static BinaryImage findPeakCandidates(const std::vector<unsigned>& hist, int width, int height, unsigned lower_bound);
@@ -139,9 +149,24 @@ class HoughLineDetector {
    * \brief A 2D histogram laid out in raster order.
    *
    * Rows correspond to line angles while columns correspond to
-   * line distances from the origin.
+   * line distances from the origin.  Built lazily by buildHistogram().
+   */
+  mutable std::vector<unsigned> m_histogram;
+
+  /**
+   * Indicates that m_histogram reflects all the buffered points.
+   */
+  mutable bool m_histogramReady;
+
+  /**
+   * The buffered input points, stored as separate coordinate and
+   * weight arrays so that the voting loop vectorizes.
    */
-  std::vector<unsigned> m_histogram;
+  std::vector<float> m_pointXs;
+
+  std::vector<float> m_pointYs;
+
+  std::vector<unsigned> m_pointWeights;
 
   /**
    * \brief An array of sines (y) and cosines(x) of angles we working with.
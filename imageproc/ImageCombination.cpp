@@ -1,88 +1,122 @@
 
 #include "ImageCombination.h"
 #include <QImage>
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 #include "BinaryImage.h"
+#include "ParallelFor.h"
 
 namespace imageproc {
 namespace impl {
+// All the loops below are driven by the 32-bit mask words rather than
+// individual bits: all-zero words are skipped, all-ones words turn
+// into plain fills or copies, and only words on the edges of content
+// take the bit-by-bit path.  Rows are split across threads in strips.
+
 template <typename MixedPixel>
 void combineImagesMono(QImage& mixedImage, const BinaryImage& foreground) {
-  auto* mixed_line = reinterpret_cast<MixedPixel*>(mixedImage.bits());
+  auto* const mixed_data = reinterpret_cast<MixedPixel*>(mixedImage.bits());
   const int mixed_stride = mixedImage.bytesPerLine() / sizeof(MixedPixel);
-  const uint32_t* foreground_line = foreground.data();
+  const uint32_t* const foreground_data = foreground.data();
   const int foreground_stride = foreground.wordsPerLine();
   const int width = mixedImage.width();
   const int height = mixedImage.height();
   const uint32_t msb = uint32_t(1) << 31;
-
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      if (foreground_line[x >> 5] & (msb >> (x & 31))) {
-        uint32_t tmp = foreground_line[x >> 5];
-        tmp >>= (31 - (x & 31));
-        tmp &= uint32_t(1);
-
-        --tmp;
-        tmp |= 0xff000000;
-        mixed_line[x] = static_cast<MixedPixel>(tmp);
+  const auto black = static_cast<MixedPixel>(0xff000000);
+
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      MixedPixel* const mixed_line = mixed_data + y * mixed_stride;
+      const uint32_t* const foreground_line = foreground_data + y * foreground_stride;
+
+      for (int x_word = 0; x_word * 32 < width; ++x_word) {
+        const uint32_t word = foreground_line[x_word];
+        if (word == 0) {
+          continue;
+        }
+
+        const int x_begin = x_word * 32;
+        const int x_end = std::min(x_begin + 32, width);
+        if ((word == ~uint32_t(0)) && (x_end - x_begin == 32)) {
+          std::fill(mixed_line + x_begin, mixed_line + x_end, black);
+        } else {
+          for (int x = x_begin; x < x_end; ++x) {
+            if (word & (msb >> (x & 31))) {
+              mixed_line[x] = black;
+            }
+          }
+        }
       }
     }
-    mixed_line += mixed_stride;
-    foreground_line += foreground_stride;
-  }
+  });
 }
 
 template <typename MixedPixel>
 void combineImagesMono(QImage& mixedImage, const BinaryImage& foreground, const BinaryImage& mask) {
-  auto* mixed_line = reinterpret_cast<MixedPixel*>(mixedImage.bits());
+  auto* const mixed_data = reinterpret_cast<MixedPixel*>(mixedImage.bits());
   const int mixed_stride = mixedImage.bytesPerLine() / sizeof(MixedPixel);
-  const uint32_t* foreground_line = foreground.data();
+  const uint32_t* const foreground_data = foreground.data();
   const int foreground_stride = foreground.wordsPerLine();
-  const uint32_t* mask_line = mask.data();
+  const uint32_t* const mask_data = mask.data();
   const int mask_stride = mask.wordsPerLine();
   const int width = mixedImage.width();
   const int height = mixedImage.height();
   const uint32_t msb = uint32_t(1) << 31;
-
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      if (mask_line[x >> 5] & (msb >> (x & 31))) {
-        uint32_t tmp = foreground_line[x >> 5];
-        tmp >>= (31 - (x & 31));
-        tmp &= uint32_t(1);
-
-        --tmp;
-        tmp |= 0xff000000;
-        mixed_line[x] = static_cast<MixedPixel>(tmp);
+  const auto black = static_cast<MixedPixel>(0xff000000);
+  const auto white = static_cast<MixedPixel>(0xffffffff);
+
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      MixedPixel* const mixed_line = mixed_data + y * mixed_stride;
+      const uint32_t* const foreground_line = foreground_data + y * foreground_stride;
+      const uint32_t* const mask_line = mask_data + y * mask_stride;
+
+      for (int x_word = 0; x_word * 32 < width; ++x_word) {
+        const uint32_t mask_word = mask_line[x_word];
+        if (mask_word == 0) {
+          continue;
+        }
+
+        const uint32_t fg_word = foreground_line[x_word];
+        const int x_begin = x_word * 32;
+        const int x_end = std::min(x_begin + 32, width);
+        if ((mask_word == ~uint32_t(0)) && (x_end - x_begin == 32) && ((fg_word == 0) || (fg_word == ~uint32_t(0)))) {
+          std::fill(mixed_line + x_begin, mixed_line + x_end, (fg_word == 0) ? white : black);
+        } else {
+          for (int x = x_begin; x < x_end; ++x) {
+            if (mask_word & (msb >> (x & 31))) {
+              mixed_line[x] = (fg_word & (msb >> (x & 31))) ? black : white;
+            }
+          }
+        }
       }
     }
-    mixed_line += mixed_stride;
-    foreground_line += foreground_stride;
-    mask_line += mask_stride;
-  }
+  });
 }
 
 template <typename MixedPixel>
 void combineImagesColor(QImage& mixedImage, const QImage& foreground) {
-  auto* mixed_line = reinterpret_cast<MixedPixel*>(mixedImage.bits());
+  auto* const mixed_data = reinterpret_cast<MixedPixel*>(mixedImage.bits());
   const int mixed_stride = mixedImage.bytesPerLine() / sizeof(MixedPixel);
-  const auto* foreground_line = reinterpret_cast<const MixedPixel*>(foreground.bits());
+  const auto* const foreground_data = reinterpret_cast<const MixedPixel*>(foreground.bits());
   const int foreground_stride = foreground.bytesPerLine() / sizeof(MixedPixel);
   const int width = mixedImage.width();
   const int height = mixedImage.height();
   const auto msb = uint32_t(0x00ffffff);
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      if ((foreground_line[x] & msb) != msb) {
-        mixed_line[x] = foreground_line[x];
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      MixedPixel* const mixed_line = mixed_data + y * mixed_stride;
+      const MixedPixel* const foreground_line = foreground_data + y * foreground_stride;
+
+      for (int x = 0; x < width; ++x) {
+        if ((foreground_line[x] & msb) != msb) {
+          mixed_line[x] = foreground_line[x];
+        }
       }
     }
-    mixed_line += mixed_stride;
-    foreground_line += foreground_stride;
-  }
+  });
 }
 
 template <typename MixedPixel, typename ForegroundPixel>
@@ -90,9 +124,9 @@ void combineImagesColor(QImage& mixedImage, const QImage& foreground);
 
 template <>
 void combineImagesColor<uint32_t, uint8_t>(QImage& mixedImage, const QImage& foreground) {
-  auto* mixed_line = reinterpret_cast<uint32_t*>(mixedImage.bits());
+  auto* const mixed_data = reinterpret_cast<uint32_t*>(mixedImage.bits());
   const int mixed_stride = mixedImage.bytesPerLine() / sizeof(uint32_t);
-  const auto* foreground_line = foreground.bits();
+  const uint8_t* const foreground_data = foreground.bits();
   const int foreground_stride = foreground.bytesPerLine();
   const int width = mixedImage.width();
   const int height = mixedImage.height();
@@ -100,16 +134,19 @@ void combineImagesColor<uint32_t, uint8_t>(QImage& mixedImage, const QImage& for
 
   const QVector<QRgb> foreground_palette = foreground.colorTable();
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      uint32_t color = foreground_palette[foreground_line[x]];
-      if ((color & msb) != msb) {
-        mixed_line[x] = color;
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      uint32_t* const mixed_line = mixed_data + y * mixed_stride;
+      const uint8_t* const foreground_line = foreground_data + y * foreground_stride;
+
+      for (int x = 0; x < width; ++x) {
+        const uint32_t color = foreground_palette[foreground_line[x]];
+        if ((color & msb) != msb) {
+          mixed_line[x] = color;
+        }
       }
     }
-    mixed_line += mixed_stride;
-    foreground_line += foreground_stride;
-  }
+  });
 }
 
 void mergePalettes(QVector<uint32_t>& mixed_palette, const QVector<uint32_t>& palette) {
@@ -124,9 +161,9 @@ void mergePalettes(QVector<uint32_t>& mixed_palette, const QVector<uint32_t>& pa
 
 template <>
 void combineImagesColor<uint8_t, uint8_t>(QImage& mixedImage, const QImage& foreground) {
-  auto* mixed_line = mixedImage.bits();
+  auto* const mixed_data = mixedImage.bits();
   const int mixed_stride = mixedImage.bytesPerLine();
-  const auto* foreground_line = foreground.bits();
+  const uint8_t* const foreground_data = foreground.bits();
   const int foreground_stride = foreground.bytesPerLine();
   const int width = mixedImage.width();
   const int height = mixedImage.height();
@@ -147,40 +184,61 @@ void combineImagesColor<uint8_t, uint8_t>(QImage& mixedImage, const QImage& fore
     colorToIndex[mixed_palette[i]] = static_cast<uint8_t>(i);
   }
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      uint32_t color = foreground_palette[foreground_line[x]];
-      if ((color & msb) != msb) {
-        mixed_line[x] = colorToIndex[color];
+  // Read-only from here on, so the rows can go to separate threads.
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      uint8_t* const mixed_line = mixed_data + y * mixed_stride;
+      const uint8_t* const foreground_line = foreground_data + y * foreground_stride;
+
+      for (int x = 0; x < width; ++x) {
+        const uint32_t color = foreground_palette[foreground_line[x]];
+        if ((color & msb) != msb) {
+          const auto it = colorToIndex.find(color);
+          mixed_line[x] = (it != colorToIndex.end()) ? it->second : 0;
+        }
       }
     }
-    mixed_line += mixed_stride;
-    foreground_line += foreground_stride;
-  }
+  });
 }
 
 template <typename MixedPixel>
 void combineImagesColor(QImage& mixedImage, const QImage& foreground, const BinaryImage& mask) {
-  auto* mixed_line = reinterpret_cast<MixedPixel*>(mixedImage.bits());
+  auto* const mixed_data = reinterpret_cast<MixedPixel*>(mixedImage.bits());
   const int mixed_stride = mixedImage.bytesPerLine() / sizeof(MixedPixel);
-  const auto* foreground_line = reinterpret_cast<const MixedPixel*>(foreground.bits());
+  const auto* const foreground_data = reinterpret_cast<const MixedPixel*>(foreground.bits());
   const int foreground_stride = foreground.bytesPerLine() / sizeof(MixedPixel);
-  const uint32_t* mask_line = mask.data();
+  const uint32_t* const mask_data = mask.data();
   const int mask_stride = mask.wordsPerLine();
   const int width = mixedImage.width();
   const int height = mixedImage.height();
   const uint32_t msb = uint32_t(1) << 31;
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      if (mask_line[x >> 5] & (msb >> (x & 31))) {
-        mixed_line[x] = foreground_line[x];
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      MixedPixel* const mixed_line = mixed_data + y * mixed_stride;
+      const MixedPixel* const foreground_line = foreground_data + y * foreground_stride;
+      const uint32_t* const mask_line = mask_data + y * mask_stride;
+
+      for (int x_word = 0; x_word * 32 < width; ++x_word) {
+        const uint32_t mask_word = mask_line[x_word];
+        if (mask_word == 0) {
+          continue;
+        }
+
+        const int x_begin = x_word * 32;
+        const int x_end = std::min(x_begin + 32, width);
+        if ((mask_word == ~uint32_t(0)) && (x_end - x_begin == 32)) {
+          std::copy(foreground_line + x_begin, foreground_line + x_end, mixed_line + x_begin);
+        } else {
+          for (int x = x_begin; x < x_end; ++x) {
+            if (mask_word & (msb >> (x & 31))) {
+              mixed_line[x] = foreground_line[x];
+            }
+          }
+        }
       }
     }
-    mixed_line += mixed_stride;
-    foreground_line += foreground_stride;
-    mask_line += mask_stride;
-  }
+  });
 }
 
 template <typename MixedPixel, typename ForegroundPixel>
@@ -188,11 +246,11 @@ void combineImagesColor(QImage& mixedImage, const QImage& foreground, const Bina
 
 template <>
 void combineImagesColor<uint32_t, uint8_t>(QImage& mixedImage, const QImage& foreground, const BinaryImage& mask) {
-  auto* mixed_line = reinterpret_cast<uint32_t*>(mixedImage.bits());
+  auto* const mixed_data = reinterpret_cast<uint32_t*>(mixedImage.bits());
   const int mixed_stride = mixedImage.bytesPerLine() / sizeof(uint32_t);
-  const auto* foreground_line = foreground.bits();
+  const uint8_t* const foreground_data = foreground.bits();
   const int foreground_stride = foreground.bytesPerLine();
-  const uint32_t* mask_line = mask.data();
+  const uint32_t* const mask_data = mask.data();
   const int mask_stride = mask.wordsPerLine();
   const int width = mixedImage.width();
   const int height = mixedImage.height();
@@ -200,26 +258,43 @@ void combineImagesColor<uint32_t, uint8_t>(QImage& mixedImage, const QImage& for
 
   const QVector<QRgb> foreground_palette = foreground.colorTable();
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      if (mask_line[x >> 5] & (msb >> (x & 31))) {
-        uint32_t color = foreground_palette[foreground_line[x]];
-        mixed_line[x] = color;
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      uint32_t* const mixed_line = mixed_data + y * mixed_stride;
+      const uint8_t* const foreground_line = foreground_data + y * foreground_stride;
+      const uint32_t* const mask_line = mask_data + y * mask_stride;
+
+      for (int x_word = 0; x_word * 32 < width; ++x_word) {
+        const uint32_t mask_word = mask_line[x_word];
+        if (mask_word == 0) {
+          continue;
+        }
+
+        const int x_begin = x_word * 32;
+        const int x_end = std::min(x_begin + 32, width);
+        if ((mask_word == ~uint32_t(0)) && (x_end - x_begin == 32)) {
+          for (int x = x_begin; x < x_end; ++x) {
+            mixed_line[x] = foreground_palette[foreground_line[x]];
+          }
+        } else {
+          for (int x = x_begin; x < x_end; ++x) {
+            if (mask_word & (msb >> (x & 31))) {
+              mixed_line[x] = foreground_palette[foreground_line[x]];
+            }
+          }
+        }
       }
     }
-    mixed_line += mixed_stride;
-    foreground_line += foreground_stride;
-    mask_line += mask_stride;
-  }
+  });
 }
 
 template <>
 void combineImagesColor<uint8_t, uint8_t>(QImage& mixedImage, const QImage& foreground, const BinaryImage& mask) {
-  auto* mixed_line = mixedImage.bits();
+  auto* const mixed_data = mixedImage.bits();
   const int mixed_stride = mixedImage.bytesPerLine();
-  const auto* foreground_line = foreground.bits();
+  const uint8_t* const foreground_data = foreground.bits();
   const int foreground_stride = foreground.bytesPerLine();
-  const uint32_t* mask_line = mask.data();
+  const uint32_t* const mask_data = mask.data();
   const int mask_stride = mask.wordsPerLine();
   const int width = mixedImage.width();
   const int height = mixedImage.height();
@@ -240,39 +315,69 @@ void combineImagesColor<uint8_t, uint8_t>(QImage& mixedImage, const QImage& fore
     colorToIndex[mixed_palette[i]] = static_cast<uint8_t>(i);
   }
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      if (mask_line[x >> 5] & (msb >> (x & 31))) {
-        uint32_t color = foreground_palette[foreground_line[x]];
-        mixed_line[x] = colorToIndex[color];
+  // Read-only from here on, so the rows can go to separate threads.
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      uint8_t* const mixed_line = mixed_data + y * mixed_stride;
+      const uint8_t* const foreground_line = foreground_data + y * foreground_stride;
+      const uint32_t* const mask_line = mask_data + y * mask_stride;
+
+      for (int x_word = 0; x_word * 32 < width; ++x_word) {
+        const uint32_t mask_word = mask_line[x_word];
+        if (mask_word == 0) {
+          continue;
+        }
+
+        const int x_begin = x_word * 32;
+        const int x_end = std::min(x_begin + 32, width);
+        for (int x = x_begin; x < x_end; ++x) {
+          if (mask_word & (msb >> (x & 31))) {
+            const uint32_t color = foreground_palette[foreground_line[x]];
+            const auto it = colorToIndex.find(color);
+            mixed_line[x] = (it != colorToIndex.end()) ? it->second : 0;
+          }
+        }
       }
     }
-    mixed_line += mixed_stride;
-    foreground_line += foreground_stride;
-    mask_line += mask_stride;
-  }
+  });
 }
 
 template <typename MixedPixel>
 void applyMask(QImage& image, const BinaryImage& bw_mask, const BWColor filling_color = WHITE) {
-  auto* image_line = reinterpret_cast<MixedPixel*>(image.bits());
+  auto* const image_data = reinterpret_cast<MixedPixel*>(image.bits());
   const int image_stride = image.bytesPerLine() / sizeof(MixedPixel);
-  const uint32_t* bw_mask_line = bw_mask.data();
+  const uint32_t* const bw_mask_data = bw_mask.data();
   const int bw_mask_stride = bw_mask.wordsPerLine();
   const int width = image.width();
   const int height = image.height();
   const uint32_t msb = uint32_t(1) << 31;
   const auto fillingPixel = static_cast<MixedPixel>((filling_color == WHITE) ? 0xffffffff : 0x00000000);
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      if (!(bw_mask_line[x >> 5] & (msb >> (x & 31)))) {
-        image_line[x] = fillingPixel;
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      MixedPixel* const image_line = image_data + y * image_stride;
+      const uint32_t* const bw_mask_line = bw_mask_data + y * bw_mask_stride;
+
+      for (int x_word = 0; x_word * 32 < width; ++x_word) {
+        const uint32_t mask_word = bw_mask_line[x_word];
+        if (mask_word == ~uint32_t(0)) {
+          continue;  // Everything in this word is kept.
+        }
+
+        const int x_begin = x_word * 32;
+        const int x_end = std::min(x_begin + 32, width);
+        if (mask_word == 0) {
+          std::fill(image_line + x_begin, image_line + x_end, fillingPixel);
+        } else {
+          for (int x = x_begin; x < x_end; ++x) {
+            if (!(mask_word & (msb >> (x & 31)))) {
+              image_line[x] = fillingPixel;
+            }
+          }
+        }
       }
     }
-    image_line += image_stride;
-    bw_mask_line += bw_mask_stride;
-  }
+  });
 }
 }  // namespace impl
 
@@ -21,10 +21,119 @@
 #include "BinaryImage.h"
 #include "BitOps.h"
 #include "ConnectivityMap.h"
+#include "ParallelFor.h"
 
 class QImage;
 
 namespace imageproc {
+namespace {
+/**
+ * Relaxes the 8 neighbors of \p cell, propagating its label together
+ * with the squared distance and the vector to the nearest seed.
+ * Every improved neighbor goes through \p push.
+ */
+template <typename PushOp>
+inline void relaxNeighbors(InfluenceMap::Cell* const cell, const int width, PushOp&& push) {
+  typedef InfluenceMap::Cell Cell;
+
+  const int32_t dx2 = cell->vec.x << 1;
+  const int32_t dy2 = cell->vec.y << 1;
+
+  // North-western neighbor.
+  Cell* nbh = cell - width - 1;
+  uint32_t new_dist_sq = cell->distSq + dx2 + dy2 + 2;
+  if (new_dist_sq < nbh->distSq) {
+    nbh->label = cell->label;
+    nbh->distSq = new_dist_sq;
+    nbh->vec.x = static_cast<int16_t>(cell->vec.x + 1);
+    nbh->vec.y = static_cast<int16_t>(cell->vec.y + 1);
+    push(nbh);
+  }
+  // Northern neighbor.
+  ++nbh;
+  new_dist_sq = cell->distSq + dy2 + 1;
+  if (new_dist_sq < nbh->distSq) {
+    nbh->label = cell->label;
+    nbh->distSq = new_dist_sq;
+    nbh->vec.x = cell->vec.x;
+    nbh->vec.y = static_cast<int16_t>(cell->vec.y + 1);
+    push(nbh);
+  }
+
+  // North-eastern neighbor.
+  ++nbh;
+  new_dist_sq = cell->distSq - dx2 + dy2 + 2;
+  if (new_dist_sq < nbh->distSq) {
+    nbh->label = cell->label;
+    nbh->distSq = new_dist_sq;
+    nbh->vec.x = static_cast<int16_t>(cell->vec.x - 1);
+    nbh->vec.y = static_cast<int16_t>(cell->vec.y + 1);
+    push(nbh);
+  }
+  // Eastern neighbor.
+  nbh += width;
+  new_dist_sq = cell->distSq - dx2 + 1;
+  if (new_dist_sq < nbh->distSq) {
+    nbh->label = cell->label;
+    nbh->distSq = new_dist_sq;
+    nbh->vec.x = static_cast<int16_t>(cell->vec.x - 1);
+    nbh->vec.y = cell->vec.y;
+    push(nbh);
+  }
+
+  // South-eastern neighbor.
+  nbh += width;
+  new_dist_sq = cell->distSq - dx2 - dy2 + 2;
+  if (new_dist_sq < nbh->distSq) {
+    nbh->label = cell->label;
+    nbh->distSq = new_dist_sq;
+    nbh->vec.x = static_cast<int16_t>(cell->vec.x - 1);
+    nbh->vec.y = static_cast<int16_t>(cell->vec.y - 1);
+    push(nbh);
+  }
+  // Southern neighbor.
+  --nbh;
+  new_dist_sq = cell->distSq - dy2 + 1;
+  if (new_dist_sq < nbh->distSq) {
+    nbh->label = cell->label;
+    nbh->distSq = new_dist_sq;
+    nbh->vec.x = cell->vec.x;
+    nbh->vec.y = static_cast<int16_t>(cell->vec.y - 1);
+    push(nbh);
+  }
+
+  // South-western neighbor.
+  --nbh;
+  new_dist_sq = cell->distSq + dx2 - dy2 + 2;
+  if (new_dist_sq < nbh->distSq) {
+    nbh->label = cell->label;
+    nbh->distSq = new_dist_sq;
+    nbh->vec.x = static_cast<int16_t>(cell->vec.x + 1);
+    nbh->vec.y = static_cast<int16_t>(cell->vec.y - 1);
+    push(nbh);
+  }
+  // Western neighbor.
+  nbh -= width;
+  new_dist_sq = cell->distSq + dx2 + 1;
+  if (new_dist_sq < nbh->distSq) {
+    nbh->label = cell->label;
+    nbh->distSq = new_dist_sq;
+    nbh->vec.x = static_cast<int16_t>(cell->vec.x + 1);
+    nbh->vec.y = cell->vec.y;
+    push(nbh);
+  }
+}  // relaxNeighbors
+
+/** Per-band state of the banded propagation. */
+struct Band {
+  FastQueue<InfluenceMap::Cell*> queue;
+
+  /** Cells improved by this band but owned by the previous / next band. */
+  std::vector<InfluenceMap::Cell*> outboxPrev;
+  std::vector<InfluenceMap::Cell*> outboxNext;
+};
+}  // namespace
+
 InfluenceMap::InfluenceMap() : m_plainData(nullptr), m_size(), m_stride(0), m_maxLabel(0) {}
 
 InfluenceMap::InfluenceMap(const ConnectivityMap& cmap) : m_plainData(nullptr), m_size(), m_stride(0), m_maxLabel(0) {
@@ -82,7 +191,7 @@ void InfluenceMap::init(const ConnectivityMap& cmap, const BinaryImage* mask) {
   m_plainData = &m_data[0] + width + 1;
   m_maxLabel = cmap.maxLabel();
 
-  FastQueue<Cell*> queue;
+  std::vector<Cell*> seeds;
 
   Cell* cell = &m_data[0];
   const uint32_t* label = cmap.paddedData();
@@ -93,7 +202,7 @@ void InfluenceMap::init(const ConnectivityMap& cmap, const BinaryImage* mask) {
     cell->vec.x = 0;
     cell->vec.y = 0;
     if (*label != 0) {
-      queue.push(cell);
+      seeds.push_back(cell);
     }
     ++cell;
     ++label;
@@ -127,103 +236,116 @@ void InfluenceMap::init(const ConnectivityMap& cmap, const BinaryImage* mask) {
     }
   }
 
-  while (!queue.empty()) {
-    cell = queue.front();
-    queue.pop();
-
-    assert((cell - &m_data[0]) / width > 0);
-    assert((cell - &m_data[0]) / width < height - 1);
-    assert((cell - &m_data[0]) % width > 0);
-    assert((cell - &m_data[0]) % width < width - 1);
-    assert(cell->distSq != ~uint32_t(0));
-    assert(cell->label != 0);
-    assert(cell->label <= m_maxLabel);
-
-    const int32_t dx2 = cell->vec.x << 1;
-    const int32_t dy2 = cell->vec.y << 1;
-
-    // North-western neighbor.
-    Cell* nbh = cell - width - 1;
-    uint32_t new_dist_sq = cell->distSq + dx2 + dy2 + 2;
-    if (new_dist_sq < nbh->distSq) {
-      nbh->label = cell->label;
-      nbh->distSq = new_dist_sq;
-      nbh->vec.x = static_cast<int16_t>(cell->vec.x + 1);
-      nbh->vec.y = static_cast<int16_t>(cell->vec.y + 1);
-      queue.push(nbh);
-    }
-    // Northern neighbor.
-    ++nbh;
-    new_dist_sq = cell->distSq + dy2 + 1;
-    if (new_dist_sq < nbh->distSq) {
-      nbh->label = cell->label;
-      nbh->distSq = new_dist_sq;
-      nbh->vec.x = cell->vec.x;
-      nbh->vec.y = static_cast<int16_t>(cell->vec.y + 1);
-      queue.push(nbh);
-    }
+  const int plain_height = height - 2;
+  // A fixed band height independent of the number of cores keeps
+  // the result machine-independent.  Bands must be at least 2 rows
+  // tall for the two-phase schedule below to be race-free.
+  const int band_height = std::max(2, (plain_height + 31) / 32);
+  const int num_bands = plain_height / band_height;
 
-    // North-eastern neighbor.
-    ++nbh;
-    new_dist_sq = cell->distSq - dx2 + dy2 + 2;
-    if (new_dist_sq < nbh->distSq) {
-      nbh->label = cell->label;
-      nbh->distSq = new_dist_sq;
-      nbh->vec.x = static_cast<int16_t>(cell->vec.x - 1);
-      nbh->vec.y = static_cast<int16_t>(cell->vec.y + 1);
-      queue.push(nbh);
+  const int64_t parallel_threshold = int64_t(1) << 18;  // 256K pixels.
+  const bool parallel = (int64_t(m_size.width()) * m_size.height() >= parallel_threshold) && (num_bands >= 2);
+
+  if (!parallel) {
+    FastQueue<Cell*> queue;
+    for (Cell* seed : seeds) {
+      queue.push(seed);
     }
-    // Eastern neighbor.
-    nbh += width;
-    new_dist_sq = cell->distSq - dx2 + 1;
-    if (new_dist_sq < nbh->distSq) {
-      nbh->label = cell->label;
-      nbh->distSq = new_dist_sq;
-      nbh->vec.x = static_cast<int16_t>(cell->vec.x - 1);
-      nbh->vec.y = cell->vec.y;
-      queue.push(nbh);
+
+    while (!queue.empty()) {
+      cell = queue.front();
+      queue.pop();
+
+      assert((cell - &m_data[0]) / width > 0);
+      assert((cell - &m_data[0]) / width < height - 1);
+      assert((cell - &m_data[0]) % width > 0);
+      assert((cell - &m_data[0]) % width < width - 1);
+      assert(cell->distSq != ~uint32_t(0));
+      assert(cell->label != 0);
+      assert(cell->label <= m_maxLabel);
+
+      relaxNeighbors(cell, width, [&queue](Cell* nbh) { queue.push(nbh); });
     }
 
-    // South-eastern neighbor.
-    nbh += width;
-    new_dist_sq = cell->distSq - dx2 - dy2 + 2;
-    if (new_dist_sq < nbh->distSq) {
-      nbh->label = cell->label;
-      nbh->distSq = new_dist_sq;
-      nbh->vec.x = static_cast<int16_t>(cell->vec.x - 1);
-      nbh->vec.y = static_cast<int16_t>(cell->vec.y - 1);
-      queue.push(nbh);
+    return;
+  }
+
+  // Banded label-correcting propagation.  Each band runs the serial
+  // algorithm over its own rows; an improved cell of a neighboring
+  // band is updated in place and handed over through an outbox.
+  // Bands of the same parity never share a writable row (bands are
+  // at least 2 rows tall), so a phase processing only even or only
+  // odd bands needs no synchronization beyond the phase barrier.
+  std::vector<Band> bands(num_bands);
+
+  Cell* const data = &m_data[0];
+  for (Cell* seed : seeds) {
+    const int plain_y = int((seed - data) / width) - 1;
+    bands[std::min(plain_y / band_height, num_bands - 1)].queue.push(seed);
+  }
+
+  int parity = 0;
+  int idle_phases = 0;
+  while (idle_phases < 2) {
+    std::vector<int> active;
+    for (int b = parity; b < num_bands; b += 2) {
+      if (!bands[b].queue.empty()) {
+        active.push_back(b);
+      }
     }
-    // Southern neighbor.
-    --nbh;
-    new_dist_sq = cell->distSq - dy2 + 1;
-    if (new_dist_sq < nbh->distSq) {
-      nbh->label = cell->label;
-      nbh->distSq = new_dist_sq;
-      nbh->vec.x = cell->vec.x;
-      nbh->vec.y = static_cast<int16_t>(cell->vec.y - 1);
-      queue.push(nbh);
+    parity ^= 1;
+    if (active.empty()) {
+      ++idle_phases;
+      continue;
     }
+    idle_phases = 0;
+
+    parallelForChunked(0, static_cast<int>(active.size()), [&](const int chunk_begin, const int chunk_end) {
+      for (int i = chunk_begin; i < chunk_end; ++i) {
+        const int b = active[i];
+        Band& band = bands[b];
+
+        const int row_begin = 1 + b * band_height;
+        const int row_end = (b == num_bands - 1) ? height - 1 : row_begin + band_height;
+        Cell* const band_begin = data + row_begin * width;
+        Cell* const band_end = data + row_end * width;
+
+        while (!band.queue.empty()) {
+          Cell* const band_cell = band.queue.front();
+          band.queue.pop();
+
+          relaxNeighbors(band_cell, width, [&](Cell* nbh) {
+            if ((nbh >= band_begin) && (nbh < band_end)) {
+              band.queue.push(nbh);
+            } else if (nbh < band_begin) {
+              band.outboxPrev.push_back(nbh);
+            } else {
+              band.outboxNext.push_back(nbh);
+            }
+          });
+        }
+      }
+    });
+
+    // Deliver the outboxes.  Doing it single-threaded and in band
+    // order makes the receiving queues deterministic.
+    for (int b = 1 - parity; b < num_bands; b += 2) {
+      Band& band = bands[b];
+      if (b > 0) {
+        for (Cell* handed_over : band.outboxPrev) {
+          bands[b - 1].queue.push(handed_over);
+        }
+      }
+      assert((b > 0) || band.outboxPrev.empty());
+      band.outboxPrev.clear();
 
-    // South-western neighbor.
-    --nbh;
-    new_dist_sq = cell->distSq + dx2 - dy2 + 2;
-    if (new_dist_sq < nbh->distSq) {
-      nbh->label = cell->label;
-      nbh->distSq = new_dist_sq;
-      nbh->vec.x = static_cast<int16_t>(cell->vec.x + 1);
-      nbh->vec.y = static_cast<int16_t>(cell->vec.y - 1);
-      queue.push(nbh);
-    }
-    // Western neighbor.
-    nbh -= width;
-    new_dist_sq = cell->distSq + dx2 + 1;
-    if (new_dist_sq < nbh->distSq) {
-      nbh->label = cell->label;
-      nbh->distSq = new_dist_sq;
-      nbh->vec.x = static_cast<int16_t>(cell->vec.x + 1);
-      nbh->vec.y = cell->vec.y;
-      queue.push(nbh);
+      if (b + 1 < num_bands) {
+        for (Cell* handed_over : band.outboxNext) {
+          bands[b + 1].queue.push(handed_over);
+        }
+      }
+      assert((b + 1 < num_bands) || band.outboxNext.empty());
+      band.outboxNext.clear();
     }
   }
 }  // InfluenceMap::init
@@ -0,0 +1,235 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C) 2007-2008  Joseph Artsimovich <joseph_a@mail.ru>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "IntegralImage.h"
+#include <cassert>
+#include "BinaryImage.h"
+#include "GrayImage.h"
+#include "ParallelFor.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMAGEPROC_INTEGRAL_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace imageproc {
+namespace {
+/**
+ * Writes the inclusive prefix sums of \p line to sums[1..len] and the
+ * prefix sums of squared values to sq_sums[1..len].  Position 0 of both
+ * outputs is the fake column and is set to zero.
+ */
+void prefixRowScalar(const uint8_t* const line, const int len, uint32_t* const sums, uint64_t* const sq_sums) {
+  sums[0] = 0;
+  sq_sums[0] = 0;
+
+  uint32_t sum = 0;
+  uint64_t sq_sum = 0;
+  for (int x = 0; x < len; ++x) {
+    const uint32_t pixel = line[x];
+    sum += pixel;
+    sq_sum += pixel * pixel;
+    sums[x + 1] = sum;
+    sq_sums[x + 1] = sq_sum;
+  }
+}
+
+#ifdef IMAGEPROC_INTEGRAL_AVX2
+__attribute__((target("avx2"))) void prefixRowAvx2(const uint8_t* const line,
+                                                   const int len,
+                                                   uint32_t* const sums,
+                                                   uint64_t* const sq_sums) {
+  sums[0] = 0;
+
+  // Only the 32-bit sums are scanned with SIMD.  A 64-bit scan of the
+  // squares would need cross-lane shuffles at every step, which eats
+  // most of the gain, so the squares take the scalar loop below.
+  const __m256i high_lane = _mm256_set_epi32(-1, -1, -1, -1, 0, 0, 0, 0);
+  __m256i carry = _mm256_setzero_si256();
+
+  int x = 0;
+  for (; x + 8 <= len; x += 8) {
+    __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (line + x)));
+    // An inclusive scan within each 128-bit lane...
+    v = _mm256_add_epi32(v, _mm256_slli_si256(v, 4));
+    v = _mm256_add_epi32(v, _mm256_slli_si256(v, 8));
+    // ... then the total of the low lane is added to the high lane.
+    const __m256i low_total = _mm256_permutevar8x32_epi32(v, _mm256_set1_epi32(3));
+    v = _mm256_add_epi32(v, _mm256_and_si256(low_total, high_lane));
+    v = _mm256_add_epi32(v, carry);
+    _mm256_storeu_si256((__m256i*) (sums + x + 1), v);
+    carry = _mm256_permutevar8x32_epi32(v, _mm256_set1_epi32(7));
+  }
+
+  uint32_t sum = (x > 0) ? sums[x] : 0;
+  for (; x < len; ++x) {
+    sum += line[x];
+    sums[x + 1] = sum;
+  }
+
+  sq_sums[0] = 0;
+  uint64_t sq_sum = 0;
+  for (int i = 0; i < len; ++i) {
+    const uint32_t pixel = line[i];
+    sq_sum += pixel * pixel;
+    sq_sums[i + 1] = sq_sum;
+  }
+}
+#endif  // ifdef IMAGEPROC_INTEGRAL_AVX2
+
+/**
+ * Writes the inclusive prefix sums of the first \p len bits of \p line
+ * to sums[1..len].  Position 0 is the fake column and is set to zero.
+ */
+void prefixBinaryRow(const uint32_t* const line, const int len, uint32_t* const sums) {
+  sums[0] = 0;
+
+  uint32_t sum = 0;
+  int x = 0;
+  for (; x + 32 <= len; x += 32) {
+    const uint32_t word = line[x >> 5];
+    if (word == 0) {
+      // All-white: a constant fill the compiler vectorizes.
+      for (int i = 1; i <= 32; ++i) {
+        sums[x + i] = sum;
+      }
+    } else if (word == ~uint32_t(0)) {
+      // All-black: a linear ramp.
+      for (int i = 1; i <= 32; ++i) {
+        sums[x + i] = sum + i;
+      }
+      sum += 32;
+    } else {
+      for (int i = 0; i < 32; ++i) {
+        sum += (word >> (31 - i)) & 1;
+        sums[x + 1 + i] = sum;
+      }
+    }
+  }
+
+  if (x < len) {
+    const uint32_t word = line[x >> 5];
+    for (int i = 0; x < len; ++x, ++i) {
+      sum += (word >> (31 - i)) & 1;
+      sums[x + 1] = sum;
+    }
+  }
+}
+
+void prefixRow(const uint8_t* const line, const int len, uint32_t* const sums, uint64_t* const sq_sums) {
+#ifdef IMAGEPROC_INTEGRAL_AVX2
+  static void (*const kernel)(const uint8_t*, int, uint32_t*, uint64_t*)
+      = __builtin_cpu_supports("avx2") ? &prefixRowAvx2 : &prefixRowScalar;
+  kernel(line, len, sums, sq_sums);
+#else
+  prefixRowScalar(line, len, sums, sq_sums);
+#endif
+}
+}  // namespace
+
+void buildGrayIntegralImages(const GrayImage& src, IntegralImage<uint32_t>& sums, IntegralImage<uint64_t>& square_sums) {
+  const int w = src.width();
+  const int h = src.height();
+  assert(sums.m_width == w + 1 && sums.m_height == h + 1);
+  assert(square_sums.m_width == w + 1 && square_sums.m_height == h + 1);
+
+  const uint8_t* const src_data = src.data();
+  const int src_stride = src.stride();
+  const int table_width = w + 1;
+  uint32_t* const sum_data = sums.m_data;
+  uint64_t* const sq_sum_data = square_sums.m_data;
+
+  // Pixel counts below which threading overhead isn't worth it.
+  const int max_threads = (int64_t(w) * h >= (int64_t(1) << 18)) ? 0 : 1;
+
+  // Phase 1: independent prefix sums along every row.
+  // Row 0 of both tables is the fake row, initialized by init().
+  parallelForChunked(
+      0, h,
+      [&](const int chunk_begin, const int chunk_end) {
+        for (int y = chunk_begin; y < chunk_end; ++y) {
+          prefixRow(src_data + y * src_stride, w, sum_data + (y + 1) * table_width,
+                    sq_sum_data + (y + 1) * table_width);
+        }
+      },
+      max_threads);
+
+  // Phase 2: accumulation down the columns, parallel over vertical
+  // strips.  Within a strip each row is just an element-wise addition
+  // of the row above, which vectorizes.
+  parallelForChunked(
+      1, table_width,
+      [&](const int strip_begin, const int strip_end) {
+        for (int y = 2; y <= h; ++y) {
+          uint32_t* const sum_row = sum_data + y * table_width;
+          const uint32_t* const sum_above = sum_row - table_width;
+          for (int x = strip_begin; x < strip_end; ++x) {
+            sum_row[x] += sum_above[x];
+          }
+
+          uint64_t* const sq_sum_row = sq_sum_data + y * table_width;
+          const uint64_t* const sq_sum_above = sq_sum_row - table_width;
+          for (int x = strip_begin; x < strip_end; ++x) {
+            sq_sum_row[x] += sq_sum_above[x];
+          }
+        }
+      },
+      max_threads);
+}
+
+void buildBinaryIntegralImage(const BinaryImage& src, IntegralImage<uint32_t>& sums) {
+  const int w = src.width();
+  const int h = src.height();
+  assert(sums.m_width == w + 1 && sums.m_height == h + 1);
+
+  const uint32_t* const src_data = src.data();
+  const int wpl = src.wordsPerLine();
+  const int table_width = w + 1;
+  uint32_t* const sum_data = sums.m_data;
+
+  // Pixel counts below which threading overhead isn't worth it.
+  const int max_threads = (int64_t(w) * h >= (int64_t(1) << 18)) ? 0 : 1;
+
+  // Phase 1: independent prefix sums along every row.
+  // Row 0 of the table is the fake row, initialized by init().
+  parallelForChunked(
+      0, h,
+      [&](const int chunk_begin, const int chunk_end) {
+        for (int y = chunk_begin; y < chunk_end; ++y) {
+          prefixBinaryRow(src_data + y * wpl, w, sum_data + (y + 1) * table_width);
+        }
+      },
+      max_threads);
+
+  // Phase 2: accumulation down the columns, parallel over vertical
+  // strips.  Within a strip each row is just an element-wise addition
+  // of the row above, which vectorizes.
+  parallelForChunked(
+      1, table_width,
+      [&](const int strip_begin, const int strip_end) {
+        for (int y = 2; y <= h; ++y) {
+          uint32_t* const sum_row = sum_data + y * table_width;
+          const uint32_t* const sum_above = sum_row - table_width;
+          for (int x = strip_begin; x < strip_end; ++x) {
+            sum_row[x] += sum_above[x];
+          }
+        }
+      },
+      max_threads);
+}
+}  // namespace imageproc
@@ -21,10 +21,39 @@
 
 #include <QRect>
 #include <QSize>
+#include <cstdint>
 #include <new>
 #include "NonCopyable.h"
 
 namespace imageproc {
+class BinaryImage;
+class GrayImage;
+
+template <typename T>
+class IntegralImage;
+
+/**
+ * \brief Builds the integral image and the integral of squares of an
+ *        8-bit grayscale image in a single pass over the source.
+ *
+ * Both images must have been constructed with the size of \p src.
+ * This replaces pushing the values one by one: the row prefix sums
+ * are vectorized and the column accumulation runs in parallel over
+ * vertical strips.
+ */
+void buildGrayIntegralImages(const GrayImage& src, IntegralImage<uint32_t>& sums, IntegralImage<uint64_t>& square_sums);
+
+/**
+ * \brief Builds the integral image of a binary image, counting the
+ *        black (set) pixels.
+ *
+ * The image must have been constructed with the size of \p src.
+ * This replaces pushing the bits one by one: rows are processed a
+ * word at a time, with fast paths for all-white and all-black words,
+ * and the column accumulation runs in parallel over vertical strips.
+ */
+void buildBinaryIntegralImage(const BinaryImage& src, IntegralImage<uint32_t>& sums);
+
 /**
  * \brief Provides the sum of values in a sub-rectangle of a 2D array in constant time.
  *
@@ -74,6 +103,12 @@ class IntegralImage {
   T sum(const QRect& rect) const;
 
  private:
+  friend void buildGrayIntegralImages(const GrayImage& src,
+                                      IntegralImage<uint32_t>& sums,
+                                      IntegralImage<uint64_t>& square_sums);
+
+  friend void buildBinaryIntegralImage(const BinaryImage& src, IntegralImage<uint32_t>& sums);
+
   void init(int width, int height);
 
   T* m_data;
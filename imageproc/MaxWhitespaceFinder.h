@@ -21,6 +21,7 @@
 
 #include <QRect>
 #include <QSize>
+#include <algorithm>
 #include <cstddef>
 #include <deque>
 #include <memory>
@@ -244,6 +245,9 @@ void PriorityStorageImpl<QualityCompare>::pop() {
 /**
  * Same as std::push_heap(), except this one never copies objects, but swap()'s
  * them instead.  We need this to avoid copying the obstacle list over and over.
+ *
+ * The heap is 4-ary: half the levels of a binary one, and the children
+ * of a node are adjacent in memory, so a reheap touches fewer cache lines.
  */
 template <typename QualityCompare>
 void PriorityStorageImpl<QualityCompare>::pushHeap(const std::deque<Region>::iterator begin,
@@ -251,13 +255,13 @@ void PriorityStorageImpl<QualityCompare>::pushHeap(const std::deque<Region>::ite
   typedef std::vector<Region>::iterator::difference_type Distance;
 
   Distance valueIdx = end - begin - 1;
-  Distance parentIdx = (valueIdx - 1) / 2;
+  Distance parentIdx = (valueIdx - 1) / 4;
 
   // While the node is bigger than its parent, swap them.
   while (valueIdx > 0 && m_qualityLess(*(begin + parentIdx), *(begin + valueIdx))) {
     (begin + valueIdx)->swap(*(begin + parentIdx));
     valueIdx = parentIdx;
-    parentIdx = (valueIdx - 1) / 2;
+    parentIdx = (valueIdx - 1) / 4;
   }
 }
 
@@ -274,28 +278,25 @@ void PriorityStorageImpl<QualityCompare>::popHeap(const std::deque<Region>::iter
   typedef std::vector<Region>::iterator::difference_type Distance;
   const Distance new_length = end - begin - 1;
   Distance nodeIdx = 0;
-  Distance secondChildIdx = 2 * (nodeIdx + 1);
 
   // Lower the new top node all the way down the tree
   // by continuously swapping it with the biggest of its children.
-  while (secondChildIdx < new_length) {
-    const Distance firstChildIdx = secondChildIdx - 1;
-    Distance biggestChildIdx = firstChildIdx;
+  while (true) {
+    const Distance firstChildIdx = 4 * nodeIdx + 1;
+    if (firstChildIdx >= new_length) {
+      break;
+    }
 
-    if (m_qualityLess(*(begin + firstChildIdx), *(begin + secondChildIdx))) {
-      biggestChildIdx = secondChildIdx;
+    const Distance childEndIdx = std::min<Distance>(firstChildIdx + 4, new_length);
+    Distance biggestChildIdx = firstChildIdx;
+    for (Distance i = firstChildIdx + 1; i < childEndIdx; ++i) {
+      if (m_qualityLess(*(begin + biggestChildIdx), *(begin + i))) {
+        biggestChildIdx = i;
+      }
     }
 
     (begin + nodeIdx)->swap(*(begin + biggestChildIdx));
-
     nodeIdx = biggestChildIdx;
-    secondChildIdx = 2 * (nodeIdx + 1);
-  }
-  if (secondChildIdx == new_length) {
-    // Swap it with its only child.
-    const Distance firstChildIdx = secondChildIdx - 1;
-    (begin + nodeIdx)->swap(*(begin + firstChildIdx));
-    nodeIdx = firstChildIdx;
   }
 
   // Now raise the node until it's at correct position.  Very little
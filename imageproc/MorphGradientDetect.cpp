@@ -17,22 +17,18 @@
  */
 
 #include "MorphGradientDetect.h"
-#include "GrayRasterOp.h"
 #include "Grayscale.h"
 #include "Morphology.h"
 
 namespace imageproc {
+// The fused entry points below produce the difference directly from the
+// final windowed min/max pass, instead of materializing the eroded or
+// dilated image and subtracting it in a separate sweep.
 GrayImage morphGradientDetectDarkSide(const GrayImage& image, const QSize& area) {
-  GrayImage lighter(erodeGray(image, area, 0x00));
-  grayRasterOp<GRopUnclippedSubtract<GRopDst, GRopSrc>>(lighter, image);
-
-  return lighter;
+  return erodeGrayMinusSrc(image, area, 0x00);
 }
 
 GrayImage morphGradientDetectLightSide(const GrayImage& image, const QSize& area) {
-  GrayImage darker(dilateGray(image, area, 0xff));
-  grayRasterOp<GRopUnclippedSubtract<GRopSrc, GRopDst>>(darker, image);
-
-  return darker;
+  return srcMinusDilateGray(image, area, 0xff);
 }
 }  // namespace imageproc
@@ -23,6 +23,8 @@
 #include "BinaryImage.h"
 #include "GrayImage.h"
 #include "Grayscale.h"
+#include "OpCounters.h"
+#include "ParallelFor.h"
 #include "RasterOp.h"
 
 namespace imageproc {
@@ -325,6 +327,9 @@ void dilateOrErodeBrick(BinaryImage& dst,
   assert(!brick.isEmpty());
   assert(!dst_area.isEmpty());
 
+  OpCounters::add(OpCounters::MORPHOLOGY_CALLS, 1);
+  OpCounters::add(OpCounters::MORPHOLOGY_BYTES, (uint64_t(src.width()) * src.height() + uint64_t(dst_area.width()) * dst_area.height()) / 8);
+
   if (!extendByBrick(src.rect(), brick).intersects(dst_area)) {
     dst.fill(src_surroundings);
 
@@ -398,6 +403,37 @@ class Lighter {
 };
 
 
+/** Final-pass writer that stores the windowed extremum as is. */
+class StoreExtremum {
+ public:
+  uint8_t operator()(const uint8_t extremum, int /*x*/, int /*y*/) const { return extremum; }
+};
+
+
+/**
+ * Final-pass writer producing a morphological gradient directly: the
+ * unclipped difference between the extremum and the pixel of the
+ * original image at the same destination coordinates.  Fusing the
+ * subtraction into the spreading pass saves a separate full-image sweep.
+ */
+template <bool ExtremumMinusOrigin>
+class GradientWriter {
+ public:
+  GradientWriter(const uint8_t* origin_data, const int origin_stride)
+      : m_originData(origin_data), m_originStride(origin_stride) {}
+
+  uint8_t operator()(const uint8_t extremum, const int x, const int y) const {
+    const uint8_t origin = m_originData[y * m_originStride + x];
+
+    return ExtremumMinusOrigin ? extremum - origin : origin - extremum;
+  }
+
+ private:
+  const uint8_t* const m_originData;
+  const int m_originStride;
+};
+
+
 template <typename MinOrMax>
 void fillExtremumArrayLeftHalf(uint8_t* dst,
                                const uint8_t* const src_center,
@@ -434,66 +470,87 @@ void fillExtremumArrayRightHalf(uint8_t* dst,
   }
 }
 
-template <typename MinOrMax>
-void spreadGrayHorizontal(GrayImage& dst, const GrayImage& src, const int dy, const int dx1, const int dx2) {
+template <typename MinOrMax, typename FinalWriter>
+void spreadGrayHorizontal(GrayImage& dst,
+                          const GrayImage& src,
+                          const int dy,
+                          const int dx1,
+                          const int dx2,
+                          const FinalWriter& writer) {
   const int src_stride = src.stride();
   const int dst_stride = dst.stride();
-  const uint8_t* src_line = src.data() + dy * src_stride;
-  uint8_t* dst_line = dst.data();
 
   const int dst_width = dst.width();
   const int dst_height = dst.height();
 
   const int se_len = dx2 - dx1 + 1;
 
-  std::vector<uint8_t> min_max_array(se_len * 2 - 1, 0);
-  uint8_t* const array_center = &min_max_array[se_len - 1];
-
-  for (int y = 0; y < dst_height; ++y) {
-    for (int dst_segment_first = 0; dst_segment_first < dst_width; dst_segment_first += se_len) {
-      const int dst_segment_last = std::min(dst_segment_first + se_len, dst_width) - 1;  // inclusive
-      const int src_segment_first = dst_segment_first + dx1;
-      const int src_segment_last = dst_segment_last + dx2;
-      const int src_segment_center = (src_segment_first + src_segment_last) >> 1;
-
-      fillExtremumArrayLeftHalf<MinOrMax>(array_center, src_line + src_segment_center, 1, src_segment_first,
-                                          src_segment_center);
-
-      fillExtremumArrayRightHalf<MinOrMax>(array_center, src_line + src_segment_center, 1, src_segment_center,
-                                           src_segment_last);
-
-      for (int x = dst_segment_first; x <= dst_segment_last; ++x) {
-        const int src_first = x + dx1;
-        const int src_last = x + dx2;  // inclusive
-        assert(src_segment_center >= src_first);
-        assert(src_segment_center <= src_last);
-        uint8_t v1 = array_center[src_first - src_segment_center];
-        uint8_t v2 = array_center[src_last - src_segment_center];
-        dst_line[x] = MinOrMax::select(v1, v2);
+  const uint8_t* const src_data = src.data() + dy * src_stride;
+  uint8_t* const dst_data = dst.data();
+
+  // The van Herk / Gil-Werman scheme below makes the cost of a row
+  // independent of the structuring element length.  Rows don't depend
+  // on each other, so they are split across threads, each thread with
+  // its own extremum array.
+  parallelForChunked(0, dst_height, [&](const int y_begin, const int y_end) {
+    std::vector<uint8_t> min_max_array(se_len * 2 - 1, 0);
+    uint8_t* const array_center = &min_max_array[se_len - 1];
+
+    const uint8_t* src_line = src_data + y_begin * src_stride;
+    uint8_t* dst_line = dst_data + y_begin * dst_stride;
+
+    for (int y = y_begin; y < y_end; ++y) {
+      for (int dst_segment_first = 0; dst_segment_first < dst_width; dst_segment_first += se_len) {
+        const int dst_segment_last = std::min(dst_segment_first + se_len, dst_width) - 1;  // inclusive
+        const int src_segment_first = dst_segment_first + dx1;
+        const int src_segment_last = dst_segment_last + dx2;
+        const int src_segment_center = (src_segment_first + src_segment_last) >> 1;
+
+        fillExtremumArrayLeftHalf<MinOrMax>(array_center, src_line + src_segment_center, 1, src_segment_first,
+                                            src_segment_center);
+
+        fillExtremumArrayRightHalf<MinOrMax>(array_center, src_line + src_segment_center, 1, src_segment_center,
+                                             src_segment_last);
+
+        for (int x = dst_segment_first; x <= dst_segment_last; ++x) {
+          const int src_first = x + dx1;
+          const int src_last = x + dx2;  // inclusive
+          assert(src_segment_center >= src_first);
+          assert(src_segment_center <= src_last);
+          uint8_t v1 = array_center[src_first - src_segment_center];
+          uint8_t v2 = array_center[src_last - src_segment_center];
+          dst_line[x] = writer(MinOrMax::select(v1, v2), x, y);
+        }
       }
-    }
 
-    src_line += src_stride;
-    dst_line += dst_stride;
-  }
+      src_line += src_stride;
+      dst_line += dst_stride;
+    }
+  });
 }  // spreadGrayHorizontal
 
-template <typename MinOrMax>
+template <typename MinOrMax, typename FinalWriter>
 void spreadGrayHorizontal(GrayImage& dst,
                           const CoordinateSystem& dst_cs,
                           const GrayImage& src,
                           const CoordinateSystem& src_cs,
                           const int dy,
                           const int dx1,
-                          const int dx2) {
+                          const int dx2,
+                          const FinalWriter& writer) {
   // src_point = dst_point + dst_to_src;
   const QPoint dst_to_src(dst_cs.offsetTo(src_cs));
 
-  spreadGrayHorizontal<MinOrMax>(dst, src, dy + dst_to_src.y(), dx1 + dst_to_src.x(), dx2 + dst_to_src.x());
+  spreadGrayHorizontal<MinOrMax>(dst, src, dy + dst_to_src.y(), dx1 + dst_to_src.x(), dx2 + dst_to_src.x(), writer);
 }
 
-template <typename MinOrMax>
-void spreadGrayVertical(GrayImage& dst, const GrayImage& src, const int dx, const int dy1, const int dy2) {
+template <typename MinOrMax, typename FinalWriter>
+void spreadGrayVertical(GrayImage& dst,
+                        const GrayImage& src,
+                        const int dx,
+                        const int dy1,
+                        const int dy2,
+                        const FinalWriter& writer) {
   const int src_stride = src.stride();
   const int dst_stride = dst.stride();
   const uint8_t* const src_data = src.data() + dx;
@@ -504,49 +561,54 @@ void spreadGrayVertical(GrayImage& dst, const GrayImage& src, const int dx, cons
 
   const int se_len = dy2 - dy1 + 1;
 
-  std::vector<uint8_t> min_max_array(se_len * 2 - 1, 0);
-  uint8_t* const array_center = &min_max_array[se_len - 1];
-
-  for (int x = 0; x < dst_width; ++x) {
-    for (int dst_segment_first = 0; dst_segment_first < dst_height; dst_segment_first += se_len) {
-      const int dst_segment_last = std::min(dst_segment_first + se_len, dst_height) - 1;  // inclusive
-      const int src_segment_first = dst_segment_first + dy1;
-      const int src_segment_last = dst_segment_last + dy2;
-      const int src_segment_center = (src_segment_first + src_segment_last) >> 1;
-
-      fillExtremumArrayLeftHalf<MinOrMax>(array_center, src_data + x + src_segment_center * src_stride, src_stride,
-                                          src_segment_first, src_segment_center);
-
-      fillExtremumArrayRightHalf<MinOrMax>(array_center, src_data + x + src_segment_center * src_stride, src_stride,
-                                           src_segment_center, src_segment_last);
-
-      uint8_t* dst = dst_data + x + dst_segment_first * dst_stride;
-      for (int y = dst_segment_first; y <= dst_segment_last; ++y) {
-        const int src_first = y + dy1;
-        const int src_last = y + dy2;  // inclusive
-        assert(src_segment_center >= src_first);
-        assert(src_segment_center <= src_last);
-        uint8_t v1 = array_center[src_first - src_segment_center];
-        uint8_t v2 = array_center[src_last - src_segment_center];
-        *dst = MinOrMax::select(v1, v2);
-        dst += dst_stride;
+  // Columns are independent; contiguous strips of them go to
+  // separate threads.  \see spreadGrayHorizontal()
+  parallelForChunked(0, dst_width, [&](const int x_begin, const int x_end) {
+    std::vector<uint8_t> min_max_array(se_len * 2 - 1, 0);
+    uint8_t* const array_center = &min_max_array[se_len - 1];
+
+    for (int x = x_begin; x < x_end; ++x) {
+      for (int dst_segment_first = 0; dst_segment_first < dst_height; dst_segment_first += se_len) {
+        const int dst_segment_last = std::min(dst_segment_first + se_len, dst_height) - 1;  // inclusive
+        const int src_segment_first = dst_segment_first + dy1;
+        const int src_segment_last = dst_segment_last + dy2;
+        const int src_segment_center = (src_segment_first + src_segment_last) >> 1;
+
+        fillExtremumArrayLeftHalf<MinOrMax>(array_center, src_data + x + src_segment_center * src_stride, src_stride,
+                                            src_segment_first, src_segment_center);
+
+        fillExtremumArrayRightHalf<MinOrMax>(array_center, src_data + x + src_segment_center * src_stride, src_stride,
+                                             src_segment_center, src_segment_last);
+
+        uint8_t* dst = dst_data + x + dst_segment_first * dst_stride;
+        for (int y = dst_segment_first; y <= dst_segment_last; ++y) {
+          const int src_first = y + dy1;
+          const int src_last = y + dy2;  // inclusive
+          assert(src_segment_center >= src_first);
+          assert(src_segment_center <= src_last);
+          uint8_t v1 = array_center[src_first - src_segment_center];
+          uint8_t v2 = array_center[src_last - src_segment_center];
+          *dst = writer(MinOrMax::select(v1, v2), x, y);
+          dst += dst_stride;
+        }
       }
     }
-  }
+  });
 }  // spreadGrayVertical
 
-template <typename MinOrMax>
+template <typename MinOrMax, typename FinalWriter>
 void spreadGrayVertical(GrayImage& dst,
                         const CoordinateSystem& dst_cs,
                         const GrayImage& src,
                         const CoordinateSystem& src_cs,
                         const int dx,
                         const int dy1,
-                        const int dy2) {
+                        const int dy2,
+                        const FinalWriter& writer) {
   // src_point = dst_point + dst_to_src;
   const QPoint dst_to_src(dst_cs.offsetTo(src_cs));
 
-  spreadGrayVertical<MinOrMax>(dst, src, dx + dst_to_src.x(), dy1 + dst_to_src.y(), dy2 + dst_to_src.y());
+  spreadGrayVertical<MinOrMax>(dst, src, dx + dst_to_src.x(), dy1 + dst_to_src.y(), dy2 + dst_to_src.y(), writer);
 }
 
 GrayImage extendGrayImage(const GrayImage& src, const QRect& dst_area, const uint8_t background) {
@@ -606,6 +668,10 @@ GrayImage dilateOrErodeGray(const GrayImage& src,
   assert(!brick.isEmpty());
   assert(!dst_area.isEmpty());
 
+  OpCounters::add(OpCounters::MORPHOLOGY_CALLS, 1);
+  OpCounters::add(OpCounters::MORPHOLOGY_BYTES,
+                  uint64_t(src.width()) * src.height() + uint64_t(dst_area.width()) * dst_area.height());
+
   GrayImage dst(dst_area.size());
 
   if (!extendByBrick(src.rect(), brick).intersects(dst_area)) {
@@ -644,11 +710,11 @@ GrayImage dilateOrErodeGray(const GrayImage& src,
       }
 
       spreadGrayHorizontal<MinOrMax>(tmp, tmp_cs, effective_src, effective_src_cs, collect_area1.minY(),
-                                     collect_area1.minX(), collect_area1.maxX());
+                                     collect_area1.minX(), collect_area1.maxX(), StoreExtremum());
     }
     // Second operation.
     spreadGrayVertical<MinOrMax>(dst, dst_cs, tmp, tmp_cs, collect_area2.minX(), collect_area2.minY(),
-                                 collect_area2.maxY());
+                                 collect_area2.maxY(), StoreExtremum());
   } else {
     const QRect effective_src_rect(extendByBrick(dst_area, collect_area));
     GrayImage effective_src;
@@ -662,16 +728,84 @@ GrayImage dilateOrErodeGray(const GrayImage& src,
 
     if (collect_area.minY() == collect_area.maxY()) {
       spreadGrayHorizontal<MinOrMax>(dst, dst_cs, effective_src, effective_src_cs, collect_area.minY(),
-                                     collect_area.minX(), collect_area.maxX());
+                                     collect_area.minX(), collect_area.maxX(), StoreExtremum());
     } else {
       assert(collect_area.minX() == collect_area.maxX());
       spreadGrayVertical<MinOrMax>(dst, dst_cs, effective_src, effective_src_cs, collect_area.minX(),
-                                   collect_area.minY(), collect_area.maxY());
+                                   collect_area.minY(), collect_area.maxY(), StoreExtremum());
     }
   }
 
   return dst;
 }  // dilateOrErodeGray
+
+/**
+ * Mirrors dilateOrErodeGray() over the whole source rect, except the
+ * final spreading pass writes the difference with the source pixel
+ * directly instead of the extremum, so no separate subtraction sweep
+ * and no second full-size result image are needed.
+ */
+template <typename MinOrMax, bool ExtremumMinusSrc>
+GrayImage grayGradient(const GrayImage& src, const Brick& brick, const unsigned char src_surroundings) {
+  assert(!src.isNull());
+  assert(!brick.isEmpty());
+
+  OpCounters::add(OpCounters::MORPHOLOGY_CALLS, 1);
+  OpCounters::add(OpCounters::MORPHOLOGY_BYTES, 2 * uint64_t(src.width()) * src.height());
+
+  const QRect dst_area(src.rect());
+  GrayImage dst(dst_area.size());
+  const CoordinateSystem dst_cs(dst_area.topLeft());
+  const Brick collect_area(brick.flipped());
+  const GradientWriter<ExtremumMinusSrc> gradient_writer(src.data(), src.stride());
+
+  if ((collect_area.minY() != collect_area.maxY()) && (collect_area.minX() != collect_area.maxX())) {
+    const Brick collect_area1(collect_area.minX(), collect_area.minY(), collect_area.maxX(), collect_area.minY());
+    const Brick collect_area2(0, 0, 0, collect_area.maxY() - collect_area.minY());
+
+    const QRect tmp_rect(extendByBrick(dst_area, collect_area2));
+    CoordinateSystem tmp_cs(tmp_rect.topLeft());
+
+    GrayImage tmp(tmp_rect.size());
+    {
+      const QRect effective_src_rect(extendByBrick(tmp_rect, collect_area1));
+      GrayImage effective_src;
+      CoordinateSystem effective_src_cs;
+      if (src.rect().contains(effective_src_rect)) {
+        effective_src = src;
+      } else {
+        effective_src = extendGrayImage(src, effective_src_rect, src_surroundings);
+        effective_src_cs = CoordinateSystem(effective_src_rect.topLeft());
+      }
+
+      spreadGrayHorizontal<MinOrMax>(tmp, tmp_cs, effective_src, effective_src_cs, collect_area1.minY(),
+                                     collect_area1.minX(), collect_area1.maxX(), StoreExtremum());
+    }
+    spreadGrayVertical<MinOrMax>(dst, dst_cs, tmp, tmp_cs, collect_area2.minX(), collect_area2.minY(),
+                                 collect_area2.maxY(), gradient_writer);
+  } else {
+    const QRect effective_src_rect(extendByBrick(dst_area, collect_area));
+    GrayImage effective_src;
+    CoordinateSystem effective_src_cs;
+    if (src.rect().contains(effective_src_rect)) {
+      effective_src = src;
+    } else {
+      effective_src = extendGrayImage(src, effective_src_rect, src_surroundings);
+      effective_src_cs = CoordinateSystem(effective_src_rect.topLeft());
+    }
+
+    if (collect_area.minY() == collect_area.maxY()) {
+      spreadGrayHorizontal<MinOrMax>(dst, dst_cs, effective_src, effective_src_cs, collect_area.minY(),
+                                     collect_area.minX(), collect_area.maxX(), gradient_writer);
+    } else {
+      assert(collect_area.minX() == collect_area.maxX());
+      spreadGrayVertical<MinOrMax>(dst, dst_cs, effective_src, effective_src_cs, collect_area.minX(),
+                                   collect_area.minY(), collect_area.maxY(), gradient_writer);
+    }
+  }
+
+  return dst;
+}  // grayGradient
 }  // anonymous namespace
 
 BinaryImage dilateBrick(const BinaryImage& src,
@@ -716,6 +850,10 @@ BinaryImage dilateBrick(const BinaryImage& src, const Brick& brick, const BWColo
   return dilateBrick(src, brick, src.rect(), src_surroundings);
 }
 
+void dilateBrickInPlace(BinaryImage& image, const Brick& brick, const BWColor src_surroundings) {
+  dilateBrick(image, brick, image.rect(), src_surroundings).swap(image);
+}
+
 GrayImage dilateGray(const GrayImage& src, const Brick& brick, const unsigned char src_surroundings) {
   return dilateGray(src, brick, src.rect(), src_surroundings);
 }
@@ -764,10 +902,36 @@ BinaryImage erodeBrick(const BinaryImage& src, const Brick& brick, const BWColor
   return erodeBrick(src, brick, src.rect(), src_surroundings);
 }
 
+void erodeBrickInPlace(BinaryImage& image, const Brick& brick, const BWColor src_surroundings) {
+  erodeBrick(image, brick, image.rect(), src_surroundings).swap(image);
+}
+
 GrayImage erodeGray(const GrayImage& src, const Brick& brick, const unsigned char src_surroundings) {
   return erodeGray(src, brick, src.rect(), src_surroundings);
 }
 
+GrayImage erodeGrayMinusSrc(const GrayImage& src, const Brick& brick, const unsigned char src_surroundings) {
+  if (src.isNull()) {
+    throw std::invalid_argument("erodeGrayMinusSrc: src image is null");
+  }
+  if (brick.isEmpty()) {
+    throw std::invalid_argument("erodeGrayMinusSrc: brick is empty");
+  }
+
+  return grayGradient<Lighter, true>(src, brick, src_surroundings);
+}
+
+GrayImage srcMinusDilateGray(const GrayImage& src, const Brick& brick, const unsigned char src_surroundings) {
+  if (src.isNull()) {
+    throw std::invalid_argument("srcMinusDilateGray: src image is null");
+  }
+  if (brick.isEmpty()) {
+    throw std::invalid_argument("srcMinusDilateGray: brick is empty");
+  }
+
+  return grayGradient<Darker, false>(src, brick, src_surroundings);
+}
+
 BinaryImage openBrick(const BinaryImage& src,
                       const QSize& brick,
                       const QRect& dst_area,
@@ -809,6 +973,10 @@ BinaryImage openBrick(const BinaryImage& src, const QSize& brick, const BWColor
   return openBrick(src, brick, src.rect(), src_surroundings);
 }
 
+void openBrickInPlace(BinaryImage& image, const QSize& brick, const BWColor src_surroundings) {
+  openBrick(image, brick, image.rect(), src_surroundings).swap(image);
+}
+
 GrayImage openGray(const GrayImage& src,
                    const QSize& brick,
                    const QRect& dst_area,
@@ -881,6 +1049,10 @@ BinaryImage closeBrick(const BinaryImage& src, const QSize& brick, const BWColor
   return closeBrick(src, brick, src.rect(), src_surroundings);
 }
 
+void closeBrickInPlace(BinaryImage& image, const QSize& brick, const BWColor src_surroundings) {
+  closeBrick(image, brick, image.rect(), src_surroundings).swap(image);
+}
+
 GrayImage closeGray(const GrayImage& src,
                     const QSize& brick,
                     const QRect& dst_area,
@@ -122,6 +122,15 @@ BinaryImage dilateBrick(const BinaryImage& src,
  */
 BinaryImage dilateBrick(const BinaryImage& src, const Brick& brick, BWColor src_surroundings = WHITE);
 
+/**
+ * \brief Same as above, with the result replacing \p image.
+ *
+ * Prefer this form when the source image is no longer needed.  It makes
+ * sure no reference to the old data survives, so later writes to the
+ * result won't trigger a copy-on-write.
+ */
+void dilateBrickInPlace(BinaryImage& image, const Brick& brick, BWColor src_surroundings = WHITE);
+
 /**
  * \brief Spreads darker pixels over the brick's area.
  *
@@ -164,6 +173,11 @@ BinaryImage erodeBrick(const BinaryImage& src,
  */
 BinaryImage erodeBrick(const BinaryImage& src, const Brick& brick, BWColor src_surroundings = BLACK);
 
+/**
+ * \brief Same as above, with the result replacing \p image.
+ */
+void erodeBrickInPlace(BinaryImage& image, const Brick& brick, BWColor src_surroundings = BLACK);
+
 /**
  * \brief Spreads lighter pixels over the brick's area.
  *
@@ -185,6 +199,24 @@ GrayImage erodeGray(const GrayImage& src,
  */
 GrayImage erodeGray(const GrayImage& src, const Brick& brick, unsigned char src_surroundings = 0x00);
 
+/**
+ * \brief Computes erodeGray(src, brick) - src in a single pass.
+ *
+ * Equivalent to eroding and then subtracting the source pixelwise
+ * (without clipping), but the difference is produced by the final
+ * spreading pass itself, so no second full-size image is allocated
+ * and no separate subtraction sweep is made.  This is the dark side
+ * of a morphological gradient.
+ */
+GrayImage erodeGrayMinusSrc(const GrayImage& src, const Brick& brick, unsigned char src_surroundings = 0x00);
+
+/**
+ * \brief Computes src - dilateGray(src, brick) in a single pass.
+ *
+ * The light side counterpart of erodeGrayMinusSrc().
+ */
+GrayImage srcMinusDilateGray(const GrayImage& src, const Brick& brick, unsigned char src_surroundings = 0xff);
+
 /**
  * \brief Turn the black areas where the brick doesn't fit, into white.
  *
@@ -208,6 +240,11 @@ BinaryImage openBrick(const BinaryImage& src,
  */
 BinaryImage openBrick(const BinaryImage& src, const QSize& brick, BWColor src_surroundings = WHITE);
 
+/**
+ * \brief Same as above, with the result replacing \p image.
+ */
+void openBrickInPlace(BinaryImage& image, const QSize& brick, BWColor src_surroundings = WHITE);
+
 /**
  * \brief Remove dark areas smaller than the structuring element.
  *
@@ -249,6 +286,11 @@ BinaryImage closeBrick(const BinaryImage& src,
  */
 BinaryImage closeBrick(const BinaryImage& src, const QSize& brick, BWColor src_surroundings = WHITE);
 
+/**
+ * \brief Same as above, with the result replacing \p image.
+ */
+void closeBrickInPlace(BinaryImage& image, const QSize& brick, BWColor src_surroundings = WHITE);
+
 /**
  * \brief Remove light areas smaller than the structuring element.
  *
@@ -18,6 +18,8 @@
 
 #include "OrthogonalRotation.h"
 #include "BinaryImage.h"
+#include "BitOps.h"
+#include "ParallelFor.h"
 #include "RasterOp.h"
 
 namespace imageproc {
@@ -25,6 +27,48 @@ static inline uint32_t mask(int x) {
   return (uint32_t(1) << 31) >> (x % 32);
 }
 
+/**
+ * Returns the max_threads argument for parallelForChunked().
+ */
+static int rotationMaxThreads(const QRect& src_rect) {
+  const int64_t area = int64_t(src_rect.width()) * src_rect.height();
+  const int64_t parallel_threshold = int64_t(1) << 18;  // 256K pixels.
+
+  return area >= parallel_threshold ? 0 : 1;
+}
+
+/**
+ * Extracts 32 consecutive bits starting at \p bit_pos of a line.
+ * Bit 0 of the result (MSB first) corresponds to \p bit_pos.
+ * All 32 bits must lie within the line, or the behaviour is undefined.
+ */
+static inline uint32_t window32(const uint32_t* const line, const int bit_pos, const int last_word) {
+  const int word = bit_pos >> 5;
+  const int shift = bit_pos & 31;
+  uint32_t w = line[word] << shift;
+  if ((shift != 0) && (word < last_word)) {
+    w |= line[word + 1] >> (32 - shift);
+  }
+
+  return w;
+}
+
+/**
+ * In-place transpose of a 32x32 bit matrix, with bit j (MSB first)
+ * of word i being the element at row i, column j.
+ * The algorithm is from Hacker's Delight, section 7-3.
+ */
+static void transpose32(uint32_t* const a) {
+  uint32_t m = 0x0000ffff;
+  for (int j = 16; j != 0; j >>= 1, m ^= m << j) {
+    for (int k = 0; k < 32; k = (k + j + 1) & ~j) {
+      const uint32_t t = (a[k] ^ (a[k + j] >> j)) & m;
+      a[k] ^= t;
+      a[k + j] ^= t << j;
+    }
+  }
+}
+
 static BinaryImage rotate0(const BinaryImage& src, const QRect& src_rect) {
   if (src_rect == src.rect()) {
     return src;
@@ -36,6 +80,35 @@ static BinaryImage rotate0(const BinaryImage& src, const QRect& src_rect) {
   return dst;
 }
 
+/**
+ * The bit-by-bit loop the tiled implementations below fall back to
+ * for the edge regions not covered by whole 32x32 tiles.
+ */
+static void rotate90Scalar(const BinaryImage& src,
+                           const QRect& src_rect,
+                           BinaryImage& dst,
+                           const int dst_y_begin,
+                           const int dst_y_end,
+                           const int dst_x_begin,
+                           const int dst_x_end) {
+  const int src_wpl = src.wordsPerLine();
+  const int dst_wpl = dst.wordsPerLine();
+  const uint32_t* const src_data = src.data();
+  uint32_t* dst_line = dst.data() + dst_y_begin * dst_wpl;
+
+  for (int dst_y = dst_y_begin; dst_y < dst_y_end; ++dst_y, dst_line += dst_wpl) {
+    const int src_x = src_rect.left() + dst_y;
+    const uint32_t* src_pword = src_data + (src_rect.bottom() - dst_x_begin) * src_wpl + src_x / 32;
+    const uint32_t src_mask = mask(src_x);
+
+    for (int dst_x = dst_x_begin; dst_x < dst_x_end; ++dst_x, src_pword -= src_wpl) {
+      if (*src_pword & src_mask) {
+        dst_line[dst_x / 32] |= mask(dst_x);
+      }
+    }
+  }
+}
+
 static BinaryImage rotate90(const BinaryImage& src, const QRect& src_rect) {
   const int dst_w = src_rect.height();
   const int dst_h = src_rect.width();
@@ -43,8 +116,9 @@ static BinaryImage rotate90(const BinaryImage& src, const QRect& src_rect) {
   dst.fill(WHITE);
   const int src_wpl = src.wordsPerLine();
   const int dst_wpl = dst.wordsPerLine();
-  const uint32_t* const src_data = src.data() + src_rect.bottom() * src_wpl;
-  uint32_t* dst_line = dst.data();
+  const uint32_t* const src_data = src.data();
+  uint32_t* const dst_data = dst.data();
+  const int last_src_word = src_wpl - 1;
 
   /*
    *   dst
@@ -54,22 +128,69 @@ static BinaryImage rotate90(const BinaryImage& src, const QRect& src_rect) {
    * |
    */
 
-  for (int dst_y = 0; dst_y < dst_h; ++dst_y) {
-    const int src_x = src_rect.left() + dst_y;
-    const uint32_t* src_pword = src_data + src_x / 32;
-    const uint32_t src_mask = mask(src_x);
+  // A 32x32 tile of dst bits is a 32x32 tile of src bits transposed.
+  // Gathering the source rows bottom to top takes care of the flip.
+  const int full_tiles_x = dst_w >> 5;
+  const int full_tiles_y = dst_h >> 5;
 
-    for (int dst_x = 0; dst_x < dst_w; ++dst_x) {
-      if (*src_pword & src_mask) {
+  parallelForChunked(
+      0, full_tiles_y,
+      [&](const int ty_begin, const int ty_end) {
+        uint32_t tile[32];
+
+        for (int ty = ty_begin; ty < ty_end; ++ty) {
+          const int dst_y0 = ty << 5;
+          const int src_x0 = src_rect.left() + dst_y0;
+
+          for (int tx = 0; tx < full_tiles_x; ++tx) {
+            const int dst_x0 = tx << 5;
+
+            const uint32_t* src_line = src_data + (src_rect.bottom() - dst_x0) * src_wpl;
+            for (int k = 0; k < 32; ++k, src_line -= src_wpl) {
+              tile[k] = window32(src_line, src_x0, last_src_word);
+            }
+
+            transpose32(tile);
+
+            uint32_t* dst_pword = dst_data + dst_y0 * dst_wpl + tx;
+            for (int j = 0; j < 32; ++j, dst_pword += dst_wpl) {
+              *dst_pword = tile[j];
+            }
+          }
+        }
+      },
+      rotationMaxThreads(src_rect));
+
+  // The strip to the right of the whole tiles and the one below them.
+  rotate90Scalar(src, src_rect, dst, 0, full_tiles_y << 5, full_tiles_x << 5, dst_w);
+  rotate90Scalar(src, src_rect, dst, full_tiles_y << 5, dst_h, 0, dst_w);
+
+  return dst;
+}
+
+static void rotate180Scalar(const BinaryImage& src,
+                            const QRect& src_rect,
+                            BinaryImage& dst,
+                            const int dst_y_begin,
+                            const int dst_y_end,
+                            const int dst_x_begin,
+                            const int dst_x_end) {
+  const int src_wpl = src.wordsPerLine();
+  const int dst_wpl = dst.wordsPerLine();
+  const uint32_t* src_line = src.data() + (src_rect.bottom() - dst_y_begin) * src_wpl;
+  uint32_t* dst_line = dst.data() + dst_y_begin * dst_wpl;
+
+  for (int dst_y = dst_y_begin; dst_y < dst_y_end; ++dst_y) {
+    int src_x = src_rect.right() - dst_x_begin;
+    for (int dst_x = dst_x_begin; dst_x < dst_x_end; --src_x, ++dst_x) {
+      if (src_line[src_x / 32] & mask(src_x)) {
         dst_line[dst_x / 32] |= mask(dst_x);
       }
-      src_pword -= src_wpl;
     }
 
+    src_line -= src_wpl;
     dst_line += dst_wpl;
   }
-
-  return dst;
 }
 
 static BinaryImage rotate180(const BinaryImage& src, const QRect& src_rect) {
@@ -79,8 +200,9 @@ static BinaryImage rotate180(const BinaryImage& src, const QRect& src_rect) {
   dst.fill(WHITE);
   const int src_wpl = src.wordsPerLine();
   const int dst_wpl = dst.wordsPerLine();
-  const uint32_t* src_line = src.data() + src_rect.bottom() * src_wpl;
-  uint32_t* dst_line = dst.data();
+  const uint32_t* const src_data = src.data();
+  uint32_t* const dst_data = dst.data();
+  const int last_src_word = src_wpl - 1;
 
   /*
    *  dst
@@ -89,19 +211,55 @@ static BinaryImage rotate180(const BinaryImage& src, const QRect& src_rect) {
    *  src
    */
 
-  for (int dst_y = 0; dst_y < dst_h; ++dst_y) {
-    int src_x = src_rect.right();
-    for (int dst_x = 0; dst_x < dst_w; --src_x, ++dst_x) {
-      if (src_line[src_x / 32] & mask(src_x)) {
+  // A whole dst word is a bit-reversed 32-bit window of the source
+  // row, read right to left.
+  const int full_words = dst_w >> 5;
+
+  parallelForChunked(
+      0, dst_h,
+      [&](const int y_begin, const int y_end) {
+        const uint32_t* src_line = src_data + (src_rect.bottom() - y_begin) * src_wpl;
+        uint32_t* dst_line = dst_data + y_begin * dst_wpl;
+
+        for (int dst_y = y_begin; dst_y < y_end; ++dst_y) {
+          for (int i = 0; i < full_words; ++i) {
+            dst_line[i] = reverseBits(window32(src_line, src_rect.right() - (i << 5) - 31, last_src_word));
+          }
+
+          src_line -= src_wpl;
+          dst_line += dst_wpl;
+        }
+      },
+      rotationMaxThreads(src_rect));
+
+  rotate180Scalar(src, src_rect, dst, 0, dst_h, full_words << 5, dst_w);
+
+  return dst;
+}
+
+static void rotate270Scalar(const BinaryImage& src,
+                            const QRect& src_rect,
+                            BinaryImage& dst,
+                            const int dst_y_begin,
+                            const int dst_y_end,
+                            const int dst_x_begin,
+                            const int dst_x_end) {
+  const int src_wpl = src.wordsPerLine();
+  const int dst_wpl = dst.wordsPerLine();
+  const uint32_t* const src_data = src.data();
+  uint32_t* dst_line = dst.data() + dst_y_begin * dst_wpl;
+
+  for (int dst_y = dst_y_begin; dst_y < dst_y_end; ++dst_y, dst_line += dst_wpl) {
+    const int src_x = src_rect.right() - dst_y;
+    const uint32_t* src_pword = src_data + (src_rect.top() + dst_x_begin) * src_wpl + src_x / 32;
+    const uint32_t src_mask = mask(src_x);
+
+    for (int dst_x = dst_x_begin; dst_x < dst_x_end; ++dst_x, src_pword += src_wpl) {
+      if (*src_pword & src_mask) {
         dst_line[dst_x / 32] |= mask(dst_x);
       }
     }
-
-    src_line -= src_wpl;
-    dst_line += dst_wpl;
   }
-
-  return dst;
 }
 
 static BinaryImage rotate270(const BinaryImage& src, const QRect& src_rect) {
@@ -111,8 +269,9 @@ static BinaryImage rotate270(const BinaryImage& src, const QRect& src_rect) {
   dst.fill(WHITE);
   const int src_wpl = src.wordsPerLine();
   const int dst_wpl = dst.wordsPerLine();
-  const uint32_t* const src_data = src.data() + src_rect.top() * src_wpl;
-  uint32_t* dst_line = dst.data();
+  const uint32_t* const src_data = src.data();
+  uint32_t* const dst_data = dst.data();
+  const int last_src_word = src_wpl - 1;
 
   /*
    *  dst
@@ -122,20 +281,41 @@ static BinaryImage rotate270(const BinaryImage& src, const QRect& src_rect) {
    *       v
    */
 
-  for (int dst_y = 0; dst_y < dst_h; ++dst_y) {
-    const int src_x = src_rect.right() - dst_y;
-    const uint32_t* src_pword = src_data + src_x / 32;
-    const uint32_t src_mask = mask(src_x);
+  // Same tiling as rotate90(), except the rows are gathered top to
+  // bottom and the transposed tile comes out upside down.
+  const int full_tiles_x = dst_w >> 5;
+  const int full_tiles_y = dst_h >> 5;
 
-    for (int dst_x = 0; dst_x < dst_w; ++dst_x) {
-      if (*src_pword & src_mask) {
-        dst_line[dst_x / 32] |= mask(dst_x);
-      }
-      src_pword += src_wpl;
-    }
+  parallelForChunked(
+      0, full_tiles_y,
+      [&](const int ty_begin, const int ty_end) {
+        uint32_t tile[32];
 
-    dst_line += dst_wpl;
-  }
+        for (int ty = ty_begin; ty < ty_end; ++ty) {
+          const int dst_y0 = ty << 5;
+          const int src_x0 = src_rect.right() - dst_y0 - 31;
+
+          for (int tx = 0; tx < full_tiles_x; ++tx) {
+            const int dst_x0 = tx << 5;
+
+            const uint32_t* src_line = src_data + (src_rect.top() + dst_x0) * src_wpl;
+            for (int k = 0; k < 32; ++k, src_line += src_wpl) {
+              tile[k] = window32(src_line, src_x0, last_src_word);
+            }
+
+            transpose32(tile);
+
+            uint32_t* dst_pword = dst_data + dst_y0 * dst_wpl + tx;
+            for (int j = 0; j < 32; ++j, dst_pword += dst_wpl) {
+              *dst_pword = tile[31 - j];
+            }
+          }
+        }
+      },
+      rotationMaxThreads(src_rect));
+
+  rotate270Scalar(src, src_rect, dst, 0, full_tiles_y << 5, full_tiles_x << 5, dst_w);
+  rotate270Scalar(src, src_rect, dst, full_tiles_y << 5, dst_h, 0, dst_w);
 
   return dst;
 }
@@ -169,4 +349,4 @@ BinaryImage orthogonalRotation(const BinaryImage& src, const QRect& src_rect, co
 BinaryImage orthogonalRotation(const BinaryImage& src, const int degrees) {
   return orthogonalRotation(src, src.rect(), degrees);
 }
-}  // namespace imageproc
\ No newline at end of file
+}  // namespace imageproc
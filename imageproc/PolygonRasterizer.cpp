@@ -18,12 +18,14 @@
 
 #include "PolygonRasterizer.h"
 #include <QImage>
+#include <algorithm>
 #include <QPainterPath>
 #include <QPolygonF>
 #include <boost/foreach.hpp>
 #include <cassert>
 #include "BinaryImage.h"
 #include "PolygonUtils.h"
+#include "RleMask.h"
 
 namespace imageproc {
 /**
@@ -33,7 +35,7 @@ class PolygonRasterizer::Edge {
  public:
   Edge(const QPointF& top, const QPointF& bottom, int vert_direction);
 
-  Edge(const QPointF& from, const QPointF& to);
+  Edge(int poly_index, const QPointF& from, const QPointF& to);
 
   const QPointF& top() const { return m_top; }
 
@@ -47,12 +49,15 @@ class PolygonRasterizer::Edge {
 
   int vertDirection() const { return m_vertDirection; }
 
+  int polyIndex() const { return m_polyIndex; }
+
  private:
   QPointF m_top;
   QPointF m_bottom;
   double m_deltaX;
   double m_reDeltaY;
   int m_vertDirection;  // 1: down, -1: up
+  int m_polyIndex;      // which polygon of a batch the edge belongs to
 };
 
 
@@ -95,7 +100,17 @@ class PolygonRasterizer::EdgeOrderY {
 
 class PolygonRasterizer::EdgeOrderX {
  public:
-  bool operator()(const EdgeComponent& lhs, const EdgeComponent& rhs) const { return lhs.x() < rhs.x(); }
+  // Grouping by polygon comes first, so that each polygon of a batch
+  // can be processed separately within a scanline.
+  bool operator()(const EdgeComponent& lhs, const EdgeComponent& rhs) const {
+    const int lhs_poly = lhs.edge().polyIndex();
+    const int rhs_poly = rhs.edge().polyIndex();
+    if (lhs_poly != rhs_poly) {
+      return lhs_poly < rhs_poly;
+    }
+
+    return lhs.x() < rhs.x();
+  }
 };
 
 
@@ -103,13 +118,33 @@ class PolygonRasterizer::Rasterizer {
  public:
   Rasterizer(const QRect& image_rect, const QPolygonF& poly, Qt::FillRule fill_rule, bool invert);
 
+  /** Batch version: the polygons rasterize as if filled one by one in order. */
+  Rasterizer(const QRect& image_rect, const std::vector<QPolygonF>& polys, Qt::FillRule fill_rule);
+
   void fillBinary(BinaryImage& image, BWColor color) const;
 
+  void fillBinary(BinaryImage& image, const std::vector<BWColor>& colors) const;
+
   void fillGrayscale(QImage& image, uint8_t color) const;
 
+  void fillGrayscale(QImage& image, const std::vector<uint8_t>& colors) const;
+
+  void fillRgb32(QImage& image, const std::vector<uint32_t>& colors) const;
+
+  void fillRle(RleMask& mask) const;
+
  private:
   void prepareEdges();
 
+  /**
+   * Sweeps an active edge table down the bounding box, calling
+   * \code process_line(y, edges, num_edges) \endcode for every
+   * scanline and polygon with the polygon's edge crossings sorted
+   * by x.  Polygons of a batch come in their original order.
+   */
+  template <typename LineProcessor>
+  void sweepLines(LineProcessor process_line) const;
+
   static void oddEvenLineBinary(const EdgeComponent* edges, int num_edges, uint32_t* line, uint32_t pattern);
 
   static void oddEvenLineGrayscale(const EdgeComponent* edges, int num_edges, uint8_t* line, uint8_t color);
@@ -126,12 +161,20 @@ class PolygonRasterizer::Rasterizer {
                                    uint8_t color,
                                    bool invert);
 
+  static void oddEvenLineRgb32(const EdgeComponent* edges, int num_edges, uint32_t* line, uint32_t color);
+
+  static void windingLineRgb32(const EdgeComponent* edges, int num_edges, uint32_t* line, uint32_t color, bool invert);
+
+  static void oddEvenLineRle(const EdgeComponent* edges, int num_edges, RleMask& mask, int y);
+
+  static void windingLineRle(const EdgeComponent* edges, int num_edges, RleMask& mask, int y, bool invert);
+
   static void fillBinarySegment(int x_from, int x_to, uint32_t* line, uint32_t pattern);
 
   std::vector<Edge> m_edges;  // m_edgeComponents references m_edges.
   std::vector<EdgeComponent> m_edgeComponents;
   QRect m_imageRect;
-  QPolygonF m_fillPoly;
+  std::vector<QPolygonF> m_fillPolys;
   QRectF m_boundingBox;
   Qt::FillRule m_fillRule;
   bool m_invert;
@@ -152,6 +195,69 @@ void PolygonRasterizer::fill(BinaryImage& image,
   rasterizer.fillBinary(image, color);
 }
 
+void PolygonRasterizer::fill(BinaryImage& image,
+                             const std::vector<std::pair<QPolygonF, BWColor>>& polys,
+                             const Qt::FillRule fill_rule) {
+  if (image.isNull()) {
+    throw std::invalid_argument("PolygonRasterizer: target image is null");
+  }
+  if (polys.empty()) {
+    return;
+  }
+
+  std::vector<QPolygonF> shapes;
+  std::vector<BWColor> colors;
+  shapes.reserve(polys.size());
+  colors.reserve(polys.size());
+  for (const auto& poly_and_color : polys) {
+    shapes.push_back(poly_and_color.first);
+    colors.push_back(poly_and_color.second);
+  }
+
+  Rasterizer rasterizer(image.rect(), shapes, fill_rule);
+  rasterizer.fillBinary(image, colors);
+}
+
+void PolygonRasterizer::fill(QImage& image,
+                             const std::vector<std::pair<QPolygonF, QRgb>>& polys,
+                             const Qt::FillRule fill_rule) {
+  if (image.isNull()) {
+    throw std::invalid_argument("PolygonRasterizer: target image is null");
+  }
+  if (polys.empty()) {
+    return;
+  }
+
+  std::vector<QPolygonF> shapes;
+  shapes.reserve(polys.size());
+  for (const auto& poly_and_color : polys) {
+    shapes.push_back(poly_and_color.first);
+  }
+
+  const QImage::Format format = image.format();
+  if ((format == QImage::Format_RGB32) || (format == QImage::Format_ARGB32)) {
+    std::vector<uint32_t> colors;
+    colors.reserve(polys.size());
+    for (const auto& poly_and_color : polys) {
+      colors.push_back(uint32_t(poly_and_color.second));
+    }
+
+    Rasterizer rasterizer(image.rect(), shapes, fill_rule);
+    rasterizer.fillRgb32(image, colors);
+  } else if ((format == QImage::Format_Indexed8) && image.isGrayscale()) {
+    std::vector<uint8_t> colors;
+    colors.reserve(polys.size());
+    for (const auto& poly_and_color : polys) {
+      colors.push_back(static_cast<uint8_t>(qGray(poly_and_color.second)));
+    }
+
+    Rasterizer rasterizer(image.rect(), shapes, fill_rule);
+    rasterizer.fillGrayscale(image, colors);
+  } else {
+    throw std::invalid_argument("PolygonRasterizer: unsupported target image format");
+  }
+}
+
 void PolygonRasterizer::fillExcept(BinaryImage& image,
                                    const BWColor color,
                                    const QPolygonF& poly,
@@ -164,6 +270,15 @@ void PolygonRasterizer::fillExcept(BinaryImage& image,
   rasterizer.fillBinary(image, color);
 }
 
+void PolygonRasterizer::fillRle(RleMask& mask, const QPolygonF& poly, const Qt::FillRule fill_rule) {
+  if (mask.isNull()) {
+    throw std::invalid_argument("PolygonRasterizer: target mask is null");
+  }
+
+  Rasterizer rasterizer(QRect(QPoint(0, 0), mask.size()), poly, fill_rule, false);
+  rasterizer.fillRle(mask);
+}
+
 void PolygonRasterizer::grayFill(QImage& image,
                                  const unsigned char color,
                                  const QPolygonF& poly,
@@ -201,9 +316,11 @@ PolygonRasterizer::Edge::Edge(const QPointF& top, const QPointF& bottom, const i
       m_bottom(bottom),
       m_deltaX(bottom.x() - top.x()),
       m_reDeltaY(1.0 / (bottom.y() - top.y())),
-      m_vertDirection(vert_direction) {}
+      m_vertDirection(vert_direction),
+      m_polyIndex(0) {}
 
-PolygonRasterizer::Edge::Edge(const QPointF& from, const QPointF& to) {
+PolygonRasterizer::Edge::Edge(const int poly_index, const QPointF& from, const QPointF& to)
+    : m_polyIndex(poly_index) {
   if (from.y() < to.y()) {
     m_vertDirection = 1;
     m_top = from;
@@ -239,34 +356,71 @@ PolygonRasterizer::Rasterizer::Rasterizer(const QRect& image_rect,
   path2.addPolygon(PolygonUtils::round(poly));
   path2.closeSubpath();
 
-  m_fillPoly = path1.intersected(path2).toFillPolygon();
+  m_fillPolys.push_back(path1.intersected(path2).toFillPolygon());
 
   if (invert) {
     m_boundingBox = path1.subtracted(path2).boundingRect();
   } else {
-    m_boundingBox = m_fillPoly.boundingRect();
+    m_boundingBox = m_fillPolys.back().boundingRect();
   }
 
   prepareEdges();
 }
 
-void PolygonRasterizer::Rasterizer::prepareEdges() {
-  const int num_verts = m_fillPoly.size();
-  if (num_verts == 0) {
-    return;
+PolygonRasterizer::Rasterizer::Rasterizer(const QRect& image_rect,
+                                          const std::vector<QPolygonF>& polys,
+                                          const Qt::FillRule fill_rule)
+    : m_imageRect(image_rect), m_fillRule(fill_rule), m_invert(false) {
+  QPainterPath path1;
+  path1.setFillRule(fill_rule);
+  path1.addRect(image_rect);
+
+  m_fillPolys.reserve(polys.size());
+  for (const QPolygonF& poly : polys) {
+    QPainterPath path2;
+    path2.setFillRule(fill_rule);
+    path2.addPolygon(PolygonUtils::round(poly));
+    path2.closeSubpath();
+
+    m_fillPolys.push_back(path1.intersected(path2).toFillPolygon());
+    m_boundingBox |= m_fillPolys.back().boundingRect();
   }
 
-  // Collect the edges, excluding horizontal and null ones.
-  m_edges.reserve(num_verts + 2);
-  for (int i = 0; i < num_verts - 1; ++i) {
-    const QPointF from(m_fillPoly[i]);
-    const QPointF to(m_fillPoly[i + 1]);
-    if (from.y() != to.y()) {
-      m_edges.emplace_back(from, to);
+  prepareEdges();
+}
+
+void PolygonRasterizer::Rasterizer::prepareEdges() {
+  // An ordered list of y coordinates of polygon vertexes.
+  std::vector<double> y_values;
+
+  for (size_t poly_idx = 0; poly_idx < m_fillPolys.size(); ++poly_idx) {
+    const QPolygonF& fill_poly = m_fillPolys[poly_idx];
+    const int num_verts = fill_poly.size();
+    if (num_verts == 0) {
+      continue;
+    }
+
+    // Collect the edges, excluding horizontal and null ones.
+    m_edges.reserve(m_edges.size() + num_verts + 2);
+    for (int i = 0; i < num_verts - 1; ++i) {
+      const QPointF from(fill_poly[i]);
+      const QPointF to(fill_poly[i + 1]);
+      if (from.y() != to.y()) {
+        m_edges.emplace_back(static_cast<int>(poly_idx), from, to);
+      }
+    }
+
+    assert(fill_poly.isClosed());
+
+    y_values.reserve(y_values.size() + num_verts + 2);
+    for (const QPointF& pt : fill_poly) {
+      y_values.push_back(pt.y());
     }
   }
 
-  assert(m_fillPoly.isClosed());
+  if (y_values.empty()) {
+    return;
+  }
 
   if (m_invert) {
     // Add left and right edges with neutral direction (0),
@@ -274,16 +428,7 @@ void PolygonRasterizer::Rasterizer::prepareEdges() {
     const QRectF rect(m_imageRect);
     m_edges.emplace_back(rect.topLeft(), rect.bottomLeft(), 0);
     m_edges.emplace_back(rect.topRight(), rect.bottomRight(), 0);
-  }
-
-  // Create an ordered list of y coordinates of polygon vertexes.
-  std::vector<double> y_values;
-  y_values.reserve(num_verts + 2);
-  for (const QPointF& pt : m_fillPoly) {
-    y_values.push_back(pt.y());
-  }
 
-  if (m_invert) {
     y_values.push_back(0.0);
     y_values.push_back(m_imageRect.height());
   }
@@ -311,84 +456,140 @@ void PolygonRasterizer::Rasterizer::prepareEdges() {
   std::sort(m_edgeComponents.begin(), m_edgeComponents.end(), EdgeOrderY());
 }  // PolygonRasterizer::Rasterizer::prepareEdges
 
-void PolygonRasterizer::Rasterizer::fillBinary(BinaryImage& image, const BWColor color) const {
-  std::vector<EdgeComponent> edges_for_line;
-  typedef std::vector<EdgeComponent>::const_iterator EdgeIter;
+template <typename LineProcessor>
+void PolygonRasterizer::Rasterizer::sweepLines(LineProcessor process_line) const {
+  // The active edge table: components crossing the current scanline,
+  // kept as copies so their x members can be updated per line.
+  std::vector<EdgeComponent> active;
 
-  uint32_t* line = image.data();
-  const int wpl = image.wordsPerLine();
-  const uint32_t pattern = (color == WHITE) ? 0 : ~uint32_t(0);
+  const size_t num_components = m_edgeComponents.size();
+  size_t enter_pos = 0;
 
-  int i = qRound(m_boundingBox.top());
-  line += i * wpl;
   const int limit = qRound(m_boundingBox.bottom());
-  for (; i < limit; ++i, line += wpl, edges_for_line.clear()) {
+  for (int i = qRound(m_boundingBox.top()); i < limit; ++i) {
     const double y = i + 0.5;
 
-    // Get edges intersecting this horizontal line.
-    const std::pair<EdgeIter, EdgeIter> range(
-        std::equal_range(m_edgeComponents.begin(), m_edgeComponents.end(), y, EdgeOrderY()));
+    // Retire the components the scanline has passed ...
+    active.erase(std::remove_if(active.begin(), active.end(),
+                                [y](const EdgeComponent& ecomp) { return ecomp.bottom() <= y; }),
+                 active.end());
+
+    // ... and admit the ones it has reached.  m_edgeComponents is
+    // sorted by top, so the candidates form a contiguous run.
+    for (; enter_pos < num_components && m_edgeComponents[enter_pos].top() <= y; ++enter_pos) {
+      const EdgeComponent& ecomp = m_edgeComponents[enter_pos];
+      if (ecomp.bottom() > y) {
+        active.push_back(ecomp);
+      }
+    }
 
-    if (range.first == range.second) {
+    if (active.empty()) {
       continue;
     }
 
-    std::copy(range.first, range.second, std::back_inserter(edges_for_line));
-
     // Calculate the intersection point of each edge with
     // the current horizontal line.
-    for (EdgeComponent& ecomp : edges_for_line) {
+    for (EdgeComponent& ecomp : active) {
       ecomp.setX(ecomp.edge().xForY(y));
     }
-    // Sort edge components by the x value of the intersection point.
-    std::sort(edges_for_line.begin(), edges_for_line.end(), EdgeOrderX());
+    // Sort edge components by polygon, then by the x value
+    // of the intersection point.
+    std::sort(active.begin(), active.end(), EdgeOrderX());
+
+    // Process each polygon of a batch separately and in order, so that
+    // overlapping polygons compose the same way sequential fills would.
+    const auto num_active = static_cast<int>(active.size());
+    int begin = 0;
+    while (begin < num_active) {
+      const int poly_index = active[begin].edge().polyIndex();
+      int end = begin + 1;
+      while (end < num_active && active[end].edge().polyIndex() == poly_index) {
+        ++end;
+      }
+      process_line(i, &active[begin], end - begin);
+      begin = end;
+    }
+  }
+}  // PolygonRasterizer::Rasterizer::sweepLines
+
+void PolygonRasterizer::Rasterizer::fillBinary(BinaryImage& image, const BWColor color) const {
+  fillBinary(image, std::vector<BWColor>(m_fillPolys.size(), color));
+}
+
+void PolygonRasterizer::Rasterizer::fillBinary(BinaryImage& image, const std::vector<BWColor>& colors) const {
+  std::vector<uint32_t> patterns;
+  patterns.reserve(colors.size());
+  for (const BWColor color : colors) {
+    patterns.push_back((color == WHITE) ? 0 : ~uint32_t(0));
+  }
 
+  uint32_t* const data = image.data();
+  const int wpl = image.wordsPerLine();
+
+  sweepLines([&](const int i, const EdgeComponent* edges, const int num_edges) {
+    uint32_t* const line = data + i * wpl;
+    const uint32_t pattern = patterns[edges->edge().polyIndex()];
     if (m_fillRule == Qt::OddEvenFill) {
-      oddEvenLineBinary(&edges_for_line.front(), static_cast<int>(edges_for_line.size()), line, pattern);
+      oddEvenLineBinary(edges, num_edges, line, pattern);
     } else {
-      windingLineBinary(&edges_for_line.front(), static_cast<int>(edges_for_line.size()), line, pattern, m_invert);
+      windingLineBinary(edges, num_edges, line, pattern, m_invert);
     }
-  }
+  });
 }  // PolygonRasterizer::Rasterizer::fillBinary
 
 void PolygonRasterizer::Rasterizer::fillGrayscale(QImage& image, const uint8_t color) const {
-  std::vector<EdgeComponent> edges_for_line;
-  typedef std::vector<EdgeComponent>::const_iterator EdgeIter;
-
-  uint8_t* line = image.bits();
+  uint8_t* const data = image.bits();
   const int bpl = image.bytesPerLine();
 
-  int i = qRound(m_boundingBox.top());
-  line += i * bpl;
-  const int limit = qRound(m_boundingBox.bottom());
-  for (; i < limit; ++i, line += bpl, edges_for_line.clear()) {
-    const double y = i + 0.5;
+  sweepLines([&](const int i, const EdgeComponent* edges, const int num_edges) {
+    uint8_t* const line = data + i * bpl;
+    if (m_fillRule == Qt::OddEvenFill) {
+      oddEvenLineGrayscale(edges, num_edges, line, color);
+    } else {
+      windingLineGrayscale(edges, num_edges, line, color, m_invert);
+    }
+  });
+}  // PolygonRasterizer::Rasterizer::fillGrayscale
 
-    // Get edges intersecting this horizontal line.
-    const std::pair<EdgeIter, EdgeIter> range(
-        std::equal_range(m_edgeComponents.begin(), m_edgeComponents.end(), y, EdgeOrderY()));
+void PolygonRasterizer::Rasterizer::fillGrayscale(QImage& image, const std::vector<uint8_t>& colors) const {
+  uint8_t* const data = image.bits();
+  const int bpl = image.bytesPerLine();
 
-    if (range.first == range.second) {
-      continue;
+  sweepLines([&](const int i, const EdgeComponent* edges, const int num_edges) {
+    uint8_t* const line = data + i * bpl;
+    const uint8_t color = colors[edges->edge().polyIndex()];
+    if (m_fillRule == Qt::OddEvenFill) {
+      oddEvenLineGrayscale(edges, num_edges, line, color);
+    } else {
+      windingLineGrayscale(edges, num_edges, line, color, m_invert);
     }
+  });
+}
 
-    std::copy(range.first, range.second, std::back_inserter(edges_for_line));
+void PolygonRasterizer::Rasterizer::fillRgb32(QImage& image, const std::vector<uint32_t>& colors) const {
+  auto* const data = (uint32_t*) image.bits();
+  const int stride = image.bytesPerLine() / 4;
 
-    // Calculate the intersection point of each edge with
-    // the current horizontal line.
-    for (EdgeComponent& ecomp : edges_for_line) {
-      ecomp.setX(ecomp.edge().xForY(y));
+  sweepLines([&](const int i, const EdgeComponent* edges, const int num_edges) {
+    uint32_t* const line = data + i * stride;
+    const uint32_t color = colors[edges->edge().polyIndex()];
+    if (m_fillRule == Qt::OddEvenFill) {
+      oddEvenLineRgb32(edges, num_edges, line, color);
+    } else {
+      windingLineRgb32(edges, num_edges, line, color, m_invert);
     }
-    // Sort edge components by the x value of the intersection point.
-    std::sort(edges_for_line.begin(), edges_for_line.end(), EdgeOrderX());
+  });
+}
 
+void PolygonRasterizer::Rasterizer::fillRle(RleMask& mask) const {
+  sweepLines([&](const int i, const EdgeComponent* edges, const int num_edges) {
     if (m_fillRule == Qt::OddEvenFill) {
-      oddEvenLineGrayscale(&edges_for_line.front(), static_cast<int>(edges_for_line.size()), line, color);
+      oddEvenLineRle(edges, num_edges, mask, i);
     } else {
-      windingLineGrayscale(&edges_for_line.front(), static_cast<int>(edges_for_line.size()), line, color, m_invert);
+      windingLineRle(edges, num_edges, mask, i, m_invert);
     }
-  }
-}  // PolygonRasterizer::Rasterizer::fillGrayscale
+  });
+}  // PolygonRasterizer::Rasterizer::fillRle
 
 void PolygonRasterizer::Rasterizer::oddEvenLineBinary(const EdgeComponent* const edges,
                                                       const int num_edges,
@@ -444,6 +645,56 @@ void PolygonRasterizer::Rasterizer::windingLineGrayscale(const EdgeComponent* co
   }
 }
 
+void PolygonRasterizer::Rasterizer::oddEvenLineRgb32(const EdgeComponent* const edges,
+                                                     const int num_edges,
+                                                     uint32_t* const line,
+                                                     const uint32_t color) {
+  for (int i = 0; i < num_edges - 1; i += 2) {
+    const int from = qRound(edges[i].x());
+    const int to = qRound(edges[i + 1].x());
+    std::fill(line + from, line + to, color);
+  }
+}
+
+void PolygonRasterizer::Rasterizer::windingLineRgb32(const EdgeComponent* const edges,
+                                                     const int num_edges,
+                                                     uint32_t* const line,
+                                                     const uint32_t color,
+                                                     const bool invert) {
+  int dir_sum = 0;
+  for (int i = 0; i < num_edges - 1; ++i) {
+    dir_sum += edges[i].edge().vertDirection();
+    if ((dir_sum == 0) == invert) {
+      const int from = qRound(edges[i].x());
+      const int to = qRound(edges[i + 1].x());
+      std::fill(line + from, line + to, color);
+    }
+  }
+}
+
+void PolygonRasterizer::Rasterizer::oddEvenLineRle(const EdgeComponent* const edges,
+                                                   const int num_edges,
+                                                   RleMask& mask,
+                                                   const int y) {
+  for (int i = 0; i < num_edges - 1; i += 2) {
+    mask.addRun(y, qRound(edges[i].x()), qRound(edges[i + 1].x()));
+  }
+}
+
+void PolygonRasterizer::Rasterizer::windingLineRle(const EdgeComponent* const edges,
+                                                   const int num_edges,
+                                                   RleMask& mask,
+                                                   const int y,
+                                                   const bool invert) {
+  int dir_sum = 0;
+  for (int i = 0; i < num_edges - 1; ++i) {
+    dir_sum += edges[i].edge().vertDirection();
+    if ((dir_sum == 0) == invert) {
+      mask.addRun(y, qRound(edges[i].x()), qRound(edges[i + 1].x()));
+    }
+  }
+}
+
 void PolygonRasterizer::Rasterizer::fillBinarySegment(const int x_from,
                                                       const int x_to,
                                                       uint32_t* const line,
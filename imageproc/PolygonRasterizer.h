@@ -19,22 +19,57 @@
 #ifndef IMAGEPROC_POLYGONRASTERIZER_H_
 #define IMAGEPROC_POLYGONRASTERIZER_H_
 
+#include <QPolygonF>
+#include <QRgb>
 #include <Qt>
+#include <utility>
+#include <vector>
 #include "BWColor.h"
 
-class QPolygonF;
 class QRectF;
 class QImage;
 
 namespace imageproc {
 class BinaryImage;
+class RleMask;
 
 class PolygonRasterizer {
  public:
   static void fill(BinaryImage& image, BWColor color, const QPolygonF& poly, Qt::FillRule fill_rule);
 
+  /**
+   * \brief Fills a batch of polygons in a single scanline sweep.
+   *
+   * Equivalent to calling fill() once per polygon in order, but the
+   * edges of all polygons share one active edge table, so the image
+   * is traversed once rather than once per polygon.
+   */
+  static void fill(BinaryImage& image, const std::vector<std::pair<QPolygonF, BWColor>>& polys, Qt::FillRule fill_rule);
+
+  /**
+   * \brief Fills a batch of polygons directly on the image planes.
+   *
+   * The counterpart of the BinaryImage batch overload for RGB32 /
+   * ARGB32 and grayscale Indexed8 images: every scanline span is
+   * written with a word fill or memset() on the target rows, with no
+   * intermediate format conversions.  For Indexed8, the color is
+   * converted with qGray().  Edges come out hard, as with the
+   * BinaryImage overloads.  Other image formats are rejected with
+   * std::invalid_argument.
+   */
+  static void fill(QImage& image, const std::vector<std::pair<QPolygonF, QRgb>>& polys, Qt::FillRule fill_rule);
+
   static void fillExcept(BinaryImage& image, BWColor color, const QPolygonF& poly, Qt::FillRule fill_rule);
 
+  /**
+   * \brief Adds the polygon interior to an RLE mask as black runs.
+   *
+   * Unlike fill(), nothing is cleared first: the runs merge into
+   * whatever the mask already contains, so successive calls compose
+   * the way successive BLACK fills into a BinaryImage would.
+   */
+  static void fillRle(RleMask& mask, const QPolygonF& poly, Qt::FillRule fill_rule);
+
   static void grayFill(QImage& image, unsigned char color, const QPolygonF& poly, Qt::FillRule fill_rule);
 
   static void grayFillExcept(QImage& image, unsigned char color, const QPolygonF& poly, Qt::FillRule fill_rule);
@@ -19,6 +19,7 @@
 #include "PolygonUtils.h"
 #include <QLineF>
 #include <QPolygonF>
+#include <QRectF>
 #include <cassert>
 #include <cmath>
 
@@ -179,6 +180,85 @@ struct LexicographicPointComparator {
 double cross(const QPointF& O, const QPointF& A, const QPointF& B) {
   return (A.x() - O.x()) * (B.y() - O.y()) - (A.y() - O.y()) * (B.x() - O.x());
 }
+
+int signOf(const double val) {
+  return val < 0.0 ? -1 : (val > 0.0 ? 1 : 0);
+}
+
+/**
+ * Returns true if the polygon (without a closing vertex) is convex and
+ * winds around its interior exactly once.  Consistent turn direction
+ * alone would also accept a polygon winding around twice, so the edge
+ * directions are additionally required to rotate through each
+ * half-plane only once: over one loop, the signs of the edge dx and dy
+ * components may each change at most twice.
+ */
+bool isConvex(const QPolygonF& poly) {
+  const int n = poly.size();
+  int turn_sign = 0;
+  int dx_sign = 0, dy_sign = 0;
+  int dx_flips = 0, dy_flips = 0;
+
+  for (int i = 0; i < n; ++i) {
+    const QPointF& a = poly[i];
+    const QPointF& b = poly[(i + 1) % n];
+    const QPointF& c = poly[(i + 2) % n];
+
+    const int sign = signOf(cross(a, b, c));
+    if (sign != 0) {
+      if (turn_sign == 0) {
+        turn_sign = sign;
+      } else if (sign != turn_sign) {
+        return false;
+      }
+    }
+
+    const int new_dx_sign = signOf(b.x() - a.x());
+    if ((new_dx_sign != 0) && (new_dx_sign != dx_sign)) {
+      if (dx_sign != 0 && ++dx_flips > 2) {
+        return false;
+      }
+      dx_sign = new_dx_sign;
+    }
+    const int new_dy_sign = signOf(b.y() - a.y());
+    if ((new_dy_sign != 0) && (new_dy_sign != dy_sign)) {
+      if (dy_sign != 0 && ++dy_flips > 2) {
+        return false;
+      }
+      dy_sign = new_dy_sign;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Clips the polygon against one half-plane.  \p inside decides whether
+ * a vertex is kept and \p intersect projects an edge endpoint onto the
+ * boundary; both only look at one coordinate, the boundary being
+ * axis-aligned.
+ */
+template <typename InsidePred, typename IntersectFunc>
+void clipAgainstBoundary(QPolygonF& poly, QPolygonF& scratch, InsidePred inside, IntersectFunc intersect) {
+  scratch.clear();
+
+  const int n = poly.size();
+  for (int i = 0; i < n; ++i) {
+    const QPointF& cur = poly[i];
+    const QPointF& next = poly[(i + 1) % n];
+    const bool cur_inside = inside(cur);
+    const bool next_inside = inside(next);
+
+    if (cur_inside) {
+      scratch.push_back(cur);
+    }
+    if (cur_inside != next_inside) {
+      scratch.push_back(intersect(cur, next));
+    }
+  }
+
+  poly.swap(scratch);
+}
 }  // anonymous namespace
 
 QPolygonF PolygonUtils::convexHull(std::vector<QPointF> point_cloud) {
@@ -216,4 +296,53 @@ QPolygonF PolygonUtils::convexHull(std::vector<QPointF> point_cloud) {
 
   return poly;
 }
+
+QPolygonF PolygonUtils::clipToRect(const QPolygonF& poly, const QRectF& rect) {
+  QPolygonF subject(poly);
+  if (!subject.empty() && (subject.back() == subject.front())) {
+    subject.pop_back();  // Drop the closing vertex for the duration of clipping.
+  }
+  if (subject.size() < 3) {
+    return QPolygonF();
+  }
+
+  if (!isConvex(subject)) {
+    return poly.intersected(QPolygonF(rect));
+  }
+
+  QPolygonF scratch;
+  scratch.reserve(subject.size() + 4);
+
+  const double left = rect.left();
+  const double right = rect.right();
+  const double top = rect.top();
+  const double bottom = rect.bottom();
+
+  const auto at_x = [](const QPointF& a, const QPointF& b, double x) {
+    const double t = (x - a.x()) / (b.x() - a.x());
+    return QPointF(x, a.y() + t * (b.y() - a.y()));
+  };
+  const auto at_y = [](const QPointF& a, const QPointF& b, double y) {
+    const double t = (y - a.y()) / (b.y() - a.y());
+    return QPointF(a.x() + t * (b.x() - a.x()), y);
+  };
+
+  clipAgainstBoundary(subject, scratch, [left](const QPointF& p) { return p.x() >= left; },
+                      [&at_x, left](const QPointF& a, const QPointF& b) { return at_x(a, b, left); });
+  clipAgainstBoundary(subject, scratch, [right](const QPointF& p) { return p.x() <= right; },
+                      [&at_x, right](const QPointF& a, const QPointF& b) { return at_x(a, b, right); });
+  clipAgainstBoundary(subject, scratch, [top](const QPointF& p) { return p.y() >= top; },
+                      [&at_y, top](const QPointF& a, const QPointF& b) { return at_y(a, b, top); });
+  clipAgainstBoundary(subject, scratch, [bottom](const QPointF& p) { return p.y() <= bottom; },
+                      [&at_y, bottom](const QPointF& a, const QPointF& b) { return at_y(a, b, bottom); });
+
+  if (subject.size() < 3) {
+    return QPolygonF();
+  }
+
+  // Closed, the way QPolygonF::intersected() returns its result.
+  subject.push_back(subject.front());
+
+  return subject;
+}
 }  // namespace imageproc
\ No newline at end of file
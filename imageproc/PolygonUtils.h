@@ -24,6 +24,7 @@
 class QPolygonF;
 class QPointF;
 class QLineF;
+class QRectF;
 
 namespace imageproc {
 class PolygonUtils {
@@ -52,6 +53,22 @@ class PolygonUtils {
 
   static QPolygonF convexHull(std::vector<QPointF> point_cloud);
 
+  /**
+   * \brief Intersects a polygon with an axis-aligned rectangle.
+   *
+   * For convex input this clips the vertices directly with the
+   * Sutherland-Hodgman algorithm, avoiding the QPainterPath boolean
+   * operations behind QPolygonF::intersected() and their allocations.
+   * The polygons clipped at rendering time are affinely mapped
+   * rectangles, so this is the path that's virtually always taken.
+   * Input that isn't verifiably convex falls back to
+   * QPolygonF::intersected().
+   *
+   * Like QPolygonF::intersected(), the returned polygon is closed.
+   * An empty intersection gives an empty polygon.
+   */
+  static QPolygonF clipToRect(const QPolygonF& poly, const QRectF& rect);
+
  private:
   class Before;
 
@@ -22,8 +22,11 @@
 #include <cassert>
 #include <cmath>
 #include <cstdint>
+#include <mutex>
 #include <stdexcept>
+#include <vector>
 #include "AlignedArray.h"
+#include "ParallelFor.h"
 #include "BinaryImage.h"
 #include "BitOps.h"
 #include "GrayImage.h"
@@ -68,7 +71,8 @@ PolynomialSurface::PolynomialSurface(const int hor_degree, const int vert_degree
 
   try {
     DynamicMatrixCalc<double> mc;
-    mc(AtA).solve(mc(Atb)).write(m_coeffs.data());
+    // A^T*A is symmetric positive definite, so the LDLT path applies.
+    mc(AtA).solvePosDef(mc(Atb)).write(m_coeffs.data());
   } catch (const std::runtime_error&) {
   }
 }
@@ -114,7 +118,8 @@ PolynomialSurface::PolynomialSurface(const int hor_degree,
 
   try {
     DynamicMatrixCalc<double> mc;
-    mc(AtA).solve(mc(Atb)).write(m_coeffs.data());
+    // A^T*A is symmetric positive definite, so the LDLT path applies.
+    mc(AtA).solvePosDef(mc(Atb)).write(m_coeffs.data());
   } catch (const std::runtime_error&) {
   }
 }
@@ -127,54 +132,66 @@ GrayImage PolynomialSurface::render(const QSize& size) const {
   GrayImage image(size);
   const int width = size.width();
   const int height = size.height();
-  unsigned char* line = image.data();
+  unsigned char* const image_data = image.data();
   const int bpl = image.stride();
-  const auto num_coeffs = static_cast<const int>(m_coeffs.size());
 
   // Pretend that both x and y positions of pixels
   // lie in range of [0, 1].
   const double xscale = calcScale(width);
   const double yscale = calcScale(height);
 
-  AlignedArray<float, 4> vert_matrix(num_coeffs * height);
-  float* out = &vert_matrix[0];
-  for (int y = 0; y < height; ++y) {
-    const double y_adjusted = y * yscale;
-    double pow = 1.0;
-    int pos = 0;
-    for (int i = 0; i <= m_vertDegree; ++i) {
-      for (int j = 0; j <= m_horDegree; ++j, ++pos, ++out) {
-        *out = static_cast<float>(m_coeffs[pos] * pow);
-      }
-      pow *= y_adjusted;
+  // Powers of x for every column, one contiguous row per exponent,
+  // so the evaluation below walks sequential memory.
+  AlignedArray<float, 4> x_powers((m_horDegree + 1) * width);
+  for (int x = 0; x < width; ++x) {
+    x_powers[x] = 1.0f;
+  }
+  for (int j = 1; j <= m_horDegree; ++j) {
+    const float* const prev = &x_powers[0] + (j - 1) * width;
+    float* const cur = &x_powers[0] + j * width;
+    for (int x = 0; x < width; ++x) {
+      cur[x] = prev[x] * static_cast<float>(x * xscale);
     }
   }
 
-  AlignedArray<float, 4> hor_matrix(num_coeffs * width);
-  out = &hor_matrix[0];
-  for (int x = 0; x < width; ++x) {
-    const double x_adjusted = x * xscale;
-    for (int i = 0; i <= m_vertDegree; ++i) {
+  // This is the only part of background estimation working at full
+  // resolution, so it's worth splitting across threads.  Within a row,
+  // the vertical terms are collapsed into a single 1D polynomial first,
+  // turning the per-pixel work into a handful of multiply-accumulate
+  // sweeps over contiguous arrays that vectorize well.
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    std::vector<double> row_poly(m_horDegree + 1);
+    std::vector<float> row_acc(width);
+
+    unsigned char* line = image_data + chunk_begin * bpl;
+    for (int y = chunk_begin; y < chunk_end; ++y, line += bpl) {
+      const double y_adjusted = y * yscale;
+
+      std::fill(row_poly.begin(), row_poly.end(), 0.0);
       double pow = 1.0;
-      for (int j = 0; j <= m_horDegree; ++j, ++out) {
-        *out = static_cast<float>(pow);
-        pow *= x_adjusted;
+      int pos = 0;
+      for (int i = 0; i <= m_vertDegree; ++i) {
+        for (int j = 0; j <= m_horDegree; ++j, ++pos) {
+          row_poly[j] += m_coeffs[pos] * pow;
+        }
+        pow *= y_adjusted;
       }
-    }
-  }
 
-  const float* vert_line = &vert_matrix[0];
-  for (int y = 0; y < height; ++y, line += bpl, vert_line += num_coeffs) {
-    const float* hor_line = &hor_matrix[0];
-    for (int x = 0; x < width; ++x, hor_line += num_coeffs) {
-      float sum = 0.5f / 255.0f;  // for rounding purposes.
-      for (int i = 0; i < num_coeffs; ++i) {
-        sum += hor_line[i] * vert_line[i];
+      std::fill(row_acc.begin(), row_acc.end(), 0.5f / 255.0f);  // for rounding purposes.
+      for (int j = 0; j <= m_horDegree; ++j) {
+        const auto coeff = static_cast<float>(row_poly[j]);
+        const float* const xp = &x_powers[0] + j * width;
+        for (int x = 0; x < width; ++x) {
+          row_acc[x] += coeff * xp[x];
+        }
+      }
+
+      for (int x = 0; x < width; ++x) {
+        const auto isum = (int) (row_acc[x] * 255.0);
+        line[x] = static_cast<unsigned char>(qBound(0, isum, 255));
       }
-      const auto isum = (int) (sum * 255.0);
-      line[x] = static_cast<unsigned char>(qBound(0, isum, 255));
     }
-  }
+  });
 
   return image;
 }  // PolynomialSurface::render
@@ -215,7 +232,7 @@ void PolynomialSurface::prepareDataForLeastSquares(const GrayImage& image,
   const int height = image.height();
   const auto num_terms = static_cast<const int>(Atb.size());
 
-  const uint8_t* line = image.data();
+  const uint8_t* const image_data = image.data();
   const int stride = image.stride();
 
   // Pretend that both x and y positions of pixels
@@ -226,11 +243,8 @@ void PolynomialSurface::prepareDataForLeastSquares(const GrayImage& image,
   // To force data samples into [0, 1] range.
   const double data_scale = 1.0 / 255.0;
 
-  // 1, y, y^2, y^3, ...
-  VecT<double> y_powers(v_degree + 1);  // Initialized to 0.
-
-  // Same as y_powers, except y_powers correspond to a given y,
-  // while x_powers are computed for all possible x values.
+  // Powers of x are the same for every line, so they are
+  // computed once and shared read-only between threads.
   MatT<double> x_powers(h_degree + 1, width);  // Initialized to 0.
   for (int x = 0; x < width; ++x) {
     const double x_adjusted = xscale * x;
@@ -241,40 +255,61 @@ void PolynomialSurface::prepareDataForLeastSquares(const GrayImage& image,
     }
   }
 
-  VecT<double> full_powers(num_terms);
+  // Each strip accumulates into its own A^T*A and A^T*b,
+  // merged by plain addition at the end.
+  std::mutex sums_mutex;
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    MatT<double> chunk_AtA(num_terms, num_terms);
+    VecT<double> chunk_Atb(num_terms);
+    double* const chunk_AtA_data = chunk_AtA.data();
+    double* const chunk_Atb_data = chunk_Atb.data();
 
-  for (int y = 0; y < height; ++y, line += stride) {
-    const double y_adjusted = yscale * y;
+    // 1, y, y^2, y^3, ...
+    VecT<double> y_powers(v_degree + 1);  // Initialized to 0.
+    VecT<double> full_powers(num_terms);
 
-    double y_power = 1.0;
-    for (int i = 0; i <= v_degree; ++i) {
-      y_powers[i] = y_power;
-      y_power *= y_adjusted;
-    }
+    const uint8_t* line = image_data + chunk_begin * stride;
+    for (int y = chunk_begin; y < chunk_end; ++y, line += stride) {
+      const double y_adjusted = yscale * y;
 
-    for (int x = 0; x < width; ++x) {
-      const double data_point = data_scale * line[x];
-
-      int pos = 0;
+      double y_power = 1.0;
       for (int i = 0; i <= v_degree; ++i) {
-        for (int j = 0; j <= h_degree; ++j, ++pos) {
-          full_powers[pos] = y_powers[i] * x_powers(j, x);
-        }
+        y_powers[i] = y_power;
+        y_power *= y_adjusted;
       }
 
-      double* p_AtA = AtA_data;
-      for (int i = 0; i < num_terms; ++i) {
-        const double i_val = full_powers[i];
-        Atb_data[i] += i_val * data_point;
+      for (int x = 0; x < width; ++x) {
+        const double data_point = data_scale * line[x];
+
+        int pos = 0;
+        for (int i = 0; i <= v_degree; ++i) {
+          for (int j = 0; j <= h_degree; ++j, ++pos) {
+            full_powers[pos] = y_powers[i] * x_powers(j, x);
+          }
+        }
+
+        double* p_AtA = chunk_AtA_data;
+        for (int i = 0; i < num_terms; ++i) {
+          const double i_val = full_powers[i];
+          chunk_Atb_data[i] += i_val * data_point;
 
-        for (int j = 0; j < num_terms; ++j) {
-          const double j_val = full_powers[j];
-          *p_AtA += i_val * j_val;
-          ++p_AtA;
+          for (int j = 0; j < num_terms; ++j) {
+            const double j_val = full_powers[j];
+            *p_AtA += i_val * j_val;
+            ++p_AtA;
+          }
         }
       }
     }
-  }
+
+    const std::lock_guard<std::mutex> guard(sums_mutex);
+    for (int i = 0; i < num_terms; ++i) {
+      Atb_data[i] += chunk_Atb_data[i];
+    }
+    for (int i = 0; i < num_terms * num_terms; ++i) {
+      AtA_data[i] += chunk_AtA_data[i];
+    }
+  });
 }  // PolynomialSurface::prepareDataForLeastSquares
 
 void PolynomialSurface::prepareDataForLeastSquares(const GrayImage& image,
@@ -290,10 +325,10 @@ void PolynomialSurface::prepareDataForLeastSquares(const GrayImage& image,
   const int height = image.height();
   const auto num_terms = static_cast<const int>(Atb.size());
 
-  const uint8_t* image_line = image.data();
+  const uint8_t* const image_data = image.data();
   const int image_stride = image.stride();
 
-  const uint32_t* mask_line = mask.data();
+  const uint32_t* const mask_data = mask.data();
   const int mask_stride = mask.wordsPerLine();
 
   // Pretend that both x and y positions of pixels
@@ -304,11 +339,8 @@ void PolynomialSurface::prepareDataForLeastSquares(const GrayImage& image,
   // To force data samples into [0, 1] range.
   const double data_scale = 1.0 / 255.0;
 
-  // 1, y, y^2, y^3, ...
-  VecT<double> y_powers(v_degree + 1);  // Initialized to 0.
-
-  // Same as y_powers, except y_powers correspond to a given y,
-  // while x_powers are computed for all possible x values.
+  // Powers of x are the same for every line, so they are
+  // computed once and shared read-only between threads.
   MatT<double> x_powers(h_degree + 1, width);  // Initialized to 0.
   for (int x = 0; x < width; ++x) {
     const double x_adjusted = xscale * x;
@@ -319,48 +351,70 @@ void PolynomialSurface::prepareDataForLeastSquares(const GrayImage& image,
     }
   }
 
-  VecT<double> full_powers(num_terms);
-
+  // Each strip accumulates into its own A^T*A and A^T*b,
+  // merged by plain addition at the end.
+  std::mutex sums_mutex;
   const uint32_t msb = uint32_t(1) << 31;
-  for (int y = 0; y < height; ++y) {
-    const double y_adjusted = yscale * y;
-
-    double y_power = 1.0;
-    for (int i = 0; i <= v_degree; ++i) {
-      y_powers[i] = y_power;
-      y_power *= y_adjusted;
-    }
-
-    for (int x = 0; x < width; ++x) {
-      if (!(mask_line[x >> 5] & (msb >> (x & 31)))) {
-        continue;
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    MatT<double> chunk_AtA(num_terms, num_terms);
+    VecT<double> chunk_Atb(num_terms);
+    double* const chunk_AtA_data = chunk_AtA.data();
+    double* const chunk_Atb_data = chunk_Atb.data();
+
+    // 1, y, y^2, y^3, ...
+    VecT<double> y_powers(v_degree + 1);  // Initialized to 0.
+    VecT<double> full_powers(num_terms);
+
+    const uint8_t* image_line = image_data + chunk_begin * image_stride;
+    const uint32_t* mask_line = mask_data + chunk_begin * mask_stride;
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      const double y_adjusted = yscale * y;
+
+      double y_power = 1.0;
+      for (int i = 0; i <= v_degree; ++i) {
+        y_powers[i] = y_power;
+        y_power *= y_adjusted;
       }
 
-      const double data_point = data_scale * image_line[x];
+      for (int x = 0; x < width; ++x) {
+        if (!(mask_line[x >> 5] & (msb >> (x & 31)))) {
+          continue;
+        }
+
+        const double data_point = data_scale * image_line[x];
 
-      int pos = 0;
-      for (int i = 0; i <= v_degree; ++i) {
-        for (int j = 0; j <= h_degree; ++j, ++pos) {
-          full_powers[pos] = y_powers[i] * x_powers(j, x);
+        int pos = 0;
+        for (int i = 0; i <= v_degree; ++i) {
+          for (int j = 0; j <= h_degree; ++j, ++pos) {
+            full_powers[pos] = y_powers[i] * x_powers(j, x);
+          }
         }
-      }
 
-      double* p_AtA = AtA_data;
-      for (int i = 0; i < num_terms; ++i) {
-        const double i_val = full_powers[i];
-        Atb_data[i] += i_val * data_point;
+        double* p_AtA = chunk_AtA_data;
+        for (int i = 0; i < num_terms; ++i) {
+          const double i_val = full_powers[i];
+          chunk_Atb_data[i] += i_val * data_point;
 
-        for (int j = 0; j < num_terms; ++j) {
-          const double j_val = full_powers[j];
-          *p_AtA += i_val * j_val;
-          ++p_AtA;
+          for (int j = 0; j < num_terms; ++j) {
+            const double j_val = full_powers[j];
+            *p_AtA += i_val * j_val;
+            ++p_AtA;
+          }
         }
       }
+
+      image_line += image_stride;
+      mask_line += mask_stride;
     }
 
-    image_line += image_stride;
-    mask_line += mask_stride;
-  }
+    const std::lock_guard<std::mutex> guard(sums_mutex);
+    for (int i = 0; i < num_terms; ++i) {
+      Atb_data[i] += chunk_Atb_data[i];
+    }
+    for (int i = 0; i < num_terms * num_terms; ++i) {
+      AtA_data[i] += chunk_AtA_data[i];
+    }
+  });
 }  // PolynomialSurface::prepareDataForLeastSquares
 
 void PolynomialSurface::fixSquareMatrixRankDeficiency(MatT<double>& mat) {
@@ -22,6 +22,7 @@
 #include <cassert>
 #include <cmath>
 #include "Constants.h"
+#include "ParallelFor.h"
 #include "VecNT.h"
 
 namespace imageproc {
@@ -33,7 +34,8 @@ RastLineFinderParams::RastLineFinderParams()
       m_maxAngleDeg(180),
       m_angleToleranceDeg(0.1),
       m_maxDistFromLine(1.0),
-      m_minSupportPoints(3) {}
+      m_minSupportPoints(3),
+      m_earlyExitSupportPoints(0) {}
 
 bool RastLineFinderParams::validate(std::string* error) const {
   if (m_angleToleranceDeg <= 0) {
@@ -76,6 +78,7 @@ RastLineFinder::RastLineFinder(const std::vector<QPointF>& points, const RastLin
       m_angleToleranceRad(params.angleToleranceDeg() * constants::DEG2RAD),
       m_maxDistFromLine(params.maxDistFromLine()),
       m_minSupportPoints(params.minSupportPoints()),
+      m_earlyExitSupportPoints(params.earlyExitSupportPoints()),
       m_firstLine(true) {
   std::string error;
   if (!params.validate(&error)) {
@@ -121,45 +124,97 @@ QLineF RastLineFinder::findNext(std::vector<unsigned>* point_idxs) {
     pruneUnavailablePoints();
   }
 
-  SearchSpace dist_ssp1, dist_ssp2;
-  SearchSpace angle_ssp1, angle_ssp2;
+  // Subdividing a search space only involves reading shared state,
+  // so a batch of the most promising spaces is subdivided in parallel,
+  // one per worker thread.
+  const int max_batch_size = std::max(1, parallelForNumThreads());
 
   while (!m_orderedSearchSpaces.empty()) {
-    SearchSpace ssp;
-    m_orderedSearchSpaces.retrieveFront(ssp);
-
-    if (!ssp.subdivideDist(*this, dist_ssp1, dist_ssp2)) {
-      if (!ssp.subdivideAngle(*this, angle_ssp1, angle_ssp2)) {
-        // Can't subdivide at all - return what we've got then.
-        markPointsUnavailable(ssp.pointIdxs());
-        if (point_idxs) {
-          point_idxs->swap(ssp.pointIdxs());
+    // Collect a batch of subdividable search spaces, stopping at the
+    // first one that can't be subdivided any further.
+    std::vector<SearchSpace> batch;
+    while (!m_orderedSearchSpaces.empty() && int(batch.size()) < max_batch_size) {
+      SearchSpace ssp;
+      m_orderedSearchSpaces.retrieveFront(ssp);
+
+      if (!ssp.canSubdivideDist(*this) && !ssp.canSubdivideAngle(*this)) {
+        if (batch.empty()) {
+          // Can't subdivide at all - return what we've got then.
+          markPointsUnavailable(ssp.pointIdxs());
+          if (point_idxs) {
+            point_idxs->swap(ssp.pointIdxs());
+          }
+
+          return ssp.representativeLine(*this);
         }
-
-        return ssp.representativeLine(*this);
-      } else {
-        // Can only subdivide by angle.
-        pushIfGoodEnough(angle_ssp1);
-        pushIfGoodEnough(angle_ssp2);
+        // The batched spaces outrank this one and their subdivisions
+        // may keep outranking it, so it goes back into the queue.
+        m_orderedSearchSpaces.pushDestructive(ssp);
+        break;
       }
-    } else {
-      if (!ssp.subdivideAngle(*this, angle_ssp1, angle_ssp2)) {
-        // Can only subdivide by distance.
-        pushIfGoodEnough(dist_ssp1);
-        pushIfGoodEnough(dist_ssp2);
-      } else {
-        // Can subdivide both by angle and distance.
-        // Choose the option that results in less combined
-        // number of points in two resulting sub-spaces.
-        if (dist_ssp1.pointIdxs().size() + dist_ssp2.pointIdxs().size()
-            < angle_ssp1.pointIdxs().size() + angle_ssp2.pointIdxs().size()) {
-          pushIfGoodEnough(dist_ssp1);
-          pushIfGoodEnough(dist_ssp2);
+
+      batch.emplace_back();
+      batch.back().swap(ssp);
+    }
+
+    std::vector<SearchSpace> children(batch.size() * 2);
+    parallelForChunked(0, int(batch.size()), [&](const int chunk_begin, const int chunk_end) {
+      SearchSpace dist_ssp1, dist_ssp2;
+      SearchSpace angle_ssp1, angle_ssp2;
+
+      for (int i = chunk_begin; i < chunk_end; ++i) {
+        const SearchSpace& ssp = batch[i];
+        const bool has_dist = ssp.subdivideDist(*this, dist_ssp1, dist_ssp2);
+        const bool has_angle = ssp.subdivideAngle(*this, angle_ssp1, angle_ssp2);
+        assert(has_dist || has_angle);
+
+        // When both subdivisions are possible, choose the option that
+        // results in less combined number of points in two resulting
+        // sub-spaces.
+        if (has_dist
+            && (!has_angle
+                || dist_ssp1.pointIdxs().size() + dist_ssp2.pointIdxs().size()
+                       < angle_ssp1.pointIdxs().size() + angle_ssp2.pointIdxs().size())) {
+          children[i * 2].swap(dist_ssp1);
+          children[i * 2 + 1].swap(dist_ssp2);
         } else {
-          pushIfGoodEnough(angle_ssp1);
-          pushIfGoodEnough(angle_ssp2);
+          children[i * 2].swap(angle_ssp1);
+          children[i * 2 + 1].swap(angle_ssp2);
         }
       }
+    });
+
+    // With an early exit threshold set, a fully localized child with
+    // enough support ends the search right away.  The best one across
+    // all the subdivided subtrees is taken.
+    int early_exit_idx = -1;
+    if (m_earlyExitSupportPoints > 0) {
+      const size_t wanted_support = std::max(m_earlyExitSupportPoints, m_minSupportPoints);
+      for (size_t i = 0; i < children.size(); ++i) {
+        const SearchSpace& child = children[i];
+        if ((child.pointIdxs().size() >= wanted_support) && !child.canSubdivideDist(*this)
+            && !child.canSubdivideAngle(*this)) {
+          if ((early_exit_idx == -1) || (child.pointIdxs().size() > children[early_exit_idx].pointIdxs().size())) {
+            early_exit_idx = int(i);
+          }
+        }
+      }
+    }
+
+    for (size_t i = 0; i < children.size(); ++i) {
+      if (int(i) != early_exit_idx) {
+        pushIfGoodEnough(children[i]);
+      }
+    }
+
+    if (early_exit_idx != -1) {
+      SearchSpace& ssp = children[early_exit_idx];
+      markPointsUnavailable(ssp.pointIdxs());
+      if (point_idxs) {
+        point_idxs->swap(ssp.pointIdxs());
+      }
+
+      return ssp.representativeLine(*this);
     }
   }
 
@@ -265,12 +320,22 @@ QLineF RastLineFinder::SearchSpace::representativeLine(const RastLineFinder& own
   return QLineF(p1, p2);
 }
 
+bool RastLineFinder::SearchSpace::canSubdivideDist(const RastLineFinder& owner) const {
+  assert(m_maxDist >= m_minDist);
+
+  return !((m_maxDist - m_minDist <= owner.m_maxDistFromLine * 2.0001) || (m_pointIdxs.size() < 2));
+}
+
+bool RastLineFinder::SearchSpace::canSubdivideAngle(const RastLineFinder& owner) const {
+  assert(m_maxAngleRad >= m_minAngleRad);
+
+  return !((m_maxAngleRad - m_minAngleRad <= owner.m_angleToleranceRad * 2) || (m_pointIdxs.size() < 2));
+}
+
 bool RastLineFinder::SearchSpace::subdivideDist(const RastLineFinder& owner,
                                                 SearchSpace& subspace1,
                                                 SearchSpace& subspace2) const {
-  assert(m_maxDist >= m_minDist);
-
-  if ((m_maxDist - m_minDist <= owner.m_maxDistFromLine * 2.0001) || (m_pointIdxs.size() < 2)) {
+  if (!canSubdivideDist(owner)) {
     return false;
   }
 
@@ -298,9 +363,7 @@ bool RastLineFinder::SearchSpace::subdivideDist(const RastLineFinder& owner,
 bool RastLineFinder::SearchSpace::subdivideAngle(const RastLineFinder& owner,
                                                  SearchSpace& subspace1,
                                                  SearchSpace& subspace2) const {
-  assert(m_maxAngleRad >= m_minAngleRad);
-
-  if ((m_maxAngleRad - m_minAngleRad <= owner.m_angleToleranceRad * 2) || (m_pointIdxs.size() < 2)) {
+  if (!canSubdivideAngle(owner)) {
     return false;
   }
 
@@ -105,6 +105,18 @@ class RastLineFinderParams {
    */
   unsigned minSupportPoints() const { return m_minSupportPoints; }
 
+  /**
+   * When set to a non-zero value, the search stops as soon as any line
+   * with at least that many support points has been localized, even if
+   * a slightly better line could still be found by continuing.  Set it
+   * when any sufficiently strong line is acceptable.  Zero (the
+   * default) always returns the best line first.
+   */
+  void setEarlyExitSupportPoints(unsigned pts) { m_earlyExitSupportPoints = pts; }
+
+  /** \see setEarlyExitSupportPoints() */
+  unsigned earlyExitSupportPoints() const { return m_earlyExitSupportPoints; }
+
   /**
    * \brief Checks if parameters are valid, optionally providing an error string.
    */
@@ -117,6 +129,7 @@ class RastLineFinderParams {
   double m_angleToleranceDeg;
   double m_maxDistFromLine;
   unsigned m_minSupportPoints;
+  unsigned m_earlyExitSupportPoints;
 };
 
 
@@ -201,6 +214,10 @@ class RastLineFinder {
      */
     QLineF representativeLine(const RastLineFinder& owner) const;
 
+    bool canSubdivideDist(const RastLineFinder& owner) const;
+
+    bool canSubdivideAngle(const RastLineFinder& owner) const;
+
     bool subdivideDist(const RastLineFinder& owner, SearchSpace& subspace1, SearchSpace& subspace2) const;
 
     bool subdivideAngle(const RastLineFinder& owner, SearchSpace& subspace1, SearchSpace& subspace2) const;
@@ -244,6 +261,7 @@ class RastLineFinder {
   double m_angleToleranceRad;
   double m_maxDistFromLine;
   unsigned m_minSupportPoints;
+  unsigned m_earlyExitSupportPoints;
   std::vector<Point> m_points;
   OrderedSearchSpaces m_orderedSearchSpaces;
   bool m_firstLine;
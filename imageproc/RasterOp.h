@@ -26,6 +26,8 @@
 #include <cassert>
 #include <stdexcept>
 #include "BinaryImage.h"
+#include "OpCounters.h"
+#include "RasterOpWordKernels.h"
 
 namespace imageproc {
 /**
@@ -200,6 +202,17 @@ void rasterOpInDirection(BinaryImage& dst,
                          const QPoint& sp,
                          const int dy,
                          const int dx) {
+  const RopTruthTable tt{Rop::transform(0, 0), Rop::transform(0, ~uint32_t(0)), Rop::transform(~uint32_t(0), 0),
+                         Rop::transform(~uint32_t(0), ~uint32_t(0))};
+  // A rop built from the standard functors is a pure bitwise function
+  // of (src, dst) and is exactly reproduced by its truth table, which
+  // makes it eligible for the runtime-dispatched SIMD kernels.  Custom
+  // rops that fail this probe keep the scalar path.  We also avoid the
+  // kernels when processing right-to-left or in-place, as they assume
+  // non-overlapping spans processed left-to-right.
+  const bool bitwise_rop = Rop::transform(0xDEADBEEF, 0x31415926) == ropTruthTableApply(0xDEADBEEF, 0x31415926, tt);
+  const bool use_simd = bitwise_rop && (dx == 1) && (&dst != &src);
+
   const int src_start_bit = sp.x() % 32;
   const int dst_start_bit = dr.x() % 32;
   const int rightmost_dst_bit = dr.right();  // == dr.x() + dr.width() - 1;
@@ -265,6 +278,25 @@ void rasterOpInDirection(BinaryImage& dst,
         const uint32_t new_dst_word = Rop::transform(src_word, dst_word);
         dst_span[0] = (dst_word & ~mask) | (new_dst_word & mask);
       }
+    } else if (use_simd) {
+      const RopWordKernel kernel = ropWordKernel();
+
+      for (int i = dr.height(); i > 0; --i, src_span += src_span_delta, dst_span += dst_span_delta) {
+        // Handle the first (possibly incomplete) dst word in the line.
+        uint32_t src_word = src_span[first_dst_word];
+        uint32_t dst_word = dst_span[first_dst_word];
+        uint32_t new_dst_word = Rop::transform(src_word, dst_word);
+        dst_span[first_dst_word] = (dst_word & ~first_dst_mask) | (new_dst_word & first_dst_mask);
+
+        kernel(dst_span + first_dst_word + 1, src_span + first_dst_word + 1,
+               size_t(last_dst_word - first_dst_word - 1), tt);
+
+        // Handle the last (possibly incomplete) dst word in the line.
+        src_word = src_span[last_dst_word];
+        dst_word = dst_span[last_dst_word];
+        new_dst_word = Rop::transform(src_word, dst_word);
+        dst_span[last_dst_word] = (dst_word & ~last_dst_mask) | (new_dst_word & last_dst_mask);
+      }
     } else {
       for (int i = dr.height(); i > 0; --i, src_span += src_span_delta, dst_span += dst_span_delta) {
         int widx = first_dst_word;
@@ -317,6 +349,41 @@ void rasterOpInDirection(BinaryImage& dst,
     const uint32_t can_last_word1 = (~uint32_t(0) << src_word1_shift) & last_dst_mask;
     const uint32_t can_last_word2 = (~uint32_t(0) >> src_word2_shift) & last_dst_mask;
 
+    if (use_simd) {
+      const RopShiftedWordKernel kernel = ropShiftedWordKernel();
+
+      for (int i = dr.height(); i > 0; --i, src_span += src_span_delta, dst_span += dst_span_delta) {
+        // Handle the first (possibly incomplete) dst word in the line.
+        uint32_t src_word = 0;
+        if (can_first_word1) {
+          src_word |= src_span[first_dst_word] << src_word1_shift;
+        }
+        if (can_first_word2) {
+          src_word |= src_span[first_dst_word + 1] >> src_word2_shift;
+        }
+        uint32_t dst_word = dst_span[first_dst_word];
+        uint32_t new_dst_word = Rop::transform(src_word, dst_word);
+        dst_span[first_dst_word] = (dst_word & ~first_dst_mask) | (new_dst_word & first_dst_mask);
+
+        kernel(dst_span + first_dst_word + 1, src_span + first_dst_word + 1,
+               size_t(last_dst_word - first_dst_word - 1), src_word1_shift, src_word2_shift, tt);
+
+        // Handle the last (possibly incomplete) dst word in the line.
+        src_word = 0;
+        if (can_last_word1) {
+          src_word |= src_span[last_dst_word] << src_word1_shift;
+        }
+        if (can_last_word2) {
+          src_word |= src_span[last_dst_word + 1] >> src_word2_shift;
+        }
+        dst_word = dst_span[last_dst_word];
+        new_dst_word = Rop::transform(src_word, dst_word);
+        dst_span[last_dst_word] = (dst_word & ~last_dst_mask) | (new_dst_word & last_dst_mask);
+      }
+
+      return;
+    }
+
     for (int i = dr.height(); i > 0; --i, src_span += src_span_delta, dst_span += dst_span_delta) {
       int widx = first_dst_word;
       // Handle the first (possibly incomplete) dst word in the line.
@@ -385,6 +452,10 @@ void rasterOp(BinaryImage& dst, const QRect& dr, const BinaryImage& src, const Q
     throw std::invalid_argument("rasterOp: raster area exceedes the src image");
   }
 
+  OpCounters::add(OpCounters::RASTER_OP_CALLS, 1);
+  // One read of src, one read-modify-write of dst.
+  OpCounters::add(OpCounters::RASTER_OP_BYTES, uint64_t(dr.width()) * dr.height() * 3 / 8);
+
   // We need to avoid a situation where we write some output
   // and then read it as input.  This can happen if src and dst
   // are the same images.
@@ -422,6 +493,9 @@ void rasterOp(BinaryImage& dst, const BinaryImage& src) {
     throw std::invalid_argument("rasterOp: images have different sizes");
   }
 
+  OpCounters::add(OpCounters::RASTER_OP_CALLS, 1);
+  OpCounters::add(OpCounters::RASTER_OP_BYTES, uint64_t(dst.width()) * dst.height() * 3 / 8);
+
   rasterOpInDirection<Rop>(dst, dst.rect(), src, QPoint(0, 0), 1, 1);
 }
 }  // namespace imageproc
@@ -22,6 +22,7 @@
 #include <QSize>
 #include <cassert>
 #include <cstdint>
+#include <tuple>
 #include "BinaryImage.h"
 
 namespace imageproc {
@@ -87,6 +88,41 @@ void rasterOpGeneric(const BinaryImage& image1, T2* data2, int stride2, Op opera
 template <typename T2, typename Op>
 void rasterOpGeneric(const BinaryImage& image1, T2* data2, int stride2, Op operation);
 
+namespace rop_generic_impl {
+template <typename... Ops>
+class FusedOp {
+ public:
+  explicit FusedOp(const Ops&... ops) : m_ops(ops...) {}
+
+  template <typename... Args>
+  void operator()(Args&&... args) const {
+    std::apply([&](const Ops&... ops) { (ops(args...), ...); }, m_ops);
+  }
+
+ private:
+  std::tuple<Ops...> m_ops;
+};
+}  // namespace rop_generic_impl
+
+/**
+ * \brief Chains pixel operations into a single one, applied left to right.
+ *
+ * Each operation sees the values left behind by the previous one, so a
+ * sequence of passes over the same image(s) collapses into one traversal:
+ * \code
+ * rasterOpGeneric(data, stride, size, fusedOp(_1 -= 10, if_then(_1 > 200, ++var(count))));
+ * \endcode
+ * On page-sized images each pass is a full sweep through memory, so
+ * fusing is a bandwidth saving, not just a loop-overhead one.  Only
+ * worth it for per-pixel traversals: sequences of plain rasterOp()
+ * calls already process 32 pixels per word and would lose more to
+ * per-pixel dispatch than they'd gain from fusion.
+ */
+template <typename... Ops>
+rop_generic_impl::FusedOp<Ops...> fusedOp(const Ops&... ops) {
+  return rop_generic_impl::FusedOp<Ops...>(ops...);
+}
+
 
 /*======================== Implementation ==========================*/
 
@@ -0,0 +1,206 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C) 2007-2008  Joseph Artsimovich <joseph_a@mail.ru>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RasterOpWordKernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMAGEPROC_ROP_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define IMAGEPROC_ROP_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace imageproc {
+namespace detail {
+namespace {
+inline uint32_t applyTruthTable(const uint32_t s, const uint32_t d, const RopTruthTable& tt) {
+  return ropTruthTableApply(s, d, tt);
+}
+
+void scalarWordKernel(uint32_t* dst, const uint32_t* src, const size_t num_words, const RopTruthTable& tt) {
+  for (size_t i = 0; i < num_words; ++i) {
+    dst[i] = applyTruthTable(src[i], dst[i], tt);
+  }
+}
+
+void scalarShiftedWordKernel(uint32_t* dst,
+                             const uint32_t* src,
+                             const size_t num_words,
+                             const int shift1,
+                             const int shift2,
+                             const RopTruthTable& tt) {
+  for (size_t i = 0; i < num_words; ++i) {
+    const uint32_t s = (src[i] << shift1) | (src[i + 1] >> shift2);
+    dst[i] = applyTruthTable(s, dst[i], tt);
+  }
+}
+
+#if defined(IMAGEPROC_ROP_AVX2)
+__attribute__((target("avx2"))) void avx2WordKernel(uint32_t* dst,
+                                                    const uint32_t* src,
+                                                    const size_t num_words,
+                                                    const RopTruthTable& tt) {
+  const __m256i t00 = _mm256_set1_epi32(int32_t(tt.t00));
+  const __m256i t01 = _mm256_set1_epi32(int32_t(tt.t01));
+  const __m256i t10 = _mm256_set1_epi32(int32_t(tt.t10));
+  const __m256i t11 = _mm256_set1_epi32(int32_t(tt.t11));
+
+  size_t i = 0;
+  for (; i + 8 <= num_words; i += 8) {
+    const __m256i s = _mm256_loadu_si256((const __m256i*) (src + i));
+    const __m256i d = _mm256_loadu_si256((const __m256i*) (dst + i));
+    __m256i res = _mm256_and_si256(t11, _mm256_and_si256(s, d));
+    res = _mm256_or_si256(res, _mm256_and_si256(t10, _mm256_andnot_si256(d, s)));
+    res = _mm256_or_si256(res, _mm256_and_si256(t01, _mm256_andnot_si256(s, d)));
+    res = _mm256_or_si256(res, _mm256_andnot_si256(_mm256_or_si256(s, d), t00));
+    _mm256_storeu_si256((__m256i*) (dst + i), res);
+  }
+  scalarWordKernel(dst + i, src + i, num_words - i, tt);
+}
+
+__attribute__((target("avx2"))) void avx2ShiftedWordKernel(uint32_t* dst,
+                                                           const uint32_t* src,
+                                                           const size_t num_words,
+                                                           const int shift1,
+                                                           const int shift2,
+                                                           const RopTruthTable& tt) {
+  const __m256i t00 = _mm256_set1_epi32(int32_t(tt.t00));
+  const __m256i t01 = _mm256_set1_epi32(int32_t(tt.t01));
+  const __m256i t10 = _mm256_set1_epi32(int32_t(tt.t10));
+  const __m256i t11 = _mm256_set1_epi32(int32_t(tt.t11));
+
+  size_t i = 0;
+  for (; i + 8 <= num_words; i += 8) {
+    const __m256i s1 = _mm256_loadu_si256((const __m256i*) (src + i));
+    const __m256i s2 = _mm256_loadu_si256((const __m256i*) (src + i + 1));
+    const __m256i s = _mm256_or_si256(_mm256_slli_epi32(s1, shift1), _mm256_srli_epi32(s2, shift2));
+    const __m256i d = _mm256_loadu_si256((const __m256i*) (dst + i));
+    __m256i res = _mm256_and_si256(t11, _mm256_and_si256(s, d));
+    res = _mm256_or_si256(res, _mm256_and_si256(t10, _mm256_andnot_si256(d, s)));
+    res = _mm256_or_si256(res, _mm256_and_si256(t01, _mm256_andnot_si256(s, d)));
+    res = _mm256_or_si256(res, _mm256_andnot_si256(_mm256_or_si256(s, d), t00));
+    _mm256_storeu_si256((__m256i*) (dst + i), res);
+  }
+  scalarShiftedWordKernel(dst + i, src + i, num_words - i, shift1, shift2, tt);
+}
+#endif  // IMAGEPROC_ROP_AVX2
+
+#if defined(IMAGEPROC_ROP_NEON)
+inline uint32x4_t neonApplyTruthTable(const uint32x4_t s,
+                                      const uint32x4_t d,
+                                      const uint32x4_t t00,
+                                      const uint32x4_t t01,
+                                      const uint32x4_t t10,
+                                      const uint32x4_t t11) {
+  uint32x4_t res = vandq_u32(t11, vandq_u32(s, d));
+  res = vorrq_u32(res, vandq_u32(t10, vbicq_u32(s, d)));
+  res = vorrq_u32(res, vandq_u32(t01, vbicq_u32(d, s)));
+  res = vorrq_u32(res, vbicq_u32(t00, vorrq_u32(s, d)));
+
+  return res;
+}
+
+void neonWordKernel(uint32_t* dst, const uint32_t* src, const size_t num_words, const RopTruthTable& tt) {
+  const uint32x4_t t00 = vdupq_n_u32(tt.t00);
+  const uint32x4_t t01 = vdupq_n_u32(tt.t01);
+  const uint32x4_t t10 = vdupq_n_u32(tt.t10);
+  const uint32x4_t t11 = vdupq_n_u32(tt.t11);
+
+  size_t i = 0;
+  for (; i + 8 <= num_words; i += 8) {
+    // Two 128-bit lanes per iteration to match the 256-bit x86 path.
+    const uint32x4_t res_lo = neonApplyTruthTable(vld1q_u32(src + i), vld1q_u32(dst + i), t00, t01, t10, t11);
+    const uint32x4_t res_hi = neonApplyTruthTable(vld1q_u32(src + i + 4), vld1q_u32(dst + i + 4), t00, t01, t10, t11);
+    vst1q_u32(dst + i, res_lo);
+    vst1q_u32(dst + i + 4, res_hi);
+  }
+  scalarWordKernel(dst + i, src + i, num_words - i, tt);
+}
+
+void neonShiftedWordKernel(uint32_t* dst,
+                           const uint32_t* src,
+                           const size_t num_words,
+                           const int shift1,
+                           const int shift2,
+                           const RopTruthTable& tt) {
+  const uint32x4_t t00 = vdupq_n_u32(tt.t00);
+  const uint32x4_t t01 = vdupq_n_u32(tt.t01);
+  const uint32x4_t t10 = vdupq_n_u32(tt.t10);
+  const uint32x4_t t11 = vdupq_n_u32(tt.t11);
+  const int32x4_t vshift1 = vdupq_n_s32(shift1);
+  const int32x4_t vshift2 = vdupq_n_s32(-shift2);
+
+  size_t i = 0;
+  for (; i + 4 <= num_words; i += 4) {
+    const uint32x4_t s
+        = vorrq_u32(vshlq_u32(vld1q_u32(src + i), vshift1), vshlq_u32(vld1q_u32(src + i + 1), vshift2));
+    vst1q_u32(dst + i, neonApplyTruthTable(s, vld1q_u32(dst + i), t00, t01, t10, t11));
+  }
+  scalarShiftedWordKernel(dst + i, src + i, num_words - i, shift1, shift2, tt);
+}
+#endif  // IMAGEPROC_ROP_NEON
+
+#if defined(IMAGEPROC_ROP_AVX2)
+bool cpuSupportsAvx2() {
+  return __builtin_cpu_supports("avx2") != 0;
+}
+#endif
+
+RopWordKernel selectWordKernel() {
+#if defined(IMAGEPROC_ROP_AVX2)
+  if (cpuSupportsAvx2()) {
+    return &avx2WordKernel;
+  }
+#endif
+#if defined(IMAGEPROC_ROP_NEON)
+  return &neonWordKernel;
+#endif
+
+  return &scalarWordKernel;
+}
+
+RopShiftedWordKernel selectShiftedWordKernel() {
+#if defined(IMAGEPROC_ROP_AVX2)
+  if (cpuSupportsAvx2()) {
+    return &avx2ShiftedWordKernel;
+  }
+#endif
+#if defined(IMAGEPROC_ROP_NEON)
+  return &neonShiftedWordKernel;
+#endif
+
+  return &scalarShiftedWordKernel;
+}
+}  // namespace
+
+RopWordKernel ropWordKernel() {
+  static const RopWordKernel kernel = selectWordKernel();
+
+  return kernel;
+}
+
+RopShiftedWordKernel ropShiftedWordKernel() {
+  static const RopShiftedWordKernel kernel = selectShiftedWordKernel();
+
+  return kernel;
+}
+}  // namespace detail
+}  // namespace imageproc
@@ -0,0 +1,85 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C) 2007-2008  Joseph Artsimovich <joseph_a@mail.ru>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGEPROC_RASTEROPWORDKERNELS_H_
+#define IMAGEPROC_RASTEROPWORDKERNELS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace imageproc {
+namespace detail {
+/**
+ * Any bitwise raster operation is fully described by its 1-bit truth
+ * table f(src, dst).  Expanding each of the 4 entries to a full word
+ * (0 or ~0) lets a single kernel implement every combination of the
+ * standard Rop* functors:
+ * \code
+ * dst = (t11 & s & d) | (t10 & s & ~d) | (t01 & ~s & d) | (t00 & ~s & ~d)
+ * \endcode
+ */
+struct RopTruthTable {
+  uint32_t t00;  // transform(0, 0)
+  uint32_t t01;  // transform(0, ~0)
+  uint32_t t10;  // transform(~0, 0)
+  uint32_t t11;  // transform(~0, ~0)
+};
+
+/**
+ * Evaluates the truth-table expansion for a single pair of words.
+ * For bitwise rops this is exactly Rop::transform(s, d).
+ */
+inline uint32_t ropTruthTableApply(const uint32_t s, const uint32_t d, const RopTruthTable& tt) {
+  return (tt.t11 & s & d) | (tt.t10 & s & ~d) | (tt.t01 & ~s & d) | (tt.t00 & ~s & ~d);
+}
+
+/**
+ * Applies a truth-table raster operation to \p num_words full words:
+ * dst[i] = f(src[i], dst[i]).  The src and dst spans must not overlap.
+ */
+using RopWordKernel = void (*)(uint32_t* dst, const uint32_t* src, size_t num_words, const RopTruthTable& tt);
+
+/**
+ * Same as RopWordKernel, but the source word for dst[i] is assembled
+ * from two adjacent words: (src[i] << shift1) | (src[i + 1] >> shift2),
+ * with shift1 + shift2 == 32.  src[num_words] must be readable.
+ */
+using RopShiftedWordKernel = void (*)(uint32_t* dst,
+                                      const uint32_t* src,
+                                      size_t num_words,
+                                      int shift1,
+                                      int shift2,
+                                      const RopTruthTable& tt);
+
+/**
+ * \brief Returns the best kernel for the current CPU.
+ *
+ * The returned pointer processes 256 bits per iteration where AVX2
+ * (x86) or NEON (ARM) is available at runtime, falling back to a
+ * portable scalar loop otherwise.  Detection happens once; subsequent
+ * calls are a plain load.
+ */
+RopWordKernel ropWordKernel();
+
+/**
+ * \see ropWordKernel()
+ */
+RopShiftedWordKernel ropShiftedWordKernel();
+}  // namespace detail
+}  // namespace imageproc
+#endif  // ifndef IMAGEPROC_RASTEROPWORDKERNELS_H_
@@ -18,89 +18,129 @@
 
 #include "ReduceThreshold.h"
 #include <cassert>
+#include "ParallelFor.h"
+
+// _pext_u64() requires 64-bit mode.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define IMAGEPROC_REDUCE_BMI2 1
+#include <immintrin.h>
+#endif
 
 namespace imageproc {
 namespace {
 /**
- * This lookup table is filled like this:
- * \code
- * for (unsigned i = 0; i < 256; i += 2) {
- *  unsigned out =
- *      ((i & (1 << 1)) >> 1) |  // bit 1 becomes bit 0
- *      ((i & (1 << 3)) >> 2) |  // bit 3 becomes bit 1
- *      ((i & (1 << 5)) >> 3) |  // bit 5 becomes bit 2
- *      ((i & (1 << 7)) >> 4);   // bit 7 becomes bit 3
- *  compressBitsLut[i >> 1] = static_cast<uint8_t>(out);
- * }
- * \endcode
- * We take every other byte because bit 0 doesn't matter here.
+ * Throw away every other bit starting with bit 0 and pack the
+ * remaining 16 bits into the lower half of a word, preserving order.
+ * The bit gathering steps are from Hacker's Delight, section 7-2.
  */
-const uint8_t compressBitsLut[128]
-    = {0x0, 0x1, 0x0, 0x1, 0x2, 0x3, 0x2, 0x3, 0x0, 0x1, 0x0, 0x1, 0x2, 0x3, 0x2, 0x3, 0x4, 0x5, 0x4, 0x5, 0x6, 0x7,
-       0x6, 0x7, 0x4, 0x5, 0x4, 0x5, 0x6, 0x7, 0x6, 0x7, 0x0, 0x1, 0x0, 0x1, 0x2, 0x3, 0x2, 0x3, 0x0, 0x1, 0x0, 0x1,
-       0x2, 0x3, 0x2, 0x3, 0x4, 0x5, 0x4, 0x5, 0x6, 0x7, 0x6, 0x7, 0x4, 0x5, 0x4, 0x5, 0x6, 0x7, 0x6, 0x7, 0x8, 0x9,
-       0x8, 0x9, 0xa, 0xb, 0xa, 0xb, 0x8, 0x9, 0x8, 0x9, 0xa, 0xb, 0xa, 0xb, 0xc, 0xd, 0xc, 0xd, 0xe, 0xf, 0xe, 0xf,
-       0xc, 0xd, 0xc, 0xd, 0xe, 0xf, 0xe, 0xf, 0x8, 0x9, 0x8, 0x9, 0xa, 0xb, 0xa, 0xb, 0x8, 0x9, 0x8, 0x9, 0xa, 0xb,
-       0xa, 0xb, 0xc, 0xd, 0xc, 0xd, 0xe, 0xf, 0xe, 0xf, 0xc, 0xd, 0xc, 0xd, 0xe, 0xf, 0xe, 0xf};
+inline uint32_t packOddBits(const uint32_t bits) {
+  uint32_t x = (bits >> 1) & 0x55555555;
+  x = (x | (x >> 1)) & 0x33333333;
+  x = (x | (x >> 2)) & 0x0f0f0f0f;
+  x = (x | (x >> 4)) & 0x00ff00ff;
+  x = (x | (x >> 8)) & 0x0000ffff;
+
+  return x;
+}
 
-/**
- * Throw away every other bit starting with bit 0 and
- * pack the remaining bits into the upper half of a word.
- */
-inline uint32_t compressBitsUpperHalf(const uint32_t bits) {
-  uint32_t r;
-  r = compressBitsLut[(bits >> 25) /*& 0x7F*/] << 28;
-  r |= compressBitsLut[(bits >> 17) & 0x7F] << 24;
-  r |= compressBitsLut[(bits >> 9) & 0x7F] << 20;
-  r |= compressBitsLut[(bits >> 1) & 0x7F] << 16;
-
-  return r;
+template <int Threshold>
+inline uint32_t thresholdWord(const uint32_t top, const uint32_t bottom) {
+  if constexpr (Threshold == 1) {
+    uint32_t word = top | bottom;
+    word |= word << 1;
+
+    return word;
+  } else if constexpr (Threshold == 2) {
+    uint32_t word1 = top & bottom;
+    word1 |= word1 << 1;
+    uint32_t word2 = top | bottom;
+    word2 &= word2 << 1;
+
+    return word1 | word2;
+  } else if constexpr (Threshold == 3) {
+    uint32_t word1 = top | bottom;
+    word1 &= word1 << 1;
+    uint32_t word2 = top & bottom;
+    word2 |= word2 << 1;
+
+    return word1 & word2;
+  } else {
+    uint32_t word = top & bottom;
+    word &= word << 1;
+
+    return word;
+  }
 }
 
 /**
- * Throw away every other bit starting with bit 0 and
- * pack the remaining bits into the lower half of a word.
+ * Reduces one pair of source rows to one destination row.
+ * \p steps is the number of source words to consume.
  */
-inline uint32_t compressBitsLowerHalf(const uint32_t bits) {
-  uint32_t r;
-  r = compressBitsLut[(bits >> 25) /*& 0x7F*/] << 12;
-  r |= compressBitsLut[(bits >> 17) & 0x7F] << 8;
-  r |= compressBitsLut[(bits >> 9) & 0x7F] << 4;
-  r |= compressBitsLut[(bits >> 1) & 0x7F];
-
-  return r;
-}
-
-inline uint32_t threshold1(const uint32_t top, const uint32_t bottom) {
-  uint32_t word = top | bottom;
-  word |= word << 1;
-
-  return word;
-}
-
-inline uint32_t threshold2(const uint32_t top, const uint32_t bottom) {
-  uint32_t word1 = top & bottom;
-  word1 |= word1 << 1;
-  uint32_t word2 = top | bottom;
-  word2 &= word2 << 1;
-
-  return word1 | word2;
+template <int Threshold>
+void reduceLineScalar(const uint32_t* const top, const uint32_t* const bottom, uint32_t* const dst, const int steps) {
+  int j = 0;
+  for (; j + 2 <= steps; j += 2) {
+    const uint32_t w1 = thresholdWord<Threshold>(top[j], bottom[j]);
+    const uint32_t w2 = thresholdWord<Threshold>(top[j + 1], bottom[j + 1]);
+    dst[j / 2] = (packOddBits(w1) << 16) | packOddBits(w2);
+  }
+  if (j < steps) {
+    dst[j / 2] = packOddBits(thresholdWord<Threshold>(top[j], bottom[j])) << 16;
+  }
 }
 
-inline uint32_t threshold3(const uint32_t top, const uint32_t bottom) {
-  uint32_t word1 = top | bottom;
-  word1 &= word1 << 1;
-  uint32_t word2 = top & bottom;
-  word2 |= word2 << 1;
-
-  return word1 & word2;
+#ifdef IMAGEPROC_REDUCE_BMI2
+/**
+ * Same as reduceLineScalar(), but a single PEXT compacts two source
+ * words into a whole destination word.
+ */
+template <int Threshold>
+__attribute__((target("bmi2"))) void reduceLineBmi2(const uint32_t* const top,
+                                                    const uint32_t* const bottom,
+                                                    uint32_t* const dst,
+                                                    const int steps) {
+  const uint64_t odd_bits_mask = 0xaaaaaaaaaaaaaaaa;
+
+  int j = 0;
+  for (; j + 2 <= steps; j += 2) {
+    const uint32_t w1 = thresholdWord<Threshold>(top[j], bottom[j]);
+    const uint32_t w2 = thresholdWord<Threshold>(top[j + 1], bottom[j + 1]);
+    dst[j / 2] = uint32_t(_pext_u64((uint64_t(w1) << 32) | w2, odd_bits_mask));
+  }
+  if (j < steps) {
+    const uint32_t w1 = thresholdWord<Threshold>(top[j], bottom[j]);
+    dst[j / 2] = uint32_t(_pext_u64(uint64_t(w1) << 32, odd_bits_mask));
+  }
 }
-
-inline uint32_t threshold4(const uint32_t top, const uint32_t bottom) {
-  uint32_t word = top & bottom;
-  word &= word << 1;
-
-  return word;
+#endif  // ifdef IMAGEPROC_REDUCE_BMI2
+
+typedef void (*ReduceLineFunc)(const uint32_t*, const uint32_t*, uint32_t*, int);
+
+ReduceLineFunc selectReduceLine(const int threshold) {
+#ifdef IMAGEPROC_REDUCE_BMI2
+  if (__builtin_cpu_supports("bmi2")) {
+    switch (threshold) {
+      case 1:
+        return &reduceLineBmi2<1>;
+      case 2:
+        return &reduceLineBmi2<2>;
+      case 3:
+        return &reduceLineBmi2<3>;
+      default:
+        return &reduceLineBmi2<4>;
+    }
+  }
+#endif
+  switch (threshold) {
+    case 1:
+      return &reduceLineScalar<1>;
+    case 2:
+      return &reduceLineScalar<2>;
+    case 3:
+      return &reduceLineScalar<3>;
+    default:
+      return &reduceLineScalar<4>;
+  }
 }
 }  // namespace
 
@@ -138,64 +178,28 @@ ReduceThreshold& ReduceThreshold::reduce(const int threshold) {
   assert(steps_per_line <= src_wpl);
   assert(steps_per_line / 2 <= dst_wpl);
 
-  const uint32_t* src_line = src.data();
-  uint32_t* dst_line = dst.data();
+  const uint32_t* const src_data = src.data();
+  uint32_t* const dst_data = dst.data();
 
-  uint32_t word;
+  const ReduceLineFunc reduce_line = selectReduceLine(threshold);
 
-  if (threshold == 1) {
-    for (int i = dst_h; i > 0; --i) {
-      for (int j = 0; j < steps_per_line; j += 2) {
-        word = threshold1(src_line[j], src_line[j + src_wpl]);
-        dst_line[j / 2] = compressBitsUpperHalf(word);
-      }
-      for (int j = 1; j < steps_per_line; j += 2) {
-        word = threshold1(src_line[j], src_line[j + src_wpl]);
-        dst_line[j / 2] |= compressBitsLowerHalf(word);
-      }
-      src_line += src_wpl * 2;
-      dst_line += dst_wpl;
-    }
-  } else if (threshold == 2) {
-    for (int i = dst_h; i > 0; --i) {
-      for (int j = 0; j < steps_per_line; j += 2) {
-        word = threshold2(src_line[j], src_line[j + src_wpl]);
-        dst_line[j / 2] = compressBitsUpperHalf(word);
-      }
-      for (int j = 1; j < steps_per_line; j += 2) {
-        word = threshold2(src_line[j], src_line[j + src_wpl]);
-        dst_line[j / 2] |= compressBitsLowerHalf(word);
-      }
-      src_line += src_wpl * 2;
-      dst_line += dst_wpl;
-    }
-  } else if (threshold == 3) {
-    for (int i = dst_h; i > 0; --i) {
-      for (int j = 0; j < steps_per_line; j += 2) {
-        word = threshold3(src_line[j], src_line[j + src_wpl]);
-        dst_line[j / 2] = compressBitsUpperHalf(word);
-      }
-      for (int j = 1; j < steps_per_line; j += 2) {
-        word = threshold3(src_line[j], src_line[j + src_wpl]);
-        dst_line[j / 2] |= compressBitsLowerHalf(word);
-      }
-      src_line += src_wpl * 2;
-      dst_line += dst_wpl;
-    }
-  } else if (threshold == 4) {
-    for (int i = dst_h; i > 0; --i) {
-      for (int j = 0; j < steps_per_line; j += 2) {
-        word = threshold4(src_line[j], src_line[j + src_wpl]);
-        dst_line[j / 2] = compressBitsUpperHalf(word);
-      }
-      for (int j = 1; j < steps_per_line; j += 2) {
-        word = threshold4(src_line[j], src_line[j + src_wpl]);
-        dst_line[j / 2] |= compressBitsLowerHalf(word);
-      }
-      src_line += src_wpl * 2;
-      dst_line += dst_wpl;
-    }
-  }
+  // Pairs of source rows are independent of each other.
+  const int64_t parallel_threshold = int64_t(1) << 18;  // 256K pixels.
+  const int max_threads = (int64_t(src.width()) * src.height() >= parallel_threshold) ? 0 : 1;
+
+  parallelForChunked(
+      0, dst_h,
+      [&](const int dst_y_begin, const int dst_y_end) {
+        const uint32_t* src_line = src_data + dst_y_begin * 2 * src_wpl;
+        uint32_t* dst_line = dst_data + dst_y_begin * dst_wpl;
+
+        for (int dst_y = dst_y_begin; dst_y < dst_y_end; ++dst_y) {
+          reduce_line(src_line, src_line + src_wpl, dst_line, steps_per_line);
+          src_line += src_wpl * 2;
+          dst_line += dst_wpl;
+        }
+      },
+      max_threads);
 
   m_image = dst;
 
@@ -219,38 +223,11 @@ void ReduceThreshold::reduceHorLine(const int threshold) {
   assert(steps_per_line <= src.wordsPerLine());
   assert(steps_per_line / 2 <= dst.wordsPerLine());
 
-  uint32_t word;
-
-  switch (threshold) {
-    case 1:
-    case 2:
-      for (int j = 0; j < steps_per_line; j += 2) {
-        word = src_line[j];
-        word |= word << 1;
-        dst_line[j / 2] = compressBitsUpperHalf(word);
-      }
-      for (int j = 1; j < steps_per_line; j += 2) {
-        word = src_line[j];
-        word |= word << 1;
-        dst_line[j / 2] |= compressBitsLowerHalf(word);
-      }
-      break;
-    case 3:
-    case 4:
-      for (int j = 0; j < steps_per_line; j += 2) {
-        word = src_line[j];
-        word &= word << 1;
-        dst_line[j / 2] = compressBitsUpperHalf(word);
-      }
-      for (int j = 1; j < steps_per_line; j += 2) {
-        word = src_line[j];
-        word &= word << 1;
-        dst_line[j / 2] |= compressBitsLowerHalf(word);
-      }
-      break;
-    default:
-      break;
-  }
+  // With a single row, the bottom row of a pair is the row itself,
+  // which turns thresholds 1 and 2 into an OR of horizontal neighbors
+  // and thresholds 3 and 4 into an AND.
+  const ReduceLineFunc reduce_line = selectReduceLine(threshold);
+  reduce_line(src_line, src_line, dst_line, steps_per_line);
 
   m_image = dst;
 }  // ReduceThreshold::reduceHorLine
@@ -295,4 +272,4 @@ void ReduceThreshold::reduceVertLine(const int threshold) {
 
   m_image = dst;
 }  // ReduceThreshold::reduceVertLine
-}  // namespace imageproc
\ No newline at end of file
+}  // namespace imageproc
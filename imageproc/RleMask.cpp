@@ -0,0 +1,177 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C) 2007-2008  Joseph Artsimovich <joseph_a@mail.ru>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RleMask.h"
+#include <algorithm>
+
+namespace imageproc {
+/**
+ * Writes \p pattern to pixels [x_from, x_to) of a line of words,
+ * leaving the pixels outside the segment intact.
+ */
+static void fillSegment(const int x_from, const int x_to, uint32_t* const line, const uint32_t pattern) {
+  const uint32_t full_mask = ~uint32_t(0);
+  const uint32_t first_word_mask = full_mask >> (x_from & 31);
+  const uint32_t last_word_mask = full_mask << (31 - ((x_to - 1) & 31));
+  const int first_word_idx = x_from >> 5;
+  const int last_word_idx = (x_to - 1) >> 5;  // x_to is exclusive
+  if (first_word_idx == last_word_idx) {
+    const uint32_t mask = first_word_mask & last_word_mask;
+    uint32_t& word = line[first_word_idx];
+    word = (word & ~mask) | (pattern & mask);
+
+    return;
+  }
+
+  int i = first_word_idx;
+
+  // First word.
+  uint32_t& first_word = line[i];
+  first_word = (first_word & ~first_word_mask) | (pattern & first_word_mask);
+
+  // Middle words.
+  for (++i; i < last_word_idx; ++i) {
+    line[i] = pattern;
+  }
+
+  // Last word.
+  uint32_t& last_word = line[i];
+  last_word = (last_word & ~last_word_mask) | (pattern & last_word_mask);
+}
+
+RleMask::RleMask(const QSize& size) {
+  if (size.isEmpty()) {
+    return;
+  }
+
+  m_size = size;
+  m_rows.resize(size.height());
+}
+
+bool RleMask::isEmpty() const {
+  for (const std::vector<Run>& row : m_rows) {
+    if (!row.empty()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void RleMask::addRun(const int y, int x_begin, int x_end) {
+  if ((y < 0) || (y >= height())) {
+    return;
+  }
+
+  x_begin = std::max(x_begin, 0);
+  x_end = std::min(x_end, width());
+  if (x_begin >= x_end) {
+    return;
+  }
+
+  std::vector<Run>& row = m_rows[y];
+
+  // Find the first run the new one could touch.
+  auto it(row.begin());
+  while ((it != row.end()) && (it->xEnd < x_begin)) {
+    ++it;
+  }
+
+  if ((it == row.end()) || (it->xBegin > x_end)) {
+    row.insert(it, Run{x_begin, x_end});
+
+    return;
+  }
+
+  // Merge with every run the new one overlaps or abuts.
+  it->xBegin = std::min(it->xBegin, x_begin);
+  it->xEnd = std::max(it->xEnd, x_end);
+  auto next(it + 1);
+  while ((next != row.end()) && (next->xBegin <= it->xEnd)) {
+    it->xEnd = std::max(it->xEnd, next->xEnd);
+    next = row.erase(next);
+  }
+}
+
+QRect RleMask::boundingRect() const {
+  int top = -1;
+  int bottom = -1;
+  int left = width();
+  int right = 0;
+
+  for (int y = 0; y < height(); ++y) {
+    const std::vector<Run>& row = m_rows[y];
+    if (row.empty()) {
+      continue;
+    }
+    if (top == -1) {
+      top = y;
+    }
+    bottom = y;
+    left = std::min(left, row.front().xBegin);
+    right = std::max(right, row.back().xEnd);
+  }
+
+  if (top == -1) {
+    return QRect();
+  }
+
+  return QRect(left, top, right - left, bottom - top + 1);
+}
+
+void RleMask::expandRow(const int y, uint32_t* const line) const {
+  const int wpl = (width() + 31) >> 5;
+  std::fill(line, line + wpl, uint32_t(0));
+  for (const Run& run : m_rows[y]) {
+    fillSegment(run.xBegin, run.xEnd, line, ~uint32_t(0));
+  }
+}
+
+void RleMask::fill(BinaryImage& image, const BWColor color) const {
+  if (image.isNull()) {
+    throw std::invalid_argument("RleMask::fill: target image is null");
+  }
+  if (image.size() != m_size) {
+    throw std::invalid_argument("RleMask::fill: image and mask sizes don't match");
+  }
+  if (isEmpty()) {
+    // Don't detach the image data for nothing.
+    return;
+  }
+
+  const uint32_t pattern = (color == WHITE) ? 0 : ~uint32_t(0);
+  const int wpl = image.wordsPerLine();
+  uint32_t* line = image.data();
+  for (int y = 0; y < height(); ++y, line += wpl) {
+    for (const Run& run : m_rows[y]) {
+      fillSegment(run.xBegin, run.xEnd, line, pattern);
+    }
+  }
+}
+
+BinaryImage RleMask::toBinaryImage() const {
+  if (isNull()) {
+    return BinaryImage();
+  }
+
+  BinaryImage image(m_size, WHITE);
+  fill(image, BLACK);
+
+  return image;
+}
+}  // namespace imageproc
@@ -0,0 +1,161 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C) 2007-2008  Joseph Artsimovich <joseph_a@mail.ru>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGEPROC_RLEMASK_H_
+#define IMAGEPROC_RLEMASK_H_
+
+#include <QRect>
+#include <QSize>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "BWColor.h"
+#include "BinaryImage.h"
+
+namespace imageproc {
+/**
+ * \brief A run-length encoded binary mask.
+ *
+ * Stores, for every row, a sorted list of black runs.  A mask covering
+ * a small fraction of a page this way takes a few kilobytes where a
+ * BinaryImage would take a full plane, and applying it only touches
+ * the words its runs overlap.  Rows are expanded to plain words on
+ * demand, which makes the mask interoperable with rasterOp().
+ *
+ * The intended use is masks derived from a ZoneSet: a page typically
+ * carries a handful of small zones, so allocating and clearing a full
+ * plane per mask is almost entirely wasted work.
+ */
+class RleMask {
+ public:
+  /**
+   * \brief A horizontal run of black pixels.  xEnd is not included.
+   */
+  struct Run {
+    int xBegin;
+    int xEnd;
+  };
+
+  /**
+   * \brief Constructs a null mask.
+   */
+  RleMask() = default;
+
+  /**
+   * \brief Constructs an all-white mask of the given size.
+   */
+  explicit RleMask(const QSize& size);
+
+  bool isNull() const { return m_size.isEmpty(); }
+
+  const QSize& size() const { return m_size; }
+
+  int width() const { return m_size.width(); }
+
+  int height() const { return m_size.height(); }
+
+  /**
+   * \brief Returns true if the mask has no black pixels.
+   */
+  bool isEmpty() const;
+
+  /**
+   * \brief Marks [x_begin, x_end) in row \p y as black.
+   *
+   * The run is clipped to the mask area.  Overlapping and adjacent
+   * runs are merged, so the per-row lists stay sorted and disjoint.
+   */
+  void addRun(int y, int x_begin, int x_end);
+
+  const std::vector<Run>& runs(int y) const { return m_rows[y]; }
+
+  /**
+   * \brief The bounding rectangle of the black pixels.
+   *
+   * Returns a null rectangle for an empty mask.
+   */
+  QRect boundingRect() const;
+
+  /**
+   * \brief Expands row \p y into a line of words, 1 meaning black.
+   *
+   * Every word a BinaryImage of this width would use for a line is
+   * written, including the padding bits, which are set to zero.
+   */
+  void expandRow(int y, uint32_t* line) const;
+
+  /**
+   * \brief Sets the masked pixels of \p image to \p color.
+   *
+   * The image must have the same size as the mask.  Rows without runs
+   * aren't touched at all.
+   */
+  void fill(BinaryImage& image, BWColor color) const;
+
+  /**
+   * \brief Expands the mask into a BinaryImage with a white background.
+   */
+  BinaryImage toBinaryImage() const;
+
+ private:
+  QSize m_size;
+  std::vector<std::vector<Run>> m_rows;
+};
+
+
+/**
+ * \brief Same as rasterOp(BinaryImage&, const BinaryImage&), with an
+ *        RLE source expanded one row at a time.
+ *
+ * No full-sized plane is ever materialized for the source.  Rows
+ * without runs are skipped entirely when the operation keeps the
+ * destination intact for white source pixels, which is the case for
+ * things like RopOr\<RopSrc, RopDst\>.
+ */
+template <typename Rop>
+void rasterOp(BinaryImage& dst, const RleMask& src) {
+  if (dst.isNull() || src.isNull()) {
+    throw std::invalid_argument("rasterOp: can't operate on null images");
+  }
+  if (dst.size() != src.size()) {
+    throw std::invalid_argument("rasterOp: images have different sizes");
+  }
+
+  // For a bitwise operation the two probe words below cover every
+  // (white src, any dst) combination, bit by bit.  If both come out
+  // unchanged, rows without runs can't modify the destination.
+  const uint32_t all_ones = ~uint32_t(0);
+  const bool white_src_transparent = (Rop::transform(0, 0) == 0) && (Rop::transform(0, all_ones) == all_ones);
+
+  const int wpl = dst.wordsPerLine();
+  uint32_t* dst_line = dst.data();
+  std::vector<uint32_t> src_line(wpl, 0);
+
+  const int height = src.height();
+  for (int y = 0; y < height; ++y, dst_line += wpl) {
+    if (src.runs(y).empty() && white_src_transparent) {
+      continue;
+    }
+    src.expandRow(y, &src_line[0]);
+    for (int i = 0; i < wpl; ++i) {
+      dst_line[i] = Rop::transform(src_line[i], dst_line[i]);
+    }
+  }
+}
+}  // namespace imageproc
+#endif  // ifndef IMAGEPROC_RLEMASK_H_
@@ -23,6 +23,7 @@
 #include "BinaryImage.h"
 #include "ConnectivityMap.h"
 #include "Morphology.h"
+#include "ParallelFor.h"
 #include "RasterOp.h"
 #include "SeedFill.h"
 
@@ -194,171 +195,193 @@ void SEDM::processColumns() {
   const int width = m_size.width() + 2;
   const int height = m_size.height() + 2;
 
-  uint32_t* p_sqd = &m_data[0];
-  for (int x = 0; x < width; ++x, ++p_sqd) {
-    // (d + 1)^2 = d^2 + 2d + 1
-    uint32_t b = 1;  // 2d + 1 in the above formula.
-    for (int todo = height - 1; todo > 0; --todo) {
-      const uint32_t sqd = *p_sqd + b;
-      p_sqd += width;
-      if (*p_sqd > sqd) {
-        *p_sqd = sqd;
-        b += 2;
-      } else {
-        b = 1;
+  uint32_t* const data = &m_data[0];
+
+  // Columns don't depend on each other in this phase,
+  // so contiguous strips of them go to separate threads.
+  parallelForChunked(0, width, [&](const int x_begin, const int x_end) {
+    for (int x = x_begin; x < x_end; ++x) {
+      uint32_t* p_sqd = data + x;
+      // (d + 1)^2 = d^2 + 2d + 1
+      uint32_t b = 1;  // 2d + 1 in the above formula.
+      for (int todo = height - 1; todo > 0; --todo) {
+        const uint32_t sqd = *p_sqd + b;
+        p_sqd += width;
+        if (*p_sqd > sqd) {
+          *p_sqd = sqd;
+          b += 2;
+        } else {
+          b = 1;
+        }
       }
-    }
 
-    b = 1;
-    for (int todo = height - 1; todo > 0; --todo) {
-      const uint32_t sqd = *p_sqd + b;
-      p_sqd -= width;
-      if (*p_sqd > sqd) {
-        *p_sqd = sqd;
-        b += 2;
-      } else {
-        b = 1;
+      b = 1;
+      for (int todo = height - 1; todo > 0; --todo) {
+        const uint32_t sqd = *p_sqd + b;
+        p_sqd -= width;
+        if (*p_sqd > sqd) {
+          *p_sqd = sqd;
+          b += 2;
+        } else {
+          b = 1;
+        }
       }
     }
-  }
+  });
 }  // SEDM::processColumns
 
 void SEDM::processColumns(ConnectivityMap& cmap) {
   const int width = m_size.width() + 2;
   const int height = m_size.height() + 2;
 
-  uint32_t* p_sqd = &m_data[0];
-  uint32_t* p_label = cmap.paddedData();
-  for (int x = 0; x < width; ++x, ++p_sqd, ++p_label) {
-    // (d + 1)^2 = d^2 + 2d + 1
-    uint32_t b = 1;  // 2d + 1 in the above formula.
-    for (int todo = height - 1; todo > 0; --todo) {
-      const uint32_t sqd = *p_sqd + b;
-      p_sqd += width;
-      p_label += width;
-      if (sqd < *p_sqd) {
-        *p_sqd = sqd;
-        *p_label = p_label[-width];
-        b += 2;
-      } else {
-        b = 1;
+  uint32_t* const data = &m_data[0];
+  uint32_t* const labels = cmap.paddedData();
+
+  parallelForChunked(0, width, [&](const int x_begin, const int x_end) {
+    for (int x = x_begin; x < x_end; ++x) {
+      uint32_t* p_sqd = data + x;
+      uint32_t* p_label = labels + x;
+      // (d + 1)^2 = d^2 + 2d + 1
+      uint32_t b = 1;  // 2d + 1 in the above formula.
+      for (int todo = height - 1; todo > 0; --todo) {
+        const uint32_t sqd = *p_sqd + b;
+        p_sqd += width;
+        p_label += width;
+        if (sqd < *p_sqd) {
+          *p_sqd = sqd;
+          *p_label = p_label[-width];
+          b += 2;
+        } else {
+          b = 1;
+        }
       }
-    }
 
-    b = 1;
-    for (int todo = height - 1; todo > 0; --todo) {
-      const uint32_t sqd = *p_sqd + b;
-      p_sqd -= width;
-      p_label -= width;
-      if (sqd < *p_sqd) {
-        *p_sqd = sqd;
-        *p_label = p_label[width];
-        b += 2;
-      } else {
-        b = 1;
+      b = 1;
+      for (int todo = height - 1; todo > 0; --todo) {
+        const uint32_t sqd = *p_sqd + b;
+        p_sqd -= width;
+        p_label -= width;
+        if (sqd < *p_sqd) {
+          *p_sqd = sqd;
+          *p_label = p_label[width];
+          b += 2;
+        } else {
+          b = 1;
+        }
       }
     }
-  }
+  });
 }  // SEDM::processColumns
 
 void SEDM::processRows() {
   const int width = m_size.width() + 2;
   const int height = m_size.height() + 2;
 
-  std::vector<int> s(width, 0);
-  std::vector<int> t(width, 0);
-  std::vector<uint32_t> row_copy(width, 0);
-
-  uint32_t* line = &m_data[0];
-  for (int y = 0; y < height; ++y, line += width) {
-    int q = 0;
-    s[0] = 0;
-    t[0] = 0;
-    for (int x = 1; x < width; ++x) {
-      while (q >= 0 && distSq(t[q], s[q], line[s[q]]) > distSq(t[q], x, line[x])) {
-        --q;
-      }
+  uint32_t* const data = &m_data[0];
+
+  // The envelope algorithm works on one row at a time,
+  // so rows go to separate threads, each with its own scratch vectors.
+  parallelForChunked(0, height, [&](const int y_begin, const int y_end) {
+    std::vector<int> s(width, 0);
+    std::vector<int> t(width, 0);
+    std::vector<uint32_t> row_copy(width, 0);
+
+    uint32_t* line = data + y_begin * width;
+    for (int y = y_begin; y < y_end; ++y, line += width) {
+      int q = 0;
+      s[0] = 0;
+      t[0] = 0;
+      for (int x = 1; x < width; ++x) {
+        while (q >= 0 && distSq(t[q], s[q], line[s[q]]) > distSq(t[q], x, line[x])) {
+          --q;
+        }
 
-      if (q < 0) {
-        q = 0;
-        s[0] = x;
-      } else {
-        const int x2 = s[q];
-        if ((line[x] != INF_DIST) && (line[x2] != INF_DIST)) {
-          int w = (x * x + line[x]) - (x2 * x2 + line[x2]);
-          w /= (x - x2) << 1;
-          ++w;
-          if ((unsigned) w < (unsigned) width) {
-            ++q;
-            s[q] = x;
-            t[q] = w;
+        if (q < 0) {
+          q = 0;
+          s[0] = x;
+        } else {
+          const int x2 = s[q];
+          if ((line[x] != INF_DIST) && (line[x2] != INF_DIST)) {
+            int w = (x * x + line[x]) - (x2 * x2 + line[x2]);
+            w /= (x - x2) << 1;
+            ++w;
+            if ((unsigned) w < (unsigned) width) {
+              ++q;
+              s[q] = x;
+              t[q] = w;
+            }
           }
         }
       }
-    }
 
-    memcpy(&row_copy[0], line, width * sizeof(*line));
+      memcpy(&row_copy[0], line, width * sizeof(*line));
 
-    for (int x = width - 1; x >= 0; --x) {
-      const int x2 = s[q];
-      line[x] = distSq(x, x2, row_copy[x2]);
-      if (x == t[q]) {
-        --q;
+      for (int x = width - 1; x >= 0; --x) {
+        const int x2 = s[q];
+        line[x] = distSq(x, x2, row_copy[x2]);
+        if (x == t[q]) {
+          --q;
+        }
       }
     }
-  }
+  });
 }  // SEDM::processRows
 
 void SEDM::processRows(ConnectivityMap& cmap) {
   const int width = m_size.width() + 2;
   const int height = m_size.height() + 2;
 
-  std::vector<int> s(width, 0);
-  std::vector<int> t(width, 0);
-  std::vector<uint32_t> row_copy(width, 0);
-  std::vector<uint32_t> cmap_row_copy(width, 0);
-
-  uint32_t* line = &m_data[0];
-  uint32_t* cmap_line = cmap.paddedData();
-  for (int y = 0; y < height; ++y, line += width, cmap_line += width) {
-    int q = 0;
-    s[0] = 0;
-    t[0] = 0;
-    for (int x = 1; x < width; ++x) {
-      while (q >= 0 && distSq(t[q], s[q], line[s[q]]) > distSq(t[q], x, line[x])) {
-        --q;
-      }
+  uint32_t* const data = &m_data[0];
+  uint32_t* const labels = cmap.paddedData();
+
+  parallelForChunked(0, height, [&](const int y_begin, const int y_end) {
+    std::vector<int> s(width, 0);
+    std::vector<int> t(width, 0);
+    std::vector<uint32_t> row_copy(width, 0);
+    std::vector<uint32_t> cmap_row_copy(width, 0);
+
+    uint32_t* line = data + y_begin * width;
+    uint32_t* cmap_line = labels + y_begin * width;
+    for (int y = y_begin; y < y_end; ++y, line += width, cmap_line += width) {
+      int q = 0;
+      s[0] = 0;
+      t[0] = 0;
+      for (int x = 1; x < width; ++x) {
+        while (q >= 0 && distSq(t[q], s[q], line[s[q]]) > distSq(t[q], x, line[x])) {
+          --q;
+        }
 
-      if (q < 0) {
-        q = 0;
-        s[0] = x;
-      } else {
-        const int x2 = s[q];
-        if ((line[x] != INF_DIST) && (line[x2] != INF_DIST)) {
-          int w = (x * x + line[x]) - (x2 * x2 + line[x2]);
-          w /= (x - x2) << 1;
-          ++w;
-          if ((unsigned) w < (unsigned) width) {
-            ++q;
-            s[q] = x;
-            t[q] = w;
+        if (q < 0) {
+          q = 0;
+          s[0] = x;
+        } else {
+          const int x2 = s[q];
+          if ((line[x] != INF_DIST) && (line[x2] != INF_DIST)) {
+            int w = (x * x + line[x]) - (x2 * x2 + line[x2]);
+            w /= (x - x2) << 1;
+            ++w;
+            if ((unsigned) w < (unsigned) width) {
+              ++q;
+              s[q] = x;
+              t[q] = w;
+            }
           }
         }
       }
-    }
 
-    memcpy(&row_copy[0], line, width * sizeof(*line));
-    memcpy(&cmap_row_copy[0], cmap_line, width * sizeof(*cmap_line));
+      memcpy(&row_copy[0], line, width * sizeof(*line));
+      memcpy(&cmap_row_copy[0], cmap_line, width * sizeof(*cmap_line));
 
-    for (int x = width - 1; x >= 0; --x) {
-      const int x2 = s[q];
-      line[x] = distSq(x, x2, row_copy[x2]);
-      cmap_line[x] = cmap_row_copy[x2];
-      if (x == t[q]) {
-        --q;
+      for (int x = width - 1; x >= 0; --x) {
+        const int x2 = s[q];
+        line[x] = distSq(x, x2, row_copy[x2]);
+        cmap_line[x] = cmap_row_copy[x2];
+        if (x == t[q]) {
+          --q;
+        }
       }
     }
-  }
+  });
 }  // SEDM::processRows
 
 /*====================== Peak finding stuff goes below ====================*/
@@ -17,7 +17,15 @@
  */
 
 #include "SavGolFilter.h"
+#include <QPoint>
+#include <QSize>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include "FlatHashMap.h"
 #include "Grayscale.h"
+#include "ParallelFor.h"
 #include "SavGolKernel.h"
 
 namespace imageproc {
@@ -26,24 +34,111 @@ int calcNumTerms(const int hor_degree, const int vert_degree) {
   return (hor_degree + 1) * (vert_degree + 1);
 }
 
-class Kernel : public SavGolKernel {
+/**
+ * \brief Every convolution kernel needed to filter an image with one
+ *        (window, degree) combination.
+ *
+ * Computing a SavGolKernel involves a QR factorization, and the border
+ * handling below needs a separate kernel for every distinct hot spot
+ * position, so a filter call used to spend a noticeable fraction of its
+ * time just deriving coefficients.  Those coefficients depend on nothing
+ * but the window size and the polynomial degrees, which stay the same
+ * for every page of a project, so we derive them once per combination
+ * and keep them in a process-wide cache (see compiledKernelsFor()).
+ */
+class CompiledKernels {
  public:
-  Kernel(const QSize& size, const QPoint& origin, int hor_degree, int vert_degree)
-      : SavGolKernel(size, origin, hor_degree, vert_degree) {}
+  CompiledKernels(const QSize& window_size, int hor_degree, int vert_degree);
+
+  /**
+   * The full 2D kernel with its hot spot at (x, y),
+   * with x in [0, kw) and y in [0, kh).
+   */
+  const float* kernelFor(const int x, const int y) const { return m_kernels.data() + (y * m_kw + x) * m_kernelStride; }
+
+  /** The 1D horizontal kernel of the separable central-area path. */
+  const float* horKernel() const { return m_horKernel.data(); }
+
+  /** The 1D vertical kernel of the separable central-area path. */
+  const float* vertKernel() const { return m_vertKernel.data(); }
+
+ private:
+  int m_kw;
+  int m_kh;
 
-  void convolve(uint8_t* dst, const uint8_t* src_top_left, int src_bpl) const;
+  /** Kernels are padded to a multiple of 4 floats to keep each one 16-byte aligned. */
+  int m_kernelStride;
+
+  AlignedArray<float, 4> m_kernels;
+  AlignedArray<float, 4> m_horKernel;
+  AlignedArray<float, 4> m_vertKernel;
 };
 
 
-inline void Kernel::convolve(uint8_t* dst, const uint8_t* src_top_left, int src_bpl) const {
+CompiledKernels::CompiledKernels(const QSize& window_size, const int hor_degree, const int vert_degree)
+    : m_kw(window_size.width()), m_kh(window_size.height()), m_kernelStride((m_kw * m_kh + 3) & ~3) {
+  AlignedArray<float, 4>(m_kernelStride * m_kw * m_kh).swap(m_kernels);
+
+  // A single QR factorization serves every hot spot position.
+  SavGolKernel kernel(window_size, QPoint(0, 0), hor_degree, vert_degree);
+  float* dst = m_kernels.data();
+  for (int y = 0; y < m_kh; ++y) {
+    for (int x = 0; x < m_kw; ++x, dst += m_kernelStride) {
+      kernel.recalcForOrigin(QPoint(x, y));
+      std::copy(kernel.data(), kernel.data() + m_kw * m_kh, dst);
+    }
+  }
+
+  const QPoint k_center(m_kw / 2, m_kh / 2);
+
+  const SavGolKernel hor_kernel(QSize(m_kw, 1), QPoint(k_center.x(), 0), hor_degree, 0);
+  AlignedArray<float, 4>(m_kw).swap(m_horKernel);
+  std::copy(hor_kernel.data(), hor_kernel.data() + m_kw, m_horKernel.data());
+
+  const SavGolKernel vert_kernel(QSize(1, m_kh), QPoint(0, k_center.y()), 0, vert_degree);
+  AlignedArray<float, 4>(m_kh).swap(m_vertKernel);
+  std::copy(vert_kernel.data(), vert_kernel.data() + m_kh, m_vertKernel.data());
+}
+
+/**
+ * \brief Returns the kernel set for the given parameters, deriving it
+ *        on first use.
+ *
+ * Entries are never evicted: a project uses a single combination of
+ * window size and degrees across all of its pages, and a kernel set
+ * is a few dozen kilobytes at the window sizes we're called with.
+ */
+std::shared_ptr<const CompiledKernels> compiledKernelsFor(const QSize& window_size,
+                                                          const int hor_degree,
+                                                          const int vert_degree) {
+  const uint64_t key = (uint64_t(uint16_t(window_size.width())) << 48) | (uint64_t(uint16_t(window_size.height())) << 32)
+                       | (uint64_t(uint16_t(hor_degree)) << 16) | uint64_t(uint16_t(vert_degree));
+
+  static std::mutex mutex;
+  static FlatHashMap<uint64_t, std::shared_ptr<const CompiledKernels>> cache;
+
+  const std::lock_guard<std::mutex> guard(mutex);
+
+  std::shared_ptr<const CompiledKernels>& entry = cache[key];
+  if (!entry) {
+    entry = std::make_shared<CompiledKernels>(window_size, hor_degree, vert_degree);
+  }
+
+  return entry;
+}
+
+inline void convolve(uint8_t* dst,
+                     const float* kernel,
+                     const int kw,
+                     const int kh,
+                     const uint8_t* src_top_left,
+                     const int src_bpl) {
   const uint8_t* p_src = src_top_left;
-  const float* p_kernel = data();
+  const float* p_kernel = kernel;
   float sum = 0.5;  // For rounding purposes.
-  const int w = width();
-  const int h = height();
 
-  for (int y = 0; y < h; ++y, p_src += src_bpl) {
-    for (int x = 0; x < w; ++x) {
+  for (int y = 0; y < kh; ++y, p_src += src_bpl) {
+    for (int x = 0; x < kw; ++x) {
       sum += p_src[x] * *p_kernel;
       ++p_kernel;
     }
@@ -80,12 +175,6 @@ QImage savGolFilterGrayToGray(const QImage& src,
   // Co-ordinates of the central point (C) of the kernel.
   const QPoint k_center(kw / 2, kh / 2);
 
-  // Origin is the current hot spot of the kernel.
-  // Normally it's at k_center, but sometimes we move
-  // it to other locations to avoid parts of the kernel
-  // from going outside of the image area.
-  QPoint k_origin;
-
   // Length of the top segment (T) of the kernel.
   const int k_top = k_center.y();
 
@@ -108,60 +197,43 @@ QImage savGolFilterGrayToGray(const QImage& src,
 
   uint8_t* const dst_data = dst.bits();
   const int dst_bpl = dst.bytesPerLine();
+
+  const std::shared_ptr<const CompiledKernels> kernels(compiledKernelsFor(window_size, hor_degree, vert_degree));
+
   // Top-left corner.
   const uint8_t* src_line = src_data;
   uint8_t* dst_line = dst_data;
-  Kernel kernel(window_size, QPoint(0, 0), hor_degree, vert_degree);
   for (int y = 0; y < k_top; ++y, dst_line += dst_bpl) {
-    k_origin.setY(y);
     for (int x = 0; x < k_left; ++x) {
-      k_origin.setX(x);
-      kernel.recalcForOrigin(k_origin);
-      kernel.convolve(dst_line + x, src_line, src_bpl);
+      convolve(dst_line + x, kernels->kernelFor(x, y), kw, kh, src_line, src_bpl);
     }
   }
 
   // Top area between two corners.
-  k_origin.setX(k_center.x());
   src_line = src_data - k_left;
   dst_line = dst_data;
   for (int y = 0; y < k_top; ++y, dst_line += dst_bpl) {
-    k_origin.setY(y);
-    kernel.recalcForOrigin(k_origin);
+    const float* const kernel = kernels->kernelFor(k_center.x(), y);
     for (int x = k_left; x < width - k_right; ++x) {
-      kernel.convolve(dst_line + x, src_line + x, src_bpl);
+      convolve(dst_line + x, kernel, kw, kh, src_line + x, src_bpl);
     }
   }
   // Top-right corner.
-  k_origin.setY(0);
   src_line = src_data + width - kw;
   dst_line = dst_data;
   for (int y = 0; y < k_top; ++y, dst_line += dst_bpl) {
-    k_origin.setX(k_center.x() + 1);
-    for (int x = width - k_right; x < width; ++x) {
-      kernel.recalcForOrigin(k_origin);
-      kernel.convolve(dst_line + x, src_line, src_bpl);
-      k_origin.rx() += 1;
+    int kx = k_center.x() + 1;
+    for (int x = width - k_right; x < width; ++x, ++kx) {
+      convolve(dst_line + x, kernels->kernelFor(kx, y), kw, kh, src_line, src_bpl);
     }
-    k_origin.ry() += 1;
   }
-  // Central area.
-#if 0
-            // Simple but slow implementation.
-                    kernel.recalcForOrigin(k_center);
-                    src_line = src_data - k_left;
-                    dst_line = dst_data + dst_bpl * k_top;
-                    for (int y = k_top; y < height - k_bottom; ++y) {
-                        for (int x = k_left; x < width - k_right; ++x) {
-                            kernel.convolve(dst_line + x, src_line + x, src_bpl);
-                        }
-                        src_line += src_bpl;
-                        dst_line += dst_bpl;
-                    }
-#else
-  // Take advantage of Savitzky-Golay filter being separable.
-  const SavGolKernel hor_kernel(QSize(window_size.width(), 1), QPoint(k_center.x(), 0), hor_degree, 0);
-  const SavGolKernel vert_kernel(QSize(1, window_size.height()), QPoint(0, k_center.y()), 0, vert_degree);
+
+  // Central area.  Take advantage of the Savitzky-Golay filter being
+  // separable: a horizontal pass into a floating point buffer followed
+  // by a vertical pass into the destination.  Within each pass rows
+  // are independent, so they are processed in parallel strips.
+  const float* const hor_kernel = kernels->horKernel();
+  const float* const vert_kernel = kernels->vertKernel();
 
   const int shift = kw - 1;
 
@@ -170,109 +242,107 @@ QImage savGolFilterGrayToGray(const QImage& src,
   const int temp_stride = (width - shift + 3) & ~3;
   AlignedArray<float, 4> temp_array(temp_stride * height);
   // Horizontal pass.
-  src_line = src_data - shift;
-  float* temp_line = temp_array.data() - shift;
-  for (int y = 0; y < height; ++y) {
-    for (int i = shift; i < width; ++i) {
-      float sum = 0.0f;
-
-      const uint8_t* src = src_line + i;
-      for (int j = 0; j < kw; ++j) {
-        sum += src[j] * hor_kernel[j];
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    const uint8_t* src_line = src_data + chunk_begin * src_bpl - shift;
+    float* temp_line = temp_array.data() + chunk_begin * temp_stride - shift;
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      for (int i = shift; i < width; ++i) {
+        float sum = 0.0f;
+
+        const uint8_t* src = src_line + i;
+        for (int j = 0; j < kw; ++j) {
+          sum += src[j] * hor_kernel[j];
+        }
+        temp_line[i] = sum;
       }
-      temp_line[i] = sum;
+      temp_line += temp_stride;
+      src_line += src_bpl;
     }
-    temp_line += temp_stride;
-    src_line += src_bpl;
-  }
+  });
   // Vertical pass.
-  dst_line = dst_data + k_top * dst_bpl + k_left - shift;
-  temp_line = temp_array.data() - shift;
-  for (int y = k_top; y < height - k_bottom; ++y) {
-    for (int i = shift; i < width; ++i) {
-      float sum = 0.0f;
-
-      float* tmp = temp_line + i;
-      for (int j = 0; j < kh; ++j, tmp += temp_stride) {
-        sum += *tmp * vert_kernel[j];
+  parallelForChunked(k_top, height - k_bottom, [&](const int chunk_begin, const int chunk_end) {
+    uint8_t* dst_line = dst_data + chunk_begin * dst_bpl + k_left - shift;
+    float* temp_line = temp_array.data() + (chunk_begin - k_top) * temp_stride - shift;
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      for (int i = shift; i < width; ++i) {
+        float sum = 0.0f;
+
+        float* tmp = temp_line + i;
+        for (int j = 0; j < kh; ++j, tmp += temp_stride) {
+          sum += *tmp * vert_kernel[j];
+        }
+        const auto val = static_cast<int>(sum);
+        dst_line[i] = static_cast<uint8_t>(qBound(0, val, 255));
       }
-      const auto val = static_cast<int>(sum);
-      dst_line[i] = static_cast<uint8_t>(qBound(0, val, 255));
-    }
 
-    temp_line += temp_stride;
-    dst_line += dst_bpl;
-  }
-#endif  // if 0
+      temp_line += temp_stride;
+      dst_line += dst_bpl;
+    }
+  });
 
   // Left area between two corners.
-  k_origin.setX(0);
-  k_origin.setY(k_center.y() + 1);
   for (int x = 0; x < k_left; ++x) {
     src_line = src_data;
     dst_line = dst_data + dst_bpl * k_top;
 
-    kernel.recalcForOrigin(k_origin);
+    const float* const kernel = kernels->kernelFor(x, k_center.y() + 1);
     for (int y = k_top; y < height - k_bottom; ++y) {
-      kernel.convolve(dst_line + x, src_line, src_bpl);
+      convolve(dst_line + x, kernel, kw, kh, src_line, src_bpl);
       src_line += src_bpl;
       dst_line += dst_bpl;
     }
-    k_origin.rx() += 1;
   }
   // Right area between two corners.
-  k_origin.setX(k_center.x() + 1);
-  k_origin.setY(k_center.y());
-  for (int x = width - k_right; x < width; ++x) {
-    src_line = src_data + width - kw;
-    dst_line = dst_data + dst_bpl * k_top;
-
-    kernel.recalcForOrigin(k_origin);
-    for (int y = k_top; y < height - k_bottom; ++y) {
-      kernel.convolve(dst_line + x, src_line, src_bpl);
-      src_line += src_bpl;
-      dst_line += dst_bpl;
+  {
+    int kx = k_center.x() + 1;
+    for (int x = width - k_right; x < width; ++x, ++kx) {
+      src_line = src_data + width - kw;
+      dst_line = dst_data + dst_bpl * k_top;
+
+      const float* const kernel = kernels->kernelFor(kx, k_center.y());
+      for (int y = k_top; y < height - k_bottom; ++y) {
+        convolve(dst_line + x, kernel, kw, kh, src_line, src_bpl);
+        src_line += src_bpl;
+        dst_line += dst_bpl;
+      }
     }
-    k_origin.rx() += 1;
   }
 
   // Bottom-left corner.
-  k_origin.setY(k_center.y() + 1);
   src_line = src_data + src_bpl * (height - kh);
   dst_line = dst_data + dst_bpl * (height - k_bottom);
-  for (int y = height - k_bottom; y < height; ++y, dst_line += dst_bpl) {
-    for (int x = 0; x < k_left; ++x) {
-      k_origin.setX(x);
-      kernel.recalcForOrigin(k_origin);
-      kernel.convolve(dst_line + x, src_line, src_bpl);
+  {
+    int ky = k_center.y() + 1;
+    for (int y = height - k_bottom; y < height; ++y, dst_line += dst_bpl, ++ky) {
+      for (int x = 0; x < k_left; ++x) {
+        convolve(dst_line + x, kernels->kernelFor(x, ky), kw, kh, src_line, src_bpl);
+      }
     }
-    k_origin.ry() += 1;
   }
 
   // Bottom area between two corners.
-  k_origin.setX(k_center.x());
-  k_origin.setY(k_center.y() + 1);
   src_line = src_data + src_bpl * (height - kh) - k_left;
   dst_line = dst_data + dst_bpl * (height - k_bottom);
-  for (int y = height - k_bottom; y < height; ++y, dst_line += dst_bpl) {
-    kernel.recalcForOrigin(k_origin);
-    for (int x = k_left; x < width - k_right; ++x) {
-      kernel.convolve(dst_line + x, src_line + x, src_bpl);
+  {
+    int ky = k_center.y() + 1;
+    for (int y = height - k_bottom; y < height; ++y, dst_line += dst_bpl, ++ky) {
+      const float* const kernel = kernels->kernelFor(k_center.x(), ky);
+      for (int x = k_left; x < width - k_right; ++x) {
+        convolve(dst_line + x, kernel, kw, kh, src_line + x, src_bpl);
+      }
     }
-    k_origin.ry() += 1;
   }
   // Bottom-right corner.
-  k_origin.setY(k_center.y() + 1);
   src_line = src_data + src_bpl * (height - kh) + (width - kw);
   dst_line = dst_data + dst_bpl * (height - k_bottom);
-  for (int y = height - k_bottom; y < height; ++y, dst_line += dst_bpl) {
-    k_origin.setX(k_center.x() + 1);
-    for (int x = width - k_right; x < width; ++x) {
-      kernel.recalcForOrigin(k_origin);
-      kernel.convolve(dst_line + x, src_line, src_bpl);
-      k_origin.rx() += 1;
+  {
+    int ky = k_center.y() + 1;
+    for (int y = height - k_bottom; y < height; ++y, dst_line += dst_bpl, ++ky) {
+      int kx = k_center.x() + 1;
+      for (int x = width - k_right; x < width; ++x, ++kx) {
+        convolve(dst_line + x, kernels->kernelFor(kx, ky), kw, kh, src_line, src_bpl);
+      }
     }
-    k_origin.ry() += 1;
   }
 
   return dst;
@@ -293,4 +363,4 @@ QImage savGolFilter(const QImage& src, const QSize& window_size, const int hor_d
 
   return savGolFilterGrayToGray(toGrayscale(src), window_size, hor_degree, vert_degree);
 }
-}  // namespace imageproc
\ No newline at end of file
+}  // namespace imageproc
@@ -17,10 +17,65 @@
  */
 
 #include "Scale.h"
+#include <algorithm>
 #include <cassert>
+#include <vector>
 #include "GrayImage.h"
+#include "ParallelFor.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IMAGEPROC_SCALE_AVX2 1
+#include <immintrin.h>
+#endif
 
 namespace imageproc {
+/**
+ * The cost of scaling is driven by whichever of the two images is larger,
+ * so both sizes participate in the "is it worth spawning threads" decision.
+ * Returns the max_threads argument for parallelForChunked().
+ */
+static int scaleMaxThreads(const QSize& src_size, const QSize& dst_size) {
+  const int64_t src_area = int64_t(src_size.width()) * src_size.height();
+  const int64_t dst_area = int64_t(dst_size.width()) * dst_size.height();
+  const int64_t parallel_threshold = int64_t(1) << 18;  // 256K pixels.
+
+  return std::max(src_area, dst_area) >= parallel_threshold ? 0 : 1;
+}
+
+static void accumulateLineScalar(uint32_t* sums, const uint8_t* line, const int len) {
+  for (int x = 0; x < len; ++x) {
+    sums[x] += line[x];
+  }
+}
+
+#ifdef IMAGEPROC_SCALE_AVX2
+__attribute__((target("avx2"))) static void accumulateLineAvx2(uint32_t* sums, const uint8_t* line, const int len) {
+  int x = 0;
+  for (; x + 8 <= len; x += 8) {
+    const __m256i pixels = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (line + x)));
+    const __m256i acc = _mm256_loadu_si256((const __m256i*) (sums + x));
+    _mm256_storeu_si256((__m256i*) (sums + x), _mm256_add_epi32(acc, pixels));
+  }
+  for (; x < len; ++x) {
+    sums[x] += line[x];
+  }
+}
+#endif
+
+/**
+ * Adds \p len bytes of \p line to the corresponding 32-bit \p sums.
+ * The inner loop of the box filter - dispatched to AVX2 when available.
+ */
+static void accumulateLine(uint32_t* sums, const uint8_t* line, const int len) {
+#ifdef IMAGEPROC_SCALE_AVX2
+  static void (*const kernel)(uint32_t*, const uint8_t*, int)
+      = __builtin_cpu_supports("avx2") ? &accumulateLineAvx2 : &accumulateLineScalar;
+  kernel(sums, line, len);
+#else
+  accumulateLineScalar(sums, line, len);
+#endif
+}
+
 /**
  * This is an optimized implementation for the case when every destination
  * pixel maps exactly to a M x N block of source pixels.
@@ -37,35 +92,42 @@ static GrayImage scaleDownIntGrayToGray(const GrayImage& src, const QSize& dst_s
 
   GrayImage dst(dst_size);
 
-  const uint8_t* src_line = src.data();
-  uint8_t* dst_line = dst.data();
+  const uint8_t* const src_data = src.data();
+  uint8_t* const dst_data = dst.data();
   const int src_stride = src.stride();
-  const int src_stride_scaled = src_stride * yscale;
   const int dst_stride = dst.stride();
 
-  int sy = 0;
-  int dy = 0;
-  for (; dy < dh; ++dy, sy += yscale) {
-    int sx = 0;
-    int dx = 0;
-    for (; dx < dw; ++dx, sx += xscale) {
-      unsigned gray_level = 0;
-      const uint8_t* psrc = src_line + sx;
-
-      for (int i = 0; i < yscale; ++i, psrc += src_stride) {
-        for (int j = 0; j < xscale; ++j) {
-          gray_level += psrc[j];
-        }
-      }
+  parallelForChunked(
+      0, dh,
+      [&](const int chunk_begin, const int chunk_end) {
+        // Column sums over the yscale source rows contributing to one
+        // destination row.  Summing whole contiguous lines vectorizes,
+        // unlike walking M x N blocks pixel by pixel.
+        std::vector<uint32_t> col_sums(dw * xscale);
+
+        for (int dy = chunk_begin; dy < chunk_end; ++dy) {
+          const uint8_t* src_line = src_data + dy * yscale * src_stride;
+          uint8_t* const dst_line = dst_data + dy * dst_stride;
+
+          std::fill(col_sums.begin(), col_sums.end(), uint32_t(0));
+          for (int i = 0; i < yscale; ++i, src_line += src_stride) {
+            accumulateLine(&col_sums[0], src_line, dw * xscale);
+          }
 
-      const unsigned pix_value = (gray_level + (total_area >> 1)) / total_area;
-      assert(pix_value < 256);
-      dst_line[dx] = static_cast<uint8_t>(pix_value);
-    }
+          const uint32_t* psum = &col_sums[0];
+          for (int dx = 0; dx < dw; ++dx, psum += xscale) {
+            unsigned gray_level = 0;
+            for (int j = 0; j < xscale; ++j) {
+              gray_level += psum[j];
+            }
 
-    src_line += src_stride_scaled;
-    dst_line += dst_stride;
-  }
+            const unsigned pix_value = (gray_level + (total_area >> 1)) / total_area;
+            assert(pix_value < 256);
+            dst_line[dx] = static_cast<uint8_t>(pix_value);
+          }
+        }
+      },
+      scaleMaxThreads(src.size(), dst_size));
 
   return dst;
 }  // scaleDownIntGrayToGray
@@ -85,31 +147,39 @@ static GrayImage scaleUpIntGrayToGray(const GrayImage& src, const QSize& dst_siz
 
   GrayImage dst(dst_size);
 
-  const uint8_t* src_line = src.data();
-  uint8_t* dst_line = dst.data();
+  const uint8_t* const src_data = src.data();
+  uint8_t* const dst_data = dst.data();
   const int src_stride = src.stride();
   const int dst_stride = dst.stride();
   const int dst_stride_scaled = dst_stride * yscale;
 
-  int sy = 0;
-  int dy = 0;
-  for (; dy < dh; ++sy, dy += xscale) {
-    int sx = 0;
-    int dx = 0;
-
-    for (; dx < dw; ++sx, dx += xscale) {
-      uint8_t* pdst = dst_line + dx;
+  // Each source row expands into its own band of yscale destination rows,
+  // so bands can be filled independently.
+  parallelForChunked(
+      0, sh,
+      [&](const int chunk_begin, const int chunk_end) {
+        const uint8_t* src_line = src_data + chunk_begin * src_stride;
+        uint8_t* dst_line = dst_data + chunk_begin * dst_stride_scaled;
+
+        for (int sy = chunk_begin; sy < chunk_end; ++sy) {
+          int sx = 0;
+          int dx = 0;
+
+          for (; dx < dw; ++sx, dx += xscale) {
+            uint8_t* pdst = dst_line + dx;
+
+            for (int i = 0; i < yscale; ++i, pdst += dst_stride) {
+              for (int j = 0; j < xscale; ++j) {
+                pdst[j] = src_line[sx];
+              }
+            }
+          }
 
-      for (int i = 0; i < yscale; ++i, pdst += dst_stride) {
-        for (int j = 0; j < xscale; ++j) {
-          pdst[j] = src_line[sx];
+          src_line += src_stride;
+          dst_line += dst_stride_scaled;
         }
-      }
-    }
-
-    src_line += src_stride;
-    dst_line += dst_stride_scaled;
-  }
+      },
+      scaleMaxThreads(src.size(), dst_size));
 
   return dst;
 }  // scaleUpIntGrayToGray
@@ -152,41 +222,48 @@ static GrayImage scaleUpGrayToGray(const GrayImage& src, const QSize& dst_size)
   GrayImage dst(dst_size);
 
   const uint8_t* const src_data = src.data();
-  uint8_t* dst_line = dst.data();
+  uint8_t* const dst_data = dst.data();
   const int src_stride = src.stride();
   const int dst_stride = dst.stride();
 
-  for (int dy = 0; dy < dh; ++dy, dst_line += dst_stride) {
-    const auto sy32 = (int) (dy * dy2sy32);
-    const int sy = sy32 >> 5;
-    const unsigned top_fraction = 32 - (sy32 & 31);
-    const unsigned bottom_fraction = sy32 & 31;
-    assert(sy + 1 < sh);  // calc32xRatio1() ensures that.
-    const uint8_t* src_line = src_data + sy * src_stride;
-
-    for (int dx = 0; dx < dw; ++dx) {
-      const auto sx32 = (int) (dx * dx2sx32);
-      const int sx = sx32 >> 5;
-      const unsigned left_fraction = 32 - (sx32 & 31);
-      const unsigned right_fraction = sx32 & 31;
-      assert(sx + 1 < sw);  // calc32xRatio1() ensures that.
-      unsigned gray_level = 0;
-
-      const uint8_t* psrc = src_line + sx;
-      gray_level += *psrc * left_fraction * top_fraction;
-      ++psrc;
-      gray_level += *psrc * right_fraction * top_fraction;
-      psrc += src_stride;
-      gray_level += *psrc * right_fraction * bottom_fraction;
-      --psrc;
-      gray_level += *psrc * left_fraction * bottom_fraction;
-
-      const unsigned total_area = 32 * 32;
-      const unsigned pix_value = (gray_level + (total_area >> 1)) / total_area;
-      assert(pix_value < 256);
-      dst_line[dx] = static_cast<uint8_t>(pix_value);
-    }
-  }
+  parallelForChunked(
+      0, dh,
+      [&](const int chunk_begin, const int chunk_end) {
+        uint8_t* dst_line = dst_data + chunk_begin * dst_stride;
+
+        for (int dy = chunk_begin; dy < chunk_end; ++dy, dst_line += dst_stride) {
+          const auto sy32 = (int) (dy * dy2sy32);
+          const int sy = sy32 >> 5;
+          const unsigned top_fraction = 32 - (sy32 & 31);
+          const unsigned bottom_fraction = sy32 & 31;
+          assert(sy + 1 < sh);  // calc32xRatio1() ensures that.
+          const uint8_t* src_line = src_data + sy * src_stride;
+
+          for (int dx = 0; dx < dw; ++dx) {
+            const auto sx32 = (int) (dx * dx2sx32);
+            const int sx = sx32 >> 5;
+            const unsigned left_fraction = 32 - (sx32 & 31);
+            const unsigned right_fraction = sx32 & 31;
+            assert(sx + 1 < sw);  // calc32xRatio1() ensures that.
+            unsigned gray_level = 0;
+
+            const uint8_t* psrc = src_line + sx;
+            gray_level += *psrc * left_fraction * top_fraction;
+            ++psrc;
+            gray_level += *psrc * right_fraction * top_fraction;
+            psrc += src_stride;
+            gray_level += *psrc * right_fraction * bottom_fraction;
+            --psrc;
+            gray_level += *psrc * left_fraction * bottom_fraction;
+
+            const unsigned total_area = 32 * 32;
+            const unsigned pix_value = (gray_level + (total_area >> 1)) / total_area;
+            assert(pix_value < 256);
+            dst_line[dx] = static_cast<uint8_t>(pix_value);
+          }
+        }
+      },
+      scaleMaxThreads(src.size(), dst_size));
 
   return dst;
 }  // scaleUpGrayToGray
@@ -238,124 +315,131 @@ static GrayImage scaleGrayToGray(const GrayImage& src, const QSize& dst_size) {
   GrayImage dst(dst_size);
 
   const uint8_t* const src_data = src.data();
-  uint8_t* dst_line = dst.data();
+  uint8_t* const dst_data = dst.data();
   const int src_stride = src.stride();
   const int dst_stride = dst.stride();
 
-  int sy32bottom = 0;
-  for (int dy1 = 1; dy1 <= dh; ++dy1, dst_line += dst_stride) {
-    const int sy32top = sy32bottom;
-    sy32bottom = (int) (dy1 * dy2sy32);
-    const int sytop = sy32top >> 5;
-    const int sybottom = (sy32bottom - 1) >> 5;
-    const unsigned top_fraction = 32 - (sy32top & 31);
-    const unsigned bottom_fraction = sy32bottom - (sybottom << 5);
-    assert(sybottom < sh);  // calc32xRatio2() ensures that.
-    const unsigned top_area = top_fraction << 5;
-    const unsigned bottom_area = bottom_fraction << 5;
-
-    const uint8_t* const src_line_const = src_data + sytop * src_stride;
-
-    int sx32right = 0;
-    for (int dx = 0; dx < dw; ++dx) {
-      const int sx32left = sx32right;
-      sx32right = (int) ((dx + 1) * dx2sx32);
-      const int sxleft = sx32left >> 5;
-      const int sxright = (sx32right - 1) >> 5;
-      const unsigned left_fraction = 32 - (sx32left & 31);
-      const unsigned right_fraction = sx32right - (sxright << 5);
-      assert(sxright < sw);  // calc32xRatio2() ensures that.
-      const uint8_t* src_line = src_line_const;
-      unsigned gray_level = 0;
-
-      if (sytop == sybottom) {
-        if (sxleft == sxright) {
-          // dst pixel maps to a single src pixel
-          dst_line[dx] = src_line[sxleft];
-          continue;
-        } else {
-          // dst pixel maps to a horizontal line of src pixels
-          const unsigned vert_fraction = sy32bottom - sy32top;
-          const unsigned left_area = vert_fraction * left_fraction;
-          const unsigned middle_area = vert_fraction << 5;
-          const unsigned right_area = vert_fraction * right_fraction;
-
-          gray_level += src_line[sxleft] * left_area;
-
-          for (int sx = sxleft + 1; sx < sxright; ++sx) {
-            gray_level += src_line[sx] * middle_area;
-          }
-
-          gray_level += src_line[sxright] * right_area;
-        }
-      } else if (sxleft == sxright) {
-        // dst pixel maps to a vertical line of src pixels
-        const unsigned hor_fraction = sx32right - sx32left;
-        const unsigned top_area = hor_fraction * top_fraction;
-        const unsigned middle_area = hor_fraction << 5;
-        const unsigned bottom_area = hor_fraction * bottom_fraction;
-
-        gray_level += src_line[sxleft] * top_area;
-
-        src_line += src_stride;
-
-        for (int sy = sytop + 1; sy < sybottom; ++sy) {
-          gray_level += src_line[sxleft] * middle_area;
-          src_line += src_stride;
-        }
-
-        gray_level += src_line[sxleft] * bottom_area;
-      } else {
-        // dst pixel maps to a block of src pixels
-        const unsigned left_area = left_fraction << 5;
-        const unsigned right_area = right_fraction << 5;
-        const unsigned topleft_area = top_fraction * left_fraction;
-        const unsigned topright_area = top_fraction * right_fraction;
-        const unsigned bottomleft_area = bottom_fraction * left_fraction;
-        const unsigned bottomright_area = bottom_fraction * right_fraction;
-
-        // process the top-left corner
-        gray_level += src_line[sxleft] * topleft_area;
-
-        // process the top line (without corners)
-        for (int sx = sxleft + 1; sx < sxright; ++sx) {
-          gray_level += src_line[sx] * top_area;
-        }
-
-        // process the top-right corner
-        gray_level += src_line[sxright] * topright_area;
-
-        src_line += src_stride;
-        // process middle lines
-        for (int sy = sytop + 1; sy < sybottom; ++sy) {
-          gray_level += src_line[sxleft] * left_area;
-
-          for (int sx = sxleft + 1; sx < sxright; ++sx) {
-            gray_level += src_line[sx] << (5 + 5);
+  parallelForChunked(
+      1, dh + 1,
+      [&](const int chunk_begin, const int chunk_end) {
+        uint8_t* dst_line = dst_data + (chunk_begin - 1) * dst_stride;
+
+        int sy32bottom = (int) ((chunk_begin - 1) * dy2sy32);
+        for (int dy1 = chunk_begin; dy1 < chunk_end; ++dy1, dst_line += dst_stride) {
+          const int sy32top = sy32bottom;
+          sy32bottom = (int) (dy1 * dy2sy32);
+          const int sytop = sy32top >> 5;
+          const int sybottom = (sy32bottom - 1) >> 5;
+          const unsigned top_fraction = 32 - (sy32top & 31);
+          const unsigned bottom_fraction = sy32bottom - (sybottom << 5);
+          assert(sybottom < sh);  // calc32xRatio2() ensures that.
+          const unsigned top_area = top_fraction << 5;
+          const unsigned bottom_area = bottom_fraction << 5;
+
+          const uint8_t* const src_line_const = src_data + sytop * src_stride;
+
+          int sx32right = 0;
+          for (int dx = 0; dx < dw; ++dx) {
+            const int sx32left = sx32right;
+            sx32right = (int) ((dx + 1) * dx2sx32);
+            const int sxleft = sx32left >> 5;
+            const int sxright = (sx32right - 1) >> 5;
+            const unsigned left_fraction = 32 - (sx32left & 31);
+            const unsigned right_fraction = sx32right - (sxright << 5);
+            assert(sxright < sw);  // calc32xRatio2() ensures that.
+            const uint8_t* src_line = src_line_const;
+            unsigned gray_level = 0;
+
+            if (sytop == sybottom) {
+              if (sxleft == sxright) {
+                // dst pixel maps to a single src pixel
+                dst_line[dx] = src_line[sxleft];
+                continue;
+              } else {
+                // dst pixel maps to a horizontal line of src pixels
+                const unsigned vert_fraction = sy32bottom - sy32top;
+                const unsigned left_area = vert_fraction * left_fraction;
+                const unsigned middle_area = vert_fraction << 5;
+                const unsigned right_area = vert_fraction * right_fraction;
+
+                gray_level += src_line[sxleft] * left_area;
+
+                for (int sx = sxleft + 1; sx < sxright; ++sx) {
+                  gray_level += src_line[sx] * middle_area;
+                }
+
+                gray_level += src_line[sxright] * right_area;
+              }
+            } else if (sxleft == sxright) {
+              // dst pixel maps to a vertical line of src pixels
+              const unsigned hor_fraction = sx32right - sx32left;
+              const unsigned top_area = hor_fraction * top_fraction;
+              const unsigned middle_area = hor_fraction << 5;
+              const unsigned bottom_area = hor_fraction * bottom_fraction;
+
+              gray_level += src_line[sxleft] * top_area;
+
+              src_line += src_stride;
+
+              for (int sy = sytop + 1; sy < sybottom; ++sy) {
+                gray_level += src_line[sxleft] * middle_area;
+                src_line += src_stride;
+              }
+
+              gray_level += src_line[sxleft] * bottom_area;
+            } else {
+              // dst pixel maps to a block of src pixels
+              const unsigned left_area = left_fraction << 5;
+              const unsigned right_area = right_fraction << 5;
+              const unsigned topleft_area = top_fraction * left_fraction;
+              const unsigned topright_area = top_fraction * right_fraction;
+              const unsigned bottomleft_area = bottom_fraction * left_fraction;
+              const unsigned bottomright_area = bottom_fraction * right_fraction;
+
+              // process the top-left corner
+              gray_level += src_line[sxleft] * topleft_area;
+
+              // process the top line (without corners)
+              for (int sx = sxleft + 1; sx < sxright; ++sx) {
+                gray_level += src_line[sx] * top_area;
+              }
+
+              // process the top-right corner
+              gray_level += src_line[sxright] * topright_area;
+
+              src_line += src_stride;
+              // process middle lines
+              for (int sy = sytop + 1; sy < sybottom; ++sy) {
+                gray_level += src_line[sxleft] * left_area;
+
+                for (int sx = sxleft + 1; sx < sxright; ++sx) {
+                  gray_level += src_line[sx] << (5 + 5);
+                }
+
+                gray_level += src_line[sxright] * right_area;
+
+                src_line += src_stride;
+              }
+
+              // process bottom-left corner
+              gray_level += src_line[sxleft] * bottomleft_area;
+
+              // process the bottom line (without corners)
+              for (int sx = sxleft + 1; sx < sxright; ++sx) {
+                gray_level += src_line[sx] * bottom_area;
+              }
+              // process the bottom-right corner
+              gray_level += src_line[sxright] * bottomright_area;
+            }
+
+            const unsigned total_area = (sy32bottom - sy32top) * (sx32right - sx32left);
+            const unsigned pix_value = (gray_level + (total_area >> 1)) / total_area;
+            assert(pix_value < 256);
+            dst_line[dx] = static_cast<uint8_t>(pix_value);
           }
-
-          gray_level += src_line[sxright] * right_area;
-
-          src_line += src_stride;
-        }
-
-        // process bottom-left corner
-        gray_level += src_line[sxleft] * bottomleft_area;
-
-        // process the bottom line (without corners)
-        for (int sx = sxleft + 1; sx < sxright; ++sx) {
-          gray_level += src_line[sx] * bottom_area;
         }
-        // process the bottom-right corner
-        gray_level += src_line[sxright] * bottomright_area;
-      }
-
-      const unsigned total_area = (sy32bottom - sy32top) * (sx32right - sx32left);
-      const unsigned pix_value = (gray_level + (total_area >> 1)) / total_area;
-      assert(pix_value < 256);
-      dst_line[dx] = static_cast<uint8_t>(pix_value);
-    }
-  }
+      },
+      scaleMaxThreads(src.size(), dst_size));
 
   return dst;
 }  // scaleGrayToGray
@@ -375,4 +459,4 @@ GrayImage scaleToGray(const GrayImage& src, const QSize& dst_size) {
 
   return scaleGrayToGray(src, dst_size);
 }
-}  // namespace imageproc
\ No newline at end of file
+}  // namespace imageproc
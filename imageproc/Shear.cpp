@@ -19,6 +19,7 @@
 #include "Shear.h"
 #include <cassert>
 #include <cmath>
+#include "Constants.h"
 #include "RasterOp.h"
 
 namespace imageproc {
@@ -185,4 +186,28 @@ void hShearInPlace(BinaryImage& image, const double shear, const double y_origin
 void vShearInPlace(BinaryImage& image, const double shear, const double x_origin, const BWColor background_color) {
   vShearFromTo(image, image, shear, x_origin, background_color);
 }
+
+BinaryImage shearRotation(const BinaryImage& src, const double degrees, const BWColor background_color) {
+  if (src.isNull()) {
+    throw std::invalid_argument("Can't rotate a null image");
+  }
+  if (std::fabs(degrees) > 45.0) {
+    throw std::invalid_argument("shearRotation: the angle is too steep for a shear-based rotation");
+  }
+
+  // R(a) = H(-tan(a/2)) * V(sin(a)) * H(-tan(a/2)), where H and V
+  // are horizontal and vertical shear matrices.
+  const double radians = degrees * constants::DEG2RAD;
+  const double h_shear = -std::tan(0.5 * radians);
+  const double v_shear = std::sin(radians);
+  const double y_origin = 0.5 * src.height();
+  const double x_origin = 0.5 * src.width();
+
+  BinaryImage dst(src);
+  hShearInPlace(dst, h_shear, y_origin, background_color);
+  vShearInPlace(dst, v_shear, x_origin, background_color);
+  hShearInPlace(dst, h_shear, y_origin, background_color);
+
+  return dst;
+}
 }  // namespace imageproc
\ No newline at end of file
@@ -82,5 +82,23 @@ void hShearInPlace(BinaryImage& image, double shear, double y_origin, BWColor ba
  * Same as vShearFromTo() with src and dst being the same image.
  */
 void vShearInPlace(BinaryImage& image, double shear, double x_origin, BWColor background_color);
+
+/**
+ * \brief Rotation about the image center built from three shears.
+ *
+ * The rotation is decomposed into a horizontal shear, a vertical shear
+ * and another horizontal shear, each of which moves pixels in whole
+ * rows or columns.  That makes it much faster than resampling, at the
+ * cost of edges being off by a pixel here and there.  It's intended
+ * for the small rotation angles involved in deskewing.
+ *
+ * \param src The source image.
+ * \param degrees The rotation angle.  Positive values rotate clockwise.
+ *        Must not exceed 45 degrees in either direction.
+ * \param background_color The color used to fill areas not represented
+ *        in the source image.
+ * \return The rotated image of the same size as the source one.
+ */
+BinaryImage shearRotation(const BinaryImage& src, double degrees, BWColor background_color);
 }  // namespace imageproc
 #endif
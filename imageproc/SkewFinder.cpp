@@ -19,9 +19,11 @@
 #include "SkewFinder.h"
 #include <QDebug>
 #include <cmath>
+#include <vector>
 #include "BinaryImage.h"
 #include "BitOps.h"
 #include "Constants.h"
+#include "ParallelFor.h"
 #include "ReduceThreshold.h"
 #include "Shear.h"
 
@@ -94,20 +96,32 @@ Skew SkewFinder::findSkew(const BinaryImage& image) const {
     coarse_reduced.reduce(i == 0 ? 1 : 2);
   }
 
-  BinaryImage skewed(coarse_reduced.image().size());
   const double coarse_step = 1.0;  // degrees
-  // Coarse linear search.
-  int num_coarse_scores = 0;
+  // Coarse linear sweep.  The candidate angles are independent of each
+  // other, so they are scored in parallel, each thread shearing into
+  // its own buffer.
+  std::vector<double> coarse_angles;
+  for (double angle = -m_maxAngle; angle <= m_maxAngle; angle += coarse_step) {
+    coarse_angles.push_back(angle);
+  }
+
+  std::vector<double> coarse_scores(coarse_angles.size(), 0.0);
+  parallelForChunked(0, static_cast<int>(coarse_angles.size()), [&](const int chunk_begin, const int chunk_end) {
+    BinaryImage sheared(coarse_reduced.image().size());
+    for (int i = chunk_begin; i < chunk_end; ++i) {
+      coarse_scores[i] = process(coarse_reduced, sheared, coarse_angles[i]);
+    }
+  });
+
+  const int num_coarse_scores = static_cast<int>(coarse_scores.size());
   double sum_coarse_scores = 0.0;
   double best_coarse_score = 0.0;
   double best_coarse_angle = -m_maxAngle;
-  for (double angle = -m_maxAngle; angle <= m_maxAngle; angle += coarse_step) {
-    const double score = process(coarse_reduced, skewed, angle);
-    sum_coarse_scores += score;
-    ++num_coarse_scores;
-    if (score > best_coarse_score) {
-      best_coarse_angle = angle;
-      best_coarse_score = score;
+  for (int i = 0; i < num_coarse_scores; ++i) {
+    sum_coarse_scores += coarse_scores[i];
+    if (coarse_scores[i] > best_coarse_score) {
+      best_coarse_angle = coarse_angles[i];
+      best_coarse_score = coarse_scores[i];
     }
   }
 
@@ -124,23 +138,33 @@ Skew SkewFinder::findSkew(const BinaryImage& image) const {
     fine_reduced.reduce(i == 0 ? 1 : 2);
   }
 
-  if (m_coarseReduction != m_fineReduction) {
-    skewed = BinaryImage(fine_reduced.image().size());
-  }
-  // Fine binary search.
-  double angle_plus = best_coarse_angle + 0.5 * coarse_step;
-  double angle_minus = best_coarse_angle - 0.5 * coarse_step;
-  double score_plus = process(fine_reduced, skewed, angle_plus);
-  double score_minus = process(fine_reduced, skewed, angle_minus);
-  const double fine_score1 = score_plus;
-  const double fine_score2 = score_minus;
-  while (angle_plus - angle_minus > m_accuracy) {
-    if (score_plus > score_minus) {
-      angle_minus = 0.5 * (angle_plus + angle_minus);
-      score_minus = process(fine_reduced, skewed, angle_minus);
-    } else if (score_plus < score_minus) {
-      angle_plus = 0.5 * (angle_plus + angle_minus);
-      score_plus = process(fine_reduced, skewed, angle_plus);
+  BinaryImage skewed(fine_reduced.image().size());
+
+  // Golden-section refinement around the coarse peak.  The score is
+  // assumed to be unimodal within the bracket, which golden-section
+  // narrows with a single rotate+score evaluation per iteration.
+  const double inv_phi = 0.5 * (std::sqrt(5.0) - 1.0);
+  double lo = best_coarse_angle - 0.5 * coarse_step;
+  double hi = best_coarse_angle + 0.5 * coarse_step;
+  double angle1 = hi - inv_phi * (hi - lo);
+  double angle2 = lo + inv_phi * (hi - lo);
+  double score1 = process(fine_reduced, skewed, angle1);
+  double score2 = process(fine_reduced, skewed, angle2);
+  const double fine_score1 = score1;
+  const double fine_score2 = score2;
+  while (hi - lo > m_accuracy) {
+    if (score1 > score2) {
+      hi = angle2;
+      angle2 = angle1;
+      score2 = score1;
+      angle1 = hi - inv_phi * (hi - lo);
+      score1 = process(fine_reduced, skewed, angle1);
+    } else if (score1 < score2) {
+      lo = angle1;
+      angle1 = angle2;
+      score1 = score2;
+      angle2 = lo + inv_phi * (hi - lo);
+      score2 = process(fine_reduced, skewed, angle2);
     } else {
       // This protects us from unreasonably low m_accuracy.
       break;
@@ -149,12 +173,12 @@ Skew SkewFinder::findSkew(const BinaryImage& image) const {
 
   double best_angle;
   double best_score;
-  if (score_plus > score_minus) {
-    best_angle = angle_plus;
-    best_score = score_plus;
+  if (score1 > score2) {
+    best_angle = angle1;
+    best_score = score1;
   } else {
-    best_angle = angle_minus;
-    best_score = score_minus;
+    best_angle = angle2;
+    best_score = score2;
   }
 
   if (best_score <= LOW_SCORE) {
@@ -0,0 +1,253 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Sobel.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "ParallelFor.h"
+
+namespace imageproc {
+namespace {
+/** t = left + 2*mid + right along the row, with replicated edges. */
+template <typename SrcPixel>
+void horizontalAccumulateRow(const SrcPixel* const s, float* const t, const int width) {
+  if (width == 1) {
+    t[0] = 4.0f * float(s[0]);
+
+    return;
+  }
+
+  t[0] = 3.0f * float(s[0]) + float(s[1]);
+  for (int x = 1; x < width - 1; ++x) {
+    t[x] = float(s[x - 1]) + 2.0f * float(s[x]) + float(s[x + 1]);
+  }
+  t[width - 1] = float(s[width - 2]) + 3.0f * float(s[width - 1]);
+}
+
+/** d = (right - left) * scale [+ d * dst_factor] along the row. */
+void horizontalDiffRow(const float* const t,
+                       float* const d,
+                       const int width,
+                       const float scale,
+                       const float dst_factor) {
+  // The dst_factor == 0 case gets its own loop: dst may be uninitialized,
+  // and 0 * NaN would not be 0.
+  if (width == 1) {
+    d[0] = (dst_factor == 0.0f) ? 0.0f : d[0] * dst_factor;
+
+    return;
+  }
+
+  if (dst_factor == 0.0f) {
+    d[0] = (t[1] - t[0]) * scale;
+    for (int x = 1; x < width - 1; ++x) {
+      d[x] = (t[x + 1] - t[x - 1]) * scale;
+    }
+    d[width - 1] = (t[width - 1] - t[width - 2]) * scale;
+  } else {
+    d[0] = d[0] * dst_factor + (t[1] - t[0]) * scale;
+    for (int x = 1; x < width - 1; ++x) {
+      d[x] = d[x] * dst_factor + (t[x + 1] - t[x - 1]) * scale;
+    }
+    d[width - 1] = d[width - 1] * dst_factor + (t[width - 1] - t[width - 2]) * scale;
+  }
+}
+
+/** d = (bottom - top) * scale [+ d * dst_factor] along the row. */
+void verticalDiffRow(const float* const top,
+                     const float* const bottom,
+                     float* const d,
+                     const int width,
+                     const float scale,
+                     const float dst_factor) {
+  if (dst_factor == 0.0f) {
+    for (int x = 0; x < width; ++x) {
+      d[x] = (bottom[x] - top[x]) * scale;
+    }
+  } else {
+    for (int x = 0; x < width; ++x) {
+      d[x] = d[x] * dst_factor + (bottom[x] - top[x]) * scale;
+    }
+  }
+}
+
+template <typename SrcPixel>
+void horizontalSobelImpl(const int width,
+                         const int height,
+                         const SrcPixel* const src,
+                         const int src_stride,
+                         const float sobel_scale,
+                         float* const tmp,
+                         const int tmp_stride,
+                         float* const dst,
+                         const int dst_stride,
+                         const float dst_factor) {
+  if ((width <= 0) || (height <= 0)) {
+    return;
+  }
+
+  // Vertical pre-accumulation pass: tmp = top + 2*mid + bottom.  Unlike
+  // the generic template, which walks this pass column by column, both
+  // passes here go row by row over contiguous memory, so they vectorize
+  // and stay cache-friendly on page-sized grids.
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      const SrcPixel* const top = src + std::max(y - 1, 0) * src_stride;
+      const SrcPixel* const mid = src + y * src_stride;
+      const SrcPixel* const bottom = src + std::min(y + 1, height - 1) * src_stride;
+      float* const t = tmp + y * tmp_stride;
+      for (int x = 0; x < width; ++x) {
+        t[x] = float(top[x]) + 2.0f * float(mid[x]) + float(bottom[x]);
+      }
+    }
+  });
+
+  // Horizontal differencing pass: dst = (right - left) * scale.
+  if (dst == tmp) {
+    // Writing a row would destroy the left neighbours of the next
+    // pixels, so stage each row through a scratch buffer.
+    std::vector<float> row(width);
+    for (int y = 0; y < height; ++y) {
+      const float* const t = tmp + y * tmp_stride;
+      std::copy(t, t + width, row.begin());
+      horizontalDiffRow(row.data(), dst + y * dst_stride, width, sobel_scale, dst_factor);
+    }
+  } else {
+    parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+      for (int y = chunk_begin; y < chunk_end; ++y) {
+        horizontalDiffRow(tmp + y * tmp_stride, dst + y * dst_stride, width, sobel_scale, dst_factor);
+      }
+    });
+  }
+}
+
+template <typename SrcPixel>
+void verticalSobelImpl(const int width,
+                       const int height,
+                       const SrcPixel* const src,
+                       const int src_stride,
+                       const float sobel_scale,
+                       float* const tmp,
+                       const int tmp_stride,
+                       float* const dst,
+                       const int dst_stride,
+                       const float dst_factor) {
+  if ((width <= 0) || (height <= 0)) {
+    return;
+  }
+
+  // Horizontal pre-accumulation pass: tmp = left + 2*mid + right.
+  // A row only reads its own source row, so tmp aliasing src is fine
+  // as long as the row is staged through a scratch buffer.
+  const bool tmp_aliases_src = (static_cast<const void*>(tmp) == static_cast<const void*>(src));
+  parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+    std::vector<float> scratch(tmp_aliases_src ? width : 0);
+    for (int y = chunk_begin; y < chunk_end; ++y) {
+      const SrcPixel* const s = src + y * src_stride;
+      float* const t = tmp + y * tmp_stride;
+      if (tmp_aliases_src) {
+        for (int x = 0; x < width; ++x) {
+          scratch[x] = float(s[x]);
+        }
+        horizontalAccumulateRow(scratch.data(), t, width);
+      } else {
+        horizontalAccumulateRow(s, t, width);
+      }
+    }
+  });
+
+  // Vertical differencing pass: dst = (bottom - top) * scale.
+  if (dst == tmp) {
+    // Writing row y destroys the top neighbour of row y + 1, so carry
+    // a copy of the previous row along.
+    std::vector<float> top_buf(width);
+    std::vector<float> cur_buf(width);
+    for (int y = 0; y < height; ++y) {
+      const float* const cur = tmp + y * tmp_stride;
+      std::copy(cur, cur + width, cur_buf.begin());
+      const float* const top = (y == 0) ? cur_buf.data() : top_buf.data();
+      const float* const bottom = (y == height - 1) ? cur_buf.data() : tmp + (y + 1) * tmp_stride;
+      verticalDiffRow(top, bottom, dst + y * dst_stride, width, sobel_scale, dst_factor);
+      top_buf.swap(cur_buf);
+    }
+  } else {
+    parallelForChunked(0, height, [&](const int chunk_begin, const int chunk_end) {
+      for (int y = chunk_begin; y < chunk_end; ++y) {
+        const float* const top = tmp + std::max(y - 1, 0) * tmp_stride;
+        const float* const bottom = tmp + std::min(y + 1, height - 1) * tmp_stride;
+        verticalDiffRow(top, bottom, dst + y * dst_stride, width, sobel_scale, dst_factor);
+      }
+    });
+  }
+}
+}  // namespace
+
+void horizontalSobel(const int width,
+                     const int height,
+                     const uint8_t* const src,
+                     const int src_stride,
+                     const float sobel_scale,
+                     float* const tmp,
+                     const int tmp_stride,
+                     float* const dst,
+                     const int dst_stride,
+                     const float dst_factor) {
+  horizontalSobelImpl(width, height, src, src_stride, sobel_scale, tmp, tmp_stride, dst, dst_stride, dst_factor);
+}
+
+void horizontalSobel(const int width,
+                     const int height,
+                     const float* const src,
+                     const int src_stride,
+                     const float sobel_scale,
+                     float* const tmp,
+                     const int tmp_stride,
+                     float* const dst,
+                     const int dst_stride,
+                     const float dst_factor) {
+  horizontalSobelImpl(width, height, src, src_stride, sobel_scale, tmp, tmp_stride, dst, dst_stride, dst_factor);
+}
+
+void verticalSobel(const int width,
+                   const int height,
+                   const uint8_t* const src,
+                   const int src_stride,
+                   const float sobel_scale,
+                   float* const tmp,
+                   const int tmp_stride,
+                   float* const dst,
+                   const int dst_stride,
+                   const float dst_factor) {
+  verticalSobelImpl(width, height, src, src_stride, sobel_scale, tmp, tmp_stride, dst, dst_stride, dst_factor);
+}
+
+void verticalSobel(const int width,
+                   const int height,
+                   const float* const src,
+                   const int src_stride,
+                   const float sobel_scale,
+                   float* const tmp,
+                   const int tmp_stride,
+                   float* const dst,
+                   const int dst_stride,
+                   const float dst_factor) {
+  verticalSobelImpl(width, height, src, src_stride, sobel_scale, tmp, tmp_stride, dst, dst_stride, dst_factor);
+}
+}  // namespace imageproc
@@ -19,6 +19,8 @@
 #ifndef IMAGEPROC_SOBEL_H_
 #define IMAGEPROC_SOBEL_H_
 
+#include <cstdint>
+
 /**
  * \file
  *
@@ -122,6 +124,72 @@ void verticalSobel(int width,
                    int dst_stride,
                    DstWriter dst_writer);
 
+/**
+ * \brief Optimized gradient for the common image-to-float-grid case.
+ *
+ * Equivalent to the generic template with a source reader of
+ * "_1 * sobel_scale" and plain writers, but both passes traverse rows
+ * of contiguous memory, which the generic template cannot do for its
+ * column pass.  The loops vectorize and the rows are processed in
+ * parallel, which matters on the full-page grids the dewarping
+ * estimators work with.  The typical "combine with what's already in
+ * dst" final writer is folded in as well:
+ * \code
+ * dst = dst * dst_factor + sobel * sobel_scale
+ * \endcode
+ * with dst_factor 0 (the default) meaning a plain overwrite even if
+ * dst is uninitialized.
+ *
+ * \p tmp may equal \p dst; for verticalSobel() it may equal \p src
+ * as well.  Partial overlaps are not supported.
+ */
+void horizontalSobel(int width,
+                     int height,
+                     const uint8_t* src,
+                     int src_stride,
+                     float sobel_scale,
+                     float* tmp,
+                     int tmp_stride,
+                     float* dst,
+                     int dst_stride,
+                     float dst_factor = 0.0f);
+
+/** \see the uint8_t overload above. */
+void horizontalSobel(int width,
+                     int height,
+                     const float* src,
+                     int src_stride,
+                     float sobel_scale,
+                     float* tmp,
+                     int tmp_stride,
+                     float* dst,
+                     int dst_stride,
+                     float dst_factor = 0.0f);
+
+/** \see the uint8_t overload of horizontalSobel(). */
+void verticalSobel(int width,
+                   int height,
+                   const uint8_t* src,
+                   int src_stride,
+                   float sobel_scale,
+                   float* tmp,
+                   int tmp_stride,
+                   float* dst,
+                   int dst_stride,
+                   float dst_factor = 0.0f);
+
+/** \see the uint8_t overload of horizontalSobel(). */
+void verticalSobel(int width,
+                   int height,
+                   const float* src,
+                   int src_stride,
+                   float sobel_scale,
+                   float* tmp,
+                   int tmp_stride,
+                   float* dst,
+                   int dst_stride,
+                   float dst_factor = 0.0f);
+
 
 template <typename T,
           typename SrcIt,
@@ -19,9 +19,17 @@
 #include "Transform.h"
 #include <QDebug>
 #include <cassert>
+#include <cmath>
+#include "AccelBackend.h"
 #include "BadAllocIfNull.h"
+#include "BinaryImage.h"
 #include "ColorMixer.h"
+#include "Constants.h"
+#include "OpCounters.h"
 #include "Grayscale.h"
+#include "ParallelFor.h"
+#include "RasterOp.h"
+#include "Shear.h"
 
 namespace imageproc {
 namespace {
@@ -54,41 +62,28 @@ QSizeF calcSrcUnitSize(const QTransform& xform, const QSizeF& min) {
 }
 
 template <typename StorageUnit, typename Mixer>
-static void transformGeneric(const StorageUnit* const src_data,
-                             const int src_stride,
-                             const QSize src_size,
-                             StorageUnit* const dst_data,
-                             const int dst_stride,
-                             const QTransform& xform,
-                             const QRect& dst_rect,
-                             const StorageUnit outside_color,
-                             const int outside_flags,
-                             const QSizeF& min_mapping_area) {
+static void transformTile(const StorageUnit* const src_data,
+                          const int src_stride,
+                          const QSize src_size,
+                          StorageUnit* const dst_data,
+                          const int dst_stride,
+                          const QTransform& inv_xform,
+                          const QRect& tile,
+                          const StorageUnit outside_color,
+                          const int outside_flags,
+                          const int src32_unit_w,
+                          const int src32_unit_h) {
   const int sw = src_size.width();
   const int sh = src_size.height();
-  const int dw = dst_rect.width();
-  const int dh = dst_rect.height();
 
-  StorageUnit* dst_line = dst_data;
-
-  QTransform inv_xform;
-  inv_xform.translate(dst_rect.x(), dst_rect.y());
-  inv_xform *= xform.inverted();
-  inv_xform *= QTransform().scale(32.0, 32.0);
-
-  // sx32 = dx*inv_xform.m11() + dy*inv_xform.m21() + inv_xform.dx();
-  // sy32 = dy*inv_xform.m22() + dx*inv_xform.m12() + inv_xform.dy();
-
-  const QSizeF src32_unit_size(calcSrcUnitSize(inv_xform, min_mapping_area));
-  const int src32_unit_w = std::max<int>(1, qRound(src32_unit_size.width()));
-  const int src32_unit_h = std::max<int>(1, qRound(src32_unit_size.height()));
+  StorageUnit* dst_line = dst_data + tile.top() * dst_stride;
 
-  for (int dy = 0; dy < dh; ++dy, dst_line += dst_stride) {
+  for (int dy = tile.top(); dy <= tile.bottom(); ++dy, dst_line += dst_stride) {
     const double f_dy_center = dy + 0.5;
     const double f_sx32_base = f_dy_center * inv_xform.m21() + inv_xform.dx();
     const double f_sy32_base = f_dy_center * inv_xform.m22() + inv_xform.dy();
 
-    for (int dx = 0; dx < dw; ++dx) {
+    for (int dx = tile.left(); dx <= tile.right(); ++dx) {
       const double f_dx_center = dx + 0.5;
       const double f_sx32_center = f_sx32_base + f_dx_center * inv_xform.m11();
       const double f_sy32_center = f_sy32_base + f_dx_center * inv_xform.m12();
@@ -292,6 +287,51 @@ static void transformGeneric(const StorageUnit* const src_data,
       dst_line[dx] = mixer.mix(src_area + background_area);
     }
   }
+}  // transformTile
+
+template <typename StorageUnit, typename Mixer>
+static void transformGeneric(const StorageUnit* const src_data,
+                             const int src_stride,
+                             const QSize src_size,
+                             StorageUnit* const dst_data,
+                             const int dst_stride,
+                             const QTransform& xform,
+                             const QRect& dst_rect,
+                             const StorageUnit outside_color,
+                             const int outside_flags,
+                             const QSizeF& min_mapping_area) {
+  const int dw = dst_rect.width();
+  const int dh = dst_rect.height();
+
+  QTransform inv_xform;
+  inv_xform.translate(dst_rect.x(), dst_rect.y());
+  inv_xform *= xform.inverted();
+  inv_xform *= QTransform().scale(32.0, 32.0);
+
+  // sx32 = dx*inv_xform.m11() + dy*inv_xform.m21() + inv_xform.dx();
+  // sy32 = dy*inv_xform.m22() + dx*inv_xform.m12() + inv_xform.dy();
+
+  const QSizeF src32_unit_size(calcSrcUnitSize(inv_xform, min_mapping_area));
+  const int src32_unit_w = std::max<int>(1, qRound(src32_unit_size.width()));
+  const int src32_unit_h = std::max<int>(1, qRound(src32_unit_size.height()));
+
+  // The destination is processed in square tiles rather than full rows.
+  // A tile's gathers stay within a bounded window of the source even for
+  // large rotation angles, and tiles go to separate threads.
+  const int tile_size = 64;
+  const int tiles_x = (dw + tile_size - 1) / tile_size;
+  const int tiles_y = (dh + tile_size - 1) / tile_size;
+
+  parallelForChunked(0, tiles_x * tiles_y, [&](const int begin, const int end) {
+    for (int tile_idx = begin; tile_idx < end; ++tile_idx) {
+      const int tile_x = (tile_idx % tiles_x) * tile_size;
+      const int tile_y = (tile_idx / tiles_x) * tile_size;
+      const QRect tile(tile_x, tile_y, std::min(tile_size, dw - tile_x), std::min(tile_size, dh - tile_y));
+
+      transformTile<StorageUnit, Mixer>(src_data, src_stride, src_size, dst_data, dst_stride, inv_xform, tile,
+                                        outside_color, outside_flags, src32_unit_w, src32_unit_h);
+    }
+  });
 }  // transformGeneric
 
 void fixDpiInPlace(QImage& image, const QTransform& xform) {
@@ -311,6 +351,98 @@ void fixDpiInPlace(GrayImage& image, const QTransform& xform) {
     image.setDotsPerMeterX(dpi_rect.width());
   }
 }
+
+const double MAX_SHEAR_ROTATION_DEGREES = 7.0;
+
+bool isBlackAndWhite(const QImage& img) {
+  if ((img.format() != QImage::Format_Mono) && (img.format() != QImage::Format_MonoLSB)) {
+    return false;
+  }
+
+  const QVector<QRgb> palette(img.colorTable());
+  if (palette.size() != 2) {
+    return false;
+  }
+
+  return ((palette[0] == 0xff000000) && (palette[1] == 0xffffffff))
+         || ((palette[0] == 0xffffffff) && (palette[1] == 0xff000000));
+}
+
+/**
+ * Checks whether the transformation is a rotation by a small angle,
+ * possibly combined with a translation, and extracts that angle.
+ */
+bool isSmallRotation(const QTransform& xform, double& degrees) {
+  const double eps = 1e-6;
+  if ((std::fabs(xform.m11() - xform.m22()) > eps) || (std::fabs(xform.m12() + xform.m21()) > eps)) {
+    return false;
+  }
+
+  const double squared_norm = xform.m11() * xform.m11() + xform.m12() * xform.m12();
+  if (std::fabs(squared_norm - 1.0) > eps) {
+    return false;
+  }
+
+  degrees = std::atan2(xform.m12(), xform.m11()) * constants::RAD2DEG;
+
+  return std::fabs(degrees) <= MAX_SHEAR_ROTATION_DEGREES;
+}
+
+/**
+ * Checks whether transformByShears() would produce the same result
+ * as the general resampler, give or take a pixel along the edges.
+ */
+bool shearRotationApplicable(const QImage& src,
+                             const QTransform& xform,
+                             const OutsidePixels& outside_pixels,
+                             const QSizeF& min_mapping_area,
+                             double& degrees) {
+  if (!isBlackAndWhite(src)) {
+    return false;
+  }
+  if (!(outside_pixels.flags() & OutsidePixels::COLOR)) {
+    return false;
+  }
+  if ((outside_pixels.grayLevel() != 0x00) && (outside_pixels.grayLevel() != 0xff)) {
+    // A gray background would be blended into the edges by the
+    // general code path, which shears can't reproduce.
+    return false;
+  }
+  if ((min_mapping_area.width() > 1.0) || (min_mapping_area.height() > 1.0)) {
+    // The caller asked for smoothing.
+    return false;
+  }
+
+  return isSmallRotation(xform, degrees);
+}
+
+BinaryImage transformByShears(const QImage& src,
+                              const QTransform& xform,
+                              const double degrees,
+                              const QRect& dst_rect,
+                              const OutsidePixels& outside_pixels) {
+  const BWColor bg_color = (outside_pixels.grayLevel() == 0x00) ? BLACK : WHITE;
+  BinaryImage canvas(dst_rect.width(), dst_rect.height());
+  canvas.fill(bg_color);
+
+  // Position the source on the canvas so that rotating the canvas
+  // about its center reproduces the requested transformation.
+  const QPointF canvas_center(0.5 * dst_rect.width(), 0.5 * dst_rect.height());
+  QTransform inv_rotation;
+  inv_rotation.rotate(-degrees);
+  const QPointF offset_f(
+      canvas_center
+      - inv_rotation.map(canvas_center + QPointF(dst_rect.topLeft()) - QPointF(xform.dx(), xform.dy())));
+  const QPoint offset(qRound(offset_f.x()), qRound(offset_f.y()));
+
+  const BinaryImage bin_src(src);
+  const QRect bounded_rect(QRect(offset, bin_src.size()).intersected(canvas.rect()));
+  if (!bounded_rect.isEmpty()) {
+    rasterOp<RopSrc>(canvas, bounded_rect, bin_src, bounded_rect.topLeft() - offset);
+  }
+
+  return shearRotation(canvas, degrees, bg_color);
+}
 }  // namespace
 
 QImage transform(const QImage& src,
@@ -330,6 +462,25 @@ QImage transform(const QImage& src,
     throw std::invalid_argument("transform: dst_rect is invalid");
   }
 
+  AccelBackend& accel = accelBackend();
+  if (accel.supports(AccelBackend::AFFINE_TRANSFORM)) {
+    QImage dst;
+    if (accel.affineTransform(src, xform, dst_rect, outside_pixels, min_mapping_area, dst)) {
+      return dst;
+    }
+  }
+
+  OpCounters::add(OpCounters::TRANSFORM_CALLS, 1);
+  OpCounters::add(OpCounters::TRANSFORM_PIXELS, uint64_t(dst_rect.width()) * dst_rect.height());
+
+  // Bitonal sources rotated by a small angle, which is what deskewing
+  // does to them, take a fast path built on whole-row and whole-column
+  // shears instead of the gather-heavy area-mapping resampler.
+  double rotation_degrees = 0.0;
+  if (shearRotationApplicable(src, xform, outside_pixels, min_mapping_area, rotation_degrees)) {
+    return transformByShears(src, xform, rotation_degrees, dst_rect, outside_pixels).toQImage();
+  }
+
   auto is_opaque_gray
       = [](QRgb rgba) { return qAlpha(rgba) == 0xff && qRed(rgba) == qBlue(rgba) && qRed(rgba) == qGreen(rgba); };
   switch (src.format()) {
@@ -403,6 +554,23 @@ GrayImage transformToGray(const QImage& src,
     throw std::invalid_argument("transformToGray: dst_rect is invalid");
   }
 
+  AccelBackend& accel = accelBackend();
+  if (accel.supports(AccelBackend::AFFINE_TRANSFORM)) {
+    QImage dst;
+    if (accel.affineTransform(toGrayscale(src), xform, dst_rect, outside_pixels, min_mapping_area, dst)) {
+      return GrayImage(dst);
+    }
+  }
+
+  OpCounters::add(OpCounters::TRANSFORM_CALLS, 1);
+  OpCounters::add(OpCounters::TRANSFORM_PIXELS, uint64_t(dst_rect.width()) * dst_rect.height());
+
+  // Same shear-based fast path as in transform().
+  double rotation_degrees = 0.0;
+  if (shearRotationApplicable(src, xform, outside_pixels, min_mapping_area, rotation_degrees)) {
+    return GrayImage(transformByShears(src, xform, rotation_degrees, dst_rect, outside_pixels).toQImage());
+  }
+
   const GrayImage gray_src(src);
   GrayImage dst(dst_rect.size());
 
@@ -17,7 +17,15 @@
  */
 
 #include "UpscaleIntegerTimes.h"
+#include <cstring>
 #include "BinaryImage.h"
+#include "ParallelFor.h"
+
+// _pdep_u64() requires 64-bit mode.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define IMAGEPROC_UPSCALE_BMI2 1
+#include <immintrin.h>
+#endif
 
 namespace imageproc {
 namespace {
@@ -25,6 +33,117 @@ inline uint32_t multiplyBit(uint32_t bit, int times) {
   return (uint32_t(0) - bit) >> (32 - times);
 }
 
+void expandRowScalar(const uint32_t* const src_line, uint32_t* const dst_line, const int sw, const int xscale) {
+  uint32_t dst_word = 0;
+  int dst_bits_remaining = 32;
+  int di = 0;
+
+  for (int sx = 0; sx < sw; ++sx) {
+    const uint32_t src_word = src_line[sx >> 5];
+    const int src_bit = 31 - (sx & 31);
+    const uint32_t bit = (src_word >> src_bit) & uint32_t(1);
+    int todo = xscale;
+
+    while (dst_bits_remaining <= todo) {
+      dst_word |= multiplyBit(bit, dst_bits_remaining);
+      dst_line[di++] = dst_word;
+      todo -= dst_bits_remaining;
+      dst_bits_remaining = 32;
+      dst_word = 0;
+    }
+    if (todo > 0) {
+      dst_bits_remaining -= todo;
+      dst_word |= multiplyBit(bit, todo) << dst_bits_remaining;
+    }
+  }
+
+  if (dst_bits_remaining != 32) {
+    dst_line[di] = dst_word;
+  }
+}
+
+/**
+ * Spread the 32 bits of \p bits over a 64-bit word, putting bit i
+ * into bit 2*i.  The bit scattering steps are the reverse of the
+ * gathering ones from Hacker's Delight, section 7-2.
+ */
+inline uint64_t spreadBits(const uint32_t bits) {
+  uint64_t x = bits;
+  x = (x | (x << 16)) & 0x0000ffff0000ffff;
+  x = (x | (x << 8)) & 0x00ff00ff00ff00ff;
+  x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0f;
+  x = (x | (x << 2)) & 0x3333333333333333;
+  x = (x | (x << 1)) & 0x5555555555555555;
+
+  return x;
+}
+
+/**
+ * 2x horizontal expansion: every source word turns into two
+ * destination words with each bit doubled.  \p src_words is the
+ * number of source words to consume, \p dst_words the number of
+ * destination words that may be written, and \p last_word_mask
+ * clears the garbage bits past the end of the last source word,
+ * which would otherwise leak into the destination padding.
+ */
+void expandRowX2Scalar(const uint32_t* const src_line,
+                       uint32_t* const dst_line,
+                       const int src_words,
+                       const int dst_words,
+                       const uint32_t last_word_mask) {
+  for (int j = 0; j < src_words - 1; ++j) {
+    const uint64_t spread = spreadBits(src_line[j]);
+    const uint64_t doubled = spread | (spread << 1);
+    dst_line[j * 2] = uint32_t(doubled >> 32);
+    dst_line[j * 2 + 1] = uint32_t(doubled);
+  }
+
+  const int j = src_words - 1;
+  const uint64_t spread = spreadBits(src_line[j] & last_word_mask);
+  const uint64_t doubled = spread | (spread << 1);
+  dst_line[j * 2] = uint32_t(doubled >> 32);
+  if (j * 2 + 1 < dst_words) {
+    dst_line[j * 2 + 1] = uint32_t(doubled);
+  }
+}
+
+#ifdef IMAGEPROC_UPSCALE_BMI2
+/** Same as expandRowX2Scalar(), but a single PDEP does the spreading. */
+__attribute__((target("bmi2"))) void expandRowX2Pdep(const uint32_t* const src_line,
+                                                     uint32_t* const dst_line,
+                                                     const int src_words,
+                                                     const int dst_words,
+                                                     const uint32_t last_word_mask) {
+  const uint64_t odd_bits_mask = 0x5555555555555555;
+
+  for (int j = 0; j < src_words - 1; ++j) {
+    const uint64_t spread = _pdep_u64(src_line[j], odd_bits_mask);
+    const uint64_t doubled = spread | (spread << 1);
+    dst_line[j * 2] = uint32_t(doubled >> 32);
+    dst_line[j * 2 + 1] = uint32_t(doubled);
+  }
+
+  const int j = src_words - 1;
+  const uint64_t spread = _pdep_u64(src_line[j] & last_word_mask, odd_bits_mask);
+  const uint64_t doubled = spread | (spread << 1);
+  dst_line[j * 2] = uint32_t(doubled >> 32);
+  if (j * 2 + 1 < dst_words) {
+    dst_line[j * 2 + 1] = uint32_t(doubled);
+  }
+}
+#endif
+
+typedef void (*ExpandRowX2Func)(const uint32_t*, uint32_t*, int, int, uint32_t);
+
+ExpandRowX2Func selectExpandRowX2() {
+#ifdef IMAGEPROC_UPSCALE_BMI2
+  if (__builtin_cpu_supports("bmi2")) {
+    return &expandRowX2Pdep;
+  }
+#endif
+  return &expandRowX2Scalar;
+}
+
 void expandImpl(BinaryImage& dst, const BinaryImage& src, const int xscale, const int yscale) {
   const int sw = src.width();
   const int sh = src.height();
@@ -32,43 +151,43 @@ void expandImpl(BinaryImage& dst, const BinaryImage& src, const int xscale, cons
   const int src_wpl = src.wordsPerLine();
   const int dst_wpl = dst.wordsPerLine();
 
-  const uint32_t* src_line = src.data();
-  uint32_t* dst_line = dst.data();
-
-  for (int sy = 0; sy < sh; ++sy, src_line += src_wpl) {
-    uint32_t dst_word = 0;
-    int dst_bits_remaining = 32;
-    int di = 0;
-
-    for (int sx = 0; sx < sw; ++sx) {
-      const uint32_t src_word = src_line[sx >> 5];
-      const int src_bit = 31 - (sx & 31);
-      const uint32_t bit = (src_word >> src_bit) & uint32_t(1);
-      int todo = xscale;
-
-      while (dst_bits_remaining <= todo) {
-        dst_word |= multiplyBit(bit, dst_bits_remaining);
-        dst_line[di++] = dst_word;
-        todo -= dst_bits_remaining;
-        dst_bits_remaining = 32;
-        dst_word = 0;
-      }
-      if (todo > 0) {
-        dst_bits_remaining -= todo;
-        dst_word |= multiplyBit(bit, todo) << dst_bits_remaining;
-      }
-    }
-
-    if (dst_bits_remaining != 32) {
-      dst_line[di] = dst_word;
-    }
-
-    const uint32_t* first_dst_line = dst_line;
-    dst_line += dst_wpl;
-    for (int line = 1; line < yscale; ++line, dst_line += dst_wpl) {
-      memcpy(dst_line, first_dst_line, dst_wpl * 4);
-    }
-  }
+  const uint32_t* const src_data = src.data();
+  uint32_t* const dst_data = dst.data();
+
+  const int src_words = (sw + 31) / 32;
+  const int dst_words = (sw * xscale + 31) / 32;
+  const uint32_t last_word_mask = (sw & 31) ? ~uint32_t(0) << (32 - (sw & 31)) : ~uint32_t(0);
+
+  const ExpandRowX2Func expand_row_x2 = selectExpandRowX2();
+
+  // Source rows are independent of each other.
+  const int64_t parallel_threshold = int64_t(1) << 18;  // 256K pixels.
+  const int max_threads = (int64_t(dst.width()) * dst.height() >= parallel_threshold) ? 0 : 1;
+
+  parallelForChunked(
+      0, sh,
+      [&](const int sy_begin, const int sy_end) {
+        const uint32_t* src_line = src_data + sy_begin * src_wpl;
+        uint32_t* dst_line = dst_data + sy_begin * yscale * dst_wpl;
+
+        for (int sy = sy_begin; sy < sy_end; ++sy, src_line += src_wpl) {
+          if (xscale == 1) {
+            memcpy(dst_line, src_line, src_words * 4);
+            dst_line[src_words - 1] = src_line[src_words - 1] & last_word_mask;
+          } else if (xscale == 2) {
+            expand_row_x2(src_line, dst_line, src_words, dst_words, last_word_mask);
+          } else {
+            expandRowScalar(src_line, dst_line, sw, xscale);
+          }
+
+          const uint32_t* const first_dst_line = dst_line;
+          dst_line += dst_wpl;
+          for (int line = 1; line < yscale; ++line, dst_line += dst_wpl) {
+            memcpy(dst_line, first_dst_line, dst_wpl * 4);
+          }
+        }
+      },
+      max_threads);
 }  // expandImpl
 }  // namespace
 
@@ -108,4 +227,4 @@ BinaryImage upscaleIntegerTimes(const BinaryImage& src, const QSize& dst_size, c
 
   return dst;
 }
-}  // namespace imageproc
\ No newline at end of file
+}  // namespace imageproc
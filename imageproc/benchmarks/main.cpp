@@ -0,0 +1,244 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * \brief Microbenchmarks for the hot imageproc kernels.
+ *
+ * Each benchmark runs a kernel on fixed synthetic inputs of a couple of
+ * page-like sizes and reports ns/op and bytes/s.  The results are printed
+ * to stdout as JSON, one object per benchmark, so they can be collected
+ * and compared mechanically when a kernel is changed.
+ */
+
+#include <QImage>
+#include <QSize>
+#include <QTransform>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include "BinaryImage.h"
+#include "Binarize.h"
+#include "Connectivity.h"
+#include "GrayImage.h"
+#include "Morphology.h"
+#include "RasterOp.h"
+#include "SEDM.h"
+#include "Scale.h"
+#include "SeedFill.h"
+#include "Transform.h"
+
+namespace imageproc {
+namespace benchmarks {
+/** Accumulates pointers to kernel outputs so they can't be optimized away. */
+volatile uintptr_t sink = 0;
+
+/** Every benchmark runs for at least this long. */
+const double MIN_SECONDS = 0.5;
+
+struct BenchmarkResult {
+  std::string name;
+  long iterations;
+  double nsPerOp;
+  long bytesPerOp;
+  double bytesPerSec;
+};
+
+std::vector<BenchmarkResult> results;
+
+/**
+ * Runs \p func repeatedly, doubling the iteration count until the
+ * measurement covers MIN_SECONDS, and records the result.
+ *
+ * \param bytes_per_op The number of bytes the kernel reads plus writes
+ *        in one call, used to derive the bytes/s figure.
+ */
+void runBenchmark(const std::string& name, const long bytes_per_op, const std::function<void()>& func) {
+  func();  // Warm-up, also paging the inputs in.
+
+  typedef std::chrono::steady_clock Clock;
+
+  long iterations = 1;
+  double elapsed_sec = 0;
+  while (true) {
+    const Clock::time_point start(Clock::now());
+    for (long i = 0; i < iterations; ++i) {
+      func();
+    }
+    elapsed_sec = std::chrono::duration<double>(Clock::now() - start).count();
+    if (elapsed_sec >= MIN_SECONDS) {
+      break;
+    }
+    iterations *= 2;
+  }
+
+  BenchmarkResult result;
+  result.name = name;
+  result.iterations = iterations;
+  result.nsPerOp = elapsed_sec * 1e9 / iterations;
+  result.bytesPerOp = bytes_per_op;
+  result.bytesPerSec = bytes_per_op * iterations / elapsed_sec;
+  results.push_back(result);
+
+  std::fprintf(stderr, "%-32s %12.0f ns/op %10.2f MB/s\n", name.c_str(), result.nsPerOp,
+               result.bytesPerSec / (1024.0 * 1024.0));
+}
+
+uint32_t lcgNext(uint32_t& state) {
+  state = state * 1664525 + 1013904223;
+
+  return state;
+}
+
+/** A deterministic noise image with roughly 25% black pixels. */
+BinaryImage syntheticBinaryImage(const QSize& size, uint32_t seed) {
+  BinaryImage img(size, WHITE);
+  uint32_t* line = img.data();
+  const int wpl = img.wordsPerLine();
+  for (int y = 0; y < size.height(); ++y, line += wpl) {
+    for (int x = 0; x < wpl; ++x) {
+      line[x] = lcgNext(seed) & lcgNext(seed);
+    }
+  }
+
+  return img;
+}
+
+/** A deterministic image of gray noise. */
+GrayImage syntheticGrayImage(const QSize& size, uint32_t seed) {
+  GrayImage img(size);
+  uint8_t* line = img.data();
+  const int stride = img.stride();
+  for (int y = 0; y < size.height(); ++y, line += stride) {
+    for (int x = 0; x < size.width(); ++x) {
+      line[x] = uint8_t(lcgNext(seed) >> 24);
+    }
+  }
+
+  return img;
+}
+
+std::string sizeTag(const QSize& size) {
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "%dx%d", size.width(), size.height());
+
+  return std::string(buf);
+}
+
+void benchmarkSize(const QSize& size) {
+  const std::string tag(sizeTag(size));
+  const long binary_bytes = long(size.width() / 8) * size.height();
+  const long gray_bytes = long(size.width()) * size.height();
+
+  const BinaryImage binary_src(syntheticBinaryImage(size, 0x12345678));
+  const GrayImage gray_src(syntheticGrayImage(size, 0x9abcdef0));
+
+  {
+    BinaryImage dst(syntheticBinaryImage(size, 0x0f0f0f0f));
+    runBenchmark("RasterOp/Xor/" + tag, 3 * binary_bytes, [&dst, &binary_src]() {
+      rasterOp<RopXor<RopSrc, RopDst>>(dst, binary_src);
+      sink += reinterpret_cast<uintptr_t>(dst.data());
+    });
+  }
+
+  runBenchmark("Morphology/DilateBrick5x5/" + tag, 2 * binary_bytes, [&binary_src]() {
+    const BinaryImage dilated(dilateBrick(binary_src, QSize(5, 5)));
+    sink += reinterpret_cast<uintptr_t>(dilated.data());
+  });
+
+  runBenchmark("Morphology/OpenBrick5x5/" + tag, 2 * binary_bytes, [&binary_src]() {
+    const BinaryImage opened(openBrick(binary_src, QSize(5, 5)));
+    sink += reinterpret_cast<uintptr_t>(opened.data());
+  });
+
+  {
+    const BinaryImage seed(erodeBrick(binary_src, QSize(9, 9)));
+    runBenchmark("SeedFill/Conn8/" + tag, 3 * binary_bytes, [&seed, &binary_src]() {
+      const BinaryImage filled(seedFill(seed, binary_src, CONN8));
+      sink += reinterpret_cast<uintptr_t>(filled.data());
+    });
+  }
+
+  runBenchmark("SEDM/DistToWhite/" + tag, binary_bytes + 4 * gray_bytes, [&binary_src]() {
+    const SEDM sedm(binary_src);
+    sink += reinterpret_cast<uintptr_t>(sedm.data());
+  });
+
+  runBenchmark("Binarize/Otsu/" + tag, gray_bytes + binary_bytes, [&gray_src]() {
+    const BinaryImage bw(binarizeOtsu(gray_src));
+    sink += reinterpret_cast<uintptr_t>(bw.data());
+  });
+
+  runBenchmark("Binarize/Sauvola51x51/" + tag, gray_bytes + binary_bytes, [&gray_src]() {
+    const BinaryImage bw(binarizeSauvola(gray_src, QSize(51, 51)));
+    sink += reinterpret_cast<uintptr_t>(bw.data());
+  });
+
+  {
+    const QSize half_size(size.width() / 2, size.height() / 2);
+    runBenchmark("Scale/ToGrayHalf/" + tag, gray_bytes + gray_bytes / 4, [&gray_src, half_size]() {
+      const GrayImage scaled(scaleToGray(gray_src, half_size));
+      sink += reinterpret_cast<uintptr_t>(scaled.data());
+    });
+  }
+
+  {
+    QTransform rotation;
+    rotation.translate(0.5 * size.width(), 0.5 * size.height());
+    rotation.rotate(3.0);
+    rotation.translate(-0.5 * size.width(), -0.5 * size.height());
+    // Scaling slightly keeps this on the general resampling path
+    // rather than the shear-based fast path for pure rotations.
+    rotation.scale(1.001, 1.001);
+    const QRect dst_rect(QPoint(0, 0), size);
+    runBenchmark("Transform/Rotate3Deg/" + tag, 2 * gray_bytes, [&gray_src, rotation, dst_rect]() {
+      const GrayImage transformed(
+          transformToGray(gray_src, rotation, dst_rect, OutsidePixels::assumeWeakColor(Qt::white)));
+      sink += reinterpret_cast<uintptr_t>(transformed.data());
+    });
+  }
+}
+
+void printJson() {
+  std::printf("{\n  \"benchmarks\": [\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchmarkResult& r = results[i];
+    std::printf(
+        "    {\"name\": \"%s\", \"iterations\": %ld, \"ns_per_op\": %.1f,"
+        " \"bytes_per_op\": %ld, \"bytes_per_sec\": %.0f}%s\n",
+        r.name.c_str(), r.iterations, r.nsPerOp, r.bytesPerOp, r.bytesPerSec, i + 1 < results.size() ? "," : "");
+  }
+  std::printf("  ]\n}\n");
+}
+}  // namespace benchmarks
+}  // namespace imageproc
+
+int main() {
+  using namespace imageproc::benchmarks;
+
+  // A letter-size page at 150 and 300 dpi.
+  benchmarkSize(QSize(1275, 1650));
+  benchmarkSize(QSize(2552, 3300));
+
+  printJson();
+
+  return 0;
+}
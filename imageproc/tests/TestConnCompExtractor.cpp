@@ -0,0 +1,114 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QRect>
+#include <boost/test/auto_unit_test.hpp>
+#include <cstdlib>
+#include "BWColor.h"
+#include "BinaryImage.h"
+#include "ConnComp.h"
+#include "ConnCompEraserExt.h"
+#include "ConnCompExtractor.h"
+#include "RasterOp.h"
+#include "Utils.h"
+
+namespace imageproc {
+namespace tests {
+using namespace utils;
+
+BOOST_AUTO_TEST_SUITE(ConnCompExtractorTestSuite);
+
+BOOST_AUTO_TEST_CASE(test_null_image) {
+  const ConnCompExtractor extractor(BinaryImage(), CONN4);
+  BOOST_CHECK_EQUAL(extractor.numComponents(), size_t(0));
+}
+
+/**
+ * Extracts every component both ways and checks that each component
+ * found by ConnCompEraserExt has an exact counterpart (same seed label,
+ * metadata and pixels) among those found by ConnCompExtractor.
+ */
+static void checkAgainstEraser(const BinaryImage& image, const Connectivity conn) {
+  const ConnCompExtractor extractor(image, conn);
+
+  size_t num_erased = 0;
+  ConnCompEraserExt eraser(image, conn);
+  ConnComp cc;
+  while (!(cc = eraser.nextConnComp()).isNull()) {
+    ++num_erased;
+
+    // The eraser's seed and the extractor's seed may differ, but both
+    // must carry the same label in the extractor's map, which we verify
+    // through metadata plus pixel-exact images.
+    bool found = false;
+    for (size_t i = 0; i < extractor.numComponents(); ++i) {
+      const ConnComp& other = extractor.component(i);
+      if (other.rect() != cc.rect() || other.pixCount() != cc.pixCount()) {
+        continue;
+      }
+      if (extractor.extract(i) == eraser.computeConnCompImage()) {
+        BOOST_CHECK(cc.rect().contains(other.seed()));
+        found = true;
+        break;
+      }
+    }
+    BOOST_CHECK(found);
+  }
+
+  BOOST_CHECK_EQUAL(num_erased, extractor.numComponents());
+}
+
+BOOST_AUTO_TEST_CASE(test_matches_eraser) {
+  srand(42);
+  for (int iter = 0; iter < 20; ++iter) {
+    const BinaryImage image(randomBinaryImage(70, 64));
+    checkAgainstEraser(image, CONN4);
+    checkAgainstEraser(image, CONN8);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_aligned_extraction) {
+  srand(7);
+  const BinaryImage image(randomBinaryImage(70, 64));
+
+  const ConnCompExtractor extractor(image, CONN8);
+  for (size_t i = 0; i < extractor.numComponents(); ++i) {
+    QRect rect;
+    const BinaryImage aligned(extractor.extractAligned(i, &rect));
+    BOOST_REQUIRE_EQUAL(rect.x() % 32, 0);
+    BOOST_REQUIRE(rect.contains(extractor.component(i).rect()));
+
+    // The aligned image drawn at rect must reproduce the plain one
+    // drawn at the component's bounding box.
+    const int pad = extractor.component(i).rect().x() - rect.x();
+    BinaryImage canvas1(image.size(), WHITE);
+    rasterOp<RopOr<RopSrc, RopDst>>(canvas1, QRect(rect.topLeft(), aligned.size()), aligned, QPoint(0, 0));
+
+    const BinaryImage plain(extractor.extract(i));
+    BinaryImage canvas2(image.size(), WHITE);
+    rasterOp<RopOr<RopSrc, RopDst>>(canvas2, QRect(extractor.component(i).rect().topLeft(), plain.size()), plain,
+                                    QPoint(0, 0));
+
+    BOOST_CHECK(canvas1 == canvas2);
+    BOOST_CHECK(pad >= 0);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+}  // namespace tests
+}  // namespace imageproc
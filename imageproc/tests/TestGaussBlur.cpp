@@ -0,0 +1,75 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QSize>
+#include <boost/lambda/bind.hpp>
+#include <boost/lambda/lambda.hpp>
+#include <boost/test/auto_unit_test.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include "GaussBlur.h"
+#include "GrayImage.h"
+
+namespace imageproc {
+namespace tests {
+BOOST_AUTO_TEST_SUITE(GaussBlurTestSuite);
+
+/**
+ * The fixed-point path taken by gaussBlur() for moderate sigmas must
+ * stay within one gray level of the float reference implemented by
+ * gaussBlurGeneric().
+ */
+BOOST_AUTO_TEST_CASE(test_fixed_point_matches_float_reference) {
+  using namespace boost::lambda;
+
+  const QSize size(101, 83);
+  GrayImage img(size);
+  uint8_t* line = img.data();
+  for (int y = 0; y < size.height(); ++y, line += img.stride()) {
+    for (int x = 0; x < size.width(); ++x) {
+      line[x] = static_cast<uint8_t>(rand() % 256);
+    }
+  }
+
+  const float sigmas[] = {0.5f, 1.0f, 2.5f, 7.0f, 24.0f};
+  for (const float sigma : sigmas) {
+    const GrayImage blurred(gaussBlur(img, sigma, sigma));
+
+    GrayImage reference(size);
+    gaussBlurGeneric(size, sigma, sigma, img.data(), img.stride(), StaticCastValueConv<float>(), reference.data(),
+                     reference.stride(), _1 = bind<uint8_t>(RoundAndClipValueConv<uint8_t>(), _2));
+
+    int max_diff = 0;
+    const uint8_t* blurred_line = blurred.data();
+    const uint8_t* reference_line = reference.data();
+    for (int y = 0; y < size.height(); ++y) {
+      for (int x = 0; x < size.width(); ++x) {
+        const int diff = std::abs(int(blurred_line[x]) - int(reference_line[x]));
+        max_diff = std::max(max_diff, diff);
+      }
+      blurred_line += blurred.stride();
+      reference_line += reference.stride();
+    }
+
+    BOOST_REQUIRE_MESSAGE(max_diff <= 1, "sigma = " << sigma << ", max diff = " << max_diff);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+}  // namespace tests
+}  // namespace imageproc
@@ -100,6 +100,36 @@ BOOST_AUTO_TEST_CASE(test_sub_image) {
   BOOST_REQUIRE(orthogonalRotation(img, rect, -90) == out4_img);
 }
 
+static bool pixelAt(const BinaryImage& img, const int x, const int y) {
+  const uint32_t word = img.data()[y * img.wordsPerLine() + (x >> 5)];
+
+  return (word >> (31 - (x & 31))) & 1;
+}
+
+// Images larger than 32x32 take the word-level code paths,
+// which the fixed 9x9 cases above never reach.
+BOOST_AUTO_TEST_CASE(test_large_image) {
+  const int w = 157;
+  const int h = 95;
+  const BinaryImage img(randomBinaryImage(w, h));
+
+  const QRect rects[] = {img.rect(), QRect(3, 1, 140, 90)};
+  for (const QRect& rect : rects) {
+    const BinaryImage out90(orthogonalRotation(img, rect, 90));
+    const BinaryImage out180(orthogonalRotation(img, rect, 180));
+    const BinaryImage out270(orthogonalRotation(img, rect, 270));
+
+    for (int y = 0; y < rect.height(); ++y) {
+      for (int x = 0; x < rect.width(); ++x) {
+        const bool pixel = pixelAt(img, rect.left() + x, rect.top() + y);
+        BOOST_REQUIRE(pixelAt(out90, rect.height() - 1 - y, x) == pixel);
+        BOOST_REQUIRE(pixelAt(out180, rect.width() - 1 - x, rect.height() - 1 - y) == pixel);
+        BOOST_REQUIRE(pixelAt(out270, y, rect.width() - 1 - x) == pixel);
+      }
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 }  // namespace tests
 }  // namespace imageproc
\ No newline at end of file
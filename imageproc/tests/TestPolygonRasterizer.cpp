@@ -154,6 +154,29 @@ BOOST_AUTO_TEST_CASE(test_corner_cases) {
   BOOST_CHECK(testFillExceptShape(image_size, shape3, Qt::WindingFill));
 }
 
+BOOST_AUTO_TEST_CASE(test_batch_fill) {
+  const QSize image_size(500, 500);
+
+  // Overlapping polygons with mixed colors, including one that
+  // gets clipped, to verify that a batch composes in order.
+  std::vector<std::pair<QPolygonF, BWColor>> polys;
+  polys.emplace_back(createShape(image_size, 230), BLACK);
+  polys.emplace_back(createShape(image_size, 150).translated(60, 40), WHITE);
+  polys.emplace_back(createShape(image_size, 300), BLACK);
+
+  for (const Qt::FillRule fill_rule : {Qt::OddEvenFill, Qt::WindingFill}) {
+    BinaryImage batch(image_size, WHITE);
+    PolygonRasterizer::fill(batch, polys, fill_rule);
+
+    BinaryImage sequential(image_size, WHITE);
+    for (const auto& poly_and_color : polys) {
+      PolygonRasterizer::fill(sequential, poly_and_color.second, poly_and_color.first, fill_rule);
+    }
+
+    BOOST_REQUIRE(batch == sequential);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(regression_test_1) {
   QPolygonF shape;
   shape.push_back(QPointF(937.872, 24.559));
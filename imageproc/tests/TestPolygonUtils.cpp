@@ -0,0 +1,70 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QPolygonF>
+#include <QRectF>
+#include <QTransform>
+#include <boost/test/auto_unit_test.hpp>
+#include "PolygonUtils.h"
+
+namespace imageproc {
+namespace tests {
+BOOST_AUTO_TEST_SUITE(PolygonUtilsTestSuite);
+
+BOOST_AUTO_TEST_CASE(test_clip_fully_inside) {
+  const QPolygonF poly(QRectF(10, 10, 20, 20));
+  const QRectF rect(0, 0, 100, 100);
+  BOOST_CHECK(PolygonUtils::fuzzyCompare(PolygonUtils::clipToRect(poly, rect), poly));
+}
+
+BOOST_AUTO_TEST_CASE(test_clip_fully_outside) {
+  const QPolygonF poly(QRectF(200, 200, 20, 20));
+  const QRectF rect(0, 0, 100, 100);
+  BOOST_CHECK(PolygonUtils::clipToRect(poly, rect).isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(test_clip_rect_overlap) {
+  const QPolygonF poly(QRectF(50, 50, 100, 100));
+  const QRectF rect(0, 0, 100, 100);
+  const QPolygonF expected(QRectF(50, 50, 50, 50));
+  BOOST_CHECK(PolygonUtils::fuzzyCompare(PolygonUtils::clipToRect(poly, rect), expected));
+}
+
+BOOST_AUTO_TEST_CASE(test_clip_rotated_rect) {
+  // A rotated rectangle is the shape this function actually gets
+  // at rendering time.  Compare against Qt's own implementation.
+  QTransform xform;
+  xform.translate(50, 50);
+  xform.rotate(30);
+  const QPolygonF poly(xform.map(QPolygonF(QRectF(-40, -25, 80, 50))));
+  const QRectF rect(0, 0, 70, 60);
+  BOOST_CHECK(PolygonUtils::fuzzyCompare(PolygonUtils::clipToRect(poly, rect), poly.intersected(QPolygonF(rect))));
+}
+
+BOOST_AUTO_TEST_CASE(test_clip_concave_falls_back) {
+  // A concave polygon takes the QPolygonF::intersected() fallback,
+  // so the result must simply agree with it.
+  QPolygonF poly;
+  poly << QPointF(-20, 0) << QPointF(60, 0) << QPointF(20, 30) << QPointF(60, 60) << QPointF(-20, 60);
+  const QRectF rect(0, 0, 100, 100);
+  BOOST_CHECK(PolygonUtils::fuzzyCompare(PolygonUtils::clipToRect(poly, rect), poly.intersected(QPolygonF(rect))));
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+}  // namespace tests
+}  // namespace imageproc
@@ -53,6 +53,27 @@ BOOST_AUTO_TEST_CASE(test_small_image) {
   BOOST_CHECK(makeBinaryImage(out4, 5, 4) == ReduceThreshold(img)(4));
 }
 
+// Images wider than 64 pixels exercise the multi-word row kernels,
+// which the 10x8 case above never reaches.
+BOOST_AUTO_TEST_CASE(test_large_image) {
+  const int w = 157;
+  const int h = 43;
+  BinaryImage img(randomBinaryImage(w, h));
+
+  for (int threshold = 1; threshold <= 4; ++threshold) {
+    BinaryImage out(ReduceThreshold(img)(threshold).image());
+    BOOST_REQUIRE(out.size() == QSize(w / 2, h / 2));
+
+    for (int y = 0; y < h / 2; ++y) {
+      for (int x = 0; x < w / 2; ++x) {
+        const int count = (img.getPixel(x * 2, y * 2) == BLACK) + (img.getPixel(x * 2 + 1, y * 2) == BLACK)
+                          + (img.getPixel(x * 2, y * 2 + 1) == BLACK) + (img.getPixel(x * 2 + 1, y * 2 + 1) == BLACK);
+        BOOST_REQUIRE((out.getPixel(x, y) == BLACK) == (count >= threshold));
+      }
+    }
+  }
+}
+
 BOOST_AUTO_TEST_CASE(test_lines) {
   static const int inp[] = {0, 0, 0, 1, 1, 0, 1, 1, 0};
   static const int out1[] = {0, 1, 1, 1};
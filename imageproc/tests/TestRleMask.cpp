@@ -0,0 +1,168 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C) 2007-2008  Joseph Artsimovich <joseph_a@mail.ru>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QPointF>
+#include <QPolygonF>
+#include <QSize>
+#include <Qt>
+#include <boost/test/auto_unit_test.hpp>
+#include <cmath>
+#include <cstdlib>
+#include "BWColor.h"
+#include "BinaryImage.h"
+#include "PolygonRasterizer.h"
+#include "RasterOp.h"
+#include "RleMask.h"
+#include "Utils.h"
+
+namespace imageproc {
+namespace tests {
+using namespace utils;
+
+BOOST_AUTO_TEST_SUITE(RleMaskTestSuite);
+
+static QPolygonF createShape(const QSize& image_size, double radius) {
+  const QPointF center(0.5 * image_size.width(), 0.5 * image_size.height());
+  const double PI = 3.14159265;
+  double angle = PI / 2.0;
+  const int num_steps = 5;
+  const double step = PI * 2.0 / num_steps;
+
+  QPolygonF poly;
+
+  poly.push_back(center + QPointF(std::cos(angle), std::sin(angle)) * radius);
+  for (int i = 1; i < num_steps; ++i) {
+    angle += step * 2;
+    poly.push_back(center + QPointF(std::cos(angle), std::sin(angle)) * radius);
+  }
+
+  return poly;
+}
+
+static RleMask randomMask(const QSize& size) {
+  RleMask mask(size);
+  for (int i = 0; i < 20; ++i) {
+    const int y = rand() % size.height();
+    const int x_begin = rand() % size.width();
+    mask.addRun(y, x_begin, x_begin + 1 + rand() % 40);
+  }
+
+  return mask;
+}
+
+BOOST_AUTO_TEST_CASE(test_run_merging) {
+  RleMask mask(QSize(100, 10));
+  mask.addRun(3, 50, 60);
+  mask.addRun(3, 10, 20);
+  mask.addRun(3, 15, 30);   // Overlaps the second run.
+  mask.addRun(3, 30, 40);   // Abuts the merged run.
+  mask.addRun(3, -5, 5);    // Clipped on the left.
+  mask.addRun(3, 90, 200);  // Clipped on the right.
+  mask.addRun(3, 70, 70);   // Empty - ignored.
+  mask.addRun(-1, 0, 10);   // Out of bounds - ignored.
+
+  const std::vector<RleMask::Run>& row = mask.runs(3);
+  BOOST_REQUIRE(row.size() == 4);
+  BOOST_CHECK(row[0].xBegin == 0 && row[0].xEnd == 5);
+  BOOST_CHECK(row[1].xBegin == 10 && row[1].xEnd == 40);
+  BOOST_CHECK(row[2].xBegin == 50 && row[2].xEnd == 60);
+  BOOST_CHECK(row[3].xBegin == 90 && row[3].xEnd == 100);
+
+  BOOST_CHECK(mask.boundingRect() == QRect(0, 3, 100, 1));
+}
+
+BOOST_AUTO_TEST_CASE(test_fill_rle_matches_fill) {
+  const QSize image_size(500, 500);
+
+  // This one fits the image.
+  const QPolygonF smaller_shape(createShape(image_size, 230));
+
+  // This one doesn't fit the image and will be clipped.
+  const QPolygonF bigger_shape(createShape(image_size, 300));
+
+  for (const QPolygonF& shape : {smaller_shape, bigger_shape}) {
+    for (const Qt::FillRule fill_rule : {Qt::OddEvenFill, Qt::WindingFill}) {
+      BinaryImage control(image_size, WHITE);
+      PolygonRasterizer::fill(control, BLACK, shape, fill_rule);
+
+      RleMask mask(image_size);
+      PolygonRasterizer::fillRle(mask, shape, fill_rule);
+
+      BOOST_CHECK(mask.toBinaryImage() == control);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_fill_white) {
+  const QSize image_size(500, 500);
+  const QPolygonF shape(createShape(image_size, 230));
+
+  BinaryImage control(image_size, BLACK);
+  PolygonRasterizer::fill(control, WHITE, shape, Qt::WindingFill);
+
+  RleMask mask(image_size);
+  PolygonRasterizer::fillRle(mask, shape, Qt::WindingFill);
+  BinaryImage image(image_size, BLACK);
+  mask.fill(image, WHITE);
+
+  BOOST_CHECK(image == control);
+}
+
+BOOST_AUTO_TEST_CASE(test_raster_op_interop) {
+  // A width that isn't a multiple of 32 exercises the padding bits.
+  const QSize image_size(101, 57);
+  const RleMask mask(randomMask(image_size));
+  const BinaryImage expanded(mask.toBinaryImage());
+
+  typedef RopXor<RopSrc, RopDst> Xor;
+  typedef RopOr<RopSrc, RopDst> Or;
+  typedef RopAnd<RopSrc, RopDst> And;
+
+  const BinaryImage original(randomBinaryImage(image_size.width(), image_size.height()));
+
+  {
+    BinaryImage img1(original);
+    BinaryImage img2(original);
+    rasterOp<Xor>(img1, mask);
+    rasterOp<Xor>(img2, expanded);
+    BOOST_CHECK(img1 == img2);
+  }
+
+  {
+    // An operation where blank rows get skipped.
+    BinaryImage img1(original);
+    BinaryImage img2(original);
+    rasterOp<Or>(img1, mask);
+    rasterOp<Or>(img2, expanded);
+    BOOST_CHECK(img1 == img2);
+  }
+
+  {
+    // An operation where a white source word modifies the destination,
+    // so blank rows can't be skipped.
+    BinaryImage img1(original);
+    BinaryImage img2(original);
+    rasterOp<And>(img1, mask);
+    rasterOp<And>(img2, expanded);
+    BOOST_CHECK(img1 == img2);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+}  // namespace tests
+}  // namespace imageproc
@@ -61,6 +61,19 @@ BOOST_AUTO_TEST_CASE(test_small_image) {
   BOOST_REQUIRE(v_shear_inplace == v_out_img);
 }
 
+BOOST_AUTO_TEST_CASE(test_shear_rotation) {
+  BinaryImage img(QSize(21, 21), WHITE);
+  img.fill(QRect(17, 10, 1, 1), BLACK);
+
+  // A zero angle rotation is an exact copy.
+  BOOST_REQUIRE(shearRotation(img, 0.0, WHITE) == img);
+
+  // A clockwise rotation takes a pixel right of the center downwards.
+  BinaryImage expected(QSize(21, 21), WHITE);
+  expected.fill(QRect(17, 11, 1, 1), BLACK);
+  BOOST_REQUIRE(shearRotation(img, 10.0, WHITE) == expected);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 }  // namespace tests
 }  // namespace imageproc
\ No newline at end of file
@@ -71,6 +71,22 @@ void InteractionState::updateProximity(Captor& captor,
   }
 }
 
+void InteractionState::requestRedraw(const QRectF& widget_area) {
+  if (!widget_area.isValid()) {
+    setRedrawRequested(true);
+
+    return;
+  }
+
+  if (!m_redrawRequested) {
+    m_redrawRequested = true;
+    m_redrawArea = widget_area;
+  } else if (!m_redrawArea.isNull()) {
+    m_redrawArea |= widget_area;
+  }
+  // Otherwise a full redraw was already requested.
+}
+
 bool InteractionState::proximityLeader(const Captor& captor) const {
   return !m_proximityLeader.empty() && &m_proximityLeader.front() == &captor;
 }
@@ -20,6 +20,7 @@
 #define INTERACTION_STATE_H_
 
 #include <QCursor>
+#include <QRectF>
 #include <QString>
 #include <boost/intrusive/list.hpp>
 #include "NonCopyable.h"
@@ -113,7 +114,29 @@ class InteractionState {
 
   bool redrawRequested() const { return m_redrawRequested; }
 
-  void setRedrawRequested(bool requested) { m_redrawRequested = requested; }
+  /**
+   * Requests (or cancels) a redraw of the whole viewport.
+   */
+  void setRedrawRequested(bool requested) {
+    m_redrawRequested = requested;
+    m_redrawArea = QRectF();
+  }
+
+  /**
+   * \brief Requests a redraw of just \p widget_area, in widget coordinates.
+   *
+   * Damage areas from multiple handlers accumulate into their bounding
+   * rectangle, and a plain setRedrawRequested(true) from any handler
+   * widens the redraw to the whole viewport.  An invalid area is
+   * treated as a full redraw.
+   */
+  void requestRedraw(const QRectF& widget_area);
+
+  /**
+   * The accumulated damage area.  A null rectangle means the whole
+   * viewport.
+   */
+  const QRectF& redrawArea() const { return m_redrawArea; }
 
  private:
   typedef boost::intrusive::list<Captor, boost::intrusive::constant_time_size<false>> CaptorList;
@@ -128,6 +151,7 @@ class InteractionState {
   CaptorList m_proximityLeader;
   Proximity m_bestProximity;
   Proximity m_proximityThreshold;
+  QRectF m_redrawArea;
   int m_bestProximityPriority;
   bool m_redrawRequested;
 };
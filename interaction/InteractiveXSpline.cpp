@@ -121,15 +121,29 @@ void InteractiveXSpline::onProximityUpdate(const QPointF& screen_mouse_pos, Inte
 void InteractiveXSpline::onMouseMoveEvent(QMouseEvent*, InteractionState& interaction) {
   if (interaction.proximityLeader(m_curveProximity)) {
     // We need to redraw the highlighted point.
-    interaction.setRedrawRequested(true);
+    QRectF damage(proximityPointDamage(m_curveProximityPointScreen));
+    if (m_lastProximity) {
+      // Un-draw it at its previous position as well.
+      damage |= proximityPointDamage(m_lastProximityPointScreen);
+    }
+    interaction.requestRedraw(damage);
+    m_lastProximityPointScreen = m_curveProximityPointScreen;
     m_lastProximity = true;
   } else if (m_lastProximity) {
     // In this case we need to un-draw the highlighted point.
-    interaction.setRedrawRequested(true);
+    interaction.requestRedraw(proximityPointDamage(m_lastProximityPointScreen));
     m_lastProximity = false;
   }
 }
 
+QRectF InteractiveXSpline::proximityPointDamage(const QPointF& screen_pt) {
+  // Generously covers the highlighted point our clients draw with
+  // a cosmetic pen a few pixels wide.
+  const double r = 5.0;
+
+  return QRectF(screen_pt.x() - r, screen_pt.y() - r, 2.0 * r, 2.0 * r);
+}
+
 void InteractiveXSpline::onMousePressEvent(QMouseEvent* event, InteractionState& interaction) {
   if (interaction.captured()) {
     return;
@@ -21,6 +21,7 @@
 
 #include <QCoreApplication>
 #include <QPointF>
+#include <QRectF>
 #include <boost/function.hpp>
 #include <boost/scoped_array.hpp>
 #include <cstddef>
@@ -90,6 +91,8 @@ class InteractiveXSpline : public InteractionHandler {
 
   static Vec4d rotationAndScale(const QPointF& from, const QPointF& to);
 
+  static QRectF proximityPointDamage(const QPointF& screen_pt);
+
   ModifiedCallback m_modifiedCallback;
   DragFinishedCallback m_dragFinishedCallback;
   Transform m_fromStorage;
@@ -99,6 +102,7 @@ class InteractiveXSpline : public InteractionHandler {
   InteractionState::Captor m_curveProximity;
   QPointF m_curveProximityPointStorage;
   QPointF m_curveProximityPointScreen;
+  QPointF m_lastProximityPointScreen;
   double m_curveProximityT;
   bool m_lastProximity;
 };
@@ -0,0 +1,216 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * \brief Compares two benchmark JSON outputs and fails on regressions.
+ *
+ * Reads a baseline and a candidate report, either from imageproc_benchmarks
+ * (a "benchmarks" array with ns_per_op) or from scantailor-benchmark (a
+ * "stages" array with wall_sec plus total_wall_sec), matches the entries by
+ * name and prints the relative change of each.  A candidate slower than the
+ * baseline by more than the noise threshold makes the exit status non-zero,
+ * so a release script can use this as a gate.
+ *
+ * Usage:
+ *   scantailor-benchmark-compare [--threshold=<pct>]
+ *       [--threshold=<name-prefix>:<pct>]... <baseline.json> <candidate.json>
+ *
+ * The default threshold is 5%.  Per-benchmark thresholds are given as a
+ * name prefix, so "--threshold=Morphology/:12" loosens every morphology
+ * benchmark at once; the longest matching prefix wins.  Some benchmarks
+ * are inherently noisier than others, which is why a single global
+ * threshold has let 30% stage regressions through in the past.
+ */
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QString>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+namespace {
+/** A single comparable figure: a benchmark, a stage, or a total. */
+struct Sample {
+  QString name;
+  double value;  // ns/op or seconds; lower is better in both cases.
+  QString unit;
+};
+
+/** A threshold rule: applies to every sample whose name starts with the prefix. */
+struct ThresholdRule {
+  QString prefix;  // Empty matches everything.
+  double percent;
+};
+
+void printUsage() {
+  std::fprintf(stderr,
+               "Usage: scantailor-benchmark-compare [--threshold=<pct>]\n"
+               "           [--threshold=<name-prefix>:<pct>]... <baseline.json> <candidate.json>\n"
+               "\n"
+               "Exits non-zero if any candidate figure is slower than the baseline\n"
+               "by more than its noise threshold (default 5%%).\n");
+}
+
+bool loadSamples(const QString& path, std::vector<Sample>* samples) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    std::fprintf(stderr, "Failed to open %s\n", path.toLocal8Bit().constData());
+    return false;
+  }
+
+  QJsonParseError parse_error{};
+  const QJsonDocument doc(QJsonDocument::fromJson(file.readAll(), &parse_error));
+  if (!doc.isObject()) {
+    std::fprintf(stderr, "%s: not a JSON object: %s\n", path.toLocal8Bit().constData(),
+                 parse_error.errorString().toLocal8Bit().constData());
+    return false;
+  }
+
+  const QJsonObject root(doc.object());
+
+  // imageproc_benchmarks format.
+  for (const QJsonValue val : root.value("benchmarks").toArray()) {
+    const QJsonObject obj(val.toObject());
+    samples->push_back(Sample{obj.value("name").toString(), obj.value("ns_per_op").toDouble(), "ns/op"});
+  }
+
+  // scantailor-benchmark format.
+  for (const QJsonValue val : root.value("stages").toArray()) {
+    const QJsonObject obj(val.toObject());
+    samples->push_back(Sample{"stage/" + obj.value("name").toString(), obj.value("wall_sec").toDouble(), "s"});
+  }
+  if (root.contains("total_wall_sec")) {
+    samples->push_back(Sample{"total", root.value("total_wall_sec").toDouble(), "s"});
+  }
+
+  if (samples->empty()) {
+    std::fprintf(stderr, "%s: no benchmark figures found\n", path.toLocal8Bit().constData());
+    return false;
+  }
+
+  return true;
+}
+
+double thresholdFor(const QString& name, const std::vector<ThresholdRule>& rules) {
+  double percent = 5.0;
+  int best_len = -1;
+  for (const ThresholdRule& rule : rules) {
+    if (name.startsWith(rule.prefix) && (rule.prefix.size() > best_len)) {
+      best_len = rule.prefix.size();
+      percent = rule.percent;
+    }
+  }
+
+  return percent;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<ThresholdRule> rules;
+  std::vector<QString> paths;
+
+  for (int i = 1; i < argc; ++i) {
+    const QString arg(QString::fromLocal8Bit(argv[i]));
+    if (arg.startsWith("--threshold=")) {
+      const QString spec(arg.mid(12));
+      const int colon = spec.lastIndexOf(':');
+      bool ok = false;
+      ThresholdRule rule;
+      if (colon >= 0) {
+        rule.prefix = spec.left(colon);
+        rule.percent = spec.mid(colon + 1).toDouble(&ok);
+      } else {
+        rule.percent = spec.toDouble(&ok);
+      }
+      if (!ok || (rule.percent < 0)) {
+        std::fprintf(stderr, "Bad threshold: %s\n", argv[i]);
+        printUsage();
+        return 2;
+      }
+      rules.push_back(rule);
+    } else if (arg.startsWith("--")) {
+      printUsage();
+      return 2;
+    } else {
+      paths.push_back(arg);
+    }
+  }
+
+  if (paths.size() != 2) {
+    printUsage();
+    return 2;
+  }
+
+  std::vector<Sample> baseline;
+  std::vector<Sample> candidate;
+  if (!loadSamples(paths[0], &baseline) || !loadSamples(paths[1], &candidate)) {
+    return 2;
+  }
+
+  std::map<QString, Sample> baseline_by_name;
+  for (const Sample& sample : baseline) {
+    baseline_by_name[sample.name] = sample;
+  }
+
+  int regressions = 0;
+  int compared = 0;
+
+  for (const Sample& cand : candidate) {
+    const auto it = baseline_by_name.find(cand.name);
+    if (it == baseline_by_name.end()) {
+      std::fprintf(stderr, "%-40s new benchmark, nothing to compare against\n", cand.name.toLocal8Bit().constData());
+      continue;
+    }
+
+    const Sample& base = it->second;
+    baseline_by_name.erase(it);
+    ++compared;
+
+    if (base.value <= 0) {
+      continue;
+    }
+
+    const double change_pct = (cand.value - base.value) / base.value * 100.0;
+    const double threshold_pct = thresholdFor(cand.name, rules);
+    const bool regressed = change_pct > threshold_pct;
+    if (regressed) {
+      ++regressions;
+    }
+
+    std::fprintf(stderr, "%-40s %12.1f -> %12.1f %-5s %+6.1f%%  (threshold %.1f%%)%s\n",
+                 cand.name.toLocal8Bit().constData(), base.value, cand.value, cand.unit.toLocal8Bit().constData(),
+                 change_pct, threshold_pct, regressed ? "  REGRESSION" : "");
+  }
+
+  for (const auto& kv : baseline_by_name) {
+    std::fprintf(stderr, "%-40s present in baseline only\n", kv.first.toLocal8Bit().constData());
+  }
+
+  if (regressions > 0) {
+    std::fprintf(stderr, "\n%d of %d benchmarks regressed beyond their noise threshold.\n", regressions, compared);
+    return 1;
+  }
+
+  std::fprintf(stderr, "\nNo regressions across %d benchmarks.\n", compared);
+
+  return 0;
+}
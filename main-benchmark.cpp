@@ -0,0 +1,327 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * \brief End-to-end throughput benchmark over a synthetic page corpus.
+ *
+ * Generates a deterministic set of synthetic scanned pages (text blocks,
+ * pictures, scanner-bed borders, a slight per-page skew), then drives them
+ * through the exact code path of ConsoleBatch, one filter stage at a time,
+ * and reports per-stage wall and CPU times plus the peak RSS of the whole
+ * run.  The figures are printed to stdout as JSON so runs of different
+ * builds can be compared mechanically.
+ *
+ * Usage:
+ *   scantailor-benchmark [--pages=<n>] [--dpi=<n>] [passthrough options] <work_dir>
+ *
+ * Anything else starting with "--" is passed through to CommandLine, so
+ * the usual scantailor-cli options (--color-mode, --threads, ...) can be
+ * benchmarked as well.  The corpus is written to <work_dir>/corpus and
+ * the output to <work_dir>/out.
+ */
+
+#include <QColor>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+#include <QString>
+#include <QStringList>
+#include <QTransform>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include "CommandLine.h"
+#include "ConsoleBatch.h"
+#include "Dpi.h"
+
+#if !defined(Q_OS_WIN)
+#include <sys/resource.h>
+#else
+#include <ctime>
+#endif
+
+namespace {
+/** CPU time consumed so far by this process and all its threads, in seconds. */
+double cpuSeconds() {
+#if !defined(Q_OS_WIN)
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + 1e-6 * (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+#else
+  return double(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+/** Peak resident set size of this process in kilobytes, or -1 if unknown. */
+long peakRssKb() {
+#if defined(Q_OS_WIN)
+  return -1;
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#if defined(Q_OS_MAC)
+  return usage.ru_maxrss / 1024;  // Bytes on macOS.
+#else
+  return usage.ru_maxrss;
+#endif
+#endif
+}
+
+uint32_t lcgNext(uint32_t& state) {
+  state = state * 1664525 + 1013904223;
+
+  return state;
+}
+
+/**
+ * Draws a synthetic scanned page: the dark scanner bed around a slightly
+ * skewed white sheet, paragraphs of word-like black blobs, and on every
+ * third page a halftone-like picture block.  The same \p page_idx always
+ * produces the same image.
+ */
+QImage synthesizePage(const int page_idx, const QSize& size, const Dpi& dpi) {
+  const double pixels_per_inch = dpi.horizontal();
+  uint32_t rng = 0x5eed0000 + page_idx;
+
+  QImage page(size, QImage::Format_RGB32);
+  page.setDotsPerMeterX(qRound(dpi.horizontal() * 1000.0 / 25.4));
+  page.setDotsPerMeterY(qRound(dpi.vertical() * 1000.0 / 25.4));
+  page.fill(0xff1a1a1a);  // The scanner bed around the sheet.
+
+  QPainter painter(&page);
+
+  // The sheet doesn't lie perfectly straight on the bed, which is what
+  // gives the deskew stage something to do.  Up to ~1 degree either way.
+  const double skew_deg = (int(lcgNext(rng) % 21) - 10) * 0.1;
+  QTransform skew;
+  skew.translate(0.5 * size.width(), 0.5 * size.height());
+  skew.rotate(skew_deg);
+  skew.translate(-0.5 * size.width(), -0.5 * size.height());
+  painter.setTransform(skew);
+
+  const int bed_margin = qRound(pixels_per_inch * 0.25);
+  const QRect sheet_rect(page.rect().adjusted(bed_margin, bed_margin, -bed_margin, -bed_margin));
+  painter.fillRect(sheet_rect, Qt::white);
+
+  const int text_margin = qRound(pixels_per_inch * 0.75);
+  const QRect text_rect(sheet_rect.adjusted(text_margin, text_margin, -text_margin, -text_margin));
+
+  const int line_height = qRound(pixels_per_inch * 0.14);
+  const int glyph_height = qRound(pixels_per_inch * 0.08);
+  const int word_gap = qRound(pixels_per_inch * 0.07);
+
+  int y = text_rect.top();
+  while (y + glyph_height <= text_rect.bottom()) {
+    if (lcgNext(rng) % 8 == 0) {
+      // A paragraph break.
+      y += line_height;
+      continue;
+    }
+
+    int x = text_rect.left();
+    // The last line of a paragraph ends early.
+    const int line_end = text_rect.right() - int(lcgNext(rng) % 5 == 0 ? lcgNext(rng) % text_rect.width() / 2 : 0);
+    while (x < line_end) {
+      const int word_width = qRound(pixels_per_inch * (0.15 + 0.01 * (lcgNext(rng) % 40)));
+      painter.fillRect(QRect(x, y, std::min(word_width, line_end - x), glyph_height), Qt::black);
+      x += word_width + word_gap;
+    }
+    y += line_height;
+  }
+
+  if (page_idx % 3 == 0) {
+    // A halftone-like picture block in the middle of the page, so that
+    // the mixed output mode has a picture zone to find.
+    const QRect picture_rect(text_rect.left(), text_rect.top() + text_rect.height() / 3, text_rect.width(),
+                             qRound(pixels_per_inch * 1.5));
+    const int cell = std::max(2, qRound(pixels_per_inch * 0.01));
+    for (int py = picture_rect.top(); py < picture_rect.bottom(); py += cell) {
+      for (int px = picture_rect.left(); px < picture_rect.right(); px += cell) {
+        const int gray = 64 + int(lcgNext(rng) % 128);
+        painter.fillRect(px, py, cell, cell, QColor(gray, gray, gray));
+      }
+    }
+  }
+
+  painter.end();
+
+  return page;
+}  // synthesizePage
+
+struct StageTiming {
+  QString name;
+  double wallSec;
+  double cpuSec;
+};
+
+void printUsage() {
+  std::cout << "usage: scantailor-benchmark [--pages=<n>] [--dpi=<n>]"
+            << " [scantailor-cli options] <work_dir>" << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  QCoreApplication app(argc, argv);
+
+  int num_pages = 10;
+  int dpi_value = 300;
+  QStringList passthrough_options;
+  QString work_dir;
+
+  const QStringList args(app.arguments());
+  for (int i = 1; i < args.size(); ++i) {
+    const QString& arg = args[i];
+    if (arg.startsWith("--pages=")) {
+      num_pages = arg.section('=', 1).toInt();
+    } else if (arg.startsWith("--dpi=")) {
+      dpi_value = arg.section('=', 1).toInt();
+    } else if (arg.startsWith("--")) {
+      passthrough_options << arg;
+    } else if (work_dir.isEmpty()) {
+      work_dir = arg;
+    } else {
+      printUsage();
+
+      return 1;
+    }
+  }
+
+  if (work_dir.isEmpty() || (num_pages < 1) || (dpi_value < 72)) {
+    printUsage();
+
+    return 1;
+  }
+
+  const QString corpus_dir = work_dir + "/corpus";
+  const QString output_dir = work_dir + "/out";
+  if (!QDir().mkpath(corpus_dir) || !QDir().mkpath(output_dir)) {
+    std::cerr << "scantailor-benchmark: unable to create " << work_dir.toLatin1().constData() << std::endl;
+
+    return 1;
+  }
+
+  typedef std::chrono::steady_clock Clock;
+
+  // A letter-size sheet plus the scanner bed around it.
+  const Dpi dpi(dpi_value, dpi_value);
+  const QSize page_size(qRound(dpi_value * 9.0), qRound(dpi_value * 12.0));
+
+  const Clock::time_point corpus_start(Clock::now());
+  QStringList corpus_files;
+  for (int i = 0; i < num_pages; ++i) {
+    const QString file_path = QString("%1/page_%2.png").arg(corpus_dir).arg(i + 1, 4, 10, QChar('0'));
+    if (!QFile::exists(file_path)) {
+      // Generation is deterministic, so pages left by a previous run
+      // with the same geometry are exactly the ones we would write.
+      if (!synthesizePage(i, page_size, dpi).save(file_path)) {
+        std::cerr << "scantailor-benchmark: unable to write " << file_path.toLatin1().constData() << std::endl;
+
+        return 1;
+      }
+    }
+    corpus_files << file_path;
+  }
+  const double corpus_sec = std::chrono::duration<double>(Clock::now() - corpus_start).count();
+  std::fprintf(stderr, "%-16s %8.2f s wall\n", "corpus", corpus_sec);
+
+  // Build the same CommandLine a scantailor-cli invocation would see, so
+  // that ConsoleBatch takes exactly its production code path.
+  QStringList base_args;
+  base_args << args[0] << QString("--dpi=%1").arg(dpi_value) << passthrough_options << corpus_files << output_dir;
+
+  CommandLine base_cli(base_args, false);
+  CommandLine::set(base_cli);
+  if (base_cli.isError()) {
+    base_cli.printHelp();
+
+    return 1;
+  }
+
+  const char* const stage_names[] = {"fix_orientation", "page_split", "deskew", "select_content", "page_layout",
+                                     "output"};
+  const int num_stages = 6;
+
+  std::vector<StageTiming> timings;
+
+  try {
+    ConsoleBatch cbatch(base_cli.images(), output_dir, base_cli.getLayoutDirection());
+
+    for (int j = 0; j < num_stages; ++j) {
+      // Restricting each process() call to a single filter gives us
+      // per-stage timings while keeping the batch loop itself, the
+      // worker crew and the output write queue barrier all timed.
+      QStringList stage_args(base_args);
+      stage_args.insert(1, QString("--start-filter=%1").arg(j + 1));
+      stage_args.insert(2, QString("--end-filter=%1").arg(j + 1));
+      CommandLine stage_cli(stage_args, false);
+      CommandLine::set(stage_cli);
+
+      const Clock::time_point wall_start(Clock::now());
+      const double cpu_start = cpuSeconds();
+      cbatch.process();
+      const double cpu_sec = cpuSeconds() - cpu_start;
+      const double wall_sec = std::chrono::duration<double>(Clock::now() - wall_start).count();
+
+      StageTiming timing;
+      timing.name = stage_names[j];
+      timing.wallSec = wall_sec;
+      timing.cpuSec = cpu_sec;
+      timings.push_back(timing);
+
+      std::fprintf(stderr, "%-16s %8.2f s wall %8.2f s cpu\n", stage_names[j], wall_sec, cpu_sec);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+
+    return 1;
+  }
+
+  double total_wall = 0;
+  double total_cpu = 0;
+  for (const StageTiming& timing : timings) {
+    total_wall += timing.wallSec;
+    total_cpu += timing.cpuSec;
+  }
+  const long peak_rss_kb = peakRssKb();
+  std::fprintf(stderr, "%-16s %8.2f s wall %8.2f s cpu %8ld KB peak RSS\n", "total", total_wall, total_cpu,
+               peak_rss_kb);
+
+  std::printf("{\n");
+  std::printf("  \"pages\": %d, \"dpi\": %d, \"corpus_sec\": %.3f,\n", num_pages, dpi_value, corpus_sec);
+  std::printf("  \"stages\": [\n");
+  for (size_t i = 0; i < timings.size(); ++i) {
+    const StageTiming& timing = timings[i];
+    std::printf("    {\"name\": \"%s\", \"wall_sec\": %.3f, \"cpu_sec\": %.3f}%s\n",
+                timing.name.toLatin1().constData(), timing.wallSec, timing.cpuSec,
+                i + 1 < timings.size() ? "," : "");
+  }
+  std::printf("  ],\n");
+  std::printf("  \"total_wall_sec\": %.3f, \"total_cpu_sec\": %.3f, \"peak_rss_kb\": %ld\n", total_wall, total_cpu,
+              peak_rss_kb);
+  std::printf("}\n");
+
+  return 0;
+}  // main
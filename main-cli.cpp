@@ -22,6 +22,7 @@
 
 #include "CommandLine.h"
 #include "ConsoleBatch.h"
+#include "ConsoleDaemon.h"
 
 
 int main(int argc, char** argv) {
@@ -42,6 +43,13 @@ int main(int argc, char** argv) {
     return 1;
   }
 
+  if (cli.hasDaemon()) {
+    // Serve jobs until shutdown, amortizing process startup across them.
+    ConsoleDaemon daemon(cli.getDaemonSocket());
+
+    return daemon.run();
+  }
+
   if (cli.hasHelp() || cli.outputDirectory().isEmpty() || ((cli.images().size() == 0) && cli.projectFile().isEmpty())) {
     cli.printHelp();
 
@@ -17,6 +17,7 @@
  */
 
 #include "ArcLengthMapper.h"
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 
@@ -27,9 +28,12 @@ void ArcLengthMapper::Hint::update(int new_segment) {
   m_lastSegment = new_segment;
 }
 
-ArcLengthMapper::ArcLengthMapper() : m_prevFX() {}
+ArcLengthMapper::ArcLengthMapper() : m_prevFX(), m_invArcLenCellSize(), m_invXCellSize() {}
 
 void ArcLengthMapper::addSample(double x, double fx) {
+  m_arcLenToSegment.clear();
+  m_xToSegment.clear();
+
   double arc_len = 0;
 
   if (!m_samples.empty()) {
@@ -48,6 +52,9 @@ double ArcLengthMapper::totalArcLength() const {
 }
 
 void ArcLengthMapper::normalizeRange(double total_arc_len) {
+  m_arcLenToSegment.clear();
+  m_xToSegment.clear();
+
   if (m_samples.size() <= 1) {
     // If size == 1, samples.back().arcLen below will be 0.
     return;
@@ -61,6 +68,50 @@ void ArcLengthMapper::normalizeRange(double total_arc_len) {
   }
 }
 
+void ArcLengthMapper::buildLookupTables() {
+  m_arcLenToSegment.clear();
+  m_xToSegment.clear();
+
+  if (m_samples.size() < 2) {
+    return;
+  }
+
+  const auto num_segments = static_cast<int>(m_samples.size() - 1);
+  // Twice as many cells as segments keeps the walk from a cell's
+  // starting segment to the right one short.
+  const int num_cells = num_segments * 2;
+
+  const double arc_len_range = m_samples.back().arcLen - m_samples.front().arcLen;
+  const double x_range = m_samples.back().x - m_samples.front().x;
+  if ((arc_len_range <= 0) || (x_range <= 0)) {
+    return;
+  }
+
+  m_invArcLenCellSize = num_cells / arc_len_range;
+  m_invXCellSize = num_cells / x_range;
+
+  m_arcLenToSegment.resize(num_cells);
+  m_xToSegment.resize(num_cells);
+
+  int segment = 0;
+  for (int cell = 0; cell < num_cells; ++cell) {
+    const double cell_start = m_samples.front().arcLen + cell / m_invArcLenCellSize;
+    while ((segment < num_segments - 1) && (m_samples[segment + 1].arcLen <= cell_start)) {
+      ++segment;
+    }
+    m_arcLenToSegment[cell] = segment;
+  }
+
+  segment = 0;
+  for (int cell = 0; cell < num_cells; ++cell) {
+    const double cell_start = m_samples.front().x + cell / m_invXCellSize;
+    while ((segment < num_segments - 1) && (m_samples[segment + 1].x <= cell_start)) {
+      ++segment;
+    }
+    m_xToSegment[cell] = segment;
+  }
+}  // ArcLengthMapper::buildLookupTables
+
 double ArcLengthMapper::arcLenToX(double arc_len, Hint& hint) const {
   switch (m_samples.size()) {
     case 0:
@@ -94,6 +145,14 @@ double ArcLengthMapper::arcLenToX(double arc_len, Hint& hint) const {
 
     return interpolateArcLenInSegment(arc_len, hint.m_lastSegment);
   }
+
+  if (!m_arcLenToSegment.empty()) {
+    // An O(1) lookup into the precomputed table.
+    const int left_idx = lookupSegmentForArcLen(arc_len);
+    hint.update(left_idx);
+
+    return interpolateArcLenInSegment(arc_len, left_idx);
+  }
   // Do a binary search.
   int left_idx = 0;
   auto right_idx = static_cast<int>(m_samples.size() - 1);
@@ -149,6 +208,14 @@ double ArcLengthMapper::xToArcLen(double x, Hint& hint) const {
 
     return interpolateXInSegment(x, hint.m_lastSegment);
   }
+
+  if (!m_xToSegment.empty()) {
+    // An O(1) lookup into the precomputed table.
+    const int left_idx = lookupSegmentForX(x);
+    hint.update(left_idx);
+
+    return interpolateXInSegment(x, left_idx);
+  }
   // Do a binary search.
   int left_idx = 0;
   auto right_idx = static_cast<int>(m_samples.size() - 1);
@@ -171,6 +238,42 @@ double ArcLengthMapper::xToArcLen(double x, Hint& hint) const {
   return interpolateXInSegment(x, left_idx);
 }  // ArcLengthMapper::xToArcLen
 
+int ArcLengthMapper::lookupSegmentForArcLen(double arc_len) const {
+  assert(!m_arcLenToSegment.empty());  // Enforced by the caller.
+  const auto num_cells = static_cast<int>(m_arcLenToSegment.size());
+  const auto num_segments = static_cast<int>(m_samples.size() - 1);
+
+  auto cell = static_cast<int>((arc_len - m_samples.front().arcLen) * m_invArcLenCellSize);
+  cell = std::max(0, std::min(cell, num_cells - 1));
+
+  // The table gives us the segment containing the cell's start.
+  // The one containing arc_len can only be further to the right.
+  int segment = m_arcLenToSegment[cell];
+  while ((segment < num_segments - 1) && (m_samples[segment + 1].arcLen < arc_len)) {
+    ++segment;
+  }
+
+  return segment;
+}
+
+int ArcLengthMapper::lookupSegmentForX(double x) const {
+  assert(!m_xToSegment.empty());  // Enforced by the caller.
+  const auto num_cells = static_cast<int>(m_xToSegment.size());
+  const auto num_segments = static_cast<int>(m_samples.size() - 1);
+
+  auto cell = static_cast<int>((x - m_samples.front().x) * m_invXCellSize);
+  cell = std::max(0, std::min(cell, num_cells - 1));
+
+  // The table gives us the segment containing the cell's start.
+  // The one containing x can only be further to the right.
+  int segment = m_xToSegment[cell];
+  while ((segment < num_segments - 1) && (m_samples[segment + 1].x < x)) {
+    ++segment;
+  }
+
+  return segment;
+}
+
 bool ArcLengthMapper::checkSegmentForArcLen(double arc_len, int segment) const {
   assert(m_samples.size() > 1);  // Enforced by the caller.
   if ((segment < 0) || (segment >= int(m_samples.size()) - 1)) {
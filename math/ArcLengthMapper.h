@@ -74,6 +74,17 @@ class ArcLengthMapper {
    */
   void normalizeRange(double total_arc_len);
 
+  /**
+   * \brief Builds uniformly-spaced lookup tables that let queries
+   *        find their segment in O(1) instead of by binary search.
+   *
+   * Should be called once after all samples have been added and after
+   * normalizeRange(), if used, as both invalidate the tables.  Queries
+   * work without the tables, falling back to binary search, and return
+   * identical results either way.
+   */
+  void buildLookupTables();
+
   /**
    * \brief Maps from arc length to the corresponding function argument.
    *
@@ -102,8 +113,21 @@ class ArcLengthMapper {
 
   double interpolateXInSegment(double x, int segment) const;
 
+  int lookupSegmentForArcLen(double arc_len) const;
+
+  int lookupSegmentForX(double x) const;
+
   std::vector<Sample> m_samples;
   double m_prevFX;
+
+  /**
+   * Map a uniform grid over the range of sample values to the segment
+   * containing each grid cell's start.  \see buildLookupTables()
+   */
+  std::vector<int> m_arcLenToSegment;
+  std::vector<int> m_xToSegment;
+  double m_invArcLenCellSize;
+  double m_invXCellSize;
 };
 
 
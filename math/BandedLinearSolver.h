@@ -0,0 +1,186 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BANDED_LINEAR_SOLVER_H_
+#define BANDED_LINEAR_SOLVER_H_
+
+#include <boost/scoped_array.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+/**
+ * \brief Solves Ax = b for a square banded matrix A using LU decomposition
+ *        with partial pivoting.
+ *
+ * Unlike LinearSolver, which costs O(n^3), this one costs
+ * O(n * kl * (kl + ku)), where kl and ku are the lower and upper
+ * bandwidths of A.  That makes it the right tool for the banded
+ * systems produced by spline fitting, where each equation only
+ * involves a few neighbouring control points.
+ *
+ * \note The matrix is passed in band storage: element A(i, j) lives at
+ *       AB[j * (2*kl + ku + 1) + kl + ku + i - j].  The top kl entries
+ *       of each column are workspace for fill-in produced by row
+ *       pivoting and must be zero on entry, as must any in-band
+ *       positions that lie outside of A.
+ *
+ * \see LinearSolver
+ */
+class BandedLinearSolver {
+  // Member-wise copying is OK.
+ public:
+  /**
+   * \throw std::runtime_error If a bandwidth is not below num_rows.
+   */
+  BandedLinearSolver(size_t num_rows, size_t lower_bandwidth, size_t upper_bandwidth);
+
+  /**
+   * \brief Solves Ax = b
+   *
+   * \param AB Matrix A in band storage (see the class-level note).
+   *        It's clobbered by the factorization.
+   * \param X Vector X.  Results will be written here.
+   * \param B Vector B.  It's allowed to pass the same pointer for X and B.
+   * \param pbuffer Temporary buffer of at least "rows(A)" size_t elements.
+   *
+   * \throw std::runtime_error If the system can't be solved.
+   */
+  template <typename T>
+  void solve(T* AB, T* X, const T* B, size_t* pbuffer) const;
+
+  /**
+   * \brief A simplified version of the one above.
+   *
+   * In this version, the buffer is allocated internally.
+   */
+  template <typename T>
+  void solve(T* AB, T* X, const T* B) const;
+
+ private:
+  size_t m_numRows;
+  size_t m_lowerBandwidth;
+  size_t m_upperBandwidth;
+};
+
+
+template <typename T>
+void BandedLinearSolver::solve(T* AB, T* X, const T* B, size_t* pbuffer) const {
+  using namespace std;  // To catch different overloads of std::abs()
+  const T epsilon(std::sqrt(numeric_limits<T>::epsilon()));
+
+  const size_t n = m_numRows;
+  const size_t kl = m_lowerBandwidth;
+  const size_t ku = m_upperBandwidth;
+  const size_t ldab = 2 * kl + ku + 1;
+  // Position of the main diagonal within a column of AB.
+  const size_t diag = kl + ku;
+
+  size_t* const pivot = pbuffer;
+
+  // Factorize PA = LU in place.  Multipliers of L go below the
+  // diagonal, U goes on and above it.  Row swaps make the bandwidth
+  // of U grow from ku up to kl + ku, which is what the workspace
+  // rows of AB are for.
+  size_t last_col = 0;  // The rightmost column touched by row swaps so far.
+  for (size_t i = 0; i < n; ++i) {
+    const size_t num_sub = std::min(kl, n - 1 - i);  // Sub-diagonal elements in this column.
+    T* const p_col = AB + i * ldab;
+
+    // Find the largest pivot among the diagonal and sub-diagonal elements.
+    size_t pivot_sub = 0;
+    T largest_abs_pivot(std::abs(p_col[diag]));
+    for (size_t p = 1; p <= num_sub; ++p) {
+      const T abs_pivot(std::abs(p_col[diag + p]));
+      if (abs_pivot > largest_abs_pivot) {
+        largest_abs_pivot = abs_pivot;
+        pivot_sub = p;
+      }
+    }
+
+    if (largest_abs_pivot <= epsilon) {
+      throw std::runtime_error("BandedLinearSolver: not a full rank matrix");
+    }
+
+    pivot[i] = i + pivot_sub;
+    last_col = std::max(last_col, std::min(i + ku + pivot_sub, n - 1));
+
+    if (pivot_sub != 0) {
+      // Swap rows i and i + pivot_sub within the band.
+      for (size_t col = i; col <= last_col; ++col) {
+        T* const p_row_i = AB + col * ldab + diag + i - col;
+        std::swap(p_row_i[0], p_row_i[pivot_sub]);
+      }
+    }
+
+    // Compute the multipliers.
+    const T r_pivot(T(1) / p_col[diag]);
+    for (size_t p = 1; p <= num_sub; ++p) {
+      p_col[diag + p] *= r_pivot;
+    }
+
+    // Update the trailing submatrix within the band.
+    for (size_t col = i + 1; col <= last_col; ++col) {
+      T* const p_row_i = AB + col * ldab + diag + i - col;
+      const T factor(p_row_i[0]);
+      if (factor != T()) {
+        for (size_t p = 1; p <= num_sub; ++p) {
+          p_row_i[p] -= factor * p_col[diag + p];
+        }
+      }
+    }
+  }
+
+  // First solve Ly = Pb
+  for (size_t i = 0; i < n; ++i) {
+    X[i] = B[i];
+  }
+  for (size_t i = 0; i < n; ++i) {
+    std::swap(X[i], X[pivot[i]]);
+
+    const size_t num_sub = std::min(kl, n - 1 - i);
+    const T* const p_col = AB + i * ldab;
+    const T y_i(X[i]);
+    for (size_t p = 1; p <= num_sub; ++p) {
+      X[i + p] -= p_col[diag + p] * y_i;
+    }
+  }
+
+  // Now solve Ux = y
+  for (size_t i = n; i-- > 0;) {
+    const T* const p_col = AB + i * ldab;
+    X[i] /= p_col[diag];
+
+    const size_t num_super = std::min(kl + ku, i);
+    const T x_i(X[i]);
+    for (size_t p = 1; p <= num_super; ++p) {
+      X[i - p] -= p_col[diag - p] * x_i;
+    }
+  }
+}  // BandedLinearSolver::solve
+
+template <typename T>
+void BandedLinearSolver::solve(T* AB, T* X, const T* B) const {
+  boost::scoped_array<size_t> pbuffer(new size_t[m_numRows]);
+
+  solve(AB, X, B, pbuffer.get());
+}
+
+#endif  // ifndef BANDED_LINEAR_SOLVER_H_
@@ -0,0 +1,146 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LDLT_SOLVER_H_
+#define LDLT_SOLVER_H_
+
+#include <boost/scoped_array.hpp>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+/**
+ * \brief Solves Ax = b for a symmetric positive definite A
+ *        using LDL^T decomposition.
+ *
+ * Roughly half the flops of the LU decomposition in LinearSolver,
+ * no pivoting and therefore better locality.  Normal equations of
+ * least squares problems are the typical use case.  Only the lower
+ * triangle of A is ever read.
+ *
+ * \note All matrices are assumed to be in column-major order.
+ *
+ * \see LinearSolver, MatrixCalc
+ */
+class LDLTSolver {
+  // Member-wise copying is OK.
+ public:
+  explicit LDLTSolver(size_t rows_AB, size_t cols_BX = 1);
+
+  /**
+   * \brief Solves Ax = b
+   *
+   * \param A Matrix A.  Must be symmetric positive definite.
+   * \param X Matrix (or vector) X.  Results will be written here.
+   * \param B Matrix (or vector) B.  It's allowed to pass the same pointer for X and B.
+   * \param tbuffer Temporary buffer of at least "rows(A) * (rows(A) + 1)" T elements.
+   *
+   * \throw std::runtime_error If the matrix is not positive definite.
+   */
+  template <typename T>
+  void solve(const T* A, T* X, const T* B, T* tbuffer) const;
+
+  /**
+   * \brief A simplified version of the one above.
+   *
+   * In this version, the buffer is allocated internally.
+   */
+  template <typename T>
+  void solve(const T* A, T* X, const T* B) const;
+
+ private:
+  size_t m_rowsAB;
+  size_t m_colsBX;
+};
+
+
+template <typename T>
+void LDLTSolver::solve(const T* A, T* X, const T* B, T* tbuffer) const {
+  using namespace std;  // To catch different overloads of std::abs()
+  const T epsilon(std::sqrt(numeric_limits<T>::epsilon()));
+
+  const size_t n = m_rowsAB;
+
+  T* const l_data = tbuffer;  // Dimensions: n, n.  Only the lower triangle is used.
+  tbuffer += n * n;
+  T* const d_data = tbuffer;  // The diagonal of D.
+
+  // Factorize A = L * D * L^T, with L unit lower triangular.
+  for (size_t j = 0; j < n; ++j) {
+    T* const p_col = l_data + j * n;
+
+    T d(A[j * n + j]);
+    for (size_t k = 0; k < j; ++k) {
+      const T l_jk = l_data[k * n + j];
+      d -= l_jk * l_jk * d_data[k];
+    }
+    if (d <= epsilon) {
+      throw std::runtime_error("LDLTSolver: not a positive definite matrix");
+    }
+    d_data[j] = d;
+
+    const T r_d(T(1) / d);
+    for (size_t i = j + 1; i < n; ++i) {
+      T sum(A[j * n + i]);
+      for (size_t k = 0; k < j; ++k) {
+        sum -= l_data[k * n + i] * l_data[k * n + j] * d_data[k];
+      }
+      p_col[i] = sum * r_d;
+    }
+  }
+
+  // First solve Lz = b, then Dw = z, then L^T x = w.
+  T* p_x_col = X;
+  const T* p_b_col = B;
+  for (size_t x_col = 0; x_col < m_colsBX; ++x_col) {
+    for (size_t i = 0; i < n; ++i) {
+      T right(p_b_col[i]);
+      for (size_t k = 0; k < i; ++k) {
+        right -= l_data[k * n + i] * p_x_col[k];
+      }
+      // We assume L has ones on the diagonal, so no division here.
+      p_x_col[i] = right;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      p_x_col[i] /= d_data[i];
+    }
+
+    for (size_t i = n; i-- > 0;) {
+      T right(p_x_col[i]);
+      for (size_t k = i + 1; k < n; ++k) {
+        right -= l_data[i * n + k] * p_x_col[k];
+      }
+      p_x_col[i] = right;
+    }
+
+    p_x_col += n;
+    p_b_col += n;
+  }
+}  // LDLTSolver::solve
+
+template <typename T>
+void LDLTSolver::solve(const T* A, T* X, const T* B) const {
+  boost::scoped_array<T> tbuffer(new T[m_rowsAB * (m_rowsAB + 1)]);
+
+  solve(A, X, B, tbuffer.get());
+}
+
+#endif  // ifndef LDLT_SOLVER_H_
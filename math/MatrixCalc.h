@@ -21,7 +21,9 @@
 
 #include <cassert>
 #include <cstddef>
+#include "ArenaPool.h"
 #include "DynamicPool.h"
+#include "LDLTSolver.h"
 #include "LinearSolver.h"
 #include "MatMNT.h"
 #include "MatT.h"
@@ -69,6 +71,29 @@ class DynamicPoolAllocator : public AbstractAllocator<T> {
 };
 
 
+/**
+ * Like DynamicPoolAllocator, but for trivially destructible types only:
+ * storage recycles through ArenaPool's thread-local chunk freelists, so
+ * creating a calculator per solve iteration doesn't hit the heap.
+ */
+template <typename T>
+class ArenaPoolAllocator : public AbstractAllocator<T> {
+ public:
+  virtual T* allocT(size_t size) { return m_poolT.alloc(size); }
+
+  virtual size_t* allocP(size_t size) { return m_poolP.alloc(size); }
+
+  void reset() {
+    m_poolP.reset();
+    m_poolT.reset();
+  }
+
+ private:
+  ArenaPool<size_t> m_poolP;
+  ArenaPool<T> m_poolT;
+};
+
+
 template <typename T>
 class Mat {
   template <typename OT, typename Alloc>
@@ -99,6 +124,15 @@ class Mat {
 
   Mat solve(const T* data, int rows, int cols) const;
 
+  /**
+   * \brief Like solve(), but for a symmetric positive definite matrix.
+   *
+   * Uses the LDL^T decomposition, which costs roughly half of the
+   * general LU.  Throws std::runtime_error if the matrix turns out
+   * not to be positive definite.
+   */
+  Mat solvePosDef(const Mat& b) const;
+
   Mat trans() const;
 
   Mat write(T* buf) const;
@@ -168,7 +202,7 @@ class StaticMatrixCalc : public MatrixCalc<T, mcalc::StaticPoolAllocator<T, TSiz
 
 
 template <typename T>
-class DynamicMatrixCalc : public MatrixCalc<T, mcalc::DynamicPoolAllocator<T>> {};
+class DynamicMatrixCalc : public MatrixCalc<T, mcalc::ArenaPoolAllocator<T>> {};
 
 
 /*========================== Implementation =============================*/
@@ -208,6 +242,18 @@ Mat<T> Mat<T>::solve(const T* data, int rows, int cols) const {
   return solve(Mat(alloc, data, rows, cols));
 }
 
+template <typename T>
+Mat<T> Mat<T>::solvePosDef(const Mat& b) const {
+  assert(cols == rows);
+  assert(rows == b.rows);
+
+  T* x_data = alloc->allocT(cols * b.cols);
+  T* tbuffer = alloc->allocT(rows * (rows + 1));
+  LDLTSolver(rows, b.cols).solve(data, x_data, b.data, tbuffer);
+
+  return Mat(alloc, x_data, cols, b.cols);
+}
+
 template <typename T>
 Mat<T> Mat<T>::trans() const {
   if ((cols == 1) || (rows == 1)) {
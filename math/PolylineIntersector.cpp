@@ -17,7 +17,9 @@
  */
 
 #include "PolylineIntersector.h"
+#include <algorithm>
 #include <cmath>
+#include <numeric>
 #include "ToLineProjector.h"
 
 PolylineIntersector::Hint::Hint() : m_lastSegment(0), m_direction(1) {}
@@ -28,7 +30,100 @@ void PolylineIntersector::Hint::update(int new_segment) {
 }
 
 PolylineIntersector::PolylineIntersector(const std::vector<QPointF>& polyline)
-    : m_polyline(polyline), m_numSegments(static_cast<int>(polyline.size() - 1)) {}
+    : m_polyline(polyline), m_numSegments(static_cast<int>(polyline.size() - 1)), m_chordLength(0) {
+  buildSegmentIndex();
+}
+
+void PolylineIntersector::buildSegmentIndex() {
+  // Short polylines are served well enough by the binary search.
+  if (m_numSegments < 8) {
+    return;
+  }
+
+  m_chordOrigin = Vec2d(m_polyline.front());
+  const Vec2d chord(Vec2d(m_polyline.back()) - m_chordOrigin);
+  m_chordLength = std::sqrt(chord.squaredNorm());
+  if (m_chordLength < 1e-6) {
+    m_chordLength = 0;
+    return;
+  }
+  m_chordDir = chord * (1.0 / m_chordLength);
+
+  const int num_cells = m_numSegments;
+  const double param_to_cell = num_cells / m_chordLength;
+
+  const auto cell_range = [this, num_cells, param_to_cell](int segment, int& c1, int& c2) {
+    const double t1 = m_chordDir.dot(Vec2d(m_polyline[segment]) - m_chordOrigin);
+    const double t2 = m_chordDir.dot(Vec2d(m_polyline[segment + 1]) - m_chordOrigin);
+    c1 = std::max(0, std::min(num_cells - 1, int(std::floor(std::min(t1, t2) * param_to_cell))));
+    c2 = std::max(0, std::min(num_cells - 1, int(std::floor(std::max(t1, t2) * param_to_cell))));
+  };
+
+  // Compressed rows: a counting pass, a prefix sum, then a fill pass.
+  m_cellStarts.assign(num_cells + 1, 0);
+  for (int i = 0; i < m_numSegments; ++i) {
+    int c1, c2;
+    cell_range(i, c1, c2);
+    for (int c = c1; c <= c2; ++c) {
+      ++m_cellStarts[c + 1];
+    }
+  }
+  std::partial_sum(m_cellStarts.begin(), m_cellStarts.end(), m_cellStarts.begin());
+
+  m_cellSegments.resize(m_cellStarts.back());
+  std::vector<int> fill_pos(m_cellStarts.begin(), m_cellStarts.end() - 1);
+  for (int i = 0; i < m_numSegments; ++i) {
+    int c1, c2;
+    cell_range(i, c1, c2);
+    for (int c = c1; c <= c2; ++c) {
+      m_cellSegments[fill_pos[c]++] = i;
+    }
+  }
+}
+
+bool PolylineIntersector::intersectUsingIndex(const QLineF& line,
+                                              const QLineF& normal,
+                                              QPointF& intersection,
+                                              Hint& hint) const {
+  if (m_cellStarts.empty()) {
+    return false;
+  }
+
+  const Vec2d nv(normal.p2() - normal.p1());
+
+  // The parameter at which the query line crosses the chord.  For a
+  // line nearly parallel to the chord this is unstable, so such
+  // queries take the fallback path.
+  const double denom = nv.dot(m_chordDir);
+  if (std::fabs(denom) < 1e-6 * std::sqrt(nv.squaredNorm())) {
+    return false;
+  }
+  const double s = nv.dot(Vec2d(normal.p1()) - m_chordOrigin) / denom;
+
+  const auto num_cells = static_cast<int>(m_cellStarts.size() - 1);
+  const int cell = int(std::floor(s * num_cells / m_chordLength));
+  if ((cell < -1) || (cell > num_cells)) {
+    return false;
+  }
+
+  // The actual crossing may project into a neighboring cell when the
+  // polyline bends away from its chord, so scan one cell to each side.
+  const int c1 = std::max(0, cell - 1);
+  const int c2 = std::min(num_cells - 1, cell + 1);
+  for (int c = c1; c <= c2; ++c) {
+    for (int i = m_cellStarts[c]; i < m_cellStarts[c + 1]; ++i) {
+      const int segment = m_cellSegments[i];
+      if (intersectsSegment(normal, segment)) {
+        hint.update(segment);
+        intersection = intersectWithSegment(line, segment);
+
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
 
 QPointF PolylineIntersector::intersect(const QLineF& line, Hint& hint) const {
   const QLineF normal(line.normalVector());
@@ -53,8 +148,13 @@ QPointF PolylineIntersector::intersect(const QLineF& line, Hint& hint) const {
     return intersectWithSegment(line, segment);
   }
 
-  // Does the whole polyline intersect our line?
+  // Locate the crossing through the segment index.
   QPointF intersection;
+  if (intersectUsingIndex(line, normal, intersection, hint)) {
+    return intersection;
+  }
+
+  // Does the whole polyline intersect our line?
   if (tryIntersectingOutsideOfPolyline(line, intersection, hint)) {
     return intersection;
   }
@@ -84,6 +184,18 @@ QPointF PolylineIntersector::intersect(const QLineF& line, Hint& hint) const {
   return intersectWithSegment(line, left_idx);
 }  // PolylineIntersector::intersect
 
+std::vector<QPointF> PolylineIntersector::intersectAll(const std::vector<QLineF>& lines) const {
+  Hint hint;
+
+  std::vector<QPointF> intersections;
+  intersections.reserve(lines.size());
+  for (const QLineF& line : lines) {
+    intersections.push_back(intersect(line, hint));
+  }
+
+  return intersections;
+}
+
 bool PolylineIntersector::intersectsSegment(const QLineF& normal, int segment) const {
   if ((segment < 0) || (segment >= m_numSegments)) {
     return false;
@@ -44,7 +44,21 @@ class PolylineIntersector {
 
   QPointF intersect(const QLineF& line, Hint& hint) const;
 
+  /**
+   * \brief Intersects an ordered sweep of lines with the polyline.
+   *
+   * Equivalent to calling intersect() once per line with a shared
+   * hint, which is the access pattern of dewarping grid construction:
+   * consecutive lines cross the polyline in nearby segments, so most
+   * queries are answered by the hint alone.
+   */
+  std::vector<QPointF> intersectAll(const std::vector<QLineF>& lines) const;
+
  private:
+  void buildSegmentIndex();
+
+  bool intersectUsingIndex(const QLineF& line, const QLineF& normal, QPointF& intersection, Hint& hint) const;
+
   bool intersectsSegment(const QLineF& normal, int segment) const;
 
   bool intersectsSpan(const QLineF& normal, const QLineF& span) const;
@@ -55,6 +69,21 @@ class PolylineIntersector {
 
   std::vector<QPointF> m_polyline;
   int m_numSegments;
+
+  /**
+   * A uniform grid of segment indexes over the parameter range of the
+   * polyline's chord (the straight line from its first to its last
+   * point).  A query line is located by the parameter at which it
+   * crosses the chord, dropping a cold lookup from O(log n) to a scan
+   * of the few segments in one cell.  Stored in compressed form:
+   * cell i holds m_cellSegments[m_cellStarts[i] .. m_cellStarts[i+1]).
+   * Empty when the polyline is too short to be worth indexing.
+   */
+  Vec2d m_chordOrigin;
+  Vec2d m_chordDir;  // Unit vector, front to back.
+  double m_chordLength;
+  std::vector<int> m_cellStarts;
+  std::vector<int> m_cellSegments;
 };
 
 
@@ -20,8 +20,10 @@
 #include <QDebug>
 #include <boost/foreach.hpp>
 #include <cmath>
+#include <memory>
 #include "ToLineProjector.h"
 #include "VecNT.h"
+#include "adiff/FixedFunction.h"
 #include "adiff/Function.h"
 #include "adiff/SparseMap.h"
 
@@ -83,6 +85,31 @@ class XSpline::HBlendFunc {
 };
 
 
+/**
+ * Evaluates points on a single spline segment, with the tension
+ * derived parameters and the blending functions set up once rather
+ * than for every point.  \see XSpline::evalBatch()
+ */
+class XSpline::SegmentEvaluator {
+ public:
+  SegmentEvaluator(const std::vector<ControlPoint>& control_points, int segment);
+
+  QPointF evalAt(double t) const;
+
+ private:
+  QPointF m_pts[4];
+  bool m_mergeHead;
+  bool m_mergeTail;
+  TensionDerivedParams m_tdp;
+  GBlendFunc m_g0;
+  GBlendFunc m_g1;
+  GBlendFunc m_g2;
+  GBlendFunc m_g3;
+  HBlendFunc m_h0;
+  HBlendFunc m_h3;
+};
+
+
 struct XSpline::DecomposedDerivs {
   double zeroDerivCoeffs[4];
   double firstDerivCoeffs[4];
@@ -176,7 +203,104 @@ QPointF XSpline::pointAtImpl(int segment, double t) const {
   return pt;
 }
 
-void XSpline::sample(const VirtualFunction<void, const QPointF&, double, SampleFlags>& sink,
+XSpline::SegmentEvaluator::SegmentEvaluator(const std::vector<ControlPoint>& control_points, int segment)
+    : m_tdp(control_points[segment].tension, control_points[segment + 1].tension),
+      m_g0(m_tdp.q[0], m_tdp.p[0]),
+      m_g1(m_tdp.q[1], m_tdp.p[1]),
+      m_g2(m_tdp.q[2], m_tdp.p[2]),
+      m_g3(m_tdp.q[3], m_tdp.p[3]),
+      m_h0(m_tdp.q[0]),
+      m_h3(m_tdp.q[3]) {
+  int idxs[4];
+  idxs[0] = std::max<int>(0, segment - 1);
+  idxs[1] = segment;
+  idxs[2] = segment + 1;
+  idxs[3] = std::min<int>(segment + 2, static_cast<int>(control_points.size() - 1));
+
+  for (int i = 0; i < 4; ++i) {
+    m_pts[i] = control_points[idxs[i]].pos;
+  }
+
+  m_mergeHead = (idxs[0] == idxs[1]);
+  m_mergeTail = (idxs[2] == idxs[3]);
+}
+
+QPointF XSpline::SegmentEvaluator::evalAt(double t) const {
+  // The calculations mirror XSpline::linearCombinationFor(),
+  // with the blending functions already set up.
+  Vec4d A;
+
+  if (t <= m_tdp.T0p) {
+    A[0] = m_g0.value((t - m_tdp.T0p) / (m_tdp.t0 - m_tdp.T0p));
+  } else {
+    A[0] = m_h0.value((t - m_tdp.T0p) / (m_tdp.t0 - m_tdp.T0p));
+  }
+
+  A[1] = m_g1.value((t - m_tdp.T1p) / (m_tdp.t1 - m_tdp.T1p));
+  A[2] = m_g2.value((t - m_tdp.T2m) / (m_tdp.t2 - m_tdp.T2m));
+
+  if (t >= m_tdp.T3m) {
+    A[3] = m_g3.value((t - m_tdp.T3m) / (m_tdp.t3 - m_tdp.T3m));
+  } else {
+    A[3] = m_h3.value((t - m_tdp.T3m) / (m_tdp.t3 - m_tdp.T3m));
+  }
+
+  A /= A.sum();
+
+  QPointF pt(0, 0);
+  if (m_mergeHead) {
+    pt += m_pts[0] * (A[0] + A[1]);
+  } else {
+    pt += m_pts[0] * A[0];
+    pt += m_pts[1] * A[1];
+  }
+  if (m_mergeTail) {
+    pt += m_pts[2] * (A[2] + A[3]);
+  } else {
+    pt += m_pts[2] * A[2];
+    pt += m_pts[3] * A[3];
+  }
+
+  return pt;
+}
+
+void XSpline::evalBatch(double from_t, double to_t, int num_points, QPointF* out) const {
+  const int num_segments = numSegments();
+  assert(num_segments > 0);
+  assert(from_t >= 0 && from_t <= 1);
+  assert(to_t >= 0 && to_t <= 1);
+  assert(num_points > 0);
+
+  const double step = num_points > 1 ? (to_t - from_t) / (num_points - 1) : 0.0;
+
+  int cur_segment = -1;
+  std::unique_ptr<SegmentEvaluator> evaluator;
+  for (int i = 0; i < num_points; ++i) {
+    const double t = from_t + step * i;
+
+    int segment;
+    double seg_t;
+    if (t >= 1.0) {
+      // If we went with the branch below, we would end up with
+      // segment == num_segments, which is an error.
+      segment = num_segments - 1;
+      seg_t = 1.0;
+    } else {
+      const double t2 = t * num_segments;
+      const double fsegment = std::floor(t2);
+      segment = static_cast<int>(fsegment);
+      seg_t = t2 - fsegment;
+    }
+
+    if (segment != cur_segment) {
+      evaluator = std::make_unique<SegmentEvaluator>(m_controlPoints, segment);
+      cur_segment = segment;
+    }
+    out[i] = evaluator->evalAt(seg_t);
+  }
+}  // XSpline::evalBatch
+
+void XSpline::sample(function_ref<void(const QPointF&, double, SampleFlags)> sink,
                      const SamplingParams& params,
                      double from_t,
                      double to_t) const {
@@ -210,7 +334,7 @@ void XSpline::sample(const VirtualFunction<void, const QPointF&, double, SampleF
   sink(to_pt, to_t, TAIL_SAMPLE);
 }  // XSpline::sample
 
-void XSpline::maybeAddMoreSamples(const VirtualFunction<void, const QPointF&, double, SampleFlags>& sink,
+void XSpline::maybeAddMoreSamples(function_ref<void(const QPointF&, double, SampleFlags)> sink,
                                   double max_sqdist_to_spline,
                                   double max_sqdist_between_samples,
                                   double num_segments,
@@ -538,32 +662,35 @@ QuadraticFunction XSpline::controlPointsAttractionForce(int seg_begin, int seg_e
 
   const int num_control_points = numControlPoints();
 
-  SparseMap<2> sparse_map(num_control_points * 2);
-  sparse_map.markAllNonZero();
-
-  Function<2> force(sparse_map);
-  if (seg_begin != seg_end) {
-    Function<2> prev_x(seg_begin * 2, m_controlPoints[seg_begin].pos.x(), sparse_map);
-    Function<2> prev_y(seg_begin * 2 + 1, m_controlPoints[seg_begin].pos.y(), sparse_map);
-
-    for (int i = seg_begin + 1; i <= seg_end; ++i) {
-      Function<2> next_x(i * 2, m_controlPoints[i].pos.x(), sparse_map);
-      Function<2> next_y(i * 2 + 1, m_controlPoints[i].pos.y(), sparse_map);
-
-      const Function<2> dx(next_x - prev_x);
-      const Function<2> dy(next_y - prev_y);
-      force += dx * dx + dy * dy;
+  // Each term of the force involves just two control points, so it's
+  // differentiated over its own 4 variables (2 points x 2 coordinates)
+  // with a compile-time-dense FixedFunction, and its contributions are
+  // accumulated straight into the quadratic form.  Dragging every
+  // temporary over the full 2N-variable sparse layout, the way it was
+  // done before, made each term cost O(N^2).
+  QuadraticFunction f(num_control_points * 2);
 
-      next_x.swap(prev_x);
-      next_y.swap(prev_y);
+  for (int i = seg_begin + 1; i <= seg_end; ++i) {
+    const int prev = i - 1;
+    const FixedFunction<4> prev_x(0, m_controlPoints[prev].pos.x());
+    const FixedFunction<4> prev_y(1, m_controlPoints[prev].pos.y());
+    const FixedFunction<4> next_x(2, m_controlPoints[i].pos.x());
+    const FixedFunction<4> next_y(3, m_controlPoints[i].pos.y());
+
+    const FixedFunction<4> dx(next_x - prev_x);
+    const FixedFunction<4> dy(next_y - prev_y);
+    const FixedFunction<4> force(dx * dx + dy * dy);
+
+    const size_t var_idxs[4] = {size_t(prev * 2), size_t(prev * 2 + 1), size_t(i * 2), size_t(i * 2 + 1)};
+    for (size_t li = 0; li < 4; ++li) {
+      f.b[var_idxs[li]] += force.gradient(li);
+      for (size_t lj = 0; lj < 4; ++lj) {
+        f.A(var_idxs[li], var_idxs[lj]) += 0.5 * force.hessian(li, lj);
+      }
     }
+    f.c += force.value;
   }
 
-  QuadraticFunction f(num_control_points * 2);
-  f.A = 0.5 * force.hessian(sparse_map);
-  f.b = force.gradient(sparse_map);
-  f.c = force.value;
-
   return f;
 }  // XSpline::controlPointsAttractionForce
 
@@ -643,30 +770,32 @@ QPointF XSpline::pointClosestTo(const QPointF to, double* t, double accuracy) co
     return m_controlPoints.front().pos;
   }
 
-  QPointF prev_pt(pointAtImpl(0, 0));
-  QPointF next_pt;
+  // Evaluate all the junction points in one go - this routine runs
+  // on every mouse move while hovering over a spline.
+  std::vector<QPointF> junctions(num_segments + 1);
+  evalBatch(0.0, 1.0, num_segments + 1, &junctions[0]);
+
   // Find the closest segment.
   int best_segment = 0;
-  double best_sqdist = Vec2d(to - prev_pt).squaredNorm();
-  for (int seg = 0; seg < num_segments; ++seg, prev_pt = next_pt) {
-    next_pt = pointAtImpl(seg, 1.0);
-
-    const double sqdist = sqDistToLine(to, QLineF(prev_pt, next_pt));
+  double best_sqdist = Vec2d(to - junctions.front()).squaredNorm();
+  for (int seg = 0; seg < num_segments; ++seg) {
+    const double sqdist = sqDistToLine(to, QLineF(junctions[seg], junctions[seg + 1]));
     if (sqdist < best_sqdist) {
       best_segment = seg;
       best_sqdist = sqdist;
     }
   }
   // Continue with a binary search.
+  const SegmentEvaluator evaluator(m_controlPoints, best_segment);
   const double sq_accuracy = accuracy * accuracy;
   double prev_t = 0;
   double next_t = 1;
-  prev_pt = pointAtImpl(best_segment, prev_t);
-  next_pt = pointAtImpl(best_segment, next_t);
+  QPointF prev_pt(evaluator.evalAt(prev_t));
+  QPointF next_pt(evaluator.evalAt(next_t));
 
   while (Vec2d(prev_pt - next_pt).squaredNorm() > sq_accuracy) {
     const double mid_t = 0.5 * (prev_t + next_t);
-    const QPointF mid_pt(pointAtImpl(best_segment, mid_t));
+    const QPointF mid_pt(evaluator.evalAt(mid_t));
 
     const ToLineProjector projector(QLineF(prev_pt, next_pt));
     const double pt = projector.projectionScalar(to);
@@ -704,7 +833,7 @@ std::vector<QPointF> XSpline::toPolyline(const SamplingParams& params, double fr
   std::vector<QPointF> polyline;
 
   auto sink = [&polyline](const QPointF& pt, double, SampleFlags) { polyline.push_back(pt); };
-  sample(ProxyFunction<decltype(sink), void, const QPointF&, double, SampleFlags>(sink), params, from_t, to_t);
+  sample(sink, params, from_t, to_t);
 
   return polyline;
 }
@@ -24,7 +24,7 @@
 #include <vector>
 #include "NumericTraits.h"
 #include "QuadraticFunction.h"
-#include "VirtualFunction.h"
+#include "function_ref.h"
 #include "spfit/FittableSpline.h"
 
 /**
@@ -107,6 +107,17 @@ class XSpline : public spfit::FittableSpline {
    */
   QPointF pointAt(double t) const;
 
+  /**
+   * \brief Evaluates the spline at \p num_points positions uniformly
+   *        spaced over [from_t, to_t], writing them to \p out.
+   *
+   * Equivalent to calling pointAt() at every position, except the
+   * blending functions are set up once per segment rather than once
+   * per point, which matters when evaluating hundreds of points
+   * per redraw.
+   */
+  void evalBatch(double from_t, double to_t, int num_points, QPointF* out) const;
+
   /**
    * \brief Calculates a point on the spline plus the first and the second derivatives at position t.
    */
@@ -162,7 +173,7 @@ class XSpline : public spfit::FittableSpline {
   QPointF pointClosestTo(QPointF to, double accuracy = 0.2) const;
 
   /** \see spfit::FittableSpline::sample() */
-  void sample(const VirtualFunction<void, const QPointF&, double, SampleFlags>& sink,
+  void sample(function_ref<void(const QPointF&, double, SampleFlags)> sink,
               const SamplingParams& params = SamplingParams(),
               double from_t = 0.0,
               double to_t = 1.0) const override;
@@ -192,6 +203,7 @@ class XSpline : public spfit::FittableSpline {
 
   class GBlendFunc;
   class HBlendFunc;
+  class SegmentEvaluator;
 
   struct DecomposedDerivs;
 
@@ -203,7 +215,7 @@ class XSpline : public spfit::FittableSpline {
 
   DecomposedDerivs decomposedDerivsImpl(int segment, double t) const;
 
-  void maybeAddMoreSamples(const VirtualFunction<void, const QPointF&, double, SampleFlags>& sink,
+  void maybeAddMoreSamples(function_ref<void(const QPointF&, double, SampleFlags)> sink,
                            double max_sqdist_to_spline,
                            double max_sqdist_between_samples,
                            double num_segments,
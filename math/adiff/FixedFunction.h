@@ -0,0 +1,194 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADIFF_FIXED_FUNCTION_H_
+#define ADIFF_FIXED_FUNCTION_H_
+
+#include <cstddef>
+#include "MatMNT.h"
+
+namespace adiff {
+/**
+ * \brief A Function<2> counterpart for a compile-time number of variables.
+ *
+ * Function<2> keeps its derivatives in heap-allocated vectors laid out
+ * by a runtime SparseMap, which means an allocation per temporary and
+ * a map lookup per derivative.  When a term involves a small, fixed
+ * set of variables -- as the per-segment terms of the spline forces do
+ * -- the sparsity pattern is known at compile time, so the derivatives
+ * can live in a dense NxN stack array (MatMNT) with the index
+ * arithmetic folded into constants, and the loops become candidates
+ * for unrolling and vectorization.
+ *
+ * The directional derivative convention matches Function<2>:
+ * element (i, j) holds the derivatives in the direction u = i + j.
+ */
+template <size_t N>
+class FixedFunction {
+  // Member-wise copying is OK.
+ public:
+  /** The value of the function. */
+  double value;
+
+  /**
+   * First directional derivatives in the direction
+   * of u = i + j for every element at (i, j).
+   */
+  MatMNT<N, N, double> firstDerivs;
+
+  /**
+   * Second directional derivatives in the direction
+   * of u = i + j for every element at (i, j).
+   */
+  MatMNT<N, N, double> secondDerivs;
+
+  /**
+   * Constructs the "f(x1, x2, ...) = 0" function.
+   */
+  FixedFunction() : value() {}
+
+  /**
+   * Constructs a function representing an argument.
+   *
+   * \param arg_idx Argument number, in [0, N).
+   * \param val Argument value.
+   */
+  FixedFunction(size_t arg_idx, double val) : value(val) {
+    for (size_t i = 0; i < N; ++i) {
+      firstDerivs(arg_idx, i) = 1.0;
+      firstDerivs(i, arg_idx) = 1.0;
+    }
+  }
+
+  /**
+   * The derivative with respect to variable \p i.
+   */
+  double gradient(size_t i) const { return firstDerivs(i, i); }
+
+  /**
+   * The Hessian element at (i, j), recovered from the directional
+   * derivatives the same way Function<2>::hessian() does it.
+   */
+  double hessian(size_t i, size_t j) const {
+    if (i == j) {
+      return secondDerivs(i, i);
+    }
+
+    return 0.5 * (secondDerivs(i, j) - (secondDerivs(i, i) + secondDerivs(j, j)));
+  }
+
+  FixedFunction& operator+=(const FixedFunction& other) {
+    value += other.value;
+    for (size_t u = 0; u < N * N; ++u) {
+      firstDerivs.data()[u] += other.firstDerivs.data()[u];
+      secondDerivs.data()[u] += other.secondDerivs.data()[u];
+    }
+
+    return *this;
+  }
+
+  FixedFunction& operator-=(const FixedFunction& other) {
+    value -= other.value;
+    for (size_t u = 0; u < N * N; ++u) {
+      firstDerivs.data()[u] -= other.firstDerivs.data()[u];
+      secondDerivs.data()[u] -= other.secondDerivs.data()[u];
+    }
+
+    return *this;
+  }
+
+  FixedFunction& operator*=(double scalar) {
+    value *= scalar;
+    for (size_t u = 0; u < N * N; ++u) {
+      firstDerivs.data()[u] *= scalar;
+    }
+
+    return *this;
+  }
+};
+
+
+template <size_t N>
+FixedFunction<N> operator+(const FixedFunction<N>& f1, const FixedFunction<N>& f2) {
+  FixedFunction<N> res(f1);
+  res += f2;
+
+  return res;
+}
+
+template <size_t N>
+FixedFunction<N> operator-(const FixedFunction<N>& f1, const FixedFunction<N>& f2) {
+  FixedFunction<N> res(f1);
+  res -= f2;
+
+  return res;
+}
+
+template <size_t N>
+FixedFunction<N> operator*(const FixedFunction<N>& f1, const FixedFunction<N>& f2) {
+  FixedFunction<N> res;
+  res.value = f1.value * f2.value;
+
+  for (size_t u = 0; u < N * N; ++u) {
+    const double a1 = f1.firstDerivs.data()[u];
+    const double a2 = f2.firstDerivs.data()[u];
+    res.firstDerivs.data()[u] = a1 * f2.value + f1.value * a2;
+    res.secondDerivs.data()[u]
+        = f1.secondDerivs.data()[u] * f2.value + 2.0 * a1 * a2 + f1.value * f2.secondDerivs.data()[u];
+  }
+
+  return res;
+}
+
+template <size_t N>
+FixedFunction<N> operator*(const FixedFunction<N>& f, double scalar) {
+  FixedFunction<N> res(f);
+  res *= scalar;
+
+  return res;
+}
+
+template <size_t N>
+FixedFunction<N> operator*(double scalar, const FixedFunction<N>& f) {
+  FixedFunction<N> res(f);
+  res *= scalar;
+
+  return res;
+}
+
+template <size_t N>
+FixedFunction<N> operator/(const FixedFunction<N>& num, const FixedFunction<N>& den) {
+  FixedFunction<N> res;
+  res.value = num.value / den.value;
+
+  const double den2 = den.value * den.value;
+  const double den4 = den2 * den2;
+
+  for (size_t u = 0; u < N * N; ++u) {
+    const double d1 = num.firstDerivs.data()[u] * den.value - num.value * den.firstDerivs.data()[u];
+    res.firstDerivs.data()[u] = d1 / den2;
+
+    const double d2 = num.secondDerivs.data()[u] * den.value - num.value * den.secondDerivs.data()[u];
+    const double d3 = 2.0 * den.value * den.firstDerivs.data()[u];
+    res.secondDerivs.data()[u] = (d2 * den2 - d1 * d3) / den4;
+  }
+
+  return res;
+}
+}  // namespace adiff
+#endif  // ifndef ADIFF_FIXED_FUNCTION_H_
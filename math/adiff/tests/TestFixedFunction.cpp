@@ -0,0 +1,86 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/test/auto_unit_test.hpp>
+#include <cstdlib>
+#include "FixedFunction.h"
+#include "Function.h"
+
+namespace adiff {
+namespace tests {
+BOOST_AUTO_TEST_SUITE(FixedFunctionTestSuite);
+
+/**
+ * Evaluates the same expression through the runtime Function<2> with a
+ * dense SparseMap and through the compile-time FixedFunction, and
+ * checks that the value, gradient and Hessian agree.
+ */
+BOOST_AUTO_TEST_CASE(test_matches_runtime_function) {
+  srand(42);
+  for (int iter = 0; iter < 100; ++iter) {
+    const double x_val = (rand() % 1000 - 500) / 50.0;
+    const double y_val = (rand() % 1000 - 500) / 50.0;
+    const double scalar = (rand() % 100 + 1) / 10.0;
+
+    // F = (x - y)^2 * scalar + x * y
+    SparseMap<2> sparse_map(2);
+    sparse_map.markAllNonZero();
+
+    const Function<2> x(0, x_val, sparse_map);
+    const Function<2> y(1, y_val, sparse_map);
+    const Function<2> d(x - y);
+    const Function<2> ref(d * d * scalar + x * y);
+
+    const FixedFunction<2> fx(0, x_val);
+    const FixedFunction<2> fy(1, y_val);
+    const FixedFunction<2> fd(fx - fy);
+    const FixedFunction<2> res(fd * fd * scalar + fx * fy);
+
+    BOOST_REQUIRE_CLOSE(res.value, ref.value, 1e-9);
+
+    const VecT<double> grad(ref.gradient(sparse_map));
+    const MatT<double> hess(ref.hessian(sparse_map));
+    for (size_t i = 0; i < 2; ++i) {
+      BOOST_REQUIRE_CLOSE(res.gradient(i), grad[i], 1e-9);
+      for (size_t j = 0; j < 2; ++j) {
+        BOOST_REQUIRE_CLOSE(res.hessian(i, j), hess(i, j), 1e-9);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_division) {
+  // F = x / y  | x = 6, y = 2
+  const FixedFunction<2> x(0, 6.0);
+  const FixedFunction<2> y(1, 2.0);
+  const FixedFunction<2> res(x / y);
+
+  BOOST_REQUIRE_CLOSE(res.value, 3.0, 1e-9);
+  // dF/dx = 1/y, dF/dy = -x/y^2
+  BOOST_REQUIRE_CLOSE(res.gradient(0), 0.5, 1e-9);
+  BOOST_REQUIRE_CLOSE(res.gradient(1), -1.5, 1e-9);
+  // d2F/dx2 = 0, d2F/dxdy = -1/y^2, d2F/dy2 = 2x/y^3
+  BOOST_REQUIRE_CLOSE(res.hessian(0, 0), 0.0, 1e-9);
+  BOOST_REQUIRE_CLOSE(res.hessian(0, 1), -0.25, 1e-9);
+  BOOST_REQUIRE_CLOSE(res.hessian(1, 0), -0.25, 1e-9);
+  BOOST_REQUIRE_CLOSE(res.hessian(1, 1), 1.5, 1e-9);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+}  // namespace tests
+}  // namespace adiff
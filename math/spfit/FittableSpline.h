@@ -23,7 +23,7 @@
 #include <vector>
 #include "FlagOps.h"
 #include "NumericTraits.h"
-#include "VirtualFunction.h"
+#include "function_ref.h"
 
 namespace spfit {
 /**
@@ -104,7 +104,7 @@ class FittableSpline {
    *       corresponding to them will be marked with HEAD_SAMPLE
    *       and TAIL_SAMPLE respectably.
    */
-  virtual void sample(const VirtualFunction<void, const QPointF&, double, SampleFlags>& sink,
+  virtual void sample(function_ref<void(const QPointF&, double, SampleFlags)> sink,
                       const SamplingParams& params,
                       double from_t = 0.0,
                       double to_t = 1.0) const = 0;
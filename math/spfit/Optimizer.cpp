@@ -18,6 +18,8 @@
 
 #include "Optimizer.h"
 #include <boost/foreach.hpp>
+#include <algorithm>
+#include "BandedLinearSolver.h"
 #include "MatrixCalc.h"
 
 namespace spfit {
@@ -27,7 +29,12 @@ Optimizer::Optimizer(size_t num_vars)
       m_b(num_vars),
       m_x(num_vars),
       m_externalForce(num_vars),
-      m_internalForce(num_vars) {}
+      m_internalForce(num_vars),
+      m_varMap(num_vars) {
+  for (size_t i = 0; i < num_vars; ++i) {
+    m_varMap[i] = i;
+  }
+}
 
 void Optimizer::setConstraints(const std::list<LinearFunction>& constraints) {
   const size_t num_constraints = constraints.size();
@@ -56,9 +63,39 @@ void Optimizer::setConstraints(const std::list<LinearFunction>& constraints) {
     }
   }
 
+  // With constraint rows simply appended after the variables,
+  // a constraint on the first control point would destroy the
+  // bandedness of the system.  Instead, we remember an ordering
+  // that places each constraint row right after the last variable
+  // it involves.  \see trySolveBanded()
+  std::vector<size_t> var_map(num_dimensions);
+  if (m_numVars > 0) {
+    std::vector<std::vector<size_t>> row_after_var(m_numVars);
+
+    size_t row = m_numVars;
+    for (ctr = constraints.begin(); ctr != constraints.end(); ++ctr, ++row) {
+      size_t last_var = 0;
+      for (size_t j = 0; j < m_numVars; ++j) {
+        if (ctr->a[j] != 0) {
+          last_var = j;
+        }
+      }
+      row_after_var[last_var].push_back(row);
+    }
+
+    size_t pos = 0;
+    for (size_t var = 0; var < m_numVars; ++var) {
+      var_map[var] = pos++;
+      for (const size_t ctr_row : row_after_var[var]) {
+        var_map[ctr_row] = pos++;
+      }
+    }
+  }
+
   VecT<double>(num_dimensions).swap(m_x);
   m_A.swap(A);
   m_b.swap(b);
+  m_varMap.swap(var_map);
 }  // Optimizer::setConstraints
 
 void Optimizer::addExternalForce(const QuadraticFunction& force) {
@@ -102,25 +139,32 @@ OptimizationResult Optimizer::optimize(double internal_force_weight) {
   m_internalForce += m_externalForce;
 
   // For the layout of m_A and m_b, see setConstraints()
-  const QuadraticFunction::Gradient grad(m_internalForce.gradient());
+  // We write the gradient (A + A^T, b) straight into m_A and m_b
+  // rather than materializing it as a temporary.
   for (size_t i = 0; i < m_numVars; ++i) {
-    m_b[i] = -grad.b[i];
+    m_b[i] = -m_internalForce.b[i];
     for (size_t j = 0; j < m_numVars; ++j) {
-      m_A(i, j) = grad.A(i, j);
+      m_A(i, j) = m_internalForce.A(i, j) + m_internalForce.A(j, i);
     }
   }
 
   const double total_force_before = m_internalForce.c;
-  DynamicMatrixCalc<double> mc;
 
-  try {
-    mc(m_A).solve(mc(m_b)).write(m_x.data());
-  } catch (const std::runtime_error&) {
-    m_externalForce.reset();
-    m_internalForce.reset();
-    m_x.fill(0);  // To make undoLastStep() work as expected.
+  // Spline samples only involve a few neighbouring control points,
+  // so the system is normally banded and a banded solve is much
+  // cheaper than a dense one.
+  if (!trySolveBanded()) {
+    DynamicMatrixCalc<double> mc;
+
+    try {
+      mc(m_A).solve(mc(m_b)).write(m_x.data());
+    } catch (const std::runtime_error&) {
+      m_externalForce.reset();
+      m_internalForce.reset();
+      m_x.fill(0);  // To make undoLastStep() work as expected.
 
-    return OptimizationResult(total_force_before, total_force_before);
+      return OptimizationResult(total_force_before, total_force_before);
+    }
   }
 
   const double total_force_after = m_internalForce.evaluate(m_x.data());
@@ -133,6 +177,71 @@ OptimizationResult Optimizer::optimize(double internal_force_weight) {
   return OptimizationResult(total_force_before, total_force_after);
 }  // Optimizer::optimize
 
+/**
+ * Attempts to solve the system assembled by optimize() with
+ * BandedLinearSolver, reordering rows and columns of m_A according
+ * to m_varMap.  Returns false if the reordered system isn't banded
+ * enough to beat a dense LU, or if the banded solve fails.
+ */
+bool Optimizer::trySolveBanded() {
+  const size_t num_dimensions = m_b.size();
+  if ((num_dimensions == 0) || (m_varMap.size() != num_dimensions)) {
+    return false;
+  }
+
+  size_t bandwidth = 0;
+  for (size_t i = 0; i < num_dimensions; ++i) {
+    for (size_t j = i + 1; j < num_dimensions; ++j) {
+      if ((m_A(i, j) != 0) || (m_A(j, i) != 0)) {
+        const size_t pi = m_varMap[i];
+        const size_t pj = m_varMap[j];
+        bandwidth = std::max(bandwidth, pi > pj ? pi - pj : pj - pi);
+      }
+    }
+  }
+
+  // A banded solve costs O(n * bandwidth^2), so for nearly full
+  // bands the dense path wins.
+  if (bandwidth * 3 >= num_dimensions) {
+    return false;
+  }
+
+  const size_t ldab = 3 * bandwidth + 1;
+  const size_t diag = 2 * bandwidth;
+
+  // Maps band-friendly positions back to rows of m_A.
+  std::vector<size_t> inv_map(num_dimensions);
+  for (size_t i = 0; i < num_dimensions; ++i) {
+    inv_map[m_varMap[i]] = i;
+  }
+
+  std::vector<double> ab(ldab * num_dimensions, 0.0);
+  VecT<double> pb(num_dimensions);
+  VecT<double> px(num_dimensions);
+  for (size_t col = 0; col < num_dimensions; ++col) {
+    const size_t j = inv_map[col];
+    const size_t row_begin = col > bandwidth ? col - bandwidth : 0;
+    const size_t row_end = std::min(col + bandwidth, num_dimensions - 1);
+    for (size_t row = row_begin; row <= row_end; ++row) {
+      ab[col * ldab + diag + row - col] = m_A(inv_map[row], j);
+    }
+    pb[col] = m_b[j];
+  }
+
+  try {
+    const BandedLinearSolver solver(num_dimensions, bandwidth, bandwidth);
+    solver.solve(ab.data(), px.data(), pb.data());
+  } catch (const std::runtime_error&) {
+    return false;
+  }
+
+  for (size_t i = 0; i < num_dimensions; ++i) {
+    m_x[i] = px[m_varMap[i]];
+  }
+
+  return true;
+}  // Optimizer::trySolveBanded
+
 void Optimizer::undoLastStep() {
   adjustConstraints(-1.0);
   m_x.fill(0);
@@ -161,6 +270,7 @@ void Optimizer::swap(Optimizer& other) {
   m_x.swap(other.m_x);
   m_externalForce.swap(other.m_externalForce);
   m_internalForce.swap(other.m_internalForce);
+  m_varMap.swap(other.m_varMap);
   std::swap(m_numVars, other.m_numVars);
 }
 }  // namespace spfit
\ No newline at end of file
@@ -29,7 +29,6 @@
 #include "SqDistApproximant.h"
 #include "VecNT.h"
 #include "VecT.h"
-#include "VirtualFunction.h"
 
 namespace spfit {
 class Optimizer {
@@ -84,12 +83,22 @@ class Optimizer {
  private:
   void adjustConstraints(double direction);
 
+  bool trySolveBanded();
+
   size_t m_numVars;
   MatT<double> m_A;
   VecT<double> m_b;
   VecT<double> m_x;
   QuadraticFunction m_externalForce;
   QuadraticFunction m_internalForce;
+
+  /**
+   * Maps rows (and columns) of m_A to positions that interleave
+   * constraint rows with the variables they involve.  Under this
+   * ordering the system stays banded, which lets optimize() use
+   * BandedLinearSolver instead of a dense LU.  \see trySolveBanded()
+   */
+  std::vector<size_t> m_varMap;
 };
 
 
@@ -43,7 +43,15 @@ void SplineFitter::addAttractionForce(const Vec2d& spline_point,
                                       const SqDistApproximant& sqdist_approx) {
   const auto num_coeffs = static_cast<const int>(coeffs.size());
   const int num_vars = num_coeffs * 2;
-  QuadraticFunction f(num_vars);
+
+  // This function runs for every spline sample on every iteration,
+  // so reuse the scratch function rather than allocating a new one.
+  if (m_tempFunction.numVars() != size_t(num_vars)) {
+    QuadraticFunction(num_vars).swap(m_tempFunction);
+  } else {
+    m_tempFunction.reset();
+  }
+  QuadraticFunction& f = m_tempFunction;
 
   // Right now we basically have F(x) = Q(L(x)),
   // where Q is a quadratic function represented by sqdist_approx,
@@ -116,8 +124,7 @@ void SplineFitter::addAttractionForces(const ModelShape& model_shape, double fro
     addAttractionForce(pt, m_tempCoeffs, approx);
   };
 
-  m_spline->sample(ProxyFunction<decltype(sample_processor), void, const QPointF&, double, FittableSpline::SampleFlags>(
-                       sample_processor),
+  m_spline->sample(sample_processor,
                    m_samplingParams, from_t, to_t);
 }
 
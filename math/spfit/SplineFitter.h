@@ -80,6 +80,7 @@ class SplineFitter {
   FittableSpline::SamplingParams m_samplingParams;
   std::vector<double> m_tempVars;
   std::vector<int> m_tempSparseMap;
+  QuadraticFunction m_tempFunction;
   std::vector<FittableSpline::LinearCoefficient> m_tempCoeffs;
 };
 }  // namespace spfit
@@ -94,6 +94,28 @@ BOOST_AUTO_TEST_CASE(test4) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(test5) {
+  // A symmetric positive definite matrix.
+  static const double A[] = {4, 2, 2, 2, 6, 3, 2, 3, 9};
+
+  static const double B[] = {14, 23, 35};
+
+  static const double control[] = {1, 2, 3};
+
+  double x[3];
+
+  MatrixCalc<double> mc;
+  mc(A, 3, 3).solvePosDef(mc(B, 3, 1)).write(x);
+
+  for (int i = 0; i < 3; ++i) {
+    BOOST_REQUIRE_CLOSE(x[i], control[i], 1e-6);
+  }
+
+  // An indefinite matrix has to be rejected.
+  static const double indefinite[] = {1, 2, 2, 2, 1, 2, 2, 2, 1};
+  BOOST_CHECK_THROW(mc(indefinite, 3, 3).solvePosDef(mc(B, 3, 1)), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 }  // namespace tests
 }  // namespace imageproc
\ No newline at end of file
@@ -28,7 +28,7 @@ BasicSplineVisualizer::BasicSplineVisualizer()
 
 void BasicSplineVisualizer::drawSplines(QPainter& painter, const QTransform& to_screen, const EditableZoneSet& zones) {
   for (const EditableZoneSet::Zone& zone : zones) {
-    drawSpline(painter, to_screen, zone.spline());
+    drawSpline(painter, to_screen, zones, zone.spline());
   }
 }
 
@@ -39,6 +39,26 @@ void BasicSplineVisualizer::drawSpline(QPainter& painter,
   painter.drawPolygon(to_screen.map(spline->toPolygon()), Qt::WindingFill);
 }
 
+void BasicSplineVisualizer::drawSpline(QPainter& painter,
+                                       const QTransform& to_screen,
+                                       const EditableZoneSet& zones,
+                                       const EditableSpline::Ptr& spline) {
+  const QPainterPath* const path = zones.spatialIndex().outlinePath(spline);
+  if (!path) {
+    drawSpline(painter, to_screen, spline);
+
+    return;
+  }
+
+  prepareForSpline(painter, spline);
+  painter.save();
+  painter.setWorldTransform(to_screen);
+  painter.setWorldMatrixEnabled(true);
+  // The pen is cosmetic, so its width stays in device pixels.
+  painter.drawPath(*path);
+  painter.restore();
+}
+
 void BasicSplineVisualizer::drawVertex(QPainter& painter, const QPointF& pt, const QColor& color) {
   painter.setPen(Qt::NoPen);
   painter.setBrush(color);
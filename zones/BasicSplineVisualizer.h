@@ -43,6 +43,17 @@ class BasicSplineVisualizer {
 
   virtual void drawSpline(QPainter& painter, const QTransform& to_screen, const EditableSpline::Ptr& spline);
 
+  /**
+   * Like drawSpline() above, but strokes the outline cached in the
+   * zone set's spatial index instead of constructing a fresh path,
+   * making repaints of pages with many zones cheap.  Falls back to
+   * the uncached version for splines not in the zone set.
+   */
+  void drawSpline(QPainter& painter,
+                  const QTransform& to_screen,
+                  const EditableZoneSet& zones,
+                  const EditableSpline::Ptr& spline);
+
   virtual void prepareForSpline(QPainter& painter, const EditableSpline::Ptr& spline);
 
  protected:
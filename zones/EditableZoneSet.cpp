@@ -19,7 +19,8 @@
 
 #include "EditableZoneSet.h"
 
-EditableZoneSet::EditableZoneSet() : m_zoneItems(), m_zoneItemsInOrder(m_zoneItems.get<ZoneItemOrderedTag>()) {}
+EditableZoneSet::EditableZoneSet()
+    : m_zoneItems(), m_zoneItemsInOrder(m_zoneItems.get<ZoneItemOrderedTag>()), m_spatialIndex(*this) {}
 
 void EditableZoneSet::setDefaultProperties(const PropertySet& props) {
   m_defaultProps = props;
@@ -28,18 +29,23 @@ void EditableZoneSet::setDefaultProperties(const PropertySet& props) {
 void EditableZoneSet::addZone(const EditableSpline::Ptr& spline) {
   auto new_props = make_intrusive<PropertySet>(m_defaultProps);
   m_zoneItems.insert(ZoneItem(spline, new_props));
+  m_spatialIndex.invalidate();
 }
 
 void EditableZoneSet::addZone(const EditableSpline::Ptr& spline, const PropertySet& props) {
   auto new_props = make_intrusive<PropertySet>(props);
   m_zoneItems.insert(ZoneItem(spline, new_props));
+  m_spatialIndex.invalidate();
 }
 
 void EditableZoneSet::removeZone(const EditableSpline::Ptr& spline) {
   m_zoneItems.erase(spline);
+  m_spatialIndex.invalidate();
 }
 
 void EditableZoneSet::commit() {
+  // Spline geometry may have been modified in place.
+  m_spatialIndex.invalidate();
   emit committed();
 }
 
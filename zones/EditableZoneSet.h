@@ -30,6 +30,7 @@
 #include <boost/multi_index_container.hpp>
 #include "EditableSpline.h"
 #include "PropertySet.h"
+#include "ZoneSpatialIndex.h"
 #include "intrusive_ptr.h"
 
 class EditableZoneSet : public QObject {
@@ -112,6 +113,12 @@ class EditableZoneSet : public QObject {
 
   intrusive_ptr<const PropertySet> propertiesFor(const EditableSpline::Ptr& spline) const;
 
+  /**
+   * A spatial index over the zones, for accelerated hit-testing.
+   * It's kept up to date with modifications of this zone set.
+   */
+  const ZoneSpatialIndex& spatialIndex() const { return m_spatialIndex; }
+
  signals:
 
   void committed();
@@ -120,6 +127,7 @@ class EditableZoneSet : public QObject {
   ZoneItems m_zoneItems;
   ZoneItemsInOrder& m_zoneItemsInOrder;
   PropertySet m_defaultProps;
+  ZoneSpatialIndex m_spatialIndex;
 };
 
 #endif  // ifndef EDITABLE_ZONE_SET_H_
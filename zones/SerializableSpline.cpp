@@ -17,10 +17,11 @@
  */
 
 #include "SerializableSpline.h"
+#include <QStringList>
 #include <QTransform>
 #include <boost/foreach.hpp>
 #include "EditableSpline.h"
-#include "XmlMarshaller.h"
+#include "Utils.h"
 #include "XmlUnmarshaller.h"
 
 SerializableSpline::SerializableSpline(const EditableSpline& spline) {
@@ -31,6 +32,18 @@ SerializableSpline::SerializableSpline(const EditableSpline& spline) {
 }
 
 SerializableSpline::SerializableSpline(const QDomElement& el) {
+  if (el.hasAttribute("points")) {
+    // The packed representation: "x1 y1 x2 y2 ...".
+    const QStringList tokens(el.attribute("points").split(QChar(' '), QString::SkipEmptyParts));
+    m_points.reserve(tokens.size() / 2);
+    for (int i = 0; i + 1 < tokens.size(); i += 2) {
+      m_points.push_back(QPointF(tokens[i].toDouble(), tokens[i + 1].toDouble()));
+    }
+
+    return;
+  }
+
+  // Projects written by older versions: one <point> element per vertex.
   const QString point_str("point");
 
   QDomNode node(el.firstChild());
@@ -55,11 +68,21 @@ SerializableSpline::SerializableSpline(const QPolygonF& polygon) {
 QDomElement SerializableSpline::toXml(QDomDocument& doc, const QString& name) const {
   QDomElement el(doc.createElement(name));
 
-  const QString point_str("point");
-  XmlMarshaller marshaller(doc);
+  // One flat attribute instead of one child element per vertex.  In
+  // zone-heavy projects the <point> nodes used to dominate the DOM,
+  // and building, saving and re-parsing the tree - for the XML and
+  // the binary sidecar alike - paid for every one of them.
+  QString points;
+  points.reserve(m_points.size() * 16);
   for (const QPointF& pt : m_points) {
-    el.appendChild(marshaller.pointF(pt, point_str));
+    if (!points.isEmpty()) {
+      points += QChar(' ');
+    }
+    points += Utils::doubleToString(pt.x());
+    points += QChar(' ');
+    points += Utils::doubleToString(pt.y());
   }
+  el.setAttribute("points", points);
 
   return el;
 }
@@ -60,7 +60,17 @@ void ZoneCreationInteraction::onPaint(QPainter& painter, const InteractionState&
   const QTransform to_screen(m_context.imageView().imageToWidget());
   const QTransform from_screen(m_context.imageView().widgetToImage());
 
-  m_visualizer.drawSplines(painter, to_screen, m_context.zones());
+  const QRect viewport_rect(m_context.imageView().viewport()->rect());
+  if (m_cachedZonesLayer.isNull() || (m_cachedZonesLayerXform != to_screen)
+      || (m_cachedZonesLayer.size() != viewport_rect.size())) {
+    m_cachedZonesLayer = QPixmap(viewport_rect.size());
+    m_cachedZonesLayer.fill(Qt::transparent);
+    QPainter layer_painter(&m_cachedZonesLayer);
+    layer_painter.setRenderHint(QPainter::Antialiasing);
+    m_visualizer.drawSplines(layer_painter, to_screen, m_context.zones());
+    m_cachedZonesLayerXform = to_screen;
+  }
+  painter.drawPixmap(0, 0, m_cachedZonesLayer);
 
   QPen solid_line_pen(m_visualizer.solidColor());
   solid_line_pen.setCosmetic(true);
@@ -21,7 +21,9 @@
 
 #include <QCoreApplication>
 #include <QDateTime>
+#include <QPixmap>
 #include <QPointF>
+#include <QTransform>
 #include "BasicSplineVisualizer.h"
 #include "DragHandler.h"
 #include "DragWatcher.h"
@@ -79,6 +81,15 @@ class ZoneCreationInteraction : public InteractionHandler {
   ZoomHandler m_zoomHandler;
 
   BasicSplineVisualizer m_visualizer;
+
+  /**
+   * The zones that already exist don't change while a new one is being
+   * drawn, so they are rendered once into this layer and re-rendered
+   * only when the image transform or the viewport changes.  Each frame
+   * then just composites the layer and paints the rubber band on top.
+   */
+  QPixmap m_cachedZonesLayer;
+  QTransform m_cachedZonesLayerXform;
   InteractionState::Captor m_interaction;
   EditableSpline::Ptr m_spline;
   QPointF m_nextVertexImagePos;
@@ -19,9 +19,12 @@
 #include "ZoneDefaultInteraction.h"
 #include <QMouseEvent>
 #include <QPainter>
+#include <cmath>
+#include <limits>
 #include "ImageViewBase.h"
 #include "SerializableSpline.h"
 #include "ZoneInteractionContext.h"
+#include "ZoneSpatialIndex.h"
 
 ZoneDefaultInteraction::ZoneDefaultInteraction(ZoneInteractionContext& context)
     : m_context(context), m_dragHandler(context.imageView()), m_dragWatcher(m_dragHandler) {
@@ -68,7 +71,7 @@ void ZoneDefaultInteraction::onPaint(QPainter& painter, const InteractionState&
       } while (vertex != m_nearestSegment.prev);
       painter.drawPolyline(points);
     } else {
-      m_visualizer.drawSpline(painter, to_screen, spline);
+      m_visualizer.drawSpline(painter, to_screen, m_context.zones(), spline);
     }
   }
 
@@ -130,22 +133,31 @@ void ZoneDefaultInteraction::onProximityUpdate(const QPointF& mouse_pos, Interac
 
   bool has_zone_under_mouse = false;
 
-  for (const EditableZoneSet::Zone& zone : m_context.zones()) {
-    const EditableSpline::Ptr& spline = zone.spline();
+  const ZoneSpatialIndex& index = m_context.zones().spatialIndex();
 
-    {
-      QPainterPath path;
-      path.setFillRule(Qt::WindingFill);
-      path.addPolygon(spline->toPolygon());
-      if (path.contains(image_mouse_pos)) {
-        m_underCursorSpline = spline;
-
-        has_zone_under_mouse = true;
-      }
-    }
+  const std::vector<EditableSpline::Ptr>& splines_under_mouse(index.splinesContaining(image_mouse_pos));
+  if (!splines_under_mouse.empty()) {
+    // The last zone in order wins, as it's the one drawn on top.
+    m_underCursorSpline = splines_under_mouse.back();
+    has_zone_under_mouse = true;
+  }
 
-    // Process vertices.
-    for (SplineVertex::Ptr vert(spline->firstVertex()); vert; vert = vert->next(SplineVertex::NO_LOOP)) {
+  // Only proximities within the threshold may become proximity leaders
+  // (see InteractionState::updateProximity()), so limit the search to
+  // the on-screen threshold mapped into image space.  The mapping may
+  // rotate and scale anisotropically, so take a safe upper bound of its
+  // scaling factor.
+  const double scale_bound = std::hypot(std::hypot(from_screen.m11(), from_screen.m12()),
+                                        std::hypot(from_screen.m21(), from_screen.m22()));
+  const double image_radius = interaction.proximityThreshold().dist() * scale_bound;
+
+  for (const ZoneSpatialIndex::SegmentHit& hit : index.segmentsNear(image_mouse_pos, image_radius)) {
+    const EditableSpline::Ptr& spline = hit.spline;
+    const SplineSegment& segment = hit.segment;
+
+    // Process the segment endpoints.  Every vertex is an endpoint of
+    // some segment, so no vertex within the search radius is missed.
+    for (const SplineVertex::Ptr& vert : {segment.prev, segment.next}) {
       const Proximity proximity(mouse_pos, to_screen.map(vert->point()));
       if (proximity < best_vertex_proximity) {
         m_nearestVertex = vert;
@@ -153,18 +165,15 @@ void ZoneDefaultInteraction::onProximityUpdate(const QPointF& mouse_pos, Interac
         best_vertex_proximity = proximity;
       }
     }
-    // Process segments.
-    for (EditableSpline::SegmentIterator it(*spline); it.hasNext();) {
-      const SplineSegment segment(it.next());
-      const QLineF line(to_screen.map(segment.toLine()));
-      QPointF point_on_segment;
-      const Proximity proximity(Proximity::pointAndLineSegment(mouse_pos, line, &point_on_segment));
-      if (proximity < best_segment_proximity) {
-        m_nearestSegment = segment;
-        m_nearestSegmentSpline = spline;
-        best_segment_proximity = proximity;
-        m_screenPointOnSegment = point_on_segment;
-      }
+    // Process the segment itself.
+    const QLineF line(to_screen.map(segment.toLine()));
+    QPointF point_on_segment;
+    const Proximity proximity(Proximity::pointAndLineSegment(mouse_pos, line, &point_on_segment));
+    if (proximity < best_segment_proximity) {
+      m_nearestSegment = segment;
+      m_nearestSegmentSpline = spline;
+      best_segment_proximity = proximity;
+      m_screenPointOnSegment = point_on_segment;
     }
   }
 
@@ -172,7 +181,14 @@ void ZoneDefaultInteraction::onProximityUpdate(const QPointF& mouse_pos, Interac
   interaction.updateProximity(m_segmentProximity, best_segment_proximity, 1);
 
   if (has_zone_under_mouse) {
-    const Proximity zone_area_proximity(std::min(best_vertex_proximity, best_segment_proximity));
+    Proximity zone_area_proximity(std::min(best_vertex_proximity, best_segment_proximity));
+    if (zone_area_proximity == Proximity()) {
+      // Nothing within the search radius.  Any finite proximity will do
+      // here: no other captor competes at this priority, while passing
+      // Proximity() would make updateProximity() substitute the default
+      // threshold and reject it.
+      zone_area_proximity = Proximity::fromSqDist(std::numeric_limits<double>::max() / 2);
+    }
     interaction.updateProximity(m_zoneAreaProximity, zone_area_proximity, -1, zone_area_proximity);
     if (m_activeKeyboardModifiers == Qt::ShiftModifier) {
       interaction.updateProximity(m_zoneAreaDragProximity, Proximity::fromSqDist(0), 0);
@@ -47,7 +47,7 @@ void ZoneDragInteraction::onPaint(QPainter& painter, const InteractionState& int
 
     if (spline != m_spline) {
       // Draw the whole spline in solid color.
-      m_visualizer.drawSpline(painter, to_screen, spline);
+      m_visualizer.drawSpline(painter, to_screen, m_context.zones(), spline);
       continue;
     }
     // Draw the solid part of the spline.
@@ -60,7 +60,8 @@ void ZoneDragInteraction::onPaint(QPainter& painter, const InteractionState& int
     m_visualizer.prepareForSpline(painter, spline);
     painter.drawPolyline(points);
 
-    m_visualizer.drawSpline(painter, to_screen, spline);
+    // The cached outline is kept fresh by onMouseMoveEvent().
+    m_visualizer.drawSpline(painter, to_screen, m_context.zones(), spline);
   }
 }  // ZoneDragInteraction::onPaint
 
@@ -83,5 +84,9 @@ void ZoneDragInteraction::onMouseMoveEvent(QMouseEvent* event, InteractionState&
     vertex->setPoint(from_screen.map(to_screen.map(vertex->point()) + shift - splineShift));
   } while (vertex = vertex->next(SplineVertex::LOOP), vertex != m_spline->firstVertex());
 
+  // Keep the cached outline in sync while dragging.  A full index
+  // rebuild only happens on commit.
+  m_context.zones().spatialIndex().updateOutline(m_spline);
+
   m_context.imageView().update();
 }  // ZoneDragInteraction::onMouseMoveEvent
@@ -18,6 +18,7 @@
 
 #include "ZoneSet.h"
 #include <QDomNode>
+#include <atomic>
 
 ZoneSet::ZoneSet(const QDomElement& el, const PropertyFactory& prop_factory) {
   const QString zone_str("zone");
@@ -48,3 +49,9 @@ QDomElement ZoneSet::toXml(QDomDocument& doc, const QString& name) const {
 
   return el;
 }
+
+uint64_t ZoneSet::nextRevision() {
+  static std::atomic<uint64_t> counter(0);
+
+  return ++counter;
+}
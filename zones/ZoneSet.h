@@ -20,6 +20,7 @@
 #define ZONE_SET_H_
 
 #include <boost/iterator/iterator_facade.hpp>
+#include <cstdint>
 #include <list>
 #include "Zone.h"
 
@@ -42,16 +43,37 @@ class ZoneSet {
 
   bool empty() const { return m_zones.empty(); }
 
-  void add(const Zone& zone) { m_zones.push_back(zone); }
+  void add(const Zone& zone) {
+    m_zones.push_back(zone);
+    m_revision = nextRevision();
+  }
 
-  const_iterator erase(const_iterator position) { return m_zones.erase(position); }
+  const_iterator erase(const_iterator position) {
+    m_revision = nextRevision();
+    return m_zones.erase(position);
+  }
 
   const_iterator begin() const { return m_zones.begin(); }
 
   const_iterator end() const { return m_zones.end(); }
 
+  /**
+   * \brief A process-wide unique version number of the set's contents.
+   *
+   * Every construction and every mutation draws a fresh number from a
+   * global counter, so two sets with different contents can never end
+   * up with the same revision.  Copies share the revision of their
+   * source, which is what makes it usable as a cache key: anything
+   * derived from the zones (say a rasterized mask) may be reused as
+   * long as the revision matches.
+   */
+  uint64_t revision() const { return m_revision; }
+
  private:
+  static uint64_t nextRevision();
+
   std::list<Zone> m_zones;
+  uint64_t m_revision = nextRevision();
 };
 
 
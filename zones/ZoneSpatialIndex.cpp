@@ -0,0 +1,202 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ZoneSpatialIndex.h"
+#include <QLineF>
+#include <algorithm>
+#include <cmath>
+#include "EditableZoneSet.h"
+
+ZoneSpatialIndex::ZoneSpatialIndex(const EditableZoneSet& zones)
+    : m_zones(zones), m_numCols(0), m_numRows(0), m_cellSize(1.0), m_curStamp(0), m_dirty(true) {}
+
+ZoneSpatialIndex::~ZoneSpatialIndex() = default;
+
+void ZoneSpatialIndex::invalidate() {
+  m_dirty = true;
+}
+
+void ZoneSpatialIndex::rebuild() const {
+  m_segments.clear();
+  m_segmentBoxes.clear();
+  m_splineAreas.clear();
+  m_areaBySpline.clear();
+  m_cells.clear();
+  m_numCols = 0;
+  m_numRows = 0;
+
+  QRectF bounds;
+
+  for (const EditableZoneSet::Zone& zone : m_zones) {
+    const EditableSpline::Ptr& spline = zone.spline();
+
+    SplineArea area;
+    area.spline = spline;
+    buildOutline(area);
+    bounds |= area.boundingBox;
+    m_areaBySpline[spline.get()] = (uint32_t) m_splineAreas.size();
+    m_splineAreas.push_back(std::move(area));
+
+    for (EditableSpline::SegmentIterator it(*spline); it.hasNext();) {
+      const SplineSegment segment(it.next());
+      const QLineF line(segment.toLine());
+      m_segments.push_back(SegmentHit{spline, segment});
+      m_segmentBoxes.push_back(QRectF(line.p1(), line.p2()).normalized());
+    }
+  }
+
+  m_visitStamps.assign(m_segments.size(), 0);
+  m_curStamp = 0;
+  m_gridRect = bounds;
+
+  // A fixed-resolution grid is good enough here: what matters is that
+  // a query visits a few cells around the cursor rather than every
+  // segment of every zone.
+  const double max_dim = std::max(bounds.width(), bounds.height());
+  if (!m_segments.empty() && (max_dim > 0.0)) {
+    m_cellSize = max_dim / 64.0;
+    m_numCols = std::max(1, (int) std::ceil(bounds.width() / m_cellSize));
+    m_numRows = std::max(1, (int) std::ceil(bounds.height() / m_cellSize));
+    m_cells.resize((size_t) m_numCols * m_numRows);
+
+    const auto num_segments = (uint32_t) m_segments.size();
+    for (uint32_t i = 0; i < num_segments; ++i) {
+      const QRectF& box = m_segmentBoxes[i];
+      const int first_col = colOf(box.left());
+      const int last_col = colOf(box.right());
+      const int first_row = rowOf(box.top());
+      const int last_row = rowOf(box.bottom());
+      for (int row = first_row; row <= last_row; ++row) {
+        for (int col = first_col; col <= last_col; ++col) {
+          m_cells[row * m_numCols + col].push_back(i);
+        }
+      }
+    }
+  }
+
+  m_dirty = false;
+}  // ZoneSpatialIndex::rebuild
+
+void ZoneSpatialIndex::buildOutline(SplineArea& area) {
+  area.path = QPainterPath();
+  area.path.setFillRule(Qt::WindingFill);
+  area.path.addPolygon(area.spline->toPolygon());
+  // Unlike QPainterPath::contains(), stroking doesn't treat subpaths
+  // as implicitly closed.
+  area.path.closeSubpath();
+  area.boundingBox = area.path.controlPointRect();
+}
+
+const QPainterPath* ZoneSpatialIndex::outlinePath(const EditableSpline::Ptr& spline) const {
+  if (m_dirty) {
+    rebuild();
+  }
+
+  const auto it(m_areaBySpline.find(spline.get()));
+  if (it == m_areaBySpline.end()) {
+    return nullptr;
+  }
+
+  return &m_splineAreas[it->second].path;
+}
+
+void ZoneSpatialIndex::updateOutline(const EditableSpline::Ptr& spline) const {
+  if (m_dirty) {
+    // The next query rebuilds everything anyway.
+    return;
+  }
+
+  const auto it(m_areaBySpline.find(spline.get()));
+  if (it != m_areaBySpline.end()) {
+    buildOutline(m_splineAreas[it->second]);
+  }
+}
+
+int ZoneSpatialIndex::colOf(const double x) const {
+  return std::min(m_numCols - 1, std::max(0, (int) ((x - m_gridRect.left()) / m_cellSize)));
+}
+
+int ZoneSpatialIndex::rowOf(const double y) const {
+  return std::min(m_numRows - 1, std::max(0, (int) ((y - m_gridRect.top()) / m_cellSize)));
+}
+
+const std::vector<ZoneSpatialIndex::SegmentHit>& ZoneSpatialIndex::segmentsNear(const QPointF& pos,
+                                                                                const double radius) const {
+  if (m_dirty) {
+    rebuild();
+  }
+
+  m_segmentResult.clear();
+
+  if (m_numCols == 0) {
+    // A degenerate grid.  Fall back to considering every segment.
+    m_segmentResult = m_segments;
+
+    return m_segmentResult;
+  }
+
+  const QRectF query_rect(pos.x() - radius, pos.y() - radius, radius * 2.0, radius * 2.0);
+  if (!query_rect.intersects(m_gridRect)) {
+    return m_segmentResult;
+  }
+
+  if (++m_curStamp == 0) {
+    // The stamp counter wrapped around.
+    std::fill(m_visitStamps.begin(), m_visitStamps.end(), 0);
+    m_curStamp = 1;
+  }
+
+  const int first_col = colOf(query_rect.left());
+  const int last_col = colOf(query_rect.right());
+  const int first_row = rowOf(query_rect.top());
+  const int last_row = rowOf(query_rect.bottom());
+
+  for (int row = first_row; row <= last_row; ++row) {
+    for (int col = first_col; col <= last_col; ++col) {
+      for (const uint32_t idx : m_cells[row * m_numCols + col]) {
+        if (m_visitStamps[idx] == m_curStamp) {
+          continue;
+        }
+        m_visitStamps[idx] = m_curStamp;
+
+        const QRectF& box = m_segmentBoxes[idx];
+        if (box.adjusted(-radius, -radius, radius, radius).contains(pos)) {
+          m_segmentResult.push_back(m_segments[idx]);
+        }
+      }
+    }
+  }
+
+  return m_segmentResult;
+}  // ZoneSpatialIndex::segmentsNear
+
+const std::vector<EditableSpline::Ptr>& ZoneSpatialIndex::splinesContaining(const QPointF& pos) const {
+  if (m_dirty) {
+    rebuild();
+  }
+
+  m_splineResult.clear();
+
+  for (const SplineArea& area : m_splineAreas) {
+    if (area.boundingBox.contains(pos) && area.path.contains(pos)) {
+      m_splineResult.push_back(area.spline);
+    }
+  }
+
+  return m_splineResult;
+}
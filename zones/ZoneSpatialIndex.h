@@ -0,0 +1,159 @@
+/*
+    Scan Tailor - Interactive post-processing tool for scanned pages.
+    Copyright (C)  Joseph Artsimovich <joseph.artsimovich@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ZONE_SPATIAL_INDEX_H_
+#define ZONE_SPATIAL_INDEX_H_
+
+#include <QPainterPath>
+#include <QPointF>
+#include <QRectF>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "EditableSpline.h"
+#include "NonCopyable.h"
+#include "SplineSegment.h"
+
+class EditableZoneSet;
+
+/**
+ * \brief A uniform grid over the segments of a zone set.
+ *
+ * The interaction classes used to measure the proximity of the mouse
+ * to every vertex and every edge of every zone on each mouse move,
+ * which got noticeably slow on pages with hundreds of zones.  This
+ * index limits such searches to a small neighbourhood of the cursor.
+ *
+ * Any modification of the zone set invalidates the index, and the next
+ * query rebuilds it from scratch.  That keeps it trivially in sync with
+ * interactive editing, where a rebuild per edit is negligible compared
+ * to a full scan per mouse move.
+ */
+class ZoneSpatialIndex {
+  DECLARE_NON_COPYABLE(ZoneSpatialIndex)
+
+ public:
+  struct SegmentHit {
+    EditableSpline::Ptr spline;
+    SplineSegment segment;
+  };
+
+  explicit ZoneSpatialIndex(const EditableZoneSet& zones);
+
+  ~ZoneSpatialIndex();
+
+  /**
+   * \brief Marks the index as stale, to be rebuilt by the next query.
+   */
+  void invalidate();
+
+  /**
+   * \brief Returns the segments that may come within \p radius of \p pos.
+   *
+   * Coordinates are in image space.  Candidates are pre-filtered by
+   * bounding box only, so the caller still has to measure the exact
+   * proximity.  Conversely, every segment within \p radius is guaranteed
+   * to be returned, and because every vertex is an endpoint of some
+   * segment, so is every vertex within \p radius.
+   *
+   * The returned reference remains valid until the next query or edit.
+   */
+  const std::vector<SegmentHit>& segmentsNear(const QPointF& pos, double radius) const;
+
+  /**
+   * \brief Returns the splines containing \p pos, in zone order.
+   *
+   * Containment is tested against the spline polygon with Qt::WindingFill,
+   * just like ZoneDefaultInteraction used to do on every mouse move.
+   *
+   * The returned reference remains valid until the next query or edit.
+   */
+  const std::vector<EditableSpline::Ptr>& splinesContaining(const QPointF& pos) const;
+
+  /**
+   * \brief The cached outline of a spline, in image space.
+   *
+   * The path is closed and uses Qt::WindingFill, so it serves both
+   * stroking the zone outline and filling its interior without a
+   * fresh path construction per repaint.  Returns null for splines
+   * that aren't members of the zone set, e.g. one being created.
+   *
+   * The returned pointer remains valid until the next edit.
+   */
+  const QPainterPath* outlinePath(const EditableSpline::Ptr& spline) const;
+
+  /**
+   * \brief Re-caches the outline of a spline modified without a commit.
+   *
+   * Much cheaper than invalidate() and meant to be called per mouse
+   * move while a spline is being dragged.  Only the cached outline and
+   * its bounding box are refreshed; the segment grid stays as of the
+   * last commit, which is fine, as hit-testing isn't consulted while
+   * the drag interaction holds the capture.
+   */
+  void updateOutline(const EditableSpline::Ptr& spline) const;
+
+ private:
+  struct SplineArea {
+    EditableSpline::Ptr spline;
+    QPainterPath path;
+    QRectF boundingBox;
+  };
+
+  void rebuild() const;
+
+  static void buildOutline(SplineArea& area);
+
+  int colOf(double x) const;
+
+  int rowOf(double y) const;
+
+  const EditableZoneSet& m_zones;
+
+  // Queries don't logically modify the index, so the lazily built
+  // state below is mutable.
+
+  mutable std::vector<SegmentHit> m_segments;
+  mutable std::vector<QRectF> m_segmentBoxes;
+  mutable std::vector<SplineArea> m_splineAreas;
+  mutable std::unordered_map<const EditableSpline*, uint32_t> m_areaBySpline;
+
+  /**
+   * Cell (col, row) holds indices into m_segments of the segments whose
+   * bounding boxes overlap it, at m_cells[row * m_numCols + col].
+   */
+  mutable std::vector<std::vector<uint32_t>> m_cells;
+  mutable QRectF m_gridRect;
+  mutable int m_numCols;
+  mutable int m_numRows;
+  mutable double m_cellSize;
+
+  /**
+   * Deduplicates segments spanning multiple cells within a single query.
+   */
+  mutable std::vector<uint32_t> m_visitStamps;
+  mutable uint32_t m_curStamp;
+
+  mutable std::vector<SegmentHit> m_segmentResult;
+  mutable std::vector<EditableSpline::Ptr> m_splineResult;
+
+  mutable bool m_dirty;
+};
+
+
+#endif  // ifndef ZONE_SPATIAL_INDEX_H_
@@ -46,7 +46,7 @@ void ZoneVertexDragInteraction::onPaint(QPainter& painter, const InteractionStat
 
     if (spline != m_spline) {
       // Draw the whole spline in solid color.
-      m_visualizer.drawSpline(painter, to_screen, spline);
+      m_visualizer.drawSpline(painter, to_screen, m_context.zones(), spline);
       continue;
     }
     // Draw the solid part of the spline.
@@ -140,6 +140,10 @@ void ZoneVertexDragInteraction::onMouseMoveEvent(QMouseEvent* event, Interaction
     }
   }
 
+  // Keep the cached outline in sync while dragging.  A full index
+  // rebuild only happens on commit.
+  m_context.zones().spatialIndex().updateOutline(m_spline);
+
   m_context.imageView().update();
 }  // ZoneVertexDragInteraction::onMouseMoveEvent
 